@@ -5,12 +5,15 @@
 #include <BackupCatalog.hxx>
 #include <fs-archive.hxx>
 #include <xlogdefs.hxx>
+#include <checksum.hxx>
 
 namespace pgbckctl {
 
   class BackupFile;
   class BackupDirectory;
   class ArchiveLogDirectory;
+  class PageChecksumReport;
+  class BaseBackupResume;
 
   /*
    * Generic base class to implement backup
@@ -62,6 +65,9 @@ namespace pgbckctl {
     std::string filename;
     bool sync_pending = false;
     bool flush_pending = false;
+
+    /* checksum of the data written into the segment */
+    std::shared_ptr<BackupChecksum> checksum = nullptr;
   };
 
   /*
@@ -102,6 +108,18 @@ namespace pgbckctl {
      */
     uint64_t wal_synced = 0;
 
+    /**
+     * Time in microseconds it took to finalize and sync the
+     * last completed WAL segment, -1 if none was completed yet.
+     */
+    long long last_sync_usec = -1;
+
+    /**
+     * WAL segments completed by write() and not yet
+     * fetched by completedSegments().
+     */
+    std::vector<std::shared_ptr<WALSegmentDescr>> completed;
+
   public:
     TransactionLogBackup(const std::shared_ptr<CatalogDescr> & descr);
     virtual ~TransactionLogBackup();
@@ -215,6 +233,20 @@ namespace pgbckctl {
      * instance.
      */
     virtual uint64_t countSynced();
+
+    /**
+     * Returns the time in microseconds the last completed
+     * WAL segment took to be renamed and synced to disk, -1 if
+     * no segment was completed so far.
+     */
+    virtual long long lastSyncDuration();
+
+    /**
+     * Returns the WAL segments completed by write() since the
+     * last call, with their name, timeline and checksum. The
+     * archive_id isn't set in the returned descriptors.
+     */
+    virtual std::vector<std::shared_ptr<WALSegmentDescr>> completedSegments();
   };
 
   typedef enum {
@@ -273,6 +305,24 @@ namespace pgbckctl {
      */
     std::string identifier = "";
 
+    /*
+     * Store tar archives in the chunk store of the archive,
+     * see setDeduplication().
+     */
+    bool deduplicate = false;
+
+    /*
+     * Verifies page checksums of relation files in tar
+     * archives, see setPageVerification().
+     */
+    std::shared_ptr<PageChecksumReport> page_report = nullptr;
+
+    /*
+     * Aborted basebackups resumed by this one, see
+     * setResume().
+     */
+    std::shared_ptr<BaseBackupResume> resume = nullptr;
+
     /*
      * On instantiation, StreamBaseBackup creates an internal
      * name in the format streambackup-<TIMESTAMP>, which represents
@@ -291,6 +341,31 @@ namespace pgbckctl {
     virtual void finalize();
     virtual void setCompression(BackupProfileCompressType compression);
     virtual BackupProfileCompressType getCompression();
+
+    /**
+     * Tar archives stacked afterwards are deduplicated against
+     * the chunk store of the archive, see ChunkedArchiveFile.
+     */
+    virtual void setDeduplication(bool deduplicate);
+    virtual bool getDeduplication();
+
+    /**
+     * Page checksums of relation files in tar archives stacked
+     * afterwards are verified and the results recorded in the
+     * specified report, see PageVerifyingFile. Passing nullptr
+     * turns verification off.
+     */
+    virtual void setPageVerification(std::shared_ptr<PageChecksumReport> report);
+    virtual std::shared_ptr<PageChecksumReport> getPageVerification();
+
+    /**
+     * Incremental files in tar archives stacked afterwards are
+     * materialized from the specified aborted basebackups, and
+     * the manifest is rewritten accordingly, see ResumingFile.
+     * Passing nullptr turns this off.
+     */
+    virtual void setResume(std::shared_ptr<BaseBackupResume> resume);
+    virtual std::shared_ptr<BaseBackupResume> getResume();
     virtual void create();
     virtual std::string backupDirectoryString();
     virtual void setMode(StreamDirectoryOperationMode mode);
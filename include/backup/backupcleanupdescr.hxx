@@ -75,7 +75,52 @@ namespace pgbckctl {
 
     WALCleanupMode mode = NO_WAL_TO_DELETE;
 
+    /**
+     * Number of completed WAL segment files physically
+     * removed by ArchiveLogDirectory::removeXLogs(). Partial segments
+     * and timeline history files aren't counted.
+     */
+    unsigned long long removed_wal_segments = 0;
+
+    /**
+     * File names of the completed WAL segments counted in
+     * removed_wal_segments, without any compression suffix.
+     */
+    std::vector<std::string> removed_wal_segment_names;
+
+    /**
+     * Number of files and bytes removed by
+     * ArchiveLogDirectory::removeXLogs(), including partial
+     * segments and timeline history files. In dry run mode
+     * these count the files which would have been removed.
+     */
+    unsigned long long removed_wal_files = 0;
+    unsigned long long removed_wal_bytes = 0;
+
   };
+
+  /**
+   * A retention plan persisted in the catalog. It records the
+   * cleanup descriptor computed by the retention rules of a policy,
+   * so that its execution can be split into batches and resumed
+   * after being interrupted.
+   *
+   * The basebackups list of the cleanup descriptor carries the
+   * basebackups still pending for deletion only.
+   */
+  class RetentionPlanDescr {
+  public:
+
+    int archive_id = -1;
+    std::string retention_name = "";
+    std::string created = "";
+    unsigned long long wal_segment_size = 0;
+
+    std::shared_ptr<BackupCleanupDescr> cleanupDescr
+      = std::make_shared<BackupCleanupDescr>();
+
+  };
+
 }
 
 #endif
@@ -13,6 +13,8 @@
 #include <signalhandler.hxx>
 #include <basebackupmsg.hxx>
 #include <xlogdefs.hxx>
+#include <writepipeline.hxx>
+#include <checksum.hxx>
 
 #define MAXXLOGFNAMELEN MAXFNAMELEN
 
@@ -153,6 +155,11 @@ namespace pgbckctl {
      */
     std::shared_ptr<BackupTablespaceDescr> descr;
 
+    /*
+     * Checksum of the data written to the file so far.
+     */
+    std::shared_ptr<BackupChecksum> checksum;
+
     /**
      * Reset state backup to initial.
      */
@@ -161,6 +168,7 @@ namespace pgbckctl {
       handle       = nullptr;
       file         = nullptr;
       descr        = nullptr;
+      checksum     = nullptr;
     }
 
   };
@@ -182,6 +190,40 @@ namespace pgbckctl {
      */
     std::shared_ptr<TransactionLogBackup> backupHandler = nullptr;
 
+    /**
+     * Catalog handle to account completed WAL segments, optional.
+     */
+    std::shared_ptr<BackupCatalog> catalog = nullptr;
+
+    /**
+     * Worker instrumentation handle, optional. Only set if
+     * running as a background worker.
+     */
+    std::shared_ptr<WorkerInstrumentation> instr = nullptr;
+
+    /**
+     * Received WAL bytes and messages, published via instr.
+     */
+    InstrumentationRate instr_bytes;
+    InstrumentationRate instr_msgs;
+
+    /**
+     * Publishes the current stream positions and rates
+     * into the worker instrumentation, if any.
+     */
+    virtual void instrument(XLOGDataStreamMessage *datamsg);
+
+    /**
+     * I/O governor handle, optional. Consulted before
+     * received WAL is written.
+     */
+    std::shared_ptr<IOGovernor> governor = nullptr;
+
+    /**
+     * Worker event log handle, optional.
+     */
+    std::shared_ptr<WorkerEventLog> events = nullptr;
+
     /**
      * Timeout for polling on WAL stream.
      *
@@ -323,6 +365,32 @@ namespace pgbckctl {
      */
     virtual void setBackupHandler(std::shared_ptr<TransactionLogBackup> backupHandler);
 
+    /**
+     * Assigns a catalog handle to a WALStreamerProcess instance. If
+     * set, each completed WAL segment is accounted in the archive
+     * statistics of the streamed archive.
+     */
+    virtual void setCatalog(std::shared_ptr<BackupCatalog> catalog);
+
+    /**
+     * Assigns a worker instrumentation handle. If set, received
+     * and flushed positions, throughput and the sync latency of
+     * completed WAL segments are published there.
+     */
+    virtual void setInstrumentation(std::shared_ptr<WorkerInstrumentation> instr);
+
+    /**
+     * Assigns an I/O governor handle. If set, writing received
+     * WAL is throttled according to the WAL budget.
+     */
+    virtual void setIOGovernor(std::shared_ptr<IOGovernor> governor);
+
+    /**
+     * Assigns a worker event log handle. If set, every message
+     * received and status update sent is recorded there.
+     */
+    virtual void setEventLog(std::shared_ptr<WorkerEventLog> events);
+
     /**
      * Returns the current encoded XLOG position, if active.
      */
@@ -435,6 +503,71 @@ namespace pgbckctl {
      * Increments the iterator one step.
      */
     virtual void incr();
+
+    /**
+     * Worker instrumentation handle, optional.
+     */
+    std::shared_ptr<WorkerInstrumentation> instr = nullptr;
+
+    /**
+     * Bytes received for all tablespaces, used for the throughput.
+     */
+    InstrumentationRate instr_bytes;
+
+    /**
+     * Bytes received for the tablespace currently streamed.
+     */
+    unsigned long long instr_tablespace_bytes = 0;
+
+    /**
+     * Starts instrumenting the tablespace of the current step.
+     */
+    virtual void instrumentStep();
+
+    /**
+     * Accounts the specified number of bytes received for
+     * the current step and publishes the instrumentation.
+     */
+    virtual void instrument(size_t bytes);
+
+    /**
+     * I/O governor handle, optional.
+     */
+    std::shared_ptr<IOGovernor> governor = nullptr;
+
+    /**
+     * Waits for the I/O governor to admit writing the
+     * specified number of bytes, if any.
+     */
+    virtual void throttle(size_t bytes);
+
+    /**
+     * Write pipeline, optional. If set, data of the current
+     * step is written by its writer thread.
+     */
+    std::shared_ptr<BackupWritePipeline> pipeline = nullptr;
+
+    /**
+     * Writes the specified data to the file of the current step,
+     * either through the write pipeline or directly after having
+     * been admitted by the I/O governor.
+     */
+    virtual void writeStep(const char *data, size_t len);
+
+    /**
+     * Waits until all data passed to writeStep() is written.
+     * Must be called before the file of the current step is
+     * synced or closed.
+     */
+    virtual void flushStep();
+
+    /**
+     * Stores the checksum of all data passed to writeStep()
+     * for the current step into its tablespace descriptor.
+     * Must be called once the step is complete.
+     */
+    virtual void checksumStep();
+
   public:
 
     /**
@@ -442,6 +575,28 @@ namespace pgbckctl {
      */
     virtual size_t consumed();
 
+    /**
+     * Assigns a worker instrumentation handle. If set, the current
+     * tablespace, its bytes, throughput and compression ratio
+     * are published there.
+     */
+    virtual void setInstrumentation(std::shared_ptr<WorkerInstrumentation> instr);
+
+    /**
+     * Assigns an I/O governor handle. If set, writing the
+     * tablespace streams is throttled according to the basebackup
+     * budget.
+     */
+    virtual void setIOGovernor(std::shared_ptr<IOGovernor> governor);
+
+    /**
+     * Assigns a write pipeline. If set, receiving the tablespace
+     * streams doesn't wait for their files to be written, and
+     * the pipeline queue depth and stall times are published into
+     * the worker instrumentation.
+     */
+    virtual void setWritePipeline(std::shared_ptr<BackupWritePipeline> pipeline);
+
   };
 
   /**
@@ -530,6 +685,12 @@ namespace pgbckctl {
      */
     std::shared_ptr<StreamBaseBackup> backupHandle = nullptr;
 
+    /**
+     * Compression applied by the server to the archives, if any.
+     * Archives are stored as received then.
+     */
+    BackupProfileCompressType server_compression = BACKUP_COMPRESS_TYPE_NONE;
+
     /**
      * Receives a copy data stream.
      * @param msg BaseBackupMessage message kind
@@ -553,6 +714,12 @@ namespace pgbckctl {
     explicit MessageStreamer(std::shared_ptr<StreamBaseBackup> backupHandle,
                              PGconn *conn);
 
+    /**
+     * Tells the streamer that the server compresses the archives
+     * with the specified method.
+     */
+    void setServerCompression(BackupProfileCompressType compression);
+
     /**
      * Streams manifest data into the current archive file handle
      */
@@ -630,6 +797,34 @@ namespace pgbckctl {
                              PGconn *prepared_conn,
                              BaseBackupQueryType type) = 0;
 
+    /**
+     * Assigns a worker instrumentation handle to the
+     * protocol handler.
+     */
+    virtual void assignInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) = 0;
+
+    /**
+     * Assigns an I/O governor handle to the
+     * protocol handler.
+     */
+    virtual void assignIOGovernor(std::shared_ptr<IOGovernor> governor) = 0;
+
+    /**
+     * Assigns a write pipeline to the
+     * protocol handler.
+     */
+    virtual void assignWritePipeline(std::shared_ptr<BackupWritePipeline> pipeline) = 0;
+
+    /**
+     * Uploads the backup manifest of the parent basebackup, turning
+     * the next BASE_BACKUP command into an incremental basebackup.
+     * Must be called before the query is sent.
+     *
+     * Throws a StreamingFailure if the server doesn't support
+     * incremental basebackups.
+     */
+    virtual void uploadManifest(std::string const& manifest);
+
   };
 
   /**
@@ -651,6 +846,10 @@ namespace pgbckctl {
                       PGconn *prepared_conn,
                       BaseBackupQueryType type) override;
 
+    void assignInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) override;
+    void assignIOGovernor(std::shared_ptr<IOGovernor> governor) override;
+    void assignWritePipeline(std::shared_ptr<BackupWritePipeline> pipeline) override;
+
   };
 
   /**
@@ -673,6 +872,10 @@ namespace pgbckctl {
                       PGconn *prepared_conn,
                       BaseBackupQueryType type) override;
 
+    void assignInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) override;
+    void assignIOGovernor(std::shared_ptr<IOGovernor> governor) override;
+    void assignWritePipeline(std::shared_ptr<BackupWritePipeline> pipeline) override;
+
   };
 
   /**
@@ -695,6 +898,38 @@ namespace pgbckctl {
                       PGconn *prepared_conn,
                       BaseBackupQueryType type) override;
 
+    void assignInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) override;
+    void assignIOGovernor(std::shared_ptr<IOGovernor> governor) override;
+    void assignWritePipeline(std::shared_ptr<BackupWritePipeline> pipeline) override;
+
+  };
+
+  /**
+   * Protocol implementation for BASE_BACKUP command, suitable for
+   * PostgreSQL versions 17 and above. Adds incremental basebackups
+   * based on an uploaded manifest of a former basebackup.
+   */
+  class BaseBackupStream17 : public BaseBackupStream15 {
+  private:
+
+    /**
+     * Set after a manifest was uploaded successfully.
+     */
+    bool incremental = false;
+
+  public:
+
+    explicit BaseBackupStream17(PGconn *prepared_conn,
+                                std::shared_ptr<StreamBaseBackup> backupHandle,
+                                std::shared_ptr<BackupProfileDescr> profileDescr);
+    ~BaseBackupStream17() override;
+
+    std::string query(std::shared_ptr<BackupProfileDescr> profile,
+                      PGconn *prepared_conn,
+                      BaseBackupQueryType type) override;
+
+    void uploadManifest(std::string const& manifest) override;
+
   };
 
   /*
@@ -710,6 +945,36 @@ namespace pgbckctl {
      */
     std::shared_ptr<BaseBackupStream> tinfo = nullptr;
 
+    /**
+     * Worker instrumentation handle, optional.
+     */
+    std::shared_ptr<WorkerInstrumentation> instr = nullptr;
+
+    /**
+     * I/O governor handle, optional.
+     */
+    std::shared_ptr<IOGovernor> governor = nullptr;
+
+    /**
+     * Worker event log handle, optional.
+     */
+    std::shared_ptr<WorkerEventLog> events = nullptr;
+
+    /**
+     * Number and size of the write pipeline buffers,
+     * no pipeline is used if 0.
+     */
+    unsigned int write_buffers = 0;
+    size_t write_buffer_size = 0;
+
+    /**
+     * Parent and its manifest for an incremental
+     * basebackup, -1 for a full basebackup. Resumed basebackups
+     * upload a manifest without a parent.
+     */
+    int parent_id = -1;
+    std::string parent_manifest = "";
+
   protected:
     BaseBackupState current_state;
     PGconn *pgconn;
@@ -721,6 +986,14 @@ namespace pgbckctl {
     std::string systemid;
     unsigned long long wal_segment_size = 0;
 
+    /**
+     * Registers the tablespaces in the specified list in
+     * the catalog within a single transaction and clears the
+     * list afterwards.
+     */
+    void registerTablespaces(std::shared_ptr<BackupCatalog> catalog,
+                             std::vector<std::shared_ptr<BackupTablespaceDescr>> &list);
+
   public:
 
     BaseBackupProcess(PGconn *prepared_connection,
@@ -794,6 +1067,41 @@ namespace pgbckctl {
      * Assigns a stop signal handler.
      */
     void assignStopHandler(JobSignalHandler *stopHandler) override;
+
+    /**
+     * Assigns a worker instrumentation handle. Must be called
+     * before prepareStream() to take effect.
+     */
+    virtual void setInstrumentation(std::shared_ptr<WorkerInstrumentation> instr);
+
+    /**
+     * Assigns an I/O governor handle. Must be called
+     * before start() to take effect.
+     */
+    virtual void setIOGovernor(std::shared_ptr<IOGovernor> governor);
+
+    /**
+     * Assigns a worker event log handle. If set, start and end
+     * of the basebackup and every tablespace are recorded there.
+     */
+    virtual void setEventLog(std::shared_ptr<WorkerEventLog> events);
+
+    /**
+     * Writes the received tablespace streams through a write
+     * pipeline with the specified number of buffers of buffer_size
+     * bytes each. 0 buffers write synchronously, which is the
+     * default. Must be called before prepareStream() to take effect.
+     */
+    virtual void setWritePipeline(unsigned int buffers, size_t buffer_size);
+
+    /**
+     * Turns this into an incremental basebackup of the specified
+     * parent, by uploading its backup manifest before the stream
+     * is started. Must be called before start(). A resumed
+     * basebackup uploads a manifest without a parent, passing
+     * -1 as parent_id.
+     */
+    virtual void setIncremental(int parent_id, std::string manifest);
   };
 
 }
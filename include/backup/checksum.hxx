@@ -0,0 +1,130 @@
+#ifndef __HAVE_CHECKSUM_HXX__
+#define __HAVE_CHECKSUM_HXX__
+
+#include <memory>
+#include <string>
+#include <stdint.h>
+
+#include <common.hxx>
+
+namespace pgbckctl {
+
+  /**
+   * Checksum algorithm used for basebackup archives and WAL
+   * segments while they are streamed into an archive. Their
+   * checksums are stored in the catalog.
+   */
+#define STREAM_CHECKSUM_ALGORITHM "CRC32C"
+
+  /**
+   * Unsupported or unknown checksum algorithms are
+   * reported by ChecksumFailure exceptions.
+   */
+  class ChecksumFailure : public CPGBackupCtlFailure {
+  public:
+    ChecksumFailure(const char *errstr) throw() : CPGBackupCtlFailure(errstr) {};
+    ChecksumFailure(std::string errstr) throw() : CPGBackupCtlFailure(errstr) {};
+  };
+
+  /**
+   * Incremental checksum over a stream of data, using one of
+   * the algorithms a backup manifest of PostgreSQL can specify
+   * (CRC32C, SHA224, SHA256, SHA384, SHA512).
+   *
+   * final() returns the checksum hex encoded, in the same
+   * representation used by the backup manifest.
+   */
+  class BackupChecksum {
+  protected:
+
+    std::string algorithm = "NONE";
+
+  public:
+
+    virtual ~BackupChecksum();
+
+    /**
+     * Returns a checksum instance for the given manifest algorithm
+     * name. Throws a ChecksumFailure if the algorithm is unknown or
+     * not supported by this build.
+     */
+    static std::shared_ptr<BackupChecksum> get(std::string algorithm);
+
+    /**
+     * Returns true if get() supports the given algorithm.
+     */
+    static bool supported(std::string algorithm);
+
+    /**
+     * Returns a short description of the implementation used
+     * for the given algorithm, e.g. whether CRC32C is computed
+     * by the CPU.
+     */
+    static std::string implementation(std::string algorithm);
+
+    virtual std::string getAlgorithm();
+
+    virtual void reset() = 0;
+    virtual void update(const char *buf, size_t len) = 0;
+    virtual std::string final() = 0;
+
+  };
+
+  /**
+   * CRC-32C (Castagnoli). Uses the crc32 instructions of SSE 4.2 or
+   * ARMv8 if the CPU supports them, slicing-by-8 otherwise.
+   */
+  class CRC32CChecksum : public BackupChecksum {
+  private:
+
+    uint32_t crc = 0xFFFFFFFF;
+
+  public:
+
+    CRC32CChecksum();
+    virtual ~CRC32CChecksum();
+
+    /**
+     * Returns true if CRC32C is computed by the CPU.
+     */
+    static bool hardware();
+
+    /**
+     * Continues the raw (not finalized) crc over the given data.
+     */
+    static uint32_t compute(uint32_t crc, const char *buf, size_t len);
+
+    virtual void reset();
+    virtual void update(const char *buf, size_t len);
+    virtual std::string final();
+
+  };
+
+#ifdef PG_BACKUP_CTL_HAS_OPENSSL
+
+  /**
+   * SHA-2 checksums, computed by libcrypto. libcrypto uses the
+   * SHA extensions of the CPU (SHA-NI) itself, if available.
+   */
+  class SHA2Checksum : public BackupChecksum {
+  private:
+
+    void *ctx = nullptr;
+    const void *md = nullptr;
+
+  public:
+
+    SHA2Checksum(std::string algorithm);
+    virtual ~SHA2Checksum();
+
+    virtual void reset();
+    virtual void update(const char *buf, size_t len);
+    virtual std::string final();
+
+  };
+
+#endif
+
+}
+
+#endif
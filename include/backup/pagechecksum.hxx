@@ -0,0 +1,186 @@
+#ifndef __HAVE_PAGECHECKSUM_HXX__
+#define __HAVE_PAGECHECKSUM_HXX__
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <fs-archive.hxx>
+#include <fs-tar.hxx>
+
+namespace pgbckctl {
+
+  /**
+   * Defaults of a PostgreSQL build, block size and
+   * blocks per relation segment (1GB).
+   */
+#define PAGE_CHECKSUM_BLCKSZ 8192
+#define PAGE_CHECKSUM_RELSEG_SIZE 131072
+
+  /**
+   * Number of bad pages whose location is recorded,
+   * further ones are counted only.
+   */
+#define PAGE_CHECKSUM_MAX_REPORTED 100
+
+  /**
+   * Data page checksums as computed by PostgreSQL (FNV-1a
+   * based, see src/include/storage/checksum_impl.h).
+   *
+   * The page is treated as a matrix of 32 columns of 32 bit
+   * words, each column gets its own running sum. Columns are
+   * independent, so the AVX2 implementation computes eight of
+   * them with a single instruction. The scalar implementation
+   * is used if the CPU doesn't support AVX2.
+   */
+  class PageChecksum {
+  public:
+
+    /**
+     * Computes the checksum of a page of blcksz bytes, blkno is
+     * the block number within the relation (not the segment). The
+     * page isn't changed, its pd_checksum field is ignored.
+     */
+    static uint16_t compute(const char *page,
+                            uint32_t blkno,
+                            unsigned int blcksz = PAGE_CHECKSUM_BLCKSZ);
+
+    /**
+     * True if the AVX2 implementation is used.
+     */
+    static bool vectorized();
+
+    /**
+     * Returns true if the specified data directory path is a
+     * relation segment with page checksums, segno is set to the
+     * segment number then.
+     */
+    static bool relationFile(std::string name, unsigned int &segno);
+
+  };
+
+  /**
+   * Result of the page verification of a basebackup. Thread safe,
+   * pages are verified by the writer thread of the pipeline.
+   */
+  class PageChecksumReport {
+  private:
+
+    std::mutex mtx;
+
+    uint64_t startpos = 0;
+    unsigned int blcksz = PAGE_CHECKSUM_BLCKSZ;
+    unsigned int relseg_size = PAGE_CHECKSUM_RELSEG_SIZE;
+
+    unsigned long long verified = 0;
+    unsigned long long skipped = 0;
+    unsigned long long failed = 0;
+
+    std::vector<std::string> bad_pages;
+
+  public:
+
+    /**
+     * Pages with a LSN at or after startpos, the start of the
+     * basebackup, might be torn and are skipped. WAL replay fixes
+     * them anyway.
+     */
+    PageChecksumReport(uint64_t startpos,
+                       unsigned int blcksz = PAGE_CHECKSUM_BLCKSZ,
+                       unsigned int relseg_size = PAGE_CHECKSUM_RELSEG_SIZE);
+    virtual ~PageChecksumReport();
+
+    virtual uint64_t getStartPos();
+    virtual unsigned int getBlockSize();
+    virtual unsigned int getSegmentSize();
+
+    /**
+     * Verifies a single page of the specified relation segment
+     * and records the result.
+     */
+    virtual void verify(std::string const &file,
+                        unsigned int segno,
+                        uint32_t block,
+                        const char *page);
+
+    virtual unsigned long long pagesVerified();
+    virtual unsigned long long pagesSkipped();
+    virtual unsigned long long failures();
+
+    /**
+     * Bad pages as "<file> block <n>", comma separated. At most
+     * PAGE_CHECKSUM_MAX_REPORTED are listed.
+     */
+    virtual std::string detail();
+
+  };
+
+  /**
+   * Writes a tar stream into a BackupFile and verifies the page
+   * checksums of the relation files passing by. Everything else is
+   * handed to the underlying file unchanged, a bad page is recorded
+   * in the report but doesn't stop the basebackup.
+   */
+  class PageVerifyingFile : public BackupFile {
+  private:
+
+    std::shared_ptr<BackupFile> file = nullptr;
+    std::shared_ptr<PageChecksumReport> report = nullptr;
+    TarStreamIndexer indexer;
+
+    /* data directory prefix of the members, see archivePrefix() */
+    std::string prefix = "";
+
+    /* current member, if it's a relation segment */
+    size_t member = 0;
+    bool relation = false;
+    unsigned int segno = 0;
+    std::string member_name = "";
+
+    /* page being assembled */
+    std::string page = "";
+    uint32_t block = 0;
+
+    void nextMember();
+    void verifyData(const char *buf,
+                    unsigned long long offset,
+                    size_t len);
+
+  public:
+
+    PageVerifyingFile(std::shared_ptr<BackupFile> file,
+                      std::shared_ptr<PageChecksumReport> report);
+    virtual ~PageVerifyingFile();
+
+    /**
+     * Returns the data directory prefix of the members of
+     * the specified tar archive, pg_tblspc/<oid>/ for
+     * tablespaces.
+     */
+    static std::string archivePrefix(std::string archive_name);
+
+    virtual bool isCompressed();
+    virtual void setCompressed(bool compressed);
+
+    virtual void open();
+    virtual void close();
+    virtual void fsync();
+    virtual bool isOpen();
+    virtual void rename(path& newname);
+    virtual void setOpenMode(std::string mode);
+    virtual std::string getOpenMode();
+    virtual size_t write(const char *buf, size_t len);
+    virtual size_t read(char *buf, size_t len);
+    virtual void remove();
+    virtual size_t size();
+    virtual off_t lseek(off_t offset, int whence);
+    virtual off_t current_position();
+    virtual off_t frameBoundary();
+
+  };
+
+}
+
+#endif
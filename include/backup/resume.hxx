@@ -0,0 +1,348 @@
+#ifndef __HAVE_RESUME_HXX__
+#define __HAVE_RESUME_HXX__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <fs-archive.hxx>
+#include <fs-tar.hxx>
+#include <checksum.hxx>
+#include <descr.hxx>
+
+namespace pgbckctl {
+
+  /**
+   * Incremental files sent by PostgreSQL 17 for relation files
+   * listed in the uploaded manifest are named INCREMENTAL.<file>
+   * and start with this magic number.
+   */
+#define RESUME_INCREMENTAL_PREFIX "INCREMENTAL."
+#define RESUME_INCREMENTAL_MAGIC 0xd3ae1f0d
+
+  /**
+   * Name of the manifest file in a streamed basebackup.
+   */
+#define RESUME_MANIFEST_FILE "backup.manifest"
+
+  /**
+   * A complete member of an aborted basebackup.
+   */
+  typedef struct {
+
+    /* archive the member was found in, see BaseBackupResume */
+    size_t archive = 0;
+
+    /* member name and offset of its header in the tar stream */
+    std::string name = "";
+    unsigned long long header_offset = 0;
+
+    unsigned long long size = 0;
+    time_t mtime = 0;
+
+    /* CRC32C of its data */
+    std::string checksum = "";
+
+  } resume_member;
+
+  /**
+   * A file of the manifest received from the server which was
+   * materialized while streaming, with its size and checksum
+   * afterwards.
+   */
+  typedef struct {
+
+    std::string path = "";
+    unsigned long long size = 0;
+    std::string checksum = "";
+
+  } resume_replacement;
+
+  /**
+   * Resumes aborted basebackups of an archive.
+   *
+   * The complete members of the tar archives left behind by aborted
+   * basebackups are collected and listed in a backup manifest, which
+   * is uploaded to a PostgreSQL 17 server. The server then sends
+   * incremental files for relation files found there, containing only
+   * the blocks changed since the aborted basebackups started. These
+   * are materialized into full files from the blocks already on disk
+   * while they are written (see ResumingFile), so the resulting
+   * basebackup is a full one, neither depending on the aborted
+   * basebackups nor requiring pg_combinebackup.
+   *
+   * Thread safe, archives are written by the writer thread of the
+   * pipeline.
+   */
+  class BaseBackupResume {
+  private:
+
+    /* source of an archive of an aborted basebackup */
+    typedef struct {
+
+      path file;
+
+      /* index of the archive, if it has a usable one */
+      std::shared_ptr<TarArchiveIndex> index = nullptr;
+
+      /* sequential reader and header offset of its current member */
+      std::shared_ptr<TarArchiveReader> reader = nullptr;
+      unsigned long long position = 0;
+      bool positioned = false;
+
+    } resume_archive;
+
+    std::mutex mtx;
+
+    std::string checksum_algorithm = "NONE";
+    unsigned int blcksz = 8192;
+
+    std::vector<resume_archive> archives;
+
+    /* complete members, by their path in the manifest */
+    std::map<std::string, resume_member> members;
+
+    /* IDs of the aborted basebackups, the newest first */
+    std::vector<int> partials;
+
+    /* start of the WAL the aborted basebackups depend on */
+    uint64_t startpos = 0;
+    std::string startpos_str = "";
+    int timeline = -1;
+
+    /* materialized files, by their path in the received manifest */
+    std::map<std::string, resume_replacement> replacements;
+
+    void scanArchive(path archive);
+
+  public:
+
+    /**
+     * Materialized files get a checksum of the specified manifest
+     * algorithm, blcksz is the block size of the server.
+     */
+    BaseBackupResume(std::string checksum_algorithm, unsigned int blcksz);
+    virtual ~BaseBackupResume();
+
+    /**
+     * Returns the path of a member of the specified tar archive in
+     * the backup manifest. Tablespace archives of PostgreSQL 15 and
+     * later are named by their OID and have the members below
+     * pg_tblspc/<oid>/.
+     */
+    static std::string manifestPath(std::string archive_name,
+                                    std::string member_name);
+
+    /**
+     * Reads the tar archives of an aborted basebackup and collects
+     * their complete members. Members of basebackups added before
+     * take precedence, so aborted basebackups should be added the
+     * newest first. Archives which can't be read are skipped.
+     */
+    virtual void addPartial(std::shared_ptr<BaseBackupDescr> partial);
+
+    /**
+     * IDs of the aborted basebackups added, the newest first.
+     */
+    virtual std::vector<int> getPartials();
+
+    /**
+     * Number of complete members collected.
+     */
+    virtual size_t files();
+
+    virtual std::string getChecksumAlgorithm();
+    virtual unsigned int getBlockSize();
+
+    /**
+     * Returns a backup manifest listing the collected members, to
+     * be uploaded for an incremental basebackup. Its WAL range starts
+     * and ends at the start of the oldest aborted basebackup added.
+     */
+    virtual std::string manifest(std::string systemid);
+
+    /**
+     * Looks up the collected member with the specified
+     * manifest path.
+     */
+    virtual bool lookup(std::string const &path, resume_member &member);
+
+    /**
+     * Returns a reader positioned at the data of the specified
+     * member. Members of an archive are best read in the order
+     * they are stored, unless the archive is indexed. Throws a
+     * CArchiveIssue if the member can't be read anymore.
+     */
+    virtual std::shared_ptr<TarArchiveReader> open(resume_member &member);
+
+    /**
+     * Records a materialized file, the received manifest lists
+     * it by the former path.
+     */
+    virtual void replace(std::string const &former, resume_replacement &replacement);
+
+    /**
+     * Rewrites the manifest received from the server. Materialized
+     * files are listed with their new path, size and checksum, the
+     * manifest checksum is computed again.
+     */
+    virtual std::string rewriteManifest(std::string const &content);
+
+    /**
+     * Removes the lines describing an incremental basebackup
+     * from a backup_label.
+     */
+    static std::string backupLabel(std::string const &content);
+
+  };
+
+  /**
+   * State of a ResumingFile.
+   */
+  typedef enum {
+
+    RESUME_MEMBER_HEADER,
+    RESUME_MEMBER_COPY,
+    RESUME_MEMBER_INCREMENTAL,
+    RESUME_MEMBER_LABEL,
+    RESUME_MEMBER_PADDING,
+    RESUME_MEMBER_END
+
+  } ResumeMemberState;
+
+  /**
+   * Writes a tar stream of a resumed basebackup into a BackupFile.
+   *
+   * Incremental files are replaced by the full file, its blocks
+   * not sent by the server are read from the aborted basebackups.
+   * The backup_label loses its incremental lines. Everything else is
+   * handed to the underlying file unchanged. Write only, read() and
+   * lseek() throw.
+   */
+  class ResumingFile : public BackupFile {
+  private:
+
+    std::shared_ptr<BackupFile> file = nullptr;
+    std::shared_ptr<BaseBackupResume> resume = nullptr;
+    TarStreamIndexer indexer;
+
+    /* checksum of the tar stream written to the file */
+    std::shared_ptr<BackupChecksum> stream_checksum = nullptr;
+
+    std::string archive_name = "";
+
+    ResumeMemberState state = RESUME_MEMBER_HEADER;
+
+    /* headers of the current member not written yet */
+    std::string headers = "";
+    size_t member = 0;
+    unsigned long long data_end = 0;
+    std::string member_path = "";
+
+    /* incremental file being materialized */
+    std::string incremental = "";
+    bool incremental_parsed = false;
+    uint32_t truncation = 0;
+    std::vector<uint32_t> blocks;
+    size_t block_index = 0;
+    uint32_t next_block = 0;
+    unsigned long long materialized_size = 0;
+    std::shared_ptr<BackupChecksum> file_checksum = nullptr;
+    std::shared_ptr<TarArchiveReader> prior = nullptr;
+    resume_member prior_member;
+    uint32_t prior_block = 0;
+
+    /* backup_label being collected */
+    std::string label = "";
+
+    void emit(const char *buf, size_t len);
+    void emitHeader(std::string const &name, unsigned long long size);
+    void emitPadding(unsigned long long size);
+
+    void startMember();
+    void incrementalData(const char *buf, size_t len);
+    void parseIncremental(unsigned long long member_size);
+    void materializeUpTo(uint32_t block);
+    void finishIncremental();
+    void finishLabel();
+
+  public:
+
+    ResumingFile(std::shared_ptr<BackupFile> file,
+                 std::shared_ptr<BaseBackupResume> resume,
+                 std::string archive_name);
+    virtual ~ResumingFile();
+
+    /**
+     * Returns the checksum of the tar stream written so far,
+     * using STREAM_CHECKSUM_ALGORITHM. It differs from the one of
+     * the received stream if files were materialized.
+     */
+    virtual std::string checksum();
+
+    virtual bool isCompressed();
+    virtual void setCompressed(bool compressed);
+
+    virtual void open();
+    virtual void close();
+    virtual void fsync();
+    virtual bool isOpen();
+    virtual void rename(path& newname);
+    virtual void setOpenMode(std::string mode);
+    virtual std::string getOpenMode();
+    virtual size_t write(const char *buf, size_t len);
+    virtual size_t read(char *buf, size_t len);
+    virtual void remove();
+    virtual size_t size();
+    virtual off_t lseek(off_t offset, int whence);
+    virtual off_t current_position();
+    virtual off_t frameBoundary();
+
+  };
+
+  /**
+   * Collects the manifest of a resumed basebackup and writes it
+   * rewritten by BaseBackupResume::rewriteManifest() when closed,
+   * all archives are complete then.
+   */
+  class ResumedManifestFile : public BackupFile {
+  private:
+
+    std::shared_ptr<BackupFile> file = nullptr;
+    std::shared_ptr<BaseBackupResume> resume = nullptr;
+
+    std::string content = "";
+    bool written = false;
+
+    void writeManifest();
+
+  public:
+
+    ResumedManifestFile(std::shared_ptr<BackupFile> file,
+                        std::shared_ptr<BaseBackupResume> resume);
+    virtual ~ResumedManifestFile();
+
+    virtual bool isCompressed();
+    virtual void setCompressed(bool compressed);
+
+    virtual void open();
+    virtual void close();
+    virtual void fsync();
+    virtual bool isOpen();
+    virtual void rename(path& newname);
+    virtual void setOpenMode(std::string mode);
+    virtual std::string getOpenMode();
+    virtual size_t write(const char *buf, size_t len);
+    virtual size_t read(char *buf, size_t len);
+    virtual void remove();
+    virtual size_t size();
+    virtual off_t lseek(off_t offset, int whence);
+
+  };
+
+}
+
+#endif
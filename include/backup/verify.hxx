@@ -0,0 +1,145 @@
+#ifndef __HAVE_VERIFY_HXX__
+#define __HAVE_VERIFY_HXX__
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <checksum.hxx>
+#include <descr.hxx>
+#include <fs-archive.hxx>
+#include <fs-tar.hxx>
+#include <verifydescr.hxx>
+
+namespace pgbckctl {
+
+  /**
+   * Verifies a basebackup against its backup manifest.
+   *
+   * All tar archives of the basebackup are read and every member
+   * is checked for its size and checksum as listed in the manifest.
+   * Uncompressed archives are indexed first and their members are
+   * then checked by all threads concurrently, compressed archives
+   * can only be read sequentially and are spread over the threads
+   * as a whole, or by compressed frames if they have a member index.
+   * Basebackups streamed into a plain directory are checked file by
+   * file.
+   *
+   * Additionally, the WAL range required to restore the basebackup
+   * must be present in the log/ directory of the archive or in the
+   * basebackup itself.
+   */
+  class BaseBackupVerifier {
+  private:
+
+    /**
+     * A file listed in the manifest.
+     */
+    typedef struct {
+
+      unsigned long long size = 0;
+      std::string algorithm = "NONE";
+      std::string checksum = "";
+      bool found = false;
+
+    } manifest_file;
+
+    /**
+     * A piece of work of a verification thread, gets a
+     * read buffer of VERIFY_BUFFER_SIZE bytes.
+     */
+    typedef std::function<void(char *buf)> verify_unit;
+
+    std::shared_ptr<BaseBackupDescr> bbdescr = nullptr;
+    path logdir;
+    unsigned int parallel = 1;
+
+    /**
+     * WAL range required by the basebackup.
+     */
+    typedef struct {
+
+      unsigned int timeline = 0;
+      std::string start = "";
+      std::string end = "";
+
+    } wal_range;
+
+    std::map<std::string, manifest_file> manifest;
+    bool manifest_loaded = false;
+
+    std::vector<wal_range> wal_ranges;
+    std::set<std::string> wal_in_backup;
+
+    std::shared_ptr<BaseBackupVerifyResult> result = nullptr;
+    std::mutex mtx;
+    std::atomic<unsigned long long> bytes;
+
+    void readManifest(std::string content);
+    void verifyManifestChecksum(std::string &content, std::string expected);
+
+    /**
+     * Returns the data directory prefix of members
+     * of the specified archive.
+     */
+    std::string archivePrefix(std::string archive_name);
+
+    /**
+     * Checks a file read from the backup against the manifest and
+     * records the result. Thread safe.
+     */
+    void record(std::string path,
+                std::string archive,
+                unsigned long long size,
+                std::shared_ptr<BackupChecksum> checksum);
+
+    /**
+     * Work units for the different kinds of
+     * basebackup contents.
+     */
+    void addTarArchive(path archive, std::vector<verify_unit> &units);
+
+    /**
+     * Reads count members (0 means all) of an archive sequentially
+     * from the specified source and records them.
+     */
+    void readMembers(path archive,
+                     std::string prefix,
+                     std::shared_ptr<TarStreamSource> source,
+                     size_t count,
+                     char *buf);
+    void addPlainFiles(path directory, std::vector<verify_unit> &units);
+
+    void verifyWAL(unsigned int timeline,
+                   std::string start,
+                   std::string end);
+
+  public:
+
+    /**
+     * Prepares the verification of the specified basebackup with
+     * parallel threads, 0 means one thread per CPU. logdir is the
+     * log/ directory of the archive.
+     */
+    BaseBackupVerifier(std::shared_ptr<BaseBackupDescr> bbdescr,
+                       path logdir,
+                       unsigned int parallel = 0);
+    virtual ~BaseBackupVerifier();
+
+    /**
+     * Verifies the basebackup. Problems found are recorded
+     * in the result, a CArchiveIssue is thrown only if the
+     * basebackup can't be verified at all.
+     */
+    virtual std::shared_ptr<BaseBackupVerifyResult> verify();
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef __HAVE_VERIFYDESCR_HXX__
+#define __HAVE_VERIFYDESCR_HXX__
+
+#include <string>
+#include <vector>
+
+namespace pgbckctl {
+
+  /**
+   * Result of the verification of a single file
+   * of a basebackup.
+   */
+  typedef enum {
+
+    VERIFY_FILE_OK = 0,
+
+    /* size matches, but there is no checksum we can verify */
+    VERIFY_FILE_NO_CHECKSUM,
+
+    VERIFY_FILE_MISSING,
+    VERIFY_FILE_SIZE_MISMATCH,
+    VERIFY_FILE_CHECKSUM_MISMATCH,
+    VERIFY_FILE_NOT_IN_MANIFEST
+
+  } VerifyFileStatus;
+
+  /**
+   * Verification result of a file listed in the
+   * backup manifest or found in the basebackup.
+   */
+  typedef struct {
+
+    /* path relative to the data directory, as in the manifest */
+    std::string path = "";
+
+    /* archive file the file was read from, empty if plain */
+    std::string archive = "";
+
+    unsigned long long size = 0;
+
+    std::string algorithm = "NONE";
+    std::string expected = "";
+    std::string computed = "";
+
+    VerifyFileStatus status = VERIFY_FILE_OK;
+
+  } verify_file_result;
+
+  /**
+   * Result of VERIFY BASEBACKUP.
+   */
+  class BaseBackupVerifyResult {
+  public:
+
+    int basebackup_id = -1;
+    std::string archive_name = "";
+    std::string fsentry = "";
+
+    /**
+     * Backup manifest status, "missing", "verified", "checksum
+     * mismatch" or "not verified" if the manifest checksum
+     * can't be computed.
+     */
+    std::string manifest_status = "missing";
+
+    /**
+     * CRC32C implementation used, if any.
+     */
+    std::string checksum_implementation = "";
+
+    unsigned int parallel = 1;
+
+    std::vector<verify_file_result> files;
+
+    /**
+     * Errors not related to a specific file, e.g.
+     * corrupted archives.
+     */
+    std::vector<std::string> errors;
+
+    /**
+     * Required WAL range and WAL segments of this range
+     * neither found in the archive nor in the basebackup.
+     */
+    unsigned int timeline = 0;
+    std::string wal_start = "";
+    std::string wal_end = "";
+    unsigned int wal_segments = 0;
+    std::vector<std::string> wal_missing;
+
+    /* bytes read, uncompressed */
+    unsigned long long bytes = 0;
+    long long elapsed_msec = 0;
+
+    /**
+     * Number of problems found.
+     */
+    unsigned int failures() {
+
+      unsigned int result = this->errors.size() + this->wal_missing.size();
+
+      for (auto &file : this->files) {
+        if (file.status != VERIFY_FILE_OK && file.status != VERIFY_FILE_NO_CHECKSUM)
+          result++;
+      }
+
+      if (this->manifest_status == "checksum mismatch")
+        result++;
+
+      return result;
+
+    }
+
+    /**
+     * Throughput in MB/s.
+     */
+    double throughput() {
+
+      if (this->elapsed_msec <= 0)
+        return 0.0;
+
+      return ((double) this->bytes / (1024.0 * 1024.0)) / ((double) this->elapsed_msec / 1000.0);
+
+    }
+
+    static std::string statusToString(VerifyFileStatus status) {
+
+      switch(status) {
+      case VERIFY_FILE_OK:
+        return "OK";
+      case VERIFY_FILE_NO_CHECKSUM:
+        return "NO CHECKSUM";
+      case VERIFY_FILE_MISSING:
+        return "MISSING";
+      case VERIFY_FILE_SIZE_MISMATCH:
+        return "SIZE MISMATCH";
+      case VERIFY_FILE_CHECKSUM_MISMATCH:
+        return "CHECKSUM MISMATCH";
+      case VERIFY_FILE_NOT_IN_MANIFEST:
+        return "NOT IN MANIFEST";
+      default:
+        return "UNKNOWN";
+      }
+
+    }
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef __HAVE_WRITEPIPELINE_HXX__
+#define __HAVE_WRITEPIPELINE_HXX__
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace pgbckctl {
+
+  class BackupFile;
+  class IOGovernor;
+
+  /**
+   * Decouples receiving a basebackup stream from writing it.
+   *
+   * The receiving thread copies the stream into a bounded pool of
+   * large buffers, a writer thread drains them into their backup
+   * files (and thus into a compressor, if any). A disk or compression
+   * stall then only blocks the receiver after all buffers are filled,
+   * instead of backing up into the connection for every chunk.
+   *
+   * Every buffer carries the file it belongs to, so switching to the
+   * next file doesn't need to wait for the writer. Anything else done
+   * with a file written through the pipeline, e.g. fsync() or close(),
+   * requires a flush() before.
+   *
+   * Errors of the writer thread are rethrown by the next write()
+   * or flush() call of the receiver.
+   */
+  class BackupWritePipeline {
+  private:
+
+    /**
+     * A buffer of the pool, either free, filled by
+     * the receiver or queued for the writer.
+     */
+    typedef struct {
+
+      std::shared_ptr<BackupFile> file = nullptr;
+      size_t len = 0;
+      std::unique_ptr<char[]> data;
+
+    } write_buffer;
+
+    size_t buffer_size = 0;
+
+    /**
+     * All buffers of the pool, allocated once.
+     */
+    std::vector<std::unique_ptr<write_buffer>> pool;
+
+    /**
+     * Buffers ready to be filled and buffers
+     * queued for the writer, protected by mtx.
+     */
+    std::queue<write_buffer *> free_buffers;
+    std::queue<write_buffer *> filled_buffers;
+
+    /**
+     * Buffer currently filled by the receiver, only
+     * ever touched by the receiver.
+     */
+    write_buffer *current = nullptr;
+
+    /* true while the writer writes a buffer */
+    bool writing = false;
+
+    bool shutdown = false;
+
+    /* first error of the writer */
+    std::exception_ptr error = nullptr;
+
+    std::shared_ptr<IOGovernor> governor = nullptr;
+
+    std::mutex mtx;
+    std::condition_variable buffer_freed;
+    std::condition_variable buffer_filled;
+
+    /*
+     * Statistics, readable without the lock.
+     */
+    std::atomic<unsigned int> queue_depth;
+    std::atomic<long long> receiver_stall_nsec;
+    std::atomic<long long> writer_idle_nsec;
+
+    std::thread writer;
+
+    /**
+     * Main loop of the writer thread.
+     */
+    void drain();
+
+    /**
+     * Takes a free buffer for the receiver, waiting for
+     * the writer to free one if necessary.
+     */
+    void acquire(std::shared_ptr<BackupFile> file);
+
+    /**
+     * Queues the current buffer for the writer.
+     */
+    void submit();
+
+    /**
+     * Rethrows the error of the writer, if any.
+     * mtx must be held.
+     */
+    void rethrow();
+
+  public:
+
+    /**
+     * Allocates the buffer pool and starts the writer thread.
+     * Throws a StreamingFailure in case buffers is 0.
+     */
+    BackupWritePipeline(unsigned int buffers, size_t buffer_size);
+
+    /**
+     * Stops the writer thread. Buffers not yet written
+     * are discarded.
+     */
+    virtual ~BackupWritePipeline();
+
+    /**
+     * Assigns an I/O governor handle. If set, the writer waits
+     * for the governor before it writes a buffer.
+     */
+    virtual void setIOGovernor(std::shared_ptr<IOGovernor> governor);
+
+    /**
+     * Copies the specified data into the pipeline, to be
+     * written to file. Blocks only if all buffers are in use.
+     */
+    virtual void write(std::shared_ptr<BackupFile> file,
+                       const char *data,
+                       size_t len);
+
+    /**
+     * Waits until everything passed to write() before
+     * is written.
+     */
+    virtual void flush();
+
+    /**
+     * Number of buffers waiting for the writer.
+     */
+    virtual unsigned int depth();
+
+    /**
+     * Total time the receiver waited for the writer, in
+     * milliseconds. Grows if writing is the bottleneck.
+     */
+    virtual long long receiverStallMsec();
+
+    /**
+     * Total time the writer waited for data, in milliseconds.
+     * Grows if receiving is the bottleneck.
+     */
+    virtual long long writerIdleMsec();
+
+  };
+
+}
+
+#endif
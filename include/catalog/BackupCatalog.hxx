@@ -3,11 +3,14 @@
 
 #include <sqlite3.h>
 #include <list>
+#include <map>
 
 #include <common.hxx>
 #include <catalog.hxx>
 #include <descr.hxx>
 #include <stream.hxx>
+#include <backupcleanupdescr.hxx>
+#include <scheduledescr.hxx>
 
 namespace pgbckctl {
 
@@ -63,6 +66,16 @@ namespace pgbckctl {
      */
     virtual void setPragma();
 
+    /**
+     * Updates the materialized statistics of an archive. assignments
+     * is the SET list of the UPDATE command, filter its WHERE condition
+     * selecting the archive_stat row. values are bound to the
+     * placeholders ?1, ?2, ... in order.
+     */
+    virtual void updateArchiveStat(std::string assignments,
+                                   std::string filter,
+                                   std::vector<sqlite3_int64> values);
+
   protected:
     std::string sqliteDB;
     std::string archiveDir;
@@ -469,6 +482,13 @@ namespace pgbckctl {
                                                            std::shared_ptr<RetentionRuleDescr> retentionRule,
                                                            Range colIdRange);
 
+    /**
+     * Reads a schedule from the current row of the result set
+     * identified by stmt. The columns are expected in the order
+     * getSchedules() selects them.
+     */
+    std::shared_ptr<ScheduleDescr> fetchSchedule(sqlite3_stmt *stmt);
+
     /**
      * Returns a retention policy descriptor with
      * all rule(s) attached.
@@ -509,6 +529,62 @@ namespace pgbckctl {
      */
     virtual void createRetentionPolicy(std::shared_ptr<RetentionDescr> retentionPolicy);
 
+    /**
+     * Persists the specified retention plan, including its
+     * pending basebackups and WAL cleanup offsets. Throws if the
+     * archive already has a retention plan.
+     */
+    virtual void createRetentionPlan(std::shared_ptr<RetentionPlanDescr> plan);
+
+    /**
+     * Returns the retention plan of the specified archive. If no
+     * plan exists, the returned descriptor has an archive_id of -1.
+     */
+    virtual std::shared_ptr<RetentionPlanDescr> getRetentionPlan(int archive_id);
+
+    /**
+     * Removes the specified basebackup from the pending entries
+     * of the retention plan of the given archive.
+     */
+    virtual void finishRetentionPlanBackup(int archive_id, int basebackup_id);
+
+    /**
+     * Drops the retention plan of the specified archive.
+     */
+    virtual void dropRetentionPlan(int archive_id);
+
+    /**
+     * Stores a new schedule. The id of the specified
+     * descriptor is set to the new catalog ID afterwards.
+     */
+    virtual void createSchedule(std::shared_ptr<ScheduleDescr> schedule);
+
+    /**
+     * Returns the schedule with the given name of the specified
+     * archive. If no such schedule exists, the returned descriptor
+     * has an id of -1.
+     */
+    virtual std::shared_ptr<ScheduleDescr> getSchedule(int archive_id,
+                                                       std::string name);
+
+    /**
+     * Returns all schedules of the specified archive, ordered
+     * by archive and schedule name. An archive_id of -1 returns
+     * the schedules of all archives.
+     */
+    virtual std::vector<std::shared_ptr<ScheduleDescr>> getSchedules(int archive_id);
+
+    /**
+     * Drops the schedule with the specified ID.
+     */
+    virtual void dropSchedule(int schedule_id);
+
+    /**
+     * Records the time the scheduler started the job
+     * of the specified schedule.
+     */
+    virtual void setScheduleLastRun(int schedule_id, std::string last_run);
+
     /**
      * Creates or removes a pin on the specified basebackup ID(s).
      *
@@ -542,6 +618,17 @@ namespace pgbckctl {
                                    std::shared_ptr<BackupTablespaceDescr> tablespace,
                                    Range range);
 
+    /**
+     * Fetches the tablespace columns of the current result row
+     * into the specified plain tablespace entry. attrs holds the
+     * column identifiers to retrieve, starting at the first
+     * column in colIdRange.
+     */
+    void fetchBackupTablespaceIntoEntry(sqlite3_stmt *stmt,
+                                        BackupTablespaceEntry &entry,
+                                        std::vector<int> &attrs,
+                                        Range colIdRange);
+
     /*
      * Fetch catalog process information from
      * statement handle.
@@ -600,6 +687,13 @@ namespace pgbckctl {
      */
     virtual void deleteBaseBackup(int basebackupId);
 
+    /**
+     * Returns the number of incremental basebackups, which
+     * refer to the specified basebackup as their parent and
+     * weren't aborted.
+     */
+    virtual int getIncrementalChildCount(int basebackupId);
+
     /*
      * Abort a registered basebackup. Marks the specified basebackup as failed.
      */
@@ -629,6 +723,16 @@ namespace pgbckctl {
      */
     virtual void registerTablespaceForBackup(std::shared_ptr<BackupTablespaceDescr> tblspcDescr);
 
+    /**
+     * Registers all tablespace descriptors in the specified list
+     * in the backup catalog. Rows are inserted with multi-row
+     * INSERT statements, so this is much cheaper than calling
+     * registerTablespaceForBackup() for each tablespace.
+     *
+     * Backup ID must be set in all descriptors.
+     */
+    virtual void registerTablespacesForBackup(std::vector<std::shared_ptr<BackupTablespaceDescr>> list);
+
     /**
      * Retrieve a complete list of backups stored in
      * the current catalog.
@@ -706,9 +810,66 @@ namespace pgbckctl {
 
     /**
      * Returns a catalog status view for the given archive.
+     *
+     * The numbers are read from the materialized archive_stat
+     * catalog table, which is maintained by registerBasebackup(),
+     * finalizeBasebackup(), abortBasebackup(), deleteBaseBackup(),
+     * registerTablespaceForBackup() and updateArchiveWALStat().
      */
     virtual std::shared_ptr<StatCatalogArchive> statCatalog(std::string archive_name);
 
+    /**
+     * Adds the specified number of WAL segments and bytes to the
+     * statistics of the given archive. Negative values account
+     * WAL segments removed from the archive.
+     */
+    virtual void updateArchiveWALStat(int archive_id,
+                                      long long segments,
+                                      long long bytes);
+
+    /**
+     * Registers a WAL segment completed by WAL streaming
+     * with its checksum. archive_id must be set.
+     */
+    virtual void registerWALSegment(std::shared_ptr<WALSegmentDescr> segment);
+
+    /**
+     * Returns the catalog entry of the specified WAL segment
+     * file name of an archive. If the segment isn't known,
+     * the returned descriptor has an empty name.
+     */
+    virtual std::shared_ptr<WALSegmentDescr> getWALSegment(int archive_id,
+                                                           std::string name);
+
+    /**
+     * Removes the entries of the specified WAL segment
+     * file names, e.g. after cleaning up the archive.
+     */
+    virtual void unregisterWALSegments(int archive_id,
+                                       std::vector<std::string> names);
+
+    /**
+     * Adds a reference to each of the specified chunks (hash and
+     * size) of the chunk store of an archive, chunks not known so far
+     * are registered. Called once per deduplicated basebackup.
+     */
+    virtual void referenceChunks(int archive_id,
+                                 std::map<std::string, unsigned long long> chunks);
+
+    /**
+     * Drops a reference from each of the specified chunks, e.g.
+     * when a deduplicated basebackup is deleted.
+     */
+    virtual void unreferenceChunks(int archive_id,
+                                   std::vector<std::string> hashes);
+
+    /**
+     * Removes the entries of all chunks of an archive no longer
+     * referenced by any basebackup and returns their hashes. The
+     * caller must remove the chunk files before committing.
+     */
+    virtual std::vector<std::string> purgeChunks(int archive_id);
+
     /**
      * Returns the compiled in catalog magic number. Should
      * match at least the version returned from the catalog database
@@ -1,6 +1,7 @@
 #ifndef __HAVE_BACKUPLOCKINFO_HXX__
 #define __HAVE_BACKUPLOCKINFO_HXX__
 
+#include <set>
 #include <catalog.hxx>
 #include <shm.hxx>
 
@@ -23,6 +24,7 @@ namespace pgbckctl {
                 LOCKED_BY_SHM,
                 LOCKED_BY_PIN,
                 LOCKED_BY_INVALID_STATE,
+                LOCKED_BY_INCREMENTAL,
                 NOT_LOCKED
 
   } BackupLockInfoType;
@@ -63,6 +65,35 @@ namespace pgbckctl {
 
   };
 
+  /**
+   * BackupIncrementalLockInfo
+   *
+   * Checks whether a basebackup is the parent of an incremental
+   * basebackup. Such a basebackup is required to restore the
+   * incremental basebackup and thus locked as long as any of its
+   * incremental basebackups, which weren't aborted, exists.
+   */
+  class BackupIncrementalLockInfo : public BackupLockInfo {
+  private:
+
+    /**
+     * IDs of all basebackups referenced as a parent.
+     */
+    std::set<int> parents;
+
+  public:
+
+    /**
+     * Initialize the lock info from the list of basebackups
+     * of an archive.
+     */
+    BackupIncrementalLockInfo(std::vector<std::shared_ptr<BaseBackupDescr>> &list);
+    virtual ~BackupIncrementalLockInfo();
+
+    virtual BackupLockInfoType locked(std::shared_ptr<BaseBackupDescr> backup);
+
+  };
+
   /**
    * SHMBackupLockInfo
    *
@@ -1,7 +1,7 @@
 #ifndef __CATALOG__
 #define __CATALOG__
 
-#define CATALOG_MAGIC 108
+#define CATALOG_MAGIC 116
 
 /*
  * Archive catalog entity
@@ -56,6 +56,9 @@
 #define SQL_BACKUP_WAL_SEGMENT_SIZE_ATTNO 12
 #define SQL_BACKUP_USED_PROFILE_ATTNO 13
 #define SQL_BACKUP_PG_VERSION_NUM_ATTNO 14
+#define SQL_BACKUP_PARENT_ID_ATTNO 15
+#define SQL_BACKUP_BAD_PAGES_ATTNO 16
+#define SQL_BACKUP_BAD_PAGES_DETAIL_ATTNO 17
 
 /*
  * Computed columns with no corresponding
@@ -64,13 +67,13 @@
  * a BaseBackupDescr. They must not be counted
  * below in SQL_BACKUP_NCOLS!
  */
-#define SQL_BACKUP_COMPUTED_DURATION 15
-#define SQL_BACKUP_COMPUTED_RETENTION_DATETIME 16
+#define SQL_BACKUP_COMPUTED_DURATION 18
+#define SQL_BACKUP_COMPUTED_RETENTION_DATETIME 19
 
 /*
  * Keep that in sync with above number of cols
  */
-#define SQL_BACKUP_NCOLS 15
+#define SQL_BACKUP_NCOLS 18
 
 /*
  * Attributes belong to stream tablex
@@ -109,11 +112,16 @@
 #define SQL_BCK_PROF_NOVERIFY_CHECKSUMS_ATTNO 8
 #define SQL_BCK_PROF_MANIFEST_ATTNO 9
 #define SQL_BCK_PROF_MANIFEST_CHECKSUMS_ATTNO 10
+#define SQL_BCK_PROF_COMPRESS_ON_SERVER_ATTNO 11
+#define SQL_BCK_PROF_COMPRESS_LEVEL_ATTNO 12
+#define SQL_BCK_PROF_COMPRESS_WORKERS_ATTNO 13
+#define SQL_BCK_PROF_DEDUPLICATE_ATTNO 14
+#define SQL_BCK_PROF_VERIFY_PAGES_ATTNO 15
 
 /*
  * Keep number of columns in sync with above definitions
  */
-#define SQL_BACKUP_PROFILES_NCOLS 11
+#define SQL_BACKUP_PROFILES_NCOLS 16
 
 /*
  * Attributes belonging to backup_tablespaces catalog table.
@@ -124,11 +132,13 @@
 #define SQL_BCK_TBLSPC_SPCOID_ATTNO 1
 #define SQL_BCK_TBLSPC_SPCLOC_ATTNO 2
 #define SQL_BCK_TBLSPC_SPCSZ_ATTNO 3
+#define SQL_BCK_TBLSPC_CSUM_ALG_ATTNO 4
+#define SQL_BCK_TBLSPC_CSUM_ATTNO 5
 
 /*
  * Keep number of columns in sync with above definitions
  */
-#define SQL_BCK_TBLSPC_NCOLS 4
+#define SQL_BCK_TBLSPC_NCOLS 6
 
 /*
  * Attributes belonging to procs catalog table.
@@ -9,6 +9,8 @@
 
 /* special descriptors */
 #include <recoverydescr.hxx>
+#include <metricsdescr.hxx>
+#include <scheduledescr.hxx>
 
 namespace pgbckctl {
 
@@ -72,7 +74,13 @@ namespace pgbckctl {
     RESET_VARIABLE,
     DROP_BASEBACKUP,
     RESTORE_BACKUP,
-    STAT_ARCHIVE_BASEBACKUP
+    STAT_ARCHIVE_BASEBACKUP,
+    START_METRICS_SERVER,
+    CREATE_SCHEDULE,
+    DROP_SCHEDULE,
+    LIST_SCHEDULES,
+    SHOW_EVENTS,
+    VERIFY_BASEBACKUP
   } CatalogTag;
 
   /**
@@ -579,6 +587,18 @@ namespace pgbckctl {
      */
     std::shared_ptr<RecoveryStreamDescr> recoveryStream = nullptr;
 
+    /**
+     * A pointer to a MetricsServerDescr descriptor instantiated
+     * during parsing a START METRICS SERVER command.
+     */
+    std::shared_ptr<MetricsServerDescr> metricsServer = nullptr;
+
+    /**
+     * A pointer to a ScheduleDescr instantiated during
+     * parsing a CREATE or DROP SCHEDULE command.
+     */
+    std::shared_ptr<ScheduleDescr> schedule = nullptr;
+
     /**
      * A pointer to a RestoreDescr instantiated during
      * parsing a RESTORE command.
@@ -612,6 +632,17 @@ namespace pgbckctl {
     int basebackup_id = -1;
     bool verbose_output = false;
 
+    /**
+     * Worker PID to filter SHOW EVENTS, -1 means all workers.
+     */
+    int worker_pid = -1;
+
+    /**
+     * Number of threads for VERIFY BASEBACKUP, 0 means
+     * one per CPU.
+     */
+    unsigned int parallel = 0;
+
     /**
      * Used to parse retention policy commands.
      */
@@ -622,6 +653,22 @@ namespace pgbckctl {
      */
     bool force_systemid_update = false;
 
+    /**
+     * Option flag, START BASEBACKUP ... INCREMENTAL
+     */
+    bool incremental = false;
+
+    /**
+     * Option flag, START BASEBACKUP ... RESUME
+     */
+    bool resume = false;
+
+    /**
+     * Option flag, APPLY RETENTION POLICY ... DRY RUN only
+     * reports what would be removed.
+     */
+    bool dry_run = false;
+
     /**
      * A PinDescr instance is initialized by the parser when
      * handling a PIN command. By default, a caller can only
@@ -681,10 +728,27 @@ namespace pgbckctl {
      */
     void setBasebackupID(std::string const& bbid);
 
+    /**
+     * Set the worker PID during parse analysis.
+     */
+    void setWorkerPID(std::string const& pid);
+
+    /**
+     * Set the number of threads during parse analysis.
+     */
+    void setParallel(std::string const& parallel);
+
     /**
      * Set the FORCE_SYSTEMID_OPTION option.
      */
     void setForceSystemIDUpdate(bool const& force_sysid_update);
+    void setIncremental(bool const& incremental);
+    void setResume(bool const& resume);
+
+    /**
+     * Set the DRY RUN option.
+     */
+    void setDryRun(bool const& dry_run);
 
     /*
      * Returns command tag as string.
@@ -720,6 +784,61 @@ namespace pgbckctl {
      */
     void setRecoveryStreamPort(std::string const& portnumber);
 
+    /**
+     * makeMetricsServerDescr
+     *
+     * Instantiate and setup an internal metrics server descriptor.
+     * Used within parsing the START METRICS SERVER command.
+     */
+    void makeMetricsServerDescr();
+
+    /**
+     * Returns the internal instance of a metrics server
+     * descriptor, if any. Could be a nullptr in case makeMetricsServerDescr()
+     * wasn't called before.
+     */
+    std::shared_ptr<MetricsServerDescr> getMetricsServerDescr();
+
+    /**
+     * Attach the portnumber to the internal metrics server
+     * descriptor.
+     *
+     * NOTE: Will throw in case no metrics server descriptor
+     *       was initialized yet (see makeMetricsServerDescr()).
+     */
+    void setMetricsServerPort(std::string const& portnumber);
+
+    /**
+     * Stores the specified hostname or ip in the metrics
+     * server descriptor. If makeMetricsServerDescr() wasn't
+     * called before, this will throw.
+     */
+    void setMetricsServerAddr(std::string const& address);
+
+    /**
+     * makeScheduleDescr
+     *
+     * Instantiate an internal schedule descriptor. Used
+     * within parsing the CREATE and DROP SCHEDULE commands.
+     */
+    void makeScheduleDescr();
+
+    /**
+     * Returns the internal schedule descriptor, nullptr
+     * if makeScheduleDescr() wasn't called before.
+     */
+    std::shared_ptr<ScheduleDescr> getScheduleDescr();
+
+    /**
+     * Setters for the properties of the internal schedule
+     * descriptor. They throw in case no schedule descriptor
+     * was initialized yet (see makeScheduleDescr()).
+     */
+    void setScheduleName(std::string const& name);
+    void setScheduleCron(std::string const& cron);
+    void setScheduleAction(ScheduleAction const& action);
+    void setScheduleParam(std::string const& param);
+
     /**
      * Returns a shared pointer to the internal
      * recovery descriptor.
@@ -947,6 +1066,16 @@ namespace pgbckctl {
 
     void setProfileWaitForWAL(bool const& wait);
 
+    void setProfileCompressOnServer(bool const& on_server);
+
+    void setProfileCompressLevel(std::string const& level);
+
+    void setProfileCompressWorkers(std::string const& workers);
+
+    void setProfileDeduplicate(bool const& deduplicate);
+
+    void setProfileVerifyPages(bool const& verify_pages);
+
     void setProfileAffectedAttribute(int const& colId);
 
     void setDSN(std::string const& dsn);
@@ -984,9 +1113,51 @@ namespace pgbckctl {
     bool manifest           = false;
     std::string manifest_checksums = "CRC32C";
 
+    /**
+     * Server-side compression (PostgreSQL 15 and above). The server
+     * sends the archives already compressed with compress_type, 0
+     * for compress_level and compress_workers (zstd only) means the
+     * server defaults.
+     */
+    bool compress_on_server = false;
+    int compress_level = 0;
+    int compress_workers = 0;
+
+    /**
+     * Store the tar archives of basebackups in the chunk store
+     * of the archive, chunks already stored by former basebackups
+     * are referenced instead of written again.
+     */
+    bool deduplicate = false;
+
+    /**
+     * Verify the checksums of data pages while the basebackup
+     * is streamed, bad pages are recorded with the basebackup.
+     */
+    bool verify_pages = false;
+
     static BackupProfileCompressType compressionType(std::string type) noexcept(false);
     static std::string compressionType(BackupProfileCompressType type) noexcept(false);
 
+    /**
+     * Returns the compression method as requested from the
+     * server with the BASE_BACKUP COMPRESSION option, e.g. "zstd".
+     * Throws for compression types not supported by the server.
+     */
+    static std::string serverCompressionMethod(BackupProfileCompressType type) noexcept(false);
+
+    /**
+     * Returns the file name suffix of archives compressed
+     * by the server with the specified compression type.
+     */
+    static std::string serverCompressionSuffix(BackupProfileCompressType type) noexcept(false);
+
+    /**
+     * Returns a string describing the compression
+     * of this profile, e.g. "ZSTD (server, level 5, 4 workers)".
+     */
+    virtual std::string compressionString();
+
   };
 
   /**
@@ -1038,6 +1209,13 @@ namespace pgbckctl {
     std::string spclocation;
     unsigned long long spcsize;
 
+    /*
+     * Checksum of the archive stream of this tablespace, computed
+     * while it was written. Empty if not known.
+     */
+    std::string checksum_algorithm = "";
+    std::string checksum = "";
+
     virtual BackupElemType getType() { return BASEBACKUP_ELEM_TBLSPC ;}
   };
 
@@ -1055,6 +1233,42 @@ namespace pgbckctl {
     virtual BackupElemType getType() { return BASEBACKUP_ELEM_MANIFEST; }
   };
 
+  /**
+   * Plain tablespace entry of a basebackup, as stored in the
+   * backup_tablespaces catalog table.
+   *
+   * BaseBackupDescr keeps its tablespaces as a contiguous list of
+   * these, filled by the joined basebackup catalog fetches. Callers
+   * requiring a full BackupTablespaceDescr handle should use
+   * BackupCatalog::getBackupTablespaces().
+   */
+  struct BackupTablespaceEntry {
+    int backup_id = -1;
+    unsigned int spcoid = 0;
+    std::string spclocation;
+    unsigned long long spcsize = 0;
+    std::string checksum_algorithm = "";
+    std::string checksum = "";
+  };
+
+  /**
+   * A completed WAL segment streamed into an archive, as
+   * stored in the wal_segments catalog table.
+   *
+   * The checksum covers the uncompressed contents of the
+   * segment and is computed while it is written.
+   */
+  class WALSegmentDescr {
+  public:
+    int archive_id = -1;
+    std::string name = "";
+    unsigned int timeline = 0;
+    unsigned long long size = 0;
+    std::string checksum_algorithm = "";
+    std::string checksum = "";
+    std::string created = "";
+  };
+
   /**
    * BaseBackupDescr represents a
    * catalog entry for either a running
@@ -1079,6 +1293,20 @@ namespace pgbckctl {
     int used_profile = -1;
     int pg_version_num;
 
+    /**
+     * ID of the basebackup an incremental basebackup
+     * depends on, -1 for full basebackups.
+     */
+    int parent_id = -1;
+
+    /**
+     * Number of pages with a bad checksum found while streaming
+     * (see VERIFY_PAGES) and their locations, at most
+     * PAGE_CHECKSUM_MAX_REPORTED are listed.
+     */
+    unsigned int bad_pages = 0;
+    std::string bad_pages_detail = "";
+
     /**
      * Static const specifiers for status flags.
      */
@@ -1098,8 +1326,8 @@ namespace pgbckctl {
      */
     bool exceeds_retention_rule = false;
 
-    /* List of tablespaces descriptors in backup */
-    std::vector<std::shared_ptr<BackupTablespaceDescr>> tablespaces;
+    /* List of tablespaces in backup */
+    std::vector<BackupTablespaceEntry> tablespaces;
 
     /************* computed columns by SQL *************/
 
@@ -1125,6 +1353,10 @@ namespace pgbckctl {
     unsigned long long estimated_total_size = 0;
     unsigned long avg_backup_duration = 0;
 
+    /* WAL segments currently stored in the archive */
+    unsigned long long wal_segments = 0;
+    unsigned long long wal_bytes = 0;
+
     std::string latest_finished = "";
 
   };
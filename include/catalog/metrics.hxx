@@ -0,0 +1,184 @@
+#ifndef __HAVE_METRICS_HXX__
+#define __HAVE_METRICS_HXX__
+
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <common.hxx>
+#include <descr.hxx>
+#include <streamident.hxx>
+#include <BackupCatalog.hxx>
+#include <shm.hxx>
+
+namespace pgbckctl {
+
+  /**
+   * Per archive catalog data rendered by the metrics
+   * exporter.
+   */
+  class MetricsArchiveEntry {
+  public:
+
+    /**
+     * Archive descriptor.
+     */
+    std::shared_ptr<CatalogDescr> archive = nullptr;
+
+    /**
+     * Materialized archive statistics, see STAT ARCHIVE.
+     */
+    std::shared_ptr<StatCatalogArchive> stat = nullptr;
+
+    /**
+     * Newest basebackup in state "ready", nullptr if
+     * there is none.
+     */
+    std::shared_ptr<BaseBackupDescr> last_basebackup = nullptr;
+
+    /**
+     * Sum of all tablespace sizes of last_basebackup.
+     */
+    unsigned long long last_basebackup_size = 0;
+
+    /**
+     * Streams registered for this archive.
+     */
+    std::vector<std::shared_ptr<StreamIdentification>> streams;
+
+  };
+
+  /**
+   * An in-memory copy of all catalog data the metrics exporter
+   * renders. Like PGProtoCatalogSnapshot, the snapshot carries the
+   * catalog generation from the worker shared memory it was built
+   * with, so scrapes only read the catalog database after it
+   * has changed. Since not every catalog change advances the
+   * generation (e.g. streamed WAL positions), a snapshot also
+   * expires after a maximum age.
+   */
+  class MetricsCatalogSnapshot {
+  private:
+
+    /**
+     * Catalog generation this snapshot was built from.
+     */
+    unsigned long long generation = 0;
+
+    /**
+     * Set by build(), false if the snapshot is empty.
+     */
+    bool built = false;
+
+    /**
+     * Time the snapshot was built.
+     */
+    std::chrono::steady_clock::time_point built_at;
+
+    /**
+     * Per archive entries.
+     */
+    std::vector<std::shared_ptr<MetricsArchiveEntry>> archives;
+
+  public:
+
+    MetricsCatalogSnapshot();
+    virtual ~MetricsCatalogSnapshot();
+
+    /**
+     * (Re-)Builds the snapshot from the given catalog handle. The
+     * catalog handle can be opened read only, build() only
+     * reads from the catalog database.
+     */
+    virtual void build(BackupCatalog &catalog,
+                       unsigned long long generation);
+
+    /**
+     * Returns true if the snapshot matches the specified catalog
+     * generation and isn't older than max_age seconds.
+     */
+    virtual bool isValid(unsigned long long generation,
+                         unsigned int max_age);
+
+    /**
+     * Returns the catalog generation the snapshot was built from.
+     */
+    virtual unsigned long long getGeneration();
+
+    /**
+     * Returns the list of archive entries in this snapshot.
+     */
+    virtual std::vector<std::shared_ptr<MetricsArchiveEntry>> getArchives();
+
+    /**
+     * Returns the archive entry with the specified archive ID,
+     * nullptr if not found.
+     */
+    virtual std::shared_ptr<MetricsArchiveEntry> getArchive(int archive_id);
+
+  };
+
+  /**
+   * Renders a catalog snapshot and a copy of the worker
+   * shared memory slots in OpenMetrics text format.
+   */
+  class OpenMetricsRenderer {
+  private:
+
+    /**
+     * Output stream.
+     */
+    std::ostream &out;
+
+    /**
+     * Writes the HELP and TYPE lines of a metric family.
+     */
+    void family(std::string name,
+                std::string type,
+                std::string help);
+
+    /**
+     * Writes a single sample line.
+     */
+    void sample(std::string name,
+                std::vector<std::pair<std::string, std::string>> labels,
+                std::string value);
+
+    void sample(std::string name,
+                std::vector<std::pair<std::string, std::string>> labels,
+                double value);
+
+    void sample(std::string name,
+                std::vector<std::pair<std::string, std::string>> labels,
+                unsigned long long value);
+
+  public:
+
+    /**
+     * Content type of the rendered output.
+     */
+    static constexpr const char *CONTENT_TYPE
+      = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+    OpenMetricsRenderer(std::ostream &out);
+    virtual ~OpenMetricsRenderer();
+
+    /**
+     * Escapes a label value according to the OpenMetrics
+     * text format.
+     */
+    static std::string escape(std::string value);
+
+    /**
+     * Renders all metrics, including the terminating
+     * EOF marker. workers are copies of the used
+     * worker shared memory slots, see WorkerSHM::read().
+     */
+    virtual void render(std::shared_ptr<MetricsCatalogSnapshot> snapshot,
+                        std::vector<std::pair<unsigned int, shm_worker_area>> workers,
+                        size_t max_workers);
+
+  };
+
+}
+
+#endif
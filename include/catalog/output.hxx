@@ -6,6 +6,7 @@
 #include <descr.hxx>
 #include <rtconfig.hxx>
 #include <BackupCatalog.hxx>
+#include <verifydescr.hxx>
 
 using namespace pgbckctl;
 
@@ -80,6 +81,8 @@ namespace pgbckctl {
                         std::ostringstream &output) = 0;
     virtual void nodeAs(std::vector<shm_worker_area> &slots,
                         std::ostringstream &output) = 0;
+    virtual void nodeAs(std::vector<worker_event> &events,
+                        std::ostringstream &output) = 0;
     virtual void nodeAs(std::vector<std::shared_ptr<ConnectionDescr>> connections,
                         std::ostringstream &output) = 0;
     virtual void nodeAs(std::vector<std::shared_ptr<RetentionDescr>> &retentionList,
@@ -100,6 +103,10 @@ namespace pgbckctl {
                         std::ostringstream &output) = 0;
     virtual void nodeAs(std::shared_ptr<std::list<directory_entry>> fileList,
                         std::ostringstream &output) = 0;
+    virtual void nodeAs(std::vector<std::shared_ptr<ScheduleDescr>> &schedules,
+                        std::ostringstream &output) = 0;
+    virtual void nodeAs(std::shared_ptr<BaseBackupVerifyResult> result,
+                        std::ostringstream &output) = 0;
     static void nodeAs(std::exception &e,
                        std::ostringstream &output,
                        std::string output_type);
@@ -159,6 +166,8 @@ namespace pgbckctl {
                         std::ostringstream &output);
     virtual void nodeAs(std::vector<shm_worker_area> &slots,
                         std::ostringstream &output);
+    virtual void nodeAs(std::vector<worker_event> &events,
+                        std::ostringstream &output);
     virtual void nodeAs(std::vector<std::shared_ptr<ConnectionDescr>> connections,
                         std::ostringstream &output);
     virtual void nodeAs(std::vector<std::shared_ptr<RetentionDescr>> &retentionList,
@@ -179,6 +188,10 @@ namespace pgbckctl {
                         std::ostringstream &output);
     virtual void nodeAs(std::shared_ptr<std::list<directory_entry>> fileList,
                         std::ostringstream &output);
+    virtual void nodeAs(std::vector<std::shared_ptr<ScheduleDescr>> &schedules,
+                        std::ostringstream &output);
+    virtual void nodeAs(std::shared_ptr<BaseBackupVerifyResult> result,
+                        std::ostringstream &output);
 
   };
 
@@ -234,6 +247,8 @@ namespace pgbckctl {
                         std::ostringstream &output);
     virtual void nodeAs(std::vector<shm_worker_area> &slots,
                             std::ostringstream &output);
+    virtual void nodeAs(std::vector<worker_event> &events,
+                        std::ostringstream &output);
     virtual void nodeAs(std::vector<std::shared_ptr<ConnectionDescr>> connections,
                         std::ostringstream &output);
     virtual void nodeAs(std::vector<std::shared_ptr<RetentionDescr>> &retentionList,
@@ -254,6 +269,10 @@ namespace pgbckctl {
                         std::ostringstream &output);
     virtual void nodeAs(std::shared_ptr<std::list<directory_entry>> fileList,
                         std::ostringstream &output);
+    virtual void nodeAs(std::vector<std::shared_ptr<ScheduleDescr>> &schedules,
+                        std::ostringstream &output);
+    virtual void nodeAs(std::shared_ptr<BaseBackupVerifyResult> result,
+                        std::ostringstream &output);
 
 
   };
@@ -11,6 +11,7 @@
 #include <BackupCatalog.hxx>
 #include <backupcleanupdescr.hxx>
 #include <memorybuffer.hxx>
+#include <fs-sparse.hxx>
 
 #ifdef PG_BACKUP_CTL_HAS_ZLIB
 /*
@@ -133,6 +134,14 @@ namespace pgbckctl {
     virtual void setTemporary();
     virtual bool isTemporary();
 
+    /**
+     * Ends the current compressed frame, data written afterwards
+     * can be decompressed without the data written before. Returns
+     * the file offset the new frame starts at, or -1 if the file
+     * can't do that (the default).
+     */
+    virtual off_t frameBoundary();
+
     /**
      * Returns the filename as a string.
      */
@@ -161,11 +170,33 @@ namespace pgbckctl {
     std::string mode = "rb";
 
     bool opened = false;
+
+    /*
+     * Zero blocks are left as holes, see setSparse(). sparse_tail
+     * holds the bytes of an incomplete block not written yet,
+     * sparse_end is the end of the file including a hole at its
+     * end. Both are on disk after flushSparse() only.
+     */
+    bool sparse = false;
+    std::string sparse_tail = "";
+    off_t sparse_end = 0;
+
+    void writeSparse(const char *buf, size_t len, bool aligned);
+    void flushSparse();
+
   public:
 
     ArchiveFile(path pathHandle);
     virtual ~ArchiveFile();
 
+    /**
+     * Leave aligned blocks of SPARSE_BLOCK_SIZE consisting of
+     * zeros as holes when writing, the file gets sparse. Only
+     * for files written sequentially from the start.
+     */
+    virtual void setSparse(bool sparse);
+    virtual bool isSparse();
+
     virtual bool isCompressed();
     virtual void setCompressed(bool compressed);
     virtual bool isOpen();
@@ -253,6 +284,12 @@ namespace pgbckctl {
     virtual off_t lseek(off_t offset, int whence);
     virtual void remove();
 
+    /**
+     * Finishes the current gzip member, the next write
+     * starts a new one.
+     */
+    virtual off_t frameBoundary();
+
     /**
      * Set open mode for this file. The default is "rb"
      */
@@ -641,9 +678,14 @@ namespace pgbckctl {
      * specified in the BackupCleanDescr structure. The caller should have
      * called identifyDeletionPoints() before doing the phyiscal stuff
      * here to be safe.
+     *
+     * If dry_run is set, nothing is removed, only the removed_wal_*
+     * counters of cleanupDescr are advanced for the files which would
+     * have been deleted.
      */
     void removeXLogs(std::shared_ptr<BackupCleanupDescr> cleanupDescr,
-                     unsigned long long wal_segment_size);
+                     unsigned long long wal_segment_size,
+                     bool dry_run = false);
 
     /**
      * Check specified cleanup descriptor being suitable to perform a
@@ -727,9 +769,15 @@ namespace pgbckctl {
     /*
      * Returns a file handle representing the new streamed base
      * backup file content.
+     *
+     * If deduplicate is set, the content is stored in the chunk
+     * store of the archive and the returned handle writes
+     * the recipe <name>.chunks only. This requires compression
+     * NONE or GZIP, the latter compresses the chunks.
      */
     virtual std::shared_ptr<BackupFile> basebackup(std::string name,
-                                                   BackupProfileCompressType compression);
+                                                   BackupProfileCompressType compression,
+                                                   bool deduplicate = false);
 
     /**
      * Instantiate the directory.
@@ -751,6 +799,13 @@ namespace pgbckctl {
      */
     virtual ssize_t size();
 
+    /**
+     * Turns the aligned zero blocks of all files in the streaming
+     * basebackup directory into holes, for plain basebackups
+     * extracted by tar. Returns the number of bytes deallocated.
+     */
+    virtual unsigned long long punchHoles();
+
     /**
      * Fsync directories.
      */
@@ -762,6 +817,12 @@ namespace pgbckctl {
      */
     virtual void remove();
 
+    /**
+     * Returns the backup manifest stored in this basebackup
+     * directory. Throws a CArchiveIssue if there is none.
+     */
+    virtual std::string manifest();
+
     /**
      * Verification of content of the specified
      * base backup descriptor
@@ -0,0 +1,287 @@
+#ifndef __HAVE_FS_CHUNKS_HXX__
+#define __HAVE_FS_CHUNKS_HXX__
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <fs-archive.hxx>
+#include <fs-tar.hxx>
+#include <checksum.hxx>
+
+namespace pgbckctl {
+
+  /**
+   * Bounds of the chunks a deduplicated tar stream is split
+   * into. Chunk boundaries depend on the content only, so
+   * unchanged files give the same chunks in every basebackup.
+   */
+#define CHUNK_MIN_SIZE (16 * 1024)
+#define CHUNK_AVG_SIZE (64 * 1024)
+#define CHUNK_MAX_SIZE (256 * 1024)
+
+  /**
+   * Hash identifying a chunk in the chunk store.
+   */
+#define CHUNK_HASH_ALGORITHM "SHA256"
+
+  /**
+   * Suffix of the recipe replacing a tar archive
+   * in a deduplicated basebackup.
+   */
+#define CHUNK_RECIPE_SUFFIX ".chunks"
+
+  /**
+   * Number of chunks written before they are made durable. The
+   * chunk store syncs them in batches instead of one by one.
+   */
+#define CHUNK_STORE_SYNC_BATCH 1024
+
+  /**
+   * A chunk referenced by a recipe.
+   */
+  typedef struct {
+
+    std::string hash = "";
+    unsigned long long size = 0;
+
+  } chunk_ref;
+
+  /**
+   * Content defined chunking (FastCDC).
+   *
+   * A gear hash is rolled over the data, a chunk ends where the
+   * hash matches a mask. A stricter mask is used below the average
+   * chunk size and a looser one above, which keeps chunk sizes
+   * close to CHUNK_AVG_SIZE.
+   */
+  class ContentDefinedChunker {
+  private:
+
+    uint64_t fingerprint = 0;
+    size_t length = 0;
+
+  public:
+
+    ContentDefinedChunker();
+    virtual ~ContentDefinedChunker();
+
+    /**
+     * Scans up to len bytes for the end of the current chunk.
+     * Returns the number of bytes belonging to the current chunk,
+     * cut is set if the chunk ends there.
+     */
+    virtual size_t scan(const char *buf, size_t len, bool &cut);
+
+    /**
+     * Starts a new chunk.
+     */
+    virtual void reset();
+
+  };
+
+  /**
+   * Content addressed store of chunks, shared by all deduplicated
+   * basebackups of an archive. Chunks are stored once, in files
+   * named by their hash, and are never changed afterwards.
+   *
+   * New chunks are written into temporary files first and get
+   * their final name by sync(), once they are durable. Until then
+   * they are known to this instance only.
+   */
+  class ChunkStore {
+  private:
+
+    path directory;
+    bool compress = false;
+
+    /* temporary and final file names of chunks not synced yet */
+    std::vector<std::pair<path, path>> pending;
+    std::set<std::string> pending_hashes;
+
+    /* subdirectories known to exist */
+    std::set<std::string> subdirs;
+
+  public:
+
+    /**
+     * Chunks written by this instance are gzip compressed if
+     * compress is set. Reading handles both.
+     */
+    ChunkStore(path directory, bool compress = false);
+    virtual ~ChunkStore();
+
+    /**
+     * Returns the chunk store directory of an archive.
+     */
+    static path forArchive(path archive_directory);
+
+    /**
+     * Returns the chunk store directory of the archive the
+     * specified recipe belongs to.
+     */
+    static path forRecipe(path recipe);
+
+    virtual path getPath();
+
+    /**
+     * Returns the file of the specified chunk, either
+     * compressed or not.
+     */
+    virtual path chunkFile(std::string const &hash, bool compressed);
+
+    virtual bool exists(std::string const &hash);
+
+    /**
+     * Stores a chunk, unless it exists already. Returns the
+     * number of bytes written, 0 if the chunk wasn't new.
+     */
+    virtual size_t put(std::string const &hash, const char *data, size_t len);
+
+    /**
+     * Reads the specified chunk and verifies its hash. Throws a
+     * CArchiveIssue if the chunk is missing or corrupted.
+     */
+    virtual void get(std::string const &hash, std::string &data);
+
+    /**
+     * Removes the specified chunk, if it exists.
+     */
+    virtual void remove(std::string const &hash);
+
+    /**
+     * Makes all chunks written so far durable.
+     */
+    virtual void sync();
+
+  };
+
+  /**
+   * The list of chunks a tar archive is made of.
+   */
+  class ChunkRecipe {
+  public:
+
+    /**
+     * Returns true if the specified file is a recipe.
+     */
+    static bool isRecipe(path file);
+
+    /**
+     * Reads a recipe, throws a CArchiveIssue if it
+     * can't be read or is invalid.
+     */
+    static std::vector<chunk_ref> read(path recipe);
+
+    /**
+     * Writes a recipe durably.
+     */
+    static void write(path recipe, std::vector<chunk_ref> &chunks);
+
+    /**
+     * Returns the chunks referenced by the recipes in the
+     * specified basebackup directory, each chunk once.
+     */
+    static std::map<std::string, unsigned long long> chunks(path basebackup);
+
+  };
+
+  /**
+   * Writes a tar stream into the chunk store of an archive.
+   *
+   * The stream is split into content defined chunks, each tar
+   * member starts a new chunk, so files unchanged between
+   * basebackups give the same chunks wherever they are in the
+   * stream. Only chunks not in the store yet are written, the
+   * file itself just lists the chunks (see ChunkRecipe). Write
+   * only.
+   */
+  class ChunkedArchiveFile : public BackupFile {
+  private:
+
+    std::shared_ptr<ChunkStore> store = nullptr;
+    std::shared_ptr<BackupChecksum> hash = nullptr;
+    TarStreamIndexer indexer;
+    ContentDefinedChunker chunker;
+
+    std::string chunk = "";
+    std::vector<chunk_ref> recipe;
+
+    std::string mode = "wb";
+    bool opened = false;
+
+    /* bytes and chunks actually written into the store */
+    unsigned long long stored = 0;
+    unsigned long long chunks_new = 0;
+
+    void cut();
+
+  public:
+
+    ChunkedArchiveFile(path recipe, std::shared_ptr<ChunkStore> store);
+    virtual ~ChunkedArchiveFile();
+
+    /**
+     * A chunked file reports itself as compressed, its size()
+     * is what was written into the chunk store.
+     */
+    virtual bool isCompressed();
+    virtual void setCompressed(bool compressed);
+
+    virtual void open();
+    virtual void close();
+    virtual void fsync();
+    virtual bool isOpen();
+    virtual void rename(path& newname);
+    virtual void setOpenMode(std::string mode);
+    virtual std::string getOpenMode();
+    virtual size_t write(const char *buf, size_t len);
+    virtual size_t read(char *buf, size_t len);
+    virtual void remove();
+    virtual size_t size();
+    virtual off_t lseek(off_t offset, int whence);
+
+    /**
+     * Ends the current chunk. The returned offset is the position
+     * in the tar stream, TarChunkedSource can start reading there
+     * without loading the chunks before.
+     */
+    virtual off_t frameBoundary();
+
+  };
+
+  /**
+   * Reads the tar stream of a recipe from the chunk store. Starting
+   * at an offset on a chunk boundary skips the former chunks without
+   * reading them.
+   */
+  class TarChunkedSource : public TarStreamSource {
+  private:
+
+    std::shared_ptr<ChunkStore> store = nullptr;
+    std::vector<chunk_ref> chunks;
+
+    /* next chunk to load */
+    size_t next = 0;
+
+    /* current chunk and read position within it */
+    std::string data = "";
+    size_t pos = 0;
+
+  public:
+
+    TarChunkedSource(path file, unsigned long long offset = 0);
+    virtual ~TarChunkedSource();
+
+    virtual size_t read(char *buf, size_t len);
+    virtual void skip(unsigned long long len);
+    virtual void close();
+
+  };
+
+}
+
+#endif
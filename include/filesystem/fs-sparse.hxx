@@ -0,0 +1,62 @@
+#ifndef __HAVE_FS_SPARSE_HXX__
+#define __HAVE_FS_SPARSE_HXX__
+
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace pgbckctl {
+
+  /**
+   * Granularity of holes in sparse files. Only aligned blocks of
+   * this size are turned into holes, filesystems can't deallocate
+   * anything smaller anyway.
+   */
+#define SPARSE_BLOCK_SIZE 4096
+
+  /**
+   * Support for sparse files in the archive.
+   *
+   * Relation files of bulk loaded or freshly truncated tables often
+   * contain long runs of zero pages. Blocks consisting of zeros
+   * only are left as holes when written, and files with holes are
+   * copied by their data regions only (SEEK_DATA/SEEK_HOLE), so
+   * they stay sparse.
+   *
+   * The zero scan uses AVX2 if the CPU supports it, SSE2
+   * otherwise on x86_64 and a scalar loop everywhere else.
+   */
+  class SparseFile {
+  public:
+
+    /**
+     * True if the len bytes at buf are all zero.
+     */
+    static bool zero(const char *buf, size_t len);
+
+    /**
+     * True if the zero scan uses AVX2.
+     */
+    static bool vectorized();
+
+    /**
+     * Returns the data regions of the file fd refers to up to size,
+     * as pairs of start and end offsets. The regions in between are
+     * holes. Without SEEK_DATA/SEEK_HOLE support the whole file is a
+     * single data region. The file offset of fd is kept.
+     */
+    static std::vector<std::pair<off_t, off_t>> dataRegions(int fd, off_t size);
+
+    /**
+     * Deallocates the aligned zero blocks of an existing regular
+     * file, its size doesn't change. Returns the number of bytes
+     * turned into holes, 0 if the filesystem can't punch holes.
+     */
+    static unsigned long long punchHoles(boost::filesystem::path file);
+
+  };
+
+}
+
+#endif
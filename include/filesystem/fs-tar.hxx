@@ -0,0 +1,471 @@
+#ifndef __HAVE_FS_TAR_HXX__
+#define __HAVE_FS_TAR_HXX__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+#include <fs-archive.hxx>
+#include <daemon.hxx>
+
+namespace pgbckctl {
+
+  /**
+   * Size of a tar block.
+   */
+#define TAR_BLOCK_SIZE 512
+
+  /**
+   * Suffix of the member index written next to
+   * a tar archive, e.g. "base.tar.gz.index".
+   */
+#define TAR_INDEX_SUFFIX ".index"
+
+  /**
+   * A compressed tar archive starts a new frame at the next
+   * member boundary once the current frame holds this many
+   * uncompressed bytes. Smaller members share a frame.
+   */
+#define TAR_INDEX_FRAME_SIZE (1024 * 1024)
+
+  /**
+   * A member of a tar archive, as returned by
+   * TarArchiveReader::next().
+   *
+   * Offsets are relative to the start of the
+   * uncompressed tar stream.
+   */
+  typedef struct {
+
+    std::string name = "";
+    std::string linkname = "";
+
+    /* tar typeflag, '0' for regular files, '5' for directories... */
+    char type = '0';
+
+    unsigned long long size = 0;
+    time_t mtime = 0;
+
+    /* permission bits */
+    unsigned int mode = 0;
+
+    /*
+     * offset of the header block of this member, or of the
+     * first extended header preceding it
+     */
+    unsigned long long header_offset = 0;
+
+    /* offset of the first data byte */
+    unsigned long long data_offset = 0;
+
+    /*
+     * Compressed frame the member starts in, read from a
+     * TarArchiveIndex: offset of the frame in the archive file
+     * and offset into the uncompressed stream the frame starts
+     * at. Both are the header offset for uncompressed archives.
+     */
+    unsigned long long frame_offset = 0;
+    unsigned long long frame_start = 0;
+
+  } tar_member;
+
+  /**
+   * Sequential source of an uncompressed tar stream.
+   *
+   * Compressed archives are decompressed on the fly, either
+   * by zlib or by piping them through the corresponding
+   * command line tool (zstd, lz4, xz), just like they were
+   * written.
+   */
+  class TarStreamSource {
+  protected:
+
+    path file;
+
+  public:
+
+    TarStreamSource(path file);
+    virtual ~TarStreamSource();
+
+    /**
+     * Opens the specified archive file with a source suitable for
+     * its compression, derived from its file name suffix.
+     * Throws a CArchiveIssue if the file can't be opened.
+     */
+    static std::shared_ptr<TarStreamSource> open(path file);
+
+    /**
+     * Like open(), but starts reading at the specified file offset,
+     * which must be the start of a compressed frame. Only uncompressed
+     * and gzip compressed archives can be opened at an offset other
+     * than 0.
+     */
+    static std::shared_ptr<TarStreamSource> open(path file, unsigned long long offset);
+
+    /**
+     * Returns true if the file name looks like a tar
+     * archive, compressed or not.
+     */
+    static bool isTarArchive(path file);
+
+    /**
+     * Returns the file name without its compression
+     * suffix, e.g. "base.tar" for "base.tar.zst".
+     */
+    static std::string archiveName(path file);
+
+    /**
+     * Reads up to len bytes. Returns less than len
+     * at the end of the stream only.
+     */
+    virtual size_t read(char *buf, size_t len) = 0;
+
+    /**
+     * Skips len bytes of the stream.
+     */
+    virtual void skip(unsigned long long len);
+
+    /**
+     * True if the source supports reading at arbitrary
+     * offsets with pread().
+     */
+    virtual bool seekable();
+
+    /**
+     * Reads len bytes at the given offset, without changing the
+     * position of read(). Safe to call from several threads.
+     * Throws a CArchiveIssue if the source isn't seekable.
+     */
+    virtual size_t pread(char *buf, size_t len, unsigned long long offset);
+
+    virtual void close() = 0;
+
+    virtual path getPath();
+
+  };
+
+  /**
+   * Uncompressed tar archive file.
+   */
+  class TarFileSource : public TarStreamSource {
+  private:
+
+    int fd = -1;
+
+  public:
+
+    TarFileSource(path file, unsigned long long offset = 0);
+    virtual ~TarFileSource();
+
+    virtual size_t read(char *buf, size_t len);
+    virtual void skip(unsigned long long len);
+    virtual bool seekable();
+    virtual size_t pread(char *buf, size_t len, unsigned long long offset);
+    virtual void close();
+
+  };
+
+#ifdef PG_BACKUP_CTL_HAS_ZLIB
+
+  /**
+   * gzip compressed tar archive file, decompressed by zlib.
+   */
+  class TarGzipSource : public TarStreamSource {
+  private:
+
+    gzFile zh = NULL;
+
+  public:
+
+    TarGzipSource(path file, unsigned long long offset = 0);
+    virtual ~TarGzipSource();
+
+    virtual size_t read(char *buf, size_t len);
+    virtual void close();
+
+  };
+
+#endif
+
+  /**
+   * Tar archive file decompressed by an external command,
+   * which writes the decompressed stream to its stdout.
+   */
+  class TarPipedSource : public TarStreamSource {
+  private:
+
+    job_info jobDescr;
+    FILE *fpipe_handle = NULL;
+
+  public:
+
+    TarPipedSource(path file, std::string executable);
+    virtual ~TarPipedSource();
+
+    virtual size_t read(char *buf, size_t len);
+    virtual void close();
+
+  };
+
+  /**
+   * Reads the members of a tar archive sequentially.
+   *
+   * Understands ustar headers (including the name prefix),
+   * GNU long names and pax extended headers, which covers
+   * everything PostgreSQL and GNU tar write. Header checksums
+   * are verified, a corrupted or truncated archive throws a
+   * CArchiveIssue.
+   */
+  class TarArchiveReader {
+  private:
+
+    std::shared_ptr<TarStreamSource> source = nullptr;
+
+    /* current offset into the uncompressed stream */
+    unsigned long long position = 0;
+
+    /* data bytes of the current member not read yet */
+    unsigned long long remaining = 0;
+
+    /* padding after the data of the current member */
+    unsigned long long padding = 0;
+
+    bool eof = false;
+
+    void readBlocks(char *buf, size_t len);
+    void skipBytes(unsigned long long len);
+    std::string readExtension(unsigned long long size);
+
+  public:
+
+    TarArchiveReader(std::shared_ptr<TarStreamSource> source);
+    virtual ~TarArchiveReader();
+
+    /**
+     * Advances to the next member, skipping any unread data of
+     * the current one. Returns false at the end of the archive.
+     */
+    virtual bool next(tar_member &member);
+
+    /**
+     * Reads data of the current member. Returns 0 once
+     * all of its data was read.
+     */
+    virtual size_t read(char *buf, size_t len);
+
+    /**
+     * Parses a numeric header field, octal or base-256.
+     */
+    static unsigned long long number(const char *field, size_t len);
+
+  };
+
+  /**
+   * State of a TarStreamIndexer.
+   */
+  typedef enum {
+
+    TAR_INDEXER_HEADER,
+    TAR_INDEXER_DATA,
+    TAR_INDEXER_END,
+    TAR_INDEXER_FAILED
+
+  } TarIndexerState;
+
+  /**
+   * Builds the member list of a tar stream while it is written.
+   *
+   * The stream is fed in arbitrary pieces, headers are collected
+   * and parsed as they pass by, the same way TarArchiveReader does.
+   * feed() stops at member boundaries, so a caller can start a
+   * new compressed frame there. A stream the indexer can't parse
+   * isn't an error for the writer, the indexer just gives up.
+   */
+  class TarStreamIndexer {
+  private:
+
+    TarIndexerState state = TAR_INDEXER_HEADER;
+
+    /* bytes of the stream seen so far */
+    unsigned long long position = 0;
+
+    char header[TAR_BLOCK_SIZE];
+    size_t header_fill = 0;
+
+    /* data and padding of the current header not seen yet */
+    unsigned long long remaining = 0;
+    unsigned long long padding = 0;
+
+    /* extended header collected, 0 if none */
+    char extension = 0;
+    std::string extension_data = "";
+
+    /*
+     * Extended headers apply to the next member, which
+     * starts at the first of them.
+     */
+    bool pending = false;
+    unsigned long long member_start = 0;
+    std::string longname = "";
+    std::string longlink = "";
+    unsigned long long paxsize = 0;
+    bool have_paxsize = false;
+
+    unsigned long long frame_offset = 0;
+    unsigned long long frame_start = 0;
+
+    std::vector<tar_member> members;
+    std::string error = "";
+
+    void processHeader();
+    void fail(std::string error);
+
+  public:
+
+    TarStreamIndexer();
+    virtual ~TarStreamIndexer();
+
+    /**
+     * Consumes up to len bytes of the stream, but not beyond the
+     * next member boundary. Returns the number of bytes consumed.
+     */
+    virtual size_t feed(const char *buf, size_t len);
+
+    /**
+     * True if the next byte fed starts a new member.
+     */
+    virtual bool atBoundary();
+
+    /**
+     * True if the stream seen so far ends on a member boundary
+     * or with the end of archive marker.
+     */
+    virtual bool complete();
+
+    virtual bool failed();
+    virtual std::string getError();
+
+    virtual unsigned long long getPosition();
+
+    /**
+     * Members starting from now on are in the compressed frame
+     * at the specified file offset, which starts at the given
+     * stream offset.
+     */
+    virtual void setFrame(unsigned long long offset, unsigned long long start);
+
+    virtual std::vector<tar_member> &getMembers();
+
+  };
+
+  /**
+   * Member index of a tar archive, stored in a text file next
+   * to the archive (see TAR_INDEX_SUFFIX).
+   *
+   * Each member is listed with its offsets and the compressed
+   * frame it starts in, so a single member can be read without
+   * decompressing the archive from its start.
+   */
+  class TarArchiveIndex {
+  private:
+
+    path archive;
+    std::vector<tar_member> members;
+
+  public:
+
+    TarArchiveIndex(path archive);
+    virtual ~TarArchiveIndex();
+
+    /**
+     * Returns the path of the index file of the specified archive.
+     */
+    static path indexFile(path archive);
+
+    /**
+     * Reads the index file. Returns false if there is no index or
+     * it doesn't fit the archive (anymore), the index can't be used
+     * then.
+     */
+    virtual bool load();
+
+    /**
+     * Writes the index file of the archive, which must be complete
+     * already. Throws a CArchiveIssue on errors.
+     */
+    virtual void write(std::vector<tar_member> &members);
+
+    virtual std::vector<tar_member> &getMembers();
+
+    /**
+     * Looks up the member with the specified name. Returns false
+     * if there is no such member.
+     */
+    virtual bool lookup(std::string name, tar_member &member);
+
+    /**
+     * Opens the archive positioned at the header of the specified
+     * member, a TarArchiveReader on the returned source starts with
+     * this member.
+     */
+    virtual std::shared_ptr<TarStreamSource> open(tar_member &member);
+
+  };
+
+  /**
+   * Writes a tar stream into a BackupFile and indexes its
+   * members on the way.
+   *
+   * If the file is compressed and can start new frames, a new
+   * frame is started at a member boundary whenever the current
+   * one got TAR_INDEX_FRAME_SIZE bytes. The index is written
+   * when the file is closed. Write only, read() and lseek()
+   * throw.
+   */
+  class TarIndexingFile : public BackupFile {
+  private:
+
+    std::shared_ptr<BackupFile> file = nullptr;
+    TarStreamIndexer indexer;
+
+    /* stream offset the current frame starts at */
+    unsigned long long frame_start = 0;
+
+    bool indexed = false;
+
+    void frame();
+    void writeIndex();
+
+  public:
+
+    TarIndexingFile(std::shared_ptr<BackupFile> file);
+    virtual ~TarIndexingFile();
+
+    virtual bool isCompressed();
+    virtual void setCompressed(bool compressed);
+
+    virtual void open();
+    virtual void close();
+    virtual void fsync();
+    virtual bool isOpen();
+    virtual void rename(path& newname);
+    virtual void setOpenMode(std::string mode);
+    virtual std::string getOpenMode();
+    virtual size_t write(const char *buf, size_t len);
+    virtual size_t read(char *buf, size_t len);
+    virtual void remove();
+    virtual size_t size();
+    virtual off_t lseek(off_t offset, int whence);
+    virtual off_t current_position();
+
+    /**
+     * Returns the file the tar stream is written to.
+     */
+    virtual std::shared_ptr<BackupFile> getFile();
+
+  };
+
+}
+
+#endif
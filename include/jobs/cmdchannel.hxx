@@ -0,0 +1,259 @@
+#ifndef __HAVE_CMDCHANNEL_HXX__
+#define __HAVE_CMDCHANNEL_HXX__
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <daemon.hxx>
+
+namespace pgbckctl {
+
+  /**
+   * Message types of the launcher command channel.
+   */
+  typedef enum {
+
+    /* caller -> launcher: command to execute */
+    CMD_MSG_SUBMIT = 'S',
+
+    /* launcher or worker -> caller: command accepted or rejected */
+    CMD_MSG_ACK = 'A',
+
+    /* worker -> caller: instrumentation of the worker */
+    CMD_MSG_PROGRESS = 'P',
+
+    /* worker -> caller: command finished */
+    CMD_MSG_DONE = 'D'
+
+  } CommandMessageType;
+
+  /**
+   * Flags of a submitted command.
+   *
+   * CMD_SUBMIT_WAIT asks for progress and completion messages,
+   * such commands are always executed by a dedicated worker.
+   */
+#define CMD_SUBMIT_WAIT 0x01
+
+  /**
+   * Maximum size of a single message.
+   */
+#define CMD_MSG_MAX_SIZE 65536
+
+  /**
+   * A command passed to the launcher. The caller has already
+   * parsed the command, so the launcher can dispatch it by its
+   * tag without parsing it again.
+   */
+  typedef struct {
+
+    CatalogTag tag = EMPTY_DESCR;
+    unsigned int flags = 0;
+    std::string archive_name = "";
+
+    /* command string the worker executes */
+    std::string command = "";
+
+  } launcher_cmd_request;
+
+  /**
+   * Answer to a submitted command.
+   */
+  typedef struct {
+
+    bool accepted = false;
+
+    /* PID of the worker, 0 if passed to the worker pool */
+    pid_t pid = 0;
+
+    /* error message if the command was rejected */
+    std::string message = "";
+
+  } launcher_cmd_ack;
+
+  /**
+   * Result of a command executed with CMD_SUBMIT_WAIT.
+   */
+  typedef struct {
+
+    bool success = false;
+    std::string message = "";
+
+  } launcher_cmd_done;
+
+  /**
+   * A single message of the command channel.
+   *
+   * Every message is sent as one SOCK_SEQPACKET packet, consisting
+   * of the message type byte followed by its fields. Integers are
+   * encoded in network byte order, strings are prefixed by their
+   * length. Decoding a truncated message throws a LauncherFailure.
+   */
+  class CommandMessage {
+  private:
+
+    std::string buf = "";
+    size_t pos = 1;
+
+    void putUInt32(uint32_t value);
+    void putInt64(int64_t value);
+    void putString(std::string value);
+
+    uint32_t getUInt32();
+    int64_t getInt64();
+    std::string getString();
+
+  public:
+
+    CommandMessage();
+    CommandMessage(launcher_cmd_request &request);
+    CommandMessage(launcher_cmd_ack &ack);
+    CommandMessage(std::vector<worker_instrumentation_item> &items);
+    CommandMessage(launcher_cmd_done &done);
+    virtual ~CommandMessage();
+
+    /**
+     * Type of this message, 0 if empty.
+     */
+    virtual CommandMessageType type();
+
+    /**
+     * Decodes the fields of this message, throws a LauncherFailure
+     * in case the message is of another type or truncated.
+     */
+    virtual void decode(launcher_cmd_request &request);
+    virtual void decode(launcher_cmd_ack &ack);
+    virtual void decode(std::vector<worker_instrumentation_item> &items);
+    virtual void decode(launcher_cmd_done &done);
+
+    /**
+     * Raw message content.
+     */
+    virtual std::string &data();
+
+  };
+
+  /**
+   * Connection over the command channel of a launcher.
+   *
+   * The launcher listens on an abstract SOCK_SEQPACKET unix socket
+   * per catalog. A caller connects, submits a single command and
+   * gets an acknowledgement, either from the launcher itself or from
+   * the worker executing the command. The connection is passed down
+   * to the worker, so a caller waiting for the command gets the
+   * progress and the result directly from the worker.
+   */
+  class LauncherCommandChannel {
+  private:
+
+    int fd = -1;
+
+  public:
+
+    LauncherCommandChannel();
+
+    /**
+     * Adopts an already connected socket.
+     */
+    LauncherCommandChannel(int fd);
+
+    /**
+     * Closes the connection, if still open.
+     */
+    virtual ~LauncherCommandChannel();
+
+    /**
+     * Returns the abstract unix socket address the launcher of
+     * the given catalog listens on for commands.
+     */
+    static socklen_t address(std::string catalog_name,
+                             struct sockaddr_un &addr);
+
+    /**
+     * Creates the non-blocking listening socket of the launcher.
+     * Throws a LauncherFailure on errors.
+     */
+    static int listen(std::string catalog_name);
+
+    /**
+     * Returns true if the peer of the specified connection runs
+     * with our effective user ID or as root. The socket lives in the
+     * abstract namespace, which has no file permissions, so this is
+     * checked by the launcher for every connection.
+     */
+    static bool peerAllowed(int fd);
+
+    /**
+     * Connects to the launcher of the given catalog. Returns false
+     * if there is no launcher listening.
+     */
+    virtual bool connect(std::string catalog_name);
+
+    /**
+     * Returns the socket descriptor, -1 if not connected.
+     */
+    virtual int socket();
+
+    /**
+     * Returns the socket descriptor and forgets about it,
+     * so it isn't closed by this instance anymore.
+     */
+    virtual int release();
+
+    virtual void close();
+
+    /**
+     * Sends a message. Throws a LauncherFailure on errors, e.g. if
+     * the peer has gone away.
+     */
+    virtual void send(CommandMessage &msg);
+
+    /**
+     * Receives a message, waiting for timeout milliseconds at most
+     * (forever if negative). Returns false on timeout and in case
+     * the peer has closed the connection, in which case the message
+     * is left empty.
+     */
+    virtual bool receive(CommandMessage &msg, int timeout);
+
+  };
+
+  /**
+   * Submits a command via the command channel of the launcher of
+   * the given catalog.
+   *
+   * Returns false if there's no launcher listening. Otherwise, ack
+   * holds the answer of the launcher. If the command was accepted
+   * and request.flags has CMD_SUBMIT_WAIT set, this blocks until the
+   * worker has finished and calls progress for every progress message
+   * of the worker, done holds the result afterwards.
+   */
+  bool submit_launcher_cmd(std::string catalog_name,
+                           launcher_cmd_request &request,
+                           launcher_cmd_ack &ack,
+                           launcher_cmd_done &done,
+                           std::function<void(pid_t, std::vector<worker_instrumentation_item> &)> progress = nullptr);
+
+  /**
+   * Passes the specified command to the launcher of the catalog the
+   * job handle belongs to without waiting for it to finish.
+   *
+   * Uses the command channel and falls back to the message queue, if
+   * the launcher doesn't listen there, e.g. since it isn't started yet.
+   * Throws a LauncherFailure if the launcher rejected the command.
+   *
+   * Returns the PID of the worker, or 0 if it isn't known yet.
+   */
+  pid_t dispatch_launcher_cmd(job_info &info,
+                              CatalogTag tag,
+                              std::string archive_name,
+                              std::string command);
+
+}
+
+#endif
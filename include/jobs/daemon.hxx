@@ -164,8 +164,8 @@ namespace pgbckctl {
      * a signal handler (especially SIGCHLD handlers) don't have
      * access to our internal worker shared memory area. The
      * dead PIDS are reaped by calling execute_reaper(), which
-     * should happen periodically to avoid wasting too much
-     * worker slots in shared memory.
+     * the launcher does whenever it receives SIGCHLD to avoid
+     * wasting too much worker slots in shared memory.
      */
     virtual void assign_reaper(background_reaper *reaper);
 
@@ -181,7 +181,9 @@ namespace pgbckctl {
   void establish_launcher_cmd_queue(job_info &info);
   void send_launcher_cmd(job_info& info, std::string command);
   std::string recv_launcher_cmd(job_info &info, bool &cmd_received);
-  pid_t worker_command(BackgroundWorker &worker, std::string command);
+  pid_t worker_command(BackgroundWorker &worker,
+                       std::string command,
+                       int channel_fd = -1);
 
   /**
    * Returns true in case a background launcher process
@@ -189,6 +191,16 @@ namespace pgbckctl {
    */
   bool launcher_is_running(std::shared_ptr<CatalogProc> procInfo);
 
+  /**
+   * Advances the catalog generation counter in the worker
+   * shared memory of the given catalog, telling any process
+   * caching catalog data that it needs to refresh its copy.
+   *
+   * Does nothing if there is no worker shared memory segment
+   * for this catalog, since then no one can cache anything.
+   */
+  void catalog_changed(std::string catalog_name);
+
   /**
    * Runs a blocking child subprocess.
    */
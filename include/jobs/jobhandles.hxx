@@ -4,6 +4,7 @@
 #include <boost/interprocess/ipc/message_queue.hpp>
 //#include <BackupCatalog.hxx>
 #include <commands.hxx>
+#include <workerpolicy.hxx>
 
 namespace pgbckctl {
 
@@ -111,6 +112,51 @@ namespace pgbckctl {
      */
     boost::interprocess::message_queue *command_queue = nullptr;
 
+    /**
+     * Number of pre-forked pool workers the launcher keeps
+     * around to execute short commands. 0 disables the pool,
+     * every command gets its own worker process then.
+     */
+    unsigned int worker_pool_size = 0;
+
+    /**
+     * Queue the launcher passes commands to its pool
+     * workers with, only set if worker_pool_size > 0.
+     */
+    boost::interprocess::message_queue *pool_queue = nullptr;
+
+    /**
+     * Limits of the launcher scheduler: maximum number of
+     * scheduled basebackups running concurrently against the same
+     * database host and writing to the same storage device, 0
+     * means unlimited. Scheduled jobs are started delayed by up to
+     * scheduler_max_start_delay seconds.
+     */
+    unsigned int scheduler_max_basebackups_per_host = 1;
+    unsigned int scheduler_max_basebackups_per_device = 2;
+    unsigned int scheduler_max_start_delay = 60;
+
+    /**
+     * Budgets of the I/O governor in kB per second, 0 means
+     * unlimited. See IOGovernor.
+     */
+    unsigned long long governor_total_rate = 0;
+    unsigned long long governor_wal_rate = 0;
+    unsigned long long governor_basebackup_rate = 0;
+    unsigned long long governor_restore_rate = 0;
+
+    /**
+     * Scheduling policies of the workers by job type,
+     * see WorkerPolicy.
+     */
+    WorkerPolicy worker_policies[WORKER_POLICY_TYPES];
+
+    /**
+     * Runtime configuration the launcher was started with,
+     * assigned to every command executed by its workers.
+     */
+    std::shared_ptr<RuntimeConfiguration> runtime_config = nullptr;
+
   } job_info;
 
 
@@ -0,0 +1,54 @@
+#ifndef __HAVE_METRICSDESCR_HXX__
+#define __HAVE_METRICSDESCR_HXX__
+
+#include <string>
+#include <vector>
+
+namespace pgbckctl {
+
+  /**
+   * Metrics server descriptor.
+   */
+  class MetricsServerDescr {
+  public:
+
+    static const int DEFAULT_METRICS_PORT = 9433;
+
+    /**
+     * Default maximum age of the cached catalog snapshot
+     * in seconds.
+     */
+    static const unsigned int DEFAULT_SNAPSHOT_MAX_AGE = 30;
+
+    /**
+     * Port number to listen on.
+     */
+    unsigned int port = DEFAULT_METRICS_PORT;
+
+    /**
+     * List of IP addresses to listen on.
+     */
+    std::vector<std::string> listen_on;
+
+    /**
+     * The worker id this metrics server was registered to.
+     */
+    int worker_id = -1;
+
+    /**
+     * Catalog the metrics are exported for. This usually
+     * means the path to the SQLite database.
+     */
+    std::string catalog_name = "";
+
+    /**
+     * Maximum age of the cached catalog snapshot in seconds. The
+     * snapshot is rebuilt earlier if the catalog generation
+     * changes.
+     */
+    unsigned int snapshot_max_age = DEFAULT_SNAPSHOT_MAX_AGE;
+
+  };
+}
+
+#endif
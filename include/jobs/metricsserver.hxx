@@ -0,0 +1,43 @@
+#ifndef __HAVE_PGBCKCTL_METRICS_SERVER__
+#define __HAVE_PGBCKCTL_METRICS_SERVER__
+
+/*
+ * NOTE:
+ *
+ * Like server.hxx, this doesn't include any boost::asio
+ * definitions, those are kept private in metricsserver.cxx.
+ */
+
+#include <memory>
+#include <metricsdescr.hxx>
+#include <server.hxx>
+
+namespace pgbckctl {
+
+  /* Forward class declarations */
+  class PGBackupCtlMetricsServer;
+
+  /**
+   * Public implementation interface for the
+   * pg_backup_ctl++ metrics server.
+   *
+   * The metrics server answers HTTP GET requests for /metrics
+   * with the state of the archives and workers of a catalog in
+   * OpenMetrics text format. Worker state is read from the worker
+   * shared memory, catalog data is served from a cached snapshot,
+   * so scraping never writes to or locks the catalog database.
+   */
+  class MetricsServer {
+  protected:
+    std::shared_ptr<PGBackupCtlMetricsServer> instance = nullptr;
+  public:
+
+    MetricsServer(std::shared_ptr<MetricsServerDescr> metricsDescr);
+    virtual ~MetricsServer();
+
+    virtual void run();
+
+  };
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef __HAVE_SCHEDULEDESCR_HXX__
+#define __HAVE_SCHEDULEDESCR_HXX__
+
+#include <string>
+
+namespace pgbckctl {
+
+  /**
+   * Job types the launcher scheduler can start.
+   */
+  typedef enum {
+
+    SCHEDULE_ACTION_NONE = 0,
+    SCHEDULE_ACTION_BASEBACKUP,
+    SCHEDULE_ACTION_RETENTION
+
+  } ScheduleAction;
+
+  /**
+   * Descriptor of a schedule stored in the catalog. A schedule
+   * starts a basebackup or applies a retention policy to its
+   * archive at the times matched by a cron expression.
+   */
+  class ScheduleDescr {
+  public:
+
+    /**
+     * Catalog ID of the schedule, -1 if not stored yet.
+     */
+    int id = -1;
+
+    /**
+     * Archive the schedule belongs to.
+     */
+    int archive_id = -1;
+    std::string archive_name = "";
+
+    /**
+     * Schedule name, unique per archive.
+     */
+    std::string name = "";
+
+    /**
+     * Cron expression with the five fields minute, hour,
+     * day of month, month and day of week.
+     */
+    std::string cron = "";
+
+    /**
+     * Job to start.
+     */
+    ScheduleAction action = SCHEDULE_ACTION_NONE;
+
+    /**
+     * Backup profile for SCHEDULE_ACTION_BASEBACKUP (empty
+     * means the default profile), retention policy name for
+     * SCHEDULE_ACTION_RETENTION.
+     */
+    std::string param = "";
+
+    std::string created = "";
+
+    /**
+     * Time the scheduler started the job last,
+     * empty if it never did.
+     */
+    std::string last_run = "";
+
+    /**
+     * Returns the string representation of the specified
+     * action as stored in the catalog.
+     */
+    static std::string actionToString(ScheduleAction action) {
+
+      switch(action) {
+      case SCHEDULE_ACTION_BASEBACKUP:
+        return "basebackup";
+      case SCHEDULE_ACTION_RETENTION:
+        return "retention";
+      default:
+        return "none";
+      }
+
+    }
+
+    /**
+     * Inverse of actionToString().
+     */
+    static ScheduleAction stringToAction(std::string action) {
+
+      if (action == "basebackup")
+        return SCHEDULE_ACTION_BASEBACKUP;
+
+      if (action == "retention")
+        return SCHEDULE_ACTION_RETENTION;
+
+      return SCHEDULE_ACTION_NONE;
+
+    }
+
+  };
+}
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef __HAVE_SCHEDULER_HXX__
+#define __HAVE_SCHEDULER_HXX__
+
+#include <ctime>
+#include <map>
+#include <vector>
+#include <sys/types.h>
+
+#include <common.hxx>
+#include <daemon.hxx>
+#include <scheduledescr.hxx>
+
+namespace pgbckctl {
+
+  /*
+   * Errors in schedule definitions are mapped
+   * to SchedulerFailure exceptions.
+   */
+  class SchedulerFailure : public CPGBackupCtlFailure {
+  public:
+    SchedulerFailure(const char *errstr) throw() : CPGBackupCtlFailure(errstr) {};
+    SchedulerFailure(std::string errstr) throw() : CPGBackupCtlFailure(errstr) {};
+  };
+
+  /**
+   * A parsed cron expression.
+   *
+   * Supports the five standard fields minute, hour, day of month,
+   * month and day of week, each a comma separated list of
+   * values, ranges (a-b) and steps (*\/n, a-b/n). Day of week
+   * accepts 0-7, where both 0 and 7 are sunday. Like cron, a time
+   * matches if either day field matches, in case both are
+   * restricted. The macros @hourly, @daily, @weekly and @monthly
+   * are understood, too.
+   *
+   * All times are evaluated in local time.
+   */
+  class CronExpression {
+  private:
+
+    std::string expression = "";
+
+    std::vector<bool> minutes;
+    std::vector<bool> hours;
+    std::vector<bool> mdays;
+    std::vector<bool> months;
+    std::vector<bool> wdays;
+
+    /*
+     * Set if the corresponding day field is "*".
+     */
+    bool mday_any = false;
+    bool wday_any = false;
+
+    /*
+     * Parses a single field into the specified value set.
+     */
+    static void parseField(std::string field,
+                           unsigned int min,
+                           unsigned int max,
+                           std::vector<bool> &values);
+
+    bool dayMatches(struct tm &tm);
+
+  public:
+
+    /**
+     * Parses the specified expression, throws
+     * a SchedulerFailure if it is malformed.
+     */
+    CronExpression(std::string expression);
+    virtual ~CronExpression();
+
+    /**
+     * Returns true if the specified local time
+     * matches the expression.
+     */
+    virtual bool matches(struct tm &tm);
+
+    /**
+     * Returns the first matching minute after the specified
+     * time. Throws a SchedulerFailure if there is none within the
+     * next years, e.g. for "0 0 30 2 *".
+     */
+    virtual time_t next(time_t after);
+
+    /**
+     * Returns the expression as specified.
+     */
+    virtual std::string str();
+
+  };
+
+  /**
+   * The launcher's job scheduler.
+   *
+   * Reads the schedules from the catalog and starts their jobs
+   * by passing the corresponding commands to the launcher via
+   * send_launcher_cmd(), just like a user would. The schedules are
+   * reloaded whenever the catalog generation in the worker shared
+   * memory advances.
+   *
+   * Basebackups are subject to two concurrency limits: the number
+   * of basebackups running against the same database host and the
+   * number of basebackups writing to the same storage device. A
+   * job exceeding a limit is deferred until a running basebackup
+   * finishes. Additionally, the start of every job is delayed by a
+   * fixed, per schedule offset of up to max_start_delay seconds,
+   * so schedules sharing the same cron expression don't start
+   * their jobs all at once.
+   */
+  class LauncherScheduler {
+  private:
+
+    /*
+     * State of a single schedule.
+     */
+    typedef struct scheduled_job {
+
+      std::shared_ptr<ScheduleDescr> schedule = nullptr;
+      std::shared_ptr<CronExpression> cron = nullptr;
+
+      /* Time according to the cron expression */
+      time_t nominal = 0;
+
+      /* nominal plus start delay */
+      time_t due = 0;
+
+    } scheduled_job;
+
+    /*
+     * Database host and storage device of an archive,
+     * used to apply the basebackup limits.
+     */
+    typedef struct archive_location {
+
+      std::string host = "";
+      dev_t device = 0;
+
+    } archive_location;
+
+    /*
+     * A basebackup passed to the launcher, but not yet
+     * visible in the worker shared memory.
+     */
+    typedef struct pending_basebackup {
+
+      int archive_id = -1;
+      time_t dispatched = 0;
+
+    } pending_basebackup;
+
+    std::shared_ptr<BackupCatalog> catalog = nullptr;
+    WorkerSHM *worker_shm = nullptr;
+
+    unsigned int max_basebackups_per_host = 0;
+    unsigned int max_basebackups_per_device = 0;
+    unsigned int max_start_delay = 0;
+
+    /*
+     * Catalog generation the schedules were loaded with.
+     */
+    unsigned long long generation = 0;
+    bool loaded = false;
+
+    /* Schedules by catalog ID */
+    std::map<int, scheduled_job> jobs;
+
+    /* Locations by archive ID */
+    std::map<int, archive_location> locations;
+
+    std::vector<pending_basebackup> pending;
+
+    /*
+     * (Re-)Reads the schedules from the catalog.
+     */
+    void load(time_t now);
+
+    /*
+     * Returns the location of the specified archive, looked
+     * up in the catalog if not known yet.
+     */
+    archive_location &location(int archive_id);
+
+    /*
+     * Returns true if a basebackup for the specified archive
+     * can be started without exceeding the limits.
+     */
+    bool admit(int archive_id, time_t now);
+
+    /*
+     * Returns the start delay of the specified schedule.
+     */
+    time_t startDelay(std::shared_ptr<ScheduleDescr> schedule);
+
+  public:
+
+    /**
+     * Seconds to wait before deferred jobs are checked
+     * again, in case no worker exits before.
+     */
+    static const int RETRY_INTERVAL = 10;
+
+    /**
+     * Seconds after which a dispatched basebackup not yet showing
+     * up in the worker shared memory isn't counted anymore.
+     */
+    static const int PENDING_TIMEOUT = 60;
+
+    LauncherScheduler(std::shared_ptr<BackupCatalog> catalog,
+                      WorkerSHM *worker_shm,
+                      unsigned int max_basebackups_per_host,
+                      unsigned int max_basebackups_per_device,
+                      unsigned int max_start_delay);
+    virtual ~LauncherScheduler();
+
+    /**
+     * Starts all due jobs. Returns the number of seconds until
+     * the scheduler needs to run again, or -1 if there is
+     * nothing scheduled.
+     */
+    virtual int run(job_info &info);
+
+    /**
+     * Returns the command string executing the job
+     * of the specified schedule.
+     */
+    static std::string jobCommand(std::shared_ptr<ScheduleDescr> schedule);
+
+  };
+
+}
+
+#endif
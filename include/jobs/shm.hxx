@@ -3,15 +3,13 @@
 
 #include <boost/interprocess/managed_xsi_shared_memory.hpp>
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <workerpolicy.hxx>
 
 namespace pgbckctl {
 
-#define WORKER_SHM_CRITICAL_SECTION_START_P(shm) \
-  { \
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>(*((shm)->check_and_get_mutex()));
-
-#define WORKER_SHM_CRITICAL_SECTION_END }
-
   class background_reaper;
   class background_worker_shm_reaper;
 
@@ -24,13 +22,39 @@ namespace pgbckctl {
     SHMFailure(std::string errstr) throw() : CPGBackupCtlFailure(errstr) {};
   };
 
+  /**
+   * Keys of instrumentation items published by workers, see
+   * WorkerInstrumentation.
+   */
+  typedef enum {
+
+    INSTR_NONE = 0,
+
+    /* WAL streamer */
+    INSTR_WAL_RECEIVED_LSN,
+    INSTR_WAL_FLUSHED_LSN,
+    INSTR_WAL_BYTES_PER_SEC,
+    INSTR_WAL_MSGS_PER_SEC,
+    INSTR_WAL_FSYNC_USEC,
+
+    /* basebackup */
+    INSTR_BASEBACKUP_TABLESPACE_OID,
+    INSTR_BASEBACKUP_TABLESPACE_BYTES,
+    INSTR_BASEBACKUP_BYTES_PER_SEC,
+    INSTR_BASEBACKUP_COMPRESSION_RATIO,
+    INSTR_BASEBACKUP_WRITE_QUEUE_DEPTH,
+    INSTR_BASEBACKUP_RECEIVER_STALL_MSEC,
+    INSTR_BASEBACKUP_WRITER_IDLE_MSEC
+
+  } WorkerInstrumentationKey;
+
   /**
    * Instrumentation item
    */
   typedef struct {
 
-    int key;
-    long long value;
+    int key = INSTR_NONE;
+    long long value = 0;
     boost::posix_time::ptime start_time;
 
   } worker_instrumentation_item ;
@@ -60,6 +84,16 @@ namespace pgbckctl {
   typedef struct {
 
     volatile pid_t pid = -1; /* -1 means unused slot */
+
+    /*
+     * Sequence counter of this slot (seqlock). Writers switch it
+     * from even to odd with a CAS before they modify the slot and
+     * make it even again afterwards, readers retry their copy until
+     * they saw the same even counter before and after. See
+     * WorkerSHM::read().
+     */
+    volatile unsigned int seq = 0;
+
     CatalogTag cmdType;
     int archive_id = -1; /* -1 means no archive attached */
     boost::posix_time::ptime started;
@@ -87,8 +121,183 @@ namespace pgbckctl {
      */
     worker_instrumentation_item instr[MAX_WORKER_INSTRUMENTATION_SLOTS];
 
+    /**
+     * Scheduling policy in effect for this worker,
+     * see WorkerPolicy.
+     */
+    worker_policy_info policy;
+
   } shm_worker_area;
 
+  /**
+   * Catalog generation counter, kept in the worker shared
+   * memory segment besides the worker slots.
+   *
+   * Every process changing the set of basebackups or the
+   * properties of an archive bumps the counter, so that readers
+   * holding a cached copy of catalog data (e.g. the streaming
+   * server catalog snapshot) can tell their copy is stale
+   * without touching the catalog database. The counter is
+   * read and updated lock-free.
+   */
+  typedef struct {
+
+    std::atomic<unsigned long long> generation;
+
+  } shm_catalog_generation;
+
+  /**
+   * Job classes of the I/O governor, see IOGovernor.
+   *
+   * IO_CLASS_TOTAL isn't a job class itself, but the host wide
+   * budget shared by all classes.
+   */
+  typedef enum {
+
+    IO_CLASS_WAL = 0,
+    IO_CLASS_BASEBACKUP,
+    IO_CLASS_RESTORE,
+    IO_CLASS_TOTAL
+
+  } IOGovernorClass;
+
+#define IO_GOVERNOR_BUCKETS (IO_CLASS_TOTAL + 1)
+
+  /**
+   * A token bucket of the I/O governor.
+   *
+   * The bucket is kept as the time it runs empty (the theoretical
+   * arrival time of the next byte, GCRA), in nanoseconds of the
+   * steady clock, which is the same for all processes on the host.
+   * This way a single atomic value describes the bucket and it can
+   * be updated with a CAS, without any locks.
+   */
+  typedef struct {
+
+    /* Budget in bytes per second, 0 means unlimited */
+    std::atomic<unsigned long long> rate;
+
+    /* Time the bucket runs empty */
+    std::atomic<long long> tat;
+
+  } shm_io_bucket;
+
+  /**
+   * Token buckets of the I/O governor, kept in the worker
+   * shared memory segment besides the worker slots. The budgets
+   * are set by the launcher during startup.
+   */
+  typedef struct {
+
+    shm_io_bucket bucket[IO_GOVERNOR_BUCKETS];
+
+  } shm_io_governor;
+
+  /**
+   * Events recorded into the event log of a worker,
+   * see WorkerEventLog. The comments list the numeric arguments
+   * recorded with an event.
+   */
+  typedef enum {
+
+    EVT_NONE = 0,
+
+    /* command tag, archive id */
+    EVT_WORKER_START,
+
+    /* 1 if the command succeeded, 0 otherwise */
+    EVT_WORKER_EXIT,
+
+    /* WAL streamer: start position, timeline */
+    EVT_WAL_STREAM_START,
+
+    /* WAL streamer: start position, length, server position */
+    EVT_WAL_DATA,
+
+    /* WAL streamer: flush position, timeline */
+    EVT_WAL_SEGMENT_DONE,
+
+    /* WAL streamer: write, flush and apply position */
+    EVT_WAL_STATUS_UPDATE,
+
+    /* WAL streamer: 1 if a reply was requested */
+    EVT_WAL_KEEPALIVE,
+
+    /* WAL streamer: archiver state, write position, timeline */
+    EVT_WAL_STREAM_END,
+
+    /* basebackup: start position, timeline */
+    EVT_BASEBACKUP_START,
+
+    /* basebackup: tablespace oid, size */
+    EVT_BASEBACKUP_TABLESPACE,
+
+    /* basebackup: end position */
+    EVT_BASEBACKUP_END
+
+  } WorkerEventId;
+
+  /**
+   * Number of numeric arguments of an event.
+   */
+#define WORKER_EVENT_ARGS 3
+
+  /**
+   * Number of records in the event log of a worker slot.
+   */
+#define WORKER_EVENT_LOG_SIZE 512
+
+  /**
+   * A single record of a worker event log.
+   *
+   * seq is the position of the record in the log plus one, 0 while
+   * the record is written. Readers take a copy and discard it if seq
+   * was 0 or changed meanwhile.
+   */
+  typedef struct {
+
+    std::atomic<unsigned long long> seq;
+
+    /* nanoseconds since the epoch */
+    long long timestamp;
+
+    pid_t pid;
+    int event;
+    long long args[WORKER_EVENT_ARGS];
+
+  } shm_worker_event;
+
+  /**
+   * Event log of a worker slot, a ring buffer of fixed size
+   * records. next counts all records ever written, so the
+   * record at next % WORKER_EVENT_LOG_SIZE is the oldest one.
+   *
+   * The event logs live besides the worker slots, but aren't
+   * cleared when a slot is freed or the launcher starts. This way
+   * the last events of a crashed worker can still be inspected.
+   */
+  typedef struct {
+
+    std::atomic<unsigned long long> next;
+    shm_worker_event events[WORKER_EVENT_LOG_SIZE];
+
+  } shm_worker_event_log;
+
+  /**
+   * A decoded copy of an event log record, see
+   * WorkerSHM::readEvents().
+   */
+  typedef struct {
+
+    unsigned long long seq = 0;
+    unsigned int slot = 0;
+    long long timestamp = 0;
+    pid_t pid = -1;
+    int event = EVT_NONE;
+    long long args[WORKER_EVENT_ARGS] = { 0, 0, 0 };
+
+  } worker_event;
+
   /**
    * Base class for process specific shared memory segments.
    */
@@ -266,8 +475,10 @@ namespace pgbckctl {
      * currently used is:
      *
      * (sizeof(shm_worker_area)) * max_workers
-     *    + sizeof(boost::interprocess::interprocess_mutex)
-     *    + 4
+     *    + slot allocation bitmap
+     *    + I/O governor buckets
+     *    + (sizeof(shm_worker_event_log)) * max_workers
+     *    + 4096
      */
     size_t calculateSHMsize();
 
@@ -276,6 +487,58 @@ namespace pgbckctl {
      */
     shm_worker_area *shm_mem_ptr = nullptr;
 
+    /**
+     * Slot allocation bitmap in shared memory, one bit per
+     * worker slot. A set bit means the slot is in use. Slots are
+     * claimed and released with atomic operations only, so
+     * allocate() and free() don't need the shared memory lock.
+     */
+    std::atomic<unsigned long long> *slot_map = nullptr;
+
+    /**
+     * Number of 64 bit words in slot_map.
+     */
+    unsigned int slot_map_words = 0;
+
+    /**
+     * Returns the worker slot at the specified index. Throws
+     * in case we aren't attached or the index is out of range.
+     */
+    shm_worker_area *slot(unsigned int slot_index);
+
+    /**
+     * Starts modifying the specified slot, waiting for
+     * a concurrent writer of the same slot to finish.
+     */
+    void beginSlotWrite(shm_worker_area *ptr);
+
+    /**
+     * Finishes a modification started with beginSlotWrite().
+     */
+    void endSlotWrite(shm_worker_area *ptr);
+
+    /**
+     * Clears the specified slot and releases it in the
+     * allocation bitmap, even if its former owner died while
+     * modifying it. Used by the reaper only.
+     */
+    void reclaim(unsigned int slot_index);
+
+    /**
+     * Catalog generation counter in shared memory.
+     */
+    shm_catalog_generation *generation_ptr = nullptr;
+
+    /**
+     * I/O governor token buckets in shared memory.
+     */
+    shm_io_governor *governor_ptr = nullptr;
+
+    /**
+     * Worker event logs in shared memory, one per slot.
+     */
+    shm_worker_event_log *event_log_ptr = nullptr;
+
     /**
      * Upper index for shm_mem_ptr. This is initialized
      * after allocating the shared memory area during
@@ -357,9 +620,8 @@ namespace pgbckctl {
 
     /**
      * Writes the specified items into the shared memory
-     * slot on the specified index. Caller should
-     * have locked the shared memory operation to protect
-     * against concurrent changes.
+     * slot on the specified index. Concurrent writers of the
+     * same slot are serialized by the slot sequence counter.
      *
      * Throws in case we aren't attached.
      *
@@ -372,9 +634,11 @@ namespace pgbckctl {
 
     /**
      * Allocates a new worker slot and writes
-     * the properties of item into the new slot.
+     * the properties of item into the new slot. The slot is
+     * claimed in the allocation bitmap with a CAS, so this
+     * doesn't need the shared memory lock.
      *
-     * Throws in case we aren't attached.
+     * Throws in case we aren't attached or no slot is free.
      *
      * allocate() is different from write(). The latter
      * doesn't try to get a free slot index and doesn't increase
@@ -384,9 +648,9 @@ namespace pgbckctl {
     virtual unsigned int allocate(shm_worker_area &item);
 
     /**
-     * Returns a copy of the specified worker area at
-     * the specified shared memory slot. Caller should have locked
-     * the shared memory against concurrent changes.
+     * Returns a consistent copy of the specified worker area at
+     * the specified shared memory slot. This never blocks writers,
+     * the copy is retried in case the slot changed meanwhile.
      *
      * Throws in case we aren't attached.
      */
@@ -401,7 +665,7 @@ namespace pgbckctl {
 
     /**
      * Resets the specified worker slot to represent a free
-     * slot. Also sets the last index being freed.
+     * slot and releases it in the allocation bitmap.
      */
     virtual void free(unsigned int slot_index);
 
@@ -419,7 +683,8 @@ namespace pgbckctl {
                                    pid_t child_pid);
 
     /**
-     * Resets all worker slots to be empty.
+     * Resets all worker slots to be empty. Must only be called
+     * if no workers are attached.
      *
      * Throws in case we aren't attached.
      */
@@ -432,8 +697,8 @@ namespace pgbckctl {
     virtual bool isEmpty(unsigned int slot_index);
 
     /**
-     * Returns a slot index usable by a new
-     * worker.
+     * Returns a slot index currently free. Note that the slot
+     * isn't claimed, use allocate() to get a slot for a new worker.
      */
     virtual unsigned int getFreeIndex();
 
@@ -449,6 +714,286 @@ namespace pgbckctl {
      */
     virtual void unlock();
 
+    /**
+     * Returns the current catalog generation. Throws
+     * in case the shared memory area is not attached.
+     */
+    virtual unsigned long long getCatalogGeneration();
+
+    /**
+     * Advances the catalog generation counter, invalidating
+     * all cached catalog snapshots. Returns the new generation.
+     * Throws in case the shared memory area is not attached.
+     */
+    virtual unsigned long long bumpCatalogGeneration();
+
+    /**
+     * Sets the budget of the specified I/O governor bucket in
+     * bytes per second, 0 means unlimited. Also refills the bucket.
+     * Throws in case the shared memory area is not attached.
+     */
+    virtual void setIOBudget(IOGovernorClass bucket,
+                             unsigned long long rate);
+
+    /**
+     * Returns the budget of the specified I/O governor bucket in
+     * bytes per second. Throws in case the shared memory area
+     * is not attached.
+     */
+    virtual unsigned long long getIOBudget(IOGovernorClass bucket);
+
+    /**
+     * Takes the specified number of bytes from an I/O governor
+     * bucket and returns the steady clock time in nanoseconds
+     * the caller has to wait until before it may write them. An
+     * unlimited bucket returns now.
+     *
+     * A bucket holds up to IOGovernor::BURST_NSEC worth of
+     * budget. If borrow is set, the bytes are taken regardless
+     * of the budget left and the bucket is overdrawn by up to
+     * IOGovernor::BURST_NSEC worth of budget, which delays all
+     * other callers.
+     *
+     * Doesn't need the shared memory lock. Throws in case the
+     * shared memory area is not attached.
+     */
+    virtual long long chargeIO(IOGovernorClass bucket,
+                               unsigned long long bytes,
+                               long long now,
+                               bool borrow);
+
+    /**
+     * Publishes MAX_WORKER_INSTRUMENTATION_SLOTS items into the
+     * instrumentation area of the specified slot. This doesn't
+     * lock the shared memory and should only be called by the
+     * worker owning the slot.
+     *
+     * Throws in case we aren't attached.
+     */
+    virtual void writeInstrumentation(unsigned int slot_index,
+                                      worker_instrumentation_item *items);
+
+    /**
+     * Copies the instrumentation area of the specified slot
+     * into items, which must have room for
+     * MAX_WORKER_INSTRUMENTATION_SLOTS entries. Doesn't need
+     * the shared memory lock either.
+     *
+     * Throws in case we aren't attached.
+     */
+    virtual void readInstrumentation(unsigned int slot_index,
+                                     worker_instrumentation_item *items);
+
+    /**
+     * Appends an event to the event log of the specified slot,
+     * overwriting the oldest record if the log is full. Takes no
+     * locks and doesn't allocate, so this can be called for every
+     * message a worker handles.
+     *
+     * Throws in case we aren't attached.
+     */
+    virtual void recordEvent(unsigned int slot_index,
+                             WorkerEventId event,
+                             long long arg0 = 0,
+                             long long arg1 = 0,
+                             long long arg2 = 0);
+
+    /**
+     * Returns a copy of the records in the event log of the
+     * specified slot, oldest first. Records overwritten while
+     * copying them are skipped. Doesn't need the shared
+     * memory lock either.
+     *
+     * Throws in case we aren't attached.
+     */
+    virtual std::vector<worker_event> readEvents(unsigned int slot_index);
+
+  };
+
+  /**
+   * Counts events or bytes and derives a per second
+   * rate from them, recalculated at most once a second.
+   */
+  class InstrumentationRate {
+  private:
+
+    unsigned long long count = 0;
+    unsigned long long last_count = 0;
+    long long per_sec = 0;
+    std::chrono::steady_clock::time_point last_tick;
+
+  public:
+
+    InstrumentationRate();
+
+    /**
+     * Adds n to the counter.
+     */
+    void add(unsigned long long n);
+
+    /**
+     * Recalculates the rate if at least one second has
+     * passed since the last recalculation. Returns true
+     * in this case.
+     */
+    bool tick();
+
+    /**
+     * Returns the rate as of the last tick().
+     */
+    long long rate();
+
+    /**
+     * Returns the counter.
+     */
+    unsigned long long total();
+
+    /**
+     * Resets counter and rate.
+     */
+    void reset();
+
+  };
+
+  /**
+   * Hot path instrumentation of a worker.
+   *
+   * A worker sets its items locally and publishes all of them
+   * at once into its worker shared memory slot, where SHOW WORKERS
+   * picks them up. Publishing takes no locks and doesn't touch
+   * the catalog, so it's cheap enough to be done for every
+   * message received.
+   */
+  class WorkerInstrumentation {
+  private:
+
+    std::shared_ptr<WorkerSHM> shm = nullptr;
+    unsigned int slot_index;
+
+    /**
+     * Local copy of the items, published by publish().
+     */
+    worker_instrumentation_item items[MAX_WORKER_INSTRUMENTATION_SLOTS];
+
+  public:
+
+    WorkerInstrumentation(std::shared_ptr<WorkerSHM> shm,
+                          unsigned int slot_index);
+    virtual ~WorkerInstrumentation();
+
+    /**
+     * Sets the item at the specified index. Nothing is
+     * visible to others before publish() is called.
+     */
+    virtual void set(unsigned int index,
+                     WorkerInstrumentationKey key,
+                     long long value);
+
+    /**
+     * Publishes all items into the worker shared memory slot.
+     */
+    virtual void publish();
+
+    /**
+     * Returns a readable name of the specified instrumentation key.
+     */
+    static std::string keyName(int key);
+
+    /**
+     * Returns the value of the specified item formatted
+     * according to its key, e.g. LSNs as XLOG positions.
+     */
+    static std::string valueString(worker_instrumentation_item &item);
+
+  };
+
+  /**
+   * Event log of a worker.
+   *
+   * Where a worker would log a debug message for every message
+   * it handles, it records an event with a few numeric arguments
+   * into the event log of its worker slot instead. Nothing is
+   * formatted before someone looks at the log with SHOW EVENTS, and
+   * since the log lives in the worker shared memory segment, it
+   * survives a crashed worker.
+   */
+  class WorkerEventLog {
+  private:
+
+    std::shared_ptr<WorkerSHM> shm = nullptr;
+    unsigned int slot_index;
+
+  public:
+
+    WorkerEventLog(std::shared_ptr<WorkerSHM> shm,
+                   unsigned int slot_index);
+    virtual ~WorkerEventLog();
+
+    /**
+     * Records the specified event.
+     */
+    virtual void record(WorkerEventId event,
+                        long long arg0 = 0,
+                        long long arg1 = 0,
+                        long long arg2 = 0);
+
+    /**
+     * Returns a readable name of the specified event.
+     */
+    static std::string eventName(int event);
+
+    /**
+     * Returns the arguments of the specified event formatted
+     * according to the event, e.g. LSNs as XLOG positions.
+     */
+    static std::string argsString(worker_event &event);
+
+  };
+
+  /**
+   * Host wide I/O governor.
+   *
+   * All workers of a launcher writing basebackups, WAL or
+   * restore data consult the governor before they write a chunk
+   * of data. Every job class has a token bucket of its own, plus
+   * there is a host wide bucket shared by all classes, see
+   * IOGovernorClass. The budgets are configured with the governor.*
+   * runtime variables when the launcher is started.
+   *
+   * WAL streaming has strict priority: a WAL streamer only waits
+   * for its own class budget. It takes its bytes from the host wide
+   * budget regardless of what is left, so basebackups and restores
+   * get what the WAL streamers leave over.
+   */
+  class IOGovernor {
+  private:
+
+    std::shared_ptr<WorkerSHM> shm = nullptr;
+    IOGovernorClass job_class;
+
+  public:
+
+    /**
+     * Maximum budget a bucket accumulates while idle,
+     * in nanoseconds worth of its rate.
+     */
+    static const long long BURST_NSEC = 1000000000LL;
+
+    IOGovernor(std::shared_ptr<WorkerSHM> shm,
+               IOGovernorClass job_class);
+    virtual ~IOGovernor();
+
+    /**
+     * Waits until the specified number of bytes may
+     * be written.
+     */
+    virtual void acquire(size_t bytes);
+
+    /**
+     * Returns the current steady clock time in nanoseconds.
+     */
+    static long long now();
+
   };
 
 }
@@ -0,0 +1,161 @@
+#ifndef __HAVE_WORKERPOLICY_HXX__
+#define __HAVE_WORKERPOLICY_HXX__
+
+#include <string>
+#include <vector>
+
+#include <common.hxx>
+#include <descr.hxx>
+
+namespace pgbckctl {
+
+  /**
+   * Errors in worker policy definitions are mapped
+   * to WorkerPolicyFailure exceptions.
+   */
+  class WorkerPolicyFailure : public CPGBackupCtlFailure {
+  public:
+    WorkerPolicyFailure(const char *errstr) throw() : CPGBackupCtlFailure(errstr) {};
+    WorkerPolicyFailure(std::string errstr) throw() : CPGBackupCtlFailure(errstr) {};
+  };
+
+  /**
+   * Job types a worker policy can be defined for. Every
+   * background command not covered by a specific type gets
+   * the WORKER_POLICY_DEFAULT policy.
+   */
+  typedef enum {
+
+    WORKER_POLICY_DEFAULT = 0,
+    WORKER_POLICY_WALSTREAMER,
+    WORKER_POLICY_BASEBACKUP,
+    WORKER_POLICY_RECOVERY
+
+  } WorkerPolicyType;
+
+#define WORKER_POLICY_TYPES (WORKER_POLICY_RECOVERY + 1)
+
+  /**
+   * I/O scheduling classes, values match the
+   * IOPRIO_CLASS_* definitions of the kernel.
+   */
+  typedef enum {
+
+    WORKER_IOPRIO_INHERIT = 0,
+    WORKER_IOPRIO_REALTIME,
+    WORKER_IOPRIO_BEST_EFFORT,
+    WORKER_IOPRIO_IDLE
+
+  } WorkerIOPrioClass;
+
+  /**
+   * Scheduling settings in effect for a worker, as
+   * published in its worker shared memory slot.
+   */
+  typedef struct {
+
+    int type = WORKER_POLICY_DEFAULT;
+
+    /* CPU list the worker may run on */
+    char cpus[64] = "";
+
+    /* NUMA nodes memory is bound to, empty if not bound */
+    char numa_nodes[32] = "";
+
+    int nice = 0;
+
+    int ioprio_class = WORKER_IOPRIO_INHERIT;
+    int ioprio_level = 0;
+
+  } worker_policy_info;
+
+  /**
+   * Scheduling policy of a worker job type.
+   *
+   * The policies are defined with the policy.<type>_* runtime
+   * variables and read when the launcher is started. A worker
+   * applies the policy of its job type right after it has parsed
+   * its command, before it executes anything. Every setting
+   * left empty is inherited from the launcher.
+   */
+  class WorkerPolicy {
+  public:
+
+    /**
+     * CPU list the worker is bound to, e.g. "0-3,8".
+     */
+    std::string cpus = "";
+
+    /**
+     * List of NUMA nodes the memory of the
+     * worker is bound to, e.g. "0".
+     */
+    std::string numa_nodes = "";
+
+    /**
+     * Nice level, -20 to 19.
+     */
+    std::string nice = "";
+
+    /**
+     * I/O scheduling class and its level, 0 to 7.
+     */
+    WorkerIOPrioClass ioprio_class = WORKER_IOPRIO_INHERIT;
+    int ioprio_level = 4;
+
+    /**
+     * Throws a WorkerPolicyFailure in case any of the
+     * settings is malformed.
+     */
+    virtual void validate();
+
+    /**
+     * Applies the policy to the calling process. Settings the
+     * kernel refuses (e.g. missing privileges for negative nice
+     * levels) are logged and skipped, so the worker continues to
+     * run with the settings it inherited instead.
+     *
+     * Returns the settings in effect afterwards.
+     */
+    virtual worker_policy_info apply(WorkerPolicyType type);
+
+    /**
+     * Returns the settings in effect for the calling process.
+     */
+    static worker_policy_info current(WorkerPolicyType type);
+
+    /**
+     * Returns the job type the specified command belongs to.
+     */
+    static WorkerPolicyType typeOf(CatalogTag tag);
+
+    /**
+     * Returns the name of the specified job type as used
+     * in the policy.<type>_* runtime variables.
+     */
+    static std::string typeName(int type);
+
+    /**
+     * String representations of I/O scheduling classes
+     * as used in the policy.<type>_ioprio_class runtime variables.
+     */
+    static std::string ioprioClassName(int ioprio_class);
+    static WorkerIOPrioClass stringToIOPrioClass(std::string name);
+
+    /**
+     * Parses a list like "0-3,8" into a vector of flags indexed
+     * by number. Throws a WorkerPolicyFailure in case the list is
+     * malformed or exceeds max.
+     */
+    static std::vector<bool> parseList(std::string list, unsigned int max);
+
+    /**
+     * Inverse of parseList().
+     */
+    static std::string listToString(std::vector<bool> &flags);
+
+  };
+
+}
+
+#endif
@@ -20,6 +20,8 @@ namespace pgbckctl {
   class BackupDirectory;
   class ArchiveLogDirectory;
   class TransactionLogBackup;
+  class WorkerInstrumentation;
+  class WorkerEventLog;
 
   class BaseCatalogCommand : public CatalogDescr {
   protected:
@@ -57,6 +59,27 @@ namespace pgbckctl {
      * on this instance.
      */
     virtual void copy(CatalogDescr& source);
+
+    /**
+     * Returns an instrumentation handle for the worker shared
+     * memory slot identified by worker_id. Returns a nullptr in
+     * case this command doesn't run as a background worker.
+     */
+    virtual std::shared_ptr<WorkerInstrumentation> workerInstrumentation();
+
+    /**
+     * Returns an event log handle for the worker shared memory
+     * slot identified by worker_id. Returns a nullptr in case this
+     * command doesn't run as a background worker.
+     */
+    virtual std::shared_ptr<WorkerEventLog> workerEventLog();
+
+    /**
+     * Returns an I/O governor handle for the specified job class.
+     * Returns a nullptr in case there is no launcher running
+     * for our catalog.
+     */
+    virtual std::shared_ptr<IOGovernor> ioGovernor(IOGovernorClass job_class);
   public:
     virtual void execute(bool existsOk) = 0;
 
@@ -96,6 +119,19 @@ namespace pgbckctl {
 
   };
 
+  class VerifyBasebackupCatalogCommand : public BaseCatalogCommand {
+  public:
+
+    VerifyBasebackupCatalogCommand();
+    VerifyBasebackupCatalogCommand(std::shared_ptr<CatalogDescr> descr);
+    VerifyBasebackupCatalogCommand(std::shared_ptr<BackupCatalog> catalog);
+
+    virtual ~VerifyBasebackupCatalogCommand();
+
+    virtual void execute(bool flag);
+
+  };
+
   class ShowVariableCatalogCommand : public BaseCatalogCommand {
   public:
     ShowVariableCatalogCommand(std::shared_ptr<CatalogDescr> descr);
@@ -200,6 +236,23 @@ namespace pgbckctl {
      */
     std::shared_ptr<BackupCleanupDescr> applyRulesAndRemoveBasebackups(std::shared_ptr<CatalogDescr> archiveDescr);
 
+    /*
+     * Returns the retention plan to execute. An unfinished plan
+     * persisted for the archive is resumed, otherwise the rules
+     * are applied and the resulting plan is persisted (unless
+     * in dry run mode). If nothing is to be done, the returned
+     * plan has an archive_id of -1.
+     */
+    std::shared_ptr<RetentionPlanDescr> prepareRetentionPlan(std::shared_ptr<CatalogDescr> archiveDescr,
+                                                             std::shared_ptr<ArchiveLogDirectory> archiveLogDir);
+
+    /*
+     * Prints the number of files and bytes the specified
+     * retention plan would free, without removing anything.
+     */
+    void printRetentionPlanCost(std::shared_ptr<RetentionPlanDescr> plan,
+                                std::shared_ptr<ArchiveLogDirectory> archiveLogDir);
+
   public:
 
     ApplyRetentionPolicyCommand(std::shared_ptr<CatalogDescr> descr);
@@ -464,6 +517,63 @@ namespace pgbckctl {
     virtual void execute(bool flag);
   };
 
+  /*
+   * Implements a START METRICS SERVER command handler.
+   */
+  class StartMetricsServerCommand : public BaseCatalogCommand {
+  private:
+  public:
+
+    StartMetricsServerCommand(std::shared_ptr<BackupCatalog> catalog);
+    StartMetricsServerCommand(std::shared_ptr<CatalogDescr> descr);
+    StartMetricsServerCommand();
+    virtual ~StartMetricsServerCommand();
+
+    virtual void execute(bool flag);
+  };
+
+  /*
+   * Implements the CREATE SCHEDULE command.
+   */
+  class CreateScheduleCommand : public BaseCatalogCommand {
+  public:
+
+    CreateScheduleCommand(std::shared_ptr<BackupCatalog> catalog);
+    CreateScheduleCommand(std::shared_ptr<CatalogDescr> descr);
+    CreateScheduleCommand();
+    virtual ~CreateScheduleCommand();
+
+    virtual void execute(bool flag);
+  };
+
+  /*
+   * Implements the DROP SCHEDULE command.
+   */
+  class DropScheduleCommand : public BaseCatalogCommand {
+  public:
+
+    DropScheduleCommand(std::shared_ptr<BackupCatalog> catalog);
+    DropScheduleCommand(std::shared_ptr<CatalogDescr> descr);
+    DropScheduleCommand();
+    virtual ~DropScheduleCommand();
+
+    virtual void execute(bool flag);
+  };
+
+  /*
+   * Implements the LIST SCHEDULES command.
+   */
+  class ListSchedulesCommand : public BaseCatalogCommand {
+  public:
+
+    ListSchedulesCommand(std::shared_ptr<BackupCatalog> catalog);
+    ListSchedulesCommand(std::shared_ptr<CatalogDescr> descr);
+    ListSchedulesCommand();
+    virtual ~ListSchedulesCommand();
+
+    virtual void execute(bool flag);
+  };
+
   /*
    * Implements a START STREAMING FOR ARCHIVE command handler.
    */
@@ -537,6 +647,20 @@ namespace pgbckctl {
     virtual void execute(bool noop);
   };
 
+  /**
+   * Implements the SHOW EVENTS command.
+   */
+  class ShowEventsCommandHandle : public BaseCatalogCommand {
+  public:
+    ShowEventsCommandHandle(std::shared_ptr<BackupCatalog> catalog);
+    ShowEventsCommandHandle(std::shared_ptr<CatalogDescr> descr);
+    ShowEventsCommandHandle();
+
+    virtual ~ShowEventsCommandHandle();
+
+    virtual void execute(bool noop);
+  };
+
   /**
    * Implements the STOP STREAMING FOR ARCHIVE command.
    *
@@ -259,8 +259,14 @@ namespace pgbckctl {
       std::shared_ptr<CatalogDescr> archive_descr = nullptr;
 
       /**
-       * Helper routine, queries the backup catalog for a list
-       * of valid basebackups.
+       * Catalog snapshot the list of basebackups is read from,
+       * initialized by execute().
+       */
+      std::shared_ptr<PGProtoCatalogSnapshot> snapshot = nullptr;
+
+      /**
+       * Helper routine, gets the list of basebackups from
+       * the catalog snapshot.
        *
        * This routine prepares a complete PGProtoResultSet suitable
        * to be sent over the wire.
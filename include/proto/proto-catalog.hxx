@@ -10,6 +10,101 @@
 
 namespace pgbckctl {
 
+  /**
+   * A read-mostly, in-memory copy of the catalog data a
+   * streaming server needs to answer client requests for
+   * a specific archive: the archive descriptor and its list of
+   * basebackups, including their tablespaces.
+   *
+   * The snapshot is built by the listener process before it
+   * forks connection childs, so they inherit it copy-on-write
+   * and don't need to query the catalog database for each
+   * connection. Every snapshot carries the catalog generation
+   * from the worker shared memory it was built with. A snapshot
+   * is considered stale as soon as the generation counter in
+   * shared memory moves forward.
+   */
+  class PGProtoCatalogSnapshot {
+  private:
+
+    /**
+     * Catalog generation this snapshot was built from.
+     */
+    unsigned long long generation = 0;
+
+    /**
+     * Archive ID, -1 if the snapshot wasn't built yet.
+     */
+    int archive_id = -1;
+
+    /**
+     * Archive descriptor.
+     */
+    std::shared_ptr<CatalogDescr> archive = nullptr;
+
+    /**
+     * List of basebackups belonging to the archive, newest
+     * first (as returned by BackupCatalog::getBackupList()).
+     */
+    std::vector<std::shared_ptr<BaseBackupDescr>> basebackups;
+
+  public:
+
+    PGProtoCatalogSnapshot();
+    virtual ~PGProtoCatalogSnapshot();
+
+    /**
+     * (Re-)Builds the snapshot for the specified archive
+     * from the given catalog handle. generation is the
+     * current catalog generation from the worker shared memory.
+     *
+     * Throws a CCatalogIssue in case the archive does not exist.
+     */
+    virtual void build(BackupCatalog &catalog,
+                       int archive_id,
+                       unsigned long long generation);
+
+    /**
+     * Returns true if the snapshot was built for the specified
+     * archive and still matches the specified catalog generation.
+     */
+    virtual bool isValid(int archive_id,
+                         unsigned long long generation);
+
+    /**
+     * Returns the catalog generation the snapshot was built from.
+     */
+    virtual unsigned long long getGeneration();
+
+    /**
+     * Returns the archive descriptor.
+     */
+    virtual std::shared_ptr<CatalogDescr> getArchive();
+
+    /**
+     * Returns the list of basebackups in this snapshot.
+     */
+    virtual std::vector<std::shared_ptr<BaseBackupDescr>> getBackupList();
+
+    /**
+     * Returns the newest or oldest basebackup, following the
+     * semantics of BackupCatalog::getBaseBackup(). If valid_only is
+     * true, only basebackups in state "ready" are considered.
+     *
+     * The returned descriptor has an ID of -1 if nothing was found.
+     */
+    virtual std::shared_ptr<BaseBackupDescr> getBaseBackup(BaseBackupRetrieveMode mode,
+                                                           bool valid_only);
+
+    /**
+     * Returns the basebackup identified by the specified
+     * full qualified filename. The returned descriptor has an ID of -1
+     * if nothing was found.
+     */
+    virtual std::shared_ptr<BaseBackupDescr> getBaseBackup(std::string basebackup_fqfn);
+
+  };
+
   /**
    * A catalog handler instance encapsulates various
    * actions performed by PostgreSQL streaming API commands.
@@ -32,6 +127,12 @@ namespace pgbckctl {
      */
     std::shared_ptr<BaseBackupDescr> attached_basebackup = nullptr;
 
+    /**
+     * Catalog snapshot of the archive served by this
+     * handler, see PGProtoCatalogSnapshot for details.
+     */
+    std::shared_ptr<PGProtoCatalogSnapshot> snapshot = nullptr;
+
     /**
      * Stored worker ID. This is the ID identifying
      * a potential background worker instance using this
@@ -45,6 +146,11 @@ namespace pgbckctl {
      */
     int child_id = -1;
 
+    /**
+     * Worker shared memory handle, as passed to attach().
+     */
+    std::shared_ptr<WorkerSHM> worker_shm = nullptr;
+
   public:
 
     PGProtoCatalogHandler(std::string catalog_name,
@@ -81,6 +187,18 @@ namespace pgbckctl {
                                                     int &child_id,
                                                     std::shared_ptr<WorkerSHM> shm);
 
+    /**
+     * Returns the catalog snapshot for the specified archive. If
+     * there is no snapshot yet or the catalog generation in the
+     * specified worker shared memory has moved forward, the snapshot
+     * is rebuilt from the catalog database first.
+     *
+     * If shm is not attached, the snapshot is rebuilt
+     * unconditionally.
+     */
+    virtual std::shared_ptr<PGProtoCatalogSnapshot> getSnapshot(int archive_id,
+                                                                std::shared_ptr<WorkerSHM> shm);
+
     /**
      * Returns "true" in case a PGProtoCatalogHandler is attached
      * to a basebackup via attach().
@@ -1,6 +1,10 @@
 #include <common.hxx>
 #include <backup.hxx>
+#include <fs-tar.hxx>
+#include <pagechecksum.hxx>
+#include <resume.hxx>
 #include <boost/log/trivial.hpp>
+#include <chrono>
 
 using namespace pgbckctl;
 
@@ -179,6 +183,7 @@ XLogRecPtr TransactionLogBackup::write(XLOGDataStreamMessage *message,
      */
     item->fileHandle->write(databuf + message_written,
                             bw);
+    item->checksum->update(databuf + message_written, bw);
 
     /*
      * Mark them being unsynced
@@ -201,6 +206,19 @@ XLogRecPtr TransactionLogBackup::write(XLOGDataStreamMessage *message,
      */
     if (PGStream::XLOGOffset(position, this->wal_segment_size) == 0) {
 
+      std::chrono::steady_clock::time_point sync_start = std::chrono::steady_clock::now();
+      std::shared_ptr<WALSegmentDescr> segment = std::make_shared<WALSegmentDescr>();
+
+      /*
+       * The segment file is always written from its start, so
+       * its checksum covers the whole segment.
+       */
+      segment->name = change_extension(path(item->filename), "").string();
+      segment->timeline = timeline;
+      segment->size = this->wal_segment_size;
+      segment->checksum_algorithm = item->checksum->getAlgorithm();
+      segment->checksum = item->checksum->final();
+
       this->finalizeCurrentWALFile(true);
 
       /*
@@ -213,6 +231,9 @@ XLogRecPtr TransactionLogBackup::write(XLOGDataStreamMessage *message,
        */
       this->finalize();
 
+      this->last_sync_usec = std::chrono::duration_cast<std::chrono::microseconds>
+        (std::chrono::steady_clock::now() - sync_start).count();
+
 #ifdef __DEBUG_XLOG__
       BOOST_LOG_TRIVIAL(debug) << "DEBUG: finalize XLOG segment at offset "
                                << PGStream::encodeXLOGPos(position);
@@ -227,6 +248,7 @@ XLogRecPtr TransactionLogBackup::write(XLOGDataStreamMessage *message,
        * Count synced WAL file.
        */
       this->wal_synced++;
+      this->completed.push_back(segment);
 
       /*
        * Flag current item handler to be empty,
@@ -252,6 +274,21 @@ uint64_t TransactionLogBackup::countSynced() {
 
 }
 
+long long TransactionLogBackup::lastSyncDuration() {
+
+  return this->last_sync_usec;
+
+}
+
+std::vector<std::shared_ptr<WALSegmentDescr>> TransactionLogBackup::completedSegments() {
+
+  std::vector<std::shared_ptr<WALSegmentDescr>> result;
+
+  result.swap(this->completed);
+  return result;
+
+}
+
 std::string TransactionLogBackup::walfilename(unsigned int timeline,
                                               XLogRecPtr position) {
 
@@ -470,6 +507,7 @@ std::shared_ptr<BackupFile> TransactionLogBackup::stackFile(std::string name) {
   logref->filename = name;
   logref->sync_pending = true;
   logref->flush_pending = true;
+  logref->checksum = BackupChecksum::get(STREAM_CHECKSUM_ALGORITHM);
 
   this->fileList.push_back(logref);
   return this->file;
@@ -503,12 +541,38 @@ BackupProfileCompressType StreamBaseBackup::getCompression() {
   return this->compression;
 }
 
+void StreamBaseBackup::setDeduplication(bool deduplicate) {
+  this->deduplicate = deduplicate;
+}
+
+bool StreamBaseBackup::getDeduplication() {
+  return this->deduplicate;
+}
+
+void StreamBaseBackup::setPageVerification(std::shared_ptr<PageChecksumReport> report) {
+  this->page_report = report;
+}
+
+std::shared_ptr<PageChecksumReport> StreamBaseBackup::getPageVerification() {
+  return this->page_report;
+}
+
+void StreamBaseBackup::setResume(std::shared_ptr<BaseBackupResume> resume) {
+  this->resume = resume;
+}
+
+std::shared_ptr<BaseBackupResume> StreamBaseBackup::getResume() {
+  return this->resume;
+}
+
 StreamBaseBackup::~StreamBaseBackup() {
 
-  if (this->isInitialized()) {
+  if (this->isInitialized())
     this->finalize();
+
+  /* finalize() might have been called by the owner already */
+  if (this->directory != nullptr)
     delete this->directory;
-  }
 
 };
 
@@ -580,8 +644,36 @@ void StreamBaseBackup::finalize() {
      * Sync file handles and their contents.
      */
     for(auto& item : this->fileList) {
+
+      /* archives of finished tablespaces are closed already */
+      if (!item->isOpen())
+        continue;
+
       item->fsync();
       item->close();
+
+    }
+
+    /*
+     * tar doesn't create sparse files when extracting plain
+     * basebackups, so zero blocks are deallocated afterwards.
+     */
+    if (this->compression == BACKUP_COMPRESS_TYPE_PLAIN) {
+
+      try {
+
+        unsigned long long holes
+          = ((StreamingBaseBackupDirectory *)this->directory)->punchHoles();
+
+        BOOST_LOG_TRIVIAL(debug) << "deallocated " << holes
+                                 << " bytes of zero blocks in plain basebackup";
+
+      } catch (CArchiveIssue &e) {
+        /* not fatal, the files are complete anyway */
+        BOOST_LOG_TRIVIAL(warning) << "could not make plain basebackup sparse: "
+                                   << e.what();
+      }
+
     }
 
     /*
@@ -630,11 +722,45 @@ std::shared_ptr<BackupFile> StreamBaseBackup::stackFile(std::string name) {
     throw CArchiveIssue("cannot create stream backup files: not initialized");
   }
 
+  bool tar = (name.length() > 4
+              && name.compare(name.length() - 4, 4, ".tar") == 0);
+
   /*
    * Allocate a new basebackup file. This will overwrite
-   * the last used file reference.
+   * the last used file reference. Only tar archives are
+   * deduplicated, never the manifest.
+   */
+  this->file = ((StreamingBaseBackupDirectory *)this->directory)->basebackup(name,
+                                                                            this->compression,
+                                                                            tar && this->deduplicate);
+
+  /*
+   * Page checksums are verified on the uncompressed tar stream,
+   * server compressed archives don't end with .tar.
+   */
+  if (this->page_report != nullptr && tar) {
+    this->file = std::make_shared<PageVerifyingFile>(this->file, this->page_report);
+  }
+
+  /*
+   * Tar archives we compress ourselves get a member index. Server
+   * compressed archives and plain backups extracted by tar can't
+   * be indexed, the former have a compression suffix already.
    */
-  this->file = this->directory->basebackup(name, this->compression);
+  if (this->compression != BACKUP_COMPRESS_TYPE_PLAIN && tar) {
+    this->file = std::make_shared<TarIndexingFile>(this->file);
+  }
+
+  /*
+   * A resumed basebackup materializes incremental files before
+   * anything else sees them, the manifest lists them afterwards.
+   */
+  if (this->resume != nullptr && tar) {
+    this->file = std::make_shared<ResumingFile>(this->file, this->resume, name);
+  } else if (this->resume != nullptr && name == RESUME_MANIFEST_FILE) {
+    this->file = std::make_shared<ResumedManifestFile>(this->file, this->resume);
+  }
+
   this->file->setOpenMode("wb");
   this->file->open();
 
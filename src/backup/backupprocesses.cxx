@@ -1,10 +1,12 @@
 #include <stream.hxx>
 #include <backup.hxx>
 #include <backupprocesses.hxx>
+#include <resume.hxx>
 #include <xlogdefs.hxx>
 #include <proto-buffer.hxx>
 #include <boost/log/trivial.hpp>
 
+#include <algorithm>
 #include <stack>
 
 /* Required for select() */
@@ -139,6 +141,13 @@ ArchiverState WALStreamerProcess::sendStatusUpdate() {
 
   ReceiverStatusUpdateMessage rsum(this->pgconn);
 
+  if (this->events != nullptr) {
+    this->events->record(EVT_WAL_STATUS_UPDATE,
+                         this->streamident.write_position,
+                         this->streamident.flush_position,
+                         this->streamident.apply_position);
+  }
+
 #ifdef __DEBUG_XLOG__
   BOOST_LOG_TRIVIAL(debug) << " ... sending status update to primary ";
   BOOST_LOG_TRIVIAL(debug) << "     -> write position: "
@@ -275,6 +284,61 @@ void WALStreamerProcess::setBackupHandler(std::shared_ptr<TransactionLogBackup>
 
 }
 
+void WALStreamerProcess::setCatalog(std::shared_ptr<BackupCatalog> catalog) {
+
+  this->catalog = catalog;
+
+}
+
+void WALStreamerProcess::setInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) {
+
+  this->instr = instr;
+
+}
+
+void WALStreamerProcess::setIOGovernor(std::shared_ptr<IOGovernor> governor) {
+
+  this->governor = governor;
+
+}
+
+void WALStreamerProcess::setEventLog(std::shared_ptr<WorkerEventLog> events) {
+
+  this->events = events;
+
+}
+
+void WALStreamerProcess::instrument(XLOGDataStreamMessage *datamsg) {
+
+  if (this->instr == nullptr)
+    return;
+
+  this->instr_bytes.add(datamsg->dataBufferSize());
+  this->instr_msgs.add(1);
+
+  /*
+   * Rates are recalculated once a second only, both
+   * counters are advanced together.
+   */
+  if (this->instr_bytes.tick()) {
+    this->instr_msgs.tick();
+  }
+
+  this->instr->set(0, INSTR_WAL_RECEIVED_LSN,
+                   datamsg->getXLOGStartPos() + datamsg->dataBufferSize());
+  this->instr->set(1, INSTR_WAL_FLUSHED_LSN,
+                   this->streamident.last_reported_flush_position);
+  this->instr->set(2, INSTR_WAL_BYTES_PER_SEC, this->instr_bytes.rate());
+  this->instr->set(3, INSTR_WAL_MSGS_PER_SEC, this->instr_msgs.rate());
+
+  if (this->backupHandler != nullptr) {
+    this->instr->set(4, INSTR_WAL_FSYNC_USEC, this->backupHandler->lastSyncDuration());
+  }
+
+  this->instr->publish();
+
+}
+
 void WALStreamerProcess::handleMessage(XLOGStreamMessage *message) {
 
   char msgType;
@@ -312,6 +376,13 @@ void WALStreamerProcess::handleMessage(XLOGStreamMessage *message) {
 #endif
       this->streamident.server_position = serverpos;
 
+      if (this->events != nullptr) {
+        this->events->record(EVT_WAL_DATA,
+                             datamsg->getXLOGStartPos(),
+                             datamsg->dataBufferSize(),
+                             serverpos);
+      }
+
       /*
        * Update XLOG write position and, if flushed, also
        * the flush position.
@@ -342,6 +413,9 @@ void WALStreamerProcess::handleMessage(XLOGStreamMessage *message) {
          * the backuphandler write() method will set an InvalidXLogRecPtr!
          */
 
+        if (this->governor != nullptr)
+          this->governor->acquire(datamsg->dataBufferSize());
+
         this->streamident.write_position
           = this->backupHandler->write(datamsg,
                                        this->streamident.flush_position,
@@ -352,6 +426,36 @@ void WALStreamerProcess::handleMessage(XLOGStreamMessage *message) {
           this->streamident.last_reported_flush_position
             = this->streamident.flush_position;
 
+          if (this->events != nullptr) {
+            this->events->record(EVT_WAL_SEGMENT_DONE,
+                                 this->streamident.flush_position,
+                                 this->streamident.timeline);
+          }
+
+          /*
+           * A valid flush position means we've just completed
+           * a WAL segment, so account it in the archive statistics
+           * and remember its checksum.
+           */
+          std::vector<std::shared_ptr<WALSegmentDescr>> segments
+            = this->backupHandler->completedSegments();
+
+          if (this->catalog != nullptr) {
+
+            this->catalog->startTransaction();
+            this->catalog->updateArchiveWALStat(this->streamident.archive_id,
+                                                1,
+                                                this->streamident.wal_segment_size);
+
+            for (auto &segment : segments) {
+              segment->archive_id = this->streamident.archive_id;
+              this->catalog->registerWALSegment(segment);
+            }
+
+            this->catalog->commitTransaction();
+
+          }
+
         }
 
 #ifdef __DEBUG_XLOG__
@@ -367,6 +471,8 @@ void WALStreamerProcess::handleMessage(XLOGStreamMessage *message) {
 
       }
 
+      this->instrument(datamsg);
+
       break;
     }
 
@@ -374,6 +480,10 @@ void WALStreamerProcess::handleMessage(XLOGStreamMessage *message) {
     {
       PrimaryFeedbackMessage *pm = dynamic_cast<PrimaryFeedbackMessage *>(message);
 
+      if (this->events != nullptr) {
+        this->events->record(EVT_WAL_KEEPALIVE, pm->responseRequested() ? 1 : 0);
+      }
+
 #ifdef __DEBUG_XLOG__
       BOOST_LOG_TRIVIAL(debug) << "primary feedback message";
 #endif
@@ -640,6 +750,13 @@ bool WALStreamerProcess::receive() {
 
   }
 
+  if (this->events != nullptr) {
+    this->events->record(EVT_WAL_STREAM_END,
+                         this->current_state,
+                         this->streamident.write_position,
+                         this->streamident.timeline);
+  }
+
   return can_continue;
 }
 
@@ -928,6 +1045,12 @@ void WALStreamerProcess::start() {
   this->current_state = ARCHIVER_STREAMING;
   this->streamident.status = StreamIdentification::STREAM_PROGRESS_STREAMING;
 
+  if (this->events != nullptr) {
+    this->events->record(EVT_WAL_STREAM_START,
+                         PGStream::decodeXLOGPos(this->streamident.xlogpos),
+                         this->streamident.timeline);
+  }
+
 }
 
 /* ****************************************************************************
@@ -1159,7 +1282,7 @@ void TablespaceStreamer::tablespace(std::shared_ptr<BackupElemDescr> &descr) {
       char zerochunk[1024];
       memset(zerochunk, 0, sizeof(zerochunk));
 
-      this->stepInfo.file->write(zerochunk, sizeof(zerochunk));
+      this->writeStep(zerochunk, sizeof(zerochunk));
       PQfreemem(copybuf);
       break;
     }
@@ -1171,7 +1294,8 @@ void TablespaceStreamer::tablespace(std::shared_ptr<BackupElemDescr> &descr) {
      *       since we go through the next loop where PQfreemem()
      *       will do this when necessary.
      */
-    this->stepInfo.file->write(copybuf, rc);
+    this->writeStep(copybuf, rc);
+    this->instrument(rc);
 
     /*
      * Check if we are requested to stop.
@@ -1184,14 +1308,19 @@ void TablespaceStreamer::tablespace(std::shared_ptr<BackupElemDescr> &descr) {
     }
   }
 
+  /* Everything of this tablespace must be on disk before we proceed */
+  this->flushStep();
+
   /*
    * Mark this tablespace as ready, but only in case we weren't
    * interrupted.
    */
-  if (!interrupted)
+  if (!interrupted) {
+    this->checksumStep();
     this->current_state = BASEBACKUP_STEP_TABLESPACE;
-  else
+  } else {
     this->current_state = BASEBACKUP_STEP_TABLESPACE_INTERRUPTED;
+  }
 
 }
 
@@ -1244,6 +1373,7 @@ bool TablespaceStreamer::next(std::shared_ptr<BackupElemDescr> &next) {
    */
   this->stepInfo.file = backupHandle->stackFile(CPGBackupCtlBase::intToStr(descr->spcoid)
                                                 + ".tar");
+  this->instrumentStep();
 
   if (descr->spclocation == "")
     this->current_state = BASEBACKUP_STEP_TABLESPACE_BASE;
@@ -1274,6 +1404,152 @@ void TablespaceIterator::incr() {
   this->stepInfo.current_step++;
 }
 
+void TablespaceIterator::setInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) {
+  this->instr = instr;
+}
+
+void TablespaceIterator::instrumentStep() {
+
+  if (this->instr == nullptr)
+    return;
+
+  this->instr_tablespace_bytes = 0;
+
+  if (this->stepInfo.descr != nullptr)
+    this->instr->set(0, INSTR_BASEBACKUP_TABLESPACE_OID, this->stepInfo.descr->spcoid);
+
+  this->instr->set(1, INSTR_BASEBACKUP_TABLESPACE_BYTES, 0);
+  this->instr->set(3, INSTR_BASEBACKUP_COMPRESSION_RATIO, 100);
+  this->instr->publish();
+
+}
+
+void TablespaceIterator::setIOGovernor(std::shared_ptr<IOGovernor> governor) {
+
+  this->governor = governor;
+
+  if (this->pipeline != nullptr)
+    this->pipeline->setIOGovernor(governor);
+
+}
+
+void TablespaceIterator::setWritePipeline(std::shared_ptr<BackupWritePipeline> pipeline) {
+
+  this->pipeline = pipeline;
+
+  if (this->pipeline != nullptr)
+    this->pipeline->setIOGovernor(this->governor);
+
+}
+
+void TablespaceIterator::writeStep(const char *data, size_t len) {
+
+  /*
+   * The checksum is computed here in the receiving thread, so that
+   * the data is hashed while it's still hot in the cache.
+   */
+  if (this->stepInfo.checksum == nullptr)
+    this->stepInfo.checksum = BackupChecksum::get(STREAM_CHECKSUM_ALGORITHM);
+
+  this->stepInfo.checksum->update(data, len);
+
+  /* The writer of the pipeline consults the governor itself */
+  if (this->pipeline != nullptr) {
+    this->pipeline->write(this->stepInfo.file, data, len);
+    return;
+  }
+
+  this->throttle(len);
+  this->stepInfo.file->write(data, len);
+
+}
+
+void TablespaceIterator::flushStep() {
+
+  if (this->pipeline != nullptr)
+    this->pipeline->flush();
+
+}
+
+void TablespaceIterator::checksumStep() {
+
+  if (this->stepInfo.checksum == nullptr || this->stepInfo.descr == nullptr)
+    return;
+
+  std::shared_ptr<ResumingFile> resuming = std::dynamic_pointer_cast<ResumingFile>(this->stepInfo.file);
+
+  this->stepInfo.descr->checksum_algorithm = this->stepInfo.checksum->getAlgorithm();
+  this->stepInfo.descr->checksum = this->stepInfo.checksum->final();
+  this->stepInfo.checksum = nullptr;
+
+  /*
+   * A resumed archive differs from the stream received, if files
+   * were materialized. Its checksum must describe the archive as
+   * stored, which is known once the writer is done with it.
+   */
+  if (resuming != nullptr) {
+    this->flushStep();
+    this->stepInfo.descr->checksum = resuming->checksum();
+  }
+
+}
+
+void TablespaceIterator::throttle(size_t bytes) {
+
+  if (this->governor != nullptr)
+    this->governor->acquire(bytes);
+
+}
+
+void TablespaceIterator::instrument(size_t bytes) {
+
+  if (this->instr == nullptr)
+    return;
+
+  this->instr_tablespace_bytes += bytes;
+  this->instr_bytes.add(bytes);
+
+  /*
+   * The compression ratio needs the size of the file on disk,
+   * so only check it when the throughput is recalculated, too.
+   */
+  if (this->instr_bytes.tick()) {
+
+    this->instr->set(2, INSTR_BASEBACKUP_BYTES_PER_SEC, this->instr_bytes.rate());
+
+    /*
+     * A growing receiver stall means writing is the bottleneck,
+     * a growing writer idle time means receiving is.
+     */
+    if (this->pipeline != nullptr) {
+      this->instr->set(4, INSTR_BASEBACKUP_WRITE_QUEUE_DEPTH, this->pipeline->depth());
+      this->instr->set(5, INSTR_BASEBACKUP_RECEIVER_STALL_MSEC, this->pipeline->receiverStallMsec());
+      this->instr->set(6, INSTR_BASEBACKUP_WRITER_IDLE_MSEC, this->pipeline->writerIdleMsec());
+    }
+
+    if (this->stepInfo.file != nullptr && this->stepInfo.file->isCompressed()) {
+
+      try {
+
+        size_t ondisk = this->stepInfo.file->size();
+
+        if (ondisk > 0)
+          this->instr->set(3, INSTR_BASEBACKUP_COMPRESSION_RATIO,
+                           (long long) (this->instr_tablespace_bytes * 100 / ondisk));
+
+      } catch (std::exception &e) {
+        /* not fatal, keep the former ratio */
+      }
+
+    }
+
+  }
+
+  this->instr->set(1, INSTR_BASEBACKUP_TABLESPACE_BYTES, this->instr_tablespace_bytes);
+  this->instr->publish();
+
+}
+
 /******************************************************************************
  * Implementation of MessageStreamer
  ******************************************************************************/
@@ -1286,6 +1562,12 @@ MessageStreamer::MessageStreamer(std::shared_ptr<StreamBaseBackup> sb,
 
 }
 
+void MessageStreamer::setServerCompression(BackupProfileCompressType compression) {
+
+  server_compression = compression;
+
+}
+
 void MessageStreamer::data(std::shared_ptr<BaseBackupMessage> &msg) {
 
   /*
@@ -1301,10 +1583,15 @@ void MessageStreamer::data(std::shared_ptr<BaseBackupMessage> &msg) {
 
   /*
    * This message should contain data for either manifest
-   * or archive. We don't care here about its type at the moment, so
-   * just write out its contents
+   * or archive. Archive data is governed and instrumented, the
+   * manifest is small and written directly.
    */
-  stepInfo.file->write(msg->data(), msg->dataSize());
+  if (current_state == BASEBACKUP_TABLESPACE_STREAM) {
+    this->writeStep(msg->data(), msg->dataSize());
+    this->instrument(msg->dataSize());
+  } else {
+    stepInfo.file->write(msg->data(), msg->dataSize());
+  }
 
 }
 
@@ -1339,6 +1626,7 @@ bool MessageStreamer::next(std::shared_ptr<BackupElemDescr> &next) {
     char *copy_buffer                      = nullptr;
 
     if (stopHandlerWantsExit()) {
+      this->flushStep();
       current_state = BASEBACKUP_STEP_TABLESPACE_INTERRUPTED;
       result = false;
       break;
@@ -1363,6 +1651,10 @@ bool MessageStreamer::next(std::shared_ptr<BackupElemDescr> &next) {
     if (rc == -1) {
       PQfreemem(copy_buffer);
 
+      /* Make sure all archives are written before they get finalized */
+      this->flushStep();
+      this->checksumStep();
+
       /* We're done here, nothing more expected */
       current_state = BASEBACKUP_EOB;
       result = false;
@@ -1415,11 +1707,29 @@ bool MessageStreamer::next(std::shared_ptr<BackupElemDescr> &next) {
 
         BOOST_LOG_TRIVIAL(debug) << "processing archive " << archive_name;
 
+        /*
+         * A server compressed archive is stored as is, make sure
+         * its name tells about the compression. The server usually
+         * sends the suffix already.
+         */
+        if (server_compression != BACKUP_COMPRESS_TYPE_NONE) {
+
+          string suffix = BackupProfileDescr::serverCompressionSuffix(server_compression);
+
+          if (archive_name.length() < suffix.length()
+              || archive_name.compare(archive_name.length() - suffix.length(),
+                                      suffix.length(), suffix) != 0)
+            archive_name += suffix;
+
+        }
+
         /*
          * If there is already a handle, finalize it.
          */
         if (stepInfo.file != nullptr) {
 
+          this->flushStep();
+          this->checksumStep();
           stepInfo.file->fsync();
           stepInfo.file->close();
           stepInfo.reset();
@@ -1453,6 +1763,7 @@ bool MessageStreamer::next(std::shared_ptr<BackupElemDescr> &next) {
          * next file for streaming data.
          */
         stepInfo.file = backupHandle->stackFile(archive_name);
+        this->instrumentStep();
 
         /*
          * After having BBMSG_TYPE_ARCHIVE_START received, the next expected
@@ -1478,10 +1789,17 @@ bool MessageStreamer::next(std::shared_ptr<BackupElemDescr> &next) {
          */
         current_state = BASEBACKUP_MANIFEST_STREAM;
 
+        /* The last archive is complete */
+        this->checksumStep();
+
         /* Save compression used for the archive data */
         BackupProfileCompressType former_compression = backupHandle->getCompression();
 
-        /* Get a new uncompressed handle for manifest data */
+        /*
+         * Get a new uncompressed handle for manifest data. An incremental
+         * basebackup uploads it again as is.
+         */
+        backupHandle->setCompression(BACKUP_COMPRESS_TYPE_NONE);
         stepInfo.file = backupHandle->stackFile(archive_name);
 
         /* Make sure we set compression level back, whatever it was before */
@@ -1588,8 +1906,11 @@ BaseBackupStream::makeStreamInstance(PGconn *prepared_conn,
   } else if ((PQserverVersion(prepared_conn) >= 130000)
       && (PQserverVersion(prepared_conn) < 150000)) {
     return std::make_shared<BaseBackupStream14>(prepared_conn, backupHandle, profileDescr);
-  } else if (PQserverVersion(prepared_conn) >= 150000) {
+  } else if ((PQserverVersion(prepared_conn) >= 150000)
+      && (PQserverVersion(prepared_conn) < 170000)) {
     return std::make_shared<BaseBackupStream15>(prepared_conn, backupHandle, profileDescr);
+  } else if (PQserverVersion(prepared_conn) >= 170000) {
+    return std::make_shared<BaseBackupStream17>(prepared_conn, backupHandle, profileDescr);
   } else {
     std::ostringstream oss;
 
@@ -1600,6 +1921,16 @@ BaseBackupStream::makeStreamInstance(PGconn *prepared_conn,
 
 }
 
+void BaseBackupStream::uploadManifest(std::string const& manifest) {
+
+  std::ostringstream oss;
+
+  oss << "incremental basebackups require PostgreSQL 17 or newer, server version is "
+      << PQserverVersion(this->pgconn);
+  throw StreamingFailure(oss.str());
+
+}
+
 /******************************************************************************
  * Implementation of BaseBackupStream12
  ******************************************************************************/
@@ -1719,6 +2050,24 @@ std::string BaseBackupStream12::query(std::shared_ptr<BackupProfileDescr> profil
 
 }
 
+void BaseBackupStream12::assignInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) {
+
+  setInstrumentation(instr);
+
+}
+
+void BaseBackupStream12::assignWritePipeline(std::shared_ptr<BackupWritePipeline> pipeline) {
+
+  setWritePipeline(pipeline);
+
+}
+
+void BaseBackupStream12::assignIOGovernor(std::shared_ptr<IOGovernor> governor) {
+
+  setIOGovernor(governor);
+
+}
+
 std::shared_ptr<BackupElemDescr>
 BaseBackupStream12::handleMessage(BaseBackupState &current_state) {
 
@@ -1885,6 +2234,24 @@ std::string BaseBackupStream14::query(std::shared_ptr<BackupProfileDescr> profil
 
 }
 
+void BaseBackupStream14::assignInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) {
+
+  setInstrumentation(instr);
+
+}
+
+void BaseBackupStream14::assignWritePipeline(std::shared_ptr<BackupWritePipeline> pipeline) {
+
+  setWritePipeline(pipeline);
+
+}
+
+void BaseBackupStream14::assignIOGovernor(std::shared_ptr<IOGovernor> governor) {
+
+  setIOGovernor(governor);
+
+}
+
 std::shared_ptr<BackupElemDescr>
 BaseBackupStream14::handleMessage(BaseBackupState &current_state) {
 
@@ -1926,7 +2293,12 @@ BaseBackupStream15::BaseBackupStream15(PGconn *prepared_conn,
                                        std::shared_ptr<StreamBaseBackup> backupHandle,
                                        std::shared_ptr<BackupProfileDescr> profileDescr)
         : BaseBackupStream(prepared_conn, backupHandle, profileDescr),
-          MessageStreamer(backupHandle, prepared_conn){}
+          MessageStreamer(backupHandle, prepared_conn) {
+
+  if (profileDescr != nullptr && profileDescr->compress_on_server)
+    setServerCompression(profileDescr->compress_type);
+
+}
 
 BaseBackupStream15::~BaseBackupStream15() noexcept {}
 
@@ -2033,6 +2405,35 @@ std::string BaseBackupStream15::query(std::shared_ptr<BackupProfileDescr> profil
 
       }
 
+      /*
+       * PostgreSQL 15 is able to compress the archives on the server.
+       * The compressed archives are stored as received.
+       */
+      if (this->profile->compress_on_server) {
+
+        options.push("COMPRESSION '"
+                     + BackupProfileDescr::serverCompressionMethod(this->profile->compress_type)
+                     + "'");
+
+        if (this->profile->compress_level > 0
+            || this->profile->compress_workers > 0) {
+
+          std::ostringstream detail;
+
+          if (this->profile->compress_level > 0)
+            detail << "level=" << this->profile->compress_level;
+
+          if (this->profile->compress_workers > 0) {
+            detail << (this->profile->compress_level > 0 ? "," : "");
+            detail << "workers=" << this->profile->compress_workers;
+          }
+
+          options.push("COMPRESSION_DETAIL '" + detail.str() + "'");
+
+        }
+
+      }
+
       /*
        * We always request the tablespace map from the stream.
        */
@@ -2062,6 +2463,24 @@ std::string BaseBackupStream15::query(std::shared_ptr<BackupProfileDescr> profil
 
 }
 
+void BaseBackupStream15::assignInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) {
+
+  setInstrumentation(instr);
+
+}
+
+void BaseBackupStream15::assignWritePipeline(std::shared_ptr<BackupWritePipeline> pipeline) {
+
+  setWritePipeline(pipeline);
+
+}
+
+void BaseBackupStream15::assignIOGovernor(std::shared_ptr<IOGovernor> governor) {
+
+  setIOGovernor(governor);
+
+}
+
 std::shared_ptr<BackupElemDescr>
 BaseBackupStream15::handleMessage(BaseBackupState &current_state) {
 
@@ -2091,6 +2510,107 @@ BaseBackupStream15::handleMessage(BaseBackupState &current_state) {
 
 }
 
+/******************************************************************************
+ * Implementation of BaseBackupStream17
+ ******************************************************************************/
+
+BaseBackupStream17::BaseBackupStream17(PGconn *prepared_conn,
+                                       std::shared_ptr<StreamBaseBackup> backupHandle,
+                                       std::shared_ptr<BackupProfileDescr> profileDescr)
+        : BaseBackupStream15(prepared_conn, backupHandle, profileDescr) {}
+
+BaseBackupStream17::~BaseBackupStream17() noexcept {}
+
+std::string BaseBackupStream17::query(std::shared_ptr<BackupProfileDescr> profile,
+                                      PGconn *prepared_conn, pgbckctl::BaseBackupQueryType type) {
+
+  std::string query = BaseBackupStream15::query(profile, prepared_conn, type);
+
+  /*
+   * The options list is always closed by the last parenthesis,
+   * append INCREMENTAL there.
+   */
+  if (this->incremental && type == BASEBACKUP_QUERY_TYPE_BASEBACKUP)
+    query.insert(query.rfind(')'), ", INCREMENTAL");
+
+  return query;
+
+}
+
+void BaseBackupStream17::uploadManifest(std::string const& manifest) {
+
+  PGresult *result = nullptr;
+  ExecStatusType es;
+  size_t offset = 0;
+
+  if (manifest.empty()) {
+    throw StreamingFailure("cannot upload an empty backup manifest");
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << "replication command: UPLOAD_MANIFEST";
+
+  result = PQexec(this->pgconn, "UPLOAD_MANIFEST");
+
+  if ((es = PQresultStatus(result)) != PGRES_COPY_IN) {
+    std::ostringstream oss;
+
+    oss << "could not upload backup manifest: " << PQresultErrorMessage(result);
+    PQclear(result);
+    throw StreamingFailure(oss.str());
+  }
+
+  PQclear(result);
+
+  /*
+   * Send the manifest in chunks, the server doesn't need
+   * them aligned to anything.
+   */
+  while (offset < manifest.length()) {
+
+    size_t len = std::min(manifest.length() - offset, (size_t) 65536);
+
+    if (PQputCopyData(this->pgconn, manifest.data() + offset, (int) len) <= 0) {
+      std::ostringstream oss;
+
+      oss << "could not send backup manifest: " << PQerrorMessage(this->pgconn);
+      throw StreamingFailure(oss.str());
+    }
+
+    offset += len;
+
+  }
+
+  if (PQputCopyEnd(this->pgconn, NULL) <= 0) {
+    std::ostringstream oss;
+
+    oss << "could not finish backup manifest upload: " << PQerrorMessage(this->pgconn);
+    throw StreamingFailure(oss.str());
+  }
+
+  /*
+   * The server verifies the manifest now, report its
+   * complaints, if any.
+   */
+  result = PQgetResult(this->pgconn);
+
+  if ((es = PQresultStatus(result)) != PGRES_COMMAND_OK) {
+    std::ostringstream oss;
+
+    oss << "backup manifest rejected: " << PQresultErrorMessage(result);
+    PQclear(result);
+    throw StreamingFailure(oss.str());
+  }
+
+  PQclear(result);
+
+  /* Consume the end of the command result */
+  while ((result = PQgetResult(this->pgconn)) != NULL)
+    PQclear(result);
+
+  this->incremental = true;
+
+}
+
 /******************************************************************************
  * Implementation of BaseBackupProcess
  ******************************************************************************/
@@ -2134,6 +2654,28 @@ void BaseBackupProcess::assignStopHandler(pgbckctl::JobSignalHandler *stopHandle
   this->stopHandler = stopHandler;
 }
 
+void BaseBackupProcess::setInstrumentation(std::shared_ptr<WorkerInstrumentation> instr) {
+  this->instr = instr;
+}
+
+void BaseBackupProcess::setIOGovernor(std::shared_ptr<IOGovernor> governor) {
+  this->governor = governor;
+}
+
+void BaseBackupProcess::setEventLog(std::shared_ptr<WorkerEventLog> events) {
+  this->events = events;
+}
+
+void BaseBackupProcess::setWritePipeline(unsigned int buffers, size_t buffer_size) {
+  this->write_buffers = buffers;
+  this->write_buffer_size = buffer_size;
+}
+
+void BaseBackupProcess::setIncremental(int parent_id, std::string manifest) {
+  this->parent_id = parent_id;
+  this->parent_manifest = manifest;
+}
+
 void BaseBackupProcess::start() {
 
   std::string query;
@@ -2147,6 +2689,14 @@ void BaseBackupProcess::start() {
     throw StreamingFailure("attempt to start an unprepared basebackup stream");
   }
 
+  /*
+   * An incremental basebackup needs the manifest of its
+   * parent uploaded before, a resumed one the manifest of
+   * what it resumes.
+   */
+  if (!this->parent_manifest.empty())
+    this->tinfo->uploadManifest(this->parent_manifest);
+
   query = tinfo->query(profile, pgconn,
                        BASEBACKUP_QUERY_TYPE_BASEBACKUP);
 
@@ -2177,6 +2727,7 @@ void BaseBackupProcess::start() {
    *       as long as this basebackup exists.
    */
   this->baseBackupDescr->used_profile = this->profile->profile_id;
+  this->baseBackupDescr->parent_id = this->parent_id;
 
   if (!this->profile->label.empty())
     this->baseBackupDescr->label = this->profile->label;
@@ -2186,6 +2737,12 @@ void BaseBackupProcess::start() {
    */
   this->baseBackupDescr->started = CPGBackupCtlBase::current_timestamp();
 
+  if (this->events != nullptr) {
+    this->events->record(EVT_BASEBACKUP_START,
+                         PGStream::decodeXLOGPos(this->baseBackupDescr->xlogpos),
+                         this->baseBackupDescr->timeline);
+  }
+
 }
 
 std::shared_ptr<BaseBackupDescr> BaseBackupProcess::getBaseBackupDescr() {
@@ -2230,6 +2787,19 @@ void BaseBackupProcess::prepareStream(std::shared_ptr<StreamBaseBackup> &backupH
   /* We want to have a stop handler for the basebackup stream */
   this->tinfo->assignStopHandler(this->stopHandler);
 
+  /* Publish progress into our worker slot, if instrumented */
+  if (this->instr != nullptr)
+    this->tinfo->assignInstrumentation(this->instr);
+
+  /* Throttle writes according to the basebackup budget, if governed */
+  if (this->governor != nullptr)
+    this->tinfo->assignIOGovernor(this->governor);
+
+  /* Decouple receiving from writing, if requested */
+  if (this->write_buffers > 0)
+    this->tinfo->assignWritePipeline(std::make_shared<BackupWritePipeline>(this->write_buffers,
+                                                                          this->write_buffer_size));
+
 }
 
 bool BaseBackupProcess::stream(std::shared_ptr<BackupCatalog> catalog) {
@@ -2243,46 +2813,96 @@ bool BaseBackupProcess::stream(std::shared_ptr<BackupCatalog> catalog) {
     throw StreamingFailure("cannot start data streaming from improper state");
   }
 
+  /*
+   * Tablespaces announced by the stream. They are registered
+   * in the catalog in one go after all of them were streamed.
+   */
+  std::vector<std::shared_ptr<BackupTablespaceDescr>> tablespace_list;
+
   /* Prepare state to iterate through tablespaces */
   current_state = BASEBACKUP_STEP_TABLESPACE;
 
-  while(true) {
+  try {
 
-    auto descr = tinfo->handleMessage(current_state);
+    while(true) {
 
-    /* Check state */
-    if (current_state == BASEBACKUP_STEP_TABLESPACE_INTERRUPTED) {
-      throw StreamingFailure("basebackup stream interrupted");
-    }
+      auto descr = tinfo->handleMessage(current_state);
 
-    if (current_state == BASEBACKUP_EOB) {
-      BOOST_LOG_TRIVIAL(debug) << "end of backup stream reached";
-      break;
-    }
+      /* Check state */
+      if (current_state == BASEBACKUP_STEP_TABLESPACE_INTERRUPTED) {
+        throw StreamingFailure("basebackup stream interrupted");
+      }
 
-    if (descr->getType() == BASEBACKUP_ELEM_TBLSPC) {
+      if (current_state == BASEBACKUP_EOB) {
+        BOOST_LOG_TRIVIAL(debug) << "end of backup stream reached";
+        break;
+      }
 
-      /*
-       * The backup id is retrieved by the basebackup descriptor and not (obviously) not
-       * provided directly within the basebackup stream. So we need to reference
-       * it explictely here before saving the descriptor to disc.
-       */
-      dynamic_pointer_cast<BackupTablespaceDescr>(descr)->backup_id = baseBackupDescr->id;
-      catalog->registerTablespaceForBackup(dynamic_pointer_cast<BackupTablespaceDescr>(descr));
+      if (descr->getType() == BASEBACKUP_ELEM_TBLSPC) {
 
-    }
+        if (this->events != nullptr) {
+          std::shared_ptr<BackupTablespaceDescr> tblspc
+            = dynamic_pointer_cast<BackupTablespaceDescr>(descr);
+
+          this->events->record(EVT_BASEBACKUP_TABLESPACE,
+                               tblspc->spcoid,
+                               tblspc->spcsize);
+        }
+
+        /*
+         * The backup id is retrieved by the basebackup descriptor and not (obviously) not
+         * provided directly within the basebackup stream. So we need to reference
+         * it explictely here before saving the descriptor to disc.
+         */
+        dynamic_pointer_cast<BackupTablespaceDescr>(descr)->backup_id = baseBackupDescr->id;
+        tablespace_list.push_back(dynamic_pointer_cast<BackupTablespaceDescr>(descr));
 
-    /* Should we get another state than BASEBACKUP_STEP_TABLESPACE, error out */
-    if (current_state != BASEBACKUP_STEP_TABLESPACE) {
-      throw StreamingFailure("unexpected state in basebackup stream");
+      }
+
+      /* Should we get another state than BASEBACKUP_STEP_TABLESPACE, error out */
+      if (current_state != BASEBACKUP_STEP_TABLESPACE) {
+        throw StreamingFailure("unexpected state in basebackup stream");
+      }
     }
+
+  } catch (StreamingFailure &e) {
+
+    /*
+     * Keep track of the tablespaces streamed so far, the
+     * caller will mark the basebackup aborted.
+     */
+    registerTablespaces(catalog, tablespace_list);
+    throw e;
+
   }
 
+  registerTablespaces(catalog, tablespace_list);
+
   /* success */
   return true;
 
 }
 
+void BaseBackupProcess::registerTablespaces(std::shared_ptr<BackupCatalog> catalog,
+                                            std::vector<std::shared_ptr<BackupTablespaceDescr>> &list) {
+
+  if (list.size() == 0)
+    return;
+
+  catalog->startTransaction();
+
+  try {
+    catalog->registerTablespacesForBackup(list);
+    catalog->commitTransaction();
+  } catch (CPGBackupCtlFailure &e) {
+    catalog->rollbackTransaction();
+    throw e;
+  }
+
+  list.clear();
+
+}
+
 void BaseBackupProcess::end() {
 
   PGresult *res;
@@ -2328,6 +2948,11 @@ void BaseBackupProcess::end() {
   this->baseBackupDescr->xlogposend = PQgetvalue(res, 0, 0);
   PQclear(res);
 
+  if (this->events != nullptr) {
+    this->events->record(EVT_BASEBACKUP_END,
+                         PGStream::decodeXLOGPos(this->baseBackupDescr->xlogposend));
+  }
+
   /*
    * Update internal state that we have reached XLOG end position.
    */
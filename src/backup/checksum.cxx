@@ -0,0 +1,396 @@
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+
+#include <checksum.hxx>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define HAVE_CRC32C_SSE42 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define HAVE_CRC32C_ARMV8 1
+#endif
+
+#ifdef PG_BACKUP_CTL_HAS_OPENSSL
+#include <openssl/evp.h>
+#endif
+
+using namespace pgbckctl;
+
+/*
+ * Reflected CRC-32C polynomial.
+ */
+#define CRC32C_POLY 0x82F63B78
+
+/* ****************************************************************************
+ * CRC32C implementations
+ * ****************************************************************************/
+
+/*
+ * Lookup tables for slicing-by-8, built once on first use.
+ */
+static uint32_t crc32c_table[8][256];
+
+static bool crc32c_table_init() {
+
+  for (uint32_t i = 0; i < 256; i++) {
+
+    uint32_t crc = i;
+
+    for (int j = 0; j < 8; j++)
+      crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : (crc >> 1);
+
+    crc32c_table[0][i] = crc;
+
+  }
+
+  for (uint32_t i = 0; i < 256; i++) {
+    for (int j = 1; j < 8; j++) {
+      crc32c_table[j][i] = (crc32c_table[j - 1][i] >> 8)
+        ^ crc32c_table[0][crc32c_table[j - 1][i] & 0xFF];
+    }
+  }
+
+  return true;
+
+}
+
+static uint32_t crc32c_sb8(uint32_t crc, const unsigned char *p, size_t len) {
+
+  static bool initialized = crc32c_table_init();
+
+  (void) initialized;
+
+  while (len > 0 && ((uintptr_t) p & 7) != 0) {
+    crc = crc32c_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    len--;
+  }
+
+  while (len >= 8) {
+
+    uint32_t lo;
+    uint32_t hi;
+
+    memcpy(&lo, p, 4);
+    memcpy(&hi, p + 4, 4);
+
+#ifdef PG_BACKUP_CTL_BIG_ENDIAN
+    lo = __builtin_bswap32(lo);
+    hi = __builtin_bswap32(hi);
+#endif
+
+    lo ^= crc;
+
+    crc = crc32c_table[7][lo & 0xFF]
+      ^ crc32c_table[6][(lo >> 8) & 0xFF]
+      ^ crc32c_table[5][(lo >> 16) & 0xFF]
+      ^ crc32c_table[4][lo >> 24]
+      ^ crc32c_table[3][hi & 0xFF]
+      ^ crc32c_table[2][(hi >> 8) & 0xFF]
+      ^ crc32c_table[1][(hi >> 16) & 0xFF]
+      ^ crc32c_table[0][hi >> 24];
+
+    p += 8;
+    len -= 8;
+
+  }
+
+  while (len > 0) {
+    crc = crc32c_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    len--;
+  }
+
+  return crc;
+
+}
+
+#ifdef HAVE_CRC32C_SSE42
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t len) {
+
+  uint64_t crc64 = crc;
+
+  while (len > 0 && ((uintptr_t) p & 7) != 0) {
+    crc64 = _mm_crc32_u8((uint32_t) crc64, *p++);
+    len--;
+  }
+
+  while (len >= 8) {
+
+    uint64_t data;
+
+    memcpy(&data, p, 8);
+    crc64 = _mm_crc32_u64(crc64, data);
+    p += 8;
+    len -= 8;
+
+  }
+
+  while (len > 0) {
+    crc64 = _mm_crc32_u8((uint32_t) crc64, *p++);
+    len--;
+  }
+
+  return (uint32_t) crc64;
+
+}
+
+#endif
+
+#ifdef HAVE_CRC32C_ARMV8
+
+static uint32_t crc32c_armv8(uint32_t crc, const unsigned char *p, size_t len) {
+
+  while (len > 0 && ((uintptr_t) p & 7) != 0) {
+    crc = __crc32cb(crc, *p++);
+    len--;
+  }
+
+  while (len >= 8) {
+
+    uint64_t data;
+
+    memcpy(&data, p, 8);
+    crc = __crc32cd(crc, data);
+    p += 8;
+    len -= 8;
+
+  }
+
+  while (len > 0) {
+    crc = __crc32cb(crc, *p++);
+    len--;
+  }
+
+  return crc;
+
+}
+
+#endif
+
+typedef uint32_t (*crc32c_fn)(uint32_t, const unsigned char *, size_t);
+
+/*
+ * Selects the CRC32C implementation for this CPU once.
+ */
+static crc32c_fn crc32c_choose() {
+
+#ifdef HAVE_CRC32C_SSE42
+  if (__builtin_cpu_supports("sse4.2"))
+    return crc32c_sse42;
+#endif
+
+#ifdef HAVE_CRC32C_ARMV8
+  return crc32c_armv8;
+#endif
+
+  return crc32c_sb8;
+
+}
+
+static crc32c_fn crc32c_impl = crc32c_choose();
+
+/* ****************************************************************************
+ * Implementation BackupChecksum
+ * ****************************************************************************/
+
+BackupChecksum::~BackupChecksum() {}
+
+std::string BackupChecksum::getAlgorithm() {
+
+  return this->algorithm;
+
+}
+
+bool BackupChecksum::supported(std::string algorithm) {
+
+  std::transform(algorithm.begin(), algorithm.end(), algorithm.begin(), ::toupper);
+
+  if (algorithm == "CRC32C")
+    return true;
+
+#ifdef PG_BACKUP_CTL_HAS_OPENSSL
+  if (algorithm == "SHA224" || algorithm == "SHA256"
+      || algorithm == "SHA384" || algorithm == "SHA512")
+    return true;
+#endif
+
+  return false;
+
+}
+
+std::string BackupChecksum::implementation(std::string algorithm) {
+
+  std::transform(algorithm.begin(), algorithm.end(), algorithm.begin(), ::toupper);
+
+  if (algorithm == "CRC32C")
+    return CRC32CChecksum::hardware() ? "CRC32C (hardware)" : "CRC32C (software)";
+
+  if (BackupChecksum::supported(algorithm))
+    return algorithm + " (libcrypto)";
+
+  return algorithm + " (unsupported)";
+
+}
+
+std::shared_ptr<BackupChecksum> BackupChecksum::get(std::string algorithm) {
+
+  std::transform(algorithm.begin(), algorithm.end(), algorithm.begin(), ::toupper);
+
+  if (algorithm == "CRC32C")
+    return std::make_shared<CRC32CChecksum>();
+
+#ifdef PG_BACKUP_CTL_HAS_OPENSSL
+  if (algorithm == "SHA224" || algorithm == "SHA256"
+      || algorithm == "SHA384" || algorithm == "SHA512")
+    return std::make_shared<SHA2Checksum>(algorithm);
+#endif
+
+  std::ostringstream oss;
+  oss << "checksum algorithm \"" << algorithm << "\" is not supported";
+  throw ChecksumFailure(oss.str());
+
+}
+
+/*
+ * Hex encoding as used by backup manifests.
+ */
+static std::string checksum_hex(const unsigned char *data, size_t len) {
+
+  static const char digits[] = "0123456789abcdef";
+  std::string result;
+
+  result.reserve(len * 2);
+
+  for (size_t i = 0; i < len; i++) {
+    result += digits[data[i] >> 4];
+    result += digits[data[i] & 0x0F];
+  }
+
+  return result;
+
+}
+
+/* ****************************************************************************
+ * Implementation CRC32CChecksum
+ * ****************************************************************************/
+
+CRC32CChecksum::CRC32CChecksum() {
+
+  this->algorithm = "CRC32C";
+
+}
+
+CRC32CChecksum::~CRC32CChecksum() {}
+
+bool CRC32CChecksum::hardware() {
+
+  return (crc32c_impl != crc32c_sb8);
+
+}
+
+uint32_t CRC32CChecksum::compute(uint32_t crc, const char *buf, size_t len) {
+
+  return crc32c_impl(crc, (const unsigned char *) buf, len);
+
+}
+
+void CRC32CChecksum::reset() {
+
+  this->crc = 0xFFFFFFFF;
+
+}
+
+void CRC32CChecksum::update(const char *buf, size_t len) {
+
+  this->crc = crc32c_impl(this->crc, (const unsigned char *) buf, len);
+
+}
+
+std::string CRC32CChecksum::final() {
+
+  /*
+   * PostgreSQL writes the finalized crc in native byte
+   * order into the manifest, so do we.
+   */
+  uint32_t result = this->crc ^ 0xFFFFFFFF;
+
+  return checksum_hex((const unsigned char *) &result, sizeof(result));
+
+}
+
+/* ****************************************************************************
+ * Implementation SHA2Checksum
+ * ****************************************************************************/
+
+#ifdef PG_BACKUP_CTL_HAS_OPENSSL
+
+SHA2Checksum::SHA2Checksum(std::string algorithm) {
+
+  this->algorithm = algorithm;
+
+  if (algorithm == "SHA224")
+    this->md = EVP_sha224();
+  else if (algorithm == "SHA256")
+    this->md = EVP_sha256();
+  else if (algorithm == "SHA384")
+    this->md = EVP_sha384();
+  else if (algorithm == "SHA512")
+    this->md = EVP_sha512();
+  else {
+    std::ostringstream oss;
+    oss << "checksum algorithm \"" << algorithm << "\" is not a SHA-2 algorithm";
+    throw ChecksumFailure(oss.str());
+  }
+
+  this->ctx = EVP_MD_CTX_new();
+
+  if (this->ctx == nullptr) {
+    throw ChecksumFailure("could not allocate checksum context");
+  }
+
+  this->reset();
+
+}
+
+SHA2Checksum::~SHA2Checksum() {
+
+  if (this->ctx != nullptr)
+    EVP_MD_CTX_free((EVP_MD_CTX *) this->ctx);
+
+}
+
+void SHA2Checksum::reset() {
+
+  if (EVP_DigestInit_ex((EVP_MD_CTX *) this->ctx, (const EVP_MD *) this->md, NULL) != 1) {
+    throw ChecksumFailure("could not initialize " + this->algorithm + " checksum");
+  }
+
+}
+
+void SHA2Checksum::update(const char *buf, size_t len) {
+
+  if (EVP_DigestUpdate((EVP_MD_CTX *) this->ctx, buf, len) != 1) {
+    throw ChecksumFailure("could not update " + this->algorithm + " checksum");
+  }
+
+}
+
+std::string SHA2Checksum::final() {
+
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int len = 0;
+
+  if (EVP_DigestFinal_ex((EVP_MD_CTX *) this->ctx, digest, &len) != 1) {
+    throw ChecksumFailure("could not finalize " + this->algorithm + " checksum");
+  }
+
+  return checksum_hex(digest, len);
+
+}
+
+#endif
@@ -0,0 +1,581 @@
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include <pagechecksum.hxx>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define HAVE_PAGE_CHECKSUM_AVX2 1
+#endif
+
+using namespace pgbckctl;
+
+/*
+ * Number of parallel sums per page and the FNV-1a prime,
+ * must match PostgreSQL.
+ */
+#define N_SUMS 32
+#define FNV_PRIME 16777619
+
+/*
+ * Offsets of the page header fields we need.
+ */
+#define PD_LSN_OFFSET 0
+#define PD_CHECKSUM_OFFSET 8
+#define PD_UPPER_OFFSET 14
+
+/*
+ * Base offsets of the sums, taken from PostgreSQL.
+ */
+static const uint32_t checksumBaseOffsets[N_SUMS] = {
+  0x5B1F36E9, 0xB8525960, 0x02AB50AA, 0x1DE66D2A,
+  0x79FF467A, 0x9BB9F8A3, 0x217E7CD2, 0x83E13D2C,
+  0xF8D4474F, 0xE39EB970, 0x42C6AE16, 0x993216FA,
+  0x7B093B5D, 0x98DAFF3C, 0xF718902A, 0x0B1C9CDB,
+  0xE58F764B, 0x187636BC, 0x5D7B3BB1, 0xE73DE7DE,
+  0x92BEC979, 0xCCA6C0B2, 0x304A0979, 0x85AA43D4,
+  0x783125BB, 0x6CA8EAA2, 0xE407EAC6, 0x4B5CFC3E,
+  0x9FBF8C76, 0x15CA20BE, 0xF2CA9FD3, 0x959BD756
+};
+
+/* ****************************************************************************
+ * Page checksum implementations
+ *
+ * Both get the first row of the page separately, since it contains
+ * pd_checksum, which must be taken as zero.
+ * ****************************************************************************/
+
+#define CHECKSUM_COMP(checksum, value) do {       \
+    uint32_t __tmp = (checksum) ^ (value);        \
+    (checksum) = __tmp * FNV_PRIME ^ (__tmp >> 17); \
+  } while (0)
+
+static uint32_t page_checksum_scalar(const uint32_t *first,
+                                     const char *page,
+                                     unsigned int rows) {
+
+  uint32_t sums[N_SUMS];
+  uint32_t row[N_SUMS];
+  uint32_t result = 0;
+
+  memcpy(sums, checksumBaseOffsets, sizeof(sums));
+
+  for (unsigned int i = 0; i < rows; i++) {
+
+    const uint32_t *data = first;
+
+    if (i > 0) {
+      memcpy(row, page + i * sizeof(row), sizeof(row));
+      data = row;
+    }
+
+    for (unsigned int j = 0; j < N_SUMS; j++)
+      CHECKSUM_COMP(sums[j], data[j]);
+
+  }
+
+  /* two rounds of zeroes for additional mixing */
+  for (unsigned int i = 0; i < 2; i++)
+    for (unsigned int j = 0; j < N_SUMS; j++)
+      CHECKSUM_COMP(sums[j], 0);
+
+  for (unsigned int i = 0; i < N_SUMS; i++)
+    result ^= sums[i];
+
+  return result;
+
+}
+
+#ifdef HAVE_PAGE_CHECKSUM_AVX2
+
+/*
+ * One CHECKSUM_COMP() step for eight sums. The multiplication
+ * keeps the lower 32 bits, like the scalar one.
+ */
+__attribute__((target("avx2")))
+static inline __m256i checksum_comp_avx2(__m256i sums, __m256i value) {
+
+  const __m256i prime = _mm256_set1_epi32(FNV_PRIME);
+  __m256i tmp = _mm256_xor_si256(sums, value);
+
+  return _mm256_xor_si256(_mm256_mullo_epi32(tmp, prime),
+                          _mm256_srli_epi32(tmp, 17));
+
+}
+
+__attribute__((target("avx2")))
+static uint32_t page_checksum_avx2(const uint32_t *first,
+                                   const char *page,
+                                   unsigned int rows) {
+
+  __m256i sums[N_SUMS / 8];
+  uint32_t folded[8];
+  uint32_t result = 0;
+
+  for (unsigned int j = 0; j < N_SUMS / 8; j++) {
+    sums[j] = _mm256_loadu_si256((const __m256i *) (checksumBaseOffsets + j * 8));
+    sums[j] = checksum_comp_avx2(sums[j], _mm256_loadu_si256((const __m256i *) (first + j * 8)));
+  }
+
+  for (unsigned int i = 1; i < rows; i++) {
+
+    const char *row = page + i * N_SUMS * sizeof(uint32_t);
+
+    for (unsigned int j = 0; j < N_SUMS / 8; j++)
+      sums[j] = checksum_comp_avx2(sums[j], _mm256_loadu_si256((const __m256i *) (row + j * 32)));
+
+  }
+
+  for (unsigned int i = 0; i < 2; i++)
+    for (unsigned int j = 0; j < N_SUMS / 8; j++)
+      sums[j] = checksum_comp_avx2(sums[j], _mm256_setzero_si256());
+
+  _mm256_storeu_si256((__m256i *) folded,
+                      _mm256_xor_si256(_mm256_xor_si256(sums[0], sums[1]),
+                                       _mm256_xor_si256(sums[2], sums[3])));
+
+  for (unsigned int i = 0; i < 8; i++)
+    result ^= folded[i];
+
+  return result;
+
+}
+
+#endif
+
+typedef uint32_t (*page_checksum_fn)(const uint32_t *, const char *, unsigned int);
+
+/*
+ * Selects the page checksum implementation for this CPU once.
+ */
+static page_checksum_fn page_checksum_choose() {
+
+#ifdef HAVE_PAGE_CHECKSUM_AVX2
+  if (__builtin_cpu_supports("avx2"))
+    return page_checksum_avx2;
+#endif
+
+  return page_checksum_scalar;
+
+}
+
+static page_checksum_fn page_checksum_impl = page_checksum_choose();
+
+/* ****************************************************************************
+ * Implementation PageChecksum
+ * ****************************************************************************/
+
+uint16_t PageChecksum::compute(const char *page,
+                               uint32_t blkno,
+                               unsigned int blcksz) {
+
+  uint32_t first[N_SUMS];
+  uint32_t checksum;
+
+  /* pd_checksum is computed as zero */
+  memcpy(first, page, sizeof(first));
+  memset((char *) first + PD_CHECKSUM_OFFSET, 0, sizeof(uint16_t));
+
+  checksum = page_checksum_impl(first, page, blcksz / sizeof(first));
+
+  /* mix in the block number, so transposed pages are detected */
+  checksum ^= blkno;
+
+  /* never zero, that means "no checksum" */
+  return (uint16_t) ((checksum % 65535) + 1);
+
+}
+
+bool PageChecksum::vectorized() {
+
+#ifdef HAVE_PAGE_CHECKSUM_AVX2
+  return page_checksum_impl == page_checksum_avx2;
+#else
+  return false;
+#endif
+
+}
+
+/*
+ * Relation segments are named <relfilenode>[_<fork>][.<segno>], they
+ * are located in global/, base/<dboid>/ or in the version specific
+ * directory of a tablespace, PG_<version>_<catversion>/<dboid>/.
+ */
+bool PageChecksum::relationFile(std::string name, unsigned int &segno) {
+
+  path file(name);
+  std::string filename = file.filename().string();
+  std::string parent = file.parent_path().filename().string();
+  std::string grandparent = file.parent_path().parent_path().filename().string();
+  std::string::size_type pos;
+
+  /* the data directory of the relation must match */
+  if (parent != "global") {
+
+    if (parent.length() == 0
+        || parent.find_first_not_of("0123456789") != std::string::npos)
+      return false;
+
+    if (grandparent != "base" && grandparent.compare(0, 3, "PG_") != 0)
+      return false;
+
+    /* tablespace directories are the top level in their archive */
+    if (grandparent != "base"
+        && file.parent_path().parent_path().parent_path().string().length() > 0)
+      return false;
+
+  }
+
+  segno = 0;
+
+  if ((pos = filename.find('.')) != std::string::npos) {
+
+    std::string suffix = filename.substr(pos + 1);
+
+    if (suffix.length() == 0
+        || suffix.find_first_not_of("0123456789") != std::string::npos)
+      return false;
+
+    segno = CPGBackupCtlBase::strToUInt(suffix);
+    filename = filename.substr(0, pos);
+
+  }
+
+  if ((pos = filename.find('_')) != std::string::npos) {
+
+    std::string fork = filename.substr(pos + 1);
+
+    if (fork != "fsm" && fork != "vm" && fork != "init")
+      return false;
+
+    filename = filename.substr(0, pos);
+
+  }
+
+  return (filename.length() > 0
+          && filename.find_first_not_of("0123456789") == std::string::npos);
+
+}
+
+/* ****************************************************************************
+ * Implementation PageChecksumReport
+ * ****************************************************************************/
+
+PageChecksumReport::PageChecksumReport(uint64_t startpos,
+                                       unsigned int blcksz,
+                                       unsigned int relseg_size) {
+
+  this->startpos = startpos;
+  this->blcksz = blcksz;
+  this->relseg_size = relseg_size;
+
+}
+
+PageChecksumReport::~PageChecksumReport() {}
+
+uint64_t PageChecksumReport::getStartPos() {
+  return this->startpos;
+}
+
+unsigned int PageChecksumReport::getBlockSize() {
+  return this->blcksz;
+}
+
+unsigned int PageChecksumReport::getSegmentSize() {
+  return this->relseg_size;
+}
+
+void PageChecksumReport::verify(std::string const &file,
+                                unsigned int segno,
+                                uint32_t block,
+                                const char *page) {
+
+  uint32_t xlogid;
+  uint32_t xrecoff;
+  uint16_t pd_checksum;
+  uint16_t pd_upper;
+  uint32_t blkno = segno * this->relseg_size + block;
+
+  memcpy(&xlogid, page + PD_LSN_OFFSET, sizeof(xlogid));
+  memcpy(&xrecoff, page + PD_LSN_OFFSET + sizeof(xlogid), sizeof(xrecoff));
+  memcpy(&pd_checksum, page + PD_CHECKSUM_OFFSET, sizeof(pd_checksum));
+  memcpy(&pd_upper, page + PD_UPPER_OFFSET, sizeof(pd_upper));
+
+  /*
+   * New pages don't have a checksum yet, pages changed after
+   * the basebackup started are restored from WAL.
+   */
+  if (pd_upper == 0
+      || ((((uint64_t) xlogid) << 32) | xrecoff) >= this->startpos) {
+
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->skipped++;
+    return;
+
+  }
+
+  if (PageChecksum::compute(page, blkno, this->blcksz) == pd_checksum) {
+
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->verified++;
+    return;
+
+  }
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+
+  this->failed++;
+
+  if (this->bad_pages.size() < PAGE_CHECKSUM_MAX_REPORTED) {
+    std::ostringstream oss;
+    oss << file << " block " << block;
+    this->bad_pages.push_back(oss.str());
+  }
+
+}
+
+unsigned long long PageChecksumReport::pagesVerified() {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  return this->verified;
+
+}
+
+unsigned long long PageChecksumReport::pagesSkipped() {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  return this->skipped;
+
+}
+
+unsigned long long PageChecksumReport::failures() {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  return this->failed;
+
+}
+
+std::string PageChecksumReport::detail() {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  std::ostringstream oss;
+
+  for (size_t i = 0; i < this->bad_pages.size(); i++) {
+
+    if (i > 0)
+      oss << ", ";
+
+    oss << this->bad_pages[i];
+
+  }
+
+  if (this->failed > this->bad_pages.size())
+    oss << ", ...";
+
+  return oss.str();
+
+}
+
+/* ****************************************************************************
+ * Implementation PageVerifyingFile
+ * ****************************************************************************/
+
+PageVerifyingFile::PageVerifyingFile(std::shared_ptr<BackupFile> file,
+                                     std::shared_ptr<PageChecksumReport> report)
+  : BackupFile(path(file->getFilePath())) {
+
+  this->file = file;
+  this->report = report;
+  this->prefix = PageVerifyingFile::archivePrefix(this->handle.filename().string());
+
+}
+
+PageVerifyingFile::~PageVerifyingFile() {}
+
+std::string PageVerifyingFile::archivePrefix(std::string archive_name) {
+
+  std::string name = archive_name;
+
+  if (name.length() > 4 && name.compare(name.length() - 4, 4, ".tar") == 0)
+    name = name.substr(0, name.length() - 4);
+
+  if (name.length() == 0
+      || name.find_first_not_of("0123456789") != std::string::npos)
+    return "";
+
+  return "pg_tblspc/" + name + "/";
+
+}
+
+void PageVerifyingFile::nextMember() {
+
+  tar_member &current = this->indexer.getMembers().back();
+
+  this->member = this->indexer.getMembers().size();
+  this->page = "";
+  this->block = 0;
+  this->relation = (current.type == '0'
+                    && PageChecksum::relationFile(current.name, this->segno));
+
+  /*
+   * Archives named by the tablespace OID include the data
+   * directory itself before PostgreSQL 15, only members
+   * below PG_<version> are in the tablespace.
+   */
+  if (current.name.compare(0, 3, "PG_") == 0)
+    this->member_name = this->prefix + current.name;
+  else
+    this->member_name = current.name;
+
+}
+
+void PageVerifyingFile::verifyData(const char *buf,
+                                   unsigned long long offset,
+                                   size_t len) {
+
+  unsigned int blcksz = this->report->getBlockSize();
+
+  /* we only get here in order, but better be sure */
+  if (offset != (unsigned long long) this->block * blcksz + this->page.length()) {
+    this->relation = false;
+    return;
+  }
+
+  while (len > 0) {
+
+    /* whole pages are verified in place */
+    if (this->page.length() == 0 && len >= blcksz) {
+      this->report->verify(this->member_name, this->segno, this->block, buf);
+      this->block++;
+      buf += blcksz;
+      len -= blcksz;
+      continue;
+    }
+
+    size_t n = std::min((size_t) (blcksz - this->page.length()), len);
+
+    this->page.append(buf, n);
+    buf += n;
+    len -= n;
+
+    if (this->page.length() == blcksz) {
+      this->report->verify(this->member_name, this->segno, this->block, this->page.data());
+      this->block++;
+      this->page = "";
+    }
+
+  }
+
+}
+
+bool PageVerifyingFile::isCompressed() {
+  return this->file->isCompressed();
+}
+
+void PageVerifyingFile::setCompressed(bool compressed) {
+  this->file->setCompressed(compressed);
+}
+
+void PageVerifyingFile::open() {
+  this->file->open();
+}
+
+void PageVerifyingFile::close() {
+  this->file->close();
+}
+
+void PageVerifyingFile::fsync() {
+  this->file->fsync();
+}
+
+bool PageVerifyingFile::isOpen() {
+  return this->file->isOpen();
+}
+
+void PageVerifyingFile::rename(path& newname) {
+
+  this->file->rename(newname);
+  this->handle = path(this->file->getFilePath());
+
+}
+
+void PageVerifyingFile::setOpenMode(std::string mode) {
+  this->file->setOpenMode(mode);
+}
+
+std::string PageVerifyingFile::getOpenMode() {
+  return this->file->getOpenMode();
+}
+
+size_t PageVerifyingFile::write(const char *buf, size_t len) {
+
+  /*
+   * The data goes to the file first, verification
+   * must not lose anything.
+   */
+  size_t written = this->file->write(buf, len);
+  size_t consumed = 0;
+
+  /*
+   * The indexer stops at member boundaries, so everything fed
+   * at once belongs to the last member seen.
+   */
+  while (consumed < len && !this->indexer.failed()) {
+
+    unsigned long long position = this->indexer.getPosition();
+    size_t n = this->indexer.feed(buf + consumed, len - consumed);
+
+    if (n == 0)
+      break;
+
+    if (this->indexer.getMembers().size() != this->member)
+      this->nextMember();
+
+    if (this->relation) {
+
+      tar_member &current = this->indexer.getMembers().back();
+      unsigned long long start = std::max(position, current.data_offset);
+      unsigned long long end = std::min(position + n, current.data_offset + current.size);
+
+      if (start < end) {
+        this->verifyData(buf + consumed + (start - position),
+                         start - current.data_offset,
+                         end - start);
+      }
+
+    }
+
+    consumed += n;
+
+  }
+
+  return written;
+
+}
+
+size_t PageVerifyingFile::read(char *buf, size_t len) {
+  throw CArchiveIssue("reading from a page verifying tar file is not supported");
+}
+
+void PageVerifyingFile::remove() {
+  this->file->remove();
+}
+
+size_t PageVerifyingFile::size() {
+  return this->file->size();
+}
+
+off_t PageVerifyingFile::lseek(off_t offset, int whence) {
+  throw CArchiveIssue("seeking in a page verifying tar file is not supported");
+}
+
+off_t PageVerifyingFile::current_position() {
+  return this->file->current_position();
+}
+
+off_t PageVerifyingFile::frameBoundary() {
+  return this->file->frameBoundary();
+}
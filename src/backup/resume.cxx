@@ -0,0 +1,1162 @@
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <stream.hxx>
+#include <pagechecksum.hxx>
+#include <resume.hxx>
+
+using namespace pgbckctl;
+
+/*
+ * Size of the fixed part of an incremental file header: magic,
+ * number of blocks and truncation block length.
+ */
+#define INCREMENTAL_HEADER_SIZE (3 * sizeof(uint32_t))
+
+/*
+ * Offsets and lengths of the ustar header fields we rewrite.
+ */
+#define TAR_NAME_OFFSET 0
+#define TAR_NAME_LENGTH 100
+#define TAR_SIZE_OFFSET 124
+#define TAR_SIZE_LENGTH 12
+#define TAR_CHECKSUM_OFFSET 148
+#define TAR_CHECKSUM_LENGTH 8
+#define TAR_PREFIX_OFFSET 345
+#define TAR_PREFIX_LENGTH 155
+
+/*
+ * Returns the string quoted for a JSON document.
+ */
+static std::string resume_json_quote(std::string const &value) {
+
+  std::ostringstream oss;
+
+  oss << "\"";
+
+  for (char c : value) {
+
+    if (c == '"' || c == '\\')
+      oss << '\\' << c;
+    else
+      oss << c;
+
+  }
+
+  oss << "\"";
+  return oss.str();
+
+}
+
+/*
+ * True if the path can't be written as a plain JSON string, the
+ * manifest lists it hex encoded then.
+ */
+static bool resume_needs_encoding(std::string const &value) {
+
+  for (char c : value) {
+
+    if ((unsigned char) c < 0x20 || (unsigned char) c >= 0x80)
+      return true;
+
+  }
+
+  return false;
+
+}
+
+/*
+ * Returns the value of a string field in a line of a
+ * backup manifest, an empty string if there's none.
+ */
+static std::string resume_manifest_field(std::string const &line,
+                                         std::string const &field) {
+
+  std::string key = "\"" + field + "\": \"";
+  std::string::size_type start = line.find(key);
+  std::string::size_type end;
+
+  if (start == std::string::npos)
+    return "";
+
+  start += key.length();
+  end = line.find('"', start);
+
+  if (end == std::string::npos)
+    return "";
+
+  return line.substr(start, end - start);
+
+}
+
+/*
+ * Returns the name of a member with the incremental
+ * prefix of its file name removed.
+ */
+static std::string resume_full_name(std::string const &name) {
+
+  std::string::size_type slash = name.rfind('/');
+  std::string::size_type base = (slash == std::string::npos) ? 0 : slash + 1;
+
+  return name.substr(0, base) + name.substr(base + strlen(RESUME_INCREMENTAL_PREFIX));
+
+}
+
+/*
+ * True if the member is an incremental file.
+ */
+static bool resume_is_incremental(std::string const &name) {
+
+  std::string::size_type slash = name.rfind('/');
+  std::string::size_type base = (slash == std::string::npos) ? 0 : slash + 1;
+
+  return name.compare(base, strlen(RESUME_INCREMENTAL_PREFIX), RESUME_INCREMENTAL_PREFIX) == 0;
+
+}
+
+/* ****************************************************************************
+ * Implementation BaseBackupResume
+ * ****************************************************************************/
+
+BaseBackupResume::BaseBackupResume(std::string checksum_algorithm,
+                                   unsigned int blcksz) {
+
+  this->checksum_algorithm = checksum_algorithm;
+  this->blcksz = blcksz;
+
+}
+
+BaseBackupResume::~BaseBackupResume() {}
+
+std::string BaseBackupResume::manifestPath(std::string archive_name,
+                                           std::string member_name) {
+
+  /*
+   * Archives named by the tablespace OID include the data
+   * directory itself before PostgreSQL 15, only members
+   * below PG_<version> are in the tablespace.
+   */
+  if (member_name.compare(0, 3, "PG_") == 0)
+    return PageVerifyingFile::archivePrefix(archive_name) + member_name;
+
+  return member_name;
+
+}
+
+void BaseBackupResume::scanArchive(path archive) {
+
+  resume_archive entry;
+  std::string archive_name = TarStreamSource::archiveName(archive);
+  std::shared_ptr<TarArchiveIndex> index = std::make_shared<TarArchiveIndex>(archive);
+  size_t archive_id = this->archives.size();
+  size_t found = 0;
+
+  entry.file = archive;
+
+  if (index->load())
+    entry.index = index;
+
+  this->archives.push_back(entry);
+
+  /*
+   * The archive ends somewhere within a member, or even within
+   * compressed data. Every member read completely up to there is
+   * usable, the first error ends the scan.
+   */
+  try {
+
+    TarArchiveReader reader(TarStreamSource::open(archive));
+    tar_member member;
+    char buf[65536];
+
+    while (reader.next(member)) {
+
+      resume_member resumed;
+      std::shared_ptr<BackupChecksum> crc = nullptr;
+      unsigned long long total = 0;
+      std::string manifest_path;
+      size_t n;
+
+      if (member.type != '0')
+        continue;
+
+      crc = BackupChecksum::get(STREAM_CHECKSUM_ALGORITHM);
+
+      while ((n = reader.read(buf, sizeof(buf))) > 0) {
+        crc->update(buf, n);
+        total += n;
+      }
+
+      if (total != member.size)
+        break;
+
+      /*
+       * Incremental files of an aborted incremental basebackup
+       * aren't the file they are named after.
+       */
+      if (resume_is_incremental(member.name))
+        continue;
+
+      manifest_path = BaseBackupResume::manifestPath(archive_name, member.name);
+
+      /* members of newer basebackups win */
+      if (this->members.find(manifest_path) != this->members.end())
+        continue;
+
+      resumed.archive = archive_id;
+      resumed.name = member.name;
+      resumed.header_offset = member.header_offset;
+      resumed.size = member.size;
+      resumed.mtime = member.mtime;
+      resumed.checksum = crc->final();
+
+      this->members[manifest_path] = resumed;
+      found++;
+
+    }
+
+  } catch (CArchiveIssue &e) {
+    BOOST_LOG_TRIVIAL(debug) << "DEBUG: archive " << archive.string() << " ends: " << e.what();
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "found " << found << " complete files in " << archive.string();
+
+}
+
+void BaseBackupResume::addPartial(std::shared_ptr<BaseBackupDescr> partial) {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  path directory(partial->fsentry);
+  std::vector<path> files;
+  boost::system::error_code ec;
+  uint64_t partial_startpos;
+
+  if (!boost::filesystem::is_directory(directory, ec)) {
+    BOOST_LOG_TRIVIAL(warning) << "WARNING: directory of aborted basebackup "
+                               << partial->id << " doesn't exist, not resuming it";
+    return;
+  }
+
+  for (boost::filesystem::directory_iterator it(directory, ec);
+       !ec && it != boost::filesystem::directory_iterator();
+       it.increment(ec)) {
+
+    if (TarStreamSource::isTarArchive(it->path()))
+      files.push_back(it->path());
+
+  }
+
+  std::sort(files.begin(), files.end());
+
+  for (auto &file : files)
+    this->scanArchive(file);
+
+  this->partials.push_back(partial->id);
+
+  /*
+   * The WAL of the oldest basebackup covers the
+   * changes since any of them started.
+   */
+  partial_startpos = PGStream::decodeXLOGPos(partial->xlogpos);
+
+  if (this->startpos_str.length() == 0 || partial_startpos < this->startpos) {
+    this->startpos = partial_startpos;
+    this->startpos_str = partial->xlogpos;
+    this->timeline = partial->timeline;
+  }
+
+}
+
+std::vector<int> BaseBackupResume::getPartials() {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  return this->partials;
+
+}
+
+size_t BaseBackupResume::files() {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  return this->members.size();
+
+}
+
+std::string BaseBackupResume::getChecksumAlgorithm() {
+  return this->checksum_algorithm;
+}
+
+unsigned int BaseBackupResume::getBlockSize() {
+  return this->blcksz;
+}
+
+std::string BaseBackupResume::manifest(std::string systemid) {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  std::ostringstream oss;
+  std::shared_ptr<BackupChecksum> checksum = BackupChecksum::get("SHA256");
+  std::string content;
+  bool first = true;
+
+  oss << "{ \"PostgreSQL-Backup-Manifest-Version\": 2," << "\n"
+      << "\"System-Identifier\": " << systemid << "," << "\n"
+      << "\"Files\": [";
+
+  for (auto &item : this->members) {
+
+    char mtime[64];
+    struct tm tm;
+
+    gmtime_r(&item.second.mtime, &tm);
+    strftime(mtime, sizeof(mtime), "%Y-%m-%d %H:%M:%S GMT", &tm);
+
+    oss << (first ? "\n" : ",\n");
+    first = false;
+
+    if (resume_needs_encoding(item.first)) {
+
+      std::ostringstream hex;
+
+      for (char c : item.first)
+        hex << boost::format("%02x") % (unsigned int) (unsigned char) c;
+
+      oss << "{ \"Encoded-Path\": \"" << hex.str() << "\", ";
+
+    } else {
+      oss << "{ \"Path\": " << resume_json_quote(item.first) << ", ";
+    }
+
+    oss << "\"Size\": " << item.second.size << ", "
+        << "\"Last-Modified\": \"" << mtime << "\", "
+        << "\"Checksum-Algorithm\": \"" << STREAM_CHECKSUM_ALGORITHM << "\", "
+        << "\"Checksum\": \"" << item.second.checksum << "\" }";
+
+  }
+
+  oss << "\n],\n"
+      << "\"WAL-Ranges\": [\n"
+      << "{ \"Timeline\": " << this->timeline << ", "
+      << "\"Start-LSN\": \"" << this->startpos_str << "\", "
+      << "\"End-LSN\": \"" << this->startpos_str << "\" }\n"
+      << "],\n";
+
+  content = oss.str();
+  checksum->update(content.data(), content.length());
+
+  return content + "\"Manifest-Checksum\": \"" + checksum->final() + "\"}\n";
+
+}
+
+bool BaseBackupResume::lookup(std::string const &path, resume_member &member) {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  auto it = this->members.find(path);
+
+  if (it == this->members.end())
+    return false;
+
+  member = it->second;
+  return true;
+
+}
+
+std::shared_ptr<TarArchiveReader> BaseBackupResume::open(resume_member &member) {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  resume_archive &archive = this->archives.at(member.archive);
+  tar_member current;
+
+  /*
+   * An indexed archive is read from the
+   * frame the member starts in.
+   */
+  if (archive.index != nullptr && archive.index->lookup(member.name, current)) {
+
+    std::shared_ptr<TarArchiveReader> reader
+      = std::make_shared<TarArchiveReader>(archive.index->open(current));
+
+    if (reader->next(current) && current.name == member.name)
+      return reader;
+
+  }
+
+  /*
+   * Otherwise continue with the current reader, the server sends
+   * files in the same order as before. Start over from the beginning
+   * if the member was passed already.
+   */
+  if (archive.reader == nullptr
+      || !archive.positioned
+      || archive.position >= member.header_offset) {
+
+    archive.reader = std::make_shared<TarArchiveReader>(TarStreamSource::open(archive.file));
+    archive.positioned = false;
+
+  }
+
+  while (archive.reader->next(current)) {
+
+    archive.position = current.header_offset;
+    archive.positioned = true;
+
+    if (current.header_offset == member.header_offset && current.name == member.name)
+      return archive.reader;
+
+    if (current.header_offset >= member.header_offset)
+      break;
+
+  }
+
+  archive.reader = nullptr;
+
+  std::ostringstream oss;
+  oss << "file \"" << member.name << "\" not found in archive \""
+      << archive.file.string() << "\" of aborted basebackup";
+  throw CArchiveIssue(oss.str());
+
+}
+
+void BaseBackupResume::replace(std::string const &former,
+                               resume_replacement &replacement) {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  this->replacements[former] = replacement;
+
+}
+
+std::string BaseBackupResume::rewriteManifest(std::string const &content) {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  std::istringstream in;
+  std::ostringstream out;
+  std::string line;
+  std::string body;
+  std::string last = "";
+  std::string::size_type newline = std::string::npos;
+  std::string::size_type start;
+  std::string::size_type end;
+  std::shared_ptr<BackupChecksum> checksum = nullptr;
+
+  /*
+   * The manifest checksum is the last line, it
+   * covers everything before.
+   */
+  if (content.length() > 2)
+    newline = content.rfind('\n', content.length() - 2);
+
+  if (newline == std::string::npos)
+    return content;
+
+  in.str(content.substr(0, newline + 1));
+  last = content.substr(newline + 1);
+
+  while (std::getline(in, line)) {
+
+    std::string file_path = resume_manifest_field(line, "Path");
+    std::map<std::string, resume_replacement>::iterator it;
+
+    if (file_path.length() == 0
+        || (it = this->replacements.find(file_path)) == this->replacements.end()) {
+      out << line << "\n";
+      continue;
+    }
+
+    /* keep the separator following the entry */
+    end = line.rfind('}');
+
+    out << "{ \"Path\": " << resume_json_quote(it->second.path) << ", "
+        << "\"Size\": " << it->second.size << ", "
+        << "\"Last-Modified\": \"" << resume_manifest_field(line, "Last-Modified") << "\"";
+
+    if (this->checksum_algorithm != "NONE") {
+      out << ", \"Checksum-Algorithm\": \"" << this->checksum_algorithm << "\", "
+          << "\"Checksum\": \"" << it->second.checksum << "\"";
+    }
+
+    out << " }" << ((end == std::string::npos) ? "" : line.substr(end + 1)) << "\n";
+
+  }
+
+  body = out.str();
+
+  /*
+   * Compute the manifest checksum again, if the server
+   * sent one.
+   */
+  start = last.find("\"Manifest-Checksum\": \"");
+
+  if (start == std::string::npos)
+    return body + last;
+
+  start += strlen("\"Manifest-Checksum\": \"");
+  end = last.find('"', start);
+
+  if (end == std::string::npos)
+    return body + last;
+
+  checksum = BackupChecksum::get("SHA256");
+  checksum->update(body.data(), body.length());
+
+  return body + last.substr(0, start) + checksum->final() + last.substr(end);
+
+}
+
+std::string BaseBackupResume::backupLabel(std::string const &content) {
+
+  std::istringstream in(content);
+  std::ostringstream out;
+  std::string line;
+
+  while (std::getline(in, line)) {
+
+    if (line.compare(0, strlen("INCREMENTAL FROM "), "INCREMENTAL FROM ") == 0)
+      continue;
+
+    out << line;
+
+    if (!in.eof())
+      out << "\n";
+
+  }
+
+  return out.str();
+
+}
+
+/* ****************************************************************************
+ * Implementation ResumingFile
+ * ****************************************************************************/
+
+ResumingFile::ResumingFile(std::shared_ptr<BackupFile> file,
+                           std::shared_ptr<BaseBackupResume> resume,
+                           std::string archive_name)
+  : BackupFile(path(file->getFilePath())) {
+
+  this->file = file;
+  this->resume = resume;
+  this->archive_name = archive_name;
+  this->stream_checksum = BackupChecksum::get(STREAM_CHECKSUM_ALGORITHM);
+
+}
+
+ResumingFile::~ResumingFile() {}
+
+std::string ResumingFile::checksum() {
+  return this->stream_checksum->final();
+}
+
+void ResumingFile::emit(const char *buf, size_t len) {
+
+  this->stream_checksum->update(buf, len);
+  this->file->write(buf, len);
+
+}
+
+void ResumingFile::emitHeader(std::string const &name, unsigned long long size) {
+
+  char header[TAR_BLOCK_SIZE];
+  unsigned int sum = 0;
+
+  /*
+   * The member keeps the header sent by the server, only
+   * its name and size change.
+   */
+  if (name.length() >= TAR_NAME_LENGTH || size >= (1ULL << 33)) {
+    std::ostringstream oss;
+    oss << "cannot resume file \"" << name << "\": name or size exceed the tar header";
+    throw CArchiveIssue(oss.str());
+  }
+
+  memcpy(header, this->headers.data(), TAR_BLOCK_SIZE);
+
+  memset(header + TAR_NAME_OFFSET, 0, TAR_NAME_LENGTH);
+  memcpy(header + TAR_NAME_OFFSET, name.data(), name.length());
+
+  if (memcmp(header + 257, "ustar", 5) == 0)
+    memset(header + TAR_PREFIX_OFFSET, 0, TAR_PREFIX_LENGTH);
+
+  snprintf(header + TAR_SIZE_OFFSET, TAR_SIZE_LENGTH, "%011llo", size);
+
+  memset(header + TAR_CHECKSUM_OFFSET, ' ', TAR_CHECKSUM_LENGTH);
+
+  for (int i = 0; i < TAR_BLOCK_SIZE; i++)
+    sum += (unsigned char) header[i];
+
+  snprintf(header + TAR_CHECKSUM_OFFSET, TAR_CHECKSUM_LENGTH, "%06o", sum);
+  header[TAR_CHECKSUM_OFFSET + 7] = ' ';
+
+  this->emit(header, TAR_BLOCK_SIZE);
+  this->headers = "";
+
+}
+
+void ResumingFile::emitPadding(unsigned long long size) {
+
+  char zero[TAR_BLOCK_SIZE];
+
+  if (size % TAR_BLOCK_SIZE == 0)
+    return;
+
+  memset(zero, 0, TAR_BLOCK_SIZE);
+  this->emit(zero, TAR_BLOCK_SIZE - (size % TAR_BLOCK_SIZE));
+
+}
+
+void ResumingFile::startMember() {
+
+  tar_member &current = this->indexer.getMembers().back();
+
+  this->member = this->indexer.getMembers().size();
+  this->member_path = BaseBackupResume::manifestPath(this->archive_name, current.name);
+  this->data_end = current.data_offset + current.size;
+
+  bool incremental = (current.type == '0' && resume_is_incremental(current.name));
+  bool label = (current.type == '0' && this->member_path == "backup_label");
+
+  if (!incremental && !label) {
+    this->emit(this->headers.data(), this->headers.length());
+    this->headers = "";
+    this->state = RESUME_MEMBER_COPY;
+    return;
+  }
+
+  /* PostgreSQL doesn't write extended headers */
+  if (this->headers.length() != TAR_BLOCK_SIZE) {
+    std::ostringstream oss;
+    oss << "cannot resume file \"" << current.name << "\": unexpected tar header";
+    throw CArchiveIssue(oss.str());
+  }
+
+  this->file_checksum = nullptr;
+
+  if (this->resume->getChecksumAlgorithm() != "NONE")
+    this->file_checksum = BackupChecksum::get(this->resume->getChecksumAlgorithm());
+
+  if (label) {
+    this->label = "";
+    this->state = RESUME_MEMBER_LABEL;
+    return;
+  }
+
+  this->incremental = "";
+  this->incremental_parsed = false;
+  this->truncation = 0;
+  this->blocks.clear();
+  this->block_index = 0;
+  this->next_block = 0;
+  this->materialized_size = 0;
+  this->prior = nullptr;
+  this->prior_block = 0;
+  this->state = RESUME_MEMBER_INCREMENTAL;
+
+}
+
+void ResumingFile::parseIncremental(unsigned long long member_size) {
+
+  unsigned int blcksz = this->resume->getBlockSize();
+  uint32_t magic;
+  uint32_t num_blocks;
+  size_t header_size;
+  size_t padded_size;
+  tar_member &current = this->indexer.getMembers().back();
+  std::string full_name = resume_full_name(current.name);
+
+  memcpy(&magic, this->incremental.data(), sizeof(uint32_t));
+  memcpy(&num_blocks, this->incremental.data() + sizeof(uint32_t), sizeof(uint32_t));
+  memcpy(&this->truncation, this->incremental.data() + 2 * sizeof(uint32_t), sizeof(uint32_t));
+
+  if (magic != RESUME_INCREMENTAL_MAGIC) {
+    std::ostringstream oss;
+    oss << "invalid incremental file \"" << current.name << "\"";
+    throw CArchiveIssue(oss.str());
+  }
+
+  header_size = INCREMENTAL_HEADER_SIZE + (size_t) num_blocks * sizeof(uint32_t);
+
+  if (this->incremental.length() < header_size)
+    return;
+
+  /*
+   * The header is padded to a multiple of the block size if
+   * there are blocks, the size of the member tells.
+   */
+  padded_size = header_size;
+
+  if (num_blocks > 0 && header_size % blcksz != 0)
+    padded_size += blcksz - (header_size % blcksz);
+
+  if (member_size == padded_size + (unsigned long long) num_blocks * blcksz)
+    header_size = padded_size;
+  else if (member_size != header_size + (unsigned long long) num_blocks * blcksz) {
+    std::ostringstream oss;
+    oss << "invalid size of incremental file \"" << current.name << "\"";
+    throw CArchiveIssue(oss.str());
+  }
+
+  if (this->incremental.length() < header_size)
+    return;
+
+  for (uint32_t i = 0; i < num_blocks; i++) {
+
+    uint32_t block;
+
+    memcpy(&block, this->incremental.data() + INCREMENTAL_HEADER_SIZE + i * sizeof(uint32_t),
+           sizeof(uint32_t));
+
+    if (i > 0 && block <= this->blocks.back()) {
+      std::ostringstream oss;
+      oss << "invalid block numbers in incremental file \"" << current.name << "\"";
+      throw CArchiveIssue(oss.str());
+    }
+
+    this->blocks.push_back(block);
+
+  }
+
+  this->materialized_size = this->truncation;
+
+  if (num_blocks > 0 && this->blocks.back() >= this->truncation)
+    this->materialized_size = this->blocks.back() + 1;
+
+  this->materialized_size *= blcksz;
+
+  this->incremental.erase(0, header_size);
+  this->incremental_parsed = true;
+
+  /*
+   * Blocks not sent are read from the file
+   * in the aborted basebackup.
+   */
+  if (!this->resume->lookup(resume_full_name(this->member_path), this->prior_member)) {
+    std::ostringstream oss;
+    oss << "incremental file \"" << current.name << "\" refers to a file not in the aborted basebackups";
+    throw CArchiveIssue(oss.str());
+  }
+
+  this->emitHeader(full_name, this->materialized_size);
+
+}
+
+void ResumingFile::materializeUpTo(uint32_t block) {
+
+  unsigned int blcksz = this->resume->getBlockSize();
+  std::string page(blcksz, '\0');
+
+  while (this->next_block < block) {
+
+    memset(&page[0], 0, blcksz);
+
+    /*
+     * Blocks beyond the truncation length or the end of the former
+     * file are zeroed, as done by pg_combinebackup.
+     */
+    if (this->next_block < this->truncation
+        && (unsigned long long) this->next_block * blcksz < this->prior_member.size) {
+
+      size_t done = 0;
+
+      if (this->prior == nullptr)
+        this->prior = this->resume->open(this->prior_member);
+
+      /* skip blocks replaced by the server */
+      while (this->prior_block < this->next_block) {
+
+        char skip[8192];
+        unsigned long long left = blcksz;
+
+        while (left > 0) {
+
+          size_t n = this->prior->read(skip, std::min(left, (unsigned long long) sizeof(skip)));
+
+          if (n == 0)
+            break;
+
+          left -= n;
+
+        }
+
+        this->prior_block++;
+
+      }
+
+      while (done < blcksz) {
+
+        size_t n = this->prior->read(&page[done], blcksz - done);
+
+        if (n == 0)
+          break;
+
+        done += n;
+
+      }
+
+      this->prior_block++;
+
+    }
+
+    this->emit(page.data(), blcksz);
+
+    if (this->file_checksum != nullptr)
+      this->file_checksum->update(page.data(), blcksz);
+
+    this->next_block++;
+
+  }
+
+}
+
+void ResumingFile::incrementalData(const char *buf, size_t len) {
+
+  unsigned int blcksz = this->resume->getBlockSize();
+  tar_member &current = this->indexer.getMembers().back();
+  size_t offset = 0;
+
+  this->incremental.append(buf, len);
+
+  if (!this->incremental_parsed) {
+
+    if (this->incremental.length() < INCREMENTAL_HEADER_SIZE)
+      return;
+
+    this->parseIncremental(current.size);
+
+    if (!this->incremental_parsed)
+      return;
+
+  }
+
+  /* blocks sent by the server, in ascending order */
+  while (this->incremental.length() - offset >= blcksz
+         && this->block_index < this->blocks.size()) {
+
+    uint32_t block = this->blocks[this->block_index];
+
+    this->materializeUpTo(block);
+    this->emit(this->incremental.data() + offset, blcksz);
+
+    if (this->file_checksum != nullptr)
+      this->file_checksum->update(this->incremental.data() + offset, blcksz);
+
+    this->next_block = block + 1;
+    this->block_index++;
+    offset += blcksz;
+
+  }
+
+  this->incremental.erase(0, offset);
+
+}
+
+void ResumingFile::finishIncremental() {
+
+  tar_member &current = this->indexer.getMembers().back();
+  resume_replacement replacement;
+
+  if (!this->incremental_parsed
+      || this->block_index != this->blocks.size()
+      || this->incremental.length() > 0) {
+    std::ostringstream oss;
+    oss << "incremental file \"" << current.name << "\" is incomplete";
+    throw CArchiveIssue(oss.str());
+  }
+
+  this->materializeUpTo((uint32_t) (this->materialized_size / this->resume->getBlockSize()));
+  this->emitPadding(this->materialized_size);
+  this->prior = nullptr;
+
+  replacement.path = resume_full_name(this->member_path);
+  replacement.size = this->materialized_size;
+
+  if (this->file_checksum != nullptr)
+    replacement.checksum = this->file_checksum->final();
+
+  this->resume->replace(this->member_path, replacement);
+
+}
+
+void ResumingFile::finishLabel() {
+
+  std::string content = BaseBackupResume::backupLabel(this->label);
+  resume_replacement replacement;
+
+  this->emitHeader("backup_label", content.length());
+  this->emit(content.data(), content.length());
+  this->emitPadding(content.length());
+
+  replacement.path = "backup_label";
+  replacement.size = content.length();
+
+  if (this->file_checksum != nullptr) {
+    this->file_checksum->update(content.data(), content.length());
+    replacement.checksum = this->file_checksum->final();
+  }
+
+  this->resume->replace("backup_label", replacement);
+
+}
+
+bool ResumingFile::isCompressed() {
+  return this->file->isCompressed();
+}
+
+void ResumingFile::setCompressed(bool compressed) {
+  this->file->setCompressed(compressed);
+}
+
+void ResumingFile::open() {
+  this->file->open();
+}
+
+void ResumingFile::close() {
+  this->file->close();
+}
+
+void ResumingFile::fsync() {
+  this->file->fsync();
+}
+
+bool ResumingFile::isOpen() {
+  return this->file->isOpen();
+}
+
+void ResumingFile::rename(path& newname) {
+
+  this->file->rename(newname);
+  this->handle = path(this->file->getFilePath());
+
+}
+
+void ResumingFile::setOpenMode(std::string mode) {
+  this->file->setOpenMode(mode);
+}
+
+std::string ResumingFile::getOpenMode() {
+  return this->file->getOpenMode();
+}
+
+size_t ResumingFile::write(const char *buf, size_t len) {
+
+  size_t consumed = 0;
+
+  /*
+   * The indexer stops at member boundaries, so everything fed
+   * at once belongs to the last member seen.
+   */
+  while (consumed < len) {
+
+    unsigned long long position = this->indexer.getPosition();
+    const char *data = buf + consumed;
+    size_t n;
+
+    /* everything after the end of the archive is copied */
+    if (this->state == RESUME_MEMBER_END) {
+      this->emit(data, len - consumed);
+      break;
+    }
+
+    if (this->indexer.atBoundary())
+      this->state = RESUME_MEMBER_HEADER;
+
+    n = this->indexer.feed(data, len - consumed);
+
+    if (this->indexer.failed())
+      throw CArchiveIssue("cannot resume basebackup: " + this->indexer.getError());
+
+    consumed += n;
+
+    while (true) {
+
+      if (this->state == RESUME_MEMBER_HEADER) {
+
+        if (this->indexer.getMembers().size() != this->member) {
+
+          size_t header = (size_t) (this->indexer.getMembers().back().data_offset - position);
+
+          this->headers.append(data, header);
+          data += header;
+          position += header;
+          n -= header;
+
+          this->startMember();
+          continue;
+
+        }
+
+        this->headers.append(data, n);
+
+        /* the end of archive marker */
+        if (this->indexer.complete() && !this->indexer.atBoundary()) {
+          this->emit(this->headers.data(), this->headers.length());
+          this->headers = "";
+          this->state = RESUME_MEMBER_END;
+        }
+
+        break;
+
+      }
+
+      if (this->state == RESUME_MEMBER_COPY) {
+        this->emit(data, n);
+        break;
+      }
+
+      if (this->state == RESUME_MEMBER_INCREMENTAL
+          || this->state == RESUME_MEMBER_LABEL) {
+
+        size_t member_data = (position < this->data_end)
+          ? (size_t) std::min((unsigned long long) n, this->data_end - position) : 0;
+
+        if (this->state == RESUME_MEMBER_INCREMENTAL)
+          this->incrementalData(data, member_data);
+        else
+          this->label.append(data, member_data);
+
+        position += member_data;
+
+        if (position < this->data_end)
+          break;
+
+        if (this->state == RESUME_MEMBER_INCREMENTAL)
+          this->finishIncremental();
+        else
+          this->finishLabel();
+
+        /* the member was padded already, drop what the server sent */
+        this->state = RESUME_MEMBER_PADDING;
+
+      }
+
+      break;
+
+    }
+
+  }
+
+  return len;
+
+}
+
+size_t ResumingFile::read(char *buf, size_t len) {
+  throw CArchiveIssue("reading from a resuming tar file is not supported");
+}
+
+void ResumingFile::remove() {
+  this->file->remove();
+}
+
+size_t ResumingFile::size() {
+  return this->file->size();
+}
+
+off_t ResumingFile::lseek(off_t offset, int whence) {
+  throw CArchiveIssue("seeking in a resuming tar file is not supported");
+}
+
+off_t ResumingFile::current_position() {
+  return this->file->current_position();
+}
+
+off_t ResumingFile::frameBoundary() {
+  return this->file->frameBoundary();
+}
+
+/* ****************************************************************************
+ * Implementation ResumedManifestFile
+ * ****************************************************************************/
+
+ResumedManifestFile::ResumedManifestFile(std::shared_ptr<BackupFile> file,
+                                         std::shared_ptr<BaseBackupResume> resume)
+  : BackupFile(path(file->getFilePath())) {
+
+  this->file = file;
+  this->resume = resume;
+
+}
+
+ResumedManifestFile::~ResumedManifestFile() {}
+
+void ResumedManifestFile::writeManifest() {
+
+  std::string manifest;
+
+  if (this->written)
+    return;
+
+  this->written = true;
+  manifest = this->resume->rewriteManifest(this->content);
+  this->file->write(manifest.data(), manifest.length());
+
+}
+
+bool ResumedManifestFile::isCompressed() {
+  return this->file->isCompressed();
+}
+
+void ResumedManifestFile::setCompressed(bool compressed) {
+  this->file->setCompressed(compressed);
+}
+
+void ResumedManifestFile::open() {
+  this->file->open();
+}
+
+void ResumedManifestFile::close() {
+
+  this->writeManifest();
+  this->file->close();
+
+}
+
+void ResumedManifestFile::fsync() {
+
+  this->writeManifest();
+  this->file->fsync();
+
+}
+
+bool ResumedManifestFile::isOpen() {
+  return this->file->isOpen();
+}
+
+void ResumedManifestFile::rename(path& newname) {
+
+  this->file->rename(newname);
+  this->handle = path(this->file->getFilePath());
+
+}
+
+void ResumedManifestFile::setOpenMode(std::string mode) {
+  this->file->setOpenMode(mode);
+}
+
+std::string ResumedManifestFile::getOpenMode() {
+  return this->file->getOpenMode();
+}
+
+size_t ResumedManifestFile::write(const char *buf, size_t len) {
+
+  this->content.append(buf, len);
+  return len;
+
+}
+
+size_t ResumedManifestFile::read(char *buf, size_t len) {
+  throw CArchiveIssue("reading from a resumed manifest file is not supported");
+}
+
+void ResumedManifestFile::remove() {
+  this->file->remove();
+}
+
+size_t ResumedManifestFile::size() {
+  return this->file->size();
+}
+
+off_t ResumedManifestFile::lseek(off_t offset, int whence) {
+  throw CArchiveIssue("seeking in a resumed manifest file is not supported");
+}
@@ -0,0 +1,678 @@
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <stream.hxx>
+#include <verify.hxx>
+
+using namespace pgbckctl;
+
+/*
+ * Size of the read buffer of a verification thread.
+ */
+#define VERIFY_BUFFER_SIZE (256 * 1024)
+
+/*
+ * WAL segment size assumed if the catalog doesn't know it.
+ */
+#define VERIFY_DEFAULT_WAL_SEGMENT_SIZE (16 * 1024 * 1024)
+
+/* ****************************************************************************
+ * Implementation BaseBackupVerifier
+ * ****************************************************************************/
+
+BaseBackupVerifier::BaseBackupVerifier(std::shared_ptr<BaseBackupDescr> bbdescr,
+                                       path logdir,
+                                       unsigned int parallel) {
+
+  if (bbdescr == nullptr) {
+    throw CArchiveIssue("basebackup verification requires a valid basebackup descriptor");
+  }
+
+  this->bbdescr = bbdescr;
+  this->logdir = logdir;
+  this->bytes = 0;
+
+  if (parallel == 0)
+    parallel = std::thread::hardware_concurrency();
+
+  this->parallel = std::max(1U, std::min(parallel, (unsigned int) MAX_PARALLEL_COPY_INSTANCES));
+
+}
+
+BaseBackupVerifier::~BaseBackupVerifier() {}
+
+/*
+ * Paths of files with names not representable in UTF-8
+ * are stored hex encoded.
+ */
+static std::string verify_decode_path(std::string encoded) {
+
+  std::string result;
+
+  for (std::string::size_type i = 0; i + 1 < encoded.length(); i += 2)
+    result += (char) strtol(encoded.substr(i, 2).c_str(), NULL, 16);
+
+  return result;
+
+}
+
+void BaseBackupVerifier::readManifest(std::string content) {
+
+  namespace pt = boost::property_tree;
+
+  pt::ptree manifest_tree;
+  std::istringstream iss(content);
+
+  try {
+    pt::read_json(iss, manifest_tree);
+  } catch (pt::json_parser_error &e) {
+    std::ostringstream oss;
+    oss << "could not parse backup manifest: " << e.what();
+    throw CArchiveIssue(oss.str());
+  }
+
+  for (auto &item : manifest_tree.get_child("Files", pt::ptree())) {
+
+    manifest_file entry;
+    std::string file_path = item.second.get<std::string>("Path", "");
+
+    if (file_path.length() == 0)
+      file_path = verify_decode_path(item.second.get<std::string>("Encoded-Path", ""));
+
+    entry.size = item.second.get<unsigned long long>("Size", 0);
+    entry.algorithm = item.second.get<std::string>("Checksum-Algorithm", "NONE");
+    entry.checksum = item.second.get<std::string>("Checksum", "");
+
+    this->manifest[file_path] = entry;
+
+  }
+
+  for (auto &item : manifest_tree.get_child("WAL-Ranges", pt::ptree())) {
+
+    wal_range range;
+
+    range.timeline = item.second.get<unsigned int>("Timeline", 0);
+    range.start = item.second.get<std::string>("Start-LSN", "");
+    range.end = item.second.get<std::string>("End-LSN", "");
+
+    this->wal_ranges.push_back(range);
+
+  }
+
+  this->manifest_loaded = true;
+  this->verifyManifestChecksum(content, manifest_tree.get<std::string>("Manifest-Checksum", ""));
+
+}
+
+void BaseBackupVerifier::verifyManifestChecksum(std::string &content, std::string expected) {
+
+  std::string::size_type newline = std::string::npos;
+  std::shared_ptr<BackupChecksum> checksum = nullptr;
+
+  if (expected.length() == 0 || !BackupChecksum::supported("SHA256")) {
+    this->result->manifest_status = "not verified";
+    return;
+  }
+
+  /*
+   * The manifest checksum covers everything before the
+   * line with the checksum itself, which is the last one.
+   */
+  if (content.length() > 2)
+    newline = content.rfind('\n', content.length() - 2);
+
+  if (newline == std::string::npos) {
+    this->result->manifest_status = "checksum mismatch";
+    return;
+  }
+
+  checksum = BackupChecksum::get("SHA256");
+  checksum->update(content.data(), newline + 1);
+
+  if (checksum->final() == expected)
+    this->result->manifest_status = "verified";
+  else
+    this->result->manifest_status = "checksum mismatch";
+
+}
+
+std::string BaseBackupVerifier::archivePrefix(std::string archive_name) {
+
+  std::string name = archive_name.substr(0, archive_name.length() - 4);
+  unsigned int spcoid;
+
+  if (name == "base")
+    return "";
+
+  if (name == "pg_wal")
+    return "pg_wal/";
+
+  if (name.find_first_not_of("0123456789") != std::string::npos) {
+    return "";
+  }
+
+  /*
+   * Streams of PostgreSQL before 15 name every archive by the
+   * OID of its tablespace, including the data directory.
+   */
+  spcoid = CPGBackupCtlBase::strToUInt(name);
+
+  if (spcoid == 0)
+    return "";
+
+  for (auto &tablespace : this->bbdescr->tablespaces) {
+
+    if (tablespace.spcoid == spcoid && tablespace.spclocation.length() == 0)
+      return "";
+
+  }
+
+  return "pg_tblspc/" + name + "/";
+
+}
+
+void BaseBackupVerifier::record(std::string file_path,
+                                std::string archive,
+                                unsigned long long size,
+                                std::shared_ptr<BackupChecksum> checksum) {
+
+  verify_file_result file;
+  auto it = this->manifest.find(file_path);
+
+  file.path = file_path;
+  file.archive = archive;
+  file.size = size;
+
+  if (it == this->manifest.end()) {
+
+    /* Without manifest, we can only tell the file was readable */
+    file.status = this->manifest_loaded ? VERIFY_FILE_NOT_IN_MANIFEST : VERIFY_FILE_NO_CHECKSUM;
+
+  } else {
+
+    file.algorithm = it->second.algorithm;
+    file.expected = it->second.checksum;
+
+    if (size != it->second.size) {
+      file.status = VERIFY_FILE_SIZE_MISMATCH;
+    } else if (checksum == nullptr) {
+      file.status = VERIFY_FILE_NO_CHECKSUM;
+    } else {
+
+      file.computed = checksum->final();
+
+      if (boost::iequals(file.computed, file.expected))
+        file.status = VERIFY_FILE_OK;
+      else
+        file.status = VERIFY_FILE_CHECKSUM_MISMATCH;
+
+    }
+
+  }
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+
+  if (it != this->manifest.end())
+    it->second.found = true;
+
+  this->result->files.push_back(file);
+
+}
+
+/*
+ * Returns a checksum instance suitable for the given file
+ * of the manifest, nullptr if there's nothing to check.
+ */
+static std::shared_ptr<BackupChecksum> verify_checksum_for(std::string algorithm) {
+
+  if (algorithm == "NONE" || !BackupChecksum::supported(algorithm))
+    return nullptr;
+
+  return BackupChecksum::get(algorithm);
+
+}
+
+void BaseBackupVerifier::readMembers(path archive,
+                                     std::string prefix,
+                                     std::shared_ptr<TarStreamSource> source,
+                                     size_t count,
+                                     char *buf) {
+
+  TarArchiveReader reader(source);
+  tar_member member;
+  size_t members = 0;
+  size_t n;
+
+  while ((count == 0 || members < count) && reader.next(member)) {
+
+    std::string file_path = prefix + member.name;
+    std::shared_ptr<BackupChecksum> checksum = nullptr;
+    auto it = this->manifest.find(file_path);
+
+    members++;
+
+    if (member.type != '0' && member.type != '7')
+      continue;
+
+    if (file_path.compare(0, 7, "pg_wal/") == 0) {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      this->wal_in_backup.insert(path(file_path).filename().string());
+      continue;
+    }
+
+    if (it != this->manifest.end())
+      checksum = verify_checksum_for(it->second.algorithm);
+
+    while ((n = reader.read(buf, VERIFY_BUFFER_SIZE)) > 0) {
+
+      if (checksum != nullptr)
+        checksum->update(buf, n);
+
+      this->bytes += n;
+
+    }
+
+    this->record(file_path, archive.filename().string(), member.size, checksum);
+
+  }
+
+}
+
+void BaseBackupVerifier::addTarArchive(path archive, std::vector<verify_unit> &units) {
+
+  std::string archive_name = TarStreamSource::archiveName(archive);
+  std::string prefix = this->archivePrefix(archive_name);
+  std::shared_ptr<TarStreamSource> source = nullptr;
+  std::shared_ptr<TarArchiveIndex> index = std::make_shared<TarArchiveIndex>(archive);
+  std::vector<tar_member> members;
+  bool indexed = index->load();
+
+  /*
+   * Compressed archives are read sequentially. With an index, each
+   * of its compressed frames is a unit of its own, without one the
+   * whole archive is read by a single thread.
+   */
+  if (archive.filename().string() != archive_name) {
+
+    std::vector<tar_member> &entries = index->getMembers();
+    size_t first = 0;
+
+    if (!indexed || entries.empty()) {
+
+      units.push_back([this, archive, prefix](char *buf) {
+          this->readMembers(archive, prefix, TarStreamSource::open(archive), 0, buf);
+        });
+
+      return;
+
+    }
+
+    for (size_t i = 1; i <= entries.size(); i++) {
+
+      if (i < entries.size() && entries[i].frame_offset == entries[first].frame_offset)
+        continue;
+
+      tar_member start = entries[first];
+      size_t count = i - first;
+
+      units.push_back([this, archive, prefix, index, start, count](char *buf) mutable {
+          this->readMembers(archive, prefix, index->open(start), count, buf);
+        });
+
+      first = i;
+
+    }
+
+    return;
+
+  }
+
+  /*
+   * Uncompressed archives are indexed here unless their index was
+   * written while streaming, each member then is an independent
+   * unit read with pread().
+   */
+  source = TarStreamSource::open(archive);
+
+  if (!indexed) {
+
+    TarArchiveReader reader(source);
+    tar_member member;
+
+    while (reader.next(member))
+      members.push_back(member);
+
+  } else {
+    members = index->getMembers();
+  }
+
+  for (auto &member : members) {
+
+    std::string file_path = prefix + member.name;
+
+    if (member.type != '0' && member.type != '7')
+      continue;
+
+    if (file_path.compare(0, 7, "pg_wal/") == 0) {
+      this->wal_in_backup.insert(path(file_path).filename().string());
+      continue;
+    }
+
+    units.push_back([this, archive, source, member, file_path](char *buf) {
+
+        std::shared_ptr<BackupChecksum> checksum = nullptr;
+        auto it = this->manifest.find(file_path);
+        unsigned long long offset = member.data_offset;
+        unsigned long long remaining = member.size;
+
+        if (it != this->manifest.end())
+          checksum = verify_checksum_for(it->second.algorithm);
+
+        while (remaining > 0) {
+
+          size_t len = (remaining > VERIFY_BUFFER_SIZE) ? VERIFY_BUFFER_SIZE : (size_t) remaining;
+
+          if (source->pread(buf, len, offset) != len) {
+            std::ostringstream oss;
+            oss << "unexpected end of tar archive while reading \"" << member.name << "\"";
+            throw CArchiveIssue(oss.str());
+          }
+
+          if (checksum != nullptr)
+            checksum->update(buf, len);
+
+          this->bytes += len;
+          offset += len;
+          remaining -= len;
+
+        }
+
+        this->record(file_path, archive.filename().string(), member.size, checksum);
+
+      });
+
+  }
+
+}
+
+void BaseBackupVerifier::addPlainFiles(path directory, std::vector<verify_unit> &units) {
+
+  /*
+   * A plain basebackup is the extracted tar stream, tablespaces
+   * are extracted into the same directory as the data directory.
+   */
+  for (auto &item : this->manifest) {
+
+    std::string file_path = item.first;
+
+    units.push_back([this, directory, file_path](char *buf) {
+
+        path file = directory / file_path;
+        std::shared_ptr<BackupChecksum> checksum = nullptr;
+        std::shared_ptr<TarFileSource> source = nullptr;
+        unsigned long long size = 0;
+        size_t n;
+
+        if (!boost::filesystem::exists(file)
+            && file_path.compare(0, 10, "pg_tblspc/") == 0) {
+
+          std::string::size_type pos = file_path.find('/', 10);
+
+          if (pos != std::string::npos)
+            file = directory / file_path.substr(pos + 1);
+
+        }
+
+        /* recorded as missing later */
+        if (!boost::filesystem::is_regular_file(file))
+          return;
+
+        checksum = verify_checksum_for(this->manifest.find(file_path)->second.algorithm);
+        source = std::make_shared<TarFileSource>(file);
+
+        while ((n = source->read(buf, VERIFY_BUFFER_SIZE)) > 0) {
+
+          if (checksum != nullptr)
+            checksum->update(buf, n);
+
+          size += n;
+          this->bytes += n;
+
+        }
+
+        source->close();
+        this->record(file_path, "", size, checksum);
+
+      });
+
+  }
+
+}
+
+void BaseBackupVerifier::verifyWAL(unsigned int timeline,
+                                   std::string start,
+                                   std::string end) {
+
+  unsigned long long segsize = this->bbdescr->wal_segment_size;
+  XLogRecPtr startpos;
+  XLogRecPtr endpos;
+  XLogRecPtr segpos;
+
+  if (segsize == 0)
+    segsize = VERIFY_DEFAULT_WAL_SEGMENT_SIZE;
+
+  try {
+    startpos = PGStream::decodeXLOGPos(start);
+    endpos = PGStream::decodeXLOGPos(end);
+  } catch (CPGBackupCtlFailure &e) {
+    this->result->errors.push_back("invalid WAL range " + start + " - " + end);
+    return;
+  }
+
+  /*
+   * Every segment from the one containing the start position up to
+   * the one containing the last byte before the end position is
+   * required.
+   */
+  for (segpos = startpos - (startpos % segsize);
+       segpos < endpos || segpos <= startpos;
+       segpos += segsize) {
+
+    std::string segment = ArchiveLogDirectory::XLogFileByRecPtr(segpos, timeline, segsize);
+    std::vector<std::string> suffixes = { "", ".gz", ".partial", ".partial.gz" };
+    bool found = false;
+
+    this->result->wal_segments++;
+
+    /* WAL streamed along with the basebackup */
+    if (this->wal_in_backup.find(segment) != this->wal_in_backup.end())
+      continue;
+
+    for (auto &suffix : suffixes) {
+
+      if (boost::filesystem::exists(this->logdir / (segment + suffix))) {
+        found = true;
+        break;
+      }
+
+    }
+
+    /* plain basebackups have their WAL extracted */
+    if (!found)
+      found = boost::filesystem::exists(path(this->bbdescr->fsentry) / "pg_wal" / segment);
+
+    if (!found)
+      this->result->wal_missing.push_back(segment);
+
+  }
+
+}
+
+std::shared_ptr<BaseBackupVerifyResult> BaseBackupVerifier::verify() {
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  BaseBackupVerificationCode code = StreamingBaseBackupDirectory::verify(this->bbdescr);
+  StreamingBaseBackupDirectory bbdir(path(this->bbdescr->fsentry));
+  std::vector<verify_unit> units;
+  std::vector<path> archives;
+  std::vector<std::thread> threads;
+  std::atomic<size_t> next_unit(0);
+  std::string manifest_content = "";
+  bool have_manifest = false;
+
+  if (code != BASEBACKUP_OK) {
+    std::ostringstream oss;
+    oss << "cannot verify basebackup " << this->bbdescr->id << ": "
+        << BackupDirectory::verificationCodeAsString(code);
+    throw CArchiveIssue(oss.str());
+  }
+
+  this->result = std::make_shared<BaseBackupVerifyResult>();
+  this->result->basebackup_id = this->bbdescr->id;
+  this->result->fsentry = this->bbdescr->fsentry;
+  this->result->parallel = this->parallel;
+  this->result->checksum_implementation = BackupChecksum::implementation("CRC32C");
+  this->manifest.clear();
+  this->manifest_loaded = false;
+  this->wal_ranges.clear();
+  this->wal_in_backup.clear();
+  this->bytes = 0;
+
+  try {
+    manifest_content = bbdir.manifest();
+    have_manifest = true;
+  } catch (CArchiveIssue &e) {
+    BOOST_LOG_TRIVIAL(debug) << "DEBUG: " << e.what();
+  }
+
+  /*
+   * Queue the contents of the basebackup.
+   */
+  for (directory_iterator it(path(this->bbdescr->fsentry)); it != directory_iterator(); ++it) {
+
+    if (is_regular_file(it->path()) && TarStreamSource::isTarArchive(it->path()))
+      archives.push_back(it->path());
+
+  }
+
+  std::sort(archives.begin(), archives.end());
+
+  if (have_manifest) {
+
+    try {
+      this->readManifest(manifest_content);
+    } catch (CPGBackupCtlFailure &e) {
+      this->result->manifest_status = "invalid";
+      this->result->errors.push_back(e.what());
+    }
+
+  }
+
+  for (auto &archive : archives) {
+
+    try {
+      this->addTarArchive(archive, units);
+    } catch (CPGBackupCtlFailure &e) {
+      this->result->errors.push_back(archive.filename().string() + ": " + e.what());
+    }
+
+  }
+
+  if (archives.size() == 0)
+    this->addPlainFiles(path(this->bbdescr->fsentry), units);
+
+  /*
+   * Work through all units with the requested number of threads.
+   */
+  for (unsigned int i = 0; i < std::min((size_t) this->parallel, units.size()); i++) {
+
+    threads.push_back(std::thread([this, &units, &next_unit]() {
+
+          std::unique_ptr<char[]> buf(new char[VERIFY_BUFFER_SIZE]);
+          size_t unit;
+
+          while ((unit = next_unit++) < units.size()) {
+
+            try {
+              units[unit](buf.get());
+            } catch (std::exception &e) {
+              std::lock_guard<std::mutex> lock(this->mtx);
+              this->result->errors.push_back(e.what());
+            }
+
+          }
+
+        }));
+
+  }
+
+  for (auto &thread : threads)
+    thread.join();
+
+  /*
+   * Everything left in the manifest wasn't found.
+   */
+  for (auto &item : this->manifest) {
+
+    if (!item.second.found) {
+
+      verify_file_result file;
+
+      file.path = item.first;
+      file.size = item.second.size;
+      file.algorithm = item.second.algorithm;
+      file.expected = item.second.checksum;
+      file.status = VERIFY_FILE_MISSING;
+
+      this->result->files.push_back(file);
+
+    }
+
+  }
+
+  std::sort(this->result->files.begin(), this->result->files.end(),
+            [](verify_file_result const &a, verify_file_result const &b) {
+              return a.path < b.path;
+            });
+
+  /*
+   * The WAL range is checked after the archives were read, since
+   * required segments might be part of the basebackup itself.
+   * Without a manifest, use the range recorded in the catalog.
+   */
+  if (this->wal_ranges.size() == 0 && this->bbdescr->xlogposend.length() > 0) {
+
+    wal_range range;
+
+    range.timeline = this->bbdescr->timeline;
+    range.start = this->bbdescr->xlogpos;
+    range.end = this->bbdescr->xlogposend;
+
+    this->wal_ranges.push_back(range);
+
+  }
+
+  for (auto &range : this->wal_ranges) {
+
+    if (this->result->wal_start.length() == 0)
+      this->result->wal_start = range.start;
+
+    this->result->timeline = range.timeline;
+    this->result->wal_end = range.end;
+
+    this->verifyWAL(range.timeline, range.start, range.end);
+
+  }
+
+  this->result->bytes = this->bytes;
+  this->result->elapsed_msec = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+  return this->result;
+
+}
@@ -0,0 +1,249 @@
+#include <string.h>
+#include <algorithm>
+
+#include <fs-archive.hxx>
+#include <shm.hxx>
+#include <stream.hxx>
+#include <writepipeline.hxx>
+
+using namespace pgbckctl;
+
+/* ****************************************************************************
+ * Implementation BackupWritePipeline
+ * ****************************************************************************/
+
+BackupWritePipeline::BackupWritePipeline(unsigned int buffers, size_t buffer_size) {
+
+  if (buffers == 0 || buffer_size == 0) {
+    throw StreamingFailure("write pipeline requires at least one buffer");
+  }
+
+  this->buffer_size = buffer_size;
+  this->queue_depth = 0;
+  this->receiver_stall_nsec = 0;
+  this->writer_idle_nsec = 0;
+
+  for (unsigned int i = 0; i < buffers; i++) {
+
+    std::unique_ptr<write_buffer> buf(new write_buffer());
+
+    buf->data.reset(new char[buffer_size]);
+    this->free_buffers.push(buf.get());
+    this->pool.push_back(std::move(buf));
+
+  }
+
+  this->writer = std::thread(&BackupWritePipeline::drain, this);
+
+}
+
+BackupWritePipeline::~BackupWritePipeline() {
+
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->shutdown = true;
+  }
+
+  this->buffer_filled.notify_all();
+  this->buffer_freed.notify_all();
+
+  if (this->writer.joinable())
+    this->writer.join();
+
+}
+
+void BackupWritePipeline::setIOGovernor(std::shared_ptr<IOGovernor> governor) {
+
+  std::lock_guard<std::mutex> lock(this->mtx);
+  this->governor = governor;
+
+}
+
+void BackupWritePipeline::rethrow() {
+
+  if (this->error != nullptr)
+    std::rethrow_exception(this->error);
+
+}
+
+void BackupWritePipeline::drain() {
+
+  std::unique_lock<std::mutex> lock(this->mtx);
+
+  while (true) {
+
+    write_buffer *buf;
+    std::shared_ptr<IOGovernor> io_governor;
+    long long start = IOGovernor::now();
+
+    this->buffer_filled.wait(lock, [this] {
+        return this->shutdown || !this->filled_buffers.empty();
+      });
+
+    this->writer_idle_nsec += IOGovernor::now() - start;
+
+    if (this->shutdown)
+      break;
+
+    buf = this->filled_buffers.front();
+    this->filled_buffers.pop();
+    this->queue_depth = this->filled_buffers.size();
+    this->writing = true;
+    io_governor = this->governor;
+
+    /*
+     * After an error, everything still queued is discarded, the
+     * receiver gets the error with its next call anyways. Buffers
+     * must be returned nevertheless, otherwise it would wait forever.
+     */
+    if (this->error == nullptr) {
+
+      lock.unlock();
+
+      try {
+
+        if (io_governor != nullptr)
+          io_governor->acquire(buf->len);
+
+        buf->file->write(buf->data.get(), buf->len);
+
+      } catch (...) {
+
+        lock.lock();
+        this->error = std::current_exception();
+        lock.unlock();
+
+      }
+
+      lock.lock();
+
+    }
+
+    buf->file = nullptr;
+    buf->len = 0;
+    this->free_buffers.push(buf);
+    this->writing = false;
+
+    this->buffer_freed.notify_all();
+
+  }
+
+}
+
+void BackupWritePipeline::acquire(std::shared_ptr<BackupFile> file) {
+
+  std::unique_lock<std::mutex> lock(this->mtx);
+  long long start = IOGovernor::now();
+
+  this->buffer_freed.wait(lock, [this] {
+      return this->shutdown || !this->free_buffers.empty();
+    });
+
+  this->receiver_stall_nsec += IOGovernor::now() - start;
+
+  this->rethrow();
+
+  if (this->shutdown) {
+    throw StreamingFailure("write pipeline was shut down");
+  }
+
+  this->current = this->free_buffers.front();
+  this->free_buffers.pop();
+  this->current->file = file;
+  this->current->len = 0;
+
+}
+
+void BackupWritePipeline::submit() {
+
+  if (this->current == nullptr)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mtx);
+
+    if (this->current->len > 0) {
+      this->filled_buffers.push(this->current);
+      this->queue_depth = this->filled_buffers.size();
+    } else {
+      this->free_buffers.push(this->current);
+    }
+
+    this->current = nullptr;
+  }
+
+  this->buffer_filled.notify_one();
+
+}
+
+void BackupWritePipeline::write(std::shared_ptr<BackupFile> file,
+                                const char *data,
+                                size_t len) {
+
+  if (file == nullptr) {
+    throw StreamingFailure("write pipeline requires a valid file handle");
+  }
+
+  /* A new file always starts with a new buffer */
+  if (this->current != nullptr && this->current->file != file)
+    this->submit();
+
+  while (len > 0) {
+
+    size_t n;
+
+    if (this->current == nullptr)
+      this->acquire(file);
+
+    n = std::min(len, this->buffer_size - this->current->len);
+
+    /* The buffer is ours until submitted, so no lock required */
+    memcpy(this->current->data.get() + this->current->len, data, n);
+    this->current->len += n;
+    data += n;
+    len -= n;
+
+    if (this->current->len == this->buffer_size)
+      this->submit();
+
+  }
+
+}
+
+void BackupWritePipeline::flush() {
+
+  long long start;
+
+  this->submit();
+
+  std::unique_lock<std::mutex> lock(this->mtx);
+
+  start = IOGovernor::now();
+
+  this->buffer_freed.wait(lock, [this] {
+      return this->shutdown || (this->filled_buffers.empty() && !this->writing);
+    });
+
+  this->receiver_stall_nsec += IOGovernor::now() - start;
+
+  this->rethrow();
+
+}
+
+unsigned int BackupWritePipeline::depth() {
+
+  return this->queue_depth;
+
+}
+
+long long BackupWritePipeline::receiverStallMsec() {
+
+  return this->receiver_stall_nsec / 1000000LL;
+
+}
+
+long long BackupWritePipeline::writerIdleMsec() {
+
+  return this->writer_idle_nsec / 1000000LL;
+
+}
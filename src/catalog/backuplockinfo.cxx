@@ -91,6 +91,34 @@ BackupLockInfoType BackupPinnedValidLockInfo::locked(std::shared_ptr<BaseBackupD
 
 }
 
+/* ****************************************************************************
+ * Incremental basebackup parent lock info implementation.
+ * ****************************************************************************/
+
+BackupIncrementalLockInfo::BackupIncrementalLockInfo(std::vector<std::shared_ptr<BaseBackupDescr>> &list) {
+
+  for (auto &backup : list) {
+
+    /* an aborted incremental basebackup doesn't need its parent anymore */
+    if (backup->parent_id >= 0
+        && backup->status != BaseBackupDescr::BASEBACKUP_STATUS_ABORTED)
+      parents.insert(backup->parent_id);
+
+  }
+
+}
+
+BackupIncrementalLockInfo::~BackupIncrementalLockInfo() {}
+
+BackupLockInfoType BackupIncrementalLockInfo::locked(std::shared_ptr<BaseBackupDescr> backup) {
+
+  if (parents.find(backup->id) != parents.end())
+    return LOCKED_BY_INCREMENTAL;
+
+  return NOT_LOCKED;
+
+}
+
 /* ****************************************************************************
  * Shared memory lock info.
  * ****************************************************************************/
@@ -131,17 +159,19 @@ BackupLockInfoType SHMBackupLockInfo::locked(std::shared_ptr<BaseBackupDescr> ba
   }
 
   /*
-   * Get a lock on the shared memory segment, check if the
-   * requested basebackup ID is in use.
+   * Check if the requested basebackup ID is in use.
    *
    * We need to loop through all worker slots and have a look
    * into possible child slots. This is rather expensive, but we
-   * expect the list not to be very long.
+   * expect the list not to be very long. Each slot is copied
+   * consistently by WorkerSHM::read() without locking the shared
+   * memory segment.
    */
-  WORKER_SHM_CRITICAL_SECTION_START_P(worker_shm);
-
   for (unsigned int i = 0; i < worker_shm->getMaxWorkers(); i++) {
 
+    if (worker_shm->isEmpty(i))
+      continue;
+
     shm_worker_area worker_info = worker_shm->read(i);
 
     /**
@@ -152,7 +182,7 @@ BackupLockInfoType SHMBackupLockInfo::locked(std::shared_ptr<BaseBackupDescr> ba
 
       for(unsigned int j = 0; j < MAX_WORKER_CHILDS; j++) {
 
-        sub_worker_info child_info = worker_shm->read(i, j);
+        sub_worker_info child_info = worker_info.child_info[j];
 
         /* Valid PID registered on this child slot? */
         if (child_info.pid > 0) {
@@ -175,8 +205,6 @@ BackupLockInfoType SHMBackupLockInfo::locked(std::shared_ptr<BaseBackupDescr> ba
 
   } /* outer worker slot loop */
 
-  WORKER_SHM_CRITICAL_SECTION_END;
-
   return result;
 
 }
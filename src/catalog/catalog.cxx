@@ -55,6 +55,9 @@ std::vector<std::string> BackupCatalog::backupCatalogCols =
     "wal_segment_size",
     "used_profile",
     "pg_version_num",
+    "parent_id",
+    "bad_pages",
+    "bad_pages_detail",
 
     /* the following are computed columns with no materialized representation */
     "strftime('%H hours %M minutes %S seconds', julianday(stopped, 'utc') - julianday(started, 'utc'), '12:00') AS duration ",
@@ -87,7 +90,12 @@ std::vector<std::string>BackupCatalog::backupProfilesCatalogCols =
     "wait_for_wal",
     "noverify_checksums",
     "manifest",
-    "manifest_checksums"
+    "manifest_checksums",
+    "compress_on_server",
+    "compress_level",
+    "compress_workers",
+    "deduplicate",
+    "verify_pages"
   };
 
 std::vector<std::string>BackupCatalog::backupTablespacesCatalogCols =
@@ -95,7 +103,9 @@ std::vector<std::string>BackupCatalog::backupTablespacesCatalogCols =
     "backup_id",
     "spcoid",
     "spclocation",
-    "spcsize"
+    "spcsize",
+    "checksum_algorithm",
+    "checksum"
   };
 
 std::vector<std::string>BackupCatalog::procsCatalogCols =
@@ -189,6 +199,62 @@ std::string BackupProfileDescr::compressionType(BackupProfileCompressType type)
 
 }
 
+std::string BackupProfileDescr::serverCompressionMethod(BackupProfileCompressType type) {
+
+  switch(type) {
+  case BACKUP_COMPRESS_TYPE_GZIP:
+    return "gzip";
+  case BACKUP_COMPRESS_TYPE_LZ4:
+    return "lz4";
+  case BACKUP_COMPRESS_TYPE_ZSTD:
+    return "zstd";
+  default:
+    throw CPGBackupCtlFailure("compression type " + BackupProfileDescr::compressionType(type)
+                              + " not supported on server");
+  }
+
+}
+
+std::string BackupProfileDescr::serverCompressionSuffix(BackupProfileCompressType type) {
+
+  switch(type) {
+  case BACKUP_COMPRESS_TYPE_GZIP:
+    return ".gz";
+  case BACKUP_COMPRESS_TYPE_LZ4:
+    return ".lz4";
+  case BACKUP_COMPRESS_TYPE_ZSTD:
+    return ".zst";
+  default:
+    throw CPGBackupCtlFailure("compression type " + BackupProfileDescr::compressionType(type)
+                              + " not supported on server");
+  }
+
+}
+
+std::string BackupProfileDescr::compressionString() {
+
+  std::ostringstream oss;
+
+  oss << BackupProfileDescr::compressionType(this->compress_type);
+
+  if (this->compress_on_server) {
+
+    oss << " (server";
+
+    if (this->compress_level > 0)
+      oss << ", level " << this->compress_level;
+
+    if (this->compress_workers > 0)
+      oss << ", " << this->compress_workers << " workers";
+
+    oss << ")";
+
+  }
+
+  return oss.str();
+
+}
+
 BasicPinDescr::BasicPinDescr() {
   this->tag = EMPTY_DESCR;
 }
@@ -574,6 +640,9 @@ CatalogDescr& CatalogDescr::operator=(CatalogDescr& source) {
   this->directory = source.directory;
   this->check_connection = source.check_connection;
   this->force_systemid_update = source.force_systemid_update;
+  this->incremental = source.incremental;
+  this->resume = source.resume;
+  this->dry_run = source.dry_run;
   this->forceXLOGPosRestart = source.forceXLOGPosRestart;
   this->coninfo->pghost = source.coninfo->pghost;
   this->coninfo->pgport = source.coninfo->pgport;
@@ -583,6 +652,8 @@ CatalogDescr& CatalogDescr::operator=(CatalogDescr& source) {
   this->coninfo->type = source.coninfo->type;
   this->basebackup_id = source.basebackup_id;
   this->verbose_output = source.verbose_output;
+  this->worker_pid = source.worker_pid;
+  this->parallel = source.parallel;
 
   /* job control */
   this->detach = source.detach;
@@ -634,6 +705,18 @@ CatalogDescr& CatalogDescr::operator=(CatalogDescr& source) {
   if (source.getRecoveryStreamDescr() != nullptr)
     this->recoveryStream = source.getRecoveryStreamDescr();
 
+  /*
+   * Same for the metrics server descriptor.
+   */
+  if (source.getMetricsServerDescr() != nullptr)
+    this->metricsServer = source.getMetricsServerDescr();
+
+  /*
+   * ... and the schedule descriptor.
+   */
+  if (source.getScheduleDescr() != nullptr)
+    this->schedule = source.getScheduleDescr();
+
   /*
    * Copy over restore descriptor, if defined.
    */
@@ -854,6 +937,109 @@ void CatalogDescr::setRecoveryStreamPort(std::string const& portnumber) {
 
 }
 
+std::shared_ptr<MetricsServerDescr> CatalogDescr::getMetricsServerDescr() {
+
+  return this->metricsServer;
+
+}
+
+void CatalogDescr::makeMetricsServerDescr() {
+
+  if (this->metricsServer != nullptr) {
+    throw CCatalogIssue("metrics server descriptor already initialized");
+  }
+
+  this->metricsServer = std::make_shared<MetricsServerDescr>();
+
+}
+
+void CatalogDescr::setMetricsServerAddr(std::string const& address) {
+
+  /* If the metrics server descriptor wasn't initialized yet, abort */
+  if (this->metricsServer == nullptr)
+    throw CCatalogIssue("metrics server descriptor not initialized yet");
+
+  if (address.length() == 0)
+    throw CCatalogIssue("cannot add empty address to metrics server descriptor");
+
+  /*
+   * Like recovery streams, we only support a single
+   * bind address.
+   */
+  if (this->metricsServer->listen_on.size() >= 1) {
+    throw CCatalogIssue("multiple bind addresses not supported yet");
+  }
+
+  this->metricsServer->listen_on.push_back(address);
+
+}
+
+void CatalogDescr::setMetricsServerPort(std::string const& portnumber) {
+
+  /* If the metrics server descriptor wasn't initialized yet, abort */
+  if (this->metricsServer == nullptr)
+    throw CCatalogIssue("metrics server descriptor not initialized yet");
+
+  /* Something between 0 and 65535 ... */
+  this->metricsServer->port = CPGBackupCtlBase::strToInt(portnumber);
+
+  if (this->metricsServer->port >= 65536)
+    throw CCatalogIssue("port number cannot be above 65535");
+
+}
+
+std::shared_ptr<ScheduleDescr> CatalogDescr::getScheduleDescr() {
+
+  return this->schedule;
+
+}
+
+void CatalogDescr::makeScheduleDescr() {
+
+  if (this->schedule != nullptr) {
+    throw CCatalogIssue("schedule descriptor already initialized");
+  }
+
+  this->schedule = std::make_shared<ScheduleDescr>();
+
+}
+
+void CatalogDescr::setScheduleName(std::string const& name) {
+
+  if (this->schedule == nullptr)
+    throw CCatalogIssue("schedule descriptor not initialized yet");
+
+  this->schedule->name = name;
+
+}
+
+void CatalogDescr::setScheduleCron(std::string const& cron) {
+
+  if (this->schedule == nullptr)
+    throw CCatalogIssue("schedule descriptor not initialized yet");
+
+  this->schedule->cron = cron;
+
+}
+
+void CatalogDescr::setScheduleAction(ScheduleAction const& action) {
+
+  if (this->schedule == nullptr)
+    throw CCatalogIssue("schedule descriptor not initialized yet");
+
+  this->schedule->action = action;
+
+}
+
+void CatalogDescr::setScheduleParam(std::string const& param) {
+
+  if (this->schedule == nullptr)
+    throw CCatalogIssue("schedule descriptor not initialized yet");
+
+  this->schedule->param = param;
+
+}
+
 void CatalogDescr::setPrintVerbose(bool const& verbose) {
   this->verbose_output = verbose;
 }
@@ -1317,6 +1503,18 @@ std::string CatalogDescr::commandTagName(CatalogTag tag) {
     return "RESTORE";
   case STAT_ARCHIVE_BASEBACKUP:
     return "STAT ARCHIVE";
+  case START_METRICS_SERVER:
+    return "START METRICS SERVER";
+  case CREATE_SCHEDULE:
+    return "CREATE SCHEDULE";
+  case DROP_SCHEDULE:
+    return "DROP SCHEDULE";
+  case LIST_SCHEDULES:
+    return "LIST SCHEDULES";
+  case SHOW_EVENTS:
+    return "SHOW EVENTS";
+  case VERIFY_BASEBACKUP:
+    return "VERIFY BASEBACKUP";
 
   default:
     return "UNKNOWN";
@@ -1345,6 +1543,31 @@ void CatalogDescr::setProfileManifestChecksumsIdent(std::string const& manifest_
 
 }
 
+void CatalogDescr::setProfileCompressOnServer(bool const& on_server) {
+  this->backup_profile->compress_on_server = on_server;
+  this->backup_profile->pushAffectedAttribute(SQL_BCK_PROF_COMPRESS_ON_SERVER_ATTNO);
+}
+
+void CatalogDescr::setProfileCompressLevel(std::string const& level) {
+  this->backup_profile->compress_level = CPGBackupCtlBase::strToInt(level);
+  this->backup_profile->pushAffectedAttribute(SQL_BCK_PROF_COMPRESS_LEVEL_ATTNO);
+}
+
+void CatalogDescr::setProfileCompressWorkers(std::string const& workers) {
+  this->backup_profile->compress_workers = CPGBackupCtlBase::strToInt(workers);
+  this->backup_profile->pushAffectedAttribute(SQL_BCK_PROF_COMPRESS_WORKERS_ATTNO);
+}
+
+void CatalogDescr::setProfileDeduplicate(bool const& deduplicate) {
+  this->backup_profile->deduplicate = deduplicate;
+  this->backup_profile->pushAffectedAttribute(SQL_BCK_PROF_DEDUPLICATE_ATTNO);
+}
+
+void CatalogDescr::setProfileVerifyPages(bool const& verify_pages) {
+  this->backup_profile->verify_pages = verify_pages;
+  this->backup_profile->pushAffectedAttribute(SQL_BCK_PROF_VERIFY_PAGES_ATTNO);
+}
+
 void CatalogDescr::setProfileAffectedAttribute(int const& colId) {
   this->backup_profile->pushAffectedAttribute(colId);
 }
@@ -1437,10 +1660,34 @@ void CatalogDescr::setBasebackupID(std::string const &bbid) {
 
 }
 
+void CatalogDescr::setWorkerPID(std::string const &pid) {
+
+  this->worker_pid = CPGBackupCtlBase::strToInt(pid);
+
+}
+
+void CatalogDescr::setParallel(std::string const &parallel) {
+
+  this->parallel = CPGBackupCtlBase::strToUInt(parallel);
+
+}
+
 void CatalogDescr::setForceSystemIDUpdate(bool const& force_sysid_update) {
   this->force_systemid_update = force_sysid_update;
 }
 
+void CatalogDescr::setIncremental(bool const& incremental) {
+  this->incremental = incremental;
+}
+
+void CatalogDescr::setResume(bool const& resume) {
+  this->resume = resume;
+}
+
+void CatalogDescr::setDryRun(bool const& dry_run) {
+  this->dry_run = dry_run;
+}
+
 void CatalogDescr::setVerifyOption(VerifyOption const& option) {
 
   switch(option) {
@@ -1932,6 +2179,30 @@ std::shared_ptr<BaseBackupDescr> BackupCatalog::fetchBackupIntoDescr(sqlite3_stm
       descr->used_profile = sqlite3_column_int(stmt, current_stmt_col);
       break;
 
+    case SQL_BACKUP_PG_VERSION_NUM_ATTNO:
+      descr->pg_version_num = sqlite3_column_int(stmt, current_stmt_col);
+      break;
+
+    case SQL_BACKUP_PARENT_ID_ATTNO:
+      {
+        /* NULL for full basebackups */
+        if (sqlite3_column_type(stmt, current_stmt_col) != SQLITE_NULL)
+          descr->parent_id = sqlite3_column_int(stmt, current_stmt_col);
+        else
+          descr->parent_id = -1;
+
+        break;
+      }
+
+    case SQL_BACKUP_BAD_PAGES_ATTNO:
+      descr->bad_pages = sqlite3_column_int(stmt, current_stmt_col);
+      break;
+
+    case SQL_BACKUP_BAD_PAGES_DETAIL_ATTNO:
+      if (sqlite3_column_type(stmt, current_stmt_col) != SQLITE_NULL)
+        descr->bad_pages_detail = (char *) sqlite3_column_text(stmt, current_stmt_col);
+      break;
+
     case SQL_BACKUP_COMPUTED_RETENTION_DATETIME:
 
       /* this column tag identifies a computed value, be aware for nullable expressions */
@@ -2042,6 +2313,26 @@ std::shared_ptr<BackupProfileDescr> BackupCatalog::fetchBackupProfileIntoDescr(s
       descr->manifest_checksums = (char *)sqlite3_column_text(stmt, current_stmt_col);
       break;
 
+    case SQL_BCK_PROF_COMPRESS_ON_SERVER_ATTNO:
+      descr->compress_on_server = sqlite3_column_int(stmt, current_stmt_col);
+      break;
+
+    case SQL_BCK_PROF_COMPRESS_LEVEL_ATTNO:
+      descr->compress_level = sqlite3_column_int(stmt, current_stmt_col);
+      break;
+
+    case SQL_BCK_PROF_COMPRESS_WORKERS_ATTNO:
+      descr->compress_workers = sqlite3_column_int(stmt, current_stmt_col);
+      break;
+
+    case SQL_BCK_PROF_DEDUPLICATE_ATTNO:
+      descr->deduplicate = sqlite3_column_int(stmt, current_stmt_col);
+      break;
+
+    case SQL_BCK_PROF_VERIFY_PAGES_ATTNO:
+      descr->verify_pages = sqlite3_column_int(stmt, current_stmt_col);
+      break;
+
     default:
       break;
     }
@@ -2332,34 +2623,30 @@ std::shared_ptr<StatCatalogArchive> BackupCatalog::statCatalog(std::string archi
     throw CCatalogIssue("catalog database not opened");
   }
 
+  /*
+   * All counters are materialized in archive_stat, see
+   * updateArchiveStat() and friends for how they are maintained.
+   */
   query =
 "SELECT "
-  "(SELECT COUNT(*) FROM backup WHERE archive_id = a.id) AS number_of_backups, "
-  "(SELECT COUNT(*) FROM backup b "
-                   "WHERE b.archive_id = a.id "
-                         "AND b.status = 'aborted') AS backups_failed, "
-  "(SELECT COUNT(*) FROM backup b "
-                   "WHERE b.archive_id = a.id "
-                         "AND b.status = 'in progress') AS backups_running, "
+  "COALESCE(s.number_of_backups, 0) AS number_of_backups, "
+  "COALESCE(s.backups_failed, 0) AS backups_failed, "
+  "COALESCE(s.backups_running, 0) AS backups_running, "
   "a.id, "
   "a.name, "
   "a.directory, "
   "CASE WHEN length(COALESCE(c.pghost, '')) > 0 THEN c.pghost ELSE c.dsn END AS pghost, "
-  "(SELECT SUM(spcsize) FROM backup_tablespaces bt "
-                            "JOIN backup b ON b.id = bt.backup_id "
-                            "JOIN archive a2 ON a.id = b.archive_id "
-                       "WHERE a2.id = a.id) AS approx_sz, "
-  "(SELECT MAX(stopped) FROM backup b "
-                       "WHERE b.archive_id = a.id) AS latest_finished, "
-  "(SELECT CASE WHEN (started IS NOT NULL AND stopped IS NOT NULL) "
-          "THEN AVG(CAST((julianday(stopped) - julianday(started)) * 24 * 60 * 60 AS integer)) "
-          "ELSE 0 "
-          "END AS val_avg_duration "
-   "FROM "
-   "backup b "
-   "WHERE b.archive_id = a.id) AS avg_duration "
+  "COALESCE(s.approx_sz, 0) AS approx_sz, "
+  "s.latest_finished, "
+  "CASE WHEN COALESCE(s.backups_ready, 0) > 0 "
+       "THEN s.total_duration / s.backups_ready "
+       "ELSE 0 "
+  "END AS avg_duration, "
+  "COALESCE(s.wal_segments, 0) AS wal_segments, "
+  "COALESCE(s.wal_bytes, 0) AS wal_bytes "
 "FROM "
   "archive a JOIN connections c ON c.archive_id = a.id "
+  "LEFT JOIN archive_stat s ON s.archive_id = a.id "
 "WHERE "
   "a.name = ?1 AND c.type = 'basebackup';";
 
@@ -2413,12 +2700,14 @@ std::shared_ptr<StatCatalogArchive> BackupCatalog::statCatalog(std::string archi
   if (sqlite3_column_type(stmt, 6) != SQLITE_NULL)
     result->archive_host      = (char *) sqlite3_column_text(stmt, 6);
 
-  result->estimated_total_size = sqlite3_column_int(stmt, 7);
+  result->estimated_total_size = sqlite3_column_int64(stmt, 7);
 
   if (sqlite3_column_type(stmt, 8) != SQLITE_NULL)
     result->latest_finished      = (char *) sqlite3_column_text(stmt, 8);
 
   result->avg_backup_duration  = sqlite3_column_int(stmt, 9);
+  result->wal_segments         = sqlite3_column_int64(stmt, 10);
+  result->wal_bytes            = sqlite3_column_int64(stmt, 11);
 
   /*
    * We're done.
@@ -2428,182 +2717,1200 @@ std::shared_ptr<StatCatalogArchive> BackupCatalog::statCatalog(std::string archi
   return result;
 }
 
-void BackupCatalog::dropRetentionPolicy(string retention_name) {
+void BackupCatalog::updateArchiveStat(std::string assignments,
+                                      std::string filter,
+                                      std::vector<sqlite3_int64> values) {
 
-  sqlite3_stmt *stmt = NULL;
-  ostringstream delete_sql;
+  sqlite3_stmt *stmt;
+  std::ostringstream query;
   int rc;
+  int bindIndex = 1;
 
-  /*
-   * Database available ?
-   */
   if (!this->available()) {
-    throw CArchiveIssue("catalog database not opened");
+    throw CCatalogIssue("could not update archive statistics: database not opened");
   }
 
-  if (retention_name.length() < 1) {
-    throw CArchiveIssue("cannot drop retention policy with empty identifier");
-  }
+  query << "UPDATE archive_stat SET "
+        << assignments
+        << " WHERE "
+        << filter
+        << ";";
 
-  /*
-   * Compose SQL string for deletion...
-   */
-  delete_sql << "DELETE FROM retention WHERE name = ?1;";
+#ifdef __DEBUG__
+  BOOST_LOG_TRIVIAL(debug) << "DEBUG: updateArchiveStat() query: "
+                           << query.str();
+#endif
 
   rc = sqlite3_prepare_v2(this->db_handle,
-                          delete_sql.str().c_str(),
+                          query.str().c_str(),
                           -1,
                           &stmt,
                           NULL);
 
   if (rc != SQLITE_OK) {
-    ostringstream oss;
-
-    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    std::ostringstream oss;
+    oss << "could not prepare query to update archive statistics: "
+        << sqlite3_errmsg(this->db_handle);
     throw CCatalogIssue(oss.str());
   }
 
-  /*
-   * Bind retention name
-   */
-  sqlite3_bind_text(stmt, 1, retention_name.c_str(), -1, SQLITE_STATIC);
+  for (auto const& value : values) {
+    sqlite3_bind_int64(stmt, bindIndex++, value);
+  }
 
-  /*
-   * Execute the DELETE ...
-   */
   rc = sqlite3_step(stmt);
 
   if (rc != SQLITE_DONE) {
-
-    ostringstream oss;
-
-    oss << "error dropping retention policy \""
-        << retention_name
-        << "\": "
+    std::ostringstream oss;
+    oss << "error updating archive statistics: "
         << sqlite3_errmsg(this->db_handle);
     sqlite3_finalize(stmt);
-    throw CArchiveIssue(oss.str());
-
+    throw CCatalogIssue(oss.str());
   }
 
   sqlite3_finalize(stmt);
-}
 
-void BackupCatalog::createRetentionPolicy(std::shared_ptr<RetentionDescr> retentionPolicy) {
-
-  ostringstream insert;
-  sqlite3_stmt *stmt;
-  int rc;
+}
 
-  vector<int> attrsRetention;
-  vector<int> attrsRules;
+void BackupCatalog::updateArchiveWALStat(int archive_id,
+                                         long long segments,
+                                         long long bytes) {
 
   /*
-   * Database available ?
+   * Counters are deltas, negative values are
+   * used when WAL segments were removed from the archive.
    */
-  if (! this->available()) {
-    throw CCatalogIssue("catalog database not opened");
-  }
+  this->updateArchiveStat("wal_segments = MAX(wal_segments + ?2, 0), "
+                          "wal_bytes = MAX(wal_bytes + ?3, 0)",
+                          "archive_id = ?1",
+                          { archive_id, segments, bytes });
 
-  /*
-   * Prepare the insert. A retention policy is only valid to create,
-   * if there's a rule attached to it. The creation of a retention
-   * policy thus involves at least two INSERT operations, one
-   * to create the retention policy in the retention table, and another
-   * one to create the attached rule(s) in the retention_rules table.
-   *
-   * NOTE: The caller should ideally use a transaction, but we
-   *       don't force it here.
-   */
-  if (retentionPolicy->rules.size() < 1) {
-    throw CCatalogIssue("cannot create retention policy with no rules");
-  }
+}
 
-  attrsRetention.push_back(SQL_RETENTION_NAME_ATTNO);
-  attrsRetention.push_back(SQL_RETENTION_CREATED_ATTNO);
+void BackupCatalog::registerWALSegment(std::shared_ptr<WALSegmentDescr> segment) {
 
-  attrsRules.push_back(SQL_RETENTION_RULES_ID_ATTNO);
-  attrsRules.push_back(SQL_RETENTION_RULES_TYPE_ATTNO);
-  attrsRules.push_back(SQL_RETENTION_RULES_VALUE_ATTNO);
+  sqlite3_stmt *stmt = NULL;
+  int rc;
 
-  insert << "INSERT INTO retention("
-         << this->affectedColumnsToString(SQL_RETENTION_ENTITY, attrsRetention)
-         << ") VALUES(?1, datetime('now'))";
+  if (!this->available())
+    throw CCatalogIssue("catalog database not opened");
 
-#ifdef __DEBUG__
-  BOOST_LOG_TRIVIAL(debug) << "executing SQL: " << insert.str();
-#endif
+  if (segment->archive_id < 0)
+    throw CCatalogIssue("archive id required to register WAL segment");
 
+  /*
+   * A segment streamed again after a restart replaces
+   * its former row.
+   */
   rc = sqlite3_prepare_v2(this->db_handle,
-                          insert.str().c_str(),
+                          "INSERT OR REPLACE INTO wal_segments"
+                          "(archive_id, name, timeline, size, checksum_algorithm, checksum, created) "
+                          "VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7);",
                           -1,
                           &stmt,
                           NULL);
 
   if (rc != SQLITE_OK) {
     ostringstream oss;
-
-    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    oss << "could not prepare query to register WAL segment: "
+        << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
     throw CCatalogIssue(oss.str());
   }
 
-  /*
-   * Bind attributes from retention policy descriptor.
-   */
-  this->SQLbindRetentionPolicyAttributes(retentionPolicy,
-                                         attrsRetention,
-                                         stmt,
-                                         Range(1, 1));
+  if (segment->created.empty())
+    segment->created = CPGBackupCtlBase::current_timestamp();
+
+  sqlite3_bind_int(stmt, 1, segment->archive_id);
+  sqlite3_bind_text(stmt, 2, segment->name.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 3, segment->timeline);
+  sqlite3_bind_int64(stmt, 4, segment->size);
+  sqlite3_bind_text(stmt, 5, segment->checksum_algorithm.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 6, segment->checksum.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 7, segment->created.c_str(), -1, SQLITE_STATIC);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+    oss << "error registering WAL segment: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+
+}
+
+std::shared_ptr<WALSegmentDescr> BackupCatalog::getWALSegment(int archive_id,
+                                                             std::string name) {
+
+  std::shared_ptr<WALSegmentDescr> result = std::make_shared<WALSegmentDescr>();
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (!this->available())
+    throw CCatalogIssue("catalog database not opened");
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "SELECT archive_id, name, timeline, size, checksum_algorithm, checksum, created "
+                          "FROM wal_segments WHERE archive_id = ?1 AND name = ?2;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+    oss << "could not prepare query to get WAL segment: "
+        << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, archive_id);
+  sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_STATIC);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc == SQLITE_ROW) {
+
+    result->archive_id         = sqlite3_column_int(stmt, 0);
+    result->name               = (char *) sqlite3_column_text(stmt, 1);
+    result->timeline           = sqlite3_column_int(stmt, 2);
+    result->size               = sqlite3_column_int64(stmt, 3);
+    result->checksum_algorithm = (char *) sqlite3_column_text(stmt, 4);
+    result->checksum           = (char *) sqlite3_column_text(stmt, 5);
+    result->created            = (char *) sqlite3_column_text(stmt, 6);
+
+  } else if (rc != SQLITE_DONE) {
+
+    ostringstream oss;
+    oss << "error retrieving WAL segment from catalog: "
+        << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+
+  }
+
+  sqlite3_finalize(stmt);
+  return result;
+
+}
+
+void BackupCatalog::unregisterWALSegments(int archive_id,
+                                          std::vector<std::string> names) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (!this->available())
+    throw CCatalogIssue("catalog database not opened");
+
+  if (names.size() == 0)
+    return;
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "DELETE FROM wal_segments WHERE archive_id = ?1 AND name = ?2;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+    oss << "could not prepare query to unregister WAL segments: "
+        << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  for (auto &name : names) {
+
+    sqlite3_bind_int(stmt, 1, archive_id);
+    sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_STATIC);
+
+    rc = sqlite3_step(stmt);
+
+    if (rc != SQLITE_DONE) {
+      ostringstream oss;
+      oss << "error unregistering WAL segment " << name << ": "
+          << sqlite3_errmsg(this->db_handle);
+      sqlite3_finalize(stmt);
+      throw CCatalogIssue(oss.str());
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+  }
+
+  sqlite3_finalize(stmt);
+
+}
+
+void BackupCatalog::referenceChunks(int archive_id,
+                                    std::map<std::string, unsigned long long> chunks) {
+
+  sqlite3_stmt *update = NULL;
+  sqlite3_stmt *insert = NULL;
+  int rc;
+
+  if (!this->available())
+    throw CCatalogIssue("catalog database not opened");
+
+  if (chunks.size() == 0)
+    return;
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "UPDATE chunks SET refcount = refcount + 1 "
+                          "WHERE archive_id = ?1 AND hash = ?2;",
+                          -1,
+                          &update,
+                          NULL);
+
+  if (rc == SQLITE_OK)
+    rc = sqlite3_prepare_v2(this->db_handle,
+                            "INSERT INTO chunks(archive_id, hash, size, refcount) "
+                            "VALUES(?1, ?2, ?3, 1);",
+                            -1,
+                            &insert,
+                            NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+    oss << "could not prepare query to reference chunks: "
+        << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(update);
+    sqlite3_finalize(insert);
+    throw CCatalogIssue(oss.str());
+  }
+
+  for (auto &chunk : chunks) {
+
+    sqlite3_bind_int(update, 1, archive_id);
+    sqlite3_bind_text(update, 2, chunk.first.c_str(), -1, SQLITE_STATIC);
+
+    rc = sqlite3_step(update);
+
+    /* Not referenced so far, register it */
+    if (rc == SQLITE_DONE && sqlite3_changes(this->db_handle) == 0) {
+
+      sqlite3_bind_int(insert, 1, archive_id);
+      sqlite3_bind_text(insert, 2, chunk.first.c_str(), -1, SQLITE_STATIC);
+      sqlite3_bind_int64(insert, 3, chunk.second);
+
+      rc = sqlite3_step(insert);
+
+      sqlite3_reset(insert);
+      sqlite3_clear_bindings(insert);
+
+    }
+
+    if (rc != SQLITE_DONE) {
+      ostringstream oss;
+      oss << "error referencing chunk " << chunk.first << ": "
+          << sqlite3_errmsg(this->db_handle);
+      sqlite3_finalize(update);
+      sqlite3_finalize(insert);
+      throw CCatalogIssue(oss.str());
+    }
+
+    sqlite3_reset(update);
+    sqlite3_clear_bindings(update);
+
+  }
+
+  sqlite3_finalize(update);
+  sqlite3_finalize(insert);
+
+}
+
+void BackupCatalog::unreferenceChunks(int archive_id,
+                                      std::vector<std::string> hashes) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (!this->available())
+    throw CCatalogIssue("catalog database not opened");
+
+  if (hashes.size() == 0)
+    return;
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "UPDATE chunks SET refcount = refcount - 1 "
+                          "WHERE archive_id = ?1 AND hash = ?2;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+    oss << "could not prepare query to unreference chunks: "
+        << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  for (auto &hash : hashes) {
+
+    sqlite3_bind_int(stmt, 1, archive_id);
+    sqlite3_bind_text(stmt, 2, hash.c_str(), -1, SQLITE_STATIC);
+
+    rc = sqlite3_step(stmt);
+
+    if (rc != SQLITE_DONE) {
+      ostringstream oss;
+      oss << "error unreferencing chunk " << hash << ": "
+          << sqlite3_errmsg(this->db_handle);
+      sqlite3_finalize(stmt);
+      throw CCatalogIssue(oss.str());
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+  }
+
+  sqlite3_finalize(stmt);
+
+}
+
+std::vector<std::string> BackupCatalog::purgeChunks(int archive_id) {
+
+  std::vector<std::string> result;
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (!this->available())
+    throw CCatalogIssue("catalog database not opened");
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "SELECT hash FROM chunks WHERE archive_id = ?1 AND refcount <= 0;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+    oss << "could not prepare query to get unreferenced chunks: "
+        << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, archive_id);
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    result.push_back((char *) sqlite3_column_text(stmt, 0));
+
+  sqlite3_finalize(stmt);
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+    oss << "error retrieving unreferenced chunks from catalog: "
+        << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  if (result.size() == 0)
+    return result;
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "DELETE FROM chunks WHERE archive_id = ?1 AND refcount <= 0;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc == SQLITE_OK) {
+    sqlite3_bind_int(stmt, 1, archive_id);
+    rc = sqlite3_step(stmt);
+  }
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+    oss << "error removing unreferenced chunks from catalog: "
+        << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+  return result;
+
+}
+
+void BackupCatalog::dropRetentionPolicy(string retention_name) {
+
+  sqlite3_stmt *stmt = NULL;
+  ostringstream delete_sql;
+  int rc;
+
+  /*
+   * Database available ?
+   */
+  if (!this->available()) {
+    throw CArchiveIssue("catalog database not opened");
+  }
+
+  if (retention_name.length() < 1) {
+    throw CArchiveIssue("cannot drop retention policy with empty identifier");
+  }
+
+  /*
+   * Compose SQL string for deletion...
+   */
+  delete_sql << "DELETE FROM retention WHERE name = ?1;";
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          delete_sql.str().c_str(),
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  /*
+   * Bind retention name
+   */
+  sqlite3_bind_text(stmt, 1, retention_name.c_str(), -1, SQLITE_STATIC);
+
+  /*
+   * Execute the DELETE ...
+   */
+  rc = sqlite3_step(stmt);
+
+  if (rc != SQLITE_DONE) {
+
+    ostringstream oss;
+
+    oss << "error dropping retention policy \""
+        << retention_name
+        << "\": "
+        << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CArchiveIssue(oss.str());
+
+  }
+
+  sqlite3_finalize(stmt);
+}
+
+void BackupCatalog::createRetentionPolicy(std::shared_ptr<RetentionDescr> retentionPolicy) {
+
+  ostringstream insert;
+  sqlite3_stmt *stmt;
+  int rc;
+
+  vector<int> attrsRetention;
+  vector<int> attrsRules;
+
+  /*
+   * Database available ?
+   */
+  if (! this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
+
+  /*
+   * Prepare the insert. A retention policy is only valid to create,
+   * if there's a rule attached to it. The creation of a retention
+   * policy thus involves at least two INSERT operations, one
+   * to create the retention policy in the retention table, and another
+   * one to create the attached rule(s) in the retention_rules table.
+   *
+   * NOTE: The caller should ideally use a transaction, but we
+   *       don't force it here.
+   */
+  if (retentionPolicy->rules.size() < 1) {
+    throw CCatalogIssue("cannot create retention policy with no rules");
+  }
+
+  attrsRetention.push_back(SQL_RETENTION_NAME_ATTNO);
+  attrsRetention.push_back(SQL_RETENTION_CREATED_ATTNO);
+
+  attrsRules.push_back(SQL_RETENTION_RULES_ID_ATTNO);
+  attrsRules.push_back(SQL_RETENTION_RULES_TYPE_ATTNO);
+  attrsRules.push_back(SQL_RETENTION_RULES_VALUE_ATTNO);
+
+  insert << "INSERT INTO retention("
+         << this->affectedColumnsToString(SQL_RETENTION_ENTITY, attrsRetention)
+         << ") VALUES(?1, datetime('now'))";
+
+#ifdef __DEBUG__
+  BOOST_LOG_TRIVIAL(debug) << "executing SQL: " << insert.str();
+#endif
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          insert.str().c_str(),
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  /*
+   * Bind attributes from retention policy descriptor.
+   */
+  this->SQLbindRetentionPolicyAttributes(retentionPolicy,
+                                         attrsRetention,
+                                         stmt,
+                                         Range(1, 1));
+
+  /*
+   * Execute the insert. After having successfully
+   * inserted the retention descriptor, we need it's
+   * primary key for its rule dataset.
+   */
+  rc = sqlite3_step(stmt);
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+
+    oss << "error creating retention policy in catalog database:"
+        << sqlite3_errmsg(this->db_handle);
+
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  retentionPolicy->id = sqlite3_last_insert_rowid(this->db_handle);
+
+  /*
+   * Release statement, we need it for the INSERT operation
+   * for the retention rule dataset.
+   */
+  sqlite3_finalize(stmt);
+  insert.str("");
+  insert.clear(); /* resets error flags, but normally we don't need to care here ... */
+
+  /*
+   * Prepare the INSERT operation for retention rules.
+   */
+  insert << "INSERT INTO retention_rules("
+    << this->affectedColumnsToString(SQL_RETENTION_RULES_ENTITY,
+                                     attrsRules)
+    << ") VALUES(";
+
+  for (unsigned int i = 0; i < attrsRules.size(); i++) {
+    insert << "?" << (i + 1);
+    if (i < (attrsRules.size() - 1))
+      insert << ", ";
+  }
+
+  insert << ");";
+
+#ifdef __DEBUG__
+  BOOST_LOG_TRIVIAL(debug) << "executing SQL: " << insert.str();
+#endif
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          insert.str().c_str(),
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  /*
+   * Loop through the rule list, inserting
+   * each one into the catalog database.
+   */
+  for (auto &rule : retentionPolicy->rules) {
+
+    rule->id = retentionPolicy->id;
+    this->SQLbindRetentionRuleAttributes(rule,
+                                         attrsRules,
+                                         stmt,
+                                         Range(1, attrsRules.size()));
+
+    rc = sqlite3_step(stmt);
+
+    if (rc != SQLITE_DONE) {
+
+      ostringstream oss;
+
+      oss << "error while inserting rule description into catalog: "
+          << sqlite3_errmsg(this->db_handle);
+      sqlite3_finalize(stmt);
+      throw CCatalogIssue(oss.str());
+    }
+
+  }
+
+  sqlite3_finalize(stmt);
+
+  /* and we're done */
+}
+
+void BackupCatalog::createRetentionPlan(std::shared_ptr<RetentionPlanDescr> plan) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
+
+  if (plan == nullptr || plan->cleanupDescr == nullptr) {
+    throw CCatalogIssue("cannot create retention plan without cleanup descriptor");
+  }
+
+  if (plan->created.length() == 0) {
+    plan->created = CPGBackupCtlBase::current_timestamp();
+  }
+
+#ifdef __DEBUG__
+  BOOST_LOG_TRIVIAL(debug) << "DEBUG: creating retention plan for archive id "
+                           << plan->archive_id
+                           << " with "
+                           << plan->cleanupDescr->basebackups.size()
+                           << " basebackups";
+#endif
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "INSERT INTO retention_plan(archive_id, retention_name, created, "
+                          "wal_segment_size, wal_cleanup_mode) VALUES(?1, ?2, ?3, ?4, ?5);",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, plan->archive_id);
+  sqlite3_bind_text(stmt, 2, plan->retention_name.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 3, plan->created.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 4, (sqlite3_int64) plan->wal_segment_size);
+  sqlite3_bind_int(stmt, 5, plan->cleanupDescr->mode);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+
+    oss << "error creating retention plan: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+
+  /*
+   * Pending basebackups.
+   */
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "INSERT INTO retention_plan_backups(archive_id, backup_id, fsentry) "
+                          "VALUES(?1, ?2, ?3);",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  for (auto &basebackup : plan->cleanupDescr->basebackups) {
+
+    sqlite3_bind_int(stmt, 1, plan->archive_id);
+    sqlite3_bind_int(stmt, 2, basebackup->id);
+    sqlite3_bind_text(stmt, 3, basebackup->fsentry.c_str(), -1, SQLITE_STATIC);
+
+    rc = sqlite3_step(stmt);
+
+    if (rc != SQLITE_DONE) {
+      ostringstream oss;
+
+      oss << "error adding basebackup to retention plan: "
+          << sqlite3_errmsg(this->db_handle);
+      sqlite3_finalize(stmt);
+      throw CCatalogIssue(oss.str());
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+  }
+
+  sqlite3_finalize(stmt);
+
+  /*
+   * WAL cleanup offsets per timeline. XLogRecPtr are stored
+   * as their signed 64 bit integer representation.
+   */
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "INSERT INTO retention_plan_wal(archive_id, timeline, wal_segment_size, "
+                          "wal_cleanup_start_pos, wal_cleanup_end_pos) VALUES(?1, ?2, ?3, ?4, ?5);",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  for (auto &offset_item : plan->cleanupDescr->off_list) {
+
+    sqlite3_bind_int(stmt, 1, plan->archive_id);
+    sqlite3_bind_int(stmt, 2, offset_item.first);
+    sqlite3_bind_int(stmt, 3, offset_item.second->wal_segment_size);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64) offset_item.second->wal_cleanup_start_pos);
+    sqlite3_bind_int64(stmt, 5, (sqlite3_int64) offset_item.second->wal_cleanup_end_pos);
+
+    rc = sqlite3_step(stmt);
+
+    if (rc != SQLITE_DONE) {
+      ostringstream oss;
+
+      oss << "error adding WAL cleanup offset to retention plan: "
+          << sqlite3_errmsg(this->db_handle);
+      sqlite3_finalize(stmt);
+      throw CCatalogIssue(oss.str());
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+  }
+
+  sqlite3_finalize(stmt);
+
+}
+
+std::shared_ptr<RetentionPlanDescr> BackupCatalog::getRetentionPlan(int archive_id) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+  std::shared_ptr<RetentionPlanDescr> plan = std::make_shared<RetentionPlanDescr>();
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "SELECT retention_name, created, wal_segment_size, wal_cleanup_mode "
+                          "FROM retention_plan WHERE archive_id = ?1;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, archive_id);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc == SQLITE_DONE) {
+
+    /* no plan for this archive */
+    sqlite3_finalize(stmt);
+    return plan;
+
+  }
+
+  if (rc != SQLITE_ROW) {
+    ostringstream oss;
+
+    oss << "error reading retention plan: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  plan->archive_id = archive_id;
+  plan->retention_name = (char *) sqlite3_column_text(stmt, 0);
+  plan->created = (char *) sqlite3_column_text(stmt, 1);
+  plan->wal_segment_size = sqlite3_column_int64(stmt, 2);
+
+  plan->cleanupDescr->basebackupMode = BASEBACKUP_DELETE;
+  plan->cleanupDescr->mode = (WALCleanupMode) sqlite3_column_int(stmt, 3);
+
+  sqlite3_finalize(stmt);
+
+  /*
+   * Pending basebackups, in the order they were planned.
+   */
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "SELECT backup_id, fsentry FROM retention_plan_backups "
+                          "WHERE archive_id = ?1 ORDER BY rowid;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, archive_id);
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+
+    std::shared_ptr<BaseBackupDescr> basebackup = std::make_shared<BaseBackupDescr>();
+
+    basebackup->id = sqlite3_column_int(stmt, 0);
+    basebackup->archive_id = archive_id;
+    basebackup->fsentry = (char *) sqlite3_column_text(stmt, 1);
+    basebackup->wal_segment_size = plan->wal_segment_size;
+
+    plan->cleanupDescr->basebackups.push_back(basebackup);
+
+  }
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+
+    oss << "error reading retention plan basebackups: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+
+  /*
+   * WAL cleanup offsets.
+   */
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "SELECT timeline, wal_segment_size, wal_cleanup_start_pos, wal_cleanup_end_pos "
+                          "FROM retention_plan_wal WHERE archive_id = ?1;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, archive_id);
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+
+    std::shared_ptr<xlog_cleanup_off_t> offset = std::make_shared<xlog_cleanup_off_t>();
+
+    offset->timeline = sqlite3_column_int(stmt, 0);
+    offset->wal_segment_size = sqlite3_column_int(stmt, 1);
+    offset->wal_cleanup_start_pos = (XLogRecPtr) sqlite3_column_int64(stmt, 2);
+    offset->wal_cleanup_end_pos = (XLogRecPtr) sqlite3_column_int64(stmt, 3);
+
+    plan->cleanupDescr->off_list.insert(std::make_pair(offset->timeline, offset));
+
+  }
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+
+    oss << "error reading retention plan WAL offsets: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+
+  return plan;
+
+}
+
+void BackupCatalog::finishRetentionPlanBackup(int archive_id, int basebackup_id) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "DELETE FROM retention_plan_backups WHERE archive_id = ?1 AND backup_id = ?2;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, archive_id);
+  sqlite3_bind_int(stmt, 2, basebackup_id);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+
+    oss << "error updating retention plan: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+
+}
+
+void BackupCatalog::dropRetentionPlan(int archive_id) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
+
+  /*
+   * Pending basebackups and WAL offsets are
+   * removed by ON DELETE CASCADE.
+   */
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "DELETE FROM retention_plan WHERE archive_id = ?1;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, archive_id);
 
-  /*
-   * Execute the insert. After having successfully
-   * inserted the retention descriptor, we need it's
-   * primary key for its rule dataset.
-   */
   rc = sqlite3_step(stmt);
 
   if (rc != SQLITE_DONE) {
     ostringstream oss;
 
-    oss << "error creating retention policy in catalog database:"
-        << sqlite3_errmsg(this->db_handle);
+    oss << "error dropping retention plan: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+
+}
+
+void BackupCatalog::createSchedule(std::shared_ptr<ScheduleDescr> schedule) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+  std::string action;
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
+
+  if (schedule == nullptr) {
+    throw CCatalogIssue("cannot create schedule from uninitialized descriptor");
+  }
+
+  if (schedule->created.length() == 0) {
+    schedule->created = CPGBackupCtlBase::current_timestamp();
+  }
+
+  action = ScheduleDescr::actionToString(schedule->action);
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "INSERT INTO schedules(archive_id, name, cron, action, param, created) "
+                          "VALUES(?1, ?2, ?3, ?4, ?5, ?6);",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, schedule->archive_id);
+  sqlite3_bind_text(stmt, 2, schedule->name.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 3, schedule->cron.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 4, action.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 5, schedule->param.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 6, schedule->created.c_str(), -1, SQLITE_STATIC);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
 
+    oss << "error creating schedule: " << sqlite3_errmsg(this->db_handle);
     sqlite3_finalize(stmt);
     throw CCatalogIssue(oss.str());
   }
 
-  retentionPolicy->id = sqlite3_last_insert_rowid(this->db_handle);
+  schedule->id = sqlite3_last_insert_rowid(this->db_handle);
+  sqlite3_finalize(stmt);
+
+}
+
+std::shared_ptr<ScheduleDescr> BackupCatalog::fetchSchedule(sqlite3_stmt *stmt) {
+
+  std::shared_ptr<ScheduleDescr> schedule = std::make_shared<ScheduleDescr>();
+
+  schedule->id = sqlite3_column_int(stmt, 0);
+  schedule->archive_id = sqlite3_column_int(stmt, 1);
+  schedule->archive_name = (char *) sqlite3_column_text(stmt, 2);
+  schedule->name = (char *) sqlite3_column_text(stmt, 3);
+  schedule->cron = (char *) sqlite3_column_text(stmt, 4);
+  schedule->action = ScheduleDescr::stringToAction((char *) sqlite3_column_text(stmt, 5));
+  schedule->param = (char *) sqlite3_column_text(stmt, 6);
+  schedule->created = (char *) sqlite3_column_text(stmt, 7);
+
+  if (sqlite3_column_type(stmt, 8) != SQLITE_NULL)
+    schedule->last_run = (char *) sqlite3_column_text(stmt, 8);
+
+  return schedule;
+
+}
+
+std::shared_ptr<ScheduleDescr> BackupCatalog::getSchedule(int archive_id,
+                                                          std::string name) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+  std::shared_ptr<ScheduleDescr> schedule = nullptr;
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "SELECT s.id, s.archive_id, a.name, s.name, s.cron, s.action, "
+                          "s.param, s.created, s.last_run "
+                          "FROM schedules s JOIN archive a ON a.id = s.archive_id "
+                          "WHERE s.archive_id = ?1 AND s.name = ?2;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, archive_id);
+  sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_STATIC);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc == SQLITE_ROW) {
+
+    schedule = fetchSchedule(stmt);
+
+  } else if (rc == SQLITE_DONE) {
+
+    /* no such schedule */
+    schedule = std::make_shared<ScheduleDescr>();
+
+  } else {
+    ostringstream oss;
+
+    oss << "error reading schedule: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
 
-  /*
-   * Release statement, we need it for the INSERT operation
-   * for the retention rule dataset.
-   */
   sqlite3_finalize(stmt);
-  insert.str("");
-  insert.clear(); /* resets error flags, but normally we don't need to care here ... */
+  return schedule;
 
-  /*
-   * Prepare the INSERT operation for retention rules.
-   */
-  insert << "INSERT INTO retention_rules("
-    << this->affectedColumnsToString(SQL_RETENTION_RULES_ENTITY,
-                                     attrsRules)
-    << ") VALUES(";
+}
 
-  for (unsigned int i = 0; i < attrsRules.size(); i++) {
-    insert << "?" << (i + 1);
-    if (i < (attrsRules.size() - 1))
-      insert << ", ";
+std::vector<std::shared_ptr<ScheduleDescr>> BackupCatalog::getSchedules(int archive_id) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+  std::vector<std::shared_ptr<ScheduleDescr>> result;
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
   }
 
-  insert << ");";
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "SELECT s.id, s.archive_id, a.name, s.name, s.cron, s.action, "
+                          "s.param, s.created, s.last_run "
+                          "FROM schedules s JOIN archive a ON a.id = s.archive_id "
+                          "WHERE ?1 = -1 OR s.archive_id = ?1 "
+                          "ORDER BY a.name, s.name;",
+                          -1,
+                          &stmt,
+                          NULL);
 
-#ifdef __DEBUG__
-  BOOST_LOG_TRIVIAL(debug) << "executing SQL: " << insert.str();
-#endif
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, archive_id);
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    result.push_back(fetchSchedule(stmt));
+  }
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+
+    oss << "error reading schedules: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+  return result;
+
+}
+
+void BackupCatalog::dropSchedule(int schedule_id) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
 
   rc = sqlite3_prepare_v2(this->db_handle,
-                          insert.str().c_str(),
+                          "DELETE FROM schedules WHERE id = ?1;",
                           -1,
                           &stmt,
                           NULL);
@@ -2615,35 +3922,59 @@ void BackupCatalog::createRetentionPolicy(std::shared_ptr<RetentionDescr> retent
     throw CCatalogIssue(oss.str());
   }
 
-  /*
-   * Loop through the rule list, inserting
-   * each one into the catalog database.
-   */
-  for (auto &rule : retentionPolicy->rules) {
+  sqlite3_bind_int(stmt, 1, schedule_id);
 
-    rule->id = retentionPolicy->id;
-    this->SQLbindRetentionRuleAttributes(rule,
-                                         attrsRules,
-                                         stmt,
-                                         Range(1, attrsRules.size()));
+  rc = sqlite3_step(stmt);
 
-    rc = sqlite3_step(stmt);
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
 
-    if (rc != SQLITE_DONE) {
+    oss << "error dropping schedule: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
+  }
 
-      ostringstream oss;
+  sqlite3_finalize(stmt);
 
-      oss << "error while inserting rule description into catalog: "
-          << sqlite3_errmsg(this->db_handle);
-      sqlite3_finalize(stmt);
-      throw CCatalogIssue(oss.str());
-    }
+}
+
+void BackupCatalog::setScheduleLastRun(int schedule_id, std::string last_run) {
+
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "UPDATE schedules SET last_run = ?1 WHERE id = ?2;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+
+    oss << "cannot prepare query: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_text(stmt, 1, last_run.c_str(), -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 2, schedule_id);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
 
+    oss << "error updating schedule: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+    throw CCatalogIssue(oss.str());
   }
 
   sqlite3_finalize(stmt);
 
-  /* and we're done */
 }
 
 void BackupCatalog::performPinAction(BasicPinDescr *descr,
@@ -2722,18 +4053,84 @@ void BackupCatalog::performPinAction(BasicPinDescr *descr,
 
   if (rc != SQLITE_DONE) {
     ostringstream oss;
-    oss << "failed to pin/unpin basebackup IDs "
-        << ": " << sqlite3_errmsg(db_handle);
+    oss << "failed to pin/unpin basebackup IDs "
+        << ": " << sqlite3_errmsg(db_handle);
+    sqlite3_finalize(stmt);
+    throw CArchiveIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+}
+
+void BackupCatalog::deleteBaseBackup(int basebackupId) {
+
+  int rc;
+  sqlite3_stmt *stmt;
+
+  if (!this->available()) {
+    throw CCatalogIssue("catalog database not opened");
+  }
+
+  /*
+   * Remove the basebackup from the archive statistics. This must
+   * happen before the row (and its tablespaces) are gone, since
+   * all deltas are computed from them.
+   */
+  this->updateArchiveStat("number_of_backups = MAX(number_of_backups - 1, 0), "
+                          "backups_failed = MAX(backups_failed - "
+                          "(SELECT status = 'aborted' FROM backup WHERE id = ?1), 0), "
+                          "backups_running = MAX(backups_running - "
+                          "(SELECT status = 'in progress' FROM backup WHERE id = ?1), 0), "
+                          "backups_ready = MAX(backups_ready - "
+                          "(SELECT status = 'ready' FROM backup WHERE id = ?1), 0), "
+                          "total_duration = MAX(total_duration - "
+                          "(SELECT CASE WHEN status = 'ready' "
+                          "THEN COALESCE(CAST((julianday(stopped) - julianday(started)) * 24 * 60 * 60 AS integer), 0) "
+                          "ELSE 0 END FROM backup WHERE id = ?1), 0), "
+                          "approx_sz = MAX(approx_sz - "
+                          "(SELECT COALESCE(SUM(spcsize), 0) FROM backup_tablespaces WHERE backup_id = ?1), 0), "
+                          "latest_finished = "
+                          "(SELECT MAX(b.stopped) FROM backup b "
+                          "WHERE b.archive_id = archive_stat.archive_id AND b.id <> ?1)",
+                          "archive_id = (SELECT archive_id FROM backup WHERE id = ?1)",
+                          { basebackupId });
+
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "DELETE FROM backup WHERE id = ?1;",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+
+    std::ostringstream oss;
+
+    oss << "error preparing to delete basebackup: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+
+  }
+
+  sqlite3_bind_int(stmt, 1, basebackupId);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+
+    oss << "could not delete basebackup: " << sqlite3_errmsg(this->db_handle);
     sqlite3_finalize(stmt);
-    throw CArchiveIssue(oss.str());
+    throw CCatalogIssue(oss.str());
+
   }
 
   sqlite3_finalize(stmt);
+
 }
 
-void BackupCatalog::deleteBaseBackup(int basebackupId) {
+int BackupCatalog::getIncrementalChildCount(int basebackupId) {
 
   int rc;
+  int result = 0;
   sqlite3_stmt *stmt;
 
   if (!this->available()) {
@@ -2741,7 +4138,7 @@ void BackupCatalog::deleteBaseBackup(int basebackupId) {
   }
 
   rc = sqlite3_prepare_v2(this->db_handle,
-                          "DELETE FROM backup WHERE id = ?1;",
+                          "SELECT COUNT(*) FROM backup WHERE parent_id = ?1 AND status <> 'aborted';",
                           -1,
                           &stmt,
                           NULL);
@@ -2750,7 +4147,7 @@ void BackupCatalog::deleteBaseBackup(int basebackupId) {
 
     std::ostringstream oss;
 
-    oss << "error preparing to delete basebackup: " << sqlite3_errmsg(this->db_handle);
+    oss << "error preparing to count incremental basebackups: " << sqlite3_errmsg(this->db_handle);
     throw CCatalogIssue(oss.str());
 
   }
@@ -2759,17 +4156,20 @@ void BackupCatalog::deleteBaseBackup(int basebackupId) {
 
   rc = sqlite3_step(stmt);
 
-  if (rc != SQLITE_DONE) {
+  if (rc != SQLITE_ROW) {
     ostringstream oss;
 
-    oss << "could not delete basebackup: " << sqlite3_errmsg(this->db_handle);
+    oss << "could not count incremental basebackups: " << sqlite3_errmsg(this->db_handle);
     sqlite3_finalize(stmt);
     throw CCatalogIssue(oss.str());
 
   }
 
+  result = sqlite3_column_int(stmt, 0);
   sqlite3_finalize(stmt);
 
+  return result;
+
 }
 
 void BackupCatalog::exceedsRetention(std::shared_ptr<BaseBackupDescr> basebackup,
@@ -2956,6 +4356,9 @@ std::shared_ptr<BaseBackupDescr> BackupCatalog::getBaseBackup(std::string baseba
   backupAttrs.push_back(SQL_BACKUP_PINNED_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_WAL_SEGMENT_SIZE_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_USED_PROFILE_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_PARENT_ID_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_DETAIL_ATTNO);
 
   tblspcAttrs.push_back(SQL_BCK_TBLSPC_BCK_ID_ATTNO);
   tblspcAttrs.push_back(SQL_BCK_TBLSPC_SPCOID_ATTNO);
@@ -3048,12 +4451,11 @@ std::shared_ptr<BaseBackupDescr> BackupCatalog::getBaseBackup(std::string baseba
    * repeat it and leave it to some future work to optimize it.
    */
 
-  do {
+  basebackup->setAffectedAttributes(backupAttrs);
 
-    shared_ptr<BackupTablespaceDescr> tablespace = make_shared<BackupTablespaceDescr>();
+  do {
 
-    basebackup->setAffectedAttributes(backupAttrs);
-    tablespace->setAffectedAttributes(tblspcAttrs);
+    BackupTablespaceEntry tablespace;
 
     /*
      * If not initialized, retrieve properties into
@@ -3072,12 +4474,13 @@ std::shared_ptr<BaseBackupDescr> BackupCatalog::getBaseBackup(std::string baseba
      * here to fetch, so there's no need to check if we have to
      * create a new BaseBackupDescr instance.
      */
-    this->fetchBackupTablespaceIntoDescr(stmt,
+    this->fetchBackupTablespaceIntoEntry(stmt,
                                          tablespace,
+                                         tblspcAttrs,
                                          Range(backupAttrs.size(), backupAttrs.size()
                                                + tblspcAttrs.size() -1));
 
-    if (tablespace->backup_id >= 0) {
+    if (tablespace.backup_id >= 0) {
       basebackup->tablespaces.push_back(tablespace);
     }
 
@@ -3126,6 +4529,9 @@ std::shared_ptr<BaseBackupDescr> BackupCatalog::getBaseBackup(int basebackupId,
   backupAttrs.push_back(SQL_BACKUP_PINNED_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_WAL_SEGMENT_SIZE_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_USED_PROFILE_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_PARENT_ID_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_DETAIL_ATTNO);
 
   tblspcAttrs.push_back(SQL_BCK_TBLSPC_BCK_ID_ATTNO);
   tblspcAttrs.push_back(SQL_BCK_TBLSPC_SPCOID_ATTNO);
@@ -3218,12 +4624,11 @@ std::shared_ptr<BaseBackupDescr> BackupCatalog::getBaseBackup(int basebackupId,
    * repeat it and leave it to some future work to optimize it.
    */
 
-  do {
+  basebackup->setAffectedAttributes(backupAttrs);
 
-    shared_ptr<BackupTablespaceDescr> tablespace = make_shared<BackupTablespaceDescr>();
+  do {
 
-    basebackup->setAffectedAttributes(backupAttrs);
-    tablespace->setAffectedAttributes(tblspcAttrs);
+    BackupTablespaceEntry tablespace;
 
     /*
      * If not initialized, retrieve properties into
@@ -3242,12 +4647,13 @@ std::shared_ptr<BaseBackupDescr> BackupCatalog::getBaseBackup(int basebackupId,
      * here to fetch, so there's no need to check if we have to
      * create a new BaseBackupDescr instance.
      */
-    this->fetchBackupTablespaceIntoDescr(stmt,
+    this->fetchBackupTablespaceIntoEntry(stmt,
                                          tablespace,
+                                         tblspcAttrs,
                                          Range(backupAttrs.size(), backupAttrs.size()
                                                + tblspcAttrs.size() -1));
 
-    if (tablespace->backup_id >= 0) {
+    if (tablespace.backup_id >= 0) {
       basebackup->tablespaces.push_back(tablespace);
     }
 
@@ -3292,6 +4698,9 @@ std::shared_ptr<BaseBackupDescr> BackupCatalog::getBaseBackup(BaseBackupRetrieve
   backupAttrs.push_back(SQL_BACKUP_WAL_SEGMENT_SIZE_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_USED_PROFILE_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_PG_VERSION_NUM_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_PARENT_ID_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_DETAIL_ATTNO);
 
   /* Safe column list to descriptor */
   result->setAffectedAttributes(backupAttrs);
@@ -3478,6 +4887,9 @@ BackupCatalog::getBackupListRetentionDateTime(std::string archive_name,
   backupAttrs.push_back(SQL_BACKUP_PINNED_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_WAL_SEGMENT_SIZE_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_USED_PROFILE_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_PARENT_ID_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_DETAIL_ATTNO);
 
   /* computed columns to fetch */
   backupAttrs.push_back(SQL_BACKUP_COMPUTED_DURATION);
@@ -3585,33 +4997,34 @@ BackupCatalog::getBackupListRetentionDateTime(std::string archive_name,
    */
   while (rc == SQLITE_ROW) {
 
-    shared_ptr<BaseBackupDescr> bbdescr = make_shared<BaseBackupDescr>();
-    shared_ptr<BackupTablespaceDescr> tablespace = make_shared<BackupTablespaceDescr>();
+    BackupTablespaceEntry tablespace;
 
     /* pivot pointer */
     shared_ptr<BaseBackupDescr> curr_descr = nullptr;
 
-    bbdescr->setAffectedAttributes(backupAttrs);
-    tablespace->setAffectedAttributes(tblspcAttrs);
-
-    this->fetchBackupIntoDescr(stmt,
-                               bbdescr,
-                               Range(0, backupAttrs.size() - 1));
-
     /*
      * Since we fetch tablespace and basebackup information in one
-     * query, we only push basebackup information if the last
-     * encountered backup_id differs.
+     * query, we only materialize basebackup information if the last
+     * encountered backup_id differs. The backup id is always the first
+     * column in the result set.
      */
-    if (current_backup_id != bbdescr->id) {
+    if (current_backup_id != sqlite3_column_int(stmt, 0)) {
+
+      shared_ptr<BaseBackupDescr> bbdescr = make_shared<BaseBackupDescr>();
+
+      bbdescr->setAffectedAttributes(backupAttrs);
+      this->fetchBackupIntoDescr(stmt,
+                                 bbdescr,
+                                 Range(0, backupAttrs.size() - 1));
 
       list.push_back(bbdescr);
       current_backup_id = bbdescr->id;
 
     }
 
-    this->fetchBackupTablespaceIntoDescr(stmt,
+    this->fetchBackupTablespaceIntoEntry(stmt,
                                          tablespace,
+                                         tblspcAttrs,
 
                                          /*
                                           * NOTE:
@@ -3623,7 +5036,7 @@ BackupCatalog::getBackupListRetentionDateTime(std::string archive_name,
 
                                          Range(backupAttrs.size(), backupAttrs.size() + tblspcAttrs.size() - 1));
 
-    if (tablespace->backup_id >= 0) {
+    if (tablespace.backup_id >= 0) {
 
       /* Okay, looks like a valid tablespace entry */
       curr_descr = list.back();
@@ -3681,6 +5094,10 @@ BackupCatalog::getBackupList(std::string archive_name) {
   backupAttrs.push_back(SQL_BACKUP_PINNED_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_WAL_SEGMENT_SIZE_ATTNO);
   backupAttrs.push_back(SQL_BACKUP_USED_PROFILE_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_PARENT_ID_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_BAD_PAGES_DETAIL_ATTNO);
+  backupAttrs.push_back(SQL_BACKUP_PG_VERSION_NUM_ATTNO);
 
   /* computed columns to fetch */
   backupAttrs.push_back(SQL_BACKUP_COMPUTED_DURATION);
@@ -3752,33 +5169,34 @@ BackupCatalog::getBackupList(std::string archive_name) {
    */
   while (rc == SQLITE_ROW) {
 
-    shared_ptr<BaseBackupDescr> bbdescr = make_shared<BaseBackupDescr>();
-    shared_ptr<BackupTablespaceDescr> tablespace = make_shared<BackupTablespaceDescr>();
+    BackupTablespaceEntry tablespace;
 
     /* pivot pointer */
     shared_ptr<BaseBackupDescr> curr_descr = nullptr;
 
-    bbdescr->setAffectedAttributes(backupAttrs);
-    tablespace->setAffectedAttributes(tblspcAttrs);
-
-    this->fetchBackupIntoDescr(stmt,
-                               bbdescr,
-                               Range(0, backupAttrs.size() - 1));
-
     /*
      * Since we fetch tablespace and basebackup information in one
-     * query, we only push basebackup information if the last
-     * encountered backup_id differs.
+     * query, we only materialize basebackup information if the last
+     * encountered backup_id differs. The backup id is always the first
+     * column in the result set.
      */
-    if (current_backup_id != bbdescr->id) {
+    if (current_backup_id != sqlite3_column_int(stmt, 0)) {
+
+      shared_ptr<BaseBackupDescr> bbdescr = make_shared<BaseBackupDescr>();
+
+      bbdescr->setAffectedAttributes(backupAttrs);
+      this->fetchBackupIntoDescr(stmt,
+                                 bbdescr,
+                                 Range(0, backupAttrs.size() - 1));
 
       list.push_back(bbdescr);
       current_backup_id = bbdescr->id;
 
     }
 
-    this->fetchBackupTablespaceIntoDescr(stmt,
+    this->fetchBackupTablespaceIntoEntry(stmt,
                                          tablespace,
+                                         tblspcAttrs,
 
                                          /*
                                           * NOTE:
@@ -3790,7 +5208,7 @@ BackupCatalog::getBackupList(std::string archive_name) {
 
                                          Range(backupAttrs.size(), backupAttrs.size() + tblspcAttrs.size() - 1));
 
-    if (tablespace->backup_id >= 0) {
+    if (tablespace.backup_id >= 0) {
 
       /* Okay, looks like a valid tablespace entry */
       curr_descr = list.back();
@@ -3991,11 +5409,12 @@ BackupCatalog::getBackupProfiles() {
    * Build the query.
    */
   ostringstream query;
-  Range range(0, 10);
+  Range range(0, 15);
 
   query << "SELECT id, name, compress_type, max_rate, label, "
         << "fast_checkpoint, include_wal, wait_for_wal, noverify_checksums, "
-        << "manifest, manifest_checksums "
+        << "manifest, manifest_checksums, "
+        << "compress_on_server, compress_level, compress_workers, deduplicate, verify_pages "
         << "FROM backup_profiles ORDER BY name;";
 
 #ifdef __DEBUG__
@@ -4014,6 +5433,11 @@ BackupCatalog::getBackupProfiles() {
   attr.push_back(SQL_BCK_PROF_NOVERIFY_CHECKSUMS_ATTNO);
   attr.push_back(SQL_BCK_PROF_MANIFEST_ATTNO);
   attr.push_back(SQL_BCK_PROF_MANIFEST_CHECKSUMS_ATTNO);
+  attr.push_back(SQL_BCK_PROF_COMPRESS_ON_SERVER_ATTNO);
+  attr.push_back(SQL_BCK_PROF_COMPRESS_LEVEL_ATTNO);
+  attr.push_back(SQL_BCK_PROF_COMPRESS_WORKERS_ATTNO);
+  attr.push_back(SQL_BCK_PROF_DEDUPLICATE_ATTNO);
+  attr.push_back(SQL_BCK_PROF_VERIFY_PAGES_ATTNO);
 
   int rc = sqlite3_prepare_v2(this->db_handle,
                               query.str().c_str(),
@@ -4066,7 +5490,7 @@ std::shared_ptr<BackupProfileDescr> BackupCatalog::getBackupProfile(int profile_
   sqlite3_stmt *stmt;
   int rc;
   std::ostringstream query;
-  Range range(0, 10);
+  Range range(0, 15);
 
   if (!this->available()) {
     throw CCatalogIssue("catalog database not opened");
@@ -4088,7 +5512,8 @@ std::shared_ptr<BackupProfileDescr> BackupCatalog::getBackupProfile(int profile_
    */
   query << "SELECT id, name, compress_type, max_rate, label, "
         << "fast_checkpoint, include_wal, wait_for_wal, noverify_checksums, "
-        << "manifest, manifest_checksums "
+        << "manifest, manifest_checksums, "
+        << "compress_on_server, compress_level, compress_workers, deduplicate, verify_pages "
         << "FROM backup_profiles WHERE id = ?1;";
 
 #ifdef __DEBUG__
@@ -4116,6 +5541,11 @@ std::shared_ptr<BackupProfileDescr> BackupCatalog::getBackupProfile(int profile_
   descr->pushAffectedAttribute(SQL_BCK_PROF_NOVERIFY_CHECKSUMS_ATTNO);
   descr->pushAffectedAttribute(SQL_BCK_PROF_MANIFEST_ATTNO);
   descr->pushAffectedAttribute(SQL_BCK_PROF_MANIFEST_CHECKSUMS_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_COMPRESS_ON_SERVER_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_COMPRESS_LEVEL_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_COMPRESS_WORKERS_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_DEDUPLICATE_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_VERIFY_PAGES_ATTNO);
 
   if (rc != SQLITE_OK) {
     ostringstream oss;
@@ -4164,7 +5594,7 @@ std::shared_ptr<BackupProfileDescr> BackupCatalog::getBackupProfile(std::string
   sqlite3_stmt *stmt;
   int rc;
   std::ostringstream query;
-  Range range(0, 10);
+  Range range(0, 15);
 
   if (!this->available()) {
     throw CCatalogIssue("catalog database not opened");
@@ -4175,7 +5605,8 @@ std::shared_ptr<BackupProfileDescr> BackupCatalog::getBackupProfile(std::string
    */
   query << "SELECT id, name, compress_type, max_rate, label, "
         << "fast_checkpoint, include_wal, wait_for_wal, noverify_checksums, "
-        << "manifest, manifest_checksums "
+        << "manifest, manifest_checksums, "
+        << "compress_on_server, compress_level, compress_workers, deduplicate, verify_pages "
         << "FROM backup_profiles WHERE name = ?1;";
 
 #ifdef __DEBUG__
@@ -4203,6 +5634,11 @@ std::shared_ptr<BackupProfileDescr> BackupCatalog::getBackupProfile(std::string
   descr->pushAffectedAttribute(SQL_BCK_PROF_NOVERIFY_CHECKSUMS_ATTNO);
   descr->pushAffectedAttribute(SQL_BCK_PROF_MANIFEST_ATTNO);
   descr->pushAffectedAttribute(SQL_BCK_PROF_MANIFEST_CHECKSUMS_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_COMPRESS_ON_SERVER_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_COMPRESS_LEVEL_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_COMPRESS_WORKERS_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_DEDUPLICATE_ATTNO);
+  descr->pushAffectedAttribute(SQL_BCK_PROF_VERIFY_PAGES_ATTNO);
 
   if (rc != SQLITE_OK) {
     ostringstream oss;
@@ -4254,8 +5690,9 @@ void BackupCatalog::createBackupProfile(std::shared_ptr<BackupProfileDescr> prof
 
   insert << "INSERT INTO backup_profiles("
          << "name, compress_type, max_rate, label, "
-         << "fast_checkpoint, include_wal, wait_for_wal, noverify_checksums, manifest, manifest_checksums) "
-         << "VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10);";
+         << "fast_checkpoint, include_wal, wait_for_wal, noverify_checksums, manifest, manifest_checksums, "
+         << "compress_on_server, compress_level, compress_workers, deduplicate, verify_pages) "
+         << "VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13, ?14, ?15);";
 
 #ifdef __DEBUG__
   BOOST_LOG_TRIVIAL(debug) << "createBackupProfile query: " << insert.str();
@@ -4276,7 +5713,7 @@ void BackupCatalog::createBackupProfile(std::shared_ptr<BackupProfileDescr> prof
   /*
    * Bind new backup profile data.
    */
-  Range range(1, 10);
+  Range range(1, 15);
   this->SQLbindBackupProfileAttributes(profileDescr,
                                        profileDescr->getAffectedAttributes(),
                                        stmt,
@@ -4347,6 +5784,37 @@ void BackupCatalog::createArchive(shared_ptr<CatalogDescr> descr) {
   descr->setArchiveId(sqlite3_last_insert_rowid(this->db_handle));
   sqlite3_finalize(stmt);
 
+  /*
+   * Each archive carries its own statistics row, which
+   * is maintained along with its basebackups and WAL.
+   */
+  rc = sqlite3_prepare_v2(this->db_handle,
+                          "INSERT INTO archive_stat(archive_id) VALUES(?1);",
+                          -1,
+                          &stmt,
+                          NULL);
+
+  if (rc != SQLITE_OK) {
+    ostringstream oss;
+    oss << "could not prepare archive statistics: " << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_bind_int(stmt, 1, descr->id);
+
+  rc = sqlite3_step(stmt);
+
+  if (rc != SQLITE_DONE) {
+    ostringstream oss;
+
+    oss << "error creating archive statistics in catalog database: " << sqlite3_errmsg(this->db_handle);
+    sqlite3_finalize(stmt);
+
+    throw CCatalogIssue(oss.str());
+  }
+
+  sqlite3_finalize(stmt);
+
 }
 
 int BackupCatalog::SQLbindBackupTablespaceAttributes(std::shared_ptr<BackupTablespaceDescr> tblspcDescr,
@@ -4388,6 +5856,26 @@ int BackupCatalog::SQLbindBackupTablespaceAttributes(std::shared_ptr<BackupTable
       sqlite3_bind_int(stmt, result, tblspcDescr->spcsize);
       break;
 
+    case SQL_BCK_TBLSPC_CSUM_ALG_ATTNO:
+      if (tblspcDescr->checksum_algorithm.empty())
+        sqlite3_bind_null(stmt, result);
+      else
+        sqlite3_bind_text(stmt, result,
+                          tblspcDescr->checksum_algorithm.c_str(),
+                          -1,
+                          SQLITE_STATIC);
+      break;
+
+    case SQL_BCK_TBLSPC_CSUM_ATTNO:
+      if (tblspcDescr->checksum.empty())
+        sqlite3_bind_null(stmt, result);
+      else
+        sqlite3_bind_text(stmt, result,
+                          tblspcDescr->checksum.c_str(),
+                          -1,
+                          SQLITE_STATIC);
+      break;
+
     default:
       {
         ostringstream oss;
@@ -4628,6 +6116,25 @@ int BackupCatalog::SQLbindBackupAttributes(std::shared_ptr<BaseBackupDescr> bbde
                        bbdescr->pg_version_num);
       break;
 
+    case SQL_BACKUP_PARENT_ID_ATTNO:
+      if (bbdescr->parent_id < 0)
+        sqlite3_bind_null(stmt, result);
+      else
+        sqlite3_bind_int(stmt, result, bbdescr->parent_id);
+      break;
+
+    case SQL_BACKUP_BAD_PAGES_ATTNO:
+      sqlite3_bind_int(stmt, result, bbdescr->bad_pages);
+      break;
+
+    case SQL_BACKUP_BAD_PAGES_DETAIL_ATTNO:
+      if (bbdescr->bad_pages_detail.length() == 0)
+        sqlite3_bind_null(stmt, result);
+      else
+        sqlite3_bind_text(stmt, result, bbdescr->bad_pages_detail.c_str(),
+                          -1, SQLITE_STATIC);
+      break;
+
     case SQL_BACKUP_COMPUTED_RETENTION_DATETIME:
       /* computed values must not be bound */
       throw CCatalogIssue("attempt to bind expression column exceeds_retention_rule");
@@ -4810,6 +6317,26 @@ int BackupCatalog::SQLbindBackupProfileAttributes(std::shared_ptr<BackupProfileD
                         profileDescr->manifest_checksums.c_str(), -1, SQLITE_STATIC);
       break;
 
+    case SQL_BCK_PROF_COMPRESS_ON_SERVER_ATTNO:
+      sqlite3_bind_int(stmt, result, profileDescr->compress_on_server);
+      break;
+
+    case SQL_BCK_PROF_COMPRESS_LEVEL_ATTNO:
+      sqlite3_bind_int(stmt, result, profileDescr->compress_level);
+      break;
+
+    case SQL_BCK_PROF_COMPRESS_WORKERS_ATTNO:
+      sqlite3_bind_int(stmt, result, profileDescr->compress_workers);
+      break;
+
+    case SQL_BCK_PROF_DEDUPLICATE_ATTNO:
+      sqlite3_bind_int(stmt, result, profileDescr->deduplicate);
+      break;
+
+    case SQL_BCK_PROF_VERIFY_PAGES_ATTNO:
+      sqlite3_bind_int(stmt, result, profileDescr->verify_pages);
+      break;
+
     default:
       {
         ostringstream oss;
@@ -5344,8 +6871,8 @@ void BackupCatalog::registerBasebackup(int archive_id,
   }
 
   rc = sqlite3_prepare_v2(this->db_handle,
-                          "INSERT INTO backup(archive_id, xlogpos, timeline, label, fsentry, started, systemid, wal_segment_size, used_profile, pg_version_num) "
-                          "VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10);",
+                          "INSERT INTO backup(archive_id, xlogpos, timeline, label, fsentry, started, systemid, wal_segment_size, used_profile, pg_version_num, parent_id) "
+                          "VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11);",
                           -1,
                           &stmt,
                           NULL);
@@ -5370,6 +6897,12 @@ void BackupCatalog::registerBasebackup(int archive_id,
   sqlite3_bind_int(stmt, 9, backupDescr->used_profile);
   sqlite3_bind_int(stmt, 10, backupDescr->pg_version_num);
 
+  /* Full basebackups don't have a parent */
+  if (backupDescr->parent_id < 0)
+    sqlite3_bind_null(stmt, 11);
+  else
+    sqlite3_bind_int(stmt, 11, backupDescr->parent_id);
+
   /*
    * Execute the statement.
    */
@@ -5387,10 +6920,15 @@ void BackupCatalog::registerBasebackup(int archive_id,
    */
   backupDescr->id = sqlite3_last_insert_rowid(this->db_handle);
 
+  sqlite3_finalize(stmt);
+
   /*
-   * ... and we're done
+   * Account the new basebackup in the archive statistics.
    */
-  sqlite3_finalize(stmt);
+  this->updateArchiveStat("number_of_backups = number_of_backups + 1, "
+                          "backups_running = backups_running + 1",
+                          "archive_id = ?1",
+                          { archive_id });
 }
 
 void BackupCatalog::finalizeBasebackup(std::shared_ptr<BaseBackupDescr> backupDescr) {
@@ -5417,7 +6955,8 @@ void BackupCatalog::finalizeBasebackup(std::shared_ptr<BaseBackupDescr> backupDe
   }
 
   rc = sqlite3_prepare_v2(this->db_handle,
-                          "UPDATE backup SET status = 'ready', stopped = ?1, xlogposend = ?2 "
+                          "UPDATE backup SET status = 'ready', stopped = ?1, xlogposend = ?2, "
+                          "bad_pages = ?5, bad_pages_detail = ?6 "
                           "WHERE id = ?3 AND archive_id = ?4;",
                           -1,
                           &stmt,
@@ -5440,6 +6979,13 @@ void BackupCatalog::finalizeBasebackup(std::shared_ptr<BaseBackupDescr> backupDe
                     -1, SQLITE_STATIC);
   sqlite3_bind_int(stmt, 3, backupDescr->id);
   sqlite3_bind_int(stmt, 4, backupDescr->archive_id);
+  sqlite3_bind_int(stmt, 5, backupDescr->bad_pages);
+
+  if (backupDescr->bad_pages_detail.length() == 0)
+    sqlite3_bind_null(stmt, 6);
+  else
+    sqlite3_bind_text(stmt, 6, backupDescr->bad_pages_detail.c_str(),
+                      -1, SQLITE_STATIC);
 
   /*
    * Execute the statement
@@ -5454,6 +7000,24 @@ void BackupCatalog::finalizeBasebackup(std::shared_ptr<BaseBackupDescr> backupDe
   }
 
   sqlite3_finalize(stmt);
+
+  /*
+   * The basebackup is ready now, so move it over from the running
+   * to the finished counters. Duration and finish time are taken
+   * from the row we've just updated.
+   */
+  this->updateArchiveStat("backups_running = MAX(backups_running - 1, 0), "
+                          "backups_ready = backups_ready + 1, "
+                          "total_duration = total_duration + "
+                          "(SELECT COALESCE(CAST((julianday(stopped) - julianday(started)) * 24 * 60 * 60 AS integer), 0) "
+                          "FROM backup WHERE id = ?2), "
+                          "latest_finished = "
+                          "(SELECT CASE WHEN archive_stat.latest_finished IS NULL "
+                          "OR archive_stat.latest_finished < stopped "
+                          "THEN stopped ELSE archive_stat.latest_finished END "
+                          "FROM backup WHERE id = ?2)",
+                          "archive_id = ?1",
+                          { backupDescr->archive_id, backupDescr->id });
 }
 
 void BackupCatalog::abortBasebackup(std::shared_ptr<BaseBackupDescr> backupDescr) {
@@ -5490,6 +7054,23 @@ void BackupCatalog::abortBasebackup(std::shared_ptr<BaseBackupDescr> backupDescr
     throw CCatalogIssue(oss.str());
   }
 
+  /*
+   * Account the state change in the archive statistics before
+   * the status is overwritten, since we need to know where we came from.
+   */
+  this->updateArchiveStat("backups_running = MAX(backups_running - "
+                          "(SELECT status = 'in progress' FROM backup WHERE id = ?2), 0), "
+                          "backups_ready = MAX(backups_ready - "
+                          "(SELECT status = 'ready' FROM backup WHERE id = ?2), 0), "
+                          "total_duration = MAX(total_duration - "
+                          "(SELECT CASE WHEN status = 'ready' "
+                          "THEN COALESCE(CAST((julianday(stopped) - julianday(started)) * 24 * 60 * 60 AS integer), 0) "
+                          "ELSE 0 END FROM backup WHERE id = ?2), 0), "
+                          "backups_failed = backups_failed + "
+                          "(SELECT status <> 'aborted' FROM backup WHERE id = ?2)",
+                          "archive_id = ?1 AND EXISTS(SELECT 1 FROM backup WHERE id = ?2 AND archive_id = ?1)",
+                          { backupDescr->archive_id, backupDescr->id });
+
   /*
    * Bind parameters...
    */
@@ -5878,7 +7459,7 @@ void BackupCatalog::updateProc(std::shared_ptr<CatalogProc> procInfo,
   ++boundCols;
   updateSQL << " WHERE pid = ?" << boundCols;
   ++boundCols;
-  updateSQL << "AND archive_id = ?" << boundCols << ";";
+  updateSQL << " AND archive_id = ?" << boundCols << ";";
 
 #ifdef __DEBUG__
   BOOST_LOG_TRIVIAL(debug) << "generate UPDATE SQL " << updateSQL.str();
@@ -5890,6 +7471,13 @@ void BackupCatalog::updateProc(std::shared_ptr<CatalogProc> procInfo,
                           &stmt,
                           NULL);
 
+  if (rc != SQLITE_OK) {
+    std::ostringstream oss;
+    oss << "error preparing to update catalog proc handle: "
+        << sqlite3_errmsg(this->db_handle);
+    throw CCatalogIssue(oss.str());
+  }
+
   /*
    * Assign bind variables. Please note that we rely
    * on the order of affectedAttributes to match the
@@ -5910,7 +7498,7 @@ void BackupCatalog::updateProc(std::shared_ptr<CatalogProc> procInfo,
   /*
    * Execute the UPDATE statement.
    */
-  sqlite3_step(stmt);
+  rc = sqlite3_step(stmt);
 
   if (rc != SQLITE_DONE) {
     std::ostringstream oss;
@@ -6472,7 +8060,21 @@ BackupCatalog::fetchBackupTablespaceIntoDescr(sqlite3_stmt *stmt,
 
     case SQL_BCK_TBLSPC_SPCSZ_ATTNO:
       {
-        tablespace->spcsize = sqlite3_column_int(stmt, current_stmt_col);
+        tablespace->spcsize = sqlite3_column_int64(stmt, current_stmt_col);
+        break;
+      }
+
+    case SQL_BCK_TBLSPC_CSUM_ALG_ATTNO:
+      {
+        if (sqlite3_column_type(stmt, current_stmt_col) != SQLITE_NULL)
+          tablespace->checksum_algorithm = (char *) sqlite3_column_text(stmt, current_stmt_col);
+        break;
+      }
+
+    case SQL_BCK_TBLSPC_CSUM_ATTNO:
+      {
+        if (sqlite3_column_type(stmt, current_stmt_col) != SQLITE_NULL)
+          tablespace->checksum = (char *) sqlite3_column_text(stmt, current_stmt_col);
         break;
       }
 
@@ -6490,6 +8092,63 @@ BackupCatalog::fetchBackupTablespaceIntoDescr(sqlite3_stmt *stmt,
   return tablespace;
 }
 
+void BackupCatalog::fetchBackupTablespaceIntoEntry(sqlite3_stmt *stmt,
+                                                   BackupTablespaceEntry &entry,
+                                                   std::vector<int> &attrs,
+                                                   Range colIdRange) {
+
+  int current_stmt_col = colIdRange.start();
+
+  if (stmt == NULL)
+    throw CCatalogIssue("cannot fetch backup tablespace: uninitialized statement handle");
+
+  for(auto &current : attrs) {
+
+    /*
+     * Sanity check, stop if range end is reached.
+     */
+    if (current_stmt_col > colIdRange.end())
+      break;
+
+    switch(current) {
+
+    case SQL_BCK_TBLSPC_BCK_ID_ATTNO:
+      entry.backup_id = sqlite3_column_int(stmt, current_stmt_col);
+      break;
+
+    case SQL_BCK_TBLSPC_SPCOID_ATTNO:
+      entry.spcoid = sqlite3_column_int(stmt, current_stmt_col);
+      break;
+
+    case SQL_BCK_TBLSPC_SPCLOC_ATTNO:
+      entry.spclocation = (char *) sqlite3_column_text(stmt, current_stmt_col);
+      break;
+
+    case SQL_BCK_TBLSPC_SPCSZ_ATTNO:
+      entry.spcsize = sqlite3_column_int64(stmt, current_stmt_col);
+      break;
+
+    case SQL_BCK_TBLSPC_CSUM_ALG_ATTNO:
+      if (sqlite3_column_type(stmt, current_stmt_col) != SQLITE_NULL)
+        entry.checksum_algorithm = (char *) sqlite3_column_text(stmt, current_stmt_col);
+      break;
+
+    case SQL_BCK_TBLSPC_CSUM_ATTNO:
+      if (sqlite3_column_type(stmt, current_stmt_col) != SQLITE_NULL)
+        entry.checksum = (char *) sqlite3_column_text(stmt, current_stmt_col);
+      break;
+
+    default:
+      throw CCatalogIssue("unknown column identifier in fetchBackupTablespaceIntoEntry()");
+
+    }
+
+    current_stmt_col++;
+
+  }
+
+}
+
 vector<shared_ptr<BackupTablespaceDescr>>
 BackupCatalog::getBackupTablespaces(int backup_id,
                                     vector<int> attrs) {
@@ -6553,6 +8212,7 @@ BackupCatalog::getBackupTablespaces(int backup_id,
 
     shared_ptr<BackupTablespaceDescr> tablespace = make_shared<BackupTablespaceDescr>();
 
+    tablespace->setAffectedAttributes(attrs);
     this->fetchBackupTablespaceIntoDescr(stmt, tablespace, Range(0, attrs.size() - 1));
     result.push_back(tablespace);
     rc = sqlite3_step(stmt);
@@ -6566,10 +8226,26 @@ BackupCatalog::getBackupTablespaces(int backup_id,
 
 void BackupCatalog::registerTablespaceForBackup(std::shared_ptr<BackupTablespaceDescr> tblspcDescr) {
 
-  sqlite3_stmt *stmt;
-  std::ostringstream query;
+  std::vector<std::shared_ptr<BackupTablespaceDescr>> list;
+
+  list.push_back(tblspcDescr);
+  this->registerTablespacesForBackup(list);
+
+}
+
+/*
+ * Max number of rows registerTablespacesForBackup() puts into a single
+ * INSERT statement. Each row binds 6 parameters, so this stays well
+ * below the SQLITE_MAX_VARIABLE_NUMBER default of older SQLite versions (999).
+ */
+#define TBLSPC_INSERT_BATCH_SIZE 150
+
+void BackupCatalog::registerTablespacesForBackup(std::vector<std::shared_ptr<BackupTablespaceDescr>> list) {
+
   std::vector<int> attrs;
-  int rc;
+  std::string insertCols;
+  std::map<int, sqlite3_int64> backup_sizes;
+  std::vector<std::shared_ptr<BackupTablespaceDescr>>::size_type offset = 0;
 
   if (!this->available()) {
     throw CCatalogIssue("database not available");
@@ -6578,8 +8254,12 @@ void BackupCatalog::registerTablespaceForBackup(std::shared_ptr<BackupTablespace
   /*
    * We expect the backup_id identifier to be set.
    */
-  if (tblspcDescr->backup_id < 0) {
-    throw CCatalogIssue("backup id required to register tablespace for backup");
+  for (auto &tblspcDescr : list) {
+
+    if (tblspcDescr->backup_id < 0) {
+      throw CCatalogIssue("backup id required to register tablespace for backup");
+    }
+
   }
 
   /*
@@ -6589,66 +8269,131 @@ void BackupCatalog::registerTablespaceForBackup(std::shared_ptr<BackupTablespace
   attrs.push_back(SQL_BCK_TBLSPC_SPCOID_ATTNO);
   attrs.push_back(SQL_BCK_TBLSPC_SPCLOC_ATTNO);
   attrs.push_back(SQL_BCK_TBLSPC_SPCSZ_ATTNO);
+  attrs.push_back(SQL_BCK_TBLSPC_CSUM_ALG_ATTNO);
+  attrs.push_back(SQL_BCK_TBLSPC_CSUM_ATTNO);
 
-  /*
-   * Generate INSERT SQL.
-   */
-  query << "INSERT INTO backup_tablespaces("
-        << BackupCatalog::SQLgetColumnList(SQL_BACKUP_TBLSPC_ENTITY,
-                                           /* vector with col IDs */
-                                           attrs)
-        << ") VALUES(?1, ?2, ?3, ?4);";
+  insertCols = BackupCatalog::SQLgetColumnList(SQL_BACKUP_TBLSPC_ENTITY,
+                                               /* vector with col IDs */
+                                               attrs);
+
+  while (offset < list.size()) {
+
+    sqlite3_stmt *stmt;
+    std::ostringstream query;
+    int rc;
+    sqlite3_int64 last_rowid;
+    unsigned int rows = std::min<size_t>(list.size() - offset,
+                                         TBLSPC_INSERT_BATCH_SIZE);
+
+    /*
+     * Generate multi-row INSERT SQL.
+     */
+    query << "INSERT INTO backup_tablespaces("
+          << insertCols
+          << ") VALUES";
+
+    for (unsigned int i = 0; i < rows; i++) {
+
+      unsigned int param = i * attrs.size();
+
+      query << ((i > 0) ? ", " : " ")
+            << "(?" << param + 1
+            << ", ?" << param + 2
+            << ", ?" << param + 3
+            << ", ?" << param + 4
+            << ", ?" << param + 5
+            << ", ?" << param + 6 << ")";
+
+    }
+
+    query << ";";
 
 #ifdef __DEBUG__
-  BOOST_LOG_TRIVIAL(debug) << "DEBUG: registerTablespaceForBackup() query: "
-                           << query.str();
+    BOOST_LOG_TRIVIAL(debug) << "DEBUG: registerTablespacesForBackup() query: "
+                             << query.str();
 #endif
 
-  /*
-   * Prepare the statement and bind values.
-   */
+    /*
+     * Prepare the statement and bind values.
+     */
+    rc = sqlite3_prepare_v2(this->db_handle,
+                            query.str().c_str(),
+                            -1,
+                            &stmt,
+                            NULL);
 
-  rc = sqlite3_prepare_v2(this->db_handle,
-                          query.str().c_str(),
-                          -1,
-                          &stmt,
-                          NULL);
+    if (rc != SQLITE_OK) {
+      ostringstream oss;
+      oss << "could not prepare query to register tablespace: "
+          << sqlite3_errmsg(this->db_handle);
+      sqlite3_finalize(stmt);
+      throw CCatalogIssue(oss.str());
+    }
 
-  if (rc != SQLITE_OK) {
-    ostringstream oss;
-    oss << "could not prepare query to register tablespace: "
-        << sqlite3_errmsg(this->db_handle);
-    sqlite3_finalize(stmt);
-    throw CCatalogIssue(oss.str());
-  }
+    for (unsigned int i = 0; i < rows; i++) {
 
-  sqlite3_bind_int(stmt, 1, tblspcDescr->backup_id);
-  sqlite3_bind_int(stmt, 2, tblspcDescr->spcoid);
-  sqlite3_bind_text(stmt, 3, tblspcDescr->spclocation.c_str(),
-                    -1, SQLITE_STATIC);
-  sqlite3_bind_int(stmt, 4, tblspcDescr->spcsize);
+      std::shared_ptr<BackupTablespaceDescr> tblspcDescr = list[offset + i];
+      int param = i * attrs.size();
 
-  /*
-   * Execute query...
-   */
-  rc = sqlite3_step(stmt);
+      sqlite3_bind_int(stmt, param + 1, tblspcDescr->backup_id);
+      sqlite3_bind_int(stmt, param + 2, tblspcDescr->spcoid);
+      sqlite3_bind_text(stmt, param + 3, tblspcDescr->spclocation.c_str(),
+                        -1, SQLITE_STATIC);
+      sqlite3_bind_int64(stmt, param + 4, tblspcDescr->spcsize);
+
+      if (tblspcDescr->checksum.empty()) {
+        sqlite3_bind_null(stmt, param + 5);
+        sqlite3_bind_null(stmt, param + 6);
+      } else {
+        sqlite3_bind_text(stmt, param + 5, tblspcDescr->checksum_algorithm.c_str(),
+                          -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, param + 6, tblspcDescr->checksum.c_str(),
+                          -1, SQLITE_STATIC);
+      }
+
+      backup_sizes[tblspcDescr->backup_id] += (sqlite3_int64) tblspcDescr->spcsize;
+
+    }
+
+    /*
+     * Execute query...
+     */
+    rc = sqlite3_step(stmt);
+
+    if (rc != SQLITE_DONE) {
+      std::ostringstream oss;
+      oss << "error registering tablespace: " << sqlite3_errmsg(this->db_handle);
+      sqlite3_finalize(stmt);
+      throw CCatalogIssue(oss.str());
+    }
+
+    /*
+     * Remember new registered ids of tablespaces. A multi-row
+     * INSERT assigns consecutive rowids, since we're the only
+     * writer within the current transaction.
+     */
+    last_rowid = sqlite3_last_insert_rowid(this->db_handle);
+
+    for (unsigned int i = 0; i < rows; i++) {
+      list[offset + i]->id = last_rowid - (rows - 1) + i;
+    }
 
-  if (rc != SQLITE_DONE) {
-    std::ostringstream oss;
-    oss << "error registering stream: " << sqlite3_errmsg(this->db_handle);
     sqlite3_finalize(stmt);
-    throw CCatalogIssue(oss.str());
+    offset += rows;
+
   }
 
   /*
-   * Remember new registered id of tablespace ...
+   * Tablespace sizes add to the approximate archive size.
    */
-  tblspcDescr->id = sqlite3_last_insert_rowid(this->db_handle);
+  for (auto &backup_size : backup_sizes) {
+
+    this->updateArchiveStat("approx_sz = approx_sz + ?2",
+                            "archive_id = (SELECT archive_id FROM backup WHERE id = ?1)",
+                            { backup_size.first, backup_size.second });
+
+  }
 
-  /*
-   * ... and we're done.
-   */
-  sqlite3_finalize(stmt);
 }
 
 std::vector<std::shared_ptr<ConnectionDescr>>
@@ -7260,6 +9005,12 @@ void BackupCatalog::checkCatalog() {
   if (!this->tableExists("backup_profiles"))
     throw CCatalogIssue("catalog database doesn't have a \"backup_profiles\" table");
 
+  if (!this->tableExists("wal_segments"))
+    throw CCatalogIssue("catalog database doesn't have a \"wal_segments\" table");
+
+  if (!this->tableExists("chunks"))
+    throw CCatalogIssue("catalog database doesn't have a \"chunks\" table");
+
   /*
    * Version check. Examine whether CATALOG_MAGIC and the
    * current database schema version match. This is a weak check,
@@ -0,0 +1,556 @@
+#include <metrics.hxx>
+#include <stream.hxx>
+#include <boost/log/trivial.hpp>
+#include <iomanip>
+
+using namespace pgbckctl;
+
+/******************************************************************************
+ * MetricsCatalogSnapshot implementation
+ ******************************************************************************/
+
+MetricsCatalogSnapshot::MetricsCatalogSnapshot() {}
+
+MetricsCatalogSnapshot::~MetricsCatalogSnapshot() {}
+
+void MetricsCatalogSnapshot::build(BackupCatalog &catalog,
+                                   unsigned long long generation) {
+
+  std::vector<std::shared_ptr<MetricsArchiveEntry>> list;
+  std::shared_ptr<std::list<std::shared_ptr<CatalogDescr>>> archiveList
+    = catalog.getArchiveList();
+
+  /*
+   * Fetch everything in one go before replacing the current
+   * contents, so we never leave a half-built snapshot behind
+   * in case the catalog throws.
+   */
+  for (auto &archiveDescr : *archiveList) {
+
+    std::shared_ptr<MetricsArchiveEntry> entry = std::make_shared<MetricsArchiveEntry>();
+
+    entry->archive = archiveDescr;
+    entry->stat = catalog.statCatalog(archiveDescr->archive_name);
+
+    /*
+     * getBackupList() returns the newest basebackup first, so the
+     * first one being ready is the one we are looking for.
+     */
+    for (auto &basebackup : catalog.getBackupList(archiveDescr->archive_name)) {
+
+      if (basebackup->status != BaseBackupDescr::BASEBACKUP_STATUS_READY)
+        continue;
+
+      entry->last_basebackup = basebackup;
+
+      for (auto &tblspc : basebackup->tablespaces) {
+        entry->last_basebackup_size += tblspc.spcsize;
+      }
+
+      break;
+
+    }
+
+    catalog.getStreams(archiveDescr->archive_name, entry->streams);
+
+    list.push_back(entry);
+
+  }
+
+  this->archives   = list;
+  this->generation = generation;
+  this->built_at   = std::chrono::steady_clock::now();
+  this->built      = true;
+
+  BOOST_LOG_TRIVIAL(debug) << "metrics catalog snapshot built with "
+                           << archives.size()
+                           << " archives, generation "
+                           << generation;
+
+}
+
+bool MetricsCatalogSnapshot::isValid(unsigned long long generation,
+                                     unsigned int max_age) {
+
+  if (!this->built || this->generation != generation)
+    return false;
+
+  return (std::chrono::steady_clock::now() - this->built_at)
+    < std::chrono::seconds(max_age);
+
+}
+
+unsigned long long MetricsCatalogSnapshot::getGeneration() {
+
+  return generation;
+
+}
+
+std::vector<std::shared_ptr<MetricsArchiveEntry>> MetricsCatalogSnapshot::getArchives() {
+
+  return archives;
+
+}
+
+std::shared_ptr<MetricsArchiveEntry> MetricsCatalogSnapshot::getArchive(int archive_id) {
+
+  for (auto &entry : archives) {
+
+    if (entry->archive->id == archive_id)
+      return entry;
+
+  }
+
+  return nullptr;
+
+}
+
+/******************************************************************************
+ * OpenMetricsRenderer implementation
+ ******************************************************************************/
+
+OpenMetricsRenderer::OpenMetricsRenderer(std::ostream &out) : out(out) {}
+
+OpenMetricsRenderer::~OpenMetricsRenderer() {}
+
+std::string OpenMetricsRenderer::escape(std::string value) {
+
+  std::string result;
+
+  for (auto c : value) {
+
+    switch(c) {
+    case '\\':
+      result += "\\\\";
+      break;
+    case '"':
+      result += "\\\"";
+      break;
+    case '\n':
+      result += "\\n";
+      break;
+    default:
+      result += c;
+    }
+
+  }
+
+  return result;
+
+}
+
+void OpenMetricsRenderer::family(std::string name,
+                                 std::string type,
+                                 std::string help) {
+
+  out << "# TYPE " << name << " " << type << "\n";
+  out << "# HELP " << name << " " << help << "\n";
+
+}
+
+void OpenMetricsRenderer::sample(std::string name,
+                                 std::vector<std::pair<std::string, std::string>> labels,
+                                 std::string value) {
+
+  std::string separator = "";
+
+  out << name;
+
+  if (labels.size() > 0) {
+
+    out << "{";
+
+    for (auto &label : labels) {
+      out << separator << label.first << "=\"" << escape(label.second) << "\"";
+      separator = ",";
+    }
+
+    out << "}";
+
+  }
+
+  out << " " << value << "\n";
+
+}
+
+void OpenMetricsRenderer::sample(std::string name,
+                                 std::vector<std::pair<std::string, std::string>> labels,
+                                 unsigned long long value) {
+
+  std::ostringstream oss;
+
+  oss << value;
+  sample(name, labels, oss.str());
+
+}
+
+void OpenMetricsRenderer::sample(std::string name,
+                                 std::vector<std::pair<std::string, std::string>> labels,
+                                 double value) {
+
+  std::ostringstream oss;
+
+  oss << std::fixed << std::setprecision(2) << value;
+  sample(name, labels, oss.str());
+
+}
+
+/*
+ * Decodes the catalog WAL position of a stream, returns
+ * false if the stream doesn't have a valid one.
+ */
+static bool stream_lsn(std::shared_ptr<StreamIdentification> stream,
+                       unsigned long long &lsn) {
+
+  try {
+
+    lsn = PGStream::decodeXLOGPos(stream->xlogpos);
+    return true;
+
+  } catch(StreamingFailure &e) {
+    return false;
+  }
+
+}
+
+void OpenMetricsRenderer::render(std::shared_ptr<MetricsCatalogSnapshot> snapshot,
+                                 std::vector<std::pair<unsigned int, shm_worker_area>> workers,
+                                 size_t max_workers) {
+
+  boost::posix_time::ptime now
+    = CPGBackupCtlBase::ISO8601_strTo_ptime(CPGBackupCtlBase::current_timestamp());
+  std::vector<std::shared_ptr<MetricsArchiveEntry>> archives = snapshot->getArchives();
+
+  /*
+   * Catalog metrics, served from the snapshot.
+   */
+  family("pgbckctl_catalog_generation", "gauge",
+         "Catalog generation the metrics snapshot was built from.");
+  sample("pgbckctl_catalog_generation", {}, snapshot->getGeneration());
+
+  family("pgbckctl_archive_info", "gauge", "Archives registered in the catalog.");
+  for (auto &entry : archives) {
+    sample("pgbckctl_archive_info",
+           { { "archive", entry->archive->archive_name },
+             { "directory", entry->archive->directory } },
+           1ULL);
+  }
+
+  family("pgbckctl_archive_basebackups", "gauge",
+         "Number of basebackups in the archive, by status.");
+  for (auto &entry : archives) {
+
+    if (entry->stat->archive_id < 0)
+      continue;
+
+    sample("pgbckctl_archive_basebackups",
+           { { "archive", entry->archive->archive_name }, { "status", "total" } },
+           (unsigned long long) entry->stat->number_of_backups);
+    sample("pgbckctl_archive_basebackups",
+           { { "archive", entry->archive->archive_name }, { "status", "failed" } },
+           (unsigned long long) entry->stat->backups_failed);
+    sample("pgbckctl_archive_basebackups",
+           { { "archive", entry->archive->archive_name }, { "status", "running" } },
+           (unsigned long long) entry->stat->backups_running);
+
+  }
+
+  family("pgbckctl_archive_basebackup_size_bytes", "gauge",
+         "Estimated size of all basebackups in the archive.");
+  for (auto &entry : archives) {
+
+    if (entry->stat->archive_id < 0)
+      continue;
+
+    sample("pgbckctl_archive_basebackup_size_bytes",
+           { { "archive", entry->archive->archive_name } },
+           entry->stat->estimated_total_size);
+
+  }
+
+  family("pgbckctl_archive_basebackup_duration_avg_seconds", "gauge",
+         "Average duration of successful basebackups in the archive.");
+  for (auto &entry : archives) {
+
+    if (entry->stat->archive_id < 0)
+      continue;
+
+    sample("pgbckctl_archive_basebackup_duration_avg_seconds",
+           { { "archive", entry->archive->archive_name } },
+           (unsigned long long) entry->stat->avg_backup_duration);
+
+  }
+
+  family("pgbckctl_archive_wal_segments", "gauge",
+         "WAL segments currently stored in the archive.");
+  for (auto &entry : archives) {
+
+    if (entry->stat->archive_id < 0)
+      continue;
+
+    sample("pgbckctl_archive_wal_segments",
+           { { "archive", entry->archive->archive_name } },
+           entry->stat->wal_segments);
+
+  }
+
+  family("pgbckctl_archive_wal_size_bytes", "gauge",
+         "Size of the WAL segments currently stored in the archive.");
+  for (auto &entry : archives) {
+
+    if (entry->stat->archive_id < 0)
+      continue;
+
+    sample("pgbckctl_archive_wal_size_bytes",
+           { { "archive", entry->archive->archive_name } },
+           entry->stat->wal_bytes);
+
+  }
+
+  family("pgbckctl_last_basebackup_age_seconds", "gauge",
+         "Seconds since the newest ready basebackup of the archive finished.");
+  for (auto &entry : archives) {
+
+    if (entry->last_basebackup == nullptr)
+      continue;
+
+    boost::posix_time::ptime stopped
+      = CPGBackupCtlBase::ISO8601_strTo_ptime(entry->last_basebackup->stopped);
+
+    if (stopped.is_not_a_date_time() || stopped > now)
+      continue;
+
+    sample("pgbckctl_last_basebackup_age_seconds",
+           { { "archive", entry->archive->archive_name } },
+           (unsigned long long) (now - stopped).total_seconds());
+
+  }
+
+  family("pgbckctl_last_basebackup_size_bytes", "gauge",
+         "Size of the newest ready basebackup of the archive.");
+  for (auto &entry : archives) {
+
+    if (entry->last_basebackup == nullptr)
+      continue;
+
+    sample("pgbckctl_last_basebackup_size_bytes",
+           { { "archive", entry->archive->archive_name } },
+           entry->last_basebackup_size);
+
+  }
+
+  family("pgbckctl_stream_catalog_lsn", "gauge",
+         "WAL position of the stream as recorded in the catalog.");
+  for (auto &entry : archives) {
+
+    for (auto &stream : entry->streams) {
+
+      unsigned long long lsn;
+
+      if (!stream_lsn(stream, lsn))
+        continue;
+
+      sample("pgbckctl_stream_catalog_lsn",
+             { { "archive", entry->archive->archive_name },
+               { "slot", stream->slot_name },
+               { "status", stream->status } },
+             lsn);
+
+    }
+
+  }
+
+  /*
+   * Worker metrics, read from the worker shared memory.
+   */
+  family("pgbckctl_workers_max", "gauge", "Number of available worker slots.");
+  sample("pgbckctl_workers_max", {}, (unsigned long long) max_workers);
+
+  family("pgbckctl_workers_used", "gauge", "Number of used worker slots.");
+  sample("pgbckctl_workers_used", {}, (unsigned long long) workers.size());
+
+  family("pgbckctl_worker_running_seconds", "gauge",
+         "Seconds since the worker was started.");
+  for (auto &worker : workers) {
+
+    std::shared_ptr<MetricsArchiveEntry> entry = snapshot->getArchive(worker.second.archive_id);
+    unsigned long long running = 0;
+
+    if (!worker.second.started.is_not_a_date_time() && worker.second.started < now)
+      running = (now - worker.second.started).total_seconds();
+
+    sample("pgbckctl_worker_running_seconds",
+           { { "slot", CPGBackupCtlBase::intToStr(worker.first) },
+             { "pid", CPGBackupCtlBase::intToStr(worker.second.pid) },
+             { "command", CatalogDescr::commandTagName(worker.second.cmdType) },
+             { "archive", (entry != nullptr) ? entry->archive->archive_name : "" } },
+           running);
+
+  }
+
+  family("pgbckctl_worker_children", "gauge",
+         "Number of child processes registered by the worker.");
+  for (auto &worker : workers) {
+
+    unsigned long long childs = 0;
+
+    for (unsigned int i = 0; i < MAX_WORKER_CHILDS; i++) {
+      if (worker.second.child_info[i].pid > 0)
+        childs++;
+    }
+
+    sample("pgbckctl_worker_children",
+           { { "slot", CPGBackupCtlBase::intToStr(worker.first) } },
+           childs);
+
+  }
+
+  /*
+   * Instrumentation published by the workers, one metric
+   * family per instrumentation key.
+   */
+  struct {
+    int key;
+    const char *name;
+    const char *help;
+  } instr_families[] = {
+    { INSTR_WAL_RECEIVED_LSN, "pgbckctl_wal_received_lsn",
+      "Last WAL position received by the streamer." },
+    { INSTR_WAL_FLUSHED_LSN, "pgbckctl_wal_flushed_lsn",
+      "Last WAL position flushed to the archive by the streamer." },
+    { INSTR_WAL_BYTES_PER_SEC, "pgbckctl_wal_receive_bytes_per_second",
+      "WAL receive rate of the streamer." },
+    { INSTR_WAL_MSGS_PER_SEC, "pgbckctl_wal_receive_messages_per_second",
+      "WAL message rate of the streamer." },
+    { INSTR_WAL_FSYNC_USEC, "pgbckctl_wal_fsync_microseconds",
+      "Duration of the last WAL fsync of the streamer." },
+    { INSTR_BASEBACKUP_TABLESPACE_OID, "pgbckctl_basebackup_tablespace_oid",
+      "OID of the tablespace currently streamed by the basebackup." },
+    { INSTR_BASEBACKUP_TABLESPACE_BYTES, "pgbckctl_basebackup_tablespace_bytes",
+      "Bytes streamed for the current tablespace by the basebackup." },
+    { INSTR_BASEBACKUP_BYTES_PER_SEC, "pgbckctl_basebackup_bytes_per_second",
+      "Streaming rate of the basebackup." },
+    { INSTR_BASEBACKUP_WRITE_QUEUE_DEPTH, "pgbckctl_basebackup_write_queue_depth",
+      "Buffers of the basebackup waiting to be written." },
+    { INSTR_BASEBACKUP_RECEIVER_STALL_MSEC, "pgbckctl_basebackup_receiver_stall_milliseconds",
+      "Time the basebackup receiver waited for its writer." },
+    { INSTR_BASEBACKUP_WRITER_IDLE_MSEC, "pgbckctl_basebackup_writer_idle_milliseconds",
+      "Time the basebackup writer waited for data." }
+  };
+
+  for (auto &instr_family : instr_families) {
+
+    family(instr_family.name, "gauge", instr_family.help);
+
+    for (auto &worker : workers) {
+
+      std::shared_ptr<MetricsArchiveEntry> entry = snapshot->getArchive(worker.second.archive_id);
+
+      for (unsigned int i = 0; i < MAX_WORKER_INSTRUMENTATION_SLOTS; i++) {
+
+        if (worker.second.instr[i].key != instr_family.key)
+          continue;
+
+        sample(instr_family.name,
+               { { "slot", CPGBackupCtlBase::intToStr(worker.first) },
+                 { "archive", (entry != nullptr) ? entry->archive->archive_name : "" } },
+               (unsigned long long) worker.second.instr[i].value);
+
+      }
+
+    }
+
+  }
+
+  /* The compression ratio is stored in hundredths */
+  family("pgbckctl_basebackup_compression_ratio", "gauge",
+         "Compression ratio of the current basebackup tablespace.");
+  for (auto &worker : workers) {
+
+    std::shared_ptr<MetricsArchiveEntry> entry = snapshot->getArchive(worker.second.archive_id);
+
+    for (unsigned int i = 0; i < MAX_WORKER_INSTRUMENTATION_SLOTS; i++) {
+
+      if (worker.second.instr[i].key != INSTR_BASEBACKUP_COMPRESSION_RATIO)
+        continue;
+
+      sample("pgbckctl_basebackup_compression_ratio",
+             { { "slot", CPGBackupCtlBase::intToStr(worker.first) },
+               { "archive", (entry != nullptr) ? entry->archive->archive_name : "" } },
+             worker.second.instr[i].value / 100.0);
+
+    }
+
+  }
+
+  /*
+   * Per archive WAL lag, derived from the positions published
+   * by the streamer and the position recorded in the catalog.
+   * Collect the positions first, since all samples of a metric
+   * family must be written in one go.
+   */
+  struct wal_positions {
+    std::shared_ptr<MetricsArchiveEntry> entry;
+    long long received;
+    long long flushed;
+  };
+  std::vector<wal_positions> streamers;
+
+  for (auto &worker : workers) {
+
+    wal_positions pos = { snapshot->getArchive(worker.second.archive_id), -1, -1 };
+
+    if (worker.second.cmdType != START_STREAMING_FOR_ARCHIVE || pos.entry == nullptr)
+      continue;
+
+    for (unsigned int i = 0; i < MAX_WORKER_INSTRUMENTATION_SLOTS; i++) {
+
+      if (worker.second.instr[i].key == INSTR_WAL_RECEIVED_LSN)
+        pos.received = worker.second.instr[i].value;
+
+      if (worker.second.instr[i].key == INSTR_WAL_FLUSHED_LSN)
+        pos.flushed = worker.second.instr[i].value;
+
+    }
+
+    if (pos.received >= 0)
+      streamers.push_back(pos);
+
+  }
+
+  family("pgbckctl_archive_wal_flush_lag_bytes", "gauge",
+         "WAL received by the streamer but not yet flushed to the archive.");
+  for (auto &pos : streamers) {
+
+    if (pos.flushed < 0)
+      continue;
+
+    sample("pgbckctl_archive_wal_flush_lag_bytes",
+           { { "archive", pos.entry->archive->archive_name } },
+           (unsigned long long) ((pos.received > pos.flushed) ? pos.received - pos.flushed : 0));
+
+  }
+
+  family("pgbckctl_archive_wal_catalog_lag_bytes", "gauge",
+         "WAL received by the streamer but not yet recorded in the catalog.");
+  for (auto &pos : streamers) {
+
+    for (auto &stream : pos.entry->streams) {
+
+      unsigned long long lsn;
+
+      if (!stream_lsn(stream, lsn))
+        continue;
+
+      sample("pgbckctl_archive_wal_catalog_lag_bytes",
+             { { "archive", pos.entry->archive->archive_name },
+               { "slot", stream->slot_name } },
+             (unsigned long long) (((unsigned long long) pos.received > lsn) ? pos.received - lsn : 0));
+
+    }
+
+  }
+
+  out << "# EOF\n";
+
+}
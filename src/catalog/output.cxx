@@ -2,6 +2,8 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/foreach.hpp>
 #include <vector>
+#include <iomanip>
+#include <time.h>
 
 #include <common.hxx>
 #include <fs-archive.hxx>
@@ -10,6 +12,27 @@
 
 using namespace pgbckctl;
 
+/*
+ * Formats a worker event timestamp (nanoseconds since the
+ * epoch) as local time with microseconds.
+ */
+static std::string event_time_str(long long timestamp) {
+
+  time_t sec = (time_t) (timestamp / 1000000000LL);
+  struct tm tm_local;
+  char buf[32];
+  std::ostringstream oss;
+
+  localtime_r(&sec, &tm_local);
+  strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_local);
+
+  oss << buf << "." << std::setw(6) << std::setfill('0')
+      << (timestamp % 1000000000LL) / 1000;
+
+  return oss.str();
+
+}
+
 /* ****************************************************************************
  * Implementation of OutputFormatter
  * ****************************************************************************/
@@ -203,6 +226,17 @@ void ConsoleOutputFormatter::listBackupsVerbose(std::vector<std::shared_ptr<Base
     output << CPGBackupCtlBase::makeLine(boost::format("%-20s\t%-60s")
                                        % "Used Backup Profile" % backupProfile->name);
 
+    if (basebackup->parent_id >= 0)
+      output << CPGBackupCtlBase::makeLine(boost::format("%-20s\t%-60s")
+                                         % "Incremental Of" % basebackup->parent_id);
+
+    if (basebackup->bad_pages > 0) {
+      output << CPGBackupCtlBase::makeLine(boost::format("%-20s\t%-60s")
+                                           % "Bad Pages" % basebackup->bad_pages);
+      output << CPGBackupCtlBase::makeLine(boost::format("%-20s\t%-60s")
+                                           % "Bad Pages Detail" % basebackup->bad_pages_detail);
+    }
+
     /*
      * Print tablespace information belonging to the current basebackup
      */
@@ -216,27 +250,27 @@ void ConsoleOutputFormatter::listBackupsVerbose(std::vector<std::shared_ptr<Base
       output << "---" << std::endl;
 
       /* Check for parent tablespace (also known as pg_default) */
-      if (tablespace->spcoid == 0) {
+      if (tablespace.spcoid == 0) {
 
         output << " - " << boost::format("%-20s\%-60s")
           % "upstream location" % "pg_default" << std::endl;
         output << " - " << boost::format("%-20s\%-60s")
-          % "upstream size" % tablespace->spcsize << std::endl;
+          % "upstream size" % tablespace.spcsize << std::endl;
 
       } else {
 
         output << " - " << boost::format("%-20s\%-60s")
-          % "oid" % tablespace->spcoid << std::endl;
+          % "oid" % tablespace.spcoid << std::endl;
         output << " - " << boost::format("%-20s\%-60s")
-          % "upstream location" % tablespace->spclocation << std::endl;
+          % "upstream location" % tablespace.spclocation << std::endl;
         output << " - " << boost::format("%-20s\%-60s")
-          % "upstream size" % tablespace->spcsize << std::endl;
+          % "upstream size" % tablespace.spcsize << std::endl;
 
       }
 
       output << "---" << std::endl;
 
-      upstream_total_size += tablespace->spcsize;
+      upstream_total_size += tablespace.spcsize;
     }
 
     output << "Summary:" << std::endl;
@@ -419,6 +453,22 @@ void ConsoleOutputFormatter::nodeAs(std::vector<shm_worker_area> &slots,
          << " | started " << CPGBackupCtlBase::ptime_to_str(worker.started)
          << endl;
 
+    /* Print scheduling policy, if published */
+    if (worker.policy.cpus[0] != '\0') {
+      cout << " `-> POLICY "
+           << WorkerPolicy::typeName(worker.policy.type)
+           << " | cpus " << worker.policy.cpus
+           << " | numa nodes " << ((worker.policy.numa_nodes[0] != '\0') ? worker.policy.numa_nodes : "any")
+           << " | nice " << worker.policy.nice
+           << " | io " << WorkerPolicy::ioprioClassName(worker.policy.ioprio_class);
+
+      if (worker.policy.ioprio_class != WORKER_IOPRIO_INHERIT
+          && worker.policy.ioprio_class != WORKER_IOPRIO_IDLE)
+        cout << "/" << worker.policy.ioprio_level;
+
+      cout << endl;
+    }
+
     /* Print child info, if any */
     for (unsigned int idx = 0; idx < MAX_WORKER_CHILDS; idx++) {
 
@@ -436,11 +486,45 @@ void ConsoleOutputFormatter::nodeAs(std::vector<shm_worker_area> &slots,
       }
     }
 
+    /* Print instrumentation, if any */
+    for (unsigned int idx = 0; idx < MAX_WORKER_INSTRUMENTATION_SLOTS; idx++) {
+
+      worker_instrumentation_item item = worker.instr[idx];
+
+      if (item.key != INSTR_NONE) {
+        cout << " `-> "
+             << WorkerInstrumentation::keyName(item.key)
+             << " "
+             << WorkerInstrumentation::valueString(item)
+             << endl;
+      }
+    }
+
   }
 
 
 }
 
+void ConsoleOutputFormatter::nodeAs(std::vector<worker_event> &events,
+                                    std::ostringstream &output) {
+
+  output << CPGBackupCtlBase::makeHeader("Worker events",
+                                         boost::format("%-26s\t%-8s\t%-22s\t%-40s")
+                                         % "TIME" % "PID" % "EVENT" % "ARGUMENTS",
+                                         80);
+
+  for (auto &event : events) {
+
+    output << boost::format("%-26s\t%-8s\t%-22s\t%-40s")
+      % event_time_str(event.timestamp)
+      % event.pid
+      % WorkerEventLog::eventName(event.event)
+      % WorkerEventLog::argsString(event) << endl;
+
+  }
+
+}
+
 void ConsoleOutputFormatter::nodeAs(std::vector<std::shared_ptr<RetentionDescr>> &retentionList,
                                     std::ostringstream &output) {
 
@@ -472,6 +556,30 @@ void ConsoleOutputFormatter::nodeAs(std::vector<std::shared_ptr<RetentionDescr>>
 
 }
 
+void ConsoleOutputFormatter::nodeAs(std::vector<std::shared_ptr<ScheduleDescr>> &schedules,
+                                    std::ostringstream &output) {
+
+  output << CPGBackupCtlBase::makeHeader("List of schedules",
+                                         boost::format("%-15s\t%-15s\t%-20s\t%-20s")
+                                         % "ARCHIVE" % "NAME" % "CRON" % "JOB",
+                                         80);
+
+  for (auto &schedule : schedules) {
+
+    std::string job = ScheduleDescr::actionToString(schedule->action);
+
+    if (schedule->param.length() > 0)
+      job += " " + schedule->param;
+
+    output << boost::format("%-15s\t%-15s\t%-20s\t%-20s")
+      % schedule->archive_name % schedule->name % schedule->cron % job << endl;
+    output << boost::format("%-15s\t%-60s")
+      % " - last run" % ((schedule->last_run.length() > 0) ? schedule->last_run : "never") << endl;
+
+  }
+
+}
+
 void ConsoleOutputFormatter::nodeAs(std::shared_ptr<RetentionDescr> retentionDescr,
                                     std::ostringstream &output) {
 
@@ -648,7 +756,7 @@ void ConsoleOutputFormatter::nodeAs(std::shared_ptr<BackupProfileDescr> profile,
 
   /* Profile compression type */
   output << boost::format("%-25s\t%-30s") % "COMPRESSION"
-    % BackupProfileDescr::compressionType(profile->compress_type) << endl;
+    % profile->compressionString() << endl;
 
   /* Profile max rate */
   if (profile->max_rate <= 0) {
@@ -678,6 +786,12 @@ void ConsoleOutputFormatter::nodeAs(std::shared_ptr<BackupProfileDescr> profile,
   /* Profile MANIFEST_CHECKSUMS */
   output << boost::format("%-25s\t%-30s") % "MANIFEST CHECKSUMS" % profile->manifest_checksums<< endl;
 
+  /* Profile DEDUPLICATE */
+  output << boost::format("%-25s\t%-30s") % "DEDUPLICATE" % profile->deduplicate<< endl;
+
+  /* Profile VERIFY_PAGES */
+  output << boost::format("%-25s\t%-30s") % "VERIFY PAGES" % profile->verify_pages<< endl;
+
 }
 
 void ConsoleOutputFormatter::nodeAs(std::shared_ptr<std::list<std::shared_ptr<BackupProfileDescr>>> &list,
@@ -723,6 +837,91 @@ void ConsoleOutputFormatter::nodeAs(std::shared_ptr<StatCatalogArchive> stat,
     % stat->avg_backup_duration;
   output << endl;
 
+  /*
+   * Storage occupied by basebackups and WAL.
+   */
+  output << CPGBackupCtlBase::makeHeader("Storage",
+                                            boost::format("%-12s\t%-20s\t%-9s\t%-12s")
+                                            % "approx size" % "latest finished"
+                                            % "# WAL" % "WAL size", 80);
+  output << boost::format("%-12s\t%-20s\t%-9s\t%-12s")
+    % CPGBackupCtlBase::prettySize(stat->estimated_total_size)
+    % stat->latest_finished
+    % stat->wal_segments
+    % CPGBackupCtlBase::prettySize(stat->wal_bytes);
+  output << endl;
+
+}
+
+void ConsoleOutputFormatter::nodeAs(std::shared_ptr<BaseBackupVerifyResult> result,
+                                    std::ostringstream &output) {
+
+  unsigned int files_ok = 0;
+  unsigned int files_nocsum = 0;
+
+  output << CPGBackupCtlBase::makeHeader("Verification of basebackup "
+                                         + std::to_string(result->basebackup_id)
+                                         + " in archive " + result->archive_name,
+                                         boost::format("%-20s\t%-12s\t%-40s")
+                                         % "STATUS" % "SIZE" % "FILE",
+                                         80);
+
+  /*
+   * A basebackup consists of thousands of files, so list
+   * only those with problems.
+   */
+  for (auto &file : result->files) {
+
+    if (file.status == VERIFY_FILE_OK) {
+      files_ok++;
+      continue;
+    }
+
+    if (file.status == VERIFY_FILE_NO_CHECKSUM) {
+      files_nocsum++;
+      continue;
+    }
+
+    output << boost::format("%-20s\t%-12s\t%-40s")
+      % BaseBackupVerifyResult::statusToString(file.status)
+      % CPGBackupCtlBase::prettySize(file.size)
+      % (file.archive.empty() ? file.path : file.archive + ":" + file.path) << endl;
+
+  }
+
+  for (auto &error : result->errors) {
+    output << boost::format("%-20s\t%-12s\t%-40s") % "ERROR" % "" % error << endl;
+  }
+
+  for (auto &segment : result->wal_missing) {
+    output << boost::format("%-20s\t%-12s\t%-40s") % "WAL MISSING" % "" % segment << endl;
+  }
+
+  output << CPGBackupCtlBase::makeLine(80) << endl;
+
+  output << boost::format("%-25s\t%-40s") % "Directory" % result->fsentry << endl;
+  output << boost::format("%-25s\t%-40s") % "Manifest" % result->manifest_status << endl;
+  output << boost::format("%-25s\t%-40s") % "Files verified" % files_ok << endl;
+  output << boost::format("%-25s\t%-40s") % "Files without checksum" % files_nocsum << endl;
+  output << boost::format("%-25s\t%-40s") % "Failures" % result->failures() << endl;
+
+  if (!result->checksum_implementation.empty())
+    output << boost::format("%-25s\t%-40s") % "CRC32C" % result->checksum_implementation << endl;
+
+  output << boost::format("%-25s\t%-40s") % "WAL range"
+    % (boost::format("%s - %s on timeline %u")
+       % result->wal_start % result->wal_end % result->timeline) << endl;
+  output << boost::format("%-25s\t%-40s") % "WAL segments"
+    % (boost::format("%u (%u missing)")
+       % result->wal_segments % result->wal_missing.size()) << endl;
+  output << boost::format("%-25s\t%-40s") % "Threads" % result->parallel << endl;
+  output << boost::format("%-25s\t%-40s") % "Bytes read"
+    % CPGBackupCtlBase::prettySize(result->bytes) << endl;
+  output << boost::format("%-25s\t%-40s") % "Duration"
+    % (boost::format("%.3f s") % ((double) result->elapsed_msec / 1000.0)) << endl;
+  output << boost::format("%-25s\t%-40s") % "Throughput"
+    % (boost::format("%.1f MB/s") % result->throughput()) << endl;
+
 }
 
 /* ****************************************************************************
@@ -932,6 +1131,9 @@ void JsonOutputFormatter::listBackupsVerbose(std::vector<std::shared_ptr<BaseBac
     bbackup.put("wal stop location", descr->xlogposend);
     bbackup.put("system id", descr->systemid);
     bbackup.put("wal segment size", descr->wal_segment_size);
+    bbackup.put("incremental of", descr->parent_id);
+    bbackup.put("bad pages", descr->bad_pages);
+    bbackup.put("bad pages detail", descr->bad_pages_detail);
     bbackup.put("size", directory.size());
     bbackup.put("status",
                 BackupDirectory::verificationCodeAsString(StreamingBaseBackupDirectory::verify(descr)));
@@ -942,21 +1144,21 @@ void JsonOutputFormatter::listBackupsVerbose(std::vector<std::shared_ptr<BaseBac
 
     bbackup.put("num_tablespaces", oss.str());
 
-    BOOST_FOREACH(const std::shared_ptr<BackupTablespaceDescr> &tblspc, descr->tablespaces) {
+    BOOST_FOREACH(const BackupTablespaceEntry &tblspc, descr->tablespaces) {
 
       pt::ptree tblspcinfo;
 
-      tblspcinfo.put("tablespace oid", tblspc->spcoid);
-      tblspcinfo.put("tablespace size", tblspc->spcsize);
+      tblspcinfo.put("tablespace oid", tblspc.spcoid);
+      tblspcinfo.put("tablespace size", tblspc.spcsize);
 
       /* Check for parent tablespace (also known as pg_default) */
-      if (tblspc->spcoid == 0) {
+      if (tblspc.spcoid == 0) {
         tblspcinfo.put("tablespace location", "pg_default");
       } else {
-        tblspcinfo.put("tablespace location", tblspc->spclocation);
+        tblspcinfo.put("tablespace location", tblspc.spclocation);
       }
 
-      upstream_total_size += tblspc->spcsize;
+      upstream_total_size += tblspc.spcsize;
       tablespaces.push_back(std::make_pair("", tblspcinfo));
 
     }
@@ -1022,6 +1224,38 @@ void JsonOutputFormatter::nodeAs(std::vector<std::shared_ptr<RetentionDescr>> &r
 
 }
 
+void JsonOutputFormatter::nodeAs(std::vector<std::shared_ptr<ScheduleDescr>> &schedules,
+                                 std::ostringstream &output) {
+
+  namespace pt = boost::property_tree;
+
+  pt::ptree head;
+  pt::ptree slist;
+
+  head.put("number of schedules", schedules.size());
+
+  for (auto &schedule : schedules) {
+
+    pt::ptree item;
+
+    item.put("id", schedule->id);
+    item.put("archive name", schedule->archive_name);
+    item.put("name", schedule->name);
+    item.put("cron", schedule->cron);
+    item.put("action", ScheduleDescr::actionToString(schedule->action));
+    item.put("param", schedule->param);
+    item.put("created", schedule->created);
+    item.put("last run", schedule->last_run);
+
+    slist.push_back(std::make_pair("", item));
+
+  }
+
+  head.add_child("schedules", slist);
+  pt::write_json(output, head);
+
+}
+
 void JsonOutputFormatter::nodeAs(std::shared_ptr<RetentionDescr> retentionDescr,
                                  std::ostringstream &output) {
 
@@ -1084,6 +1318,39 @@ void JsonOutputFormatter::nodeAs(std::vector<shm_worker_area> &slots,
         current.push_back(std::make_pair("", child_node));
       }
 
+      /* Instrumentation, if any */
+      pt::ptree instr_node;
+
+      for (unsigned int idx = 0; idx < MAX_WORKER_INSTRUMENTATION_SLOTS; idx++) {
+
+        worker_instrumentation_item item = worker.instr[idx];
+
+        if (item.key != INSTR_NONE) {
+          instr_node.put(WorkerInstrumentation::keyName(item.key),
+                         WorkerInstrumentation::valueString(item));
+        }
+      }
+
+      if (!instr_node.empty()) {
+        current.add_child("instrumentation", instr_node);
+      }
+
+      /* Scheduling policy, if published */
+      if (worker.policy.cpus[0] != '\0') {
+
+        pt::ptree policy_node;
+
+        policy_node.put("job type", WorkerPolicy::typeName(worker.policy.type));
+        policy_node.put("cpus", worker.policy.cpus);
+        policy_node.put("numa nodes", worker.policy.numa_nodes);
+        policy_node.put("nice", worker.policy.nice);
+        policy_node.put("ioprio class", WorkerPolicy::ioprioClassName(worker.policy.ioprio_class));
+        policy_node.put("ioprio level", worker.policy.ioprio_level);
+
+        current.add_child("policy", policy_node);
+
+      }
+
       workers.push_back(std::make_pair("", current));
     }
 
@@ -1094,6 +1361,35 @@ void JsonOutputFormatter::nodeAs(std::vector<shm_worker_area> &slots,
 
 }
 
+void JsonOutputFormatter::nodeAs(std::vector<worker_event> &events,
+                                 std::ostringstream &output) {
+
+  namespace pt = boost::property_tree;
+
+  pt::ptree head;
+  pt::ptree elist;
+
+  head.put("number of events", events.size());
+
+  for (auto &event : events) {
+
+    pt::ptree item;
+
+    item.put("time", event_time_str(event.timestamp));
+    item.put("pid", event.pid);
+    item.put("slot", event.slot);
+    item.put("event", WorkerEventLog::eventName(event.event));
+    item.put("arguments", WorkerEventLog::argsString(event));
+
+    elist.push_back(std::make_pair("", item));
+
+  }
+
+  head.add_child("events", elist);
+  pt::write_json(output, head);
+
+}
+
 void JsonOutputFormatter::nodeAs(std::shared_ptr<std::list<std::shared_ptr<CatalogDescr>>> list,
                                  std::ostringstream &output) {
 
@@ -1233,6 +1529,9 @@ void JsonOutputFormatter::listBackupProfileDetail(std::shared_ptr<BackupProfileD
                                                   boost::property_tree::ptree &node) {
 
   node.put("compress type", BackupProfileDescr::compressionType(descr->compress_type));
+  node.put("compress on server", descr->compress_on_server);
+  node.put("compress level", descr->compress_level);
+  node.put("compress workers", descr->compress_workers);
   node.put("max rate", descr->max_rate);
   node.put("backup label", descr->label);
   node.put("fast checkpoint", descr->fast_checkpoint);
@@ -1241,6 +1540,8 @@ void JsonOutputFormatter::listBackupProfileDetail(std::shared_ptr<BackupProfileD
   node.put("noverify checksums", descr->noverify_checksums);
   node.put("manifest", descr->manifest);
   node.put("manifest checksums", descr->manifest_checksums);
+  node.put("deduplicate", descr->deduplicate);
+  node.put("verify pages", descr->verify_pages);
 
 }
 
@@ -1294,9 +1595,97 @@ void JsonOutputFormatter::nodeAs(std::shared_ptr<StatCatalogArchive> stat,
   stats.put("backups running", stat->backups_running);
   stats.put("avg duration", stat->avg_backup_duration);
   stats.put("backups failed", stat->backups_failed);
+  stats.put("approx size", stat->estimated_total_size);
+  stats.put("latest finished", stat->latest_finished);
+  stats.put("wal segments", stat->wal_segments);
+  stats.put("wal size", stat->wal_bytes);
 
   head.add_child("backup statistics", stats);
 
   pt::write_json(output, head);
 
 }
+
+void JsonOutputFormatter::nodeAs(std::shared_ptr<BaseBackupVerifyResult> result,
+                                 std::ostringstream &output) {
+
+  namespace pt = boost::property_tree;
+
+  pt::ptree head;
+  pt::ptree flist;
+  pt::ptree elist;
+  pt::ptree wal;
+  pt::ptree wlist;
+  unsigned int files_ok = 0;
+  unsigned int files_nocsum = 0;
+
+  head.put("basebackup id", result->basebackup_id);
+  head.put("archive name", result->archive_name);
+  head.put("directory", result->fsentry);
+  head.put("manifest", result->manifest_status);
+  head.put("crc32c", result->checksum_implementation);
+  head.put("threads", result->parallel);
+
+  /* only files with problems are listed, see console output */
+  for (auto &file : result->files) {
+
+    pt::ptree item;
+
+    if (file.status == VERIFY_FILE_OK) {
+      files_ok++;
+      continue;
+    }
+
+    if (file.status == VERIFY_FILE_NO_CHECKSUM) {
+      files_nocsum++;
+      continue;
+    }
+
+    item.put("path", file.path);
+    item.put("archive", file.archive);
+    item.put("size", file.size);
+    item.put("status", BaseBackupVerifyResult::statusToString(file.status));
+    item.put("algorithm", file.algorithm);
+    item.put("expected", file.expected);
+    item.put("computed", file.computed);
+
+    flist.push_back(std::make_pair("", item));
+
+  }
+
+  for (auto &error : result->errors) {
+
+    pt::ptree item;
+    item.put("", error);
+    elist.push_back(std::make_pair("", item));
+
+  }
+
+  for (auto &segment : result->wal_missing) {
+
+    pt::ptree item;
+    item.put("", segment);
+    wlist.push_back(std::make_pair("", item));
+
+  }
+
+  head.put("files verified", files_ok);
+  head.put("files without checksum", files_nocsum);
+  head.put("failures", result->failures());
+  head.add_child("files", flist);
+  head.add_child("errors", elist);
+
+  wal.put("timeline", result->timeline);
+  wal.put("start", result->wal_start);
+  wal.put("end", result->wal_end);
+  wal.put("segments", result->wal_segments);
+  wal.add_child("missing", wlist);
+  head.add_child("wal", wal);
+
+  head.put("bytes", result->bytes);
+  head.put("duration ms", result->elapsed_msec);
+  head.put("throughput", (boost::format("%.1f MB/s") % result->throughput()).str());
+
+  pt::write_json(output, head);
+
+}
@@ -1175,9 +1175,10 @@ unsigned int DateTimeRetention::apply(std::vector<std::shared_ptr<BaseBackupDesc
       } else {
 
         if ( (lockType == LOCKED_BY_PIN)
-             || (lockType == LOCKED_BY_SHM) ) {
+             || (lockType == LOCKED_BY_SHM)
+             || (lockType == LOCKED_BY_INCREMENTAL) ) {
 
-          BOOST_LOG_TRIVIAL(info) << "basebackup is pinned or concurrently in use, ignoring";
+          BOOST_LOG_TRIVIAL(info) << "basebackup is pinned, concurrently in use or required by incremental basebackups, ignoring";
 
           cleanup_recptr = PGStream::XLOGPrevSegmentStartPosition(PGStream::decodeXLOGPos(bbdescr->xlogpos),
                                                                   bbdescr->wal_segment_size);
@@ -153,7 +153,9 @@ void IOUringCopyManager::_iouring_copyItem::work(BaseCopyManager::_copyOperation
   in->setOpenMode("rb");
   in->open();
 
+  /* holes of the source stay holes in the target */
   out->setOpenMode("wb+");
+  out->setSparse(true);
   out->open();
 
   ring.setup();
@@ -161,49 +163,70 @@ void IOUringCopyManager::_iouring_copyItem::work(BaseCopyManager::_copyOperation
   /* allocate input buffer according to current settings */
   ring.alloc_buffer(rbuf, ring.getBlockSize() * ring.getQueueDepth());
 
-  while(total_bytes_read < in->size()) {
+  /* data regions of the source only */
+  for (auto &region : SparseFile::dataRegions(in->getFileno(), in->size())) {
 
-    ssize_t recv_bytes = 0;
+    total_bytes_read = region.first;
 
-    /* start reading */
-    ring.read(in, rbuf, (off_t) total_bytes_read);
+    while(total_bytes_read < (size_t) region.second) {
 
-    /* wait till first read attempt is completed */
+      ssize_t recv_bytes = 0;
 
-    recv_bytes = ring.handle_current_io(rbuf);
-    rbuf->setEffectiveSize(recv_bytes, true);
+      /* start reading */
+      ring.read(in, rbuf, (off_t) total_bytes_read);
 
-    if (recv_bytes > 0) {
+      /* wait till first read attempt is completed */
 
-      ssize_t write_bytes = 0;
+      recv_bytes = ring.handle_current_io(rbuf);
 
-      /* issue write request to new file */
+      /* don't fill the hole following this region */
+      if (recv_bytes > (ssize_t) (region.second - total_bytes_read))
+        recv_bytes = region.second - total_bytes_read;
 
-      while (write_bytes < recv_bytes) {
+      rbuf->setEffectiveSize(recv_bytes, true);
 
-        ring.write(out, rbuf, total_bytes_read);
-        write_bytes += ring.handle_current_io(rbuf, true);
+      if (recv_bytes > 0) {
 
+        ssize_t write_bytes = 0;
+
+        /* issue write request to new file */
+
+        while (write_bytes < recv_bytes) {
+
+          ring.write(out, rbuf, total_bytes_read);
+          write_bytes += ring.handle_current_io(rbuf, true);
+
+        }
+
+        total_bytes_read += recv_bytes;
+
+      } else {
+        break;
       }
 
-      total_bytes_read += recv_bytes;
+      /* schedule next read */
+      rbuf->clear();
 
-    }
+      /*
+       * Check whether we are forced to exit.
+       *
+       * XXX: Checking just for the exit flag should be safe
+       *      without a critical section here.
+       */
+      if (ops_handler.exit)
+        break;
 
-    /* schedule next read */
-    rbuf->clear();
+    }
 
-    /*
-     * Check whether we are forced to exit.
-     *
-     * XXX: Checking just for the exit flag should be safe
-     *      without a critical section here.
-     */
     if (ops_handler.exit)
       break;
 
   }
 
+  /* a hole at the end of the source ends the target, too */
+  if (!ops_handler.exit)
+    out->lseek(in->size(), SEEK_SET);
+
   /*
    * Sync the out file ...
    *
@@ -742,45 +765,67 @@ void LegacyCopyManager::_legacy_copyItem::work(BaseCopyManager::_copyOperations
   in->setOpenMode("rb");
   in->open();
 
-  /* Open target, this will create the file automatically */
+  /*
+   * Open target, this will create the file automatically. Holes
+   * of the source and zero blocks stay holes in the target.
+   */
   out->setOpenMode("wb+");
+  out->setSparse(true);
   out->open();
 
-  /* We always try to read 8K sizes */
   total_bytes = in->size();
-  read_bytes = 0;
 
-  while (read_bytes < total_bytes) {
+  /* We always try to read 8K sizes, data regions only */
+  for (auto &region : SparseFile::dataRegions(in->getFileno(), total_bytes)) {
 
-    read_bytes = in->read(buf->ptr(), buf->getSize());
+    off_t offset = region.first;
 
-    if (read_bytes > 0) {
-      write_bytes = out->write(buf->ptr(), buf->getSize());
-    } else {
-      break;
-    }
+    in->lseek(offset, SEEK_SET);
+    out->lseek(offset, SEEK_SET);
 
-    /*
-     * If we don't get read_bytes back from write(), we treat this as
-     * a severe error
-     */
-    if (write_bytes < read_bytes) {
-      std::ostringstream oss;
-      oss << "short write: expected "
-          << read_bytes
-          << " got "
-          << write_bytes;
-      throw CArchiveIssue(oss.str());
-    }
+    while (offset < region.second) {
 
-    buf->clear();
+      size_t len = std::min((size_t) (region.second - offset), buf->getSize());
+
+      read_bytes = in->read(buf->ptr(), len);
+
+      if (read_bytes > 0) {
+        write_bytes = out->write(buf->ptr(), len);
+      } else {
+        break;
+      }
+
+      /*
+       * If we don't get read_bytes back from write(), we treat this as
+       * a severe error
+       */
+      if (write_bytes < read_bytes) {
+        std::ostringstream oss;
+        oss << "short write: expected "
+            << read_bytes
+            << " got "
+            << write_bytes;
+        throw CArchiveIssue(oss.str());
+      }
+
+      offset += len;
+      buf->clear();
+
+      /* Check if we're forced to exit */
+      if (ops_handler.exit)
+        break;
+
+    }
 
-    /* Check if we're forced to exit */
     if (ops_handler.exit)
       break;
 
   }
 
+  /* a hole at the end of the source ends the target, too */
+  if (!ops_handler.exit)
+    out->lseek(total_bytes, SEEK_SET);
+
   /* finish file, make sure everything hits storage */
   out->fsync();
   in->close();
@@ -11,6 +11,7 @@
 
 #include <fs-archive.hxx>
 #include <fs-pipe.hxx>
+#include <fs-chunks.hxx>
 
 using namespace pgbckctl;
 using namespace boost::adaptors;
@@ -95,6 +96,38 @@ void StreamingBaseBackupDirectory::remove() {
 
 }
 
+std::string StreamingBaseBackupDirectory::manifest() {
+
+  /*
+   * Former versions stored the manifest with the compression
+   * of the basebackup, which is gzip in the best case. Streams
+   * of PostgreSQL before 15 write it as backup_manifest.
+   */
+  std::vector<std::string> names = { "backup.manifest", "backup_manifest", "backup.manifest.gz" };
+
+  for (auto &name : names) {
+
+    path manifest_path = this->streaming_subdir / name;
+
+    if (boost::filesystem::exists(manifest_path)) {
+
+      std::ifstream file;
+      std::stringstream content;
+      bool compressed = false;
+
+      CPGBackupCtlBase::openFile(file, content, manifest_path, &compressed);
+      return content.str();
+
+    }
+
+  }
+
+  ostringstream oss;
+  oss << "no backup manifest found in basebackup directory " << this->streaming_subdir.string();
+  throw CArchiveIssue(oss.str());
+
+}
+
 std::shared_ptr<StreamingBaseBackupDirectory> StreamingBaseBackupDirectory::getInstance(string dirname,
                                                                         path archiveDir) {
 
@@ -155,15 +188,54 @@ ssize_t StreamingBaseBackupDirectory::size() {
   return result;
 }
 
+unsigned long long StreamingBaseBackupDirectory::punchHoles() {
+
+  unsigned long long result = 0;
+
+  for(recursive_directory_iterator it(this->streaming_subdir);
+      it != recursive_directory_iterator(); ++it) {
+
+    if (is_regular_file(*it) && file_size(*it) >= SPARSE_BLOCK_SIZE)
+      result += SparseFile::punchHoles(it->path());
+
+  }
+
+  return result;
+}
+
 std::shared_ptr<BackupFile> StreamingBaseBackupDirectory::basebackup(std::string name,
-                                                                     BackupProfileCompressType compression) {
+                                                                     BackupProfileCompressType compression,
+                                                                     bool deduplicate) {
+
+  if (deduplicate) {
+
+    path recipe = this->streaming_subdir / (name + CHUNK_RECIPE_SUFFIX);
+
+    if (compression != BACKUP_COMPRESS_TYPE_NONE
+        && compression != BACKUP_COMPRESS_TYPE_GZIP) {
+      std::ostringstream oss;
+      oss << "could not create deduplicated file: compression type unsupported: " << compression;
+      throw CArchiveIssue(oss.str());
+    }
+
+    return std::make_shared<ChunkedArchiveFile>(recipe,
+                                                std::make_shared<ChunkStore>(ChunkStore::forRecipe(recipe),
+                                                                             compression == BACKUP_COMPRESS_TYPE_GZIP));
+
+  }
 
   switch(compression) {
 
   case BACKUP_COMPRESS_TYPE_NONE:
+    {
+      /* zero pages of relation files don't take up space */
+      std::shared_ptr<ArchiveFile> myfile
+        = std::make_shared<ArchiveFile>(this->streaming_subdir / name);
 
-    return std::make_shared<ArchiveFile>(this->streaming_subdir / name);
-    break;
+      myfile->setSparse(true);
+      return myfile;
+      break;
+    }
 
   case BACKUP_COMPRESS_TYPE_GZIP:
 
@@ -609,7 +681,8 @@ string ArchiveLogDirectory::getXlogStartPosition(unsigned int &timelineID,
 }
 
 void ArchiveLogDirectory::removeXLogs(shared_ptr<BackupCleanupDescr> cleanupDescr,
-                                      unsigned long long wal_segment_size) {
+                                      unsigned long long wal_segment_size,
+                                      bool dry_run) {
 
   /* TLI=0 doesn't exist, so take this as a starting value */
   unsigned int lowest_tli = 0;
@@ -698,6 +771,7 @@ void ArchiveLogDirectory::removeXLogs(shared_ptr<BackupCleanupDescr> cleanupDesc
         long unsigned int xlog_segno = 0;
         XLogRecPtr recptr = InvalidXLogRecPtr;
         tli_cleanup_offsets::iterator it;
+        bool remove_segment = false;
 
 #if PG_VERSION_NUM < 110000
         XLogFromFileName(direntname.c_str(), &xlog_tli, &xlog_segno);
@@ -734,24 +808,44 @@ void ArchiveLogDirectory::removeXLogs(shared_ptr<BackupCleanupDescr> cleanupDesc
           BOOST_LOG_TRIVIAL(warning) << "TLI=" << xlog_tli
                                      << " older and not reachable anymore (treshold TLI="
                                      << "lowest_tli";
-          BOOST_LOG_TRIVIAL(info) << "TLI not reachable, deleting file "
-                                  << direntname;
+          if (!dry_run)
+            BOOST_LOG_TRIVIAL(info) << "TLI not reachable, deleting file "
+                                    << direntname;
 
           /*
            * TLI not seen in basebackup list and current segment
            * has older TLI.
            */
-          remove(entry.path());
+          remove_segment = true;
 
-        } else if ( (it->first == xlog_tli)
+        } else if ( (it != cleanupDescr->off_list.end())
                     && (recptr <= (it->second)->wal_cleanup_start_pos) ) {
 
-          BOOST_LOG_TRIVIAL(info) << "XLogRecPtr is older than requested position("
-                                   << PGStream::encodeXLOGPos(recptr)
-                                   << "), deleting file "
-                                   << direntname;
+          if (!dry_run)
+            BOOST_LOG_TRIVIAL(info) << "XLogRecPtr is older than requested position("
+                                    << PGStream::encodeXLOGPos(recptr)
+                                    << "), deleting file "
+                                    << direntname;
+
+          remove_segment = true;
 
-          remove(entry.path());
+        }
+
+        if (remove_segment) {
+
+          cleanupDescr->removed_wal_files++;
+          cleanupDescr->removed_wal_bytes += file_size(entry.path());
+
+          if (!dry_run)
+            remove(entry.path());
+
+          if (fstat == WAL_SEGMENT_COMPLETE
+              || fstat == WAL_SEGMENT_COMPLETE_COMPRESSED) {
+            cleanupDescr->removed_wal_segments++;
+            cleanupDescr->removed_wal_segment_names.push_back(fstat == WAL_SEGMENT_COMPLETE
+                                                              ? direntname
+                                                              : entry.path().stem().string());
+          }
 
         }
 
@@ -1769,6 +1863,10 @@ off_t BackupFile::current_position() {
   return this->currpos;
 }
 
+off_t BackupFile::frameBoundary() {
+  return -1;
+}
+
 /******************************************************************************
  * ArchivePipedProcess Implementation
  ******************************************************************************/
@@ -2137,6 +2235,12 @@ ArchiveFile::ArchiveFile(path pathHandle) : BackupFile(pathHandle) {
 ArchiveFile::~ArchiveFile() {
 
   if (this->fp != NULL) {
+
+    /* bytes kept back and a hole at the end, but never throw here */
+    try {
+      this->flushSparse();
+    } catch (CArchiveIssue &e) {}
+
     fclose(this->fp);
     this->fp = NULL;
     this->opened = false;
@@ -2159,6 +2263,9 @@ off_t ArchiveFile::lseek(off_t offset, int whence) {
     throw CArchiveIssue(oss.str());
   }
 
+  /* bytes kept back belong before the new position */
+  this->flushSparse();
+
   rc = ::fseek(this->fp, offset, whence);
 
   if (rc < 0) {
@@ -2171,10 +2278,115 @@ off_t ArchiveFile::lseek(off_t offset, int whence) {
   }
 
   this->currpos = ftell(this->fp);
+
+  /* seeking beyond the end leaves a hole, too */
+  if (this->sparse && this->currpos > this->sparse_end)
+    this->sparse_end = this->currpos;
+
   return rc;
 
 }
 
+void ArchiveFile::setSparse(bool sparse) {
+  this->sparse = sparse;
+}
+
+bool ArchiveFile::isSparse() {
+  return this->sparse;
+}
+
+void ArchiveFile::writeSparse(const char *buf, size_t len, bool aligned) {
+
+  size_t done = 0;
+
+  while (done < len) {
+
+    size_t run = 0;
+    bool hole;
+
+    if (!aligned) {
+      run = len;
+      hole = false;
+    } else {
+
+      /* a run of zero blocks or of blocks with data */
+      hole = SparseFile::zero(buf + done, SPARSE_BLOCK_SIZE);
+
+      do {
+        run += SPARSE_BLOCK_SIZE;
+      } while (done + run < len
+               && SparseFile::zero(buf + done + run, SPARSE_BLOCK_SIZE) == hole);
+
+    }
+
+    if (hole) {
+
+      if (fseeko(this->fp, run, SEEK_CUR) != 0) {
+        std::ostringstream oss;
+        oss << "could not seek in file "
+            << this->handle.string()
+            << ": "
+            << strerror(errno);
+        throw CArchiveIssue(oss.str());
+      }
+
+    } else if (fwrite(buf + done, run, 1, this->fp) != 1) {
+
+      std::ostringstream oss;
+      oss << "write error for file (size="
+          << run
+          << ")"
+          << this->handle.string()
+          << ": "
+          << strerror(errno);
+      throw CArchiveIssue(oss.str());
+
+    }
+
+    done += run;
+
+  }
+
+}
+
+void ArchiveFile::flushSparse() {
+
+  struct stat st;
+
+  if (!this->sparse || this->fp == NULL)
+    return;
+
+  /* bytes kept back of an incomplete block */
+  if (this->sparse_tail.length() > 0) {
+    this->writeSparse(this->sparse_tail.data(), this->sparse_tail.length(), false);
+    this->sparse_tail.clear();
+  }
+
+  /*
+   * A hole at the end of the file exists after
+   * it was extended only.
+   */
+  if (fflush(this->fp) != 0 || fstat(fileno(this->fp), &st) != 0) {
+    std::ostringstream oss;
+    oss << "could not extend sparse file \""
+        << this->handle.string()
+        << "\": "
+        << strerror(errno);
+    throw CArchiveIssue(oss.str());
+  }
+
+  if (st.st_size < this->sparse_end
+      && ftruncate(fileno(this->fp), this->sparse_end) != 0) {
+    std::ostringstream oss;
+    oss << "could not extend sparse file \""
+        << this->handle.string()
+        << "\": "
+        << strerror(errno);
+    throw CArchiveIssue(oss.str());
+  }
+
+}
+
 bool ArchiveFile::isCompressed() {
   return false;
 }
@@ -2341,6 +2553,8 @@ size_t ArchiveFile::read(char *buf, size_t len) {
     throw CArchiveIssue(oss.str());
   }
 
+  this->flushSparse();
+
   if ((result = fread(buf, len, 1, this->fp)) != 1) {
 
     /* end of file reached? */
@@ -2379,6 +2593,58 @@ size_t ArchiveFile::write(const char *buf, size_t len) {
     throw CArchiveIssue(oss.str());
   }
 
+  if (this->sparse && len > 0) {
+
+    size_t done = 0;
+
+    /*
+     * Writes are rarely aligned, so the start of a block is kept
+     * back until the block is complete and can be checked. The
+     * file position is always at the start of the bytes kept back.
+     */
+    while (done < len) {
+
+      off_t start = this->currpos + done - this->sparse_tail.length();
+      size_t room = SPARSE_BLOCK_SIZE - start % SPARSE_BLOCK_SIZE - this->sparse_tail.length();
+
+      if (this->sparse_tail.length() == 0
+          && start % SPARSE_BLOCK_SIZE == 0
+          && len - done >= SPARSE_BLOCK_SIZE) {
+
+        size_t blocks = (len - done) - (len - done) % SPARSE_BLOCK_SIZE;
+
+        this->writeSparse(buf + done, blocks, true);
+        done += blocks;
+
+      } else if (len - done >= room) {
+
+        this->sparse_tail.append(buf + done, room);
+        done += room;
+
+        /* a complete block, if it started aligned */
+        this->writeSparse(this->sparse_tail.data(),
+                          this->sparse_tail.length(),
+                          start % SPARSE_BLOCK_SIZE == 0);
+        this->sparse_tail.clear();
+
+      } else {
+
+        this->sparse_tail.append(buf + done, len - done);
+        done = len;
+
+      }
+
+    }
+
+    this->currpos += len;
+
+    if (this->currpos > this->sparse_end)
+      this->sparse_end = this->currpos;
+
+    return 1;
+
+  }
+
   if ((result = fwrite(buf, len, 1, this->fp)) != 1) {
 
     std::ostringstream oss;
@@ -2415,6 +2681,8 @@ void ArchiveFile::fsync() {
     throw CArchiveIssue(oss.str());
   }
 
+  this->flushSparse();
+
   if (::fsync(fileno(this->fp)) != 0) {
     std::ostringstream oss;
     oss << "error fsyncing file \""
@@ -2435,9 +2703,13 @@ void ArchiveFile::close() {
     throw CArchiveIssue(oss.str());
   }
 
+  this->flushSparse();
+
   fclose(this->fp);
   this->fp = NULL;
   this->currpos = 0;
+  this->sparse_end = 0;
+  this->sparse_tail.clear();
 
 }
 
@@ -2693,6 +2965,46 @@ size_t CompressedArchiveFile::write(const char *buf, size_t len) {
   return wbytes;
 }
 
+off_t CompressedArchiveFile::frameBoundary() {
+
+  int rc;
+
+  if (!this->isOpen()) {
+    std::ostringstream oss;
+    oss << "attempt to flush unitialized file "
+        << this->handle.string();
+    throw CArchiveIssue(oss.str());
+  }
+
+  /*
+   * Z_FINISH ends the deflate stream and writes the gzip
+   * trailer, zlib then starts a new gzip member with the next
+   * gzwrite(). Concatenated members are still a valid gzip file,
+   * but each of them can be decompressed on its own.
+   */
+  if ((rc = gzflush(this->zh, Z_FINISH)) != Z_OK) {
+
+    std::ostringstream oss;
+    const char *gzerrstr;
+    int gzerrno;
+
+    oss << "could not flush file "" << this->handle.string() << "": ";
+
+    gzerrstr = gzerror(this->zh, &gzerrno);
+
+    if (gzerrno == Z_ERRNO)
+      oss << strerror(errno);
+    else if (gzerrstr != NULL)
+      oss << gzerrstr;
+
+    throw CArchiveIssue(oss.str());
+
+  }
+
+  return (off_t) gzoffset(this->zh);
+
+}
+
 size_t CompressedArchiveFile::read(char *buf, size_t len) {
 
   if (!this->isOpen()) {
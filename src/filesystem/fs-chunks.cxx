@@ -0,0 +1,725 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <boost/log/trivial.hpp>
+
+#include <fs-chunks.hxx>
+
+using namespace pgbckctl;
+
+/* ****************************************************************************
+ * Implementation ContentDefinedChunker
+ * ****************************************************************************/
+
+/*
+ * Masks matched against the high bits of the gear hash, which
+ * depend on the last 64 bytes. The stricter mask applies below
+ * CHUNK_AVG_SIZE (2 bits more than its log2), the looser one
+ * above (2 bits less).
+ */
+#define CHUNK_MASK_STRICT (~0ULL << (64 - 18))
+#define CHUNK_MASK_LOOSE (~0ULL << (64 - 14))
+
+/*
+ * Random values the gear hash is built of. They must never change,
+ * otherwise chunks of new basebackups won't match the stored ones.
+ */
+static const uint64_t *chunk_gear_table() {
+
+  static uint64_t table[256];
+  static bool initialized = false;
+
+  if (!initialized) {
+
+    /* splitmix64 with a fixed seed */
+    uint64_t state = 0x5047424b43544c00ULL;
+
+    for (int i = 0; i < 256; i++) {
+
+      uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      table[i] = z ^ (z >> 31);
+
+    }
+
+    initialized = true;
+
+  }
+
+  return table;
+
+}
+
+ContentDefinedChunker::ContentDefinedChunker() {
+
+  /* make sure the table is set up before several threads use it */
+  chunk_gear_table();
+
+}
+
+ContentDefinedChunker::~ContentDefinedChunker() {}
+
+void ContentDefinedChunker::reset() {
+
+  this->fingerprint = 0;
+  this->length = 0;
+
+}
+
+size_t ContentDefinedChunker::scan(const char *buf, size_t len, bool &cut) {
+
+  const uint64_t *gear = chunk_gear_table();
+  const unsigned char *data = (const unsigned char *) buf;
+  size_t i = 0;
+
+  cut = false;
+
+  /* No chunk ends before the minimum size, skip the hashing */
+  if (this->length + 64 < CHUNK_MIN_SIZE) {
+
+    i = CHUNK_MIN_SIZE - 64 - this->length;
+
+    if (i > len)
+      i = len;
+
+    this->length += i;
+
+  }
+
+  for (; i < len; i++) {
+
+    this->fingerprint = (this->fingerprint << 1) + gear[data[i]];
+    this->length++;
+
+    if (this->length < CHUNK_MIN_SIZE)
+      continue;
+
+    if (this->length >= CHUNK_MAX_SIZE
+        || (this->fingerprint & ((this->length < CHUNK_AVG_SIZE)
+                                 ? CHUNK_MASK_STRICT : CHUNK_MASK_LOOSE)) == 0) {
+
+      cut = true;
+      this->reset();
+      return i + 1;
+
+    }
+
+  }
+
+  return len;
+
+}
+
+/* ****************************************************************************
+ * Implementation ChunkStore
+ * ****************************************************************************/
+
+ChunkStore::ChunkStore(path directory, bool compress) {
+
+  this->directory = directory;
+  this->compress = compress;
+
+#ifndef PG_BACKUP_CTL_HAS_ZLIB
+  if (compress)
+    throw CArchiveIssue("zlib compression support not compiled in");
+#endif
+
+}
+
+ChunkStore::~ChunkStore() {}
+
+path ChunkStore::forArchive(path archive_directory) {
+
+  return archive_directory / "chunks";
+
+}
+
+path ChunkStore::forRecipe(path recipe) {
+
+  /* <archive>/base/<basebackup>/<recipe> */
+  return ChunkStore::forArchive(recipe.parent_path().parent_path().parent_path());
+
+}
+
+path ChunkStore::getPath() {
+
+  return this->directory;
+
+}
+
+path ChunkStore::chunkFile(std::string const &hash, bool compressed) {
+
+  /* spread the chunks over 256 subdirectories */
+  return this->directory / hash.substr(0, 2) / (compressed ? hash + ".gz" : hash);
+
+}
+
+bool ChunkStore::exists(std::string const &hash) {
+
+  return (this->pending_hashes.find(hash) != this->pending_hashes.end())
+    || boost::filesystem::exists(this->chunkFile(hash, false))
+    || boost::filesystem::exists(this->chunkFile(hash, true));
+
+}
+
+size_t ChunkStore::put(std::string const &hash, const char *data, size_t len) {
+
+  path file = this->chunkFile(hash, this->compress);
+  path temp = path(file.string() + "." + boost::filesystem::unique_path().string() + ".tmp");
+  size_t written = 0;
+  int fd;
+
+  if (this->exists(hash))
+    return 0;
+
+  if (this->subdirs.find(file.parent_path().string()) == this->subdirs.end()) {
+    boost::filesystem::create_directories(file.parent_path());
+    this->subdirs.insert(file.parent_path().string());
+  }
+
+  fd = ::open(temp.string().c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+
+  if (fd < 0) {
+    std::ostringstream oss;
+    oss << "could not create chunk file \"" << temp.string() << "\": " << strerror(errno);
+    throw CArchiveIssue(oss.str());
+  }
+
+#ifdef PG_BACKUP_CTL_HAS_ZLIB
+  if (this->compress) {
+
+    gzFile zh = gzdopen(fd, "wb6");
+
+    if (zh == NULL || gzwrite(zh, data, (unsigned int) len) != (int) len
+        || gzclose(zh) != Z_OK) {
+
+      std::ostringstream oss;
+      oss << "could not write chunk file \"" << temp.string() << "\"";
+
+      if (zh == NULL)
+        ::close(fd);
+
+      ::unlink(temp.string().c_str());
+      throw CArchiveIssue(oss.str());
+
+    }
+
+    written = boost::filesystem::file_size(temp);
+
+  }
+#endif
+
+  if (!this->compress) {
+
+    while (written < len) {
+
+      ssize_t rc = ::write(fd, data + written, len - written);
+
+      if (rc < 0 && errno == EINTR)
+        continue;
+
+      if (rc <= 0) {
+        std::ostringstream oss;
+        oss << "could not write chunk file \"" << temp.string() << "\": " << strerror(errno);
+        ::close(fd);
+        ::unlink(temp.string().c_str());
+        throw CArchiveIssue(oss.str());
+      }
+
+      written += rc;
+
+    }
+
+    ::close(fd);
+
+  }
+
+  this->pending.push_back(std::make_pair(temp, file));
+  this->pending_hashes.insert(hash);
+
+  if (this->pending.size() >= CHUNK_STORE_SYNC_BATCH)
+    this->sync();
+
+  return written;
+
+}
+
+void ChunkStore::get(std::string const &hash, std::string &data) {
+
+  path file = this->chunkFile(hash, false);
+  std::shared_ptr<BackupChecksum> checksum = nullptr;
+
+  data.clear();
+
+  if (boost::filesystem::exists(file)) {
+
+    std::ifstream in(file.string(), std::ios::binary);
+
+    if (!in.is_open())
+      throw CArchiveIssue("could not open chunk file \"" + file.string() + "\"");
+
+    data.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  } else {
+
+#ifdef PG_BACKUP_CTL_HAS_ZLIB
+    gzFile zh;
+    char buf[64 * 1024];
+    int rc;
+
+    file = this->chunkFile(hash, true);
+
+    if ((zh = gzopen(file.string().c_str(), "rb")) == NULL)
+      throw CArchiveIssue("chunk " + hash + " is missing in chunk store \""
+                          + this->directory.string() + "\"");
+
+    while ((rc = gzread(zh, buf, sizeof(buf))) > 0)
+      data.append(buf, rc);
+
+    gzclose(zh);
+
+    if (rc < 0)
+      throw CArchiveIssue("could not read chunk file \"" + file.string() + "\"");
+#else
+    throw CArchiveIssue("chunk " + hash + " is missing in chunk store \""
+                        + this->directory.string() + "\"");
+#endif
+
+  }
+
+  /*
+   * A chunk is shared by many basebackups, so make sure a
+   * corrupted one is reported as such.
+   */
+  if (BackupChecksum::supported(CHUNK_HASH_ALGORITHM)) {
+
+    checksum = BackupChecksum::get(CHUNK_HASH_ALGORITHM);
+    checksum->update(data.c_str(), data.length());
+
+    if (checksum->final() != hash)
+      throw CArchiveIssue("chunk file \"" + file.string() + "\" is corrupted");
+
+  }
+
+}
+
+void ChunkStore::remove(std::string const &hash) {
+
+  boost::system::error_code ec;
+
+  boost::filesystem::remove(this->chunkFile(hash, false), ec);
+  boost::filesystem::remove(this->chunkFile(hash, true), ec);
+
+}
+
+void ChunkStore::sync() {
+
+  std::set<std::string> dirs;
+
+  /*
+   * A chunk gets its final name only after its contents are
+   * durable, a crash must never leave a chunk file other
+   * basebackups could refer to with garbage in it.
+   */
+  for (auto &item : this->pending) {
+
+    RootDirectory::fsync(item.first);
+
+    if (::rename(item.first.string().c_str(), item.second.string().c_str()) < 0) {
+      std::ostringstream oss;
+      oss << "could not rename chunk file \"" << item.first.string() << "\": " << strerror(errno);
+      throw CArchiveIssue(oss.str());
+    }
+
+    dirs.insert(item.second.parent_path().string());
+
+  }
+
+  for (auto &dir : dirs)
+    RootDirectory::fsync(path(dir));
+
+  this->pending.clear();
+  this->pending_hashes.clear();
+
+}
+
+/* ****************************************************************************
+ * Implementation ChunkRecipe
+ * ****************************************************************************/
+
+#define CHUNK_RECIPE_MAGIC "pg_backup_ctl++ chunk recipe 1"
+
+bool ChunkRecipe::isRecipe(path file) {
+
+  std::string name = file.filename().string();
+  std::string suffix = CHUNK_RECIPE_SUFFIX;
+
+  return (name.length() > suffix.length())
+    && (name.compare(name.length() - suffix.length(), suffix.length(), suffix) == 0);
+
+}
+
+std::vector<chunk_ref> ChunkRecipe::read(path recipe) {
+
+  std::ifstream in(recipe.string());
+  std::vector<chunk_ref> result;
+  std::string line;
+
+  if (!in.is_open())
+    throw CArchiveIssue("could not open chunk recipe \"" + recipe.string() + "\"");
+
+  if (!std::getline(in, line) || line != CHUNK_RECIPE_MAGIC)
+    throw CArchiveIssue("file \"" + recipe.string() + "\" is not a chunk recipe");
+
+  /* one "<hash> <size>" line per chunk */
+  while (std::getline(in, line)) {
+
+    std::string::size_type space = line.find(' ');
+    chunk_ref chunk;
+
+    if (space == std::string::npos)
+      throw CArchiveIssue("invalid chunk recipe \"" + recipe.string() + "\"");
+
+    chunk.hash = line.substr(0, space);
+    chunk.size = strtoull(line.c_str() + space + 1, NULL, 10);
+
+    result.push_back(chunk);
+
+  }
+
+  return result;
+
+}
+
+void ChunkRecipe::write(path recipe, std::vector<chunk_ref> &chunks) {
+
+  path temp = path(recipe.string() + ".tmp");
+  std::ofstream out(temp.string(), std::ios::trunc);
+
+  if (!out.is_open())
+    throw CArchiveIssue("could not create chunk recipe \"" + temp.string() + "\"");
+
+  out << CHUNK_RECIPE_MAGIC << "\n";
+
+  for (auto &chunk : chunks)
+    out << chunk.hash << " " << chunk.size << "\n";
+
+  out.close();
+
+  if (out.fail())
+    throw CArchiveIssue("could not write chunk recipe \"" + temp.string() + "\"");
+
+  RootDirectory::fsync(temp);
+
+  if (::rename(temp.string().c_str(), recipe.string().c_str()) < 0) {
+    std::ostringstream oss;
+    oss << "could not rename chunk recipe \"" << temp.string() << "\": " << strerror(errno);
+    throw CArchiveIssue(oss.str());
+  }
+
+}
+
+std::map<std::string, unsigned long long> ChunkRecipe::chunks(path basebackup) {
+
+  std::map<std::string, unsigned long long> result;
+
+  if (!boost::filesystem::is_directory(basebackup))
+    return result;
+
+  for (directory_iterator it(basebackup); it != directory_iterator(); ++it) {
+
+    if (!ChunkRecipe::isRecipe(it->path()))
+      continue;
+
+    for (auto &chunk : ChunkRecipe::read(it->path()))
+      result[chunk.hash] = chunk.size;
+
+  }
+
+  return result;
+
+}
+
+/* ****************************************************************************
+ * Implementation ChunkedArchiveFile
+ * ****************************************************************************/
+
+ChunkedArchiveFile::ChunkedArchiveFile(path recipe, std::shared_ptr<ChunkStore> store)
+  : BackupFile(recipe) {
+
+  if (store == nullptr)
+    throw CArchiveIssue("chunked archive file requires a chunk store");
+
+  this->store = store;
+  this->hash = BackupChecksum::get(CHUNK_HASH_ALGORITHM);
+  this->chunk.reserve(CHUNK_MAX_SIZE);
+
+}
+
+ChunkedArchiveFile::~ChunkedArchiveFile() {}
+
+void ChunkedArchiveFile::cut() {
+
+  chunk_ref ref;
+
+  if (this->chunk.length() == 0)
+    return;
+
+  this->hash->reset();
+  this->hash->update(this->chunk.c_str(), this->chunk.length());
+
+  ref.hash = this->hash->final();
+  ref.size = this->chunk.length();
+
+  size_t written = this->store->put(ref.hash, this->chunk.c_str(), this->chunk.length());
+
+  if (written > 0) {
+    this->stored += written;
+    this->chunks_new++;
+  }
+
+  this->recipe.push_back(ref);
+  this->chunk.clear();
+  this->chunker.reset();
+
+}
+
+bool ChunkedArchiveFile::isCompressed() {
+  return true;
+}
+
+void ChunkedArchiveFile::setCompressed(bool compressed) {
+  /* no-op, chunks are compressed by the chunk store */
+}
+
+void ChunkedArchiveFile::open() {
+
+  if (this->mode != "wb" && this->mode != "w")
+    throw CArchiveIssue("chunked archive file \"" + this->handle.string() + "\" is write only");
+
+  if (!boost::filesystem::exists(this->store->getPath()))
+    boost::filesystem::create_directories(this->store->getPath());
+
+  this->opened = true;
+
+}
+
+void ChunkedArchiveFile::close() {
+
+  if (!this->opened) {
+    std::ostringstream oss;
+    oss << "attempt to close uninitialized file \""
+        << this->handle.string() << "\"";
+    throw CArchiveIssue(oss.str());
+  }
+
+  this->cut();
+  this->store->sync();
+  ChunkRecipe::write(this->handle, this->recipe);
+
+  BOOST_LOG_TRIVIAL(debug) << "DEBUG: " << this->handle.filename().string() << ": "
+                           << this->recipe.size() << " chunks, "
+                           << this->chunks_new << " new, "
+                           << this->stored << " bytes stored of "
+                           << this->currpos;
+
+  this->opened = false;
+
+}
+
+void ChunkedArchiveFile::fsync() {
+
+  if (!this->opened) {
+    std::ostringstream oss;
+    oss << "attempt to fsync uninitialized file \""
+        << this->handle.string() << "\"";
+    throw CArchiveIssue(oss.str());
+  }
+
+  this->store->sync();
+
+}
+
+bool ChunkedArchiveFile::isOpen() {
+  return this->opened;
+}
+
+void ChunkedArchiveFile::rename(path& newname) {
+  throw CArchiveIssue("renaming chunked archive files is not supported");
+}
+
+void ChunkedArchiveFile::setOpenMode(std::string mode) {
+  this->mode = mode;
+}
+
+std::string ChunkedArchiveFile::getOpenMode() {
+  return this->mode;
+}
+
+size_t ChunkedArchiveFile::write(const char *buf, size_t len) {
+
+  size_t consumed = 0;
+
+  if (!this->opened) {
+    std::ostringstream oss;
+    oss << "attempt to write into unitialized file "
+        << this->handle.string();
+    throw CArchiveIssue(oss.str());
+  }
+
+  while (consumed < len) {
+
+    size_t n;
+    size_t pos = 0;
+
+    /* Each member starts a chunk of its own */
+    if (this->indexer.atBoundary())
+      this->cut();
+
+    n = this->indexer.feed(buf + consumed, len - consumed);
+
+    while (pos < n) {
+
+      bool end;
+      size_t k = this->chunker.scan(buf + consumed + pos, n - pos, end);
+
+      this->chunk.append(buf + consumed + pos, k);
+      pos += k;
+
+      if (end)
+        this->cut();
+
+    }
+
+    consumed += n;
+
+  }
+
+  this->currpos += len;
+  return len;
+
+}
+
+size_t ChunkedArchiveFile::read(char *buf, size_t len) {
+  throw CArchiveIssue("reading from chunked archive files is not supported, use TarChunkedSource");
+}
+
+void ChunkedArchiveFile::remove() {
+
+  boost::system::error_code ec;
+
+  /* chunks are shared, they're released by retention only */
+  boost::filesystem::remove(this->handle, ec);
+
+}
+
+size_t ChunkedArchiveFile::size() {
+  return this->stored;
+}
+
+off_t ChunkedArchiveFile::lseek(off_t offset, int whence) {
+  throw CArchiveIssue("seeking in chunked archive files is not supported");
+}
+
+off_t ChunkedArchiveFile::frameBoundary() {
+
+  this->cut();
+  return this->currpos;
+
+}
+
+/* ****************************************************************************
+ * Implementation TarChunkedSource
+ * ****************************************************************************/
+
+TarChunkedSource::TarChunkedSource(path file, unsigned long long offset) : TarStreamSource(file) {
+
+  this->store = std::make_shared<ChunkStore>(ChunkStore::forRecipe(file));
+  this->chunks = ChunkRecipe::read(file);
+
+  if (offset > 0)
+    this->skip(offset);
+
+}
+
+TarChunkedSource::~TarChunkedSource() {}
+
+size_t TarChunkedSource::read(char *buf, size_t len) {
+
+  size_t result = 0;
+
+  while (result < len) {
+
+    size_t n;
+
+    if (this->pos == this->data.length()) {
+
+      if (this->next >= this->chunks.size())
+        break;
+
+      this->store->get(this->chunks[this->next].hash, this->data);
+
+      if (this->data.length() != this->chunks[this->next].size) {
+        std::ostringstream oss;
+        oss << "chunk " << this->chunks[this->next].hash << " of \"" << this->file.string()
+            << "\" has size " << this->data.length() << ", expected "
+            << this->chunks[this->next].size;
+        throw CArchiveIssue(oss.str());
+      }
+
+      this->next++;
+      this->pos = 0;
+
+    }
+
+    n = this->data.length() - this->pos;
+
+    if (n > len - result)
+      n = len - result;
+
+    memcpy(buf + result, this->data.c_str() + this->pos, n);
+    this->pos += n;
+    result += n;
+
+  }
+
+  return result;
+
+}
+
+void TarChunkedSource::skip(unsigned long long len) {
+
+  unsigned long long n = this->data.length() - this->pos;
+
+  /* rest of the current chunk */
+  if (n > len)
+    n = len;
+
+  this->pos += n;
+  len -= n;
+
+  /* whole chunks are skipped without reading them */
+  while (len > 0 && this->next < this->chunks.size()
+         && this->chunks[this->next].size <= len) {
+    len -= this->chunks[this->next].size;
+    this->next++;
+  }
+
+  if (len > 0)
+    TarStreamSource::skip(len);
+
+}
+
+void TarChunkedSource::close() {
+
+  this->chunks.clear();
+  this->data.clear();
+  this->next = 0;
+  this->pos = 0;
+
+}
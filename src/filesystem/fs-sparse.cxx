@@ -0,0 +1,341 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include <fs-archive.hxx>
+#include <fs-sparse.hxx>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define HAVE_SPARSE_ZERO_SIMD 1
+#endif
+
+using namespace pgbckctl;
+
+/*
+ * Size of the reads when looking for zero blocks in
+ * existing files.
+ */
+#define SPARSE_SCAN_SIZE (256 * SPARSE_BLOCK_SIZE)
+
+static bool sparse_zero_scalar(const char *buf, size_t len) {
+
+  uint64_t acc = 0;
+  size_t i = 0;
+
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+
+    uint64_t word;
+
+    memcpy(&word, buf + i, sizeof(word));
+    acc |= word;
+
+    /* check now and then, non-zero data is mostly found early */
+    if ((i & 255) == 0 && acc != 0)
+      return false;
+
+  }
+
+  for (; i < len; i++)
+    acc |= (unsigned char) buf[i];
+
+  return acc == 0;
+
+}
+
+#ifdef HAVE_SPARSE_ZERO_SIMD
+
+/*
+ * SSE2 is always available on x86_64.
+ */
+static bool sparse_zero_sse2(const char *buf, size_t len) {
+
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+
+    __m128i acc = _mm_or_si128(_mm_or_si128(_mm_loadu_si128((const __m128i *) (buf + i)),
+                                            _mm_loadu_si128((const __m128i *) (buf + i + 16))),
+                               _mm_or_si128(_mm_loadu_si128((const __m128i *) (buf + i + 32)),
+                                            _mm_loadu_si128((const __m128i *) (buf + i + 48))));
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) != 0xffff)
+      return false;
+
+  }
+
+  return sparse_zero_scalar(buf + i, len - i);
+
+}
+
+__attribute__((target("avx2")))
+static bool sparse_zero_avx2(const char *buf, size_t len) {
+
+  size_t i = 0;
+
+  for (; i + 128 <= len; i += 128) {
+
+    __m256i acc = _mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256((const __m256i *) (buf + i)),
+                                                  _mm256_loadu_si256((const __m256i *) (buf + i + 32))),
+                                  _mm256_or_si256(_mm256_loadu_si256((const __m256i *) (buf + i + 64)),
+                                                  _mm256_loadu_si256((const __m256i *) (buf + i + 96))));
+
+    if (!_mm256_testz_si256(acc, acc))
+      return false;
+
+  }
+
+  return sparse_zero_sse2(buf + i, len - i);
+
+}
+
+#endif
+
+typedef bool (*sparse_zero_fn)(const char *, size_t);
+
+/*
+ * Selects the zero scan implementation for this CPU once.
+ */
+static sparse_zero_fn sparse_zero_choose() {
+
+#ifdef HAVE_SPARSE_ZERO_SIMD
+  if (__builtin_cpu_supports("avx2"))
+    return sparse_zero_avx2;
+
+  return sparse_zero_sse2;
+#else
+  return sparse_zero_scalar;
+#endif
+
+}
+
+static sparse_zero_fn sparse_zero_impl = sparse_zero_choose();
+
+/*
+ * Deallocates len bytes at offset, false if the filesystem
+ * doesn't support that.
+ */
+static bool sparse_punch(int fd, off_t offset, off_t len, std::string const &file) {
+
+#ifdef FALLOC_FL_PUNCH_HOLE
+  if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, len) == 0)
+    return true;
+
+  if (errno == EOPNOTSUPP || errno == ENOSYS)
+    return false;
+
+  std::ostringstream oss;
+  oss << "could not punch hole into file \""
+      << file
+      << "\": "
+      << strerror(errno);
+  throw CArchiveIssue(oss.str());
+#else
+  return false;
+#endif
+
+}
+
+/*
+ * Start of the next data region at or after offset, size if
+ * there's only a hole up to size. Everything is data if the
+ * filesystem can't tell.
+ */
+static off_t sparse_next_data(int fd, off_t offset, off_t size) {
+
+  if (offset >= size)
+    return size;
+
+#ifdef SEEK_DATA
+  off_t result = ::lseek(fd, offset, SEEK_DATA);
+
+  if (result < 0) {
+
+    /* nothing but a hole up to the end of the file */
+    if (errno == ENXIO)
+      return size;
+
+    /* unsupported, treat everything as data */
+    return offset;
+
+  }
+
+  return std::min(result, size);
+#else
+  return offset;
+#endif
+
+}
+
+/*
+ * Start of the next hole at or after offset, never more than size.
+ */
+static off_t sparse_next_hole(int fd, off_t offset, off_t size) {
+
+  if (offset >= size)
+    return size;
+
+#ifdef SEEK_HOLE
+  off_t result = ::lseek(fd, offset, SEEK_HOLE);
+
+  if (result < 0)
+    return size;
+
+  return std::min(result, size);
+#else
+  return size;
+#endif
+
+}
+
+/* ****************************************************************************
+ * Implementation SparseFile
+ * ****************************************************************************/
+
+bool SparseFile::zero(const char *buf, size_t len) {
+  return sparse_zero_impl(buf, len);
+}
+
+bool SparseFile::vectorized() {
+
+#ifdef HAVE_SPARSE_ZERO_SIMD
+  return sparse_zero_impl == sparse_zero_avx2;
+#else
+  return false;
+#endif
+
+}
+
+std::vector<std::pair<off_t, off_t>> SparseFile::dataRegions(int fd, off_t size) {
+
+  std::vector<std::pair<off_t, off_t>> result;
+  off_t position = ::lseek(fd, 0, SEEK_CUR);
+  off_t offset = sparse_next_data(fd, 0, size);
+
+  while (offset < size) {
+
+    off_t data_end = sparse_next_hole(fd, offset, size);
+
+    /* make sure to get ahead, even if the filesystem acts up */
+    if (data_end <= offset)
+      data_end = size;
+
+    result.push_back(std::make_pair(offset, data_end));
+    offset = sparse_next_data(fd, data_end, size);
+
+  }
+
+  if (position >= 0)
+    ::lseek(fd, position, SEEK_SET);
+
+  return result;
+
+}
+
+unsigned long long SparseFile::punchHoles(boost::filesystem::path file) {
+
+  unsigned long long result = 0;
+  std::vector<char> buf(SPARSE_SCAN_SIZE);
+  struct stat st;
+  int fd;
+
+  if ((fd = ::open(file.string().c_str(), O_RDWR)) < 0) {
+    std::ostringstream oss;
+    oss << "could not open file \""
+        << file.string()
+        << "\": "
+        << strerror(errno);
+    throw CArchiveIssue(oss.str());
+  }
+
+  try {
+
+    if (fstat(fd, &st) < 0) {
+      std::ostringstream oss;
+      oss << "could not stat file \""
+          << file.string()
+          << "\": "
+          << strerror(errno);
+      throw CArchiveIssue(oss.str());
+    }
+
+    /*
+     * Only data regions are scanned, existing holes are left
+     * alone. The partial block at the end of the file is never
+     * a hole.
+     */
+    for (auto &region : SparseFile::dataRegions(fd, st.st_size)) {
+
+      /* holes start at block boundaries */
+      off_t offset = region.first - region.first % SPARSE_BLOCK_SIZE;
+      off_t run_start = -1;
+
+      while (offset + SPARSE_BLOCK_SIZE <= region.second) {
+
+        size_t len = (size_t) std::min((off_t) SPARSE_SCAN_SIZE, region.second - offset);
+        ssize_t n;
+
+        len -= len % SPARSE_BLOCK_SIZE;
+
+        if ((n = pread(fd, buf.data(), len, offset)) != (ssize_t) len) {
+          std::ostringstream oss;
+          oss << "could not read file \""
+              << file.string()
+              << "\": "
+              << ((n < 0) ? strerror(errno) : "short read");
+          throw CArchiveIssue(oss.str());
+        }
+
+        for (size_t i = 0; i < len; i += SPARSE_BLOCK_SIZE) {
+
+          if (SparseFile::zero(buf.data() + i, SPARSE_BLOCK_SIZE)) {
+
+            if (run_start < 0)
+              run_start = offset + i;
+
+          } else if (run_start >= 0) {
+
+            if (!sparse_punch(fd, run_start, offset + i - run_start, file.string())) {
+              ::close(fd);
+              return 0;
+            }
+
+            result += offset + i - run_start;
+            run_start = -1;
+
+          }
+
+        }
+
+        offset += len;
+
+      }
+
+      if (run_start >= 0) {
+
+        if (!sparse_punch(fd, run_start, offset - run_start, file.string())) {
+          ::close(fd);
+          return 0;
+        }
+
+        result += offset - run_start;
+
+      }
+
+    }
+
+  } catch (CArchiveIssue &e) {
+    ::close(fd);
+    throw e;
+  }
+
+  ::close(fd);
+  return result;
+
+}
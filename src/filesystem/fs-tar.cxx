@@ -0,0 +1,1383 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <boost/log/trivial.hpp>
+
+#include <fs-tar.hxx>
+#include <fs-chunks.hxx>
+
+using namespace pgbckctl;
+
+/* ****************************************************************************
+ * Implementation TarStreamSource
+ * ****************************************************************************/
+
+TarStreamSource::TarStreamSource(path file) {
+
+  this->file = file;
+
+}
+
+TarStreamSource::~TarStreamSource() {}
+
+path TarStreamSource::getPath() {
+
+  return this->file;
+
+}
+
+static bool tar_has_suffix(std::string const &name, std::string const &suffix) {
+
+  return (name.length() >= suffix.length())
+    && (name.compare(name.length() - suffix.length(), suffix.length(), suffix) == 0);
+
+}
+
+bool TarStreamSource::isTarArchive(path file) {
+
+  std::string name = file.filename().string();
+
+  return tar_has_suffix(name, ".tar")
+    || tar_has_suffix(name, ".tar.gz")
+    || tar_has_suffix(name, ".tar.zst")
+    || tar_has_suffix(name, ".tar.lz4")
+    || tar_has_suffix(name, ".tar.xz")
+    || tar_has_suffix(name, ".tar" CHUNK_RECIPE_SUFFIX);
+
+}
+
+std::string TarStreamSource::archiveName(path file) {
+
+  std::string name = file.filename().string();
+  std::string::size_type pos = name.rfind(".tar");
+
+  if (pos == std::string::npos)
+    return name;
+
+  return name.substr(0, pos + 4);
+
+}
+
+std::shared_ptr<TarStreamSource> TarStreamSource::open(path file) {
+
+  return TarStreamSource::open(file, 0);
+
+}
+
+std::shared_ptr<TarStreamSource> TarStreamSource::open(path file, unsigned long long offset) {
+
+  std::string name = file.filename().string();
+  std::string executable = "";
+
+  if (tar_has_suffix(name, ".tar"))
+    return std::make_shared<TarFileSource>(file, offset);
+
+  /* deduplicated archive, read from the chunk store */
+  if (tar_has_suffix(name, CHUNK_RECIPE_SUFFIX))
+    return std::make_shared<TarChunkedSource>(file, offset);
+
+  if (tar_has_suffix(name, ".gz")) {
+#ifdef PG_BACKUP_CTL_HAS_ZLIB
+    return std::make_shared<TarGzipSource>(file, offset);
+#else
+    throw CArchiveIssue("zlib compression support not compiled in");
+#endif
+  }
+
+  if (tar_has_suffix(name, ".zst"))
+    executable = "zstd";
+  else if (tar_has_suffix(name, ".lz4"))
+    executable = "lz4";
+  else if (tar_has_suffix(name, ".xz"))
+    executable = "xz";
+  else {
+    std::ostringstream oss;
+    oss << "file \"" << file.string() << "\" is not a tar archive";
+    throw CArchiveIssue(oss.str());
+  }
+
+  if (offset > 0) {
+    std::ostringstream oss;
+    oss << "cannot read archive \"" << file.string() << "\" at offset " << offset;
+    throw CArchiveIssue(oss.str());
+  }
+
+  if (!CPGBackupCtlBase::resolve_file_path(executable))
+    throw CArchiveIssue("cannot resolve path for binary " + executable);
+
+  return std::make_shared<TarPipedSource>(file, executable);
+
+}
+
+void TarStreamSource::skip(unsigned long long len) {
+
+  char buf[8192];
+
+  while (len > 0) {
+
+    size_t n = (len > sizeof(buf)) ? sizeof(buf) : (size_t) len;
+
+    if (this->read(buf, n) != n) {
+      std::ostringstream oss;
+      oss << "unexpected end of archive \"" << this->file.string() << "\"";
+      throw CArchiveIssue(oss.str());
+    }
+
+    len -= n;
+
+  }
+
+}
+
+bool TarStreamSource::seekable() {
+
+  return false;
+
+}
+
+size_t TarStreamSource::pread(char *buf, size_t len, unsigned long long offset) {
+
+  throw CArchiveIssue("reading at arbitrary offsets is not supported for archive \""
+                      + this->file.string() + "\"");
+
+}
+
+/* ****************************************************************************
+ * Implementation TarFileSource
+ * ****************************************************************************/
+
+TarFileSource::TarFileSource(path file, unsigned long long offset) : TarStreamSource(file) {
+
+  this->fd = ::open(file.string().c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (this->fd < 0) {
+    std::ostringstream oss;
+    oss << "could not open archive \"" << file.string() << "\": " << strerror(errno);
+    throw CArchiveIssue(oss.str());
+  }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(this->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  if (offset > 0)
+    this->skip(offset);
+
+}
+
+TarFileSource::~TarFileSource() {
+
+  this->close();
+
+}
+
+size_t TarFileSource::read(char *buf, size_t len) {
+
+  size_t result = 0;
+
+  while (result < len) {
+
+    ssize_t rc = ::read(this->fd, buf + result, len - result);
+
+    if (rc < 0) {
+
+      if (errno == EINTR)
+        continue;
+
+      std::ostringstream oss;
+      oss << "could not read archive \"" << this->file.string() << "\": " << strerror(errno);
+      throw CArchiveIssue(oss.str());
+
+    }
+
+    if (rc == 0)
+      break;
+
+    result += rc;
+
+  }
+
+  return result;
+
+}
+
+void TarFileSource::skip(unsigned long long len) {
+
+  if (::lseek(this->fd, (off_t) len, SEEK_CUR) < 0) {
+    std::ostringstream oss;
+    oss << "could not seek in archive \"" << this->file.string() << "\": " << strerror(errno);
+    throw CArchiveIssue(oss.str());
+  }
+
+}
+
+bool TarFileSource::seekable() {
+
+  return true;
+
+}
+
+size_t TarFileSource::pread(char *buf, size_t len, unsigned long long offset) {
+
+  size_t result = 0;
+
+  while (result < len) {
+
+    ssize_t rc = ::pread(this->fd, buf + result, len - result, (off_t) (offset + result));
+
+    if (rc < 0) {
+
+      if (errno == EINTR)
+        continue;
+
+      std::ostringstream oss;
+      oss << "could not read archive \"" << this->file.string() << "\": " << strerror(errno);
+      throw CArchiveIssue(oss.str());
+
+    }
+
+    if (rc == 0)
+      break;
+
+    result += rc;
+
+  }
+
+  return result;
+
+}
+
+void TarFileSource::close() {
+
+  if (this->fd >= 0) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+
+}
+
+/* ****************************************************************************
+ * Implementation TarGzipSource
+ * ****************************************************************************/
+
+#ifdef PG_BACKUP_CTL_HAS_ZLIB
+
+TarGzipSource::TarGzipSource(path file, unsigned long long offset) : TarStreamSource(file) {
+
+  int fd = ::open(file.string().c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    std::ostringstream oss;
+    oss << "could not open archive \"" << file.string() << "\": " << strerror(errno);
+    throw CArchiveIssue(oss.str());
+  }
+
+  /*
+   * A frame of an indexed archive is a gzip member of its own,
+   * zlib continues with the following members transparently.
+   */
+  if (offset > 0 && ::lseek(fd, (off_t) offset, SEEK_SET) < 0) {
+    std::ostringstream oss;
+    oss << "could not seek in archive \"" << file.string() << "\": " << strerror(errno);
+    ::close(fd);
+    throw CArchiveIssue(oss.str());
+  }
+
+  this->zh = gzdopen(fd, "rb");
+
+  if (this->zh == NULL) {
+    std::ostringstream oss;
+    oss << "could not open archive \"" << file.string() << "\": " << strerror(errno);
+    ::close(fd);
+    throw CArchiveIssue(oss.str());
+  }
+
+  gzbuffer(this->zh, 128 * 1024);
+
+}
+
+TarGzipSource::~TarGzipSource() {
+
+  this->close();
+
+}
+
+size_t TarGzipSource::read(char *buf, size_t len) {
+
+  size_t result = 0;
+
+  while (result < len) {
+
+    int rc = gzread(this->zh, buf + result, (unsigned int) (len - result));
+
+    if (rc < 0) {
+
+      int gzerrno;
+      const char *gzerrstr = gzerror(this->zh, &gzerrno);
+      std::ostringstream oss;
+
+      oss << "could not read archive \"" << this->file.string() << "\": " << gzerrstr;
+      throw CArchiveIssue(oss.str());
+
+    }
+
+    if (rc == 0)
+      break;
+
+    result += rc;
+
+  }
+
+  return result;
+
+}
+
+void TarGzipSource::close() {
+
+  if (this->zh != NULL) {
+    gzclose(this->zh);
+    this->zh = NULL;
+  }
+
+}
+
+#endif
+
+/* ****************************************************************************
+ * Implementation TarPipedSource
+ * ****************************************************************************/
+
+TarPipedSource::TarPipedSource(path file, std::string executable) : TarStreamSource(file) {
+
+  this->jobDescr.executable = executable;
+  this->jobDescr.execArgs.push_back("-d");
+  this->jobDescr.execArgs.push_back("-c");
+  this->jobDescr.execArgs.push_back("-q");
+  this->jobDescr.execArgs.push_back(file.string());
+  this->jobDescr.background_exec = true;
+  this->jobDescr.po_mode = "r";
+
+  this->fpipe_handle = run_pipelined_command(this->jobDescr);
+
+  if (this->fpipe_handle == NULL) {
+    throw CArchiveIssue("could not fork " + executable + " to decompress archive \""
+                        + file.string() + "\"");
+  }
+
+}
+
+TarPipedSource::~TarPipedSource() {
+
+  this->close();
+
+}
+
+size_t TarPipedSource::read(char *buf, size_t len) {
+
+  size_t result = fread(buf, 1, len, this->fpipe_handle);
+
+  if (result < len && ferror(this->fpipe_handle) != 0) {
+    std::ostringstream oss;
+    oss << "could not read archive \"" << this->file.string() << "\": " << strerror(errno);
+    throw CArchiveIssue(oss.str());
+  }
+
+  return result;
+
+}
+
+void TarPipedSource::close() {
+
+  if (this->fpipe_handle != NULL) {
+    pclose(this->fpipe_handle);
+    this->fpipe_handle = NULL;
+  }
+
+}
+
+/* ****************************************************************************
+ * Tar header helpers, shared by TarArchiveReader and TarStreamIndexer
+ * ****************************************************************************/
+
+static unsigned long long tar_padded(unsigned long long size) {
+
+  return (size + TAR_BLOCK_SIZE - 1) & ~((unsigned long long) TAR_BLOCK_SIZE - 1);
+
+}
+
+/*
+ * Verifies the header checksum. zero is set if the header
+ * is a zero block, which doesn't have a checksum.
+ */
+static bool tar_header_valid(const char *header, bool &zero) {
+
+  unsigned long long sum = 0;
+
+  zero = true;
+
+  for (int i = 0; i < TAR_BLOCK_SIZE; i++) {
+
+    if (header[i] != 0)
+      zero = false;
+
+    /* the checksum field itself counts as blanks */
+    sum += (i >= 148 && i < 156) ? ' ' : (unsigned char) header[i];
+
+  }
+
+  return !zero && TarArchiveReader::number(header + 148, 8) == sum;
+
+}
+
+static std::string tar_header_name(const char *header) {
+
+  std::string name(header, strnlen(header, 100));
+
+  /* ustar splits long names into prefix and name */
+  if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0')
+    name = std::string(header + 345, strnlen(header + 345, 155)) + "/" + name;
+
+  return name;
+
+}
+
+/*
+ * Parses the records of a pax extended header, records
+ * are "<length> <key>=<value>\n".
+ */
+static void tar_parse_pax(std::string const &records,
+                          std::string &longname,
+                          std::string &longlink,
+                          unsigned long long &paxsize,
+                          bool &have_paxsize) {
+
+  std::string::size_type pos = 0;
+
+  while (pos < records.length()) {
+
+    std::string::size_type space = records.find(' ', pos);
+    unsigned long long reclen;
+    std::string record;
+    std::string::size_type eq;
+
+    if (space == std::string::npos)
+      break;
+
+    reclen = strtoull(records.substr(pos, space - pos).c_str(), NULL, 10);
+
+    if (reclen == 0 || pos + reclen > records.length())
+      break;
+
+    record = records.substr(space + 1, pos + reclen - space - 2);
+    eq = record.find('=');
+
+    if (eq != std::string::npos) {
+
+      std::string key = record.substr(0, eq);
+      std::string value = record.substr(eq + 1);
+
+      if (key == "path")
+        longname = value;
+      else if (key == "linkpath")
+        longlink = value;
+      else if (key == "size") {
+        paxsize = strtoull(value.c_str(), NULL, 10);
+        have_paxsize = true;
+      }
+
+    }
+
+    pos += reclen;
+
+  }
+
+}
+
+/* ****************************************************************************
+ * Implementation TarArchiveReader
+ * ****************************************************************************/
+
+TarArchiveReader::TarArchiveReader(std::shared_ptr<TarStreamSource> source) {
+
+  if (source == nullptr) {
+    throw CArchiveIssue("tar archive reader requires a valid source");
+  }
+
+  this->source = source;
+
+}
+
+TarArchiveReader::~TarArchiveReader() {}
+
+unsigned long long TarArchiveReader::number(const char *field, size_t len) {
+
+  unsigned long long result = 0;
+
+  /*
+   * Values not fitting into the octal representation are stored
+   * base-256, flagged by the high bit of the first byte (GNU tar,
+   * PostgreSQL's tarCreateHeader() does the same for large files).
+   */
+  if ((unsigned char) field[0] & 0x80) {
+
+    result = (unsigned char) field[0] & 0x7F;
+
+    for (size_t i = 1; i < len; i++)
+      result = (result << 8) | (unsigned char) field[i];
+
+    return result;
+
+  }
+
+  for (size_t i = 0; i < len; i++) {
+
+    if (field[i] == ' ' && result == 0)
+      continue;
+
+    if (field[i] < '0' || field[i] > '7')
+      break;
+
+    result = (result << 3) | (field[i] - '0');
+
+  }
+
+  return result;
+
+}
+
+void TarArchiveReader::readBlocks(char *buf, size_t len) {
+
+  if (this->source->read(buf, len) != len) {
+    std::ostringstream oss;
+    oss << "unexpected end of tar archive \"" << this->source->getPath().string()
+        << "\" at offset " << this->position;
+    throw CArchiveIssue(oss.str());
+  }
+
+  this->position += len;
+
+}
+
+void TarArchiveReader::skipBytes(unsigned long long len) {
+
+  if (len == 0)
+    return;
+
+  this->source->skip(len);
+  this->position += len;
+
+}
+
+std::string TarArchiveReader::readExtension(unsigned long long size) {
+
+  unsigned long long padded = tar_padded(size);
+  std::string data;
+
+  /* sanity check, extension headers are small */
+  if (size > 1024 * 1024) {
+    std::ostringstream oss;
+    oss << "invalid extended header in tar archive \"" << this->source->getPath().string()
+        << "\" at offset " << this->position;
+    throw CArchiveIssue(oss.str());
+  }
+
+  data.resize(padded);
+  this->readBlocks(&data[0], padded);
+  data.resize(size);
+
+  return data;
+
+}
+
+bool TarArchiveReader::next(tar_member &member) {
+
+  std::string longname = "";
+  std::string longlink = "";
+  unsigned long long paxsize = 0;
+  bool have_paxsize = false;
+  unsigned long long member_start;
+
+  if (this->eof)
+    return false;
+
+  /* Skip what's left of the current member */
+  this->skipBytes(this->remaining + this->padding);
+  this->remaining = 0;
+  this->padding = 0;
+  member_start = this->position;
+
+  while (true) {
+
+    char header[TAR_BLOCK_SIZE];
+    unsigned long long header_offset = this->position;
+    bool zero;
+    char type;
+
+    /*
+     * A stream ending without the two zero blocks is tolerated
+     * only on a header boundary.
+     */
+    if (this->source->read(header, TAR_BLOCK_SIZE) != TAR_BLOCK_SIZE) {
+
+      if (longname.length() > 0 || have_paxsize) {
+        std::ostringstream oss;
+        oss << "unexpected end of tar archive \"" << this->source->getPath().string() << "\"";
+        throw CArchiveIssue(oss.str());
+      }
+
+      this->eof = true;
+      return false;
+
+    }
+
+    this->position += TAR_BLOCK_SIZE;
+
+    if (!tar_header_valid(header, zero)) {
+
+      /* The archive ends with zero blocks */
+      if (zero) {
+        this->eof = true;
+        return false;
+      }
+
+      std::ostringstream oss;
+      oss << "invalid header checksum in tar archive \"" << this->source->getPath().string()
+          << "\" at offset " << header_offset;
+      throw CArchiveIssue(oss.str());
+    }
+
+    type = header[156];
+
+    /* GNU long name or long link target of the next member */
+    if (type == 'L' || type == 'K') {
+
+      std::string value = this->readExtension(TarArchiveReader::number(header + 124, 12));
+
+      value = std::string(value.c_str());
+
+      if (type == 'L')
+        longname = value;
+      else
+        longlink = value;
+
+      continue;
+
+    }
+
+    /* pax extended header of the next member */
+    if (type == 'x') {
+
+      tar_parse_pax(this->readExtension(TarArchiveReader::number(header + 124, 12)),
+                    longname, longlink, paxsize, have_paxsize);
+      continue;
+
+    }
+
+    /* pax global header, nothing of interest for us */
+    if (type == 'g') {
+      this->skipBytes(tar_padded(TarArchiveReader::number(header + 124, 12)));
+      member_start = this->position;
+      continue;
+    }
+
+    member.type = (type == '\0') ? '0' : type;
+    member.size = have_paxsize ? paxsize : TarArchiveReader::number(header + 124, 12);
+    member.mtime = (time_t) TarArchiveReader::number(header + 136, 12);
+    member.mode = (unsigned int) TarArchiveReader::number(header + 100, 8);
+    member.header_offset = member_start;
+    member.data_offset = this->position;
+    member.frame_offset = 0;
+    member.frame_start = 0;
+
+    if (longname.length() > 0)
+      member.name = longname;
+    else
+      member.name = tar_header_name(header);
+
+    if (longlink.length() > 0)
+      member.linkname = longlink;
+    else
+      member.linkname = std::string(header + 157, strnlen(header + 157, 100));
+
+    this->remaining = member.size;
+    this->padding = (TAR_BLOCK_SIZE - (member.size % TAR_BLOCK_SIZE)) % TAR_BLOCK_SIZE;
+
+    return true;
+
+  }
+
+}
+
+size_t TarArchiveReader::read(char *buf, size_t len) {
+
+  size_t n;
+
+  if (this->remaining == 0)
+    return 0;
+
+  n = (len > this->remaining) ? (size_t) this->remaining : len;
+
+  if (this->source->read(buf, n) != n) {
+    std::ostringstream oss;
+    oss << "unexpected end of tar archive \"" << this->source->getPath().string()
+        << "\" at offset " << this->position;
+    throw CArchiveIssue(oss.str());
+  }
+
+  this->position += n;
+  this->remaining -= n;
+
+  return n;
+
+}
+
+/* ****************************************************************************
+ * Implementation TarStreamIndexer
+ * ****************************************************************************/
+
+TarStreamIndexer::TarStreamIndexer() {}
+
+TarStreamIndexer::~TarStreamIndexer() {}
+
+void TarStreamIndexer::fail(std::string error) {
+
+  this->state = TAR_INDEXER_FAILED;
+  this->error = error;
+  this->members.clear();
+
+}
+
+void TarStreamIndexer::processHeader() {
+
+  /* offset of the header just collected */
+  unsigned long long header_offset = this->position - TAR_BLOCK_SIZE;
+  unsigned long long size;
+  bool zero;
+  char type;
+  tar_member member;
+
+  if (!tar_header_valid(this->header, zero)) {
+
+    /* The archive ends with zero blocks */
+    if (zero && !this->pending) {
+      this->state = TAR_INDEXER_END;
+      return;
+    }
+
+    std::ostringstream oss;
+    oss << "invalid tar header at offset " << header_offset;
+    this->fail(oss.str());
+    return;
+
+  }
+
+  type = this->header[156];
+  size = TarArchiveReader::number(this->header + 124, 12);
+
+  this->remaining = size;
+  this->padding = tar_padded(size) - size;
+  this->extension = 0;
+  this->state = TAR_INDEXER_DATA;
+
+  /* Extended headers of the next member, collect their data */
+  if (type == 'L' || type == 'K' || type == 'x') {
+
+    /* sanity check, extension headers are small */
+    if (size > 1024 * 1024) {
+      std::ostringstream oss;
+      oss << "invalid extended tar header at offset " << header_offset;
+      this->fail(oss.str());
+      return;
+    }
+
+    this->extension = type;
+    this->extension_data = "";
+    this->pending = true;
+
+  }
+
+  /* pax global header, skipped */
+  if (type == 'L' || type == 'K' || type == 'x' || type == 'g') {
+
+    if (this->remaining + this->padding == 0)
+      this->state = TAR_INDEXER_HEADER;
+
+    return;
+
+  }
+
+  member.type = (type == '\0') ? '0' : type;
+  member.size = this->have_paxsize ? this->paxsize : size;
+  member.mtime = (time_t) TarArchiveReader::number(this->header + 136, 12);
+  member.mode = (unsigned int) TarArchiveReader::number(this->header + 100, 8);
+  member.header_offset = this->member_start;
+  member.data_offset = this->position;
+  member.frame_offset = this->frame_offset;
+  member.frame_start = this->frame_start;
+  member.name = (this->longname.length() > 0) ? this->longname : tar_header_name(this->header);
+  member.linkname = (this->longlink.length() > 0)
+    ? this->longlink
+    : std::string(this->header + 157, strnlen(this->header + 157, 100));
+
+  this->members.push_back(member);
+
+  this->remaining = member.size;
+  this->padding = tar_padded(member.size) - member.size;
+
+  this->pending = false;
+  this->longname = "";
+  this->longlink = "";
+  this->paxsize = 0;
+  this->have_paxsize = false;
+
+  if (this->remaining + this->padding == 0)
+    this->state = TAR_INDEXER_HEADER;
+
+}
+
+size_t TarStreamIndexer::feed(const char *buf, size_t len) {
+
+  size_t consumed = 0;
+
+  /* Nothing to index anymore */
+  if (this->state == TAR_INDEXER_END || this->state == TAR_INDEXER_FAILED)
+    return len;
+
+  while (consumed < len) {
+
+    if (this->state == TAR_INDEXER_HEADER) {
+
+      size_t n = TAR_BLOCK_SIZE - this->header_fill;
+
+      if (n > len - consumed)
+        n = len - consumed;
+
+      if (this->atBoundary())
+        this->member_start = this->position;
+
+      memcpy(this->header + this->header_fill, buf + consumed, n);
+      this->header_fill += n;
+      this->position += n;
+      consumed += n;
+
+      if (this->header_fill < TAR_BLOCK_SIZE)
+        continue;
+
+      this->header_fill = 0;
+      this->processHeader();
+
+      if (this->state == TAR_INDEXER_END || this->state == TAR_INDEXER_FAILED)
+        return len;
+
+    } else {
+
+      unsigned long long left = this->remaining + this->padding;
+      size_t n = (left > len - consumed) ? len - consumed : (size_t) left;
+      size_t data = (this->remaining > n) ? n : (size_t) this->remaining;
+
+      if (this->extension != 0)
+        this->extension_data.append(buf + consumed, data);
+
+      this->remaining -= data;
+      this->padding -= (n - data);
+      this->position += n;
+      consumed += n;
+
+      if (this->remaining + this->padding > 0)
+        continue;
+
+      if (this->extension == 'L')
+        this->longname = std::string(this->extension_data.c_str());
+      else if (this->extension == 'K')
+        this->longlink = std::string(this->extension_data.c_str());
+      else if (this->extension == 'x')
+        tar_parse_pax(this->extension_data, this->longname, this->longlink,
+                      this->paxsize, this->have_paxsize);
+
+      this->extension = 0;
+      this->extension_data = "";
+      this->state = TAR_INDEXER_HEADER;
+
+    }
+
+    if (this->atBoundary())
+      break;
+
+  }
+
+  return consumed;
+
+}
+
+bool TarStreamIndexer::atBoundary() {
+
+  return (this->state == TAR_INDEXER_HEADER
+          && this->header_fill == 0
+          && !this->pending);
+
+}
+
+bool TarStreamIndexer::complete() {
+
+  return (this->state == TAR_INDEXER_END || this->atBoundary());
+
+}
+
+bool TarStreamIndexer::failed() {
+
+  return (this->state == TAR_INDEXER_FAILED);
+
+}
+
+std::string TarStreamIndexer::getError() {
+
+  return this->error;
+
+}
+
+unsigned long long TarStreamIndexer::getPosition() {
+
+  return this->position;
+
+}
+
+void TarStreamIndexer::setFrame(unsigned long long offset, unsigned long long start) {
+
+  this->frame_offset = offset;
+  this->frame_start = start;
+
+}
+
+std::vector<tar_member> &TarStreamIndexer::getMembers() {
+
+  return this->members;
+
+}
+
+/* ****************************************************************************
+ * Implementation TarArchiveIndex
+ * ****************************************************************************/
+
+/*
+ * The index is a text file, a header line with the size of
+ * the archive it belongs to and one line per member with
+ * tab separated fields:
+ *
+ * type, mode (octal), size, mtime, header offset, data offset,
+ * frame offset, frame start, name, link name
+ *
+ * Names are escaped, so they can't break the format.
+ */
+#define TAR_INDEX_MAGIC "pg_backup_ctl++ tar index 1"
+
+static std::string tar_index_escape(std::string const &value) {
+
+  std::string result;
+
+  for (auto c : value) {
+
+    if (c == '\\')
+      result += "\\\\";
+    else if (c == '\t')
+      result += "\\t";
+    else if (c == '\n')
+      result += "\\n";
+    else
+      result += c;
+
+  }
+
+  return result;
+
+}
+
+static std::string tar_index_unescape(std::string const &value) {
+
+  std::string result;
+
+  for (std::string::size_type i = 0; i < value.length(); i++) {
+
+    if (value[i] == '\\' && i + 1 < value.length()) {
+
+      i++;
+
+      if (value[i] == 't')
+        result += '\t';
+      else if (value[i] == 'n')
+        result += '\n';
+      else
+        result += value[i];
+
+    } else {
+      result += value[i];
+    }
+
+  }
+
+  return result;
+
+}
+
+TarArchiveIndex::TarArchiveIndex(path archive) {
+
+  this->archive = archive;
+
+}
+
+TarArchiveIndex::~TarArchiveIndex() {}
+
+path TarArchiveIndex::indexFile(path archive) {
+
+  return path(archive.string() + TAR_INDEX_SUFFIX);
+
+}
+
+bool TarArchiveIndex::load() {
+
+  std::ifstream in(TarArchiveIndex::indexFile(this->archive).string());
+  std::string line;
+  boost::system::error_code ec;
+  unsigned long long archive_size;
+
+  this->members.clear();
+
+  if (!in.is_open() || !std::getline(in, line))
+    return false;
+
+  /*
+   * The header tells the size of the archive, an index
+   * not matching the archive is useless.
+   */
+  if (line.compare(0, strlen(TAR_INDEX_MAGIC " "), TAR_INDEX_MAGIC " ") != 0)
+    return false;
+
+  archive_size = boost::filesystem::file_size(this->archive, ec);
+
+  if (ec || strtoull(line.c_str() + strlen(TAR_INDEX_MAGIC " "), NULL, 10) != archive_size)
+    return false;
+
+  while (std::getline(in, line)) {
+
+    std::vector<std::string> fields;
+    std::string::size_type pos = 0;
+    tar_member member;
+
+    while (true) {
+
+      std::string::size_type tab = line.find('\t', pos);
+
+      fields.push_back(line.substr(pos, (tab == std::string::npos) ? std::string::npos : tab - pos));
+
+      if (tab == std::string::npos)
+        break;
+
+      pos = tab + 1;
+
+    }
+
+    if (fields.size() != 10 || fields[0].length() != 1) {
+      this->members.clear();
+      return false;
+    }
+
+    member.type = fields[0][0];
+    member.mode = (unsigned int) strtoul(fields[1].c_str(), NULL, 8);
+    member.size = strtoull(fields[2].c_str(), NULL, 10);
+    member.mtime = (time_t) strtoll(fields[3].c_str(), NULL, 10);
+    member.header_offset = strtoull(fields[4].c_str(), NULL, 10);
+    member.data_offset = strtoull(fields[5].c_str(), NULL, 10);
+    member.frame_offset = strtoull(fields[6].c_str(), NULL, 10);
+    member.frame_start = strtoull(fields[7].c_str(), NULL, 10);
+    member.name = tar_index_unescape(fields[8]);
+    member.linkname = tar_index_unescape(fields[9]);
+
+    if (member.frame_start > member.header_offset) {
+      this->members.clear();
+      return false;
+    }
+
+    this->members.push_back(member);
+
+  }
+
+  return true;
+
+}
+
+void TarArchiveIndex::write(std::vector<tar_member> &members) {
+
+  path index = TarArchiveIndex::indexFile(this->archive);
+  path temp = path(index.string() + ".tmp");
+  std::ostringstream oss;
+  std::string content;
+  size_t written = 0;
+  int fd;
+
+  oss << TAR_INDEX_MAGIC << " " << boost::filesystem::file_size(this->archive) << "\n";
+
+  for (auto &member : members) {
+
+    oss << member.type << "\t"
+        << std::oct << member.mode << std::dec << "\t"
+        << member.size << "\t"
+        << (long long) member.mtime << "\t"
+        << member.header_offset << "\t"
+        << member.data_offset << "\t"
+        << member.frame_offset << "\t"
+        << member.frame_start << "\t"
+        << tar_index_escape(member.name) << "\t"
+        << tar_index_escape(member.linkname) << "\n";
+
+  }
+
+  content = oss.str();
+
+  /*
+   * Written into a temporary file first, so there is
+   * either a complete index or none at all.
+   */
+  fd = ::open(temp.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+
+  if (fd < 0) {
+    std::ostringstream err;
+    err << "could not create tar index \"" << temp.string() << "\": " << strerror(errno);
+    throw CArchiveIssue(err.str());
+  }
+
+  while (written < content.length()) {
+
+    ssize_t rc = ::write(fd, content.c_str() + written, content.length() - written);
+
+    if (rc < 0 && errno == EINTR)
+      continue;
+
+    if (rc <= 0) {
+      std::ostringstream err;
+      err << "could not write tar index \"" << temp.string() << "\": " << strerror(errno);
+      ::close(fd);
+      ::unlink(temp.string().c_str());
+      throw CArchiveIssue(err.str());
+    }
+
+    written += rc;
+
+  }
+
+  if (::fsync(fd) != 0 || ::close(fd) != 0
+      || ::rename(temp.string().c_str(), index.string().c_str()) != 0) {
+    std::ostringstream err;
+    err << "could not write tar index \"" << index.string() << "\": " << strerror(errno);
+    ::unlink(temp.string().c_str());
+    throw CArchiveIssue(err.str());
+  }
+
+  this->members = members;
+
+}
+
+std::vector<tar_member> &TarArchiveIndex::getMembers() {
+
+  return this->members;
+
+}
+
+bool TarArchiveIndex::lookup(std::string name, tar_member &member) {
+
+  for (auto &item : this->members) {
+
+    if (item.name == name) {
+      member = item;
+      return true;
+    }
+
+  }
+
+  return false;
+
+}
+
+std::shared_ptr<TarStreamSource> TarArchiveIndex::open(tar_member &member) {
+
+  std::shared_ptr<TarStreamSource> source = TarStreamSource::open(this->archive,
+                                                                  member.frame_offset);
+
+  source->skip(member.header_offset - member.frame_start);
+  return source;
+
+}
+
+/* ****************************************************************************
+ * Implementation TarIndexingFile
+ * ****************************************************************************/
+
+TarIndexingFile::TarIndexingFile(std::shared_ptr<BackupFile> file)
+  : BackupFile(path(file->getFilePath())) {
+
+  this->file = file;
+
+}
+
+TarIndexingFile::~TarIndexingFile() {}
+
+std::shared_ptr<BackupFile> TarIndexingFile::getFile() {
+
+  return this->file;
+
+}
+
+void TarIndexingFile::frame() {
+
+  unsigned long long position = this->indexer.getPosition();
+  off_t offset;
+
+  /* Every member can be read directly */
+  if (!this->file->isCompressed()) {
+    this->indexer.setFrame(position, position);
+    return;
+  }
+
+  if (position - this->frame_start < TAR_INDEX_FRAME_SIZE)
+    return;
+
+  /*
+   * Files which can't start a new frame keep all members in
+   * the first one, they're indexed nevertheless.
+   */
+  if ((offset = this->file->frameBoundary()) < 0)
+    return;
+
+  this->indexer.setFrame(offset, position);
+  this->frame_start = position;
+
+}
+
+void TarIndexingFile::writeIndex() {
+
+  /*
+   * The index is a by-product, the archive itself
+   * is fine without it.
+   */
+  if (this->indexer.failed()) {
+    BOOST_LOG_TRIVIAL(warning) << "WARNING: not indexing archive \""
+                               << this->handle.string() << "\": "
+                               << this->indexer.getError();
+    return;
+  }
+
+  if (!this->indexer.complete()) {
+    BOOST_LOG_TRIVIAL(warning) << "WARNING: not indexing archive \""
+                               << this->handle.string() << "\": "
+                               << "tar stream ends within a member";
+    return;
+  }
+
+  try {
+
+    TarArchiveIndex index(this->handle);
+    index.write(this->indexer.getMembers());
+
+  } catch (CArchiveIssue &e) {
+    BOOST_LOG_TRIVIAL(warning) << "WARNING: " << e.what();
+  }
+
+}
+
+bool TarIndexingFile::isCompressed() {
+  return this->file->isCompressed();
+}
+
+void TarIndexingFile::setCompressed(bool compressed) {
+  this->file->setCompressed(compressed);
+}
+
+void TarIndexingFile::open() {
+  this->file->open();
+}
+
+void TarIndexingFile::close() {
+
+  this->file->close();
+
+  if (!this->indexed) {
+    this->indexed = true;
+    this->writeIndex();
+  }
+
+}
+
+void TarIndexingFile::fsync() {
+  this->file->fsync();
+}
+
+bool TarIndexingFile::isOpen() {
+  return this->file->isOpen();
+}
+
+void TarIndexingFile::rename(path& newname) {
+
+  this->file->rename(newname);
+  this->handle = path(this->file->getFilePath());
+
+}
+
+void TarIndexingFile::setOpenMode(std::string mode) {
+  this->file->setOpenMode(mode);
+}
+
+std::string TarIndexingFile::getOpenMode() {
+  return this->file->getOpenMode();
+}
+
+size_t TarIndexingFile::write(const char *buf, size_t len) {
+
+  size_t written = 0;
+  size_t consumed = 0;
+
+  /*
+   * Hand over the data member by member, so a new frame
+   * can be started right before a member header.
+   */
+  while (consumed < len) {
+
+    size_t n;
+
+    if (this->indexer.atBoundary())
+      this->frame();
+
+    n = this->indexer.feed(buf + consumed, len - consumed);
+    written += this->file->write(buf + consumed, n);
+    consumed += n;
+
+  }
+
+  return written;
+
+}
+
+size_t TarIndexingFile::read(char *buf, size_t len) {
+  throw CArchiveIssue("reading from an indexing tar file is not supported");
+}
+
+void TarIndexingFile::remove() {
+
+  boost::system::error_code ec;
+
+  this->file->remove();
+  boost::filesystem::remove(TarArchiveIndex::indexFile(this->handle), ec);
+
+}
+
+size_t TarIndexingFile::size() {
+  return this->file->size();
+}
+
+off_t TarIndexingFile::lseek(off_t offset, int whence) {
+  throw CArchiveIssue("seeking in an indexing tar file is not supported");
+}
+
+off_t TarIndexingFile::current_position() {
+  return this->file->current_position();
+}
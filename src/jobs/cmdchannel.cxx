@@ -0,0 +1,510 @@
+#include <errno.h>
+#include <poll.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sstream>
+
+#include <boost/log/trivial.hpp>
+
+#include <cmdchannel.hxx>
+
+using namespace pgbckctl;
+
+/*
+ * Seconds a caller waits for the acknowledgement of
+ * a submitted command.
+ */
+#define CMD_ACK_TIMEOUT 30
+
+/* ****************************************************************************
+ * Implementation CommandMessage
+ * ****************************************************************************/
+
+CommandMessage::CommandMessage() {}
+
+CommandMessage::CommandMessage(launcher_cmd_request &request) {
+
+  this->buf.push_back((char) CMD_MSG_SUBMIT);
+  this->putUInt32((uint32_t) request.tag);
+  this->putUInt32(request.flags);
+  this->putString(request.archive_name);
+  this->putString(request.command);
+
+}
+
+CommandMessage::CommandMessage(launcher_cmd_ack &ack) {
+
+  this->buf.push_back((char) CMD_MSG_ACK);
+  this->putUInt32(ack.accepted ? 1 : 0);
+  this->putUInt32((uint32_t) ack.pid);
+  this->putString(ack.message);
+
+}
+
+CommandMessage::CommandMessage(std::vector<worker_instrumentation_item> &items) {
+
+  this->buf.push_back((char) CMD_MSG_PROGRESS);
+  this->putUInt32((uint32_t) items.size());
+
+  for (auto &item : items) {
+    this->putUInt32((uint32_t) item.key);
+    this->putInt64(item.value);
+  }
+
+}
+
+CommandMessage::CommandMessage(launcher_cmd_done &done) {
+
+  this->buf.push_back((char) CMD_MSG_DONE);
+  this->putUInt32(done.success ? 1 : 0);
+  this->putString(done.message);
+
+}
+
+CommandMessage::~CommandMessage() {}
+
+void CommandMessage::putUInt32(uint32_t value) {
+
+  uint32_t n = htonl(value);
+  this->buf.append((char *) &n, sizeof(n));
+
+}
+
+void CommandMessage::putInt64(int64_t value) {
+
+  this->putUInt32((uint32_t) ((uint64_t) value >> 32));
+  this->putUInt32((uint32_t) ((uint64_t) value & 0xFFFFFFFF));
+
+}
+
+void CommandMessage::putString(std::string value) {
+
+  this->putUInt32((uint32_t) value.length());
+  this->buf.append(value);
+
+}
+
+uint32_t CommandMessage::getUInt32() {
+
+  uint32_t n;
+
+  if (this->pos + sizeof(n) > this->buf.length()) {
+    throw LauncherFailure("truncated command channel message");
+  }
+
+  memcpy(&n, this->buf.data() + this->pos, sizeof(n));
+  this->pos += sizeof(n);
+
+  return ntohl(n);
+
+}
+
+int64_t CommandMessage::getInt64() {
+
+  uint64_t high = this->getUInt32();
+  uint64_t low = this->getUInt32();
+
+  return (int64_t) ((high << 32) | low);
+
+}
+
+std::string CommandMessage::getString() {
+
+  uint32_t len = this->getUInt32();
+  std::string value;
+
+  if (this->pos + len > this->buf.length()) {
+    throw LauncherFailure("truncated command channel message");
+  }
+
+  value = this->buf.substr(this->pos, len);
+  this->pos += len;
+
+  return value;
+
+}
+
+CommandMessageType CommandMessage::type() {
+
+  if (this->buf.length() == 0)
+    return (CommandMessageType) 0;
+
+  return (CommandMessageType) this->buf[0];
+
+}
+
+std::string &CommandMessage::data() {
+
+  return this->buf;
+
+}
+
+void CommandMessage::decode(launcher_cmd_request &request) {
+
+  if (this->type() != CMD_MSG_SUBMIT) {
+    throw LauncherFailure("unexpected command channel message, expected command");
+  }
+
+  this->pos = 1;
+  request.tag = (CatalogTag) (int32_t) this->getUInt32();
+  request.flags = this->getUInt32();
+  request.archive_name = this->getString();
+  request.command = this->getString();
+
+}
+
+void CommandMessage::decode(launcher_cmd_ack &ack) {
+
+  if (this->type() != CMD_MSG_ACK) {
+    throw LauncherFailure("unexpected command channel message, expected acknowledgement");
+  }
+
+  this->pos = 1;
+  ack.accepted = (this->getUInt32() != 0);
+  ack.pid = (pid_t) this->getUInt32();
+  ack.message = this->getString();
+
+}
+
+void CommandMessage::decode(std::vector<worker_instrumentation_item> &items) {
+
+  uint32_t count;
+
+  if (this->type() != CMD_MSG_PROGRESS) {
+    throw LauncherFailure("unexpected command channel message, expected progress");
+  }
+
+  this->pos = 1;
+  count = this->getUInt32();
+  items.clear();
+
+  for (uint32_t i = 0; i < count; i++) {
+
+    worker_instrumentation_item item;
+
+    item.key = (int) this->getUInt32();
+    item.value = this->getInt64();
+    items.push_back(item);
+
+  }
+
+}
+
+void CommandMessage::decode(launcher_cmd_done &done) {
+
+  if (this->type() != CMD_MSG_DONE) {
+    throw LauncherFailure("unexpected command channel message, expected result");
+  }
+
+  this->pos = 1;
+  done.success = (this->getUInt32() != 0);
+  done.message = this->getString();
+
+}
+
+/* ****************************************************************************
+ * Implementation LauncherCommandChannel
+ * ****************************************************************************/
+
+LauncherCommandChannel::LauncherCommandChannel() {}
+
+LauncherCommandChannel::LauncherCommandChannel(int fd) {
+
+  this->fd = fd;
+
+}
+
+LauncherCommandChannel::~LauncherCommandChannel() {
+
+  this->close();
+
+}
+
+socklen_t LauncherCommandChannel::address(std::string catalog_name,
+                                          struct sockaddr_un &addr) {
+
+  std::string name = "pg_backup_ctl::launcher_cmd::" + catalog_name;
+
+  memset(&addr, 0, sizeof(struct sockaddr_un));
+  addr.sun_family = AF_UNIX;
+
+  /*
+   * Abstract namespace, like the launcher wakeup socket.
+   */
+  if (name.length() > sizeof(addr.sun_path) - 1)
+    name = name.substr(0, sizeof(addr.sun_path) - 1);
+
+  memcpy(addr.sun_path + 1, name.data(), name.length());
+
+  return (socklen_t) (offsetof(struct sockaddr_un, sun_path) + 1 + name.length());
+
+}
+
+int LauncherCommandChannel::listen(std::string catalog_name) {
+
+  struct sockaddr_un addr;
+  socklen_t addrlen = LauncherCommandChannel::address(catalog_name, addr);
+  int listen_fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+  if (listen_fd < 0) {
+    std::ostringstream oss;
+    oss << "could not create launcher command socket: " << strerror(errno);
+    throw LauncherFailure(oss.str());
+  }
+
+  if (bind(listen_fd, (struct sockaddr *) &addr, addrlen) < 0
+      || ::listen(listen_fd, 64) < 0) {
+    std::ostringstream oss;
+    oss << "could not listen on launcher command socket: " << strerror(errno);
+    ::close(listen_fd);
+    throw LauncherFailure(oss.str());
+  }
+
+  return listen_fd;
+
+}
+
+bool LauncherCommandChannel::peerAllowed(int fd) {
+
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+    return false;
+
+  return (cred.uid == geteuid() || cred.uid == 0);
+
+}
+
+bool LauncherCommandChannel::connect(std::string catalog_name) {
+
+  struct sockaddr_un addr;
+  socklen_t addrlen = LauncherCommandChannel::address(catalog_name, addr);
+
+  this->close();
+  this->fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+  if (this->fd < 0) {
+    std::ostringstream oss;
+    oss << "could not create command channel socket: " << strerror(errno);
+    throw LauncherFailure(oss.str());
+  }
+
+  if (::connect(this->fd, (struct sockaddr *) &addr, addrlen) < 0) {
+
+    int connect_errno = errno;
+
+    this->close();
+
+    /*
+     * Nobody listening, the caller falls back to the
+     * message queue.
+     */
+    if (connect_errno == ECONNREFUSED || connect_errno == ENOENT)
+      return false;
+
+    std::ostringstream oss;
+    oss << "could not connect to launcher command channel: " << strerror(connect_errno);
+    throw LauncherFailure(oss.str());
+
+  }
+
+  return true;
+
+}
+
+int LauncherCommandChannel::socket() {
+
+  return this->fd;
+
+}
+
+int LauncherCommandChannel::release() {
+
+  int released_fd = this->fd;
+
+  this->fd = -1;
+  return released_fd;
+
+}
+
+void LauncherCommandChannel::close() {
+
+  if (this->fd >= 0) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+
+}
+
+void LauncherCommandChannel::send(CommandMessage &msg) {
+
+  std::string &data = msg.data();
+
+  if (this->fd < 0) {
+    throw LauncherFailure("command channel not connected");
+  }
+
+  if (data.length() > CMD_MSG_MAX_SIZE) {
+    throw LauncherFailure("command channel message exceeds maximum size");
+  }
+
+  /*
+   * MSG_NOSIGNAL, a caller which has gone away must
+   * not kill a worker reporting to it.
+   */
+  while (::send(this->fd, data.data(), data.length(), MSG_NOSIGNAL) < 0) {
+
+    if (errno != EINTR) {
+      std::ostringstream oss;
+      oss << "could not send command channel message: " << strerror(errno);
+      throw LauncherFailure(oss.str());
+    }
+
+  }
+
+}
+
+bool LauncherCommandChannel::receive(CommandMessage &msg, int timeout) {
+
+  struct pollfd pfd;
+  char buf[CMD_MSG_MAX_SIZE];
+  ssize_t len;
+  int rc;
+
+  msg.data().clear();
+
+  if (this->fd < 0) {
+    throw LauncherFailure("command channel not connected");
+  }
+
+  pfd.fd = this->fd;
+  pfd.events = POLLIN;
+
+  while ((rc = poll(&pfd, 1, timeout)) < 0) {
+
+    if (errno != EINTR) {
+      std::ostringstream oss;
+      oss << "could not wait for command channel message: " << strerror(errno);
+      throw LauncherFailure(oss.str());
+    }
+
+  }
+
+  if (rc == 0)
+    return false;
+
+  while ((len = ::recv(this->fd, buf, sizeof(buf), 0)) < 0) {
+
+    if (errno == ECONNRESET)
+      return false;
+
+    if (errno != EINTR) {
+      std::ostringstream oss;
+      oss << "could not receive command channel message: " << strerror(errno);
+      throw LauncherFailure(oss.str());
+    }
+
+  }
+
+  /* zero length means the peer has closed the connection */
+  if (len == 0)
+    return false;
+
+  msg.data().assign(buf, len);
+  return true;
+
+}
+
+/* ****************************************************************************
+ * Caller side
+ * ****************************************************************************/
+
+bool pgbckctl::submit_launcher_cmd(std::string catalog_name,
+                                   launcher_cmd_request &request,
+                                   launcher_cmd_ack &ack,
+                                   launcher_cmd_done &done,
+                                   std::function<void(pid_t, std::vector<worker_instrumentation_item> &)> progress) {
+
+  LauncherCommandChannel channel;
+  CommandMessage msg(request);
+  CommandMessage answer;
+
+  if (!channel.connect(catalog_name))
+    return false;
+
+  channel.send(msg);
+
+  if (!channel.receive(answer, CMD_ACK_TIMEOUT * 1000)) {
+    throw LauncherFailure("launcher did not acknowledge command");
+  }
+
+  answer.decode(ack);
+
+  if (!ack.accepted || !(request.flags & CMD_SUBMIT_WAIT))
+    return true;
+
+  /*
+   * Everything from here on is sent by the worker. If it exits
+   * without a result, it has crashed or was killed.
+   */
+  while (channel.receive(answer, -1)) {
+
+    if (answer.type() == CMD_MSG_PROGRESS) {
+
+      std::vector<worker_instrumentation_item> items;
+
+      answer.decode(items);
+
+      if (progress)
+        progress(ack.pid, items);
+
+      continue;
+
+    }
+
+    answer.decode(done);
+    return true;
+
+  }
+
+  done.success = false;
+  done.message = "worker exited without reporting a result";
+
+  return true;
+
+}
+
+pid_t pgbckctl::dispatch_launcher_cmd(job_info &info,
+                                      CatalogTag tag,
+                                      std::string archive_name,
+                                      std::string command) {
+
+  launcher_cmd_request request;
+  launcher_cmd_ack ack;
+  launcher_cmd_done done;
+
+  request.tag = tag;
+  request.archive_name = archive_name;
+  request.command = command;
+
+  if (!submit_launcher_cmd(info.cmdHandle->getCatalog()->name(), request, ack, done)) {
+
+    BOOST_LOG_TRIVIAL(debug) << "launcher command channel not available, using command queue";
+
+    establish_launcher_cmd_queue(info);
+    send_launcher_cmd(info, command);
+
+    return (pid_t) 0;
+
+  }
+
+  if (!ack.accepted) {
+    throw LauncherFailure("launcher rejected command: " + ack.message);
+  }
+
+  return ack.pid;
+
+}
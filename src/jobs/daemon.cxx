@@ -12,12 +12,22 @@ extern "C" {
 #include <syslog.h>
 #include <string.h>
 #include <signal.h>
+#include <time.h>
+#include <sched.h>
+#include <poll.h>
+#include <stddef.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 }
 
 /* logging */
 #include <boost/log/trivial.hpp>
 #include <istream>
 #include <stack>
+#include <set>
+#include <iomanip>
+#include <thread>
 
 #include <bgrndroletype.hxx>
 #include <daemon.hxx>
@@ -25,9 +35,29 @@ extern "C" {
 #include <commands.hxx>
 #include <reaper.hxx>
 #include <server.hxx>
+#include <scheduler.hxx>
+#include <cmdchannel.hxx>
 
 #define MSG_QUEUE_MAX_TOKEN_SZ 255
 
+/*
+ * Seconds an idle pool worker waits for a command before
+ * it rechecks for shutdown requests and its launcher.
+ */
+#define POOL_WORKER_IDLE_TIMEOUT 1
+
+/*
+ * Milliseconds the launcher waits for the command of a caller
+ * connected to its command channel.
+ */
+#define LAUNCHER_CMD_RECV_TIMEOUT 1000
+
+/*
+ * Minimum interval between two progress messages a worker
+ * sends over the command channel, in nanoseconds.
+ */
+#define WORKER_CHANNEL_PROGRESS_INTERVAL 1000000000LL
+
 using namespace pgbckctl;
 
 volatile sig_atomic_t _pgbckctl_shutdown_mode = DAEMON_RUN;
@@ -38,10 +68,68 @@ extern int errno;
  */
 background_reaper *launcher_reaper = nullptr;
 
+/*
+ * Launcher event sources. The launcher blocks the signals in
+ * launcher_sigmask and receives them through launcher_signal_fd
+ * instead, launcher_wakeup_fd is poked by send_launcher_cmd() whenever
+ * a new command was put into the message queue. Both are -1 in
+ * any process other than the launcher itself.
+ */
+static int launcher_signal_fd = -1;
+static int launcher_wakeup_fd = -1;
+static sigset_t launcher_sigmask;
+static sigset_t launcher_orig_sigmask;
+
+/*
+ * Listening socket of the launcher command channel, see
+ * LauncherCommandChannel. launcher_cmd_pending is set by
+ * launcher_wait_events() if callers are waiting to be accepted.
+ */
+static int launcher_cmd_fd = -1;
+static bool launcher_cmd_pending = false;
+
+/*
+ * Connection to the caller of the command a worker executes, if
+ * it was submitted via the command channel and the caller waits for
+ * it. nullptr otherwise, or if the caller has gone away.
+ */
+static LauncherCommandChannel *worker_channel = nullptr;
+static long long worker_channel_last_progress = 0;
+
+/*
+ * PIDs of the pre-forked pool workers, maintained by the launcher
+ * only. launcher_collect_children() removes exited pool workers, the
+ * launcher loop respawns them. If a pool worker fails during its
+ * setup, launcher_pool_failed is set and the launcher stops
+ * respawning, falling back to a dedicated process per command.
+ */
+static std::set<pid_t> launcher_pool_pids;
+static bool launcher_pool_failed = false;
+
 /*
  * Forwarded declarations.
  */
 static pid_t daemonize(job_info &info);
+static void _pgbckctl_sighandler(int sig);
+static void launcher_collect_children();
+static void launcher_setup_events(job_info &info);
+static void launcher_release_events();
+static bool launcher_wait_events(int timeout);
+static void launcher_wakeup(std::string catalog_name);
+static void launcher_setup_pool(job_info &info);
+static void launcher_fill_pool(BackgroundWorker &worker, job_info &info);
+static void launcher_shutdown_pool(job_info &info);
+static bool launcher_pool_dispatch(job_info &info,
+                                   CatalogTag tag,
+                                   std::string command);
+static CatalogTag launcher_cmd_tag(std::string command);
+static void launcher_serve_channel(BackgroundWorker &worker, job_info &info);
+static void worker_prepare(BackgroundWorker &worker);
+static void worker_channel_progress(worker_instrumentation_item *items);
+static void worker_channel_done(bool success, std::string message);
+static void worker_execute(BackgroundWorker &worker,
+                           std::shared_ptr<BackupCatalog> catalog,
+                           std::string command);
 
 /*
  * Type of background process. Either launcher or worker
@@ -507,11 +595,16 @@ size_t WorkerSHM::calculateSHMsize() {
   /*
    * Calculate the shared memory size.
    *
-   * Make sure we have a segment at least 4K in size.
+   * Make sure we have a segment at least 4K in size. The slot
+   * allocation bitmap needs one bit per worker slot, rounded up
+   * to full 64 bit words.
    *
    */
   return 2 * (sizeof(shm_worker_area) * this->max_workers)
     + sizeof(boost::interprocess::interprocess_mutex)
+    + sizeof(std::atomic<unsigned long long>) * ((this->max_workers + 63) / 64)
+    + sizeof(shm_io_governor)
+    + sizeof(shm_worker_event_log) * this->max_workers
     + ( 4096 - ( (sizeof(shm_worker_area) * this->max_workers)
                  + sizeof(boost::interprocess::interprocess_mutex) ) );
 
@@ -537,6 +630,10 @@ bool WorkerSHM::attach(std::string catalog, bool attach_only) {
   xsi_key key = xsi_key(keystr.str().c_str(), 2);
   std::ostringstream shm_ctl_name;
   std::ostringstream mtx_ctl_name;
+  std::ostringstream gen_ctl_name;
+  std::ostringstream map_ctl_name;
+  std::ostringstream gov_ctl_name;
+  std::ostringstream evt_ctl_name;
 
   /*
    * Calculate requested shared memory size.
@@ -593,6 +690,39 @@ bool WorkerSHM::attach(std::string catalog, bool attach_only) {
 
   this->upper = this->max_workers - 1;
 
+  /*
+   * Slot allocation bitmap. All slots are free initially.
+   */
+  map_ctl_name << catalog << "_slot_map";
+  this->slot_map_words = (this->max_workers + 63) / 64;
+  this->slot_map
+    = this->shm->find_or_construct<std::atomic<unsigned long long>>(map_ctl_name.str().c_str())[this->slot_map_words](0ULL);
+
+  /*
+   * The catalog generation counter lives besides the worker
+   * area. The segment size calculation leaves enough room
+   * for this.
+   */
+  gen_ctl_name << catalog << "_generation";
+  this->generation_ptr
+    = this->shm->find_or_construct<shm_catalog_generation>(gen_ctl_name.str().c_str())();
+
+  /*
+   * I/O governor token buckets. All budgets are unlimited
+   * until the launcher sets them.
+   */
+  gov_ctl_name << catalog << "_governor";
+  this->governor_ptr
+    = this->shm->find_or_construct<shm_io_governor>(gov_ctl_name.str().c_str())();
+
+  /*
+   * Worker event logs, one per slot. They're created empty
+   * once and never cleared afterwards, see reset().
+   */
+  evt_ctl_name << catalog << "_event_log";
+  this->event_log_ptr
+    = this->shm->find_or_construct<shm_worker_event_log>(evt_ctl_name.str().c_str())[this->max_workers]();
+
   /*
    * Don't forget identifiers...
    */
@@ -624,14 +754,12 @@ void WorkerSHM::lock() {
   this->mtx->lock();
 }
 
-void WorkerSHM::write(unsigned int slot_index,
-                      shm_worker_area &item) {
-
-  shm_worker_area *ptr = NULL;
+shm_worker_area *WorkerSHM::slot(unsigned int slot_index) {
 
   if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
-    throw SHMFailure("attempt to write worker slot from uninitialized shared memory");
+       || (this->shm_mem_ptr == nullptr)
+       || (this->slot_map == nullptr)) {
+    throw SHMFailure("attempt to access worker slot in uninitialized shared memory");
   }
 
   /*
@@ -647,29 +775,84 @@ void WorkerSHM::write(unsigned int slot_index,
     throw SHMFailure(oss.str());
   }
 
-  ptr = (shm_worker_area *)(this->shm_mem_ptr + slot_index);
+  return (shm_worker_area *)(this->shm_mem_ptr + slot_index);
+
+}
+
+void WorkerSHM::beginSlotWrite(shm_worker_area *ptr) {
 
-  if (ptr != NULL) {
+  unsigned int seq;
+  unsigned int spins = 0;
 
-    ptr->pid = item.pid;
-    ptr->cmdType = item.cmdType;
-    ptr->archive_id = item.archive_id;
-    ptr->started = item.started;
+  /*
+   * Writers of the same slot (the worker itself, its
+   * children and the launcher) are serialized by switching
+   * the sequence counter from even to odd. Writes are short,
+   * so just spin and yield the CPU from time to time.
+   */
+  while (true) {
+
+    seq = __atomic_load_n(&ptr->seq, __ATOMIC_RELAXED);
+
+    if (!(seq & 1)
+        && __atomic_compare_exchange_n(&ptr->seq, &seq, seq + 1, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      break;
+    }
+
+    if (++spins % 100 == 0)
+      sched_yield();
 
   }
 
+  std::atomic_thread_fence(std::memory_order_release);
+
+}
+
+void WorkerSHM::endSlotWrite(shm_worker_area *ptr) {
+
+  __atomic_add_fetch(&ptr->seq, 1, __ATOMIC_RELEASE);
+
+}
+
+void WorkerSHM::write(unsigned int slot_index,
+                      shm_worker_area &item) {
+
+  shm_worker_area *ptr = this->slot(slot_index);
+
+  this->beginSlotWrite(ptr);
+
+  ptr->pid = item.pid;
+  ptr->cmdType = item.cmdType;
+  ptr->archive_id = item.archive_id;
+  ptr->started = item.started;
+
+  this->endSlotWrite(ptr);
+
 }
 
 bool WorkerSHM::detach_basebackup(unsigned int slot_index,
                                   int child_index) {
 
-  sub_worker_info child_info;
-  shm_worker_area *ptr;
+  shm_worker_area *ptr = this->slot(slot_index);
   bool shortcut_still_valid = false;
 
-  child_info = this->read(slot_index, child_index);
-  child_info.backup_id = -1;
-  this->write(slot_index, child_index, child_info);
+  if ( (child_index < 0)
+       || (child_index >= MAX_WORKER_CHILDS) ) {
+
+    std::ostringstream oss;
+
+    oss << "child slot index "
+        << child_index
+        << " exceeds allowed number of MAX_WORKER_CHILDS="
+        << MAX_WORKER_CHILDS;
+    throw SHMFailure(oss.str());
+
+  }
+
+  this->beginSlotWrite(ptr);
+
+  ptr->child_info[child_index].backup_id = -1;
 
   /*
    * We have to check whether the shortcut basebackup_in_use
@@ -679,8 +862,6 @@ bool WorkerSHM::detach_basebackup(unsigned int slot_index,
    * there are still basebackups attached. We modify the
    * basebackup_is_use flag in place.
    */
-  ptr = (shm_worker_area *) (this->shm_mem_ptr + slot_index);
-
   for(unsigned int idx = 0; idx < MAX_WORKER_CHILDS; idx++) {
 
     /* As soon as we found an active basebackup, we're done */
@@ -694,7 +875,10 @@ bool WorkerSHM::detach_basebackup(unsigned int slot_index,
   }
 
   ptr->basebackup_in_use = shortcut_still_valid;
-  return ptr->basebackup_in_use;
+
+  this->endSlotWrite(ptr);
+
+  return shortcut_still_valid;
 
 }
 
@@ -702,27 +886,22 @@ void WorkerSHM::write(unsigned int slot_index,
                       int &child_index,
                       sub_worker_info &child_info) {
 
-  shm_worker_area *ptr = NULL;
+  shm_worker_area *ptr = this->slot(slot_index);
 
-  if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
-    throw SHMFailure("attempt to write worker slot from uninitialized shared memory");
-  }
+  /* We want to modify an existing one, check the index */
+  if (child_index >= MAX_WORKER_CHILDS) {
 
-  /*
-   * Reference the worker slot at the
-   * specified slot_index. If slot_index is larger
-   * than our upper index, throw.
-   */
-  if (slot_index > this->upper) {
-    ostringstream oss;
+    std::ostringstream oss;
 
-    oss << "requested slot index " << slot_index
-        << " exceeds shared memory upper limit";
+    oss << "child slot index "
+        << child_index
+        << " exceeds allowed number of MAX_WORKER_CHILDS="
+        << MAX_WORKER_CHILDS;
     throw SHMFailure(oss.str());
+
   }
 
-  ptr = (shm_worker_area *)(this->shm_mem_ptr + slot_index);
+  this->beginSlotWrite(ptr);
 
   /*
    * Check if child_index is a valid new index. If set to -1, we treat
@@ -753,68 +932,35 @@ void WorkerSHM::write(unsigned int slot_index,
 
       std::ostringstream oss;
 
+      this->endSlotWrite(ptr);
+
       oss << "could not register sub worker child: out of slots";
       throw SHMFailure(oss.str());
 
     }
 
-    /* Store child information into slot */
-    ptr->child_info[child_index].pid = child_info.pid;
-    ptr->child_info[child_index].backup_id = child_info.backup_id;
-
-    /* Adjust parent slot information, and we're done */
-    if (ptr->child_info[child_index].backup_id != -1)
-      ptr->basebackup_in_use = true;
-
-  } else {
-
-    /* We want to modify an existing one, check the index */
-    if ( (child_index < 0)
-         || (child_index >= MAX_WORKER_CHILDS) ) {
-
-      std::ostringstream oss;
-
-      oss << "child slot index "
-          << child_index
-          << " exceeds allowed number of MAX_WORKER_CHILDS="
-          << MAX_WORKER_CHILDS;
-      throw SHMFailure(oss.str());
-
-    }
+  }
 
-    /* Everything looks sane, modify the entry. */
-    ptr->child_info[child_index].pid = child_info.pid;
-    ptr->child_info[child_index].backup_id = child_info.backup_id;
+  /* Everything looks sane, store child information into slot */
+  ptr->child_info[child_index].pid = child_info.pid;
+  ptr->child_info[child_index].backup_id = child_info.backup_id;
 
-    if (child_info.backup_id != -1)
-      ptr->basebackup_in_use = true;
+  /* Adjust parent slot information, and we're done */
+  if (child_info.backup_id != -1)
+    ptr->basebackup_in_use = true;
 
-    BOOST_LOG_TRIVIAL(debug) << "write child info done";
+  this->endSlotWrite(ptr);
 
-  }
+  BOOST_LOG_TRIVIAL(debug) << "write child info done";
 
 }
 
 bool WorkerSHM::isEmpty(unsigned int slot_index) {
 
-  shm_worker_area *ptr;
-
-  if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
-    throw SHMFailure("attempt to read worker slot from uninitialized shared memory");
-  }
-
-  if (slot_index > this->upper) {
-    ostringstream oss;
-
-    oss << "requested slot index "
-        << slot_index
-        << " exceeds shared memory upper limit";
-    throw SHMFailure(oss.str());
-  }
+  /* validates slot_index */
+  this->slot(slot_index);
 
-  ptr = (shm_worker_area *)(this->shm_mem_ptr + slot_index);
-  return (ptr->pid == 0);
+  return !(this->slot_map[slot_index / 64].load() & (1ULL << (slot_index % 64)));
 
 }
 
@@ -846,38 +992,37 @@ void WorkerSHM::reset() {
 
       }
 
+      for (int instr_index = 0; instr_index < MAX_WORKER_INSTRUMENTATION_SLOTS; instr_index++) {
+        ptr->instr[instr_index] = worker_instrumentation_item();
+      }
+
+      ptr->policy = worker_policy_info();
+
+      /* No worker is attached, so nobody can be within a write */
+      __atomic_store_n(&ptr->seq, 0, __ATOMIC_RELEASE);
+
     }
 
   }
 
+  for (unsigned int i = 0; i < this->slot_map_words; i++) {
+    this->slot_map[i].store(0ULL);
+  }
+
 }
 
 void WorkerSHM::free_child_by_pid(unsigned int slot_index,
                                   pid_t child_pid) {
 
   shm_worker_area *ptr = nullptr;
-  unsigned int free_idx;
-
-  if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
-    throw SHMFailure("attempt to read worker slot from uninitialized shared memory");
-  }
+  int free_idx = -1;
 
   /* PID <= 0 means no-op */
   if (child_pid <= 0)
     return;
 
-  if (slot_index > this->upper) {
-    ostringstream oss;
-
-    oss << "requested slot index "
-        << slot_index
-        << " exceeds shared memory upper limit";
-    throw SHMFailure(oss.str());
-  }
-
   /* Get the worker slot */
-  ptr = (shm_worker_area *)(this->shm_mem_ptr + slot_index);
+  ptr = this->slot(slot_index);
 
   /*
    * We need to search the child_pid
@@ -911,23 +1056,9 @@ void WorkerSHM::free_child(unsigned int slot_index,
                            unsigned int child_index) {
 
   unsigned int free_child_index = child_index;
-  shm_worker_area *ptr = nullptr;
+  shm_worker_area *ptr = this->slot(slot_index);
   bool basebackup_in_use = false;
 
-  if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
-    throw SHMFailure("attempt to read worker slot from uninitialized shared memory");
-  }
-
-  if (slot_index > this->upper) {
-    ostringstream oss;
-
-    oss << "requested slot index "
-        << slot_index
-        << " exceeds shared memory upper limit";
-    throw SHMFailure(oss.str());
-  }
-
   if (free_child_index >= MAX_WORKER_CHILDS) {
 
     std::ostringstream oss;
@@ -941,15 +1072,9 @@ void WorkerSHM::free_child(unsigned int slot_index,
 
   }
 
-  /* Get the worker slot */
-  ptr = (shm_worker_area *)(this->shm_mem_ptr + slot_index);
+  this->beginSlotWrite(ptr);
 
-  /*
-   * Since we might call this method lockless,
-   * make sure the pid stays the first modification here.
-   */
   ptr->child_info[free_child_index].pid = 0;
-
   ptr->child_info[free_child_index].backup_id = -1;
 
   /*
@@ -960,7 +1085,7 @@ void WorkerSHM::free_child(unsigned int slot_index,
   for (unsigned int idx = 0; idx < MAX_WORKER_CHILDS; idx++) {
 
     if (ptr->child_info[idx].backup_id >= 0) {
-      ptr->basebackup_in_use = true;
+      basebackup_in_use = true;
 
       /* exit, since we have the info we need */
       break;
@@ -970,27 +1095,15 @@ void WorkerSHM::free_child(unsigned int slot_index,
 
   ptr->basebackup_in_use = basebackup_in_use;
 
+  this->endSlotWrite(ptr);
+
 }
 
 void WorkerSHM::free(unsigned int slot_index) {
 
-  shm_worker_area *ptr;
-
-  if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
-    throw SHMFailure("attempt to read worker slot from uninitialized shared memory");
-  }
-
-  if (slot_index > this->upper) {
-    ostringstream oss;
-
-    oss << "requested slot index "
-        << slot_index
-        << " exceeds shared memory upper limit";
-    throw SHMFailure(oss.str());
-  }
+  shm_worker_area *ptr = this->slot(slot_index);
 
-  ptr = (shm_worker_area *)(this->shm_mem_ptr + slot_index);
+  this->beginSlotWrite(ptr);
 
   ptr->pid = 0;
   ptr->cmdType = EMPTY_DESCR;
@@ -1005,43 +1118,108 @@ void WorkerSHM::free(unsigned int slot_index) {
 
   }
 
-  this->allocated--;
+  /*
+   * Clear instrumentation, too.
+   */
+  for (int instr_index = 0; instr_index < MAX_WORKER_INSTRUMENTATION_SLOTS; instr_index++) {
+    ptr->instr[instr_index] = worker_instrumentation_item();
+  }
+
+  this->endSlotWrite(ptr);
+
+  /*
+   * Release the slot only after it was cleared, so that
+   * a concurrent allocate() never sees stale contents.
+   */
+  this->slot_map[slot_index / 64].fetch_and(~(1ULL << (slot_index % 64)));
+
+  if (this->allocated > 0)
+    this->allocated--;
 
 }
 
-unsigned int WorkerSHM::allocate(shm_worker_area &item) {
+void WorkerSHM::reclaim(unsigned int slot_index) {
+
+  shm_worker_area *ptr = this->slot(slot_index);
+  unsigned int seq = __atomic_load_n(&ptr->seq, __ATOMIC_ACQUIRE);
 
-  unsigned int result = 0;
+  /*
+   * If the former owner died within a write section, the
+   * counter stays odd forever. Make it even again, the
+   * slot contents are discarded by free() anyways.
+   */
+  if (seq & 1)
+    __atomic_compare_exchange_n(&ptr->seq, &seq, seq + 1, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+
+  this->free(slot_index);
+
+}
+
+unsigned int WorkerSHM::allocate(shm_worker_area &item) {
 
   if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
+       || (this->shm_mem_ptr == nullptr)
+       || (this->slot_map == nullptr)) {
     throw SHMFailure("attempt to read worker slot from uninitialized shared memory");
   }
 
-  result = this->getFreeIndex();
-  this->write(result, item);
-  this->allocated++;
+  /*
+   * Claim the first free bit in the slot allocation bitmap. A failed
+   * CAS reloads the current word, so we just retry with the next
+   * free bit of it until the word is exhausted.
+   */
+  for (unsigned int word = 0; word < this->slot_map_words; word++) {
 
-  return result;
+    unsigned long long bits = this->slot_map[word].load();
+
+    while (~bits != 0ULL) {
+
+      unsigned int bit = __builtin_ctzll(~bits);
+      unsigned int result = word * 64 + bit;
+
+      /* Bits beyond max_workers are never used */
+      if (result > this->upper)
+        break;
+
+      if (this->slot_map[word].compare_exchange_weak(bits, bits | (1ULL << bit))) {
+
+        this->write(result, item);
+        this->allocated++;
+
+        return result;
+
+      }
+
+    }
+
+  }
+
+  throw SHMFailure("no worker slot available");
 
 }
 
 unsigned int WorkerSHM::getFreeIndex() {
 
-  shm_worker_area *ptr = nullptr;
-
   if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
+       || (this->shm_mem_ptr == nullptr)
+       || (this->slot_map == nullptr)) {
     throw SHMFailure("attempt to read worker slot from uninitialized shared memory");
   }
 
-  for (unsigned int i = 0; i <= this->upper; i++) {
+  for (unsigned int word = 0; word < this->slot_map_words; word++) {
 
-    ptr = (shm_worker_area *)(this->shm_mem_ptr + i);
+    unsigned long long bits = this->slot_map[word].load();
+
+    if (~bits != 0ULL) {
+
+      unsigned int result = word * 64 + __builtin_ctzll(~bits);
+
+      if (result <= this->upper)
+        return result;
 
-    if (ptr->pid == 0) {
-      return i;
     }
+
   }
 
   throw SHMFailure("no worker slot available");
@@ -1050,93 +1228,79 @@ unsigned int WorkerSHM::getFreeIndex() {
 
 sub_worker_info WorkerSHM::read(unsigned int slot_index,
                                 unsigned int child_index) {
-  shm_worker_area *ptr = NULL;
-  sub_worker_info result;
 
-  if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
-    throw SHMFailure("attempt to write worker slot from uninitialized shared memory");
+  if (child_index >= MAX_WORKER_CHILDS) {
+
+    std::ostringstream oss;
+
+    oss << "child slot index("
+        << child_index
+        << ") out of bounds";
+    throw SHMFailure(oss.str());
+
   }
 
   /*
-   * Reference the worker slot at the
-   * specified slot_index. If slot_index is larger
-   * than our upper index, throw.
+   * Extract child info slot information from a
+   * consistent copy of the worker slot.
    */
-  if (slot_index > this->upper) {
-    ostringstream oss;
+  return this->read(slot_index).child_info[child_index];
 
-    oss << "requested slot index " << slot_index
-        << " exceeds shared memory upper limit";
-    throw SHMFailure(oss.str());
-  }
+}
+
+shm_worker_area WorkerSHM::read(unsigned int slot_index) {
 
-  ptr = (shm_worker_area *)(this->shm_mem_ptr + slot_index);
+  shm_worker_area result;
+  shm_worker_area *ptr = this->slot(slot_index);
+  unsigned int seq_before;
+  unsigned int seq_after;
+  unsigned int spins = 0;
 
-  /**
-   * Extract child info slot information, if valid
-   * child_index present.
+  /*
+   * Copy the slot without blocking any writer. If the sequence
+   * counter was odd or changed while copying, a writer was
+   * active and we try again.
    */
-  if (ptr != NULL) {
+  while (true) {
 
-    if (child_index >= 0 || child_index < MAX_WORKER_CHILDS) {
+    seq_before = __atomic_load_n(&ptr->seq, __ATOMIC_ACQUIRE);
 
-      /* Copy information and we're done */
-      result = ptr->child_info[child_index];
+    if (!(seq_before & 1)) {
 
-    } else {
+      result = (*ptr);
 
-      std::ostringstream oss;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      seq_after = __atomic_load_n(&ptr->seq, __ATOMIC_RELAXED);
 
-      oss << "child slot index("
-          << child_index
-          << ") out of bounds";
-      SHMFailure(oss.str());
+      if (seq_before == seq_after)
+        break;
 
     }
 
+    if (++spins % 100 == 0)
+      sched_yield();
+
   }
 
   return result;
 
 }
 
-shm_worker_area WorkerSHM::read(unsigned int slot_index) {
+void WorkerSHM::detach() {
 
-  shm_worker_area result;
-  shm_worker_area *ptr;
+  if (this->shm != nullptr) {
 
-  if ( (this->shm == nullptr)
-       || (this->shm_mem_ptr == nullptr)) {
-    throw SHMFailure("attempt to read worker slot from uninitialized shared memory");
-  }
-
-  if (slot_index > this->upper) {
-    ostringstream oss;
-
-    oss << "requested slot index "
-        << slot_index
-        << " exceeds shared memory upper limit";
-    throw SHMFailure(oss.str());
-  }
-
-  ptr = (shm_worker_area *)(this->shm_mem_ptr + slot_index);
-  result = (*ptr);
-
-  return result;
-
-}
-
-void WorkerSHM::detach() {
-
-  if (this->shm != nullptr) {
-
-    /*
-     * Local pointers are NULL now.
-     */
-    this->upper = 0;
-    this->mtx = nullptr;
-    this->shm_mem_ptr = nullptr;
+    /*
+     * Local pointers are NULL now.
+     */
+    this->upper = 0;
+    this->mtx = nullptr;
+    this->shm_mem_ptr = nullptr;
+    this->slot_map = nullptr;
+    this->slot_map_words = 0;
+    this->generation_ptr = nullptr;
+    this->governor_ptr = nullptr;
+    this->event_log_ptr = nullptr;
 
     /*
      * Now detach. We don't remove it
@@ -1174,6 +1338,555 @@ size_t WorkerSHM::getSize() {
 
 }
 
+unsigned long long WorkerSHM::getCatalogGeneration() {
+
+  if (this->generation_ptr == nullptr) {
+    throw SHMFailure("attempt to read catalog generation from uninitialized shared memory");
+  }
+
+  return this->generation_ptr->generation.load();
+
+}
+
+unsigned long long WorkerSHM::bumpCatalogGeneration() {
+
+  if (this->generation_ptr == nullptr) {
+    throw SHMFailure("attempt to advance catalog generation in uninitialized shared memory");
+  }
+
+  return this->generation_ptr->generation.fetch_add(1) + 1;
+
+}
+
+void WorkerSHM::setIOBudget(IOGovernorClass bucket,
+                            unsigned long long rate) {
+
+  if (this->governor_ptr == nullptr) {
+    throw SHMFailure("attempt to set I/O budget in uninitialized shared memory");
+  }
+
+  this->governor_ptr->bucket[bucket].rate.store(rate);
+  this->governor_ptr->bucket[bucket].tat.store(0);
+
+}
+
+unsigned long long WorkerSHM::getIOBudget(IOGovernorClass bucket) {
+
+  if (this->governor_ptr == nullptr) {
+    throw SHMFailure("attempt to read I/O budget from uninitialized shared memory");
+  }
+
+  return this->governor_ptr->bucket[bucket].rate.load();
+
+}
+
+long long WorkerSHM::chargeIO(IOGovernorClass bucket,
+                              unsigned long long bytes,
+                              long long now,
+                              bool borrow) {
+
+  if (this->governor_ptr == nullptr) {
+    throw SHMFailure("attempt to charge I/O budget in uninitialized shared memory");
+  }
+
+  shm_io_bucket *ptr = &(this->governor_ptr->bucket[bucket]);
+  unsigned long long rate = ptr->rate.load();
+
+  if (rate == 0)
+    return now;
+
+  long long cost = (long long) ((double) bytes * 1000000000.0 / (double) rate);
+  long long tat = ptr->tat.load();
+  long long new_tat;
+
+  /*
+   * An idle bucket is full, but never holds more than
+   * BURST_NSEC worth of budget. Borrowing never shortens
+   * reservations made by others, it just stops adding debt
+   * beyond BURST_NSEC. A failed CAS reloads tat, so just retry
+   * with what the concurrent caller left.
+   */
+  do {
+
+    new_tat = std::max(tat, now - IOGovernor::BURST_NSEC) + cost;
+
+    if (borrow)
+      new_tat = std::max(tat, std::min(new_tat, now + IOGovernor::BURST_NSEC));
+
+  } while (!ptr->tat.compare_exchange_weak(tat, new_tat));
+
+  return new_tat;
+
+}
+
+void WorkerSHM::writeInstrumentation(unsigned int slot_index,
+                                     worker_instrumentation_item *items) {
+
+  shm_worker_area *ptr = this->slot(slot_index);
+
+  this->beginSlotWrite(ptr);
+
+  for (unsigned int i = 0; i < MAX_WORKER_INSTRUMENTATION_SLOTS; i++) {
+    ptr->instr[i] = items[i];
+  }
+
+  this->endSlotWrite(ptr);
+
+}
+
+void WorkerSHM::readInstrumentation(unsigned int slot_index,
+                                    worker_instrumentation_item *items) {
+
+  shm_worker_area copy = this->read(slot_index);
+
+  for (unsigned int i = 0; i < MAX_WORKER_INSTRUMENTATION_SLOTS; i++) {
+    items[i] = copy.instr[i];
+  }
+
+}
+
+void WorkerSHM::recordEvent(unsigned int slot_index,
+                            WorkerEventId event,
+                            long long arg0,
+                            long long arg1,
+                            long long arg2) {
+
+  shm_worker_event_log *log;
+  shm_worker_event *rec;
+  unsigned long long pos;
+  struct timespec ts;
+
+  this->slot(slot_index);
+
+  if (this->event_log_ptr == nullptr) {
+    throw SHMFailure("attempt to record worker event in uninitialized shared memory");
+  }
+
+  log = this->event_log_ptr + slot_index;
+
+  /*
+   * Claim the next record. Invalidate it before its
+   * fields are overwritten, so readers don't take a half
+   * written copy.
+   */
+  pos = log->next.fetch_add(1);
+  rec = &(log->events[pos % WORKER_EVENT_LOG_SIZE]);
+
+  rec->seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+
+  rec->timestamp = (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+  rec->pid = ::getpid();
+  rec->event = event;
+  rec->args[0] = arg0;
+  rec->args[1] = arg1;
+  rec->args[2] = arg2;
+
+  rec->seq.store(pos + 1, std::memory_order_release);
+
+}
+
+std::vector<worker_event> WorkerSHM::readEvents(unsigned int slot_index) {
+
+  std::vector<worker_event> result;
+  shm_worker_event_log *log;
+  unsigned long long next;
+  unsigned long long pos;
+
+  this->slot(slot_index);
+
+  if (this->event_log_ptr == nullptr) {
+    throw SHMFailure("attempt to read worker events from uninitialized shared memory");
+  }
+
+  log = this->event_log_ptr + slot_index;
+  next = log->next.load();
+  pos = (next > WORKER_EVENT_LOG_SIZE) ? next - WORKER_EVENT_LOG_SIZE : 0;
+
+  for (; pos < next; pos++) {
+
+    shm_worker_event *rec = &(log->events[pos % WORKER_EVENT_LOG_SIZE]);
+    worker_event copy;
+
+    copy.seq = rec->seq.load(std::memory_order_acquire);
+
+    /* still written or already overwritten by a newer event */
+    if (copy.seq != pos + 1)
+      continue;
+
+    copy.slot = slot_index;
+    copy.timestamp = rec->timestamp;
+    copy.pid = rec->pid;
+    copy.event = rec->event;
+
+    for (unsigned int i = 0; i < WORKER_EVENT_ARGS; i++)
+      copy.args[i] = rec->args[i];
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (rec->seq.load(std::memory_order_relaxed) != copy.seq)
+      continue;
+
+    result.push_back(copy);
+
+  }
+
+  return result;
+
+}
+
+/******************************************************************************
+ * InstrumentationRate implementation
+ ******************************************************************************/
+
+InstrumentationRate::InstrumentationRate() {
+
+  this->last_tick = std::chrono::steady_clock::now();
+
+}
+
+void InstrumentationRate::add(unsigned long long n) {
+
+  this->count += n;
+
+}
+
+bool InstrumentationRate::tick() {
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  long long elapsed_usec
+    = std::chrono::duration_cast<std::chrono::microseconds>(now - this->last_tick).count();
+
+  if (elapsed_usec < 1000000)
+    return false;
+
+  this->per_sec = (long long) ((this->count - this->last_count) * 1000000ULL / elapsed_usec);
+  this->last_count = this->count;
+  this->last_tick = now;
+
+  return true;
+
+}
+
+long long InstrumentationRate::rate() {
+
+  return this->per_sec;
+
+}
+
+unsigned long long InstrumentationRate::total() {
+
+  return this->count;
+
+}
+
+void InstrumentationRate::reset() {
+
+  this->count = this->last_count = 0;
+  this->per_sec = 0;
+  this->last_tick = std::chrono::steady_clock::now();
+
+}
+
+/******************************************************************************
+ * WorkerInstrumentation implementation
+ ******************************************************************************/
+
+/*
+ * Formats an LSN published by a worker as an XLOG position.
+ */
+static std::string lsn_string(long long value) {
+
+  std::ostringstream oss;
+
+  oss << std::uppercase << std::hex
+      << (unsigned int) ((unsigned long long) value >> 32)
+      << "/"
+      << (unsigned int) value;
+
+  return oss.str();
+
+}
+
+WorkerInstrumentation::WorkerInstrumentation(std::shared_ptr<WorkerSHM> shm,
+                                             unsigned int slot_index) {
+
+  if (shm == nullptr) {
+    throw SHMFailure("worker instrumentation requires a worker shared memory handle");
+  }
+
+  this->shm = shm;
+  this->slot_index = slot_index;
+
+}
+
+WorkerInstrumentation::~WorkerInstrumentation() {}
+
+void WorkerInstrumentation::set(unsigned int index,
+                                WorkerInstrumentationKey key,
+                                long long value) {
+
+  if (index >= MAX_WORKER_INSTRUMENTATION_SLOTS) {
+    std::ostringstream oss;
+
+    oss << "instrumentation index " << index
+        << " exceeds MAX_WORKER_INSTRUMENTATION_SLOTS="
+        << MAX_WORKER_INSTRUMENTATION_SLOTS;
+    throw SHMFailure(oss.str());
+  }
+
+  /*
+   * Remember when an item started to carry the current key.
+   */
+  if (this->items[index].key != key) {
+    this->items[index].key = key;
+    this->items[index].start_time = boost::posix_time::microsec_clock::local_time();
+  }
+
+  this->items[index].value = value;
+
+}
+
+void WorkerInstrumentation::publish() {
+
+  this->shm->writeInstrumentation(this->slot_index, this->items);
+  worker_channel_progress(this->items);
+
+}
+
+std::string WorkerInstrumentation::keyName(int key) {
+
+  switch(key) {
+  case INSTR_WAL_RECEIVED_LSN:
+    return "wal received lsn";
+  case INSTR_WAL_FLUSHED_LSN:
+    return "wal flushed lsn";
+  case INSTR_WAL_BYTES_PER_SEC:
+    return "wal bytes/s";
+  case INSTR_WAL_MSGS_PER_SEC:
+    return "wal messages/s";
+  case INSTR_WAL_FSYNC_USEC:
+    return "wal fsync latency";
+  case INSTR_BASEBACKUP_TABLESPACE_OID:
+    return "tablespace oid";
+  case INSTR_BASEBACKUP_TABLESPACE_BYTES:
+    return "tablespace bytes";
+  case INSTR_BASEBACKUP_BYTES_PER_SEC:
+    return "basebackup bytes/s";
+  case INSTR_BASEBACKUP_COMPRESSION_RATIO:
+    return "compression ratio";
+  case INSTR_BASEBACKUP_WRITE_QUEUE_DEPTH:
+    return "write queue depth";
+  case INSTR_BASEBACKUP_RECEIVER_STALL_MSEC:
+    return "receiver stall";
+  case INSTR_BASEBACKUP_WRITER_IDLE_MSEC:
+    return "writer idle";
+  default:
+    return "";
+  }
+
+}
+
+std::string WorkerInstrumentation::valueString(worker_instrumentation_item &item) {
+
+  std::ostringstream oss;
+
+  switch(item.key) {
+  case INSTR_WAL_RECEIVED_LSN:
+  case INSTR_WAL_FLUSHED_LSN:
+    oss << lsn_string(item.value);
+    break;
+  case INSTR_WAL_FSYNC_USEC:
+    oss << item.value << "us";
+    break;
+  case INSTR_BASEBACKUP_RECEIVER_STALL_MSEC:
+  case INSTR_BASEBACKUP_WRITER_IDLE_MSEC:
+    oss << item.value << "ms";
+    break;
+  case INSTR_BASEBACKUP_COMPRESSION_RATIO:
+    /* stored in hundredths */
+    oss << item.value / 100 << "."
+        << std::setw(2) << std::setfill('0') << item.value % 100;
+    break;
+  default:
+    oss << item.value;
+    break;
+  }
+
+  return oss.str();
+
+}
+
+/******************************************************************************
+ * WorkerEventLog implementation
+ ******************************************************************************/
+
+WorkerEventLog::WorkerEventLog(std::shared_ptr<WorkerSHM> shm,
+                               unsigned int slot_index) {
+
+  if (shm == nullptr) {
+    throw SHMFailure("worker event log requires a worker shared memory handle");
+  }
+
+  this->shm = shm;
+  this->slot_index = slot_index;
+
+}
+
+WorkerEventLog::~WorkerEventLog() {}
+
+void WorkerEventLog::record(WorkerEventId event,
+                            long long arg0,
+                            long long arg1,
+                            long long arg2) {
+
+  this->shm->recordEvent(this->slot_index, event, arg0, arg1, arg2);
+
+}
+
+std::string WorkerEventLog::eventName(int event) {
+
+  switch(event) {
+  case EVT_WORKER_START:
+    return "worker start";
+  case EVT_WORKER_EXIT:
+    return "worker exit";
+  case EVT_WAL_STREAM_START:
+    return "wal stream start";
+  case EVT_WAL_DATA:
+    return "wal data";
+  case EVT_WAL_SEGMENT_DONE:
+    return "wal segment done";
+  case EVT_WAL_STATUS_UPDATE:
+    return "wal status update";
+  case EVT_WAL_KEEPALIVE:
+    return "wal keepalive";
+  case EVT_WAL_STREAM_END:
+    return "wal stream end";
+  case EVT_BASEBACKUP_START:
+    return "basebackup start";
+  case EVT_BASEBACKUP_TABLESPACE:
+    return "basebackup tablespace";
+  case EVT_BASEBACKUP_END:
+    return "basebackup end";
+  default:
+    return "";
+  }
+
+}
+
+std::string WorkerEventLog::argsString(worker_event &event) {
+
+  std::ostringstream oss;
+
+  switch(event.event) {
+  case EVT_WORKER_START:
+    oss << "command=" << CatalogDescr::commandTagName((CatalogTag) event.args[0])
+        << " archive_id=" << event.args[1];
+    break;
+  case EVT_WORKER_EXIT:
+    oss << "success=" << event.args[0];
+    break;
+  case EVT_WAL_STREAM_START:
+  case EVT_BASEBACKUP_START:
+    oss << "start=" << lsn_string(event.args[0])
+        << " timeline=" << event.args[1];
+    break;
+  case EVT_WAL_DATA:
+    oss << "start=" << lsn_string(event.args[0])
+        << " length=" << event.args[1]
+        << " server=" << lsn_string(event.args[2]);
+    break;
+  case EVT_WAL_SEGMENT_DONE:
+    oss << "flush=" << lsn_string(event.args[0])
+        << " timeline=" << event.args[1];
+    break;
+  case EVT_WAL_STATUS_UPDATE:
+    oss << "write=" << lsn_string(event.args[0])
+        << " flush=" << lsn_string(event.args[1])
+        << " apply=" << lsn_string(event.args[2]);
+    break;
+  case EVT_WAL_KEEPALIVE:
+    oss << "reply_requested=" << event.args[0];
+    break;
+  case EVT_WAL_STREAM_END:
+    oss << "state=" << event.args[0]
+        << " write=" << lsn_string(event.args[1])
+        << " timeline=" << event.args[2];
+    break;
+  case EVT_BASEBACKUP_TABLESPACE:
+    oss << "oid=" << event.args[0]
+        << " size=" << event.args[1];
+    break;
+  case EVT_BASEBACKUP_END:
+    oss << "end=" << lsn_string(event.args[0]);
+    break;
+  default:
+    oss << event.args[0] << " " << event.args[1] << " " << event.args[2];
+    break;
+  }
+
+  return oss.str();
+
+}
+
+/******************************************************************************
+ * IOGovernor implementation
+ ******************************************************************************/
+
+IOGovernor::IOGovernor(std::shared_ptr<WorkerSHM> shm,
+                       IOGovernorClass job_class) {
+
+  if (shm == nullptr) {
+    throw SHMFailure("I/O governor requires a worker shared memory handle");
+  }
+
+  if (job_class == IO_CLASS_TOTAL) {
+    throw SHMFailure("invalid I/O governor job class");
+  }
+
+  this->shm = shm;
+  this->job_class = job_class;
+
+}
+
+IOGovernor::~IOGovernor() {}
+
+long long IOGovernor::now() {
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+}
+
+void IOGovernor::acquire(size_t bytes) {
+
+  long long start = IOGovernor::now();
+  long long until;
+
+  if (this->job_class == IO_CLASS_WAL) {
+
+    /*
+     * WAL streamers only wait for their class budget, but
+     * overdraw the host wide budget, which holds back
+     * everyone else.
+     */
+    until = this->shm->chargeIO(IO_CLASS_WAL, bytes, start, false);
+    this->shm->chargeIO(IO_CLASS_TOTAL, bytes, start, true);
+
+  } else {
+
+    until = std::max(this->shm->chargeIO(this->job_class, bytes, start, false),
+                     this->shm->chargeIO(IO_CLASS_TOTAL, bytes, start, false));
+
+  }
+
+  if (until > start)
+    std::this_thread::sleep_for(std::chrono::nanoseconds(until - start));
+
+}
+
 /******************************************************************************
  * LauncherSHM & objects implementation start
  ******************************************************************************/
@@ -1308,14 +2021,45 @@ pid_t LauncherSHM::setPID(pid_t pid) {
 
 static void _pgbckctl_sigchld_handler(int sig) {
 
-  pid_t pid;
-  int   wait_status;
-
   /* Only react on SIGCHLD */
   if (sig != SIGCHLD)
     return;
 
-  while ((pid = waitpid(-1, &wait_status, WNOHANG)) != -1) {
+  launcher_collect_children();
+
+}
+
+/*
+ * Collects all exited children of the current process.
+ *
+ * In the launcher this isn't called from the SIGCHLD handler, since the
+ * launcher blocks SIGCHLD and reads it from its signalfd instead. This
+ * makes it safe to push dead PIDs onto the reaper stack here.
+ */
+static void launcher_collect_children() {
+
+  pid_t pid;
+  int   wait_status;
+
+  /*
+   * Pending SIGCHLD signals are merged, so make sure
+   * we collect every child which has exited so far.
+   */
+  while ((pid = waitpid(-1, &wait_status, WNOHANG)) > 0) {
+
+    /*
+     * Exited pool workers are respawned by the launcher loop,
+     * unless they didn't even get through their setup.
+     */
+    if ( (_pgbckctl_job_type == BACKGROUND_LAUNCHER)
+         && (launcher_pool_pids.erase(pid) > 0) ) {
+
+      if (WIFEXITED(wait_status)
+          && WEXITSTATUS(wait_status) == DAEMON_FAILURE) {
+        launcher_pool_failed = true;
+      }
+
+    }
 
     if (WIFSIGNALED(wait_status)) {
 
@@ -1344,8 +2088,8 @@ static void _pgbckctl_sigchld_handler(int sig) {
            * This child PID died an horrible death, we need
            * to reap it out from the shared memory segment.
            *
-           * We can't do this here, since the signal handlers
-           * don't have access to the internal worker handlers. Instead,
+           * We can't do this here, since we don't have
+           * access to the internal worker handlers. Instead,
            * we use a stack to remember dead pids and reap them out
            * during command processing in the launcher itself. The
            * launcher is then responsible to clear the corresponding
@@ -1353,19 +2097,588 @@ static void _pgbckctl_sigchld_handler(int sig) {
            */
           launcher_reaper->dead_pids.push(pid);
 
-        }
+        }
+
+      }
+
+    }
+
+  }
+
+}
+
+/*
+ * Returns the abstract unix socket address the launcher of
+ * the given catalog listens on for wakeup notifications.
+ */
+static socklen_t launcher_wakeup_address(std::string catalog_name,
+                                         struct sockaddr_un &addr) {
+
+  std::string name = "pg_backup_ctl::launcher_wakeup::" + catalog_name;
+
+  memset(&addr, 0, sizeof(struct sockaddr_un));
+  addr.sun_family = AF_UNIX;
+
+  /*
+   * Leading NUL byte marks the abstract namespace, so there
+   * is no socket file to be cleaned up after a crash. Overlong
+   * names are truncated, same as with the message queue they
+   * only need to be unique per catalog.
+   */
+  if (name.length() > sizeof(addr.sun_path) - 1)
+    name = name.substr(0, sizeof(addr.sun_path) - 1);
+
+  memcpy(addr.sun_path + 1, name.data(), name.length());
+
+  return (socklen_t) (offsetof(struct sockaddr_un, sun_path) + 1 + name.length());
+
+}
+
+/*
+ * Prepares the event sources of the launcher process.
+ *
+ * Blocks all signals the launcher is interested in and routes them
+ * through a signalfd, and binds the wakeup socket for
+ * send_launcher_cmd(). Signals delivered before are already
+ * handled by the regular signal handlers, commands sent before
+ * are still in the message queue, so nothing gets lost here.
+ *
+ * Also starts listening on the command channel. Callers trying
+ * to connect before fall back to the message queue.
+ */
+static void launcher_setup_events(job_info &info) {
+
+  struct sockaddr_un addr;
+  socklen_t addrlen;
+
+  sigemptyset(&launcher_sigmask);
+  sigaddset(&launcher_sigmask, SIGCHLD);
+  sigaddset(&launcher_sigmask, SIGTERM);
+  sigaddset(&launcher_sigmask, SIGINT);
+  sigaddset(&launcher_sigmask, SIGQUIT);
+  sigaddset(&launcher_sigmask, SIGHUP);
+  sigaddset(&launcher_sigmask, SIGUSR1);
+
+  if (sigprocmask(SIG_BLOCK, &launcher_sigmask, &launcher_orig_sigmask) < 0) {
+    std::ostringstream oss;
+    oss << "could not block launcher signals: " << strerror(errno);
+    throw LauncherFailure(oss.str());
+  }
+
+  launcher_signal_fd = signalfd(-1, &launcher_sigmask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  if (launcher_signal_fd < 0) {
+    std::ostringstream oss;
+    oss << "could not create launcher signalfd: " << strerror(errno);
+    throw LauncherFailure(oss.str());
+  }
+
+  launcher_wakeup_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+  if (launcher_wakeup_fd < 0) {
+    std::ostringstream oss;
+    oss << "could not create launcher wakeup socket: " << strerror(errno);
+    throw LauncherFailure(oss.str());
+  }
+
+  addrlen = launcher_wakeup_address(info.cmdHandle->getCatalog()->name(), addr);
+
+  if (bind(launcher_wakeup_fd, (struct sockaddr *) &addr, addrlen) < 0) {
+    std::ostringstream oss;
+    oss << "could not bind launcher wakeup socket: " << strerror(errno);
+    throw LauncherFailure(oss.str());
+  }
+
+  launcher_cmd_fd = LauncherCommandChannel::listen(info.cmdHandle->getCatalog()->name());
+
+}
+
+/*
+ * Undoes launcher_setup_events() in a process forked
+ * off from the launcher.
+ */
+static void launcher_release_events() {
+
+  if (launcher_signal_fd >= 0) {
+    ::close(launcher_signal_fd);
+    launcher_signal_fd = -1;
+  }
+
+  if (launcher_wakeup_fd >= 0) {
+    ::close(launcher_wakeup_fd);
+    launcher_wakeup_fd = -1;
+  }
+
+  if (launcher_cmd_fd >= 0) {
+    ::close(launcher_cmd_fd);
+    launcher_cmd_fd = -1;
+  }
+
+  sigprocmask(SIG_SETMASK, &launcher_orig_sigmask, NULL);
+
+}
+
+/*
+ * Pokes the wakeup socket of the launcher of the given catalog.
+ *
+ * Errors are ignored: a launcher not yet listening catches up on
+ * startup, and a full socket buffer means it has a wakeup
+ * pending anyway.
+ */
+static void launcher_wakeup(std::string catalog_name) {
+
+  int wakeup_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+  if (wakeup_fd >= 0) {
+
+    struct sockaddr_un addr;
+    socklen_t addrlen = launcher_wakeup_address(catalog_name, addr);
+    char wakeup = 'w';
+
+    sendto(wakeup_fd, &wakeup, 1, MSG_DONTWAIT, (struct sockaddr *) &addr, addrlen);
+    ::close(wakeup_fd);
+
+  }
+
+}
+
+/*
+ * Blocks until either a signal, a command wakeup or a caller on the
+ * command channel arrives, or timeout seconds have passed. A negative
+ * timeout waits forever.
+ *
+ * Signals other than SIGCHLD are passed to the launcher signal
+ * handler, so _pgbckctl_shutdown_mode reflects them afterwards.
+ * Returns true if children have exited and need to be reaped.
+ */
+static bool launcher_wait_events(int timeout) {
+
+  struct pollfd fds[3];
+  bool reap = false;
+
+  fds[0].fd = launcher_signal_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = launcher_wakeup_fd;
+  fds[1].events = POLLIN;
+  fds[2].fd = launcher_cmd_fd;
+  fds[2].events = POLLIN;
+
+  while (poll(fds, 3, (timeout < 0) ? -1 : timeout * 1000) < 0) {
+
+    if (errno != EINTR) {
+      std::ostringstream oss;
+      oss << "launcher cannot wait for events: " << strerror(errno);
+      throw LauncherFailure(oss.str());
+    }
+
+  }
+
+  if (fds[0].revents & POLLIN) {
+
+    struct signalfd_siginfo si;
+
+    while (::read(launcher_signal_fd, &si, sizeof(si)) == sizeof(si)) {
+
+      if (si.ssi_signo == SIGCHLD)
+        reap = true;
+      else
+        _pgbckctl_sighandler(si.ssi_signo);
+
+    }
+
+  }
+
+  if (fds[1].revents & POLLIN) {
+
+    char buf[16];
+
+    /*
+     * Wakeups don't carry any payload, the commands
+     * themselves are fetched from the message queue.
+     */
+    while (::recv(launcher_wakeup_fd, buf, sizeof(buf), 0) >= 0);
+
+  }
+
+  if (fds[2].revents & POLLIN)
+    launcher_cmd_pending = true;
+
+  return reap;
+
+}
+
+/*
+ * Returns the name of the pool queue of the given catalog.
+ */
+static std::string launcher_pool_queue_name(std::string catalog_name) {
+
+  return "pg_backup_ctl::pool_queue::" + catalog_name;
+
+}
+
+/*
+ * Creates the queue the launcher hands commands over to its
+ * pool workers, if a worker pool was requested. A queue left
+ * over by a crashed launcher is removed before, the commands
+ * still queued there were never acknowledged anyways.
+ */
+static void launcher_setup_pool(job_info &info) {
+
+  using namespace boost::interprocess;
+
+  if (info.worker_pool_size == 0)
+    return;
+
+  std::string queue_name
+    = launcher_pool_queue_name(info.cmdHandle->getCatalog()->name());
+
+  try {
+
+    message_queue::remove(queue_name.c_str());
+    info.pool_queue = new message_queue(create_only,
+                                        queue_name.c_str(),
+                                        255,
+                                        MSG_QUEUE_MAX_TOKEN_SZ);
+
+  } catch(interprocess_exception &e) {
+    throw LauncherFailure(e.what());
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "launcher worker pool size " << info.worker_pool_size;
+
+}
+
+/*
+ * Main routine of a pool worker.
+ *
+ * Pool workers are forked off by the launcher at startup and do
+ * all the per process setup once: they attach to the worker shared
+ * memory and open their own catalog handle. Then they take commands
+ * from the pool queue and execute them one after another, occupying a
+ * worker shared memory slot only while a command is executed.
+ *
+ * Never returns.
+ */
+static void pool_worker_main(BackgroundWorker &worker, job_info &info) {
+
+  using namespace boost::interprocess;
+
+  pid_t launcher_pid = ::getppid();
+  std::shared_ptr<BackupCatalog> catalog = nullptr;
+
+  worker_prepare(worker);
+
+  /*
+   * Setup failures make the launcher stop respawning
+   * pool workers, see launcher_collect_children().
+   */
+  try {
+
+    catalog = std::make_shared<BackupCatalog>(info.cmdHandle->getCatalog()->fullname());
+
+    if (!worker.workerSHM()->attach(catalog->fullname(), true)) {
+      throw WorkerFailure("could not attach to worker shared memory area");
+    }
+
+  } catch(std::exception &e) {
+
+    BOOST_LOG_TRIVIAL(fatal) << "pool worker setup failed: " << e.what();
+    exit(DAEMON_FAILURE);
+
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << "pool worker ready at PID " << ::getpid();
+
+  while ( (_pgbckctl_shutdown_mode != DAEMON_TERM_NORMAL)
+          && (_pgbckctl_shutdown_mode != DAEMON_TERM_EMERGENCY) ) {
+
+    char recvbuffer[MSG_QUEUE_MAX_TOKEN_SZ + 1];
+    message_queue::size_type recv_size;
+    unsigned int prio;
+    bool cmd_ok = false;
+
+    /*
+     * We're of no use without a launcher feeding us.
+     */
+    if (::getppid() != launcher_pid)
+      break;
+
+    try {
+
+      memset(recvbuffer, 0, sizeof(recvbuffer));
+      cmd_ok = info.pool_queue->timed_receive(&recvbuffer,
+                                              MSG_QUEUE_MAX_TOKEN_SZ,
+                                              recv_size,
+                                              prio,
+                                              boost::posix_time::microsec_clock::universal_time()
+                                              + boost::posix_time::seconds(POOL_WORKER_IDLE_TIMEOUT));
+
+    } catch(interprocess_exception &e) {
+
+      BOOST_LOG_TRIVIAL(fatal) << "pool worker cannot receive commands: " << e.what();
+      exit(DAEMON_FAILURE);
+
+    }
+
+    if (!cmd_ok)
+      continue;
+
+    try {
+
+      worker_execute(worker, catalog, std::string(recvbuffer));
+
+    } catch (CParserIssue &pe) {
+
+      BOOST_LOG_TRIVIAL(error) << "parser failed: " << pe.what();
+
+    } catch (std::exception &e) {
+
+      BOOST_LOG_TRIVIAL(error) << "background worker failure: " << e.what();
+
+    }
+
+    /*
+     * Children forked by the command itself must
+     * not continue as a pool worker.
+     */
+    if (_pgbckctl_job_type == BACKGROUND_WORKER_CHILD)
+      exit(0);
+
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << "pool worker exiting";
+  exit(0);
+
+}
+
+/*
+ * Forks pool workers until the requested pool size is reached.
+ */
+static void launcher_fill_pool(BackgroundWorker &worker, job_info &info) {
+
+  if (info.pool_queue == nullptr || launcher_pool_failed)
+    return;
+
+  while (launcher_pool_pids.size() < info.worker_pool_size) {
+
+    pid_t pid = fork();
+
+    if (pid < (pid_t) 0) {
+
+      /*
+       * Not fatal, we retry with the next event and
+       * fork dedicated workers meanwhile.
+       */
+      BOOST_LOG_TRIVIAL(error) << "could not fork pool worker: " << strerror(errno);
+      return;
+
+    }
+
+    if (pid == (pid_t) 0) {
+      pool_worker_main(worker, info);
+    }
+
+    launcher_pool_pids.insert(pid);
+    BOOST_LOG_TRIVIAL(info) << "launcher forked pool worker at PID " << pid;
+
+  }
+
+}
+
+/*
+ * Terminates all pool workers and removes the pool queue.
+ */
+static void launcher_shutdown_pool(job_info &info) {
+
+  if (info.pool_queue == nullptr)
+    return;
+
+  for (auto &pid : launcher_pool_pids) {
+    kill(pid, SIGTERM);
+  }
+
+  delete info.pool_queue;
+  info.pool_queue = nullptr;
+
+  boost::interprocess::message_queue::remove(launcher_pool_queue_name(info.cmdHandle->getCatalog()->name()).c_str());
+
+}
+
+/*
+ * Hands the specified command with the given command tag over to
+ * the worker pool.
+ *
+ * Returns false if the command should be executed by a dedicated
+ * worker process instead. This is the case for long running commands,
+ * which would occupy a pool worker forever, and if there's no pool
+ * or it's saturated. Commands with an unknown tag are passed to a
+ * dedicated worker, too, which reports the error.
+ */
+static bool launcher_pool_dispatch(job_info &info,
+                                   CatalogTag tag,
+                                   std::string command) {
+
+  if (info.pool_queue == nullptr || launcher_pool_pids.empty())
+    return false;
+
+  switch(tag) {
+
+  case EMPTY_DESCR:
+  case START_BASEBACKUP:
+  case START_LAUNCHER:
+  case START_STREAMING_FOR_ARCHIVE:
+  case START_RECOVERY_STREAM_FOR_ARCHIVE:
+  case START_METRICS_SERVER:
+    return false;
+
+  default:
+    break;
+
+  }
+
+  try {
+    return info.pool_queue->try_send(command.data(), command.length(), 0);
+  } catch(boost::interprocess::interprocess_exception &e) {
+    return false;
+  }
+
+}
+
+/*
+ * Returns the command tag of a command string taken from the
+ * message queue, EMPTY_DESCR if it can't be parsed. Commands
+ * submitted via the command channel carry their tag already.
+ */
+static CatalogTag launcher_cmd_tag(std::string command) {
+
+  PGBackupCtlParser parser;
+
+  try {
+
+    parser.parseLine(command);
+    return parser.getCommand()->getCommandTag();
+
+  } catch(CPGBackupCtlFailure &e) {
+    return EMPTY_DESCR;
+  }
+
+}
+
+/*
+ * Accepts all callers waiting on the command channel and
+ * dispatches their commands.
+ *
+ * Commands are dispatched by the tag the caller has sent along, the
+ * launcher doesn't parse them. A command is acknowledged by the
+ * worker executing it, which also reports progress and the result to
+ * callers waiting for it, or by the launcher if it was passed to the
+ * worker pool or couldn't be dispatched at all.
+ */
+static void launcher_serve_channel(BackgroundWorker &worker, job_info &info) {
+
+  int conn_fd;
+
+  launcher_cmd_pending = false;
+
+  while ((conn_fd = accept4(launcher_cmd_fd, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+
+    LauncherCommandChannel channel(conn_fd);
+    CommandMessage msg;
+    launcher_cmd_request request;
+    launcher_cmd_ack ack;
+
+    try {
+
+      pid_t worker_pid;
+
+      if (!LauncherCommandChannel::peerAllowed(conn_fd)) {
+        BOOST_LOG_TRIVIAL(warning) << "launcher refused command channel connection of foreign user";
+        continue;
+      }
+
+      /*
+       * Callers send their command right after they have
+       * connected, don't let a stuck one block us.
+       */
+      if (!channel.receive(msg, LAUNCHER_CMD_RECV_TIMEOUT)) {
+        BOOST_LOG_TRIVIAL(warning) << "launcher command channel caller sent no command";
+        continue;
+      }
+
+      msg.decode(request);
+
+      BOOST_LOG_TRIVIAL(debug) << "BACKGROUND COMMAND: " << request.command;
+
+      if (request.tag == EMPTY_DESCR || request.tag == START_LAUNCHER
+          || request.command.length() == 0) {
+
+        ack.message = "command cannot be executed by the launcher";
+        CommandMessage answer(ack);
+        channel.send(answer);
+        continue;
+
+      }
+
+      /*
+       * Callers waiting for the command need a worker
+       * they can stay connected to.
+       */
+      if (!(request.flags & CMD_SUBMIT_WAIT)
+          && launcher_pool_dispatch(info, request.tag, request.command)) {
+
+        BOOST_LOG_TRIVIAL(debug) << "launcher passed command to worker pool";
+
+        ack.accepted = true;
+        CommandMessage answer(ack);
+        channel.send(answer);
+        continue;
+
+      }
+
+      if ((worker_pid = worker_command(worker, request.command, conn_fd)) == (pid_t) 0) {
+
+        /* child should exit after having done its duty */
+        exit(0);
+
+      } else if (worker_pid < 0) {
+
+        BOOST_LOG_TRIVIAL(fatal) << "launcher cannot fork worker process: worker setup failed";
+
+        ack.message = "worker setup failed";
+        CommandMessage answer(ack);
+        channel.send(answer);
+
+      } else {
+
+        BOOST_LOG_TRIVIAL(info) << "launcher forked worker process at PID " << worker_pid;
+
+      }
+
+    } catch (std::exception &e) {
 
+      /*
+       * Errors of the command itself end up here in the
+       * worker, which has reported them to the caller already.
+       */
+      if (_pgbckctl_job_type != BACKGROUND_LAUNCHER) {
+        BOOST_LOG_TRIVIAL(error) << "background worker failure: " << e.what();
+        exit(DAEMON_FAILURE);
       }
 
-    }
+      BOOST_LOG_TRIVIAL(error) << "launcher command channel failure: " << e.what();
 
-    /*
-     * Check status of exited child.
-     */
-    if (WIFEXITED(wait_status)) {
+      /*
+       * Tell the caller, if it's still there.
+       */
+      try {
+
+        ack.accepted = false;
+        ack.message = e.what();
+        CommandMessage answer(ack);
+        channel.send(answer);
+
+      } catch (std::exception &se) {}
 
-      /* child terminated via exit() */
-      break;
     }
 
   }
@@ -1507,6 +2820,19 @@ static pid_t daemonize(job_info &info) {
       }
     }
 
+    sigset_t waitmask;
+    sigset_t origmask;
+
+    /*
+     * Block the termination signals while checking the shutdown
+     * state, they're delivered within sigsuspend() below only.
+     */
+    sigemptyset(&waitmask);
+    sigaddset(&waitmask, SIGTERM);
+    sigaddset(&waitmask, SIGINT);
+    sigaddset(&waitmask, SIGQUIT);
+    sigprocmask(SIG_BLOCK, &waitmask, &origmask);
+
     /*
      * Launcher processing loop.
      */
@@ -1528,7 +2854,7 @@ static pid_t daemonize(job_info &info) {
        */
       if (info.detach)
         break;
-      usleep(10000);
+      sigsuspend(&origmask);
 
     } while(true);
 
@@ -1623,6 +2949,15 @@ static pid_t daemonize(job_info &info) {
 
     BOOST_LOG_TRIVIAL(info) << "reset worker shared memory area done";
 
+    /*
+     * Budgets of the I/O governor, all workers
+     * consult them from now on.
+     */
+    worker_shm->setIOBudget(IO_CLASS_TOTAL, info.governor_total_rate * 1024);
+    worker_shm->setIOBudget(IO_CLASS_WAL, info.governor_wal_rate * 1024);
+    worker_shm->setIOBudget(IO_CLASS_BASEBACKUP, info.governor_basebackup_rate * 1024);
+    worker_shm->setIOBudget(IO_CLASS_RESTORE, info.governor_restore_rate * 1024);
+
     /* Mark launcher process.
      *
      * This will instruct the signal handlers (e.g. SIGCHLD) to keep
@@ -1638,9 +2973,34 @@ static pid_t daemonize(job_info &info) {
     _pgbckctl_job_type = BACKGROUND_LAUNCHER;
 
     /*
-     * Setup message queue.
+     * Setup message queue and the events we are waiting for.
+     */
+    try {
+
+      establish_launcher_cmd_queue(info);
+      launcher_setup_events(info);
+      launcher_setup_pool(info);
+
+    } catch(LauncherFailure &e) {
+
+      BOOST_LOG_TRIVIAL(fatal) << "launcher setup failed: " << e.what();
+      exit(DAEMON_FAILURE);
+
+    }
+
+    /*
+     * The job scheduler uses a catalog handle of its own, which
+     * is only opened while it needs to read the schedules.
      */
-    establish_launcher_cmd_queue(info);
+    std::shared_ptr<BackupCatalog> scheduler_catalog = std::make_shared<BackupCatalog>();
+    scheduler_catalog->setCatalogDB(info.cmdHandle->getCatalog()->fullname());
+
+    LauncherScheduler scheduler(scheduler_catalog,
+                                worker_shm,
+                                info.scheduler_max_basebackups_per_host,
+                                info.scheduler_max_basebackups_per_device,
+                                info.scheduler_max_start_delay);
+    int scheduler_timeout = -1;
 
     /*
      * Mark background worker running.
@@ -1648,16 +3008,21 @@ static pid_t daemonize(job_info &info) {
     worker.run();
 
     /*
-     * Enter processing loop
+     * Enter processing loop. The first round reaps and drains
+     * unconditionally, to catch up with everything that happened
+     * before the event sources were established.
      */
+    bool reap = true;
+
     while(true) {
 
       /*
        * Reap dead workers, if any.
        */
-      worker.execute_reaper();
-
-      usleep(1000);
+      if (reap) {
+        launcher_collect_children();
+        worker.execute_reaper();
+      }
 
       if (_pgbckctl_shutdown_mode == DAEMON_TERM_NORMAL) {
         BOOST_LOG_TRIVIAL(info) << "shutdown request received";
@@ -1668,6 +3033,7 @@ static pid_t daemonize(job_info &info) {
          * clean startup again.
          */
         try {
+          launcher_shutdown_pool(info);
           worker.prepareShutdown();
         } catch (std::exception& e) {
           BOOST_LOG_TRIVIAL(error) << "smart shutdown catched error: " << e.what();
@@ -1677,15 +3043,31 @@ static pid_t daemonize(job_info &info) {
 
       if (_pgbckctl_shutdown_mode == DAEMON_TERM_EMERGENCY) {
         BOOST_LOG_TRIVIAL(info) << "emergency shutdown request received";
+        launcher_shutdown_pool(info);
         break;
       }
 
       /*
-       * Check message queue whether there is something to do.
+       * Replace pool workers which have exited meanwhile.
+       */
+      launcher_fill_pool(worker, info);
+
+      /*
+       * Queue the commands of due scheduled jobs, they are
+       * dispatched along with all other commands below.
+       */
+      scheduler_timeout = scheduler.run(info);
+
+      /*
+       * Dispatch everything queued in the message queue, a
+       * single wakeup might stand for more than one command.
        */
-      std::string command = recv_launcher_cmd(info, cmd_ok);
+      while (true) {
 
-      if (cmd_ok) {
+        std::string command = recv_launcher_cmd(info, cmd_ok);
+
+        if (!cmd_ok)
+          break;
 
         /*
          * We got a command string. Establish a command
@@ -1699,6 +3081,15 @@ static pid_t daemonize(job_info &info) {
 
           BOOST_LOG_TRIVIAL(debug) << "BACKGROUND COMMAND: " << command;
 
+          /*
+           * Short commands are handed over to an idle pool
+           * worker, if there's a pool.
+           */
+          if (launcher_pool_dispatch(info, launcher_cmd_tag(command), command)) {
+            BOOST_LOG_TRIVIAL(debug) << "launcher passed command to worker pool";
+            continue;
+          }
+
           /*
            * Execute the command.
            *
@@ -1749,6 +3140,28 @@ static pid_t daemonize(job_info &info) {
 
       }
 
+      /*
+       * Dispatch the commands of callers connected
+       * to the command channel.
+       */
+      if (launcher_cmd_pending)
+        launcher_serve_channel(worker, info);
+
+      /*
+       * Sleep until a signal or a new command arrives, or
+       * the next scheduled job is due.
+       */
+      try {
+
+        reap = launcher_wait_events(scheduler_timeout);
+
+      } catch(LauncherFailure &e) {
+
+        BOOST_LOG_TRIVIAL(fatal) << e.what();
+        exit(DAEMON_FAILURE);
+
+      }
+
     }
 
     exit(_pgbckctl_shutdown_mode);
@@ -1761,7 +3174,7 @@ static pid_t daemonize(job_info &info) {
 
 bool pgbckctl::launcher_is_running(std::shared_ptr<CatalogProc> procInfo) {
 
-  shmatt_t nattach;
+  shmatt_t nattach = 0;
 
   try {
     if (procInfo != nullptr && procInfo->pid > 0) {
@@ -1793,6 +3206,43 @@ bool pgbckctl::launcher_is_running(std::shared_ptr<CatalogProc> procInfo) {
 
 }
 
+void pgbckctl::catalog_changed(std::string catalog_name) {
+
+  WorkerSHM shm;
+
+  try {
+
+    if (shm.attach(catalog_name, true)) {
+
+      shm.bumpCatalogGeneration();
+      shm.detach();
+
+    }
+
+  } catch(boost::interprocess::interprocess_exception &ie) {
+
+    /*
+     * Not fatal, but readers might work with outdated
+     * catalog data now.
+     */
+    BOOST_LOG_TRIVIAL(warning) << "WARNING: could not advance catalog generation: "
+                               << ie.what();
+
+  } catch(SHMFailure &e) {
+
+    BOOST_LOG_TRIVIAL(warning) << "WARNING: could not advance catalog generation: "
+                               << e.what();
+
+  }
+
+  /*
+   * The launcher scheduler reloads its schedules
+   * on the next wakeup.
+   */
+  launcher_wakeup(boost::filesystem::path(catalog_name).filename().string());
+
+}
+
 void pgbckctl::establish_launcher_cmd_queue(job_info& info) {
 
   std::string message_queue_name;
@@ -1868,6 +3318,13 @@ void pgbckctl::send_launcher_cmd(job_info& info, std::string command) {
   } catch(interprocess_exception &e) {
     throw CPGBackupCtlFailure(e.what());
   }
+
+  /*
+   * Wake up the launcher, if it is listening. A launcher
+   * not yet listening drains the queue on startup.
+   */
+  launcher_wakeup(info.cmdHandle->getCatalog()->name());
+
 }
 
 std::string pgbckctl::recv_launcher_cmd(job_info &info, bool &cmd_received) {
@@ -1938,8 +3395,14 @@ pid_t pgbckctl::launch(job_info& info) {
  * We don't care if the job_handle hold by the worker process
  * is set to background_exec, as we do in run_process. The specified
  * command handle will always be executed in a separate process.
+ *
+ * If channel_fd is a command channel connection, the worker
+ * acknowledges the command there and reports its result. The
+ * launcher closes its copy of the connection afterwards.
  */
-pid_t pgbckctl::worker_command(BackgroundWorker &worker, std::string command) {
+pid_t pgbckctl::worker_command(BackgroundWorker &worker,
+                               std::string command,
+                               int channel_fd) {
 
   job_info info = worker.jobInfo();
   pid_t pid;
@@ -1950,183 +3413,328 @@ pid_t pgbckctl::worker_command(BackgroundWorker &worker, std::string command) {
   if ((pid = fork()) == (pid_t) 0) {
 
     /* Worker child */
+    worker_prepare(worker);
 
-    PGBackupCtlParser parser;
-    std::shared_ptr<PGBackupCtlCommand> bgrnd_cmd_handler;
-    JobSignalHandler *cmdSignalHandler;
-    WorkerSHM *worker_shm;
-    unsigned int worker_slot_index = 0;
-    shm_worker_area worker_info;
+    if (channel_fd >= 0) {
 
-    /*
-     * Make sure we have the right background job context.
-     */
-    _pgbckctl_job_type = BACKGROUND_WORKER;
+      launcher_cmd_ack ack;
 
-    /*
-     * Reset SIGCHLD signal handler. Not required
-     * in a background worker process.
-     */
-    signal(SIGCHLD, SIG_DFL);
+      ack.accepted = true;
+      ack.pid = ::getpid();
 
-    /*
-     * Tell our background worker handle that we
-     * aren't longer a launcher instance.
-     */
-    worker.release_launcher_role();
+      worker_channel = new LauncherCommandChannel(channel_fd);
+
+      try {
+        CommandMessage msg(ack);
+        worker_channel->send(msg);
+      } catch (LauncherFailure &e) {
+        /* caller has gone away already, execute anyways */
+        delete worker_channel;
+        worker_channel = nullptr;
+      }
 
-    BOOST_LOG_TRIVIAL(info) << "background job executing command " << command;
+    }
 
-    worker_info.pid = ::getpid();
-    worker_info.started = CPGBackupCtlBase::ISO8601_strTo_ptime(CPGBackupCtlBase::current_timestamp());
+    try {
+      worker_execute(worker, info.cmdHandle->getCatalog(), command);
+    } catch (std::exception &e) {
+      worker_channel_done(false, e.what());
+      throw;
+    }
 
-    /*
-     * Parse command.
-     */
-    parser.parseLine(command);
+    worker_channel_done(true, "");
 
-    /*
-     * Parser has instantiated a command handler
-     * iff success.
-     */
-    bgrnd_cmd_handler = parser.getCommand();
+#ifdef __DEBUG__
+    BOOST_LOG_TRIVIAL(debug) << "WORKER EXIT";
+#endif
+
+    /* Exit, if done */
+    exit(0);
+
+  } else if (pid < (pid_t) 0) {
 
     /*
-     * Remember parsed command tag.
+     * fork() error, this is severe, so report
+     * that by throwing a worker exception. This
+     * affects the launcher process directly!
      */
-    worker_info.cmdType = bgrnd_cmd_handler->getCommandTag();
+    std::ostringstream oss;
+
+    oss << "could not fork new worker: " << strerror(errno);
+    throw WorkerFailure(oss.str());
+
+  } else {
 
     /*
-     * If the PGBackupCtlCommand handler encapsulates a
-     * command attached to an archive, we record the archive id
-     * in the shared memory, too.
+     * Launcher process, here's actually
+     * nothing to do.
      */
-    if (bgrnd_cmd_handler->archive_name().length() > 0) {
 
-      /*
-       * catalog access can throw here, don't suppress errors
-       * at this point but remap that to a WorkerFailure exception.
-       */
-      try {
+  }
+
+  return pid;
+}
 
-        std::shared_ptr<CatalogDescr> temp_descr
-          = info.cmdHandle->getCatalog()->existsByName(bgrnd_cmd_handler->archive_name());
+/*
+ * Sends the current instrumentation of the worker to a caller
+ * waiting on the command channel, at most once per
+ * WORKER_CHANNEL_PROGRESS_INTERVAL.
+ */
+static void worker_channel_progress(worker_instrumentation_item *items) {
 
-        if (temp_descr->id >= 0) {
-          worker_info.archive_id = temp_descr->id;
-        }
+  std::vector<worker_instrumentation_item> progress;
+  long long now;
 
-      } catch(CPGBackupCtlFailure &e) {
+  if (worker_channel == nullptr)
+    return;
 
-        throw WorkerFailure(e.what());
+  now = IOGovernor::now();
 
-      }
-    }
+  if (now - worker_channel_last_progress < WORKER_CHANNEL_PROGRESS_INTERVAL)
+    return;
 
-    /*
-     * Set signal handlers.
-     */
-    cmdSignalHandler = dynamic_cast<JobSignalHandler *>(termHandler);
-    bgrnd_cmd_handler->assignSigStopHandler(cmdSignalHandler);
+  worker_channel_last_progress = now;
 
-    cmdSignalHandler = dynamic_cast<JobSignalHandler *>(emergencyHandler);
-    bgrnd_cmd_handler->assignSigIntHandler(cmdSignalHandler);
+  for (unsigned int i = 0; i < MAX_WORKER_INSTRUMENTATION_SLOTS; i++) {
+    if (items[i].key != INSTR_NONE)
+      progress.push_back(items[i]);
+  }
 
-    /*
-     * Now it's time to execute the command. Since everything is setup now,
-     * it's overdue to register the forked process into the
-     * worker shared memory area. This needs to be done in a critical
-     * section, to protect us against concurrent workers doing the same.
-     */
-    worker_shm = worker.workerSHM();
-    if (!worker_shm->attach(info.cmdHandle->getCatalog()->fullname(), true)) {
-      /* could not attach to shared memory segment */
-      throw WorkerFailure("could not attach to worker shared memory area");
-    }
+  try {
+
+    CommandMessage msg(progress);
+    worker_channel->send(msg);
+
+  } catch (LauncherFailure &e) {
 
     /*
-     * WorkerSHM::allocate() can throw, but since
-     * the real memory allocation is done before we're
-     * probably safe here.
+     * The caller isn't interested anymore, continue
+     * without reporting.
      */
-    worker_shm->lock();
-    worker_slot_index = worker_shm->allocate(worker_info);
-    worker_shm->unlock();
+    delete worker_channel;
+    worker_channel = nullptr;
 
-#ifdef __DEBUG__
-    BOOST_LOG_TRIVIAL(debug) << "WORKER SLOT " << worker_slot_index;
-#endif
+  }
+
+}
+
+/*
+ * Reports the result of the command to a caller waiting on the
+ * command channel and closes the connection. Children forked by
+ * the command don't report anything.
+ */
+static void worker_channel_done(bool success, std::string message) {
+
+  launcher_cmd_done done;
+
+  if (worker_channel == nullptr
+      || _pgbckctl_job_type == BACKGROUND_WORKER_CHILD)
+    return;
+
+  done.success = success;
+  done.message = message;
+
+  try {
+
+    CommandMessage msg(done);
+    worker_channel->send(msg);
+
+  } catch (LauncherFailure &e) {}
+
+  delete worker_channel;
+  worker_channel = nullptr;
+
+}
+
+/*
+ * Turns a process forked off from the launcher into
+ * a background worker.
+ */
+static void worker_prepare(BackgroundWorker &worker) {
+
+  /*
+   * Make sure we have the right background job context.
+   */
+  _pgbckctl_job_type = BACKGROUND_WORKER;
+
+  /*
+   * Reset SIGCHLD signal handler. Not required
+   * in a background worker process.
+   */
+  signal(SIGCHLD, SIG_DFL);
+
+  /*
+   * The launcher's signalfd and wakeup socket are of
+   * no use here, and signals must be delivered again.
+   */
+  launcher_release_events();
+
+  /*
+   * Tell our background worker handle that we
+   * aren't longer a launcher instance.
+   */
+  worker.release_launcher_role();
+
+}
+
+/*
+ * Parses and executes a single background command. The worker
+ * occupies a worker shared memory slot while the command runs.
+ *
+ * catalog is used to look up the archive of the command.
+ */
+static void worker_execute(BackgroundWorker &worker,
+                           std::shared_ptr<BackupCatalog> catalog,
+                           std::string command) {
+
+  PGBackupCtlParser parser;
+  std::shared_ptr<PGBackupCtlCommand> bgrnd_cmd_handler;
+  JobSignalHandler *cmdSignalHandler;
+  WorkerSHM *worker_shm;
+  unsigned int worker_slot_index = 0;
+  shm_worker_area worker_info;
+
+  BOOST_LOG_TRIVIAL(info) << "background job executing command " << command;
+
+  worker_info.pid = ::getpid();
+  worker_info.started = CPGBackupCtlBase::ISO8601_strTo_ptime(CPGBackupCtlBase::current_timestamp());
 
-    /* Save worker slot index as its worker ID to command handler */
-    bgrnd_cmd_handler->setWorkerID(worker_slot_index);
+  /*
+   * Parse command.
+   */
+  parser.parseLine(command);
+
+  /*
+   * Parser has instantiated a command handler
+   * iff success.
+   */
+  bgrnd_cmd_handler = parser.getCommand();
+
+  /*
+   * Remember parsed command tag.
+   */
+  worker_info.cmdType = bgrnd_cmd_handler->getCommandTag();
+
+  /*
+   * Apply the scheduling policy of our job type before anything
+   * is executed and publish the settings in effect in our worker
+   * slot. Pool workers only execute commands of the default job
+   * type, so the policy of a former command is just applied again.
+   *
+   * The command gets the runtime configuration of the launcher, too.
+   */
+  {
+    WorkerPolicyType policy_type = WorkerPolicy::typeOf(worker_info.cmdType);
+    job_info info = worker.jobInfo();
+
+    worker_info.policy = info.worker_policies[policy_type].apply(policy_type);
+
+    if (info.runtime_config != nullptr)
+      bgrnd_cmd_handler->assignRuntimeConfiguration(info.runtime_config);
+  }
+
+  /*
+   * If the PGBackupCtlCommand handler encapsulates a
+   * command attached to an archive, we record the archive id
+   * in the shared memory, too.
+   */
+  if (bgrnd_cmd_handler->archive_name().length() > 0) {
 
+    /*
+     * catalog access can throw here, don't suppress errors
+     * at this point but remap that to a WorkerFailure exception.
+     */
     try {
-      bgrnd_cmd_handler->execute(info.cmdHandle->getCatalog()->fullname());
-    } catch(exception &e) {
 
-      /*
-       * In any case, detach from the shared memory but clear
-       * our slot before, but only if this is *NOT* a BACKGROUND_WORKER_CHILD.
-       *
-       * Background: BaseCatalogCommand derived classes might fork within
-       * their execute() methods, to employ additional child processes. To
-       * make sure they don't clear the Worker SHM, they set the
-       * background job type flag to BACKGROUND_WORKER_CHILD. It's okay
-       * to just test for that flag, since others are unlikely to occur here.
-       *
-       * WorkerSHM::free() can throw itself if there's no valid shared
-       * memory handle here. But that seems unlikely, since the
-       * actions before should have failed before.
-       */
-      if (_pgbckctl_job_type != BACKGROUND_WORKER_CHILD) {
-        worker_shm->lock();
-        worker_shm->free(worker_slot_index);
-        worker_shm->unlock();
+      std::shared_ptr<CatalogDescr> temp_descr
+        = catalog->existsByName(bgrnd_cmd_handler->archive_name());
+
+      if (temp_descr->id >= 0) {
+        worker_info.archive_id = temp_descr->id;
       }
 
-      /* re-throw */
+    } catch(CPGBackupCtlFailure &e) {
+
       throw WorkerFailure(e.what());
 
     }
+  }
 
-    /* only reached if everything went okay */
-    if (_pgbckctl_job_type != BACKGROUND_WORKER_CHILD) {
+  /*
+   * Set signal handlers.
+   */
+  cmdSignalHandler = dynamic_cast<JobSignalHandler *>(termHandler);
+  bgrnd_cmd_handler->assignSigStopHandler(cmdSignalHandler);
 
-      worker_shm->lock();
-      worker_shm->free(worker_slot_index);
-      worker_shm->unlock();
+  cmdSignalHandler = dynamic_cast<JobSignalHandler *>(emergencyHandler);
+  bgrnd_cmd_handler->assignSigIntHandler(cmdSignalHandler);
 
-    }
+  /*
+   * Now it's time to execute the command. Since everything is setup now,
+   * it's overdue to register the worker into the worker shared
+   * memory area. Pool workers are already attached, so
+   * attach() is a no-op for them.
+   */
+  worker_shm = worker.workerSHM();
+  if (!worker_shm->attach(catalog->fullname(), true)) {
+    /* could not attach to shared memory segment */
+    throw WorkerFailure("could not attach to worker shared memory area");
+  }
+
+  /*
+   * WorkerSHM::allocate() can throw, but since
+   * the real memory allocation is done before we're
+   * probably safe here. Slots are claimed atomically, so
+   * there's no need to lock the shared memory.
+   */
+  worker_slot_index = worker_shm->allocate(worker_info);
+
+  worker_shm->recordEvent(worker_slot_index, EVT_WORKER_START,
+                          worker_info.cmdType, worker_info.archive_id);
 
 #ifdef __DEBUG__
-    BOOST_LOG_TRIVIAL(debug) << "WORKER EXIT";
+  BOOST_LOG_TRIVIAL(debug) << "WORKER SLOT " << worker_slot_index;
 #endif
 
-    /* Exit, if done */
-    exit(0);
+  /* Save worker slot index as its worker ID to command handler */
+  bgrnd_cmd_handler->setWorkerID(worker_slot_index);
 
-  } else if (pid < (pid_t) 0) {
+  try {
+    bgrnd_cmd_handler->execute(catalog->fullname());
+  } catch(exception &e) {
 
     /*
-     * fork() error, this is severe, so report
-     * that by throwing a worker exception. This
-     * affects the launcher process directly!
+     * In any case, detach from the shared memory but clear
+     * our slot before, but only if this is *NOT* a BACKGROUND_WORKER_CHILD.
+     *
+     * Background: BaseCatalogCommand derived classes might fork within
+     * their execute() methods, to employ additional child processes. To
+     * make sure they don't clear the Worker SHM, they set the
+     * background job type flag to BACKGROUND_WORKER_CHILD. It's okay
+     * to just test for that flag, since others are unlikely to occur here.
+     *
+     * WorkerSHM::free() can throw itself if there's no valid shared
+     * memory handle here. But that seems unlikely, since the
+     * actions before should have failed before.
      */
-    std::ostringstream oss;
+    if (_pgbckctl_job_type != BACKGROUND_WORKER_CHILD) {
+      worker_shm->recordEvent(worker_slot_index, EVT_WORKER_EXIT, 0);
+      worker_shm->free(worker_slot_index);
+    }
 
-    oss << "could not fork new worker: " << strerror(errno);
-    throw WorkerFailure(oss.str());
+    /* re-throw */
+    throw WorkerFailure(e.what());
 
-  } else {
+  }
 
-    /*
-     * Launcher process, here's actually
-     * nothing to do.
-     */
+  /* only reached if everything went okay */
+  if (_pgbckctl_job_type != BACKGROUND_WORKER_CHILD) {
+
+    worker_shm->recordEvent(worker_slot_index, EVT_WORKER_EXIT, 1);
+    worker_shm->free(worker_slot_index);
 
   }
 
-  return pid;
 }
 
 /**
@@ -0,0 +1,425 @@
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/log/trivial.hpp>
+#include <iostream>
+
+#include <common.hxx>
+#include <metrics.hxx>
+#include <metricsserver.hxx>
+
+/*
+ * Maximum size of an incoming request header. Scrapers send
+ * a few hundred bytes, anything larger is rejected.
+ */
+#define METRICS_MAX_REQUEST_SIZE 8192
+
+using namespace pgbckctl;
+
+/**
+ * pg_backup_ctl++ metrics server implementation.
+ *
+ * A minimal HTTP/1.1 responder on top of boost::asio. Every
+ * connection is answered with a single response and closed
+ * afterwards, which is all a Prometheus scraper needs.
+ */
+namespace pgbckctl {
+
+  namespace ba = boost::asio;
+  namespace ip = boost::asio::ip;
+
+  /**
+   * A single HTTP connection to the metrics server.
+   */
+  class MetricsConnection : public boost::enable_shared_from_this<MetricsConnection> {
+  private:
+
+    PGBackupCtlMetricsServer *server = nullptr;
+
+    ba::streambuf request;
+    std::string response;
+
+    void handle_request(const boost::system::error_code &ec,
+                        std::size_t len);
+
+    void handle_write(const boost::system::error_code &ec,
+                      std::size_t len);
+
+  public:
+
+    ip::tcp::socket soc;
+
+    MetricsConnection(ba::io_service &ios,
+                      PGBackupCtlMetricsServer *server)
+      : server(server), request(METRICS_MAX_REQUEST_SIZE), soc(ios) {}
+
+    void start();
+
+  };
+
+  /*
+   * Metrics server implementation class.
+   */
+  class PGBackupCtlMetricsServer {
+  private:
+
+    /**
+     * Metrics server descriptor.
+     */
+    std::shared_ptr<MetricsServerDescr> metricsDescr = nullptr;
+
+    /**
+     * Shared memory segment for background workers, nullptr
+     * in case we couldn't attach.
+     */
+    std::shared_ptr<WorkerSHM> worker_shm = nullptr;
+
+    /**
+     * Read only catalog connection, only used to (re-)build
+     * the catalog snapshot.
+     */
+    BackupCatalog catalog;
+
+    /**
+     * Cached catalog snapshot.
+     */
+    std::shared_ptr<MetricsCatalogSnapshot> snapshot = nullptr;
+
+    /*
+     * Internal boost::asio handles.
+     */
+    ba::io_service *ios     = nullptr;
+    ba::signal_set *sset_exit = nullptr;
+    ip::tcp::acceptor *acpt = nullptr;
+
+    void start_signal_wait() {
+
+      sset_exit->async_wait(boost::bind(&boost::asio::io_service::stop, this->ios));
+
+    }
+
+    void start_accept() {
+
+      boost::shared_ptr<MetricsConnection> conn
+        = boost::make_shared<MetricsConnection>(*(this->ios), this);
+
+      this->acpt->async_accept(conn->soc,
+                               boost::bind(&PGBackupCtlMetricsServer::handle_accept,
+                                           this,
+                                           conn,
+                                           _1));
+
+    }
+
+    void handle_accept(boost::shared_ptr<MetricsConnection> conn,
+                       const boost::system::error_code& ec) {
+
+      if (!ec) {
+        conn->start();
+      }
+
+      start_accept();
+
+    }
+
+    /**
+     * Returns the current catalog snapshot, rebuilding it
+     * if it is stale.
+     */
+    std::shared_ptr<MetricsCatalogSnapshot> getSnapshot();
+
+  public:
+
+    PGBackupCtlMetricsServer(std::shared_ptr<MetricsServerDescr> metricsDescr);
+    virtual ~PGBackupCtlMetricsServer();
+
+    /**
+     * Renders the current metrics in OpenMetrics text format.
+     */
+    std::string metrics();
+
+    virtual void run();
+
+  };
+
+}
+
+void MetricsConnection::start() {
+
+  ba::async_read_until(soc, request, "\r\n\r\n",
+                       boost::bind(&MetricsConnection::handle_request,
+                                   shared_from_this(),
+                                   _1, _2));
+
+}
+
+void MetricsConnection::handle_request(const boost::system::error_code &ec,
+                                       std::size_t len) {
+
+  std::istream request_stream(&request);
+  std::string method;
+  std::string target;
+  std::string status = "200 OK";
+  std::string content_type = OpenMetricsRenderer::CONTENT_TYPE;
+  std::string body;
+  std::ostringstream oss;
+
+  if (ec) {
+
+    /*
+     * Either the peer went away or the request exceeds
+     * METRICS_MAX_REQUEST_SIZE, nothing to answer then.
+     */
+    BOOST_LOG_TRIVIAL(debug) << "metrics server: error reading request: "
+                             << ec.message();
+    return;
+
+  }
+
+  request_stream >> method >> target;
+
+  /* Ignore query parameters, scrapers might append some */
+  target = target.substr(0, target.find('?'));
+
+  if (method != "GET") {
+
+    status = "405 Method Not Allowed";
+    content_type = "text/plain; charset=utf-8";
+    body = "method not allowed\n";
+
+  } else if (target != "/metrics") {
+
+    status = "404 Not Found";
+    content_type = "text/plain; charset=utf-8";
+    body = "not found\n";
+
+  } else {
+
+    try {
+
+      body = server->metrics();
+
+    } catch(CPGBackupCtlFailure &e) {
+
+      BOOST_LOG_TRIVIAL(error) << "metrics server: " << e.what();
+
+      status = "500 Internal Server Error";
+      content_type = "text/plain; charset=utf-8";
+      body = std::string(e.what()) + "\n";
+
+    }
+
+  }
+
+  oss << "HTTP/1.1 " << status << "\r\n"
+      << "Content-Type: " << content_type << "\r\n"
+      << "Content-Length: " << body.length() << "\r\n"
+      << "Connection: close\r\n"
+      << "\r\n"
+      << body;
+
+  response = oss.str();
+
+  ba::async_write(soc, ba::buffer(response),
+                  boost::bind(&MetricsConnection::handle_write,
+                              shared_from_this(),
+                              _1, _2));
+
+}
+
+void MetricsConnection::handle_write(const boost::system::error_code &ec,
+                                     std::size_t len) {
+
+  boost::system::error_code ignored;
+
+  soc.shutdown(ip::tcp::socket::shutdown_both, ignored);
+  soc.close(ignored);
+
+}
+
+PGBackupCtlMetricsServer::PGBackupCtlMetricsServer(std::shared_ptr<MetricsServerDescr> metricsDescr) {
+
+  /*
+   * We need a valid metrics descriptor!
+   */
+  if (metricsDescr == nullptr) {
+    throw TCPServerFailure("could not initialize metrics server instance: invalid metrics descriptor");
+  }
+
+  this->metricsDescr = metricsDescr;
+
+  /*
+   * Open the catalog read only, the metrics server
+   * never changes anything there.
+   */
+  this->catalog.setCatalogDB(metricsDescr->catalog_name);
+  this->catalog.open_ro();
+
+  /*
+   * Attach to the worker shared memory. If there is no
+   * launcher running, we just can't export worker state.
+   */
+  this->worker_shm = std::make_shared<WorkerSHM>();
+
+  if (!this->worker_shm->attach(metricsDescr->catalog_name, true)) {
+
+    BOOST_LOG_TRIVIAL(warning) << "metrics server: could not attach to worker shared memory, "
+                               << "worker metrics not available";
+    this->worker_shm = nullptr;
+
+  }
+
+  /*
+   * Create io_service handler
+   */
+  this->ios = new ba::io_service();
+
+  /*
+   * Create signal set
+   */
+  this->sset_exit = new ba::signal_set(*(this->ios), SIGTERM, SIGINT);
+
+  /*
+   * Create acceptor handle
+   */
+  if (metricsDescr->listen_on.size() == 1) {
+
+    this->acpt = new ip::tcp::acceptor(*(this->ios),
+                                       ip::tcp::endpoint(ip::address::from_string(metricsDescr->listen_on[0]),
+                                                         metricsDescr->port));
+  } else {
+
+    this->acpt = new ip::tcp::acceptor(*(this->ios),
+                                       ip::tcp::endpoint(ip::tcp::v6(),
+                                                         metricsDescr->port));
+  }
+
+}
+
+PGBackupCtlMetricsServer::~PGBackupCtlMetricsServer() {
+
+  if (this->acpt != nullptr)
+    delete this->acpt;
+
+  if (this->sset_exit != nullptr)
+    delete this->sset_exit;
+
+  if (this->ios != nullptr)
+    delete this->ios;
+
+  if (this->worker_shm != nullptr)
+    this->worker_shm->detach();
+
+  if (this->catalog.opened())
+    this->catalog.close();
+
+}
+
+std::shared_ptr<MetricsCatalogSnapshot> PGBackupCtlMetricsServer::getSnapshot() {
+
+  unsigned long long generation = 0;
+
+  if (worker_shm != nullptr) {
+    generation = worker_shm->getCatalogGeneration();
+  }
+
+  if (snapshot == nullptr
+      || !snapshot->isValid(generation, metricsDescr->snapshot_max_age)) {
+
+    /*
+     * Build into a new instance. If the catalog is busy, continue
+     * to serve the former snapshot instead of failing the scrape.
+     */
+    std::shared_ptr<MetricsCatalogSnapshot> new_snapshot
+      = std::make_shared<MetricsCatalogSnapshot>();
+
+    try {
+
+      new_snapshot->build(catalog, generation);
+      snapshot = new_snapshot;
+
+    } catch(CCatalogIssue &ci) {
+
+      if (snapshot == nullptr)
+        throw ci;
+
+      BOOST_LOG_TRIVIAL(warning) << "metrics server: could not refresh catalog snapshot: "
+                                 << ci.what();
+
+    }
+
+  }
+
+  return snapshot;
+
+}
+
+std::string PGBackupCtlMetricsServer::metrics() {
+
+  std::ostringstream out;
+  OpenMetricsRenderer renderer(out);
+  std::vector<std::pair<unsigned int, shm_worker_area>> workers;
+  size_t max_workers = 0;
+
+  if (worker_shm != nullptr) {
+
+    max_workers = worker_shm->getMaxWorkers();
+
+    /*
+     * Reading worker slots never blocks the workers, see
+     * WorkerSHM::read().
+     */
+    for (unsigned int i = 0; i < max_workers; i++) {
+
+      if (worker_shm->isEmpty(i))
+        continue;
+
+      shm_worker_area worker = worker_shm->read(i);
+
+      if (worker.pid > 0)
+        workers.push_back(std::make_pair(i, worker));
+
+    }
+
+  }
+
+  renderer.render(getSnapshot(), workers, max_workers);
+  return out.str();
+
+}
+
+void PGBackupCtlMetricsServer::run() {
+
+  BOOST_LOG_TRIVIAL(debug) << "DEBUG: running PGBackupCtlMetricsServer";
+
+  start_signal_wait();
+  start_accept();
+
+  this->ios->run();
+
+}
+
+/* ****************************************************************************
+ * Implementation MetricsServer
+ * ****************************************************************************/
+
+MetricsServer::MetricsServer(std::shared_ptr<MetricsServerDescr> metricsDescr) {
+
+  this->instance = std::make_shared<PGBackupCtlMetricsServer>(metricsDescr);
+
+}
+
+MetricsServer::~MetricsServer() {}
+
+void MetricsServer::run() {
+
+  BOOST_LOG_TRIVIAL(debug) << "DEBUG: run MetricsServer";
+  this->instance->run();
+
+}
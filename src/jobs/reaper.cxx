@@ -50,21 +50,21 @@ void background_worker_shm_reaper::reap() {
      * Ugly, but we need to loop through the shared memory
      * area to find the PID we need to drop.
      *
-     * NOTE: We do this without interlocking, since
-     *       we believe to reset the PID to 0 atomically.
-     *
-     *       This might by racy, but in the worst case we'll
-     *       miss this potential free slot and won't find a
-     *       remaining one. In this case the worker will
-     *       fail and exit.
+     * NOTE: The dead worker might have been killed within
+     *       a write to its slot, so reclaim() takes care
+     *       to leave the slot sequence counter in a sane state
+     *       before releasing the slot.
      */
     for (unsigned int i = 0 ; i < this->shm->getMaxWorkers(); i++) {
 
+      if (this->shm->isEmpty(i))
+        continue;
+
       shm_worker_area *ptr = (shm_worker_area *) (this->shm->shm_mem_ptr + i);
 
       if (ptr != NULL && ptr->pid == deadpid) {
 
-        ptr->pid = 0;
+        this->shm->reclaim(i);
 
       }
 
@@ -0,0 +1,622 @@
+#include <sys/stat.h>
+#include <algorithm>
+#include <functional>
+#include <sstream>
+
+#include <boost/log/trivial.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <scheduler.hxx>
+
+using namespace pgbckctl;
+
+/*
+ * Years CronExpression::next() looks ahead for
+ * a matching time.
+ */
+#define CRON_MAX_LOOKAHEAD_YEARS 5
+
+/* ****************************************************************************
+ * Implementation CronExpression
+ * ****************************************************************************/
+
+/*
+ * Converts a single numeric cron field value.
+ */
+static unsigned int cron_number(std::string value) {
+
+  if (value.length() == 0 || value.length() > 4
+      || value.find_first_not_of("0123456789") != std::string::npos) {
+    throw SchedulerFailure("\"" + value + "\" is not a number");
+  }
+
+  return (unsigned int) std::stoi(value);
+
+}
+
+CronExpression::CronExpression(std::string expression) {
+
+  std::vector<std::string> fields;
+  std::string expanded = boost::algorithm::trim_copy(expression);
+
+  this->expression = expression;
+
+  /*
+   * Expand supported macros.
+   */
+  if (expanded == "@hourly")
+    expanded = "0 * * * *";
+  else if (expanded == "@daily" || expanded == "@midnight")
+    expanded = "0 0 * * *";
+  else if (expanded == "@weekly")
+    expanded = "0 0 * * 0";
+  else if (expanded == "@monthly")
+    expanded = "0 0 1 * *";
+
+  boost::algorithm::split(fields, expanded,
+                          boost::algorithm::is_space(),
+                          boost::algorithm::token_compress_on);
+
+  if (fields.size() != 5) {
+    std::ostringstream oss;
+    oss << "cron expression \"" << expression << "\" must have 5 fields";
+    throw SchedulerFailure(oss.str());
+  }
+
+  parseField(fields[0], 0, 59, this->minutes);
+  parseField(fields[1], 0, 23, this->hours);
+  parseField(fields[2], 1, 31, this->mdays);
+  parseField(fields[3], 1, 12, this->months);
+  parseField(fields[4], 0, 7, this->wdays);
+
+  /* 7 is sunday, too */
+  if (this->wdays[7])
+    this->wdays[0] = true;
+
+  this->mday_any = (fields[2] == "*");
+  this->wday_any = (fields[4] == "*");
+
+}
+
+CronExpression::~CronExpression() {}
+
+void CronExpression::parseField(std::string field,
+                                unsigned int min,
+                                unsigned int max,
+                                std::vector<bool> &values) {
+
+  std::vector<std::string> items;
+
+  values.assign(max + 1, false);
+
+  boost::algorithm::split(items, field, boost::algorithm::is_any_of(","));
+
+  for (auto &item : items) {
+
+    unsigned int from = min;
+    unsigned int to   = max;
+    unsigned int step = 1;
+    std::string range = item;
+    size_t pos;
+
+    try {
+
+      if ((pos = item.find('/')) != std::string::npos) {
+
+        range = item.substr(0, pos);
+        step = cron_number(item.substr(pos + 1));
+
+        if (step == 0)
+          throw SchedulerFailure("step must not be zero");
+
+      }
+
+      if (range != "*") {
+
+        if ((pos = range.find('-')) != std::string::npos) {
+
+          from = cron_number(range.substr(0, pos));
+          to   = cron_number(range.substr(pos + 1));
+
+        } else {
+
+          from = cron_number(range);
+
+          /* "a/n" means from a up to max */
+          if (item.find('/') == std::string::npos)
+            to = from;
+
+        }
+
+      }
+
+    } catch(SchedulerFailure &e) {
+
+      std::ostringstream oss;
+      oss << "invalid cron field \"" << field << "\": " << e.what();
+      throw SchedulerFailure(oss.str());
+
+    }
+
+    if (from < min || to > max || from > to) {
+      std::ostringstream oss;
+      oss << "cron field \"" << field << "\" out of range "
+          << min << "-" << max;
+      throw SchedulerFailure(oss.str());
+    }
+
+    for (unsigned int i = from; i <= to; i += step)
+      values[i] = true;
+
+  }
+
+}
+
+bool CronExpression::dayMatches(struct tm &tm) {
+
+  bool mday = this->mdays[tm.tm_mday];
+  bool wday = this->wdays[tm.tm_wday];
+
+  if (this->mday_any && this->wday_any)
+    return true;
+
+  if (this->mday_any)
+    return wday;
+
+  if (this->wday_any)
+    return mday;
+
+  /* both restricted, either one matches */
+  return mday || wday;
+
+}
+
+bool CronExpression::matches(struct tm &tm) {
+
+  return this->minutes[tm.tm_min]
+    && this->hours[tm.tm_hour]
+    && this->months[tm.tm_mon + 1]
+    && dayMatches(tm);
+
+}
+
+time_t CronExpression::next(time_t after) {
+
+  struct tm tm;
+  time_t t;
+  time_t limit = after + (time_t) CRON_MAX_LOOKAHEAD_YEARS * 366 * 86400;
+
+  /*
+   * Start with the minute following after.
+   */
+  localtime_r(&after, &tm);
+  tm.tm_sec = 0;
+  tm.tm_min += 1;
+  tm.tm_isdst = -1;
+  t = mktime(&tm);
+
+  /*
+   * Advance by the largest unit not matching, this needs
+   * a few hundred iterations at most for real world
+   * expressions.
+   */
+  while (t <= limit) {
+
+    time_t prev = t;
+
+    localtime_r(&t, &tm);
+
+    if (this->matches(tm))
+      return t;
+
+    if (!this->months[tm.tm_mon + 1]) {
+
+      tm.tm_mon += 1;
+      tm.tm_mday = 1;
+      tm.tm_hour = 0;
+      tm.tm_min = 0;
+
+    } else if (!dayMatches(tm)) {
+
+      tm.tm_mday += 1;
+      tm.tm_hour = 0;
+      tm.tm_min = 0;
+
+    } else if (!this->hours[tm.tm_hour]) {
+
+      tm.tm_hour += 1;
+      tm.tm_min = 0;
+
+    } else {
+
+      tm.tm_min += 1;
+
+    }
+
+    tm.tm_isdst = -1;
+    t = mktime(&tm);
+
+    /*
+     * Daylight saving time transitions might map the
+     * new local time back, make sure we always advance.
+     */
+    if (t <= prev)
+      t = prev + 60;
+
+  }
+
+  std::ostringstream oss;
+  oss << "cron expression \"" << this->expression << "\" never matches";
+  throw SchedulerFailure(oss.str());
+
+}
+
+std::string CronExpression::str() {
+
+  return this->expression;
+
+}
+
+/* ****************************************************************************
+ * Implementation LauncherScheduler
+ * ****************************************************************************/
+
+LauncherScheduler::LauncherScheduler(std::shared_ptr<BackupCatalog> catalog,
+                                     WorkerSHM *worker_shm,
+                                     unsigned int max_basebackups_per_host,
+                                     unsigned int max_basebackups_per_device,
+                                     unsigned int max_start_delay) {
+
+  if (catalog == nullptr || worker_shm == nullptr) {
+    throw SchedulerFailure("scheduler requires a catalog and worker shared memory");
+  }
+
+  this->catalog = catalog;
+  this->worker_shm = worker_shm;
+  this->max_basebackups_per_host = max_basebackups_per_host;
+  this->max_basebackups_per_device = max_basebackups_per_device;
+  this->max_start_delay = max_start_delay;
+
+}
+
+LauncherScheduler::~LauncherScheduler() {}
+
+std::string LauncherScheduler::jobCommand(std::shared_ptr<ScheduleDescr> schedule) {
+
+  std::ostringstream cmd;
+
+  switch(schedule->action) {
+
+  case SCHEDULE_ACTION_BASEBACKUP:
+
+    cmd << "START BASEBACKUP FOR ARCHIVE " << schedule->archive_name;
+
+    if (schedule->param.length() > 0)
+      cmd << " PROFILE " << schedule->param;
+
+    break;
+
+  case SCHEDULE_ACTION_RETENTION:
+
+    cmd << "APPLY RETENTION POLICY " << schedule->param
+        << " TO ARCHIVE " << schedule->archive_name;
+    break;
+
+  default:
+    throw SchedulerFailure("unknown schedule action");
+
+  }
+
+  return cmd.str();
+
+}
+
+time_t LauncherScheduler::startDelay(std::shared_ptr<ScheduleDescr> schedule) {
+
+  if (this->max_start_delay == 0)
+    return 0;
+
+  /*
+   * Derive the delay from the schedule identity, so it
+   * stays the same across launcher restarts.
+   */
+  std::hash<std::string> hash;
+
+  return (time_t) (hash(schedule->archive_name + "/" + schedule->name)
+                   % (this->max_start_delay + 1));
+
+}
+
+void LauncherScheduler::load(time_t now) {
+
+  std::map<int, scheduled_job> new_jobs;
+  std::vector<std::shared_ptr<ScheduleDescr>> schedules
+    = this->catalog->getSchedules(-1);
+
+  for (auto &schedule : schedules) {
+
+    scheduled_job job;
+    auto old = this->jobs.find(schedule->id);
+
+    /*
+     * Keep the state of unchanged schedules, so reloading
+     * doesn't skip or repeat any job.
+     */
+    if (old != this->jobs.end()
+        && old->second.schedule->cron == schedule->cron) {
+
+      old->second.schedule = schedule;
+      new_jobs.insert(*old);
+      continue;
+
+    }
+
+    try {
+
+      job.schedule = schedule;
+      job.cron = std::make_shared<CronExpression>(schedule->cron);
+      job.nominal = job.cron->next(now);
+      job.due = job.nominal + startDelay(schedule);
+
+    } catch(SchedulerFailure &e) {
+
+      BOOST_LOG_TRIVIAL(error) << "ignoring schedule \"" << schedule->name
+                               << "\" of archive \"" << schedule->archive_name
+                               << "\": " << e.what();
+      continue;
+
+    }
+
+    new_jobs.insert(std::make_pair(schedule->id, job));
+
+  }
+
+  this->jobs = new_jobs;
+
+  /* Archives might have been changed, too */
+  this->locations.clear();
+
+  BOOST_LOG_TRIVIAL(info) << "scheduler loaded " << this->jobs.size() << " schedule(s)";
+
+}
+
+LauncherScheduler::archive_location &LauncherScheduler::location(int archive_id) {
+
+  auto it = this->locations.find(archive_id);
+
+  if (it != this->locations.end())
+    return it->second;
+
+  archive_location loc;
+  std::shared_ptr<CatalogDescr> archive = this->catalog->existsById(archive_id);
+  std::shared_ptr<ConnectionDescr> con = std::make_shared<ConnectionDescr>();
+  struct stat st;
+
+  this->catalog->getCatalogConnection(con, archive_id,
+                                      ConnectionDescr::CONNECTION_TYPE_BASEBACKUP);
+
+  loc.host = con->pghost;
+
+  /*
+   * Archives defined by a DSN have the host in there.
+   */
+  if (loc.host.length() == 0 && con->dsn.length() > 0) {
+
+    std::vector<std::string> params;
+
+    boost::algorithm::split(params, con->dsn,
+                            boost::algorithm::is_space(),
+                            boost::algorithm::token_compress_on);
+
+    for (auto &param : params) {
+
+      if (boost::algorithm::starts_with(param, "host="))
+        loc.host = param.substr(5);
+
+    }
+
+  }
+
+  if (archive->id >= 0 && stat(archive->directory.c_str(), &st) == 0)
+    loc.device = st.st_dev;
+
+  return (this->locations[archive_id] = loc);
+
+}
+
+bool LauncherScheduler::admit(int archive_id, time_t now) {
+
+  std::map<std::string, unsigned int> per_host;
+  std::map<dev_t, unsigned int> per_device;
+  std::vector<int> running;
+  archive_location &target = location(archive_id);
+
+  if (this->max_basebackups_per_host == 0
+      && this->max_basebackups_per_device == 0)
+    return true;
+
+  /*
+   * Collect the archives of all running basebackups.
+   */
+  for (unsigned int i = 0; i < this->worker_shm->getMaxWorkers(); i++) {
+
+    if (this->worker_shm->isEmpty(i))
+      continue;
+
+    shm_worker_area worker = this->worker_shm->read(i);
+
+    if (worker.pid > 0
+        && worker.cmdType == START_BASEBACKUP
+        && worker.archive_id >= 0)
+      running.push_back(worker.archive_id);
+
+  }
+
+  /*
+   * Dispatched basebackups count until their worker shows up
+   * in the shared memory or they time out.
+   */
+  for (auto it = this->pending.begin(); it != this->pending.end(); ) {
+
+    bool started = false;
+
+    for (auto &id : running) {
+
+      if (id == it->archive_id)
+        started = true;
+
+    }
+
+    if (started || (now - it->dispatched) > PENDING_TIMEOUT) {
+      it = this->pending.erase(it);
+    } else {
+      running.push_back(it->archive_id);
+      ++it;
+    }
+
+  }
+
+  for (auto &id : running) {
+
+    archive_location &loc = location(id);
+
+    per_host[loc.host]++;
+    per_device[loc.device]++;
+
+  }
+
+  if (this->max_basebackups_per_host > 0
+      && per_host[target.host] >= this->max_basebackups_per_host)
+    return false;
+
+  if (this->max_basebackups_per_device > 0
+      && target.device != 0
+      && per_device[target.device] >= this->max_basebackups_per_device)
+    return false;
+
+  return true;
+
+}
+
+int LauncherScheduler::run(job_info &info) {
+
+  time_t now = time(NULL);
+  time_t next_wakeup = 0;
+  bool deferred = false;
+  bool reload = false;
+  bool due = false;
+
+  try {
+
+    unsigned long long current_generation = this->worker_shm->getCatalogGeneration();
+
+    reload = (!this->loaded || current_generation != this->generation);
+
+    for (auto &item : this->jobs) {
+
+      if (item.second.due <= now)
+        due = true;
+
+    }
+
+    /*
+     * The catalog is only opened if there's something to do. Keeping
+     * it open would pass the connection down to every forked
+     * worker, which SQLite doesn't support.
+     */
+    if (reload || due)
+      this->catalog->open_rw();
+
+    if (reload) {
+
+      load(now);
+      this->generation = current_generation;
+      this->loaded = true;
+
+    }
+
+    for (auto &item : this->jobs) {
+
+      scheduled_job &job = item.second;
+
+      if (job.due > now) {
+
+        if (next_wakeup == 0 || job.due < next_wakeup)
+          next_wakeup = job.due;
+
+        continue;
+
+      }
+
+      if (job.schedule->action == SCHEDULE_ACTION_BASEBACKUP
+          && !admit(job.schedule->archive_id, now)) {
+
+        BOOST_LOG_TRIVIAL(debug) << "scheduler deferring basebackup for archive "
+                                 << job.schedule->archive_name;
+        deferred = true;
+        continue;
+
+      }
+
+      std::string command = jobCommand(job.schedule);
+
+      BOOST_LOG_TRIVIAL(info) << "scheduler starting job of schedule \""
+                              << job.schedule->name << "\": " << command;
+
+      send_launcher_cmd(info, command);
+
+      if (job.schedule->action == SCHEDULE_ACTION_BASEBACKUP) {
+
+        pending_basebackup bb;
+
+        bb.archive_id = job.schedule->archive_id;
+        bb.dispatched = now;
+        this->pending.push_back(bb);
+
+      }
+
+      this->catalog->setScheduleLastRun(job.schedule->id,
+                                        CPGBackupCtlBase::current_timestamp());
+
+      /*
+       * Occurrences missed while the job was deferred
+       * are skipped.
+       */
+      job.nominal = job.cron->next(std::max(now, job.nominal));
+      job.due = job.nominal + startDelay(job.schedule);
+
+      if (next_wakeup == 0 || job.due < next_wakeup)
+        next_wakeup = job.due;
+
+    }
+
+  } catch(CPGBackupCtlFailure &e) {
+
+    /*
+     * Most likely the catalog is busy, just retry.
+     */
+    BOOST_LOG_TRIVIAL(warning) << "scheduler: " << e.what();
+
+    if (this->catalog->opened())
+      this->catalog->close();
+
+    return RETRY_INTERVAL;
+
+  }
+
+  if (this->catalog->opened())
+    this->catalog->close();
+
+  if (deferred) {
+
+    if (next_wakeup == 0 || next_wakeup > now + RETRY_INTERVAL)
+      next_wakeup = now + RETRY_INTERVAL;
+
+  }
+
+  if (next_wakeup == 0)
+    return -1;
+
+  return (next_wakeup > now) ? (int) (next_wakeup - now) : 0;
+
+}
@@ -6,7 +6,6 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/array.hpp>
 #include <boost/bind.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/log/trivial.hpp>
 #include <iostream>
 #include <map>
@@ -82,6 +81,25 @@ namespace pgbckctl {
      */
     std::shared_ptr<WorkerSHM> worker_shm = std::make_shared<WorkerSHM>();
 
+    /**
+     * I/O governor throttling data sent to clients according
+     * to the restore budget, nullptr if not governed.
+     */
+    std::shared_ptr<IOGovernor> governor = nullptr;
+
+    /**
+     * Waits for the I/O governor before writing
+     * the protocol buffer to the client.
+     */
+    virtual void start_write() {
+
+      if (governor != nullptr)
+        governor->acquire(this->write_buffer.getSize());
+
+      pgprotocol::PGSocketIOContextInterface::start_write();
+
+    }
+
     /*
      * Internal boost::asio handles.
      */
@@ -136,6 +154,13 @@ namespace pgbckctl {
 
     }
 
+    /**
+     * Called by the listener right before forking a new
+     * connection child. Anything prepared here is inherited
+     * by the child. The default does nothing.
+     */
+    virtual void prepare_fork() {}
+
     void start_accept() {
       this->acpt->async_accept(SOCKET_P(this),
                                boost::bind(&PGBackupCtlStreamingServer::handle_accept,
@@ -146,6 +171,8 @@ namespace pgbckctl {
     void handle_accept(const boost::system::error_code& ec) {
       if (!ec)
         {
+          prepare_fork();
+
           /*
            * Inform the io_service that we are about to fork. The io_service cleans
            * up any internal resources, such as threads, that may interfere with
@@ -192,9 +219,7 @@ namespace pgbckctl {
 
                   child_info.pid = ::getpid();
 
-                  /* we use a scoped lock */
-                  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>(*(worker_shm->check_and_get_mutex()));
-
+                  /* the slot sequence counter serializes concurrent writers */
                   worker_shm->write(streamDescr->worker_id, child_id, child_info);
 
                 }
@@ -339,6 +364,13 @@ namespace pgbckctl {
      */
     virtual void resetQueryState();
 
+    /**
+     * Refreshes the catalog snapshot of the catalog handler
+     * in case it is stale, so that forked childs inherit a
+     * current one.
+     */
+    virtual void prepare_fork();
+
     /*
      * Handles the startup header.
      */
@@ -615,6 +647,12 @@ void PGProtoStreamingServer::run() {
   /* initialization stuff */
   worker_id = streamDescr->worker_id;
 
+  /*
+   * Data sent to recovery clients counts against the
+   * restore budget of the I/O governor.
+   */
+  governor = std::make_shared<IOGovernor>(worker_shm, IO_CLASS_RESTORE);
+
   /*
    * Create global runtime parameters.
    */
@@ -638,6 +676,12 @@ void PGProtoStreamingServer::run() {
    */
   catalogHandler = make_shared<PGProtoCatalogHandler>(streamDescr->catalog_name);
 
+  /*
+   * Take the initial catalog snapshot. Connection childs inherit
+   * it, see prepare_fork().
+   */
+  prepare_fork();
+
   /* Internal startup buffer */
   this->read_header_buffer.allocate(INITIAL_STARTUP_BUFFER_SIZE);
 
@@ -1514,6 +1558,25 @@ void PGProtoStreamingServer::process_startup_guc() {
 
 }
 
+void PGProtoStreamingServer::prepare_fork() {
+
+  try {
+
+    catalogHandler->getSnapshot(streamDescr->archive_id, worker_shm);
+
+  } catch (CPGBackupCtlFailure &e) {
+
+    /*
+     * Not fatal, the child will try again on its own when
+     * it needs the snapshot.
+     */
+    BOOST_LOG_TRIVIAL(warning) << "could not refresh catalog snapshot: "
+                               << e.what();
+
+  }
+
+}
+
 void PGProtoStreamingServer::resetQueryState() {
 
   processed_rows = 0;
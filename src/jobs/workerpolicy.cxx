@@ -0,0 +1,352 @@
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sstream>
+
+#include <boost/log/trivial.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <workerpolicy.hxx>
+
+using namespace pgbckctl;
+
+/*
+ * Neither glibc nor all kernel header versions we build against
+ * provide wrappers or definitions for the I/O priority and memory
+ * policy system calls, so keep what we need here.
+ */
+#define WORKER_IOPRIO_WHO_PROCESS 1
+#define WORKER_IOPRIO_CLASS_SHIFT 13
+#define WORKER_IOPRIO_PRIO_MASK ((1UL << WORKER_IOPRIO_CLASS_SHIFT) - 1)
+
+#define WORKER_MPOL_DEFAULT 0
+#define WORKER_MPOL_BIND 2
+
+/*
+ * Maximum number of NUMA nodes a policy can refer to.
+ */
+#define WORKER_MAX_NUMA_NODES 1024
+
+/*
+ * Copies the specified string into a fixed size buffer
+ * of a worker_policy_info, truncating it if necessary.
+ */
+static void policy_info_copy(char *dest, size_t size, std::string value) {
+
+  strncpy(dest, value.c_str(), size - 1);
+  dest[size - 1] = '\0';
+
+}
+
+/* ****************************************************************************
+ * Implementation WorkerPolicy
+ * ****************************************************************************/
+
+std::vector<bool> WorkerPolicy::parseList(std::string list, unsigned int max) {
+
+  std::vector<bool> flags(max, false);
+  std::vector<std::string> items;
+
+  boost::split(items, list, boost::is_any_of(","));
+
+  for (auto &item : items) {
+
+    std::vector<std::string> bounds;
+    unsigned long lower;
+    unsigned long upper;
+
+    boost::trim(item);
+    boost::split(bounds, item, boost::is_any_of("-"));
+
+    if (bounds.size() > 2) {
+      throw WorkerPolicyFailure("invalid range \"" + item + "\"");
+    }
+
+    for (auto &bound : bounds) {
+
+      boost::trim(bound);
+
+      if (bound.length() == 0 || bound.length() > 5
+          || bound.find_first_not_of("0123456789") != std::string::npos) {
+        throw WorkerPolicyFailure("\"" + item + "\" is not a number or range");
+      }
+
+    }
+
+    lower = std::stoul(bounds[0]);
+    upper = (bounds.size() == 2) ? std::stoul(bounds[1]) : lower;
+
+    if (lower > upper) {
+      throw WorkerPolicyFailure("invalid range \"" + item + "\"");
+    }
+
+    if (upper >= max) {
+      std::ostringstream oss;
+
+      oss << "\"" << item << "\" exceeds maximum " << (max - 1);
+      throw WorkerPolicyFailure(oss.str());
+    }
+
+    for (unsigned long i = lower; i <= upper; i++)
+      flags[i] = true;
+
+  }
+
+  return flags;
+
+}
+
+std::string WorkerPolicy::listToString(std::vector<bool> &flags) {
+
+  std::ostringstream oss;
+  unsigned int i = 0;
+
+  while (i < flags.size()) {
+
+    unsigned int start;
+
+    if (!flags[i]) {
+      i++;
+      continue;
+    }
+
+    start = i;
+
+    while (i + 1 < flags.size() && flags[i + 1])
+      i++;
+
+    if (oss.tellp() > 0)
+      oss << ",";
+
+    oss << start;
+
+    if (i > start)
+      oss << "-" << i;
+
+    i++;
+
+  }
+
+  return oss.str();
+
+}
+
+std::string WorkerPolicy::typeName(int type) {
+
+  switch(type) {
+  case WORKER_POLICY_WALSTREAMER:
+    return "walstreamer";
+  case WORKER_POLICY_BASEBACKUP:
+    return "basebackup";
+  case WORKER_POLICY_RECOVERY:
+    return "recovery";
+  default:
+    return "default";
+  }
+
+}
+
+std::string WorkerPolicy::ioprioClassName(int ioprio_class) {
+
+  switch(ioprio_class) {
+  case WORKER_IOPRIO_REALTIME:
+    return "realtime";
+  case WORKER_IOPRIO_BEST_EFFORT:
+    return "best-effort";
+  case WORKER_IOPRIO_IDLE:
+    return "idle";
+  default:
+    return "inherit";
+  }
+
+}
+
+WorkerIOPrioClass WorkerPolicy::stringToIOPrioClass(std::string name) {
+
+  if (name == "realtime")
+    return WORKER_IOPRIO_REALTIME;
+
+  if (name == "best-effort")
+    return WORKER_IOPRIO_BEST_EFFORT;
+
+  if (name == "idle")
+    return WORKER_IOPRIO_IDLE;
+
+  if (name == "inherit" || name == "")
+    return WORKER_IOPRIO_INHERIT;
+
+  throw WorkerPolicyFailure("invalid I/O scheduling class \"" + name + "\"");
+
+}
+
+WorkerPolicyType WorkerPolicy::typeOf(CatalogTag tag) {
+
+  switch(tag) {
+  case START_STREAMING_FOR_ARCHIVE:
+    return WORKER_POLICY_WALSTREAMER;
+  case START_BASEBACKUP:
+    return WORKER_POLICY_BASEBACKUP;
+  case START_RECOVERY_STREAM_FOR_ARCHIVE:
+    return WORKER_POLICY_RECOVERY;
+  default:
+    return WORKER_POLICY_DEFAULT;
+  }
+
+}
+
+void WorkerPolicy::validate() {
+
+  if (this->cpus.length() > 0)
+    WorkerPolicy::parseList(this->cpus, CPU_SETSIZE);
+
+  if (this->numa_nodes.length() > 0)
+    WorkerPolicy::parseList(this->numa_nodes, WORKER_MAX_NUMA_NODES);
+
+  if (this->nice.length() > 0) {
+
+    int level;
+    size_t pos = 0;
+
+    try {
+      level = std::stoi(this->nice, &pos);
+    } catch (std::exception &e) {
+      pos = 0;
+    }
+
+    if (pos == 0 || pos != this->nice.length() || level < -20 || level > 19) {
+      throw WorkerPolicyFailure("invalid nice level \"" + this->nice + "\"");
+    }
+
+  }
+
+  if (this->ioprio_level < 0 || this->ioprio_level > 7) {
+    throw WorkerPolicyFailure("I/O scheduling level must be between 0 and 7");
+  }
+
+}
+
+worker_policy_info WorkerPolicy::apply(WorkerPolicyType type) {
+
+  this->validate();
+
+  if (this->cpus.length() > 0) {
+
+    std::vector<bool> flags = WorkerPolicy::parseList(this->cpus, CPU_SETSIZE);
+    cpu_set_t cpuset;
+
+    CPU_ZERO(&cpuset);
+
+    for (unsigned int i = 0; i < flags.size(); i++) {
+      if (flags[i])
+        CPU_SET(i, &cpuset);
+    }
+
+    if (sched_setaffinity(0, sizeof(cpuset), &cpuset) < 0) {
+      BOOST_LOG_TRIVIAL(warning) << "could not set CPU affinity \"" << this->cpus
+                                 << "\" for " << WorkerPolicy::typeName(type)
+                                 << " worker: " << strerror(errno);
+    }
+
+  }
+
+  if (this->numa_nodes.length() > 0) {
+
+    std::vector<bool> flags = WorkerPolicy::parseList(this->numa_nodes, WORKER_MAX_NUMA_NODES);
+    unsigned long nodemask[WORKER_MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+
+    memset(nodemask, 0, sizeof(nodemask));
+
+    for (unsigned int i = 0; i < flags.size(); i++) {
+      if (flags[i])
+        nodemask[i / (8 * sizeof(unsigned long))] |= 1UL << (i % (8 * sizeof(unsigned long)));
+    }
+
+    if (syscall(SYS_set_mempolicy, WORKER_MPOL_BIND, nodemask, WORKER_MAX_NUMA_NODES) < 0) {
+      BOOST_LOG_TRIVIAL(warning) << "could not bind memory to NUMA nodes \"" << this->numa_nodes
+                                 << "\" for " << WorkerPolicy::typeName(type)
+                                 << " worker: " << strerror(errno);
+    }
+
+  }
+
+  if (this->nice.length() > 0) {
+
+    if (setpriority(PRIO_PROCESS, 0, std::stoi(this->nice)) < 0) {
+      BOOST_LOG_TRIVIAL(warning) << "could not set nice level " << this->nice
+                                 << " for " << WorkerPolicy::typeName(type)
+                                 << " worker: " << strerror(errno);
+    }
+
+  }
+
+  if (this->ioprio_class != WORKER_IOPRIO_INHERIT) {
+
+    /* The idle class doesn't know any levels */
+    unsigned long level = (this->ioprio_class == WORKER_IOPRIO_IDLE) ? 0 : this->ioprio_level;
+    unsigned long ioprio = ((unsigned long) this->ioprio_class << WORKER_IOPRIO_CLASS_SHIFT) | level;
+
+    if (syscall(SYS_ioprio_set, WORKER_IOPRIO_WHO_PROCESS, 0, ioprio) < 0) {
+      BOOST_LOG_TRIVIAL(warning) << "could not set I/O scheduling class "
+                                 << WorkerPolicy::ioprioClassName(this->ioprio_class)
+                                 << " for " << WorkerPolicy::typeName(type)
+                                 << " worker: " << strerror(errno);
+    }
+
+  }
+
+  return WorkerPolicy::current(type);
+
+}
+
+worker_policy_info WorkerPolicy::current(WorkerPolicyType type) {
+
+  worker_policy_info info;
+  cpu_set_t cpuset;
+  long ioprio;
+  int mode = WORKER_MPOL_DEFAULT;
+  unsigned long nodemask[WORKER_MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+
+  info.type = type;
+
+  CPU_ZERO(&cpuset);
+
+  if (sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0) {
+
+    std::vector<bool> flags(CPU_SETSIZE, false);
+
+    for (unsigned int i = 0; i < CPU_SETSIZE; i++)
+      flags[i] = CPU_ISSET(i, &cpuset);
+
+    policy_info_copy(info.cpus, sizeof(info.cpus), WorkerPolicy::listToString(flags));
+
+  }
+
+  memset(nodemask, 0, sizeof(nodemask));
+
+  if (syscall(SYS_get_mempolicy, &mode, nodemask, WORKER_MAX_NUMA_NODES, 0, 0) == 0
+      && mode == WORKER_MPOL_BIND) {
+
+    std::vector<bool> flags(WORKER_MAX_NUMA_NODES, false);
+
+    for (unsigned int i = 0; i < WORKER_MAX_NUMA_NODES; i++)
+      flags[i] = (nodemask[i / (8 * sizeof(unsigned long))] >> (i % (8 * sizeof(unsigned long)))) & 1UL;
+
+    policy_info_copy(info.numa_nodes, sizeof(info.numa_nodes), WorkerPolicy::listToString(flags));
+
+  }
+
+  info.nice = getpriority(PRIO_PROCESS, 0);
+
+  if ((ioprio = syscall(SYS_ioprio_get, WORKER_IOPRIO_WHO_PROCESS, 0)) >= 0) {
+
+    info.ioprio_class = (int) (ioprio >> WORKER_IOPRIO_CLASS_SHIFT);
+    info.ioprio_level = (int) (ioprio & WORKER_IOPRIO_PRIO_MASK);
+
+  }
+
+  return info;
+
+}
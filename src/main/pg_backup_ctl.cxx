@@ -22,6 +22,8 @@
 #include <output.hxx>
 #include <parser.hxx>
 #include <rtconfig.hxx>
+#include <workerpolicy.hxx>
+#include <cmdchannel.hxx>
 
 using namespace pgbckctl;
 using namespace std;
@@ -68,11 +70,13 @@ typedef struct PGBackupCtlArgs {
   char *relocatedTblspcDir;
   char *action;
   char *actionFile; /* commands read from file */
+  char *submit; /* command executed by the launcher */
   char *catalogDir; /* mandatory or compiled in default */
   char **variables = NULL; /* list of runtime variables to set */
   bool  useCompression;
   int   start_launcher = 0;
   int   start_wal_streaming = 0;
+  int   submit_nowait = 0;
 } PGBackupCtlArgs;
 
 static void handle_signal_on_input(int sig) {
@@ -134,6 +138,8 @@ static void processCmdLineArgs(int argc,
   handle->archive_name = NULL;
   handle->catalogDir   = NULL;
   handle->actionFile   = NULL;
+  handle->submit       = NULL;
+  handle->submit_nowait = 0;
   handle->start_launcher = 0;
   handle->start_wal_streaming = 0;
   handle->backup_profile      = NULL;
@@ -163,6 +169,10 @@ static void processCmdLineArgs(int argc,
       &handle->backup_profile, 0, "specifies a backup profile used by specified actions" },
     { "variable", 'V', POPT_ARG_ARGV,
       &handle->variables, 0, "runtime variables to be set during execution" },
+    { "submit", 'S', POPT_ARG_STRING,
+      &handle->submit, 0, "execute command by the launcher and wait for it to finish" },
+    { "no-wait", 0, POPT_ARG_NONE,
+      &handle->submit_nowait, 0, "with --submit, exit as soon as the launcher accepted the command" },
 
     POPT_AUTOHELP { NULL, 0, 0, NULL, 0 }
   };
@@ -214,6 +224,71 @@ void init_RtCfg() {
    */
   RtCfg->create("walstreamer.wait_timeout", 60, 60, 0, 86400);
 
+  /*
+   * retention.batch_size, number of basebackups APPLY RETENTION POLICY
+   * deletes per catalog transaction.
+   */
+  RtCfg->create("retention.batch_size", 10, 10, 1, 100000);
+
+  /*
+   * launcher.worker_pool_size, number of pre-forked workers a
+   * launcher started afterwards keeps for short background commands.
+   * 0 disables the pool.
+   */
+  RtCfg->create("launcher.worker_pool_size", 0, 0, 0, 64);
+
+  /*
+   * Limits of the launcher job scheduler, see CREATE SCHEDULE. The
+   * basebackup limits count running basebackups per database host
+   * and per archive storage device, 0 means unlimited.
+   */
+  RtCfg->create("scheduler.max_basebackups_per_host", 1, 1, 0, 1024);
+  RtCfg->create("scheduler.max_basebackups_per_device", 2, 2, 0, 1024);
+  RtCfg->create("scheduler.max_start_delay", 60, 60, 0, 3600);
+
+  /*
+   * Budgets of the host wide I/O governor in kB per second,
+   * 0 means unlimited. They are applied by a launcher started
+   * afterwards to all of its workers. WAL streaming has strict
+   * priority within governor.total_rate.
+   */
+  RtCfg->create("governor.total_rate", 0, 0, 0, 1073741824);
+  RtCfg->create("governor.wal_rate", 0, 0, 0, 1073741824);
+  RtCfg->create("governor.basebackup_rate", 0, 0, 0, 1073741824);
+  RtCfg->create("governor.restore_rate", 0, 0, 0, 1073741824);
+
+  /*
+   * Write pipeline of basebackups: number of buffers the received
+   * stream is queued in for the writer and their size in kB. 0
+   * buffers write the stream synchronously.
+   */
+  RtCfg->create("basebackup.write_buffers", 8, 8, 0, 1024);
+  RtCfg->create("basebackup.write_buffer_size", 1024, 1024, 64, 65536);
+
+  /*
+   * Scheduling policies of the workers per job type, applied by
+   * a launcher started afterwards. Empty settings are inherited
+   * from the launcher, see WorkerPolicy.
+   */
+  enums.insert("inherit");
+  enums.insert("realtime");
+  enums.insert("best-effort");
+  enums.insert("idle");
+
+  for (int type = 0; type < WORKER_POLICY_TYPES; type++) {
+
+    std::string prefix = "policy." + WorkerPolicy::typeName(type) + "_";
+
+    RtCfg->create(prefix + "cpus", std::string(""), std::string(""));
+    RtCfg->create(prefix + "numa_nodes", std::string(""), std::string(""));
+    RtCfg->create(prefix + "nice", std::string(""), std::string(""));
+    RtCfg->create(prefix + "ioprio_class", "inherit", "inherit", enums);
+    RtCfg->create(prefix + "ioprio_level", 4, 4, 0, 7);
+
+  }
+
+  enums.clear();
+
   /*
    * The on-error-exit bool parameter causes pg_backup_ctl++ to
    * exit immediately if it gets an error. This most of the time is
@@ -403,6 +478,85 @@ static int handle_inputfile(PGBackupCtlArgs *args) {
   return PG_BACKUP_CTL_SUCCESS;
 }
 
+/*
+ * Executes the --submit command by the launcher of the catalog. The
+ * command is parsed here, the launcher dispatches it by its command
+ * tag. Unless --no-wait was specified, waits for the worker to finish
+ * and prints its progress meanwhile.
+ */
+static int handle_submit(PGBackupCtlArgs *args) {
+
+  shared_ptr<PGBackupCtlCommand> command = makeCommand(string(args->submit));
+  launcher_cmd_request request;
+  launcher_cmd_ack ack;
+  launcher_cmd_done done;
+
+  request.tag = command->getCommandTag();
+  request.archive_name = command->archive_name();
+  request.command = args->submit;
+
+  /*
+   * We are already talking to the launcher, so make sure
+   * the worker doesn't pass the command on again.
+   */
+  switch(request.tag) {
+  case START_STREAMING_FOR_ARCHIVE:
+  case START_RECOVERY_STREAM_FOR_ARCHIVE:
+  case START_METRICS_SERVER:
+    if (command->getExecutableDescr()->detach)
+      request.command += " NODETACH";
+    break;
+  default:
+    break;
+  }
+
+  if (args->submit_nowait == 0)
+    request.flags |= CMD_SUBMIT_WAIT;
+
+  if (!submit_launcher_cmd(path(string(args->catalogDir)).filename().string(),
+                           request, ack, done,
+                           [](pid_t pid, std::vector<worker_instrumentation_item> &items) {
+
+                             cout << "PID " << pid << ":";
+
+                             for (auto &item : items) {
+                               cout << " " << WorkerInstrumentation::keyName(item.key)
+                                    << "=" << WorkerInstrumentation::valueString(item);
+                             }
+
+                             cout << endl;
+
+                           })) {
+
+    BOOST_LOG_TRIVIAL(error) << "no launcher running for catalog " << args->catalogDir;
+    return PG_BACKUP_CTL_GENERIC_ERROR;
+
+  }
+
+  if (!ack.accepted) {
+    BOOST_LOG_TRIVIAL(error) << "launcher rejected command: " << ack.message;
+    return PG_BACKUP_CTL_GENERIC_ERROR;
+  }
+
+  if (ack.pid > 0)
+    cout << "launcher started worker at PID " << ack.pid << endl;
+  else
+    cout << "launcher passed command to worker pool" << endl;
+
+  if (args->submit_nowait > 0)
+    return PG_BACKUP_CTL_SUCCESS;
+
+  if (!done.success) {
+    BOOST_LOG_TRIVIAL(error) << "command execution failure: " << done.message;
+    return PG_BACKUP_CTL_CATALOG_ERROR;
+  }
+
+  cout << CatalogDescr::commandTagName(request.tag) << endl;
+
+  return PG_BACKUP_CTL_SUCCESS;
+
+}
+
 static void executeCommand(PGBackupCtlArgs *args) {
 
   if (strcmp(args->action, "start-streaming") == 0) {
@@ -636,6 +790,19 @@ int main(int argc, const char **argv) {
       throw CArchiveIssue("--action or --action-file cannot be specified with --wal-streamer");
     }
 
+    /*
+     * --submit is a command of its own.
+     */
+    if ( (args.submit != NULL)
+         && ( (args.action != NULL) || (args.actionFile != NULL)
+              || (args.start_launcher > 0) || (args.start_wal_streaming > 0) ) ) {
+      throw CArchiveIssue("--submit cannot be specified with --action, --action-file, --launcher or --wal-streamer");
+    }
+
+    if ( (args.submit == NULL) && (args.submit_nowait > 0) ) {
+      throw CArchiveIssue("--no-wait requires --submit");
+    }
+
     /*
      * ... and check for mutual exclusive options.
      */
@@ -668,6 +835,10 @@ int main(int argc, const char **argv) {
       return rc;
     }
 
+    if (args.submit != NULL) {
+      return handle_submit(&args);
+    }
+
     /* ***************************************************
      * Command line action command line parameters here...
      * ***************************************************/
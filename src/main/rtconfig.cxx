@@ -327,11 +327,17 @@ IntegerConfigVariable::IntegerConfigVariable(string name,
                                              bool enforceRangeConstraint) : IntegerConfigVariable(name) {
 
   this->setRange(range_min, range_max);
-  this->enforceRangeConstraint(enforceRangeConstraint);
 
+  /*
+   * Assign values before enforcing the range, enforceRangeConstraint()
+   * checks them immediately, so the initial zero values would
+   * violate ranges not including zero.
+   */
   this->setDefault(default_value);
   this->setValue(value);
 
+  this->enforceRangeConstraint(enforceRangeConstraint);
+
 }
 
 IntegerConfigVariable::IntegerConfigVariable(string name,
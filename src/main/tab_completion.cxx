@@ -310,7 +310,17 @@ completion_word create_connection_completion[]
  * Please note that the initialization of those completion tokens
  * are done during runtime in init_readline() !
  */
-completion_word create_bck_prof_param_full[10] ;
+completion_word create_bck_prof_param_full[12] ;
+
+completion_word create_bck_prof_verify_pages_setting[]
+= { { "TRUE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_bck_prof_param_full + 11, NULL },
+    { "FALSE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_bck_prof_param_full + 11, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word create_bck_prof_dedup_setting[]
+= { { "TRUE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_bck_prof_param_full + 10, NULL },
+    { "FALSE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_bck_prof_param_full + 10, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
 
 completion_word create_bck_prof_manifest_checksums_setting[]
 = { { "NONE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_bck_prof_param_full + 9, NULL },
@@ -450,11 +460,51 @@ completion_word create_retention_completion[]
 = { { "POLICY", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_retention_ident, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
 
+completion_word create_schedule_profile_ident_compl[]
+= { { "<identifier>", COMPL_IDENTIFIER, COMPL_STATIC_ARRAY, NULL, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word create_schedule_basebackup_compl[]
+= { { "PROFILE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_schedule_profile_ident_compl, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word create_schedule_retention_compl[]
+= { { "POLICY", COMPL_KEYWORD, COMPL_FUNC_SQL, NULL,
+      (completion_callback) compl_retention_identifier },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word create_schedule_job_compl[]
+= { { "BASEBACKUP", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_schedule_basebackup_compl, NULL },
+    { "RETENTION", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_schedule_retention_compl, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word create_schedule_cron_expr_compl[]
+= { { "\"<cron expression>\"", COMPL_IDENTIFIER, COMPL_STATIC_ARRAY, create_schedule_job_compl, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word create_schedule_cron_compl[]
+= { { "CRON", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_schedule_cron_expr_compl, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word create_schedule_archive_compl[]
+= { { "ARCHIVE", COMPL_KEYWORD, COMPL_FUNC_SQL, create_schedule_cron_compl,
+      (completion_callback) compl_archive_identifier },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word create_schedule_for_compl[]
+= { { "FOR", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_schedule_archive_compl, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word create_schedule_completion[]
+= { { "<identifier>", COMPL_IDENTIFIER, COMPL_STATIC_ARRAY, create_schedule_for_compl, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
 completion_word create_completion[]
 = { { "ARCHIVE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_archive_ident_completion, NULL  },
     { "STREAMING", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_connection_completion, NULL },
     { "BACKUP", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_backup_profile_completion, NULL },
     { "RETENTION", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_retention_completion, NULL },
+    { "SCHEDULE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_schedule_completion, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } /* marks end of list */ };
 
 completion_word list_backup_completion[]
@@ -488,6 +538,7 @@ completion_word list_completion[]
     { "BASEBACKUPS", COMPL_KEYWORD, COMPL_STATIC_ARRAY, list_backup_list_completion, NULL },
     { "CONNECTION", COMPL_KEYWORD, COMPL_STATIC_ARRAY, list_connection_for_completion, NULL },
     { "RETENTION", COMPL_KEYWORD, COMPL_STATIC_ARRAY, list_retention_completion, NULL },
+    { "SCHEDULES", COMPL_KEYWORD, COMPL_STATIC_ARRAY, list_connection_for_completion, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } /* marks end of list */ };
 
 completion_word start_basebackup_opt_force_sysid_upd[]
@@ -574,11 +625,16 @@ completion_word start_recovery_compl[]
 = { { "STREAM" , COMPL_KEYWORD, COMPL_STATIC_ARRAY, start_recovery_stream, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
 
+completion_word start_metrics_compl[]
+= { { "SERVER" , COMPL_KEYWORD, COMPL_STATIC_ARRAY, recovery_stream_listen_port, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
 completion_word start_completion[]
 = { { "BASEBACKUP", COMPL_KEYWORD, COMPL_STATIC_ARRAY, start_basebackup_for, NULL },
     { "STREAMING", COMPL_KEYWORD, COMPL_STATIC_ARRAY, start_streaming_for, NULL },
     { "LAUNCHER", COMPL_KEYWORD, COMPL_STATIC_ARRAY, NULL, NULL },
     { "RECOVERY", COMPL_KEYWORD, COMPL_STATIC_ARRAY, start_recovery_compl, NULL },
+    { "METRICS", COMPL_KEYWORD, COMPL_STATIC_ARRAY, start_metrics_compl, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
 
 completion_word verify_archive_options[]
@@ -637,12 +693,17 @@ completion_word drop_retention_policy_compl[]
 = { { "POLICY", COMPL_KEYWORD, COMPL_STATIC_ARRAY, drop_retention_ident_compl, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
 
+completion_word drop_schedule_ident_compl[]
+= { { "<identifier>", COMPL_IDENTIFIER, COMPL_STATIC_ARRAY, drop_connection_from_completion, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
 completion_word drop_completion[]
 = { { "ARCHIVE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, list_archive_ident_completion, NULL },
     { "STREAMING", COMPL_KEYWORD, COMPL_STATIC_ARRAY, drop_connection_completion, NULL },
     { "BACKUP", COMPL_KEYWORD, COMPL_STATIC_ARRAY, drop_profile_completion, NULL },
     { "BASEBACKUP", COMPL_KEYWORD, COMPL_STATIC_ARRAY, drop_basebackup_completion, NULL },
     { "RETENTION", COMPL_KEYWORD, COMPL_STATIC_ARRAY, drop_retention_policy_compl, NULL },
+    { "SCHEDULE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, drop_schedule_ident_compl, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
 
 completion_word alter_archive_set_completion[]
@@ -661,8 +722,13 @@ completion_word show_completion_variable[]
 = { { "<variable>", COMPL_IDENTIFIER, COMPL_STATIC_ARRAY, NULL, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
 
+completion_word show_completion_events[]
+= { { "PID", COMPL_KEYWORD, COMPL_STATIC_ARRAY, NULL, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
 completion_word show_completion[]
 = { { "WORKERS", COMPL_KEYWORD, COMPL_STATIC_ARRAY, NULL, NULL },
+    { "EVENTS", COMPL_KEYWORD, COMPL_STATIC_ARRAY, show_completion_events, NULL },
     { "VARIABLES", COMPL_KEYWORD, COMPL_STATIC_ARRAY, NULL, NULL },
     { "VARIABLE", COMPL_KEYWORD, COMPL_FUNC_SQL, NULL,
       (completion_callback) compl_variable },
@@ -709,8 +775,16 @@ completion_word pin_completion[]
     { "<BASEBACKUP ID>", COMPL_KEYWORD, COMPL_STATIC_ARRAY, pin_completion_in, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
 
+completion_word apply_retention_dry_run[]
+= { { "RUN", COMPL_END, COMPL_STATIC_ARRAY, NULL, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
+completion_word apply_retention_options[]
+= { { "DRY", COMPL_KEYWORD, COMPL_STATIC_ARRAY, apply_retention_dry_run, NULL },
+    { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
+
 completion_word apply_retention_archive_name[]
-= { { "<identifier>", COMPL_IDENTIFIER, COMPL_STATIC_ARRAY, NULL, NULL },
+= { { "<identifier>", COMPL_IDENTIFIER, COMPL_STATIC_ARRAY, apply_retention_options, NULL },
     { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } };
 
 completion_word apply_retention_archive[]
@@ -953,6 +1027,10 @@ void init_readline(std::string catalog_name,
   completion_word create_bck_prof_w8
     = { "WITH", COMPL_KEYWORD, COMPL_STATIC_ARRAY, bck_prof_with_checksum, NULL } ;
   completion_word create_bck_prof_w9
+    = { "DEDUPLICATE", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_bck_prof_dedup_setting, NULL } ;
+  completion_word create_bck_prof_w10
+    = { "VERIFY_PAGES", COMPL_KEYWORD, COMPL_STATIC_ARRAY, create_bck_prof_verify_pages_setting, NULL } ;
+  completion_word create_bck_prof_w11
     = { "", COMPL_EOL, COMPL_STATIC_ARRAY, NULL, NULL } ;
 
   create_bck_prof_param_full[0] = create_bck_prof_w0;
@@ -965,6 +1043,8 @@ void init_readline(std::string catalog_name,
   create_bck_prof_param_full[7] = create_bck_prof_w7;
   create_bck_prof_param_full[8] = create_bck_prof_w8;
   create_bck_prof_param_full[9] = create_bck_prof_w9;
+  create_bck_prof_param_full[10] = create_bck_prof_w10;
+  create_bck_prof_param_full[11] = create_bck_prof_w11;
 
   /*
    * Initialize catalog handle for completion queries, iff
@@ -1,4 +1,3 @@
-#include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 #include <commands.hxx>
@@ -11,9 +10,30 @@
 #include <rtconfig.hxx>
 
 #include <server.hxx>
+#include <metricsserver.hxx>
+#include <scheduler.hxx>
+#include <cmdchannel.hxx>
+#include <verify.hxx>
+#include <fs-chunks.hxx>
+#include <pagechecksum.hxx>
+#include <resume.hxx>
 
 using namespace pgbckctl;
 
+/*
+ * Logs the worker a command passed to the launcher was
+ * dispatched to. The PID isn't known if the launcher wasn't
+ * listening on its command channel.
+ */
+static void launcher_dispatched(pid_t worker_pid) {
+
+  if (worker_pid > 0)
+    BOOST_LOG_TRIVIAL(info) << "launcher started worker at PID " << worker_pid;
+  else
+    BOOST_LOG_TRIVIAL(info) << "command queued for launcher";
+
+}
+
 BaseCatalogCommand::~BaseCatalogCommand() {}
 
 void BaseCatalogCommand::copy(CatalogDescr& source) {
@@ -31,6 +51,9 @@ void BaseCatalogCommand::copy(CatalogDescr& source) {
   this->directory    = source.directory;
   this->check_connection = source.check_connection;
   this->force_systemid_update = source.force_systemid_update;
+  this->incremental = source.incremental;
+  this->resume = source.resume;
+  this->dry_run = source.dry_run;
   this->forceXLOGPosRestart = source.forceXLOGPosRestart;
   this->verbose_output = source.verbose_output;
 
@@ -105,6 +128,18 @@ void BaseCatalogCommand::copy(CatalogDescr& source) {
   if (source.getRecoveryStreamDescr() != nullptr)
     this->recoveryStream = source.getRecoveryStreamDescr();
 
+  /*
+   * Copy over metrics server descriptor, if any.
+   */
+  if (source.getMetricsServerDescr() != nullptr)
+    this->metricsServer = source.getMetricsServerDescr();
+
+  /*
+   * Copy over schedule descriptor, if any.
+   */
+  if (source.getScheduleDescr() != nullptr)
+    this->schedule = source.getScheduleDescr();
+
   /*
    * In case this instance was instantiated
    * by a SET <variable> parser command, copy
@@ -117,6 +152,8 @@ void BaseCatalogCommand::copy(CatalogDescr& source) {
   this->var_val_int = source.var_val_int;
   this->var_val_bool = source.var_val_bool;
   this->basebackup_id = source.basebackup_id;
+  this->worker_pid = source.worker_pid;
+  this->parallel = source.parallel;
 
 }
 
@@ -139,6 +176,62 @@ void BaseCatalogCommand::setWorkerID(int worker_id) {
 
 }
 
+std::shared_ptr<WorkerInstrumentation> BaseCatalogCommand::workerInstrumentation() {
+
+  std::shared_ptr<WorkerSHM> shm = nullptr;
+
+  if (this->worker_id < 0 || this->catalog == nullptr)
+    return nullptr;
+
+  shm = std::make_shared<WorkerSHM>();
+
+  /*
+   * No worker shared memory means no one could
+   * look at the instrumentation anyways.
+   */
+  if (!shm->attach(this->catalog->fullname(), true))
+    return nullptr;
+
+  return std::make_shared<WorkerInstrumentation>(shm, this->worker_id);
+
+}
+
+std::shared_ptr<WorkerEventLog> BaseCatalogCommand::workerEventLog() {
+
+  std::shared_ptr<WorkerSHM> shm = nullptr;
+
+  if (this->worker_id < 0 || this->catalog == nullptr)
+    return nullptr;
+
+  shm = std::make_shared<WorkerSHM>();
+
+  if (!shm->attach(this->catalog->fullname(), true))
+    return nullptr;
+
+  return std::make_shared<WorkerEventLog>(shm, this->worker_id);
+
+}
+
+std::shared_ptr<IOGovernor> BaseCatalogCommand::ioGovernor(IOGovernorClass job_class) {
+
+  std::shared_ptr<WorkerSHM> shm = nullptr;
+
+  if (this->catalog == nullptr)
+    return nullptr;
+
+  shm = std::make_shared<WorkerSHM>();
+
+  /*
+   * The budgets are maintained by the launcher, without
+   * one there is nothing to govern.
+   */
+  if (!shm->attach(this->catalog->fullname(), true))
+    return nullptr;
+
+  return std::make_shared<IOGovernor>(shm, job_class);
+
+}
+
 void BaseCatalogCommand::assignSigIntHandler(JobSignalHandler *handler) {
 
   /*
@@ -253,6 +346,17 @@ void DropBasebackupCatalogCommand::execute(bool flag) {
       throw CArchiveIssue(oss.str());
     }
 
+    /*
+     * Incremental basebackups can't be restored without their
+     * parent, so refuse to drop it as long as they exist.
+     */
+    if (this->catalog->getIncrementalChildCount(bbDescr->id) > 0) {
+      std::ostringstream oss;
+
+      oss << "basebackup with ID \"" << bbDescr->id << "\" is the parent of incremental basebackups";
+      throw CArchiveIssue(oss.str());
+    }
+
     /*
      * Referenced archive and basebackup exist, unlink the physical
      * files associated with the current basebackup descriptor.
@@ -265,6 +369,19 @@ void DropBasebackupCatalogCommand::execute(bool flag) {
      * this issue and proceed, but print a WARNING indicating that there was an
      * orphaned catalog entry.
      */
+    {
+      std::vector<std::string> chunks;
+
+      /*
+       * Chunks of a deduplicated basebackup are shared, just release
+       * them. Retention removes them once they're unreferenced.
+       */
+      for (auto &chunk : ChunkRecipe::chunks(path(bbDescr->fsentry)))
+        chunks.push_back(chunk.first);
+
+      this->catalog->unreferenceChunks(archiveDescr->id, chunks);
+    }
+
     try {
 
       BackupDirectory::unlink_path(path(bbDescr->fsentry));
@@ -283,6 +400,7 @@ void DropBasebackupCatalogCommand::execute(bool flag) {
 
     /* And we're done */
     this->catalog->commitTransaction();
+    catalog_changed(this->catalog->fullname());
 
   } catch (CPGBackupCtlFailure &ci) {
 
@@ -295,6 +413,84 @@ void DropBasebackupCatalogCommand::execute(bool flag) {
 
 }
 
+VerifyBasebackupCatalogCommand::VerifyBasebackupCatalogCommand(shared_ptr<CatalogDescr> descr) {
+
+  this->copy(*(descr.get()));
+
+}
+
+VerifyBasebackupCatalogCommand::VerifyBasebackupCatalogCommand(shared_ptr<BackupCatalog> catalog) {
+
+  this->setCommandTag(VERIFY_BASEBACKUP);
+  this->catalog = catalog;
+
+}
+
+VerifyBasebackupCatalogCommand::VerifyBasebackupCatalogCommand() {}
+
+VerifyBasebackupCatalogCommand::~VerifyBasebackupCatalogCommand() {}
+
+void VerifyBasebackupCatalogCommand::execute(bool flag) {
+
+  std::shared_ptr<CatalogDescr> archiveDescr = nullptr;
+  std::shared_ptr<BaseBackupDescr> bbDescr = nullptr;
+  std::shared_ptr<BaseBackupVerifyResult> result = nullptr;
+
+  if (this->catalog == nullptr) {
+    throw CArchiveIssue("could not execute VERIFY BASEBACKUP command: no catalog");
+  }
+
+  /*
+   * Read only access is sufficient, verification results
+   * aren't recorded in the catalog.
+   */
+  if (!this->catalog->available()) {
+    this->catalog->open_ro();
+  }
+
+  archiveDescr = this->catalog->existsByName(this->archive_name);
+
+  if (archiveDescr->id < 0) {
+    std::ostringstream oss;
+
+    oss << "archive \"" << this->archive_name << "\" does not exist";
+    throw CArchiveIssue(oss.str());
+  }
+
+  bbDescr = this->catalog->getBaseBackup(this->basebackup_id, archiveDescr->id);
+
+  if (bbDescr->id < 0) {
+    std::ostringstream oss;
+
+    oss << "basebackup with ID \"" << this->basebackup_id << "\" does not exist";
+    throw CArchiveIssue(oss.str());
+  }
+
+  BackupDirectory archiveDir(path(archiveDescr->directory));
+  BaseBackupVerifier verifier(bbDescr, archiveDir.logdir(), this->parallel);
+
+  result = verifier.verify();
+  result->archive_name = this->archive_name;
+
+  shared_ptr<OutputFormatConfiguration> output_config
+    = std::make_shared<OutputFormatConfiguration>();
+  shared_ptr<OutputFormatter> formatter = OutputFormatter::formatter(output_config,
+                                                                     catalog,
+                                                                     getOutputFormat());
+  ostringstream output;
+  formatter->nodeAs(result, output);
+  cout << output.str();
+
+  if (result->failures() > 0) {
+    std::ostringstream oss;
+
+    oss << "verification of basebackup " << bbDescr->id << " failed with "
+        << result->failures() << " errors";
+    throw CArchiveIssue(oss.str());
+  }
+
+}
+
 ResetVariableCatalogCommand::ResetVariableCatalogCommand(shared_ptr<CatalogDescr> descr) {
 
   this->copy(*(descr.get()));
@@ -520,8 +716,10 @@ void StartRecoveryArchiveCommand::execute(bool flag) {
 
     /* Job descriptor needs a dummy handle */
     jobDescr.cmdHandle = make_shared<BackgroundWorkerCommandHandle>(this->catalog);
-    establish_launcher_cmd_queue(jobDescr);
-    send_launcher_cmd(jobDescr, mycmd.str());
+    launcher_dispatched(dispatch_launcher_cmd(jobDescr,
+                                              START_RECOVERY_STREAM_FOR_ARCHIVE,
+                                              this->archive_name,
+                                              mycmd.str()));
 
     /* And we're done. We exit this command handler, the legwork
      * will be done by the background launcher.
@@ -561,15 +759,13 @@ void StartRecoveryArchiveCommand::execute(bool flag) {
     wa.started = CPGBackupCtlBase::ISO8601_strTo_ptime(CPGBackupCtlBase::current_timestamp());
     wa.archive_id = streamDescr->archive_id;
     wa.cmdType = this->tag;
+    wa.policy = WorkerPolicy::current(WorkerPolicy::typeOf(this->tag));
 
     shm.attach(this->catalog->fullname(), true);
 
-    {
-      boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>(*(shm.check_and_get_mutex()));
-      worker_slot_index = shm.allocate(wa);
-      this->worker_id = worker_slot_index;
-      streamDescr->worker_id = this->worker_id;
-    }
+    worker_slot_index = shm.allocate(wa);
+    this->worker_id = worker_slot_index;
+    streamDescr->worker_id = this->worker_id;
 
     } catch (SHMFailure &shmfailure) {
 
@@ -602,6 +798,139 @@ void StartRecoveryArchiveCommand::execute(bool flag) {
 
 }
 
+StartMetricsServerCommand::StartMetricsServerCommand(shared_ptr<BackupCatalog> catalog) {
+
+  this->setCommandTag(tag);
+  this->catalog = catalog;
+
+}
+
+StartMetricsServerCommand::StartMetricsServerCommand(shared_ptr<CatalogDescr> descr) {
+
+  this->copy(*(descr.get()));
+
+}
+
+StartMetricsServerCommand::StartMetricsServerCommand() {
+
+  this->tag = START_METRICS_SERVER;
+
+}
+
+StartMetricsServerCommand::~StartMetricsServerCommand() {}
+
+void StartMetricsServerCommand::execute(bool flag) {
+
+  WorkerSHM shm;
+  bool own_worker_slot = false;
+
+  /*
+   * Die hard in case no catalog available.
+   */
+  if (this->catalog == nullptr) {
+    throw CArchiveIssue("could not execute catalog command: no catalog");
+  }
+
+  /*
+   * Check if we are supposed to run from background.
+   */
+  if (this->detach) {
+
+    job_info jobDescr;
+
+    /*
+     * We must rebuild our command again to pass it
+     * over to the background launcher process.
+     */
+    ostringstream mycmd;
+
+    mycmd << "START METRICS SERVER PORT " << this->metricsServer->port;
+
+    if (this->metricsServer->listen_on.size() > 0) {
+
+      string separator = "";
+
+      mycmd << " LISTEN_ON ( ";
+
+      for(auto const &ipaddress : this->metricsServer->listen_on) {
+
+        mycmd << separator << ipaddress;
+        separator = ", ";
+
+      }
+
+      mycmd << " ) ";
+
+    }
+
+    /*
+     * Make sure background worker doesn't detach again.
+     */
+    mycmd << " NODETACH";
+
+    /* Job descriptor needs a dummy handle */
+    jobDescr.cmdHandle = make_shared<BackgroundWorkerCommandHandle>(this->catalog);
+    launcher_dispatched(dispatch_launcher_cmd(jobDescr,
+                                              START_METRICS_SERVER,
+                                              "",
+                                              mycmd.str()));
+
+    return;
+
+  }
+
+  shared_ptr<MetricsServerDescr> metricsDescr = getMetricsServerDescr();
+  metricsDescr->catalog_name = catalog->fullname();
+
+  /*
+   * Like START RECOVERY STREAM, register ourselves in the worker
+   * shared memory if we weren't started by the launcher. Without
+   * a launcher, there's no shared memory to register in, but we still
+   * export catalog metrics then.
+   */
+  if (worker_id < 0) {
+
+    try {
+
+      if (shm.attach(this->catalog->fullname(), true)) {
+
+        shm_worker_area wa;
+
+        wa.pid = ::getpid();
+        wa.started = CPGBackupCtlBase::ISO8601_strTo_ptime(CPGBackupCtlBase::current_timestamp());
+        wa.cmdType = this->tag;
+        wa.policy = WorkerPolicy::current(WorkerPolicy::typeOf(this->tag));
+
+        this->worker_id = shm.allocate(wa);
+        own_worker_slot = true;
+
+      }
+
+    } catch (SHMFailure &shmfailure) {
+
+      /* re-throw as CPGBackupCtlFailure */
+      throw CPGBackupCtlFailure(shmfailure.what());
+
+    }
+
+  }
+
+  metricsDescr->worker_id = this->worker_id;
+
+  MetricsServer srv(metricsDescr);
+
+  BOOST_LOG_TRIVIAL(info) << "instantiated metrics server with port "
+                          << metricsDescr->port;
+
+  srv.run();
+
+  if (own_worker_slot) {
+    shm.free(this->worker_id);
+    shm.detach();
+  }
+
+}
+
 void ShowVariableCatalogCommand::execute(bool flag) {
 
   /* throws in case variable is unkown */
@@ -773,38 +1102,29 @@ void ShowWorkersCommandHandle::execute(bool noop) {
    * area for background workers.
    *
    * We fetch all occupied worker shared memory
-   * slots into a local vector in one step to avoid
-   * doing catalog lookups while holding the shared memory
-   * lock.
+   * slots into a local vector in one step, so catalog
+   * lookups for the output don't see slots changing
+   * underneath.
    */
   WorkerSHM shm;
   vector<shm_worker_area> slots_used;
 
   shm.attach(this->catalog->fullname(), true);
 
-  /*
-   * New scope for scoped_lock...
-   */
-  {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>(*(shm.check_and_get_mutex()));
-    for (unsigned int i = 0; i < shm.getMaxWorkers(); i++) {
+  for (unsigned int i = 0; i < shm.getMaxWorkers(); i++) {
 
-      try {
-
-        shm_worker_area worker = shm.read(i);
-
-        if (worker.pid > 0) {
-
-          slots_used.push_back(worker);
+    /* Unused slots don't need to be copied at all */
+    if (shm.isEmpty(i))
+      continue;
 
-        }
+    shm_worker_area worker = shm.read(i);
 
-      } catch(SHMFailure &e) {
+    if (worker.pid > 0) {
 
-        throw e;
-      }
+      slots_used.push_back(worker);
 
     }
+
   }
 
   shm.detach();
@@ -825,6 +1145,73 @@ void ShowWorkersCommandHandle::execute(bool noop) {
 
 }
 
+ShowEventsCommandHandle::ShowEventsCommandHandle(std::shared_ptr<BackupCatalog> catalog) {
+  this->setCommandTag(tag);
+  this->catalog = catalog;
+}
+
+ShowEventsCommandHandle::ShowEventsCommandHandle(std::shared_ptr<CatalogDescr> descr) {
+
+  this->copy(*(descr.get()));
+
+}
+
+ShowEventsCommandHandle::ShowEventsCommandHandle(){}
+
+ShowEventsCommandHandle::~ShowEventsCommandHandle() {}
+
+void ShowEventsCommandHandle::execute(bool noop) {
+
+  /*
+   * The event logs are kept in the worker shared memory
+   * segment, which outlives the launcher and its workers. So
+   * this works after a worker or the launcher has crashed, as
+   * long as nobody has removed the segment.
+   */
+  WorkerSHM shm;
+  vector<worker_event> events;
+
+  if (shm.attach(this->catalog->fullname(), true)) {
+
+    for (unsigned int i = 0; i < shm.getMaxWorkers(); i++) {
+
+      vector<worker_event> slot_events = shm.readEvents(i);
+
+      for (auto &event : slot_events) {
+
+        if (this->worker_pid > 0 && event.pid != this->worker_pid)
+          continue;
+
+        events.push_back(event);
+
+      }
+
+    }
+
+    shm.detach();
+
+  }
+
+  /*
+   * Every slot holds the history of all workers which
+   * occupied it, so merge them by time.
+   */
+  std::stable_sort(events.begin(), events.end(),
+                   [](const worker_event &a, const worker_event &b) {
+                     return a.timestamp < b.timestamp;
+                   });
+
+  shared_ptr<OutputFormatConfiguration> output_config
+    = std::make_shared<OutputFormatConfiguration>();
+  shared_ptr<OutputFormatter> formatter = OutputFormatter::formatter(output_config,
+                                                                     catalog,
+                                                                     getOutputFormat());
+  ostringstream output;
+  formatter->nodeAs(events, output);
+  cout << output.str();
+
+}
+
 ExecCommandCatalogCommand::ExecCommandCatalogCommand(std::shared_ptr<CatalogDescr> descr) {
 
   this->copy(*(descr.get()));
@@ -1239,6 +1626,118 @@ void StartLauncherCatalogCommand::execute(bool flag) {
    */
   job_info.cmdHandle = std::make_shared<BackgroundWorkerCommandHandle>(this->catalog);
 
+  /*
+   * Workers execute their commands with the runtime
+   * configuration the launcher was started with.
+   */
+  job_info.runtime_config = this->getRuntimeConfiguration();
+
+  /*
+   * Number of pre-forked workers executing short background
+   * commands, 0 disables the worker pool.
+   */
+  if (this->getRuntimeConfiguration() != nullptr) {
+
+    try {
+
+      int pool_size = 0;
+
+      this->getRuntimeConfiguration()->get("launcher.worker_pool_size")->getValue(pool_size);
+      job_info.worker_pool_size = (pool_size > 0) ? pool_size : 0;
+
+    } catch (CPGBackupCtlFailure &e) {
+      /* not configured, no worker pool then */
+    }
+
+    /*
+     * Limits of the job scheduler, keep the defaults
+     * from job_info if not configured.
+     */
+    try {
+
+      int max_per_host = 0;
+      int max_per_device = 0;
+      int max_start_delay = 0;
+
+      this->getRuntimeConfiguration()->get("scheduler.max_basebackups_per_host")->getValue(max_per_host);
+      this->getRuntimeConfiguration()->get("scheduler.max_basebackups_per_device")->getValue(max_per_device);
+      this->getRuntimeConfiguration()->get("scheduler.max_start_delay")->getValue(max_start_delay);
+
+      job_info.scheduler_max_basebackups_per_host = (max_per_host > 0) ? max_per_host : 0;
+      job_info.scheduler_max_basebackups_per_device = (max_per_device > 0) ? max_per_device : 0;
+      job_info.scheduler_max_start_delay = (max_start_delay > 0) ? max_start_delay : 0;
+
+    } catch (CPGBackupCtlFailure &e) {
+      /* not configured */
+    }
+
+    /*
+     * Budgets of the I/O governor, unlimited if
+     * not configured.
+     */
+    try {
+
+      int total_rate = 0;
+      int wal_rate = 0;
+      int basebackup_rate = 0;
+      int restore_rate = 0;
+
+      this->getRuntimeConfiguration()->get("governor.total_rate")->getValue(total_rate);
+      this->getRuntimeConfiguration()->get("governor.wal_rate")->getValue(wal_rate);
+      this->getRuntimeConfiguration()->get("governor.basebackup_rate")->getValue(basebackup_rate);
+      this->getRuntimeConfiguration()->get("governor.restore_rate")->getValue(restore_rate);
+
+      job_info.governor_total_rate = (total_rate > 0) ? total_rate : 0;
+      job_info.governor_wal_rate = (wal_rate > 0) ? wal_rate : 0;
+      job_info.governor_basebackup_rate = (basebackup_rate > 0) ? basebackup_rate : 0;
+      job_info.governor_restore_rate = (restore_rate > 0) ? restore_rate : 0;
+
+    } catch (CPGBackupCtlFailure &e) {
+      /* not configured */
+    }
+
+    /*
+     * Worker scheduling policies per job type. Unlike the
+     * settings above, malformed policies are reported, since the
+     * workers would silently run without them otherwise.
+     */
+    for (int type = 0; type < WORKER_POLICY_TYPES; type++) {
+
+      std::string prefix = "policy." + WorkerPolicy::typeName(type) + "_";
+      WorkerPolicy &policy = job_info.worker_policies[type];
+      std::string ioprio_class;
+
+      try {
+
+        this->getRuntimeConfiguration()->get(prefix + "cpus")->getValue(policy.cpus);
+        this->getRuntimeConfiguration()->get(prefix + "numa_nodes")->getValue(policy.numa_nodes);
+        this->getRuntimeConfiguration()->get(prefix + "nice")->getValue(policy.nice);
+        this->getRuntimeConfiguration()->get(prefix + "ioprio_class")->getValue(ioprio_class);
+        this->getRuntimeConfiguration()->get(prefix + "ioprio_level")->getValue(policy.ioprio_level);
+
+      } catch (CPGBackupCtlFailure &e) {
+        /* not configured */
+        continue;
+      }
+
+      try {
+
+        policy.ioprio_class = WorkerPolicy::stringToIOPrioClass(ioprio_class);
+        policy.validate();
+
+      } catch (WorkerPolicyFailure &e) {
+
+        std::ostringstream oss;
+
+        oss << "invalid worker policy " << WorkerPolicy::typeName(type) << ": " << e.what();
+        throw WorkerPolicyFailure(oss.str());
+
+      }
+
+    }
+
+  }
+
   /*
    * Finally launch the background worker.
    */
@@ -1311,19 +1810,13 @@ void StopStreamingForArchiveCommandHandle::execute(bool noop) {
   shmhandle.attach(this->catalog->fullname(), false);
 
   /*
-   * Operation on the worker shared memory is done
-   * under a lock. We need to scan the shared memory
-   * area for the specified archive id. We do this in one
-   * go without any other interaction to keep the critical
-   * section as short as possible.
+   * We need to scan the shared memory area for the
+   * specified archive id. Reading the worker slots doesn't
+   * block the workers, each slot is copied consistently.
    *
-   * Another thing to note: Don't send a signal right
-   * out of the loop to the victim process, since it would have to
-   * wait for our critical section anyways. The launcher will try
-   * clean up the worker SHM slot index right away.
+   * The launcher will try to clean up the worker SHM slot
+   * index right away after the victim process has exited.
    */
-  shmhandle.lock();
-
   try {
 
     shm_worker_area worker_info;
@@ -1344,14 +1837,12 @@ void StopStreamingForArchiveCommandHandle::execute(bool noop) {
 
   } catch(SHMFailure &shme) {
     /* if something goes wrong here, make sure
-     * we detach from SHM and unlock */
-    shmhandle.unlock();
+     * we detach from SHM */
     shmhandle.detach();
 
     throw CArchiveIssue(shme.what());
   }
 
-  shmhandle.unlock();
   shmhandle.detach();
 
   if (archive_pid > 0) {
@@ -1773,8 +2264,10 @@ void StartStreamingForArchiveCommand::execute(bool noop) {
 
     /* Assign a dummy catalog command handle to the job descriptor */
     jobDescr.cmdHandle = std::make_shared<BackgroundWorkerCommandHandle>(this->catalog);
-    establish_launcher_cmd_queue(jobDescr);
-    send_launcher_cmd(jobDescr, cmd_str.str());
+    launcher_dispatched(dispatch_launcher_cmd(jobDescr,
+                                              START_STREAMING_FOR_ARCHIVE,
+                                              archive_name,
+                                              cmd_str.str()));
 
     /* All done, we should exit this command handler */
     return;
@@ -1926,6 +2419,27 @@ void StartStreamingForArchiveCommand::execute(bool noop) {
      */
     walstreamer->setBackupHandler(this->backup);
 
+    /*
+     * Completed WAL segments are accounted in the
+     * archive statistics of our catalog.
+     */
+    walstreamer->setCatalog(this->catalog);
+
+    /*
+     * Publish stream progress into our worker slot.
+     */
+    walstreamer->setInstrumentation(this->workerInstrumentation());
+
+    /*
+     * Record protocol events into the event log of our worker slot.
+     */
+    walstreamer->setEventLog(this->workerEventLog());
+
+    /*
+     * Throttle writes according to the WAL budget.
+     */
+    walstreamer->setIOGovernor(this->ioGovernor(IO_CLASS_WAL));
+
     /*
      * Enter infinite loop as long as receive() tells
      * us that we can continue.
@@ -2457,9 +2971,33 @@ void StartBasebackupCatalogCommand::execute(bool background) {
     std::shared_ptr<BaseBackupDescr> basebackupDescr = nullptr;
 
     /*
-     * Backup profile tells us the compression mode to use...
+     * Parent of an incremental basebackup.
+     */
+    std::shared_ptr<BaseBackupDescr> parentDescr = nullptr;
+
+    /*
+     * Page verification while streaming, see VERIFY_PAGES.
      */
-    backupHandle->setCompression(backupProfile->compress_type);
+    bool verify_pages = false;
+    unsigned int page_block_size = PAGE_CHECKSUM_BLCKSZ;
+    unsigned int page_segment_size = PAGE_CHECKSUM_RELSEG_SIZE;
+    std::shared_ptr<PageChecksumReport> page_report = nullptr;
+
+    /*
+     * Aborted basebackups continued by RESUME.
+     */
+    std::shared_ptr<BaseBackupResume> resume = nullptr;
+
+    /*
+     * Backup profile tells us the compression mode to use... If the
+     * server compresses the archives, they are stored as is.
+     */
+    if (backupProfile->compress_on_server)
+      backupHandle->setCompression(BACKUP_COMPRESS_TYPE_NONE);
+    else
+      backupHandle->setCompression(backupProfile->compress_type);
+
+    backupHandle->setDeduplication(backupProfile->deduplicate);
 
     /*
      * Prepare backup handler. Should successfully create
@@ -2468,20 +3006,75 @@ void StartBasebackupCatalogCommand::execute(bool background) {
     backupHandle->initialize();
     backupHandle->create();
 
-    /*
-     * Get connection to the PostgreSQL instance.
-     */
-    pgstream.connect();
+    /*
+     * Get connection to the PostgreSQL instance.
+     */
+    pgstream.connect();
+
+    BOOST_LOG_TRIVIAL(debug)
+      << "DEBUG: connecting stream";
+
+    /*
+     * Identify this replication connection.
+     */
+    pgstream.identify();
+
+    BOOST_LOG_TRIVIAL(debug) << "DEBUG: identify stream";
+
+    if (backupProfile->compress_on_server
+        && pgstream.getServerVersion() < 150000) {
+      std::ostringstream oss;
+      oss << "backup profile \"" << backupProfile->name << "\" requests compression on server, "
+          << "this requires PostgreSQL 15 or newer";
+      throw CArchiveIssue(oss.str());
+    }
+
+    /*
+     * Page checksums can only be verified if the cluster has them
+     * enabled. Block and relation segment size are compile time
+     * settings of the server, SHOW tells us about them.
+     */
+    if (backupProfile->verify_pages) {
+
+      try {
+
+        if (pgstream.getServerSetting("data_checksums") != "on") {
+
+          BOOST_LOG_TRIVIAL(warning) << "WARNING: data checksums are disabled on the server, "
+                                     << "pages are not verified";
+
+        } else {
+
+          unsigned long long segment_size = 0;
+          std::string unit = "";
+          std::stringstream segment_size_stream(pgstream.getServerSetting("segment_size"));
+
+          page_block_size = CPGBackupCtlBase::strToUInt(pgstream.getServerSetting("block_size"));
+          segment_size_stream >> segment_size >> unit;
+
+          if (unit == "kB")
+            segment_size *= 1024;
+          else if (unit == "MB")
+            segment_size *= 1024 * 1024;
+          else if (unit == "GB")
+            segment_size *= 1024 * 1024 * 1024;
+          else if (unit == "TB")
+            segment_size *= 1024ULL * 1024 * 1024 * 1024;
+
+          if (segment_size_stream.fail() || page_block_size == 0
+              || (page_block_size % 128) != 0 || segment_size < page_block_size)
+            throw StreamingFailure("unexpected block_size or segment_size reported by server");
+
+          page_segment_size = (unsigned int) (segment_size / page_block_size);
+          verify_pages = true;
 
-    BOOST_LOG_TRIVIAL(debug)
-      << "DEBUG: connecting stream";
+        }
 
-    /*
-     * Identify this replication connection.
-     */
-    pgstream.identify();
+      } catch (CPGBackupCtlFailure &e) {
+        BOOST_LOG_TRIVIAL(warning) << "WARNING: pages are not verified: " << e.what();
+      }
 
-    BOOST_LOG_TRIVIAL(debug) << "DEBUG: identify stream";
+    }
 
     /*
      * Check if we have a compatible previous
@@ -2526,22 +3119,239 @@ void StartBasebackupCatalogCommand::execute(bool background) {
       break;
     }
 
+    /*
+     * An incremental basebackup is based on the newest valid
+     * basebackup of the archive, which must have been taken from
+     * the same cluster with a manifest. Its manifest is uploaded
+     * to the server, which then sends only what has changed since.
+     */
+    if (this->incremental) {
+
+      if (pgstream.getServerVersion() < 170000) {
+        std::ostringstream oss;
+        oss << "incremental basebackups require PostgreSQL 17 or newer";
+        throw CArchiveIssue(oss.str());
+      }
+
+      if (!backupProfile->manifest) {
+        std::ostringstream oss;
+        oss << "incremental basebackups require a backup profile with MANIFEST INCLUDED, "
+            << "backup profile \"" << backupProfile->name << "\" excludes it";
+        throw CArchiveIssue(oss.str());
+      }
+
+      this->catalog->startTransaction();
+
+      try {
+        parentDescr = this->catalog->getBaseBackup(BASEBACKUP_NEWEST, temp_descr->id, true);
+        this->catalog->commitTransaction();
+      } catch (CPGBackupCtlFailure &e) {
+        this->catalog->rollbackTransaction();
+        throw e;
+      }
+
+      if (parentDescr->id < 0) {
+        std::ostringstream oss;
+        oss << "archive \"" << this->archive_name << "\" has no valid basebackup "
+            << "to take an incremental basebackup from";
+        throw CArchiveIssue(oss.str());
+      }
+
+      if (parentDescr->systemid != pgstream.streamident.systemid
+          || parentDescr->pg_version_num < 170000) {
+        std::ostringstream oss;
+        oss << "basebackup " << parentDescr->id
+            << " wasn't taken from this PostgreSQL 17 cluster, "
+            << "cannot take an incremental basebackup from it";
+        throw CArchiveIssue(oss.str());
+      }
+
+      BOOST_LOG_TRIVIAL(info) << "taking incremental basebackup of basebackup "
+                              << parentDescr->id;
+
+    }
+
+    /*
+     * RESUME continues the aborted basebackups newer than the newest
+     * valid one. The files they got completely are listed in a manifest
+     * uploaded to the server, which then sends only the blocks changed
+     * since for relation files. Requires the same things as an incremental
+     * basebackup, and WAL summaries on the server. If resuming isn't
+     * possible, a full basebackup is taken instead.
+     */
+    if (this->resume) {
+
+      std::string reason = "";
+
+      if (pgstream.getServerVersion() < 170000) {
+        reason = "resuming basebackups requires PostgreSQL 17 or newer";
+      } else if (!backupProfile->manifest) {
+        reason = "backup profile \"" + backupProfile->name + "\" excludes the manifest";
+      } else if (backupProfile->compress_on_server
+                 || backupProfile->compress_type == BACKUP_COMPRESS_TYPE_PLAIN) {
+        reason = "backup profile \"" + backupProfile->name + "\" doesn't store tar archives";
+      } else if (!BackupChecksum::supported("SHA256")
+                 || (backupProfile->manifest_checksums != "NONE"
+                     && !BackupChecksum::supported(backupProfile->manifest_checksums))) {
+        reason = "manifest checksums are not supported by this build";
+      } else {
+
+        try {
+
+          if (pgstream.getServerSetting("summarize_wal") != "on")
+            reason = "summarize_wal is disabled on the server";
+
+        } catch (CPGBackupCtlFailure &e) {
+          reason = e.what();
+        }
+
+      }
+
+      if (reason.length() == 0) {
+
+        try {
+          resume = std::make_shared<BaseBackupResume>(backupProfile->manifest_checksums,
+                                                      CPGBackupCtlBase::strToUInt(pgstream.getServerSetting("block_size")));
+        } catch (CPGBackupCtlFailure &e) {
+          reason = e.what();
+        }
+
+      }
+
+      if (resume != nullptr) {
+
+        std::vector<std::shared_ptr<BaseBackupDescr>> list;
+        int timeline = -1;
+
+        this->catalog->startTransaction();
+
+        try {
+          list = this->catalog->getBackupList(this->archive_name);
+          this->catalog->commitTransaction();
+        } catch (CPGBackupCtlFailure &e) {
+          this->catalog->rollbackTransaction();
+          throw e;
+        }
+
+        /*
+         * The list starts with the newest basebackup. Aborted incremental
+         * basebackups hold incremental files only for relation files, and
+         * all of them must be on the timeline of the newest one.
+         */
+        for (auto &partial : list) {
+
+          if (partial->status == BaseBackupDescr::BASEBACKUP_STATUS_READY)
+            break;
+
+          if (partial->status != BaseBackupDescr::BASEBACKUP_STATUS_ABORTED
+              || partial->parent_id >= 0
+              || partial->systemid != pgstream.streamident.systemid
+              || partial->pg_version_num / 10000 != pgstream.getServerVersion() / 10000
+              || (timeline >= 0 && partial->timeline != timeline))
+            continue;
+
+          BOOST_LOG_TRIVIAL(info) << "scanning aborted basebackup " << partial->id;
+
+          resume->addPartial(partial);
+          timeline = partial->timeline;
+
+        }
+
+        if (resume->files() == 0)
+          reason = "no files of aborted basebackups found";
+
+      }
+
+      if (reason.length() > 0) {
+
+        BOOST_LOG_TRIVIAL(warning) << "WARNING: cannot resume: " << reason
+                                   << ", taking a full basebackup";
+        resume = nullptr;
+
+      } else {
+
+        BOOST_LOG_TRIVIAL(info) << "resuming " << resume->files() << " files of "
+                                << resume->getPartials().size() << " aborted basebackups";
+        backupHandle->setResume(resume);
+
+      }
+
+    }
+
     /*
      * Get basebackup stream handle.
      */
     bbp = pgstream.basebackup(backupProfile);
 
+    if (parentDescr != nullptr) {
+      bbp->setIncremental(parentDescr->id,
+                          StreamingBaseBackupDirectory(path(parentDescr->fsentry)).manifest());
+    }
+
+    /* A resumed basebackup doesn't depend on what it resumes */
+    if (resume != nullptr) {
+      bbp->setIncremental(-1, resume->manifest(pgstream.streamident.systemid));
+    }
+
     /*
      * Set signal handler
      */
     bbp->assignStopHandler(this->stopHandler);
 
+    /*
+     * Publish stream progress into our worker slot.
+     */
+    bbp->setInstrumentation(this->workerInstrumentation());
+
+    /*
+     * Record protocol events into the event log of our worker slot.
+     */
+    bbp->setEventLog(this->workerEventLog());
+
+    /*
+     * Throttle writes according to the basebackup budget.
+     */
+    bbp->setIOGovernor(this->ioGovernor(IO_CLASS_BASEBACKUP));
+
+    /*
+     * Decouple receiving the stream from writing it, if configured.
+     */
+    {
+      int write_buffers = 8;
+      int write_buffer_size = 1024;
+
+      if (this->getRuntimeConfiguration() != nullptr) {
+
+        try {
+          this->getRuntimeConfiguration()->get("basebackup.write_buffers")->getValue(write_buffers);
+          this->getRuntimeConfiguration()->get("basebackup.write_buffer_size")->getValue(write_buffer_size);
+        } catch (CPGBackupCtlFailure &e) {
+          /* not configured, keep the defaults */
+        }
+
+      }
+
+      bbp->setWritePipeline((write_buffers > 0) ? write_buffers : 0,
+                            (size_t) write_buffer_size * 1024);
+    }
+
     /*
      * Enter basebackup stream.
      */
     bbp->prepareStream(backupHandle);
     bbp->start();
 
+    /*
+     * Pages changed after the start of the basebackup are
+     * restored from WAL, verification skips them.
+     */
+    if (verify_pages) {
+      page_report = std::make_shared<PageChecksumReport>(PGStream::decodeXLOGPos(bbp->getBaseBackupDescr()->xlogpos),
+                                                         page_block_size,
+                                                         page_segment_size);
+      backupHandle->setPageVerification(page_report);
+    }
+
     /*
      * Now its time to register this basebackup handle to
      * the catalog. Do the rollback in our own exception handler
@@ -2567,6 +3377,7 @@ void StartBasebackupCatalogCommand::execute(bool background) {
       this->catalog->registerBasebackup(temp_descr->id,
                                         basebackupDescr);
       this->catalog->commitTransaction();
+      catalog_changed(this->catalog->fullname());
 
     } catch(CPGBackupCtlFailure &e) {
       this->catalog->rollbackTransaction();
@@ -2603,6 +3414,47 @@ void StartBasebackupCatalogCommand::execute(bool background) {
     BOOST_LOG_TRIVIAL(debug) << "DEBUG: disconnecting stream";
     pgstream.disconnect();
 
+    /*
+     * Close and sync all files now, recipes of deduplicated
+     * archives are complete afterwards.
+     */
+    backupHandle->finalize();
+
+    /*
+     * All pages passed the writer now, record the bad ones
+     * with the basebackup.
+     */
+    if (page_report != nullptr) {
+
+      basebackupDescr->bad_pages = page_report->failures();
+      basebackupDescr->bad_pages_detail = page_report->detail();
+
+      BOOST_LOG_TRIVIAL(info) << "verified " << page_report->pagesVerified() << " pages, "
+                              << page_report->pagesSkipped() << " skipped"
+                              << (PageChecksum::vectorized() ? " (AVX2)" : "");
+
+      if (page_report->failures() > 0)
+        BOOST_LOG_TRIVIAL(warning) << "WARNING: " << page_report->failures()
+                                   << " pages with bad checksums: "
+                                   << page_report->detail();
+
+    }
+
+    /*
+     * The aborted basebackups aren't needed anymore, they are
+     * removed by the next cleanup.
+     */
+    if (resume != nullptr) {
+
+      std::ostringstream ids;
+
+      for (auto &id : resume->getPartials())
+        ids << ((ids.tellp() > 0) ? ", " : "") << id;
+
+      BOOST_LOG_TRIVIAL(info) << "basebackup resumed aborted basebackups " << ids.str();
+
+    }
+
   } catch(CPGBackupCtlFailure& e) {
 
     bool txinprogress = false;
@@ -2626,6 +3478,7 @@ void StartBasebackupCatalogCommand::execute(bool background) {
 
         this->catalog->abortBasebackup(bbp->getBaseBackupDescr());
         this->catalog->commitTransaction();
+        catalog_changed(this->catalog->fullname());
       }
     } catch (CPGBackupCtlFailure &e) {
       if (txinprogress)
@@ -2645,7 +3498,14 @@ void StartBasebackupCatalogCommand::execute(bool background) {
 
   try {
     this->catalog->finalizeBasebackup(bbp->getBaseBackupDescr());
+
+    /* The basebackup references its chunks from now on */
+    if (backupProfile->deduplicate)
+      this->catalog->referenceChunks(bbp->getBaseBackupDescr()->archive_id,
+                                     ChunkRecipe::chunks(path(bbp->getBaseBackupDescr()->fsentry)));
+
     this->catalog->commitTransaction();
+    catalog_changed(this->catalog->fullname());
   } catch (CPGBackupCtlFailure &e) {
     this->catalog->rollbackTransaction();
     throw e;
@@ -3058,11 +3918,13 @@ shared_ptr<BackupCleanupDescr> ApplyRetentionPolicyCommand::applyRulesAndRemoveB
 
   /*
    * Create lock info objects for the retention object. We must synchronize
-   * against pinning, invalid (or in-progress) basebackups and
-   * shared memory locks. The latter is only true if there's a background
-   * launcher running which maintains the worker shared memory area.
+   * against pinning, invalid (or in-progress) basebackups, parents of
+   * incremental basebackups and shared memory locks. The latter is only
+   * true if there's a background launcher running which maintains the
+   * worker shared memory area.
    */
   shared_ptr<BackupPinnedValidLockInfo> pinLockInfo = make_shared<BackupPinnedValidLockInfo>();
+  shared_ptr<BackupIncrementalLockInfo> incrLockInfo = make_shared<BackupIncrementalLockInfo>(this->bblist);
   shared_ptr<SHMBackupLockInfo> shmLockInfo = nullptr;
 
   /*
@@ -3118,6 +3980,7 @@ shared_ptr<BackupCleanupDescr> ApplyRetentionPolicyCommand::applyRulesAndRemoveB
      * shared memory locks.
      */
     retention_rule->addLockInfo(pinLockInfo);
+    retention_rule->addLockInfo(incrLockInfo);
 
     if (shmLockInfo != nullptr)
       retention_rule->addLockInfo(shmLockInfo);
@@ -3217,10 +4080,161 @@ shared_ptr<BackupCleanupDescr> ApplyRetentionPolicyCommand::applyRulesAndRemoveB
 
 }
 
+shared_ptr<RetentionPlanDescr>
+ApplyRetentionPolicyCommand::prepareRetentionPlan(shared_ptr<CatalogDescr> archiveDescr,
+                                                  shared_ptr<ArchiveLogDirectory> archiveLogDir) {
+
+  shared_ptr<RetentionPlanDescr> plan = this->catalog->getRetentionPlan(archiveDescr->id);
+  shared_ptr<BackupCleanupDescr> cleanupDescr = nullptr;
+
+  /*
+   * Resume an unfinished plan, if any.
+   */
+  if (plan->archive_id >= 0) {
+
+    bool stale = false;
+
+    if (plan->retention_name != this->retention_name) {
+
+      ostringstream oss;
+
+      oss << "archive \"" << archiveDescr->archive_name
+          << "\" has an unfinished plan of retention policy \""
+          << plan->retention_name << "\", apply this policy first";
+      throw CArchiveIssue(oss.str());
+
+    }
+
+    /*
+     * A pending basebackup pinned in the meantime invalidates
+     * the WAL cleanup offsets of the plan, so we have to recompute it.
+     */
+    for (auto &basebackup : plan->cleanupDescr->basebackups) {
+
+      shared_ptr<BaseBackupDescr> current = this->catalog->getBaseBackup(basebackup->id,
+                                                                         archiveDescr->id);
+
+      if (current->id >= 0 && current->pinned != 0) {
+        stale = true;
+        break;
+      }
+
+    }
+
+    if (!stale) {
+
+      cout << "resuming retention plan created "
+           << plan->created << ", "
+           << plan->cleanupDescr->basebackups.size()
+           << " basebackups pending" << endl;
+      return plan;
+
+    }
+
+    BOOST_LOG_TRIVIAL(warning) << "basebackup of unfinished retention plan is pinned, recomputing plan";
+
+    if (!this->dry_run)
+      this->catalog->dropRetentionPlan(archiveDescr->id);
+
+  }
+
+  /* get the list of current basebackups */
+  this->bblist = this->catalog->getBackupList(this->archive_name);
+
+  /*
+   * Apply the rule(s) attached to this policy.
+   */
+  cleanupDescr = this->applyRulesAndRemoveBasebackups(archiveDescr);
+  plan = make_shared<RetentionPlanDescr>();
+
+  if (cleanupDescr->basebackupMode == NO_BASEBACKUPS) {
+    return plan;
+  }
+
+  archiveLogDir->checkCleanupDescriptor(cleanupDescr);
+
+  if (cleanupDescr->basebackups.size() == 0) {
+    return plan;
+  }
+
+  plan->archive_id = archiveDescr->id;
+  plan->retention_name = this->retention_name;
+  plan->wal_segment_size = cleanupDescr->basebackups[0]->wal_segment_size;
+  plan->cleanupDescr = cleanupDescr;
+
+  if (!this->dry_run)
+    this->catalog->createRetentionPlan(plan);
+
+  return plan;
+
+}
+
+void ApplyRetentionPolicyCommand::printRetentionPlanCost(shared_ptr<RetentionPlanDescr> plan,
+                                                         shared_ptr<ArchiveLogDirectory> archiveLogDir) {
+
+  unsigned long long bb_files = 0;
+  unsigned long long bb_bytes = 0;
+  shared_ptr<BackupCleanupDescr> cleanupDescr = plan->cleanupDescr;
+
+  for (auto &basebackup : cleanupDescr->basebackups) {
+
+    path bbpath(basebackup->fsentry);
+
+    if (is_regular_file(bbpath)) {
+
+      bb_files++;
+      bb_bytes += file_size(bbpath);
+
+    } else if (is_directory(bbpath)) {
+
+      for (recursive_directory_iterator it(bbpath);
+           it != recursive_directory_iterator(); ++it) {
+
+        if (is_regular_file(*it)) {
+          bb_files++;
+          bb_bytes += file_size(*it);
+        }
+
+      }
+
+    }
+
+  }
+
+  /*
+   * removeXLogs() in dry run mode just counts the files it
+   * would have removed.
+   */
+  if ((cleanupDescr->mode == WAL_CLEANUP_OFFSET || cleanupDescr->mode == WAL_CLEANUP_ALL)
+      && archiveLogDir->exists()) {
+    archiveLogDir->removeXLogs(cleanupDescr, plan->wal_segment_size, true);
+  }
+
+  cout << "retention policy \"" << plan->retention_name << "\" on archive \""
+       << this->archive_name << "\" would remove:" << endl;
+  cout << boost::format("%-25s\t%-40s")
+    % "basebackups:"
+    % (boost::format("%u (%u files, %s)")
+       % cleanupDescr->basebackups.size() % bb_files
+       % CPGBackupCtlBase::prettySize(bb_bytes)) << endl;
+  cout << boost::format("%-25s\t%-40s")
+    % "WAL:"
+    % (boost::format("%u files, %s")
+       % cleanupDescr->removed_wal_files
+       % CPGBackupCtlBase::prettySize(cleanupDescr->removed_wal_bytes)) << endl;
+  cout << boost::format("%-25s\t%-40s")
+    % "total:"
+    % (boost::format("%u files, %s")
+       % (bb_files + cleanupDescr->removed_wal_files)
+       % CPGBackupCtlBase::prettySize(bb_bytes + cleanupDescr->removed_wal_bytes)) << endl;
+
+}
+
 void ApplyRetentionPolicyCommand::execute(bool flag) {
 
   shared_ptr<CatalogDescr> archiveDescr      = nullptr;
   bool has_tx = false; /* stores state of current TX */
+  int batch_size = 10;
 
   if (this->catalog == nullptr) {
     throw CArchiveIssue("could not execute command: no catalog");
@@ -3233,16 +4247,33 @@ void ApplyRetentionPolicyCommand::execute(bool flag) {
     throw CArchiveIssue("empty retention name not allowed here");
   }
 
+  /*
+   * Number of basebackups to delete per transaction.
+   */
+  if (this->getRuntimeConfiguration() != nullptr) {
+
+    try {
+      this->getRuntimeConfiguration()->get("retention.batch_size")->getValue(batch_size);
+    } catch (CPGBackupCtlFailure &e) {
+      /* not configured, keep the default */
+    }
+
+  }
+
   /**
-   * Enter the cleanup procedure. This is done within one transaction
-   * to make sure no other write operations interfere with us.
+   * Enter the cleanup procedure. The retention plan is computed
+   * (or an unfinished one is resumed) and persisted within one
+   * transaction, then executed in batches of batch_size basebackups,
+   * each in its own transaction. WAL cleanup happens last, the plan
+   * is dropped afterwards. If interrupted, applying the policy again
+   * resumes with the basebackups still pending.
    */
   try {
 
-    shared_ptr<BackupCleanupDescr> archiveCleanupDescr = nullptr;
+    shared_ptr<RetentionPlanDescr> plan                = nullptr;
     shared_ptr<BackupDirectory> backupDir              = nullptr;
     shared_ptr<ArchiveLogDirectory> archiveLogDir      = nullptr;
-    unsigned long long wal_segment_size = 0;
+    vector<shared_ptr<BaseBackupDescr>>::iterator bbit;
 
 #ifdef __DEBUG__
     BOOST_LOG_TRIVIAL(debug) << "DEBUG: operating on directory "
@@ -3286,88 +4317,168 @@ void ApplyRetentionPolicyCommand::execute(bool flag) {
     this->id = archiveDescr->id;
     archiveDescr->tag = LIST_ARCHIVE;
 
-    /* get the list of current basebackups */
+    plan = this->prepareRetentionPlan(archiveDescr, archiveLogDir);
 
-    this->bblist = this->catalog->getBackupList(this->archive_name);
-
-    /*
-     * Apply the rule(s) attached to this policy.
-     */
-    archiveCleanupDescr = this->applyRulesAndRemoveBasebackups(archiveDescr);
+    this->catalog->commitTransaction();
+    has_tx = false;
 
     /* In case nothing to do, exit */
-    if (archiveCleanupDescr->basebackupMode == NO_BASEBACKUPS) {
+    if (plan->archive_id < 0) {
       cout << "no basebackups matches retention policy" << endl;
       return;
     }
 
+    if (this->dry_run) {
+      this->printRetentionPlanCost(plan, archiveLogDir);
+      return;
+    }
+
     /*
-     * Loop through the final cleanup descriptor. During this loop
-     * we delete the basebackup physically and from the catalog.
-     *
-     * Archive cleanup is performed afterwards.
+     * Loop through the pending basebackups of the plan. Each batch
+     * deletes its basebackups physically and from the catalog and
+     * removes them from the plan within one transaction.
+     */
+    bbit = plan->cleanupDescr->basebackups.begin();
+
+    while (bbit != plan->cleanupDescr->basebackups.end()) {
+
+      if (this->stopHandler != nullptr && this->stopHandler->check()) {
+
+        cout << "retention interrupted, "
+             << (plan->cleanupDescr->basebackups.end() - bbit)
+             << " basebackups pending, apply the policy again to resume" << endl;
+        return;
+
+      }
+
+      this->catalog->startTransaction();
+      has_tx = true;
+
+      for (int i = 0;
+           i < batch_size && bbit != plan->cleanupDescr->basebackups.end();
+           i++, ++bbit) {
+
+        shared_ptr<BaseBackupDescr> basebackup = *bbit;
+        boost::system::error_code ec;
+
+#ifdef __DEBUG__
+        BOOST_LOG_TRIVIAL(debug) << "deleting fs path " << basebackup->fsentry;
+#endif
+
+        /*
+         * A deduplicated basebackup releases its chunks, they
+         * are removed below if no basebackup uses them anymore.
+         */
+        std::vector<std::string> chunks;
+
+        for (auto &chunk : ChunkRecipe::chunks(path(basebackup->fsentry)))
+          chunks.push_back(chunk.first);
+
+        this->catalog->unreferenceChunks(this->id, chunks);
+
+        /*
+         * Drop the basebackup from the catalog database. If this
+         * succeeds we go over and unlink the file(s) and director(y|ies)
+         * physically. A basebackup already deleted by an interrupted
+         * run is gone from the catalog already, which is fine.
+         */
+        this->catalog->deleteBaseBackup(basebackup->id);
+        this->catalog->finishRetentionPlanBackup(this->id, basebackup->id);
+        remove_all(path(basebackup->fsentry), ec);
+
+        /*
+         * Explicitely warn in case the file was already deleted.
+         */
+        if (ec.value() == boost::system::errc::no_such_file_or_directory) {
+
+          BOOST_LOG_TRIVIAL(debug) << "WARNING: basebackup in file/directory "
+                                   << basebackup->fsentry
+                                   << " already gone.";
+
+        } else if (ec.value() != boost::system::errc::success) {
+
+          throw CArchiveIssue(ec.message());
+
+        }
+
+      }
+
+      this->catalog->commitTransaction();
+      has_tx = false;
+      catalog_changed(this->catalog->fullname());
+
+    }
+
+    /*
+     * Perform archive cleanup procedures. Removing WAL segments
+     * is idempotent, so an interrupted run just repeats it.
      */
-    for(auto &basebackup : archiveCleanupDescr->basebackups) {
+#ifdef __DEBUG_XLOG__
+    BOOST_LOG_TRIVIAL(debug) << "DEBUG: cleaning with wal_segment_size="
+                             << plan->wal_segment_size;
+#endif
 
-      boost::system::error_code ec;
+    if ((plan->cleanupDescr->mode == WAL_CLEANUP_OFFSET
+         || plan->cleanupDescr->mode == WAL_CLEANUP_ALL)
+        && archiveLogDir->exists()) {
 
 #ifdef __DEBUG__
-      BOOST_LOG_TRIVIAL(debug) << "deleting fs path " << basebackup->fsentry;
+      BOOST_LOG_TRIVIAL(debug) << "DEBUG: cleaning archive log directory "
+                               << archiveLogDir->getPath();
 #endif
 
-      if (wal_segment_size == 0) {
-        wal_segment_size = basebackup->wal_segment_size;
-      }
+      archiveLogDir->removeXLogs(plan->cleanupDescr, plan->wal_segment_size);
 
-#ifdef __DEBUG_XLOG__
-      BOOST_LOG_TRIVIAL(debug) << "DEBUG: cleaning with wal_segment_size="
-                               << wal_segment_size;
-#endif
+    }
 
-      /*
-       * Drop the basebackup from the catalog database. If this
-       * succeeds we go over and unlink the file(s) and director(y|ies)
-       * physically.
-       */
-      this->catalog->deleteBaseBackup(basebackup->id);
-      remove_all(path(basebackup->fsentry), ec);
+    this->catalog->startTransaction();
+    has_tx = true;
 
-      /*
-       * Explicitely warn in case the file was already deleted.
-       */
-      if (ec.value() == boost::system::errc::no_such_file_or_directory) {
+    /*
+     * Account the removed WAL segments in the archive statistics.
+     */
+    if (plan->cleanupDescr->removed_wal_segments > 0) {
+      long long removed = plan->cleanupDescr->removed_wal_segments;
+
+      this->catalog->updateArchiveWALStat(this->id,
+                                          -removed,
+                                          -(removed * (long long) plan->wal_segment_size));
+      this->catalog->unregisterWALSegments(this->id,
+                                           plan->cleanupDescr->removed_wal_segment_names);
+    }
 
-        BOOST_LOG_TRIVIAL(debug) << "WARNING: basebackup in file/directory "
-                                 << basebackup->fsentry
-                                 << " already gone.";
+    /*
+     * Remove chunks no longer referenced by any basebackup. A
+     * running basebackup might use chunks it found in the chunk
+     * store without having referenced them yet, so leave them
+     * alone then. Holding the transaction while removing the
+     * files keeps new basebackups from starting meanwhile.
+     */
+    if (this->catalog->statCatalog(this->archive_name)->backups_running == 0) {
 
-      } else if (ec.value() != boost::system::errc::success) {
+      ChunkStore store(ChunkStore::forArchive(path(archiveDescr->directory)));
+      std::vector<std::string> purged = this->catalog->purgeChunks(this->id);
 
-        throw CArchiveIssue(ec.message());
+      for (auto &hash : purged)
+        store.remove(hash);
 
-      }
+      if (purged.size() > 0)
+        BOOST_LOG_TRIVIAL(info) << "removed " << purged.size() << " unreferenced chunks";
 
-      /*
-       * Perform archive cleanup procedures...
-       */
-#ifdef __DEBUG__
-      BOOST_LOG_TRIVIAL(debug) << "DEBUG: cleaning archive log directory "
-                               << archiveLogDir->getPath();
-#endif
+    } else {
+
+      BOOST_LOG_TRIVIAL(info) << "basebackup in progress, removing unreferenced chunks deferred";
 
-      archiveLogDir->checkCleanupDescriptor(archiveCleanupDescr);
-      if (archiveLogDir->exists()){
-        archiveLogDir->removeXLogs(archiveCleanupDescr, wal_segment_size);
-      }
     }
 
     /*
-     * Now it's time to commit all database work. It might
-     * happen that we fail here, but redoing the whole work
-     * should be possible.
+     * The plan is completed now.
      */
+    this->catalog->dropRetentionPlan(this->id);
+
     this->catalog->commitTransaction();
     has_tx = false;
+    catalog_changed(this->catalog->fullname());
 
     /*
      * Fsync backup directory contents.
@@ -3525,7 +4636,70 @@ void CreateBackupProfileCatalogCommand::verify(bool print_version) {
    * XZ - requires XZ command line tool
    * ZSTD - requires the ZSTD command line tool
    * PLAIN - requires the tar command line tool
+   *
+   * Compression on the server doesn't require any tools here,
+   * but only gzip, lz4 and zstd are supported there.
+   *
+   * Deduplication splits the tar stream itself into chunks, so
+   * it can't work with archives compressed by the server or by
+   * external tools. Chunks are identified by their SHA256 hash.
+   *
+   * Page verification reads the uncompressed tar stream as well,
+   * archives compressed by the server can't be verified.
    */
+  if (this->profileDescr->deduplicate) {
+
+    if (this->profileDescr->compress_on_server
+        || (this->profileDescr->compress_type != BACKUP_COMPRESS_TYPE_NONE
+            && this->profileDescr->compress_type != BACKUP_COMPRESS_TYPE_GZIP)) {
+      throw CArchiveIssue("DEDUPLICATE requires COMPRESSION=NONE or GZIP without ON SERVER");
+    }
+
+    if (!BackupChecksum::supported(CHUNK_HASH_ALGORITHM))
+      throw CArchiveIssue("DEDUPLICATE requires " CHUNK_HASH_ALGORITHM " support (OpenSSL)");
+
+  }
+
+  if (this->profileDescr->verify_pages && this->profileDescr->compress_on_server) {
+    throw CArchiveIssue("VERIFY_PAGES can't be used with compression ON SERVER");
+  }
+
+  if (this->profileDescr->compress_on_server) {
+
+    int max_level = 0;
+
+    switch(this->profileDescr->compress_type) {
+    case BACKUP_COMPRESS_TYPE_GZIP:
+      max_level = 9;
+      break;
+    case BACKUP_COMPRESS_TYPE_LZ4:
+      max_level = 12;
+      break;
+    case BACKUP_COMPRESS_TYPE_ZSTD:
+      max_level = 22;
+      break;
+    default:
+      throw CArchiveIssue("compression on server requires GZIP, LZ4 or ZSTD");
+    }
+
+    if (this->profileDescr->compress_level > max_level) {
+      std::ostringstream oss;
+
+      oss << "compression level for "
+          << BackupProfileDescr::compressionType(this->profileDescr->compress_type)
+          << " must be between 1 and " << max_level;
+      throw CArchiveIssue(oss.str());
+    }
+
+    if (this->profileDescr->compress_workers > 0
+        && this->profileDescr->compress_type != BACKUP_COMPRESS_TYPE_ZSTD) {
+      throw CArchiveIssue("compression WORKERS are supported with ZSTD only");
+    }
+
+    return;
+
+  }
+
   switch(this->profileDescr->compress_type) {
 
   case BACKUP_COMPRESS_TYPE_PLAIN:
@@ -3691,6 +4865,11 @@ void CreateBackupProfileCatalogCommand::execute(bool existsOk) {
       attr.push_back(SQL_BCK_PROF_NOVERIFY_CHECKSUMS_ATTNO);
       attr.push_back(SQL_BCK_PROF_MANIFEST_ATTNO);
       attr.push_back(SQL_BCK_PROF_MANIFEST_CHECKSUMS_ATTNO);
+      attr.push_back(SQL_BCK_PROF_COMPRESS_ON_SERVER_ATTNO);
+      attr.push_back(SQL_BCK_PROF_COMPRESS_LEVEL_ATTNO);
+      attr.push_back(SQL_BCK_PROF_COMPRESS_WORKERS_ATTNO);
+      attr.push_back(SQL_BCK_PROF_DEDUPLICATE_ATTNO);
+      attr.push_back(SQL_BCK_PROF_VERIFY_PAGES_ATTNO);
 
       this->profileDescr->setAffectedAttributes(attr);
       this->catalog->createBackupProfile(this->profileDescr);
@@ -4019,6 +5198,7 @@ void AlterArchiveCatalogCommand::execute(bool ignoreMissing) {
     }
 
     this->catalog->commitTransaction();
+    catalog_changed(this->catalog->fullname());
 
   } catch(CPGBackupCtlFailure& e) {
     this->catalog->rollbackTransaction();
@@ -4088,6 +5268,7 @@ void DropArchiveCatalogCommand::execute(bool existsOk) {
 
     catalog->dropArchive(this->archive_name);
     catalog->commitTransaction();
+    catalog_changed(catalog->fullname());
 
   } catch (CPGBackupCtlFailure& e) {
 
@@ -4324,3 +5505,288 @@ void StatArchiveBaseBackupCommand::execute(bool noop) {
   cout << output.str();
 
 }
+
+/* ****************************************************************************
+ * Implementation CreateScheduleCommand
+ * ****************************************************************************/
+
+CreateScheduleCommand::CreateScheduleCommand(std::shared_ptr<BackupCatalog> catalog) {
+
+  this->tag = CREATE_SCHEDULE;
+  this->catalog = catalog;
+
+}
+
+CreateScheduleCommand::CreateScheduleCommand(std::shared_ptr<CatalogDescr> descr) {
+
+  this->copy(*(descr.get()));
+
+}
+
+CreateScheduleCommand::CreateScheduleCommand() {
+
+  this->tag = CREATE_SCHEDULE;
+
+}
+
+CreateScheduleCommand::~CreateScheduleCommand() {}
+
+void CreateScheduleCommand::execute(bool flag) {
+
+  bool have_tx = false;
+  std::shared_ptr<ScheduleDescr> scheduleDescr = this->getScheduleDescr();
+
+  if (this->catalog == nullptr) {
+    throw CArchiveIssue("could not execute command: no catalog");
+  }
+
+  if (scheduleDescr == nullptr) {
+    throw CArchiveIssue("could not execute command: no schedule descriptor");
+  }
+
+  /*
+   * Validate the cron expression before touching the catalog,
+   * next() also rejects expressions which never match.
+   */
+  try {
+
+    CronExpression cron(scheduleDescr->cron);
+    cron.next(time(NULL));
+
+  } catch(SchedulerFailure &e) {
+    throw CArchiveIssue(e.what());
+  }
+
+  try {
+
+    std::shared_ptr<CatalogDescr> archive = nullptr;
+
+    this->catalog->startTransaction();
+    have_tx = true;
+
+    archive = this->catalog->existsByName(this->archive_name);
+
+    if (archive->id < 0) {
+      std::ostringstream oss;
+      oss << "archive \"" << this->archive_name << "\" does not exist";
+      throw CArchiveIssue(oss.str());
+    }
+
+    /*
+     * The referenced profile or retention policy must exist. They
+     * can still be dropped afterwards, the job then fails at
+     * runtime like the corresponding command would.
+     */
+    if (scheduleDescr->action == SCHEDULE_ACTION_RETENTION) {
+
+      if (this->catalog->getRetentionPolicy(scheduleDescr->param)->id < 0) {
+        std::ostringstream oss;
+        oss << "retention policy \"" << scheduleDescr->param << "\" does not exist";
+        throw CArchiveIssue(oss.str());
+      }
+
+    } else if (scheduleDescr->param.length() > 0) {
+
+      if (this->catalog->getBackupProfile(scheduleDescr->param)->profile_id < 0) {
+        std::ostringstream oss;
+        oss << "backup profile \"" << scheduleDescr->param << "\" does not exist";
+        throw CArchiveIssue(oss.str());
+      }
+
+    }
+
+    if (this->catalog->getSchedule(archive->id, scheduleDescr->name)->id >= 0) {
+      std::ostringstream oss;
+      oss << "schedule \"" << scheduleDescr->name << "\" already exists for archive \""
+          << this->archive_name << "\"";
+      throw CArchiveIssue(oss.str());
+    }
+
+    scheduleDescr->archive_id = archive->id;
+    scheduleDescr->archive_name = archive->archive_name;
+
+    this->catalog->createSchedule(scheduleDescr);
+
+    this->catalog->commitTransaction();
+    have_tx = false;
+
+    /* makes a running launcher reload its schedules */
+    catalog_changed(this->catalog->fullname());
+
+  } catch (CPGBackupCtlFailure &e) {
+
+    if (have_tx) {
+      this->catalog->rollbackTransaction();
+      have_tx = false;
+    }
+
+    throw e;
+  }
+
+}
+
+/* ****************************************************************************
+ * Implementation DropScheduleCommand
+ * ****************************************************************************/
+
+DropScheduleCommand::DropScheduleCommand(std::shared_ptr<BackupCatalog> catalog) {
+
+  this->tag = DROP_SCHEDULE;
+  this->catalog = catalog;
+
+}
+
+DropScheduleCommand::DropScheduleCommand(std::shared_ptr<CatalogDescr> descr) {
+
+  this->copy(*(descr.get()));
+
+}
+
+DropScheduleCommand::DropScheduleCommand() {
+
+  this->tag = DROP_SCHEDULE;
+
+}
+
+DropScheduleCommand::~DropScheduleCommand() {}
+
+void DropScheduleCommand::execute(bool flag) {
+
+  bool have_tx = false;
+  std::shared_ptr<ScheduleDescr> scheduleDescr = this->getScheduleDescr();
+
+  if (this->catalog == nullptr) {
+    throw CArchiveIssue("could not execute command: no catalog");
+  }
+
+  if (scheduleDescr == nullptr) {
+    throw CArchiveIssue("could not execute command: no schedule descriptor");
+  }
+
+  try {
+
+    std::shared_ptr<CatalogDescr> archive = nullptr;
+    std::shared_ptr<ScheduleDescr> schedule = nullptr;
+
+    this->catalog->startTransaction();
+    have_tx = true;
+
+    archive = this->catalog->existsByName(this->archive_name);
+
+    if (archive->id < 0) {
+      std::ostringstream oss;
+      oss << "archive \"" << this->archive_name << "\" does not exist";
+      throw CArchiveIssue(oss.str());
+    }
+
+    schedule = this->catalog->getSchedule(archive->id, scheduleDescr->name);
+
+    if (schedule->id < 0) {
+      std::ostringstream oss;
+      oss << "schedule \"" << scheduleDescr->name << "\" does not exist for archive \""
+          << this->archive_name << "\"";
+      throw CArchiveIssue(oss.str());
+    }
+
+    this->catalog->dropSchedule(schedule->id);
+
+    this->catalog->commitTransaction();
+    have_tx = false;
+
+    catalog_changed(this->catalog->fullname());
+
+  } catch (CPGBackupCtlFailure &e) {
+
+    if (have_tx) {
+      this->catalog->rollbackTransaction();
+      have_tx = false;
+    }
+
+    throw e;
+  }
+
+}
+
+/* ****************************************************************************
+ * Implementation ListSchedulesCommand
+ * ****************************************************************************/
+
+ListSchedulesCommand::ListSchedulesCommand(std::shared_ptr<BackupCatalog> catalog) {
+
+  this->tag = LIST_SCHEDULES;
+  this->catalog = catalog;
+
+}
+
+ListSchedulesCommand::ListSchedulesCommand(std::shared_ptr<CatalogDescr> descr) {
+
+  this->copy(*(descr.get()));
+
+}
+
+ListSchedulesCommand::ListSchedulesCommand() {
+
+  this->tag = LIST_SCHEDULES;
+
+}
+
+ListSchedulesCommand::~ListSchedulesCommand() {}
+
+void ListSchedulesCommand::execute(bool flag) {
+
+  bool have_tx = false;
+
+  if (this->catalog == nullptr) {
+    throw CArchiveIssue("could not execute command: no catalog");
+  }
+
+  try {
+
+    std::vector<std::shared_ptr<ScheduleDescr>> schedules;
+    std::shared_ptr<OutputFormatter> formatter
+      = OutputFormatter::formatter(std::make_shared<OutputFormatConfiguration>(),
+                                   catalog,
+                                   getOutputFormat());
+    std::ostringstream output;
+    int archive_id = -1;
+
+    this->catalog->startTransaction();
+    have_tx = true;
+
+    /*
+     * Restrict the list to the specified archive, if any.
+     */
+    if (this->archive_name.length() > 0) {
+
+      std::shared_ptr<CatalogDescr> archive
+        = this->catalog->existsByName(this->archive_name);
+
+      if (archive->id < 0) {
+        std::ostringstream oss;
+        oss << "archive \"" << this->archive_name << "\" does not exist";
+        throw CArchiveIssue(oss.str());
+      }
+
+      archive_id = archive->id;
+
+    }
+
+    schedules = this->catalog->getSchedules(archive_id);
+
+    this->catalog->commitTransaction();
+    have_tx = false;
+
+    formatter->nodeAs(schedules, output);
+    std::cout << output.str();
+
+  } catch (CPGBackupCtlFailure &e) {
+
+    if (have_tx) {
+      this->catalog->rollbackTransaction();
+      have_tx = false;
+    }
+
+    throw e;
+  }
+
+}
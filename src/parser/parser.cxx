@@ -129,6 +129,7 @@ namespace pgbckctl {
                                               | cmd_create_backup_profile
                                               | cmd_create_connection
                                               | cmd_create_retention
+                                              | cmd_create_schedule
                                               )
                           )
 
@@ -140,6 +141,7 @@ namespace pgbckctl {
                                               | cmd_list_connection
                                               | cmd_list_backup_list
                                               | cmd_list_retention
+                                              | cmd_list_schedules
                                               )
                             )
 
@@ -175,17 +177,31 @@ namespace pgbckctl {
                                               /* DROP RETENTION POLICY */
                                               | cmd_drop_retention
 
+                                              /* DROP SCHEDULE */
+                                              | cmd_drop_schedule
+
                                               /* DROP BASEBACKUP */
                                               | cmd_drop_basebackup )
                             )
 
                          /*
-                          * VERIFY ARCHIVE <name> command
+                          * VERIFY command syntax start
                           */
-                         | ( cmd_verify_archive > eps > identifier
-                             [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ]
-                             > eps > -verify_check_connection
-                             [ boost::bind(&CatalogDescr::setVerifyOption, &cmd, VERIFY_DATABASE_CONNECTION) ] )
+                         | (
+                            cmd_verify > eps > (
+                                                /*
+                                                 * VERIFY ARCHIVE <name> command
+                                                 */
+                                                ( cmd_verify_archive > eps > identifier
+                                                  [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ]
+                                                  > eps > -verify_check_connection
+                                                  [ boost::bind(&CatalogDescr::setVerifyOption, &cmd, VERIFY_DATABASE_CONNECTION) ] )
+
+                                                /*
+                                                 * VERIFY BASEBACKUP
+                                                 */
+                                                | cmd_verify_basebackup )
+                            )
 
                          /*
                           * START command
@@ -199,6 +215,7 @@ namespace pgbckctl {
                                                   | ( cmd_start_launcher )
                                                   | ( cmd_start_streaming )
                                                   | ( cmd_start_recovery_stream )
+                                                  | ( cmd_start_metrics_server )
                                                   )
                             )
 
@@ -397,7 +414,7 @@ namespace pgbckctl {
           > eps > cmd_apply_retention;
 
         /*
-         * APPLY RETENTION POLICY <identifier> TO ARCHIVE <identifier>
+         * APPLY RETENTION POLICY <identifier> TO ARCHIVE <identifier> [DRY RUN]
          */
         cmd_apply_retention = no_case[ lexeme[ lit("RETENTION") ]]
           > eps > no_case[ lexeme[ lit("POLICY") ]]
@@ -407,7 +424,10 @@ namespace pgbckctl {
           > eps > no_case[ lexeme[ lit("TO") ]]
           > eps > no_case[ lexeme[ lit("ARCHIVE") ]]
           > eps > identifier
-          [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ];
+          [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ]
+          > eps > -( no_case[ lexeme[ lit("DRY") ]]
+                     > eps > no_case[ lexeme[ lit("RUN") ]]
+                     [ boost::bind(&CatalogDescr::setDryRun, &cmd, true) ] );
 
         /* SET <class.variable name> = <variable value> */
         cmd_set = no_case[ lexeme[ lit("SET") ]]
@@ -444,7 +464,7 @@ namespace pgbckctl {
                            | ( number_ID
                                [ boost::bind(&CatalogDescr::setVariableValueInteger, &cmd, ::_1) ] ) );
 
-        variable_value_string = +(char_("A-Za-z"));
+        variable_value_string = +(char_("A-Za-z0-9_,-"));
 
         /* RESET <runtime variable> */
         cmd_reset = no_case[ lexeme[ lit("RESET") ] ]
@@ -453,7 +473,7 @@ namespace pgbckctl {
           > eps > variable_name
           [ boost::bind(&CatalogDescr::setVariableName, &cmd, ::_1) ];
 
-        /* SHOW ( VARIABLES | WORKERS | <runtime variable> ) */
+        /* SHOW ( VARIABLES | WORKERS | EVENTS [PID <pid>] | <runtime variable> ) */
         cmd_show = no_case[lexeme[ lit("SHOW") ]]
           > eps > show_command_type;
 
@@ -463,6 +483,13 @@ namespace pgbckctl {
 
           |
 
+          ( no_case[lexeme[ lit("EVENTS") ]]
+            [boost::bind(&CatalogDescr::setCommandTag, &cmd, SHOW_EVENTS)]
+            > eps > -( no_case[lexeme[ lit("PID") ]] > eps > number_ID
+                       [ boost::bind(&CatalogDescr::setWorkerPID, &cmd, ::_1) ] ) )
+
+          |
+
           ( no_case[lexeme[ lit("VARIABLES") ]]
             [ boost::bind(&CatalogDescr::setCommandTag, &cmd, SHOW_VARIABLES) ] )
 
@@ -505,6 +532,33 @@ namespace pgbckctl {
 
         ip_address = +char_("0-9a-zA-Z.:");
 
+        /*
+         * START METRICS SERVER command
+         */
+        cmd_start_metrics_server = no_case[ lexeme[ lit("METRICS") ] ]
+          [ boost::bind(&CatalogDescr::makeMetricsServerDescr, &cmd) ]
+          > eps > no_case[ lexeme[ lit("SERVER") ] ]
+          [ boost::bind(&CatalogDescr::setCommandTag, &cmd, START_METRICS_SERVER) ]
+          > eps > -(no_case[ lexeme[ lit("PORT") ] ] > eps > number_ID
+               [ boost::bind(&CatalogDescr::setMetricsServerPort, &cmd, ::_1) ])
+          > eps > -(metrics_listen_on)
+          > eps > -( no_case[ lexeme[ lit("NODETACH") ] ]
+                     [ boost::bind(&CatalogDescr::setJobDetachMode, &cmd, false) ] );
+
+        metrics_listen_on = no_case[ lexeme[ lit("LISTEN_ON") ] ]
+          > eps > metrics_address_list;
+
+        metrics_address_list = lexeme[ lit("(") ]
+          > eps > ip_address
+          [ boost::bind(&CatalogDescr::setMetricsServerAddr, &cmd, ::_1) ]
+          > eps > -(metrics_address_item)
+          > eps > lexeme[ lit(")") ];
+
+        metrics_address_item = lexeme[ lit(",") ]
+          > eps > ip_address
+          [ boost::bind(&CatalogDescr::setMetricsServerAddr, &cmd, ::_1) ]
+          > eps > -(metrics_address_item);
+
         /*
          * START STREAMING FOR ARCHIVE command
          */
@@ -525,6 +579,8 @@ namespace pgbckctl {
 
         cmd_drop = no_case[lexeme[ lit("DROP") ]];
 
+        cmd_verify = no_case[lexeme[ lit("VERIFY") ]];
+
         cmd_list = no_case[lexeme[ lit("LIST") ]];
 
         cmd_alter = no_case[lexeme[ lit("ALTER") ]];
@@ -547,6 +603,16 @@ namespace pgbckctl {
                 > eps > identifier
                 [ boost::bind(&CatalogDescr::setRetentionName, &cmd, ::_1) ] ) );
 
+        /*
+         * LIST SCHEDULES [FOR ARCHIVE <identifier>]
+         */
+        cmd_list_schedules = no_case[ lexeme[ lit("SCHEDULES") ] ]
+          [ boost::bind(&CatalogDescr::setCommandTag, &cmd, LIST_SCHEDULES) ]
+          > eps > -( no_case[ lexeme[ lit("FOR") ] ]
+                     > eps > no_case[ lexeme[ lit("ARCHIVE") ] ]
+                     > eps > identifier
+                     [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ] );
+
         /*
          * LIST CONNECTION FOR ARCHIVE <archive name > command
          */
@@ -610,7 +676,9 @@ namespace pgbckctl {
           >> -(profile_checkpoint_option)
           >> -(profile_wait_for_wal_option)
           >> -(profile_noverify_checksums_option)
-          >> -(profile_manifest_option);
+          >> -(profile_manifest_option)
+          >> -(profile_deduplicate_option)
+          >> -(profile_verify_pages_option);
 
         /*
          * CREATE RETENTION POLICY <identifier>
@@ -764,10 +832,24 @@ namespace pgbckctl {
 
         dsn_connection_string = '"' > eps > no_skip[+(char_ - ('"'))] > eps > '"';
 
-        cmd_verify_archive = no_case[lexeme[ lit("VERIFY") ]]
-          > eps > no_case[lexeme [ lit("ARCHIVE") ]]
+        cmd_verify_archive = no_case[lexeme [ lit("ARCHIVE") ]]
           [ boost::bind(&CatalogDescr::setCommandTag, &cmd, VERIFY_ARCHIVE) ];
 
+        /*
+         * VERIFY BASEBACKUP <ID> FROM ARCHIVE <identifier> [PARALLEL <number>]
+         */
+        cmd_verify_basebackup = no_case[ lexeme[ lit("BASEBACKUP") ] ]
+          [ boost::bind(&CatalogDescr::setCommandTag, &cmd, VERIFY_BASEBACKUP) ]
+          > eps > number_ID
+          [ boost::bind(&CatalogDescr::setBasebackupID, &cmd, ::_1) ]
+          > eps > no_case[ lexeme[ lit("FROM") ] ]
+          > eps > no_case[ lexeme[ lit("ARCHIVE") ] ]
+          > eps > identifier
+          [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ]
+          > eps > -( no_case[ lexeme[ lit("PARALLEL") ] ]
+                     > eps > number_ID
+                     [ boost::bind(&CatalogDescr::setParallel, &cmd, ::_1) ] );
+
         /*
          * DROP BASEBACKUP <ID> FROM ARCHIVE <identifier>
          */
@@ -780,6 +862,46 @@ namespace pgbckctl {
           > eps > identifier
           [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ];
 
+        /*
+         * CREATE SCHEDULE <identifier> FOR ARCHIVE <identifier> CRON "<expression>"
+         *   { BASEBACKUP [PROFILE <identifier>] | RETENTION POLICY <identifier> }
+         */
+        cmd_create_schedule = no_case[ lexeme[ lit("SCHEDULE") ] ]
+          [ boost::bind(&CatalogDescr::setCommandTag, &cmd, CREATE_SCHEDULE) ]
+          [ boost::bind(&CatalogDescr::makeScheduleDescr, &cmd) ]
+          > eps > identifier
+          [ boost::bind(&CatalogDescr::setScheduleName, &cmd, ::_1) ]
+          > eps > no_case[ lexeme[ lit("FOR") ] ]
+          > eps > no_case[ lexeme[ lit("ARCHIVE") ] ]
+          > eps > identifier
+          [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ]
+          > eps > no_case[ lexeme[ lit("CRON") ] ]
+          > eps > cron_expression
+          [ boost::bind(&CatalogDescr::setScheduleCron, &cmd, ::_1) ]
+          > eps > ( ( no_case[ lexeme[ lit("BASEBACKUP") ] ]
+                      [ boost::bind(&CatalogDescr::setScheduleAction, &cmd, SCHEDULE_ACTION_BASEBACKUP) ]
+                      > eps > -( no_case[ lexeme[ lit("PROFILE") ] ]
+                                 > eps > identifier
+                                 [ boost::bind(&CatalogDescr::setScheduleParam, &cmd, ::_1) ] ) )
+                    | ( no_case[ lexeme[ lit("RETENTION") ] ]
+                        [ boost::bind(&CatalogDescr::setScheduleAction, &cmd, SCHEDULE_ACTION_RETENTION) ]
+                        > eps > no_case[ lexeme[ lit("POLICY") ] ]
+                        > eps > identifier
+                        [ boost::bind(&CatalogDescr::setScheduleParam, &cmd, ::_1) ] ) );
+
+        /*
+         * DROP SCHEDULE <identifier> FROM ARCHIVE <identifier>
+         */
+        cmd_drop_schedule = no_case[ lexeme[ lit("SCHEDULE") ] ]
+          [ boost::bind(&CatalogDescr::setCommandTag, &cmd, DROP_SCHEDULE) ]
+          [ boost::bind(&CatalogDescr::makeScheduleDescr, &cmd) ]
+          > eps > identifier
+          [ boost::bind(&CatalogDescr::setScheduleName, &cmd, ::_1) ]
+          > eps > no_case[ lexeme[ lit("FROM") ] ]
+          > eps > no_case[ lexeme[ lit("ARCHIVE") ] ]
+          > eps > identifier
+          [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ];
+
         /*
          * DROP RETENTION POLICY <identifier>
          */
@@ -820,6 +942,7 @@ namespace pgbckctl {
           > eps > identifier
           [ boost::bind(&CatalogDescr::setIdent, &cmd, ::_1) ]
           > eps > -(with_profile)
+          > eps > -(incremental_basebackup | resume_basebackup)
           > eps > -(force_systemid_update);
 
         cmd_stop_streaming = no_case[lexeme[ lit("STREAMING") ]]
@@ -855,7 +978,27 @@ namespace pgbckctl {
                    [ boost::bind(&CatalogDescr ::setProfileCompressType, &cmd, BACKUP_COMPRESS_TYPE_PLAIN)]
                    | no_case[lexeme[ lit("LZ4") ]]
                    [ boost::bind(&CatalogDescr ::setProfileCompressType, &cmd,
-                                 BACKUP_COMPRESS_TYPE_LZ4)]);
+                                 BACKUP_COMPRESS_TYPE_LZ4)])
+          >> -(profile_compression_server_option);
+
+        /*
+         * CREATE BACKUP PROFILE ... COMPRESSION=<type> ON SERVER [LEVEL=<n>] [WORKERS=<n>]
+         */
+        profile_compression_server_option = no_case[lexeme[ lit("ON") ]]
+          > eps > no_case[lexeme[ lit("SERVER") ]]
+          [ boost::bind(&CatalogDescr::setProfileCompressOnServer, &cmd, true) ]
+          > -(profile_compression_level_option
+              [ boost::bind(&CatalogDescr::setProfileCompressLevel, &cmd, ::_1) ])
+          > -(profile_compression_workers_option
+              [ boost::bind(&CatalogDescr::setProfileCompressWorkers, &cmd, ::_1) ]);
+
+        profile_compression_level_option = no_case[lexeme[ lit("LEVEL") ]]
+          > eps > -lit("=")
+          > eps > +(char_("0-9"));
+
+        profile_compression_workers_option = no_case[lexeme[ lit("WORKERS") ]]
+          > eps > -lit("=")
+          > eps > +(char_("0-9"));
 
         /*
          * CREATE BACKUP PROFILE ...  MAX_RATE=<kbps>
@@ -930,6 +1073,28 @@ namespace pgbckctl {
                     profile_manifest_exclude_option
                     );
 
+        /*
+         * CREATE BACKUP PROFILE ... DEDUPLICATE=TRUE|FALSE
+         */
+        profile_deduplicate_option = no_case[lexeme[ lit("DEDUPLICATE") ]]
+          > eps > -lit("=")
+          > eps > (no_case[lexeme[ lit("TRUE") ]]
+                   [ boost::bind(&CatalogDescr::setProfileDeduplicate, &cmd, true) ]
+                   | no_case[lexeme[ lit("FALSE") ]]
+                   [ boost::bind(&CatalogDescr::setProfileDeduplicate, &cmd, false) ]
+                   );
+
+        /*
+         * CREATE BACKUP PROFILE ... VERIFY_PAGES=TRUE|FALSE
+         */
+        profile_verify_pages_option = no_case[lexeme[ lit("VERIFY_PAGES") ]]
+          > eps > -lit("=")
+          > eps > (no_case[lexeme[ lit("TRUE") ]]
+                   [ boost::bind(&CatalogDescr::setProfileVerifyPages, &cmd, true) ]
+                   | no_case[lexeme[ lit("FALSE") ]]
+                   [ boost::bind(&CatalogDescr::setProfileVerifyPages, &cmd, false) ]
+                   );
+
         profile_manifest_include_option =
           no_case[lexeme[ lit("INCLUDED") ]]
           [ boost::bind(&CatalogDescr::setProfileManifest, &cmd, true) ]
@@ -967,6 +1132,7 @@ namespace pgbckctl {
         /* We enforce quoting for path and label strings */
         directory_string = no_skip[ '"' > eps > +(char_ - ('"') ) > eps > '"' ];
         label_string     = no_skip[ '"' > eps > +(char_ - ('"') ) > eps > '"' ];
+        cron_expression  = no_skip[ '"' > eps > +(char_ - ('"') ) > eps > '"' ];
 
         /* A binary name (executable without full path */
         executable = +(char_("a-zA-Z0-9_-+/"));
@@ -980,6 +1146,14 @@ namespace pgbckctl {
         force_systemid_update = no_case[ lexeme [ lit("FORCE_SYSTEMID_UPDATE") ] ]
           [ boost::bind(&CatalogDescr::setForceSystemIDUpdate, &cmd, true) ];
 
+        /* handle INCREMENTAL option of START BASEBACKUP */
+        incremental_basebackup = no_case[ lexeme [ lit("INCREMENTAL") ] ]
+          [ boost::bind(&CatalogDescr::setIncremental, &cmd, true) ];
+
+        /* handle RESUME option of START BASEBACKUP */
+        resume_basebackup = no_case[ lexeme [ lit("RESUME") ] ]
+          [ boost::bind(&CatalogDescr::setResume, &cmd, true) ];
+
         /*
          * error handling
          */
@@ -1004,6 +1178,7 @@ namespace pgbckctl {
         cmd_start_launcher.name("LAUNCHER");
         cmd_start_streaming.name("STREAMING");
         cmd_start_recovery_stream.name("RECOVERY STREAM FOR ARCHIVE");
+        cmd_start_metrics_server.name("METRICS SERVER");
         cmd_stop_command.name("STOP");
         cmd_stop_streaming.name("STREAMING FOR ARCHIVE");
         cmd_show.name("SHOW");
@@ -1014,11 +1189,17 @@ namespace pgbckctl {
         cmd_create_backup_profile.name("BACKUP PROFILE");
         cmd_create_connection.name("STREAMING CONNECTION");
         cmd_create_retention.name("RETENTION POLICY");
-        cmd_verify_archive.name("VERIFY ARCHIVE");
+        cmd_verify.name("VERIFY");
+        cmd_verify_archive.name("ARCHIVE");
+        cmd_verify_basebackup.name("BASEBACKUP");
         cmd_drop_archive.name("ARCHIVE");
         cmd_drop_backup_profile.name("BACKUP_PROFILE");
         cmd_drop_connection.name("STREAMING CONNECTION");
         cmd_drop_retention.name("RETENTION POLICY");
+        cmd_create_schedule.name("SCHEDULE");
+        cmd_drop_schedule.name("SCHEDULE");
+        cmd_list_schedules.name("SCHEDULES");
+        cron_expression.name("<cron expression>");
         cmd_alter_archive.name("ALTER ARCHIVE");
         cmd_alter_archive_opt.name("ALTER ARCHIVE options");
         cmd_start_basebackup.name("BASEBACKUP");
@@ -1045,6 +1226,9 @@ namespace pgbckctl {
         executable.name("executable name");
         hostname.name("ip or hostname");
         profile_compression_option.name("COMPRESSION=GZIP|NONE");
+        profile_compression_server_option.name("ON SERVER [LEVEL=<level>] [WORKERS=<number>]");
+        profile_compression_level_option.name("LEVEL=compression level");
+        profile_compression_workers_option.name("WORKERS=number of compression workers");
         profile_max_rate_option.name("MAX_RATE=maximum transfer rate in KB/s");
         profile_wal_option.name("WAL=INCLUDED|EXCLUDED");
         profile_backup_label_option.name("LABEL=label string");
@@ -1062,12 +1246,16 @@ namespace pgbckctl {
         verify_check_connection.name("CONNECTION");
         profile_noverify_checksums_option.name("NOVERIFY");
         profile_manifest_option.name("MANIFEST");
+        profile_deduplicate_option.name("DEDUPLICATE=TRUE|FALSE");
+        profile_verify_pages_option.name("VERIFY_PAGES=TRUE|FALSE");
         profile_manifest_exclude_option.name("EXCLUDED");
         profile_manifest_include_option.name("INCLUDED");
         profile_manifest_checksums_option.name("WITH CHECKSUMS {NONE|CRC32|SHA224|SHA256|SHA384|SHA512}");
         retention_rule_with_label.name("WITH LABEL");
         regexp_expression.name("<regular expression>");
         force_systemid_update.name("FORCE_SYSTEMID_UPDATE");
+        incremental_basebackup.name("INCREMENTAL");
+        resume_basebackup.name("RESUME");
         variable_name.name("<variable name>");
         variable_value.name("<variable value>");
         cmd_drop_basebackup.name("BASEBACKUP");
@@ -1075,6 +1263,9 @@ namespace pgbckctl {
         ip_address_list.name("(<IP>)"); /* XXX: Might be adjusted once we support multiple bind addresses ... */
         ip_address_item.name(", <IP>");
         stream_listen_on.name("LISTEN_ON");
+        metrics_address_list.name("(<IP>)");
+        metrics_address_item.name(", <IP>");
+        metrics_listen_on.name("LISTEN_ON");
         number_ID.name("<number>"),
         variable_value_string.name("<string>");
       }
@@ -1084,11 +1275,12 @@ namespace pgbckctl {
        */
       qi::rule<Iterator, ascii::space_type> start;
       qi::rule<Iterator, ascii::space_type> cmd_create,
-        cmd_drop, cmd_list, cmd_alter, cmd_restore, cmd_restore_action,
+        cmd_drop, cmd_verify, cmd_list, cmd_alter, cmd_restore, cmd_restore_action,
         cmd_restore_type, tablespace_map, tablespace_map_oid,
         cmd_stat;
       qi::rule<Iterator, ascii::space_type> cmd_create_archive,
                           cmd_verify_archive,
+                          cmd_verify_basebackup,
                           cmd_drop_archive,
                           cmd_drop_connection,
                           cmd_alter_archive,
@@ -1099,6 +1291,7 @@ namespace pgbckctl {
                           cmd_start_launcher,
                           cmd_start_streaming,
                           cmd_start_recovery_stream,
+                          cmd_start_metrics_server,
                           cmd_stop_streaming,
                           cmd_list_archive,
                           cmd_list_connection,
@@ -1111,6 +1304,9 @@ namespace pgbckctl {
                           cmd_drop_backup_profile,
                           cmd_drop_retention,
                           cmd_drop_basebackup,
+                          cmd_create_schedule,
+                          cmd_drop_schedule,
+                          cmd_list_schedules,
                           cmd_alter_backup_profile,
                           cmd_create_connection,
                           cmd_create_retention,
@@ -1124,8 +1320,11 @@ namespace pgbckctl {
                           show_command_type,
                           profile_noverify_checksums_option,
                           profile_manifest_option,
+                          profile_deduplicate_option,
+                          profile_verify_pages_option,
                           profile_manifest_include_option,
                           profile_manifest_exclude_option,
+                          profile_compression_server_option,
                           backup_profile_opts,
                           retention_keep_action,
                           retention_drop_action,
@@ -1134,9 +1333,14 @@ namespace pgbckctl {
                           retention_datetime_spec,
                           retention_cleanup_basebackups,
                           force_systemid_update,
+                          incremental_basebackup,
+                          resume_basebackup,
                           stream_listen_on,
                           ip_address_list,
-                          ip_address_item;
+                          ip_address_item,
+                          metrics_listen_on,
+                          metrics_address_list,
+                          metrics_address_item;
 
       qi::rule<Iterator, std::string(), ascii::space_type> identifier;
       qi::rule<Iterator, std::string(), ascii::space_type> hostname,
@@ -1150,6 +1354,8 @@ namespace pgbckctl {
                           profile_checkpoint_option,
                           profile_max_rate_option,
                           profile_compression_option,
+                          profile_compression_level_option,
+                          profile_compression_workers_option,
                           profile_backup_label_option,
                           with_profile,
                           executable,
@@ -1161,6 +1367,7 @@ namespace pgbckctl {
       qi::rule<Iterator, std::string(), ascii::space_type> property_string,
                           directory_string,
                           label_string,
+                          cron_expression,
                           number_ID,
                           variable_name,
                           variable_value,
@@ -1416,6 +1623,10 @@ shared_ptr<CatalogDescr> PGBackupCtlCommand::getExecutableDescr() {
     result = make_shared<ShowWorkersCommandHandle>(this->catalogDescr);
     break;
 
+  case SHOW_EVENTS:
+    result = make_shared<ShowEventsCommandHandle>(this->catalogDescr);
+    break;
+
   case SHOW_VARIABLES:
     result = make_shared<ShowVariablesCatalogCommand>(this->catalogDescr);
     break;
@@ -1461,6 +1672,10 @@ shared_ptr<CatalogDescr> PGBackupCtlCommand::getExecutableDescr() {
     result = make_shared<DropBasebackupCatalogCommand>(this->catalogDescr);
     break;
 
+  case VERIFY_BASEBACKUP:
+    result = make_shared<VerifyBasebackupCatalogCommand>(this->catalogDescr);
+    break;
+
   case START_RECOVERY_STREAM_FOR_ARCHIVE:
     result = make_shared<StartRecoveryArchiveCommand>(this->catalogDescr);
     break;
@@ -1473,6 +1688,22 @@ shared_ptr<CatalogDescr> PGBackupCtlCommand::getExecutableDescr() {
     result = make_shared<StatArchiveBaseBackupCommand>(this->catalogDescr);
     break;
 
+  case START_METRICS_SERVER:
+    result = make_shared<StartMetricsServerCommand>(this->catalogDescr);
+    break;
+
+  case CREATE_SCHEDULE:
+    result = make_shared<CreateScheduleCommand>(this->catalogDescr);
+    break;
+
+  case DROP_SCHEDULE:
+    result = make_shared<DropScheduleCommand>(this->catalogDescr);
+    break;
+
+  case LIST_SCHEDULES:
+    result = make_shared<ListSchedulesCommand>(this->catalogDescr);
+    break;
+
   default:
     /* no-op, but we return nullptr ! */
     break;
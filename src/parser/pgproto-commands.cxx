@@ -237,7 +237,7 @@ void PGProtoListBasebackups::prepareListOfBackups() {
 
   /* Get list of basebackups */
   std::vector<std::shared_ptr<BaseBackupDescr>> list
-    = catalog->getBackupList(archive_descr->archive_name);
+    = snapshot->getBackupList();
 
   /* Check if a buffer aggregation step() was called before.
    * If true, die hard */
@@ -361,11 +361,13 @@ void PGProtoListBasebackups::execute(std::shared_ptr<ExecutableContext> context)
 
   try {
 
-    /* Prepare catalog lookups */
-    openCatalog();
-
-    /* Lookup archive data */
-    archive_descr = catalog->existsById(archive_id);
+    /*
+     * Archive data and basebackups are read from the catalog
+     * snapshot, which gets rebuilt only in case the catalog was
+     * changed since it was taken.
+     */
+    snapshot = catalogHandler->getSnapshot(archive_id, worker_shm);
+    archive_descr = snapshot->getArchive();
 
     BOOST_LOG_TRIVIAL(debug) << "recovery instance attached to archive "
                              << archive_descr->archive_name;
@@ -374,13 +376,8 @@ void PGProtoListBasebackups::execute(std::shared_ptr<ExecutableContext> context)
 
     prepareListOfBackups();
 
-    catalog->close();
-
   } catch (CPGBackupCtlFailure &e) {
 
-    if (catalog->opened())
-      catalog->close();
-
     /* re-throw as protocol command failure */
     throw PGProtoCmdFailure(e.what());
   }
@@ -6,6 +6,135 @@
 using namespace pgbckctl;
 using namespace pgbckctl::pgprotocol;
 
+/* ****************************************************************************
+ * PGProtoCatalogSnapshot implementation
+ * ***************************************************************************/
+
+PGProtoCatalogSnapshot::PGProtoCatalogSnapshot() {}
+
+PGProtoCatalogSnapshot::~PGProtoCatalogSnapshot() {}
+
+void PGProtoCatalogSnapshot::build(BackupCatalog &catalog,
+                                   int archive_id,
+                                   unsigned long long generation) {
+
+  std::shared_ptr<CatalogDescr> archiveDescr = catalog.existsById(archive_id);
+
+  if (archiveDescr->id < 0) {
+
+    std::ostringstream oss;
+
+    oss << "cannot build catalog snapshot for archive ID \""
+        << archive_id << "\": archive does not exist";
+    throw CCatalogIssue(oss.str());
+
+  }
+
+  /*
+   * Fetch everything in one go before replacing the current
+   * contents, so we never leave a half-built snapshot behind
+   * in case the catalog throws.
+   */
+  std::vector<std::shared_ptr<BaseBackupDescr>> list
+    = catalog.getBackupList(archiveDescr->archive_name);
+
+  this->archive     = archiveDescr;
+  this->basebackups = list;
+  this->archive_id  = archive_id;
+  this->generation  = generation;
+
+  BOOST_LOG_TRIVIAL(debug) << "catalog snapshot for archive "
+                           << archive->archive_name
+                           << " built with "
+                           << basebackups.size()
+                           << " basebackups, generation "
+                           << generation;
+
+}
+
+bool PGProtoCatalogSnapshot::isValid(int archive_id,
+                                     unsigned long long generation) {
+
+  return ( (this->archive != nullptr)
+           && (this->archive_id == archive_id)
+           && (this->generation == generation) );
+
+}
+
+unsigned long long PGProtoCatalogSnapshot::getGeneration() {
+
+  return generation;
+
+}
+
+std::shared_ptr<CatalogDescr> PGProtoCatalogSnapshot::getArchive() {
+
+  return archive;
+
+}
+
+std::vector<std::shared_ptr<BaseBackupDescr>> PGProtoCatalogSnapshot::getBackupList() {
+
+  return basebackups;
+
+}
+
+std::shared_ptr<BaseBackupDescr> PGProtoCatalogSnapshot::getBaseBackup(BaseBackupRetrieveMode mode,
+                                                                       bool valid_only) {
+
+  std::shared_ptr<BaseBackupDescr> result = nullptr;
+
+  /*
+   * Same ordering as BackupCatalog::getBaseBackup(), which sorts
+   * by the stop timestamp. Timestamps are stored in ISO 8601 format,
+   * so comparing them as strings is sufficient.
+   */
+  for (auto &descr : basebackups) {
+
+    if (valid_only && descr->status != BaseBackupDescr::BASEBACKUP_STATUS_READY)
+      continue;
+
+    if (result == nullptr) {
+      result = descr;
+      continue;
+    }
+
+    if ( (mode == BASEBACKUP_NEWEST && descr->stopped > result->stopped)
+         || (mode == BASEBACKUP_OLDEST && descr->stopped < result->stopped) ) {
+      result = descr;
+    }
+
+  }
+
+  if (result == nullptr) {
+    result = std::make_shared<BaseBackupDescr>();
+    result->id = -1;
+  }
+
+  return result;
+
+}
+
+std::shared_ptr<BaseBackupDescr> PGProtoCatalogSnapshot::getBaseBackup(std::string basebackup_fqfn) {
+
+  for (auto &descr : basebackups) {
+
+    if (descr->fsentry == basebackup_fqfn)
+      return descr;
+
+  }
+
+  std::shared_ptr<BaseBackupDescr> result = std::make_shared<BaseBackupDescr>();
+  result->id = -1;
+
+  return result;
+
+}
+
+/* ****************************************************************************
+ * PGProtoCatalogHandler implementation
+ * ***************************************************************************/
+
 PGProtoCatalogHandler::PGProtoCatalogHandler(std::string catalog_name) {
 
   /*
@@ -57,6 +186,45 @@ string PGProtoCatalogHandler::getCatalogFullname() {
 
 }
 
+std::shared_ptr<PGProtoCatalogSnapshot> PGProtoCatalogHandler::getSnapshot(int archive_id,
+                                                                           std::shared_ptr<WorkerSHM> shm) {
+
+  unsigned long long generation = 0;
+  bool have_generation = false;
+
+  if (shm != nullptr && shm->get_shmid() >= 0) {
+
+    generation = shm->getCatalogGeneration();
+    have_generation = true;
+
+  }
+
+  if (snapshot == nullptr) {
+    snapshot = std::make_shared<PGProtoCatalogSnapshot>();
+  }
+
+  /*
+   * Without a generation counter we can't tell whether the snapshot
+   * is still current, so better rebuild it.
+   */
+  if (!have_generation || !snapshot->isValid(archive_id, generation)) {
+
+    /*
+     * Build into a new instance, so that callers still holding
+     * the former snapshot aren't affected.
+     */
+    std::shared_ptr<PGProtoCatalogSnapshot> new_snapshot
+      = std::make_shared<PGProtoCatalogSnapshot>();
+
+    new_snapshot->build(*catalog, archive_id, generation);
+    snapshot = new_snapshot;
+
+  }
+
+  return snapshot;
+
+}
+
 std::shared_ptr<BaseBackupDescr> PGProtoCatalogHandler::attach(std::string basebackup_fqfn,
                                                                int archive_id,
                                                                int worker_id,
@@ -102,20 +270,23 @@ std::shared_ptr<BaseBackupDescr> PGProtoCatalogHandler::attach(std::string baseb
    * if basebackup_fqfn is either newest, latest or oldest, we
    * have to do additional work.
    */
+  /*
+   * Lookups are answered from the catalog snapshot, which
+   * is usually inherited from the listener process and only rebuilt
+   * if the catalog has changed in the meantime.
+   */
+  std::shared_ptr<PGProtoCatalogSnapshot> current = getSnapshot(archive_id, shm);
+
   if ( (basebackup_fqfn == "latest") || (basebackup_fqfn == "newest") ) {
 
-    attached_basebackup = catalog->getBaseBackup(BASEBACKUP_NEWEST,
-                                                 archive_id,
-                                                 true);
+    attached_basebackup = current->getBaseBackup(BASEBACKUP_NEWEST, true);
 
   } else if (basebackup_fqfn == "oldest") {
 
-    attached_basebackup = catalog->getBaseBackup(BASEBACKUP_OLDEST,
-                                                 archive_id,
-                                                 true);
+    attached_basebackup = current->getBaseBackup(BASEBACKUP_OLDEST, true);
 
   } else {
-    attached_basebackup = catalog->getBaseBackup(basebackup_fqfn, archive_id);
+    attached_basebackup = current->getBaseBackup(basebackup_fqfn);
   }
 
   /*
@@ -126,15 +297,14 @@ std::shared_ptr<BaseBackupDescr> PGProtoCatalogHandler::attach(std::string baseb
 
     sub_worker_info child_info;
 
-    /* Employ a mutex to avoid race conditions between read() and write(). */
-    WORKER_SHM_CRITICAL_SECTION_START_P(shm);
-
+    /*
+     * The child slot is owned by us, so nobody else modifies
+     * it between read() and write().
+     */
     child_info = shm->read(worker_id, child_id);
     child_info.backup_id = attached_basebackup->id;
     shm->write(worker_id, child_id, child_info);
 
-    WORKER_SHM_CRITICAL_SECTION_END;
-
   } else {
 
     throw CCatalogIssue("error attaching basebackup in recovery instance");
@@ -146,6 +316,7 @@ std::shared_ptr<BaseBackupDescr> PGProtoCatalogHandler::attach(std::string baseb
    */
   this->worker_id = worker_id;
   this->child_id  = child_id;
+  this->worker_shm = shm;
 
   return attached_basebackup;
 
@@ -163,14 +334,8 @@ void PGProtoCatalogHandler::detach(unsigned int worker_id,
    */
   if (isAttached()) {
 
-    sub_worker_info child_info;
-
-    WORKER_SHM_CRITICAL_SECTION_START_P(shm);
-
     shm->detach_basebackup(worker_id, child_id);
 
-    WORKER_SHM_CRITICAL_SECTION_END;
-
     attached_basebackup = nullptr;
 
   }
@@ -214,7 +379,8 @@ void PGProtoCatalogHandler::queryTimelineHistory(std::shared_ptr<PGProtoResultSe
    * Archive our basebackup is attached to. We need this to
    * get the catalog parent directory for basebackups.
    */
-  catalogDescr = catalog->existsById(attached_basebackup->archive_id);
+  catalogDescr = getSnapshot(attached_basebackup->archive_id,
+                             worker_shm)->getArchive();
 
   /*
    * We got a valid descriptor?
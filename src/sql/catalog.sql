@@ -5,6 +5,27 @@ CREATE TABLE archive(
        compression    integer
 );
 
+/*
+ * Materialized per-archive statistics, maintained incrementally
+ * by the catalog API whenever basebackups are registered, finalized,
+ * aborted or deleted and whenever WAL segments are streamed into
+ * or removed from the archive. Saves STAT ARCHIVE from aggregating
+ * over the backup and backup_tablespaces tables.
+ */
+CREATE TABLE archive_stat(
+       archive_id integer not null primary key,
+       number_of_backups integer not null default 0,
+       backups_failed integer not null default 0,
+       backups_running integer not null default 0,
+       backups_ready integer not null default 0,
+       total_duration integer not null default 0,
+       approx_sz bigint not null default 0,
+       latest_finished text null,
+       wal_segments integer not null default 0,
+       wal_bytes bigint not null default 0,
+       FOREIGN KEY(archive_id) REFERENCES archive(id) ON DELETE CASCADE
+);
+
 CREATE TABLE connections(
        archive_id integer NOT NULL,
        type       text NOT NULL,
@@ -33,22 +54,60 @@ CREATE TABLE backup(
        wal_segment_size int not null,
        used_profile int not null,
        pg_version_num int not null,
+       parent_id integer null,
+       bad_pages integer not null default 0,
+       bad_pages_detail text null,
        FOREIGN KEY(archive_id) REFERENCES archive(id) ON DELETE CASCADE,
        FOREIGN KEY(used_profile) REFERENCES backup_profiles(id) ON DELETE RESTRICT ON UPDATE RESTRICT
 );
 
 CREATE INDEX backup_id_idx ON backup(id);
 CREATE INDEX backup_archive_id_idx ON backup(archive_id);
+CREATE INDEX backup_parent_id_idx ON backup(parent_id);
 
 CREATE TABLE backup_tablespaces(
        backup_id integer not null,
        spcoid integer null,
        spclocation text null,
        spcsize bigint not null,
+       checksum_algorithm text null,
+       checksum text null,
        PRIMARY KEY(backup_id, spcoid),
        FOREIGN KEY(backup_id) REFERENCES backup(id) ON DELETE CASCADE
 );
 
+/*
+ * WAL segments streamed into an archive, together with the
+ * checksum of their (uncompressed) contents computed while they
+ * were written. Rows are removed by retention cleanup along
+ * with their segment files.
+ */
+CREATE TABLE wal_segments(
+       archive_id integer not null,
+       name text not null,
+       timeline integer not null,
+       size bigint not null,
+       checksum_algorithm text not null,
+       checksum text not null,
+       created text not null,
+       PRIMARY KEY(archive_id, name),
+       FOREIGN KEY(archive_id) REFERENCES archive(id) ON DELETE CASCADE
+);
+
+/*
+ * Chunks in the chunk store of an archive (see DEDUPLICATE in
+ * backup profiles) and the number of basebackups referencing them.
+ * Chunks no longer referenced are removed by retention.
+ */
+CREATE TABLE chunks(
+       archive_id integer not null,
+       hash text not null,
+       size bigint not null,
+       refcount integer not null default 0,
+       PRIMARY KEY(archive_id, hash),
+       FOREIGN KEY(archive_id) REFERENCES archive(id) ON DELETE CASCADE
+);
+
 CREATE TABLE stream(
        id integer primary key not null,
        archive_id integer not null,
@@ -71,7 +130,7 @@ CREATE TABLE version(
        create_date text not null);
 
 /* NOTE: version number must match CATALOG_MAGIC from include/catalog/catalog.hxx */
-INSERT INTO version VALUES(108, datetime('now'));
+INSERT INTO version VALUES(116, datetime('now'));
 
 CREATE TABLE backup_profiles(
        id integer not null,
@@ -85,6 +144,11 @@ CREATE TABLE backup_profiles(
        noverify_checksums integer not null default false,
        manifest boolean not null default false,
        manifest_checksums text not null default 'CRC32C',
+       compress_on_server integer not null default false,
+       compress_level integer not null default 0,
+       compress_workers integer not null default 0,
+       deduplicate integer not null default false,
+       verify_pages integer not null default false,
        PRIMARY KEY(id)
 );
 
@@ -138,3 +202,59 @@ CREATE TABLE retention_rules(
 );
 
 CREATE UNIQUE INDEX retention_rules_id_type_uniq_idx ON retention_rules(id, type);
+
+/*
+ * Persisted retention plans. APPLY RETENTION POLICY records the
+ * basebackups it is going to delete together with the WAL cleanup
+ * offsets computed by the retention rules before touching the
+ * filesystem. The plan is then executed in batches, an interrupted
+ * run continues with the remaining entries. There is at most one
+ * plan per archive.
+ */
+CREATE TABLE retention_plan(
+       archive_id integer not null primary key,
+       retention_name text not null,
+       created text not null,
+       wal_segment_size integer not null,
+       wal_cleanup_mode integer not null,
+       FOREIGN KEY(archive_id) REFERENCES archive(id) ON DELETE CASCADE
+);
+
+CREATE TABLE retention_plan_backups(
+       archive_id integer not null,
+       backup_id integer not null,
+       fsentry text not null,
+       FOREIGN KEY(archive_id) REFERENCES retention_plan(archive_id) ON DELETE CASCADE
+);
+
+CREATE UNIQUE INDEX retention_plan_backups_uniq_idx ON retention_plan_backups(archive_id, backup_id);
+
+CREATE TABLE retention_plan_wal(
+       archive_id integer not null,
+       timeline integer not null,
+       wal_segment_size integer not null,
+       wal_cleanup_start_pos integer not null,
+       wal_cleanup_end_pos integer not null,
+       FOREIGN KEY(archive_id) REFERENCES retention_plan(archive_id) ON DELETE CASCADE
+);
+
+CREATE UNIQUE INDEX retention_plan_wal_uniq_idx ON retention_plan_wal(archive_id, timeline);
+
+/*
+ * Job schedules executed by the launcher. The cron column holds
+ * a five field cron expression, param the backup profile or
+ * retention policy name, depending on the action.
+ */
+CREATE TABLE schedules(
+       id integer not null primary key,
+       archive_id integer not null,
+       name text not null,
+       cron text not null,
+       action text not null CHECK(action IN ('basebackup', 'retention')),
+       param text not null default '',
+       created text not null,
+       last_run text,
+       FOREIGN KEY(archive_id) REFERENCES archive(id) ON DELETE CASCADE
+);
+
+CREATE UNIQUE INDEX schedules_archive_id_name_uniq_idx ON schedules(archive_id, name);
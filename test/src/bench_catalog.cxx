@@ -0,0 +1,672 @@
+/*
+ * Catalog benchmark and load generator.
+ *
+ * Populates a synthetic backup catalog and measures the latency of
+ * frequently used catalog operations, first within a single process and
+ * afterwards with a configurable number of concurrent processes.
+ *
+ * Usage:
+ *
+ *   bench_catalog [--catalog FILE] [--archives N] [--backups N]
+ *                 [--tablespaces N] [--streams N] [--rules N]
+ *                 [--iterations N] [--procs N] [--keep]
+ *
+ * The catalog FILE must not exist, it is created from the catalog
+ * schema this benchmark was built with and removed afterwards unless
+ * --keep was specified.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+extern "C" {
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+}
+
+#include <common.hxx>
+#include <BackupCatalog.hxx>
+#include <retention.hxx>
+#include <backuplockinfo.hxx>
+#include <streamident.hxx>
+
+using namespace pgbckctl;
+
+#ifndef PGBCKCTL_CATALOG_SQL
+#define PGBCKCTL_CATALOG_SQL "src/sql/catalog.sql"
+#endif
+
+/*
+ * Operations measured by the benchmark. Keep bench_op_names in sync.
+ */
+typedef enum {
+  BENCH_GET_BASEBACKUP_NEWEST,
+  BENCH_GET_BASEBACKUP_OLDEST,
+  BENCH_GET_BASEBACKUP_ID,
+  BENCH_GET_BASEBACKUP_FQFN,
+  BENCH_GET_BACKUP_LIST,
+  BENCH_STAT_CATALOG,
+  BENCH_GET_STREAMS,
+  BENCH_RETENTION_APPLY,
+  BENCH_REGISTER_PROC,
+  BENCH_UPDATE_PROC,
+  BENCH_NUM_OPS
+} BenchOp;
+
+static const char *bench_op_names[] = {
+  "getBaseBackup(newest)",
+  "getBaseBackup(oldest)",
+  "getBaseBackup(id)",
+  "getBaseBackup(fqfn)",
+  "getBackupList",
+  "statCatalog",
+  "getStreams",
+  "retention apply",
+  "registerProc",
+  "updateProc"
+};
+
+/*
+ * Benchmark settings, see usage above.
+ */
+typedef struct {
+
+  std::string catalog_name = "bench_catalog.sqlite";
+  unsigned int archives = 4;
+  unsigned int backups = 100;
+  unsigned int tablespaces = 4;
+  unsigned int streams = 2;
+  unsigned int rules = 2;
+  unsigned int iterations = 200;
+  unsigned int procs = 4;
+  bool keep = false;
+
+} bench_settings;
+
+/*
+ * Latency sample, as transported from load generator
+ * childs to the parent process.
+ */
+typedef struct {
+
+  int op;
+  double usec;
+
+} bench_sample;
+
+/*
+ * Per archive data the load generator picks from.
+ */
+typedef struct {
+
+  std::shared_ptr<CatalogDescr> archive;
+  std::vector<int> backup_ids;
+  std::vector<std::string> backup_fqfns;
+
+} bench_archive;
+
+static void usage() {
+
+  std::cerr << "usage: bench_catalog [--catalog FILE] [--archives N] [--backups N]" << std::endl
+            << "                     [--tablespaces N] [--streams N] [--rules N]" << std::endl
+            << "                     [--iterations N] [--procs N] [--keep]" << std::endl;
+
+}
+
+static bool parse_args(int argc, char **argv, bench_settings &settings) {
+
+  std::map<std::string, unsigned int *> numeric_opts = {
+    { "--archives", &settings.archives },
+    { "--backups", &settings.backups },
+    { "--tablespaces", &settings.tablespaces },
+    { "--streams", &settings.streams },
+    { "--rules", &settings.rules },
+    { "--iterations", &settings.iterations },
+    { "--procs", &settings.procs }
+  };
+
+  for (int i = 1; i < argc; i++) {
+
+    std::string opt = argv[i];
+
+    if (opt == "--keep") {
+      settings.keep = true;
+      continue;
+    }
+
+    if (i + 1 >= argc)
+      return false;
+
+    if (opt == "--catalog") {
+      settings.catalog_name = argv[++i];
+      continue;
+    }
+
+    auto it = numeric_opts.find(opt);
+
+    if (it == numeric_opts.end())
+      return false;
+
+    *(it->second) = CPGBackupCtlBase::strToInt(argv[++i]);
+
+  }
+
+  return (settings.archives > 0 && settings.backups > 0);
+
+}
+
+/*
+ * Creates the catalog database from the schema file.
+ */
+static void create_catalog(std::string catalog_name) {
+
+  sqlite3 *db = NULL;
+  std::ostringstream schema;
+  char *errmsg = NULL;
+
+  if (boost::filesystem::exists(catalog_name)) {
+    throw CCatalogIssue("catalog " + catalog_name + " already exists");
+  }
+
+  std::ifstream schema_file(PGBCKCTL_CATALOG_SQL);
+
+  if (!schema_file.is_open()) {
+    throw CCatalogIssue("could not open catalog schema " + std::string(PGBCKCTL_CATALOG_SQL));
+  }
+
+  schema << schema_file.rdbuf();
+
+  if (sqlite3_open(catalog_name.c_str(), &db) != SQLITE_OK) {
+    throw CCatalogIssue("could not create catalog " + catalog_name);
+  }
+
+  if (sqlite3_exec(db, schema.str().c_str(), NULL, NULL, &errmsg) != SQLITE_OK) {
+
+    std::string err = (errmsg != NULL) ? errmsg : "unknown error";
+
+    sqlite3_free(errmsg);
+    sqlite3_close(db);
+    throw CCatalogIssue("could not initialize catalog schema: " + err);
+
+  }
+
+  sqlite3_close(db);
+
+}
+
+/*
+ * Populates the catalog with synthetic archives, basebackups,
+ * tablespaces, streams and retention policies.
+ */
+static std::vector<bench_archive> populate(std::shared_ptr<BackupCatalog> catalog,
+                                           bench_settings &settings) {
+
+  std::vector<bench_archive> result;
+
+  catalog->startTransaction();
+
+  for (unsigned int a = 0; a < settings.archives; a++) {
+
+    bench_archive bench_descr;
+    std::shared_ptr<CatalogDescr> desc = std::make_shared<CatalogDescr>();
+    std::ostringstream name;
+
+    name << "bench_" << a;
+
+    desc->archive_name = name.str();
+    desc->directory = "/tmp/" + name.str();
+    desc->compression = false;
+    desc->coninfo->type = ConnectionDescr::CONNECTION_TYPE_BASEBACKUP;
+    catalog->createArchive(desc);
+
+    desc->coninfo->pushAffectedAttribute(SQL_CON_DSN_ATTNO);
+    desc->coninfo->pushAffectedAttribute(SQL_CON_ARCHIVE_ID_ATTNO);
+    desc->coninfo->pushAffectedAttribute(SQL_CON_TYPE_ATTNO);
+    desc->coninfo->dsn = "host=bench.server.name dbname=bench user=bench";
+    desc->coninfo->archive_id = desc->id;
+    catalog->createCatalogConnection(desc->coninfo);
+
+    /* Retention refuses to operate on untagged archive descriptors */
+    bench_descr.archive = catalog->existsByName(desc->archive_name);
+    bench_descr.archive->tag = APPLY_RETENTION_POLICY;
+
+    for (unsigned int b = 0; b < settings.backups; b++) {
+
+      std::shared_ptr<BaseBackupDescr> bb = std::make_shared<BaseBackupDescr>();
+      std::vector<std::shared_ptr<BackupTablespaceDescr>> tablespaces;
+      std::ostringstream fsentry;
+
+      fsentry << desc->directory << "/base/streamed-basebackup-" << b;
+
+      bb->archive_id = desc->id;
+      bb->xlogpos = "0/2000028";
+      bb->timeline = 1;
+      bb->label = "bench";
+      bb->fsentry = fsentry.str();
+      bb->started = CPGBackupCtlBase::current_timestamp();
+      bb->systemid = "1234";
+      bb->wal_segment_size = 16 * 1024 * 1024;
+      bb->used_profile = 1;
+      bb->pg_version_num = 130000;
+
+      catalog->registerBasebackup(desc->id, bb);
+
+      for (unsigned int t = 0; t < settings.tablespaces; t++) {
+
+        std::shared_ptr<BackupTablespaceDescr> tblspc = std::make_shared<BackupTablespaceDescr>();
+
+        tblspc->backup_id = bb->id;
+        tblspc->spcoid = (t == 0) ? 0 : 16384 + t;
+        tblspc->spclocation = (t == 0) ? "" : desc->directory + "/spc";
+        tblspc->spcsize = 1024 * 1024;
+        tablespaces.push_back(tblspc);
+
+      }
+
+      catalog->registerTablespacesForBackup(tablespaces);
+
+      bb->xlogposend = "0/3000000";
+      catalog->finalizeBasebackup(bb);
+
+      bench_descr.backup_ids.push_back(bb->id);
+      bench_descr.backup_fqfns.push_back(bb->fsentry);
+
+    }
+
+    for (unsigned int s = 0; s < settings.streams; s++) {
+
+      StreamIdentification ident;
+      std::ostringstream stype;
+
+      /*
+       * The catalog allows one stream per archive and type, so
+       * use synthetic stream types to populate more than one.
+       */
+      stype << "streamer_" << s;
+
+      ident.systemid = "1234";
+      ident.timeline = 1;
+      ident.xlogpos = "0/2000000";
+      ident.dbname = "bench";
+      ident.status = StreamIdentification::STREAM_PROGRESS_IDENTIFIED;
+
+      catalog->registerStream(desc->id, stype.str(), ident);
+
+    }
+
+    result.push_back(bench_descr);
+
+  }
+
+  /*
+   * Retention policies allow a single rule per type only, so create
+   * one KEEP policy per requested rule. The load generator applies
+   * them in turn to the archives.
+   */
+  for (unsigned int r = 0; r < settings.rules; r++) {
+
+    std::shared_ptr<RetentionDescr> policy = std::make_shared<RetentionDescr>();
+    std::shared_ptr<RetentionRuleDescr> rule = std::make_shared<RetentionRuleDescr>();
+
+    policy->name = "bench_" + CPGBackupCtlBase::uintToStr(r);
+
+    rule->type = RETENTION_KEEP_NUM;
+    rule->value = CPGBackupCtlBase::uintToStr(settings.backups / (r + 2) + 1);
+    policy->rules.push_back(rule);
+
+    catalog->createRetentionPolicy(policy);
+
+  }
+
+  catalog->commitTransaction();
+
+  return result;
+
+}
+
+/*
+ * Runs the load generator loop on its own catalog connection and
+ * collects a latency sample for each measured operation.
+ */
+static std::vector<bench_sample> run_load(bench_settings &settings,
+                                          std::vector<bench_archive> &archives,
+                                          unsigned int worker) {
+
+  std::vector<bench_sample> samples;
+  std::shared_ptr<BackupCatalog> catalog
+    = std::make_shared<BackupCatalog>(settings.catalog_name);
+  std::mt19937 rnd(worker + 1);
+
+  samples.reserve(settings.iterations * BENCH_NUM_OPS);
+
+  auto measure = [&samples](BenchOp op, std::function<void()> fn) {
+
+    auto start = std::chrono::steady_clock::now();
+
+    fn();
+
+    std::chrono::duration<double, std::micro> elapsed
+      = std::chrono::steady_clock::now() - start;
+    samples.push_back({ op, elapsed.count() });
+
+  };
+
+  for (unsigned int i = 0; i < settings.iterations; i++) {
+
+    bench_archive &bench_descr = archives[rnd() % archives.size()];
+    std::shared_ptr<CatalogDescr> archive = bench_descr.archive;
+    unsigned int backup_index = rnd() % bench_descr.backup_ids.size();
+    std::vector<std::shared_ptr<BaseBackupDescr>> list;
+    std::shared_ptr<CatalogProc> proc = std::make_shared<CatalogProc>();
+
+    measure(BENCH_GET_BASEBACKUP_NEWEST, [&]() {
+        catalog->getBaseBackup(BASEBACKUP_NEWEST, archive->id, true);
+      });
+
+    measure(BENCH_GET_BASEBACKUP_OLDEST, [&]() {
+        catalog->getBaseBackup(BASEBACKUP_OLDEST, archive->id, true);
+      });
+
+    measure(BENCH_GET_BASEBACKUP_ID, [&]() {
+        catalog->getBaseBackup(bench_descr.backup_ids[backup_index], archive->id);
+      });
+
+    measure(BENCH_GET_BASEBACKUP_FQFN, [&]() {
+        catalog->getBaseBackup(bench_descr.backup_fqfns[backup_index], archive->id);
+      });
+
+    measure(BENCH_GET_BACKUP_LIST, [&]() {
+        list = catalog->getBackupList(archive->archive_name);
+      });
+
+    measure(BENCH_STAT_CATALOG, [&]() {
+        catalog->statCatalog(archive->archive_name);
+      });
+
+    measure(BENCH_GET_STREAMS, [&]() {
+        std::vector<std::shared_ptr<StreamIdentification>> streams;
+        catalog->getStreams(archive->archive_name, streams);
+      });
+
+    if (settings.rules > 0) {
+
+      measure(BENCH_RETENTION_APPLY, [&]() {
+
+          std::vector<std::shared_ptr<Retention>> rules
+            = Retention::get("bench_" + CPGBackupCtlBase::uintToStr(i % settings.rules),
+                             archive, catalog);
+          std::shared_ptr<BackupCleanupDescr> cleanupDescr = nullptr;
+
+          for (auto &rule : rules) {
+
+            rule->addLockInfo(std::make_shared<BackupPinnedValidLockInfo>());
+
+            if (cleanupDescr == nullptr)
+              rule->init();
+            else
+              rule->init(cleanupDescr);
+
+            if (rule->apply(list) > 0)
+              cleanupDescr = rule->getCleanupDescr();
+
+          }
+
+        });
+
+    }
+
+    /*
+     * Fake process handles, unique for each worker and
+     * iteration, so concurrent workers don't collide.
+     */
+    proc->pid = 1000000 + worker * settings.iterations + i;
+    proc->archive_id = -proc->pid;
+    proc->type = CatalogProc::PROC_TYPE_STREAMER;
+    proc->started = CPGBackupCtlBase::current_timestamp();
+    proc->state = CatalogProc::PROC_STATUS_RUNNING;
+    proc->shm_key = -1;
+    proc->shm_id = -1;
+    proc->pushAffectedAttribute(SQL_PROCS_PID_ATTNO);
+    proc->pushAffectedAttribute(SQL_PROCS_ARCHIVE_ID_ATTNO);
+    proc->pushAffectedAttribute(SQL_PROCS_TYPE_ATTNO);
+    proc->pushAffectedAttribute(SQL_PROCS_STARTED_ATTNO);
+    proc->pushAffectedAttribute(SQL_PROCS_STATE_ATTNO);
+    proc->pushAffectedAttribute(SQL_PROCS_SHM_KEY_ATTNO);
+    proc->pushAffectedAttribute(SQL_PROCS_SHM_ID_ATTNO);
+
+    measure(BENCH_REGISTER_PROC, [&]() {
+        catalog->registerProc(proc);
+      });
+
+    proc->state = CatalogProc::PROC_STATUS_SHUTDOWN;
+
+    measure(BENCH_UPDATE_PROC, [&]() {
+        std::vector<int> attrs = { SQL_PROCS_STATE_ATTNO };
+        catalog->updateProc(proc, attrs, proc->pid, proc->archive_id);
+      });
+
+    catalog->unregisterProc(proc->pid, proc->archive_id);
+
+  }
+
+  catalog->close();
+
+  return samples;
+
+}
+
+/*
+ * Prints latency percentiles per operation.
+ */
+static void report(std::string title,
+                   std::vector<bench_sample> &samples,
+                   double wall_usec) {
+
+  std::vector<std::vector<double>> by_op(BENCH_NUM_OPS);
+
+  for (auto &sample : samples)
+    by_op[sample.op].push_back(sample.usec);
+
+  std::cout << CPGBackupCtlBase::makeHeader(title,
+                                            boost::format("%-24s%8s%10s%10s%10s%10s%10s")
+                                            % "operation" % "count" % "mean"
+                                            % "p50" % "p90" % "p99" % "max",
+                                            82);
+
+  for (unsigned int op = 0; op < BENCH_NUM_OPS; op++) {
+
+    std::vector<double> &values = by_op[op];
+    double sum = 0;
+
+    if (values.size() == 0)
+      continue;
+
+    std::sort(values.begin(), values.end());
+
+    for (auto &value : values)
+      sum += value;
+
+    auto percentile = [&values](double p) {
+      return values[std::min<size_t>(values.size() - 1,
+                                     (size_t) (p * values.size()))];
+    };
+
+    std::cout << boost::format("%-24s%8d%10.1f%10.1f%10.1f%10.1f%10.1f")
+      % bench_op_names[op] % values.size() % (sum / values.size())
+      % percentile(0.50) % percentile(0.90) % percentile(0.99) % values.back()
+              << std::endl;
+
+  }
+
+  std::cout << boost::format("%-24s%8d ops in %.1f ms (latencies in usec)")
+    % "total" % samples.size() % (wall_usec / 1000.0) << std::endl << std::endl;
+
+}
+
+/*
+ * Forks the requested number of load generator processes and
+ * collects their samples through a pipe each.
+ */
+static std::vector<bench_sample> run_concurrent(bench_settings &settings,
+                                                std::vector<bench_archive> &archives) {
+
+  std::vector<bench_sample> samples;
+  std::vector<std::pair<pid_t, int>> childs;
+
+  for (unsigned int w = 0; w < settings.procs; w++) {
+
+    int fds[2];
+    pid_t pid;
+
+    if (::pipe(fds) < 0) {
+      throw CPGBackupCtlFailure("could not create pipe for load generator");
+    }
+
+    pid = fork();
+
+    if (pid < 0) {
+      throw CPGBackupCtlFailure("could not fork load generator");
+    }
+
+    if (pid == 0) {
+
+      int rc = 0;
+
+      ::close(fds[0]);
+
+      try {
+
+        std::vector<bench_sample> child_samples = run_load(settings, archives, w + 1);
+        const char *ptr = (const char *) child_samples.data();
+        size_t len = child_samples.size() * sizeof(bench_sample);
+
+        while (len > 0) {
+
+          ssize_t written = ::write(fds[1], ptr, len);
+
+          if (written <= 0) {
+            rc = 1;
+            break;
+          }
+
+          ptr += written;
+          len -= written;
+
+        }
+
+      } catch (std::exception &e) {
+
+        std::cerr << "load generator " << w << " failed: " << e.what() << std::endl;
+        rc = 1;
+
+      }
+
+      ::close(fds[1]);
+      _exit(rc);
+
+    }
+
+    ::close(fds[1]);
+    childs.push_back(std::make_pair(pid, fds[0]));
+
+  }
+
+  for (auto &child : childs) {
+
+    bench_sample sample;
+    int status;
+
+    while (::read(child.second, &sample, sizeof(sample)) == sizeof(sample))
+      samples.push_back(sample);
+
+    ::close(child.second);
+    waitpid(child.first, &status, 0);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cerr << "load generator " << child.first << " exited abnormally" << std::endl;
+    }
+
+  }
+
+  return samples;
+
+}
+
+int main(int argc, char **argv) {
+
+  bench_settings settings;
+  std::shared_ptr<BackupCatalog> catalog = nullptr;
+  std::vector<bench_archive> archives;
+  int rc = 0;
+
+  if (!parse_args(argc, argv, settings)) {
+    usage();
+    return 1;
+  }
+
+  CPGBackupCtlBase::set_log_severity("warning");
+
+  try {
+
+    create_catalog(settings.catalog_name);
+
+    catalog = std::make_shared<BackupCatalog>(settings.catalog_name);
+
+    auto start = std::chrono::steady_clock::now();
+
+    archives = populate(catalog, settings);
+
+    std::chrono::duration<double, std::milli> elapsed
+      = std::chrono::steady_clock::now() - start;
+
+    std::cout << boost::format("populated %d archives with %d basebackups, "
+                               "%d tablespaces each in %.1f ms")
+      % settings.archives % settings.backups % settings.tablespaces % elapsed.count()
+              << std::endl;
+
+    catalog->close();
+
+    /* Single process */
+    start = std::chrono::steady_clock::now();
+    std::vector<bench_sample> samples = run_load(settings, archives, 0);
+    std::chrono::duration<double, std::micro> wall = std::chrono::steady_clock::now() - start;
+
+    report("single process", samples, wall.count());
+
+    /* Concurrent processes */
+    if (settings.procs > 1) {
+
+      std::ostringstream title;
+
+      title << settings.procs << " concurrent processes";
+
+      start = std::chrono::steady_clock::now();
+      samples = run_concurrent(settings, archives);
+      wall = std::chrono::steady_clock::now() - start;
+
+      report(title.str(), samples, wall.count());
+
+    }
+
+  } catch (std::exception &e) {
+
+    std::cerr << "benchmark failed: " << e.what() << std::endl;
+    rc = 1;
+
+  }
+
+  if (!settings.keep)
+    boost::filesystem::remove(settings.catalog_name);
+
+  return rc;
+
+}
@@ -2,6 +2,8 @@
 #include <boost/test/unit_test.hpp>
 #include <common.hxx>
 #include <BackupCatalog.hxx>
+#include <backuplockinfo.hxx>
+#include <scheduler.hxx>
 
 using namespace pgbckctl;
 
@@ -125,3 +127,575 @@ BOOST_AUTO_TEST_CASE(TestBackupCatalogCreateArchive)
   BOOST_TEST( !catalog->available() );
 
 }
+
+BOOST_AUTO_TEST_CASE(TestBackupCatalogStatArchive)
+{
+
+  std::shared_ptr<BackupCatalog> catalog = nullptr;
+
+  /* 1 should not throw */
+  BOOST_REQUIRE_NO_THROW( catalog
+                          = std::make_shared<BackupCatalog>(".pg_backup_ctl.sqlite") );
+
+  /* 2 Open backup catalog for read/write */
+  BOOST_REQUIRE_NO_THROW( catalog->open_rw() );
+
+  /*
+   * 3 Materialized archive statistics must follow basebackups
+   *   through their lifecycle.
+   */
+  {
+    std::shared_ptr<CatalogDescr> desc = std::make_shared<CatalogDescr>();
+    std::shared_ptr<StatCatalogArchive> stat;
+    std::shared_ptr<BaseBackupDescr> bb1 = std::make_shared<BaseBackupDescr>();
+    std::shared_ptr<BaseBackupDescr> bb2 = std::make_shared<BaseBackupDescr>();
+    std::shared_ptr<BackupTablespaceDescr> tblspc = std::make_shared<BackupTablespaceDescr>();
+
+    BOOST_REQUIRE_NO_THROW( catalog->startTransaction() );
+
+    desc->archive_name = "stattest";
+    desc->directory = "/tmp/stattest";
+    desc->compression = false;
+    desc->coninfo->type = ConnectionDescr::CONNECTION_TYPE_BASEBACKUP;
+
+    BOOST_REQUIRE_NO_THROW( catalog->createArchive(desc) );
+
+    desc->coninfo->pushAffectedAttribute(SQL_CON_DSN_ATTNO);
+    desc->coninfo->pushAffectedAttribute(SQL_CON_ARCHIVE_ID_ATTNO);
+    desc->coninfo->pushAffectedAttribute(SQL_CON_TYPE_ATTNO);
+    desc->coninfo->dsn = "host=bar.server.name dbname=foo user=test";
+    desc->coninfo->archive_id = desc->id;
+
+    BOOST_REQUIRE_NO_THROW( catalog->createCatalogConnection(desc->coninfo) );
+
+    /* Empty archive */
+    BOOST_REQUIRE_NO_THROW( stat = catalog->statCatalog("stattest") );
+    BOOST_CHECK_EQUAL( stat->archive_id, desc->id );
+    BOOST_CHECK_EQUAL( stat->number_of_backups, 0 );
+    BOOST_CHECK_EQUAL( stat->estimated_total_size, 0 );
+
+    /* Register two basebackups, both are running */
+    for (auto bb : { bb1, bb2 }) {
+      bb->archive_id = desc->id;
+      bb->xlogpos = "0/2000028";
+      bb->timeline = 1;
+      bb->label = "stattest";
+      bb->fsentry = "/tmp/stattest/base/stattest";
+      bb->started = CPGBackupCtlBase::current_timestamp();
+      bb->systemid = "1234";
+      bb->wal_segment_size = 16 * 1024 * 1024;
+      bb->used_profile = 1;
+      bb->pg_version_num = 130000;
+
+      BOOST_REQUIRE_NO_THROW( catalog->registerBasebackup(desc->id, bb) );
+    }
+
+    tblspc->backup_id = bb1->id;
+    tblspc->spcoid = 1663;
+    tblspc->spclocation = "";
+    tblspc->spcsize = 4096;
+    tblspc->checksum_algorithm = "CRC32C";
+    tblspc->checksum = "839206e3";
+    BOOST_REQUIRE_NO_THROW( catalog->registerTablespaceForBackup(tblspc) );
+
+    {
+      std::vector<std::shared_ptr<BackupTablespaceDescr>> fetched;
+      std::vector<int> attrs = { SQL_BCK_TBLSPC_SPCOID_ATTNO,
+                                 SQL_BCK_TBLSPC_CSUM_ALG_ATTNO,
+                                 SQL_BCK_TBLSPC_CSUM_ATTNO };
+
+      BOOST_REQUIRE_NO_THROW( fetched = catalog->getBackupTablespaces(bb1->id, attrs) );
+      BOOST_REQUIRE_EQUAL( fetched.size(), 1 );
+      BOOST_CHECK_EQUAL( fetched[0]->checksum_algorithm, "CRC32C" );
+      BOOST_CHECK_EQUAL( fetched[0]->checksum, "839206e3" );
+    }
+
+    BOOST_REQUIRE_NO_THROW( stat = catalog->statCatalog("stattest") );
+    BOOST_CHECK_EQUAL( stat->number_of_backups, 2 );
+    BOOST_CHECK_EQUAL( stat->backups_running, 2 );
+    BOOST_CHECK_EQUAL( stat->estimated_total_size, 4096 );
+
+    /* Finalize the first, abort the second */
+    bb1->xlogposend = "0/3000000";
+    bb1->bad_pages = 1;
+    bb1->bad_pages_detail = "base/1/1259 block 3";
+    BOOST_REQUIRE_NO_THROW( catalog->finalizeBasebackup(bb1) );
+    BOOST_REQUIRE_NO_THROW( catalog->abortBasebackup(bb2) );
+
+    /* Bad pages found while streaming are recorded */
+    {
+      std::shared_ptr<BaseBackupDescr> fetched;
+
+      BOOST_REQUIRE_NO_THROW( fetched = catalog->getBaseBackup(bb1->id, desc->id) );
+      BOOST_CHECK_EQUAL( fetched->bad_pages, 1 );
+      BOOST_CHECK_EQUAL( fetched->bad_pages_detail, "base/1/1259 block 3" );
+
+      BOOST_REQUIRE_NO_THROW( fetched = catalog->getBaseBackup(bb2->id, desc->id) );
+      BOOST_CHECK_EQUAL( fetched->bad_pages, 0 );
+      BOOST_CHECK_EQUAL( fetched->bad_pages_detail, "" );
+    }
+
+    BOOST_REQUIRE_NO_THROW( stat = catalog->statCatalog("stattest") );
+    BOOST_CHECK_EQUAL( stat->number_of_backups, 2 );
+    BOOST_CHECK_EQUAL( stat->backups_running, 0 );
+    BOOST_CHECK_EQUAL( stat->backups_failed, 1 );
+    BOOST_CHECK_EQUAL( stat->latest_finished, bb1->stopped );
+
+    /* WAL accounting */
+    BOOST_REQUIRE_NO_THROW( catalog->updateArchiveWALStat(desc->id, 2, 32 * 1024 * 1024) );
+    BOOST_REQUIRE_NO_THROW( catalog->updateArchiveWALStat(desc->id, -1, -16 * 1024 * 1024) );
+
+    BOOST_REQUIRE_NO_THROW( stat = catalog->statCatalog("stattest") );
+    BOOST_CHECK_EQUAL( stat->wal_segments, 1 );
+    BOOST_CHECK_EQUAL( stat->wal_bytes, 16 * 1024 * 1024 );
+
+    /* WAL segment checksums */
+    {
+      std::shared_ptr<WALSegmentDescr> segment = std::make_shared<WALSegmentDescr>();
+      std::shared_ptr<WALSegmentDescr> fetched;
+
+      segment->archive_id = desc->id;
+      segment->name = "000000010000000000000002";
+      segment->timeline = 1;
+      segment->size = 16 * 1024 * 1024;
+      segment->checksum_algorithm = "CRC32C";
+      segment->checksum = "00000000";
+
+      BOOST_REQUIRE_NO_THROW( catalog->registerWALSegment(segment) );
+
+      /* streaming the segment again replaces it */
+      segment->checksum = "deadbeef";
+      BOOST_REQUIRE_NO_THROW( catalog->registerWALSegment(segment) );
+
+      BOOST_REQUIRE_NO_THROW( fetched = catalog->getWALSegment(desc->id, segment->name) );
+      BOOST_CHECK_EQUAL( fetched->name, segment->name );
+      BOOST_CHECK_EQUAL( fetched->timeline, 1 );
+      BOOST_CHECK_EQUAL( fetched->size, 16 * 1024 * 1024 );
+      BOOST_CHECK_EQUAL( fetched->checksum, "deadbeef" );
+
+      BOOST_REQUIRE_NO_THROW( catalog->unregisterWALSegments(desc->id, { segment->name }) );
+      BOOST_REQUIRE_NO_THROW( fetched = catalog->getWALSegment(desc->id, segment->name) );
+      BOOST_CHECK_EQUAL( fetched->name, "" );
+    }
+
+    /* Chunk references of deduplicated basebackups */
+    {
+      std::map<std::string, unsigned long long> chunks = { { "aa01", 65536 }, { "bb02", 16384 } };
+      std::vector<std::string> purged;
+
+      /* two basebackups share chunk aa01 */
+      BOOST_REQUIRE_NO_THROW( catalog->referenceChunks(desc->id, chunks) );
+      BOOST_REQUIRE_NO_THROW( catalog->referenceChunks(desc->id, { { "aa01", 65536 } }) );
+
+      BOOST_REQUIRE_NO_THROW( catalog->unreferenceChunks(desc->id, { "aa01", "bb02" }) );
+      BOOST_REQUIRE_NO_THROW( purged = catalog->purgeChunks(desc->id) );
+      BOOST_REQUIRE_EQUAL( purged.size(), 1 );
+      BOOST_CHECK_EQUAL( purged[0], "bb02" );
+
+      BOOST_REQUIRE_NO_THROW( catalog->unreferenceChunks(desc->id, { "aa01" }) );
+      BOOST_REQUIRE_NO_THROW( purged = catalog->purgeChunks(desc->id) );
+      BOOST_REQUIRE_EQUAL( purged.size(), 1 );
+      BOOST_CHECK_EQUAL( purged[0], "aa01" );
+
+      BOOST_REQUIRE_NO_THROW( purged = catalog->purgeChunks(desc->id) );
+      BOOST_CHECK_EQUAL( purged.size(), 0 );
+    }
+
+    /* Deleting basebackups must revert their contribution */
+    BOOST_REQUIRE_NO_THROW( catalog->deleteBaseBackup(bb1->id) );
+    BOOST_REQUIRE_NO_THROW( catalog->deleteBaseBackup(bb2->id) );
+
+    BOOST_REQUIRE_NO_THROW( stat = catalog->statCatalog("stattest") );
+    BOOST_CHECK_EQUAL( stat->number_of_backups, 0 );
+    BOOST_CHECK_EQUAL( stat->backups_failed, 0 );
+    BOOST_CHECK_EQUAL( stat->estimated_total_size, 0 );
+    BOOST_CHECK_EQUAL( stat->latest_finished, "" );
+
+    BOOST_REQUIRE_NO_THROW( catalog->rollbackTransaction() );
+  }
+
+  BOOST_REQUIRE_NO_THROW( catalog->close() );
+
+}
+
+BOOST_AUTO_TEST_CASE(TestBackupCatalogTablespaceBulk)
+{
+
+  std::shared_ptr<BackupCatalog> catalog = nullptr;
+
+  /* 1 should not throw */
+  BOOST_REQUIRE_NO_THROW( catalog
+                          = std::make_shared<BackupCatalog>(".pg_backup_ctl.sqlite") );
+
+  /* 2 Open backup catalog for read/write */
+  BOOST_REQUIRE_NO_THROW( catalog->open_rw() );
+
+  /*
+   * 3 Bulk registered tablespaces must be fetched back completely,
+   *   even if they span multiple INSERT batches.
+   */
+  {
+    std::shared_ptr<CatalogDescr> desc = std::make_shared<CatalogDescr>();
+    std::shared_ptr<BaseBackupDescr> bb = std::make_shared<BaseBackupDescr>();
+    std::shared_ptr<BaseBackupDescr> fetched;
+    std::shared_ptr<StatCatalogArchive> stat;
+    std::vector<std::shared_ptr<BackupTablespaceDescr>> tablespaces;
+    std::vector<std::shared_ptr<BaseBackupDescr>> list;
+    unsigned long long total_size = 0;
+
+    BOOST_REQUIRE_NO_THROW( catalog->startTransaction() );
+
+    desc->archive_name = "tblspctest";
+    desc->directory = "/tmp/tblspctest";
+    desc->compression = false;
+    desc->coninfo->type = ConnectionDescr::CONNECTION_TYPE_BASEBACKUP;
+
+    BOOST_REQUIRE_NO_THROW( catalog->createArchive(desc) );
+
+    desc->coninfo->pushAffectedAttribute(SQL_CON_DSN_ATTNO);
+    desc->coninfo->pushAffectedAttribute(SQL_CON_ARCHIVE_ID_ATTNO);
+    desc->coninfo->pushAffectedAttribute(SQL_CON_TYPE_ATTNO);
+    desc->coninfo->dsn = "host=bar.server.name dbname=foo user=test";
+    desc->coninfo->archive_id = desc->id;
+
+    BOOST_REQUIRE_NO_THROW( catalog->createCatalogConnection(desc->coninfo) );
+
+    bb->archive_id = desc->id;
+    bb->xlogpos = "0/2000028";
+    bb->timeline = 1;
+    bb->label = "tblspctest";
+    bb->fsentry = "/tmp/tblspctest/base/tblspctest";
+    bb->started = CPGBackupCtlBase::current_timestamp();
+    bb->systemid = "1234";
+    bb->wal_segment_size = 16 * 1024 * 1024;
+    bb->used_profile = 1;
+    bb->pg_version_num = 130000;
+
+    BOOST_REQUIRE_NO_THROW( catalog->registerBasebackup(desc->id, bb) );
+
+    for (unsigned int i = 0; i < 450; i++) {
+
+      std::shared_ptr<BackupTablespaceDescr> tblspc = std::make_shared<BackupTablespaceDescr>();
+
+      tblspc->backup_id = bb->id;
+      tblspc->spcoid = 16384 + i;
+      tblspc->spclocation = "/tmp/tblspctest/spc";
+      tblspc->spcsize = 5ULL * 1024 * 1024 * 1024 + i;
+      total_size += tblspc->spcsize;
+
+      tablespaces.push_back(tblspc);
+
+    }
+
+    BOOST_REQUIRE_NO_THROW( catalog->registerTablespacesForBackup(tablespaces) );
+
+    BOOST_REQUIRE_NO_THROW( list = catalog->getBackupList("tblspctest") );
+    BOOST_REQUIRE_EQUAL( list.size(), 1 );
+    BOOST_CHECK_EQUAL( list[0]->id, bb->id );
+    BOOST_REQUIRE_EQUAL( list[0]->tablespaces.size(), 450 );
+    BOOST_CHECK_EQUAL( list[0]->tablespaces[449].spcoid, 16384 + 449 );
+    BOOST_CHECK_EQUAL( list[0]->tablespaces[449].spcsize, 5ULL * 1024 * 1024 * 1024 + 449 );
+
+    BOOST_REQUIRE_NO_THROW( fetched = catalog->getBaseBackup(bb->fsentry, desc->id) );
+    BOOST_CHECK_EQUAL( fetched->tablespaces.size(), 450 );
+
+    BOOST_REQUIRE_NO_THROW( stat = catalog->statCatalog("tblspctest") );
+    BOOST_CHECK_EQUAL( stat->estimated_total_size, total_size );
+
+    BOOST_REQUIRE_NO_THROW( catalog->rollbackTransaction() );
+  }
+
+  BOOST_REQUIRE_NO_THROW( catalog->close() );
+
+}
+
+BOOST_AUTO_TEST_CASE(TestBackupCatalogIncrementalParent)
+{
+
+  std::shared_ptr<BackupCatalog> catalog = nullptr;
+
+  /* 1 should not throw */
+  BOOST_REQUIRE_NO_THROW( catalog
+                          = std::make_shared<BackupCatalog>(".pg_backup_ctl.sqlite") );
+
+  /* 2 Open backup catalog for read/write */
+  BOOST_REQUIRE_NO_THROW( catalog->open_rw() );
+
+  /*
+   * 3 An incremental basebackup references its parent, which
+   *   is locked for retention as long as the incremental exists.
+   */
+  {
+    std::shared_ptr<CatalogDescr> desc = std::make_shared<CatalogDescr>();
+    std::shared_ptr<BaseBackupDescr> full = std::make_shared<BaseBackupDescr>();
+    std::shared_ptr<BaseBackupDescr> incr = std::make_shared<BaseBackupDescr>();
+    std::shared_ptr<BaseBackupDescr> fetched;
+    std::vector<std::shared_ptr<BaseBackupDescr>> list;
+
+    BOOST_REQUIRE_NO_THROW( catalog->startTransaction() );
+
+    desc->archive_name = "incrtest";
+    desc->directory = "/tmp/incrtest";
+    desc->compression = false;
+    desc->coninfo->type = ConnectionDescr::CONNECTION_TYPE_BASEBACKUP;
+
+    BOOST_REQUIRE_NO_THROW( catalog->createArchive(desc) );
+
+    for (auto bb : { full, incr }) {
+
+      bb->archive_id = desc->id;
+      bb->xlogpos = "0/2000028";
+      bb->timeline = 1;
+      bb->started = CPGBackupCtlBase::current_timestamp();
+      bb->systemid = "1234";
+      bb->wal_segment_size = 16 * 1024 * 1024;
+      bb->used_profile = 1;
+      bb->pg_version_num = 170000;
+
+    }
+
+    full->label = "full";
+    full->fsentry = "/tmp/incrtest/base/full";
+    incr->label = "incr";
+    incr->fsentry = "/tmp/incrtest/base/incr";
+
+    BOOST_REQUIRE_NO_THROW( catalog->registerBasebackup(desc->id, full) );
+
+    incr->parent_id = full->id;
+    BOOST_REQUIRE_NO_THROW( catalog->registerBasebackup(desc->id, incr) );
+
+    BOOST_REQUIRE_NO_THROW( fetched = catalog->getBaseBackup(incr->id, desc->id) );
+    BOOST_CHECK_EQUAL( fetched->parent_id, full->id );
+
+    BOOST_REQUIRE_NO_THROW( fetched = catalog->getBaseBackup(full->id, desc->id) );
+    BOOST_CHECK_EQUAL( fetched->parent_id, -1 );
+
+    BOOST_CHECK_EQUAL( catalog->getIncrementalChildCount(full->id), 1 );
+    BOOST_CHECK_EQUAL( catalog->getIncrementalChildCount(incr->id), 0 );
+
+    BOOST_REQUIRE_NO_THROW( list = catalog->getBackupList("incrtest") );
+    BOOST_REQUIRE_EQUAL( list.size(), 2 );
+
+    {
+      BackupIncrementalLockInfo lockInfo(list);
+
+      BOOST_CHECK( lockInfo.locked(full) == LOCKED_BY_INCREMENTAL );
+      BOOST_CHECK( lockInfo.locked(incr) == NOT_LOCKED );
+    }
+
+    /* An aborted incremental doesn't need its parent anymore */
+    BOOST_REQUIRE_NO_THROW( catalog->abortBasebackup(incr) );
+    BOOST_CHECK_EQUAL( catalog->getIncrementalChildCount(full->id), 0 );
+
+    BOOST_REQUIRE_NO_THROW( catalog->rollbackTransaction() );
+  }
+
+  BOOST_REQUIRE_NO_THROW( catalog->close() );
+
+}
+
+BOOST_AUTO_TEST_CASE(TestBackupCatalogRetentionPlan)
+{
+
+  std::shared_ptr<BackupCatalog> catalog = nullptr;
+
+  /* 1 should not throw */
+  BOOST_REQUIRE_NO_THROW( catalog
+                          = std::make_shared<BackupCatalog>(".pg_backup_ctl.sqlite") );
+
+  /* 2 Open backup catalog for read/write */
+  BOOST_REQUIRE_NO_THROW( catalog->open_rw() );
+
+  /*
+   * 3 A persisted retention plan must be read back with its
+   *   pending basebackups and WAL cleanup offsets, and shrink
+   *   as basebackups are finished.
+   */
+  {
+    std::shared_ptr<CatalogDescr> desc = std::make_shared<CatalogDescr>();
+    std::shared_ptr<RetentionPlanDescr> plan = std::make_shared<RetentionPlanDescr>();
+    std::shared_ptr<RetentionPlanDescr> fetched;
+    std::shared_ptr<xlog_cleanup_off_t> offset = std::make_shared<xlog_cleanup_off_t>();
+
+    BOOST_REQUIRE_NO_THROW( catalog->startTransaction() );
+
+    desc->archive_name = "plantest";
+    desc->directory = "/tmp/plantest";
+    desc->compression = false;
+    desc->coninfo->type = ConnectionDescr::CONNECTION_TYPE_BASEBACKUP;
+
+    BOOST_REQUIRE_NO_THROW( catalog->createArchive(desc) );
+
+    /* No plan yet */
+    BOOST_REQUIRE_NO_THROW( fetched = catalog->getRetentionPlan(desc->id) );
+    BOOST_CHECK_EQUAL( fetched->archive_id, -1 );
+
+    plan->archive_id = desc->id;
+    plan->retention_name = "plantest";
+    plan->wal_segment_size = 16 * 1024 * 1024;
+    plan->cleanupDescr->basebackupMode = BASEBACKUP_DELETE;
+    plan->cleanupDescr->mode = WAL_CLEANUP_OFFSET;
+
+    for (int i = 0; i < 3; i++) {
+
+      std::shared_ptr<BaseBackupDescr> bb = std::make_shared<BaseBackupDescr>();
+
+      bb->id = 100 + i;
+      bb->fsentry = "/tmp/plantest/base/streamed-basebackup-" + CPGBackupCtlBase::intToStr(i);
+      plan->cleanupDescr->basebackups.push_back(bb);
+
+    }
+
+    offset->timeline = 2;
+    offset->wal_segment_size = 16 * 1024 * 1024;
+    offset->wal_cleanup_start_pos = 0xFFFFFFFF03000000ULL;
+    plan->cleanupDescr->off_list.insert(std::make_pair(offset->timeline, offset));
+
+    BOOST_REQUIRE_NO_THROW( catalog->createRetentionPlan(plan) );
+
+    /* Only one plan per archive */
+    BOOST_CHECK_THROW( catalog->createRetentionPlan(plan), CCatalogIssue );
+
+    BOOST_REQUIRE_NO_THROW( fetched = catalog->getRetentionPlan(desc->id) );
+    BOOST_CHECK_EQUAL( fetched->archive_id, desc->id );
+    BOOST_CHECK_EQUAL( fetched->retention_name, "plantest" );
+    BOOST_CHECK_EQUAL( fetched->wal_segment_size, 16 * 1024 * 1024 );
+    BOOST_CHECK( fetched->cleanupDescr->mode == WAL_CLEANUP_OFFSET );
+    BOOST_REQUIRE_EQUAL( fetched->cleanupDescr->basebackups.size(), 3 );
+    BOOST_CHECK_EQUAL( fetched->cleanupDescr->basebackups[0]->id, 100 );
+    BOOST_REQUIRE_EQUAL( fetched->cleanupDescr->off_list.size(), 1 );
+    BOOST_CHECK( fetched->cleanupDescr->off_list[2]->wal_cleanup_start_pos
+                 == 0xFFFFFFFF03000000ULL );
+
+    BOOST_REQUIRE_NO_THROW( catalog->finishRetentionPlanBackup(desc->id, 100) );
+
+    BOOST_REQUIRE_NO_THROW( fetched = catalog->getRetentionPlan(desc->id) );
+    BOOST_REQUIRE_EQUAL( fetched->cleanupDescr->basebackups.size(), 2 );
+    BOOST_CHECK_EQUAL( fetched->cleanupDescr->basebackups[0]->id, 101 );
+    BOOST_CHECK_EQUAL( fetched->cleanupDescr->basebackups[1]->fsentry,
+                       "/tmp/plantest/base/streamed-basebackup-2" );
+
+    BOOST_REQUIRE_NO_THROW( catalog->dropRetentionPlan(desc->id) );
+
+    BOOST_REQUIRE_NO_THROW( fetched = catalog->getRetentionPlan(desc->id) );
+    BOOST_CHECK_EQUAL( fetched->archive_id, -1 );
+
+    BOOST_REQUIRE_NO_THROW( catalog->rollbackTransaction() );
+  }
+
+  BOOST_REQUIRE_NO_THROW( catalog->close() );
+
+}
+
+BOOST_AUTO_TEST_CASE(TestBackupCatalogSchedules)
+{
+
+  std::shared_ptr<BackupCatalog> catalog = nullptr;
+
+  /* 1 should not throw */
+  BOOST_REQUIRE_NO_THROW( catalog
+                          = std::make_shared<BackupCatalog>(".pg_backup_ctl.sqlite") );
+
+  /* 2 Open backup catalog for read/write */
+  BOOST_REQUIRE_NO_THROW( catalog->open_rw() );
+
+  /* 3 Schedules are stored per archive and can be read back and dropped */
+  {
+    std::shared_ptr<CatalogDescr> desc = std::make_shared<CatalogDescr>();
+    std::shared_ptr<ScheduleDescr> schedule = std::make_shared<ScheduleDescr>();
+    std::shared_ptr<ScheduleDescr> fetched;
+    std::vector<std::shared_ptr<ScheduleDescr>> schedules;
+
+    BOOST_REQUIRE_NO_THROW( catalog->startTransaction() );
+
+    desc->archive_name = "scheduletest";
+    desc->directory = "/tmp/scheduletest";
+    desc->compression = false;
+    desc->coninfo->type = ConnectionDescr::CONNECTION_TYPE_BASEBACKUP;
+
+    BOOST_REQUIRE_NO_THROW( catalog->createArchive(desc) );
+
+    BOOST_REQUIRE_NO_THROW( fetched = catalog->getSchedule(desc->id, "nightly") );
+    BOOST_CHECK_EQUAL( fetched->id, -1 );
+
+    schedule->archive_id = desc->id;
+    schedule->name = "nightly";
+    schedule->cron = "0 2 * * *";
+    schedule->action = SCHEDULE_ACTION_BASEBACKUP;
+
+    BOOST_REQUIRE_NO_THROW( catalog->createSchedule(schedule) );
+    BOOST_CHECK( schedule->id >= 0 );
+
+    /* Names are unique per archive */
+    BOOST_CHECK_THROW( catalog->createSchedule(schedule), CCatalogIssue );
+
+    BOOST_REQUIRE_NO_THROW( fetched = catalog->getSchedule(desc->id, "nightly") );
+    BOOST_CHECK_EQUAL( fetched->id, schedule->id );
+    BOOST_CHECK_EQUAL( fetched->archive_name, "scheduletest" );
+    BOOST_CHECK_EQUAL( fetched->cron, "0 2 * * *" );
+    BOOST_CHECK( fetched->action == SCHEDULE_ACTION_BASEBACKUP );
+    BOOST_CHECK_EQUAL( fetched->last_run, "" );
+
+    BOOST_REQUIRE_NO_THROW( catalog->setScheduleLastRun(schedule->id, "2024-01-01 02:00:00") );
+    BOOST_REQUIRE_NO_THROW( schedules = catalog->getSchedules(desc->id) );
+    BOOST_REQUIRE_EQUAL( schedules.size(), 1 );
+    BOOST_CHECK_EQUAL( schedules[0]->last_run, "2024-01-01 02:00:00" );
+
+    BOOST_REQUIRE_NO_THROW( catalog->dropSchedule(schedule->id) );
+    BOOST_REQUIRE_NO_THROW( schedules = catalog->getSchedules(desc->id) );
+    BOOST_CHECK_EQUAL( schedules.size(), 0 );
+
+    BOOST_REQUIRE_NO_THROW( catalog->rollbackTransaction() );
+  }
+
+  BOOST_REQUIRE_NO_THROW( catalog->close() );
+
+  /* 4 Cron expressions */
+  {
+    struct tm tm;
+    time_t start;
+    time_t next;
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = 124; /* 2024-01-01 10:17, a monday */
+    tm.tm_mon = 0;
+    tm.tm_mday = 1;
+    tm.tm_hour = 10;
+    tm.tm_min = 17;
+    tm.tm_isdst = -1;
+    start = mktime(&tm);
+
+    CronExpression every15("*/15 * * * *");
+    next = every15.next(start);
+    localtime_r(&next, &tm);
+    BOOST_CHECK_EQUAL( tm.tm_hour, 10 );
+    BOOST_CHECK_EQUAL( tm.tm_min, 30 );
+
+    CronExpression weekend("30 2 * * 6,7");
+    next = weekend.next(start);
+    localtime_r(&next, &tm);
+    BOOST_CHECK_EQUAL( tm.tm_mday, 6 );
+    BOOST_CHECK_EQUAL( tm.tm_hour, 2 );
+    BOOST_CHECK_EQUAL( tm.tm_min, 30 );
+
+    /* Restricted day of month and day of week match either */
+    CronExpression either("0 0 15 * 3");
+    next = either.next(start);
+    localtime_r(&next, &tm);
+    BOOST_CHECK_EQUAL( tm.tm_mday, 3 );
+
+    CronExpression monthly("@monthly");
+    next = monthly.next(start);
+    localtime_r(&next, &tm);
+    BOOST_CHECK_EQUAL( tm.tm_mon, 1 );
+    BOOST_CHECK_EQUAL( tm.tm_mday, 1 );
+    BOOST_CHECK_EQUAL( tm.tm_hour, 0 );
+
+    BOOST_CHECK_THROW( CronExpression("* * *"), SchedulerFailure );
+    BOOST_CHECK_THROW( CronExpression("60 * * * *"), SchedulerFailure );
+    BOOST_CHECK_THROW( CronExpression("*/0 * * * *"), SchedulerFailure );
+    BOOST_CHECK_THROW( CronExpression("a * * * *"), SchedulerFailure );
+    BOOST_CHECK_THROW( CronExpression("0 0 30 2 *").next(start), SchedulerFailure );
+  }
+
+}
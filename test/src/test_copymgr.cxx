@@ -1,5 +1,8 @@
 #define BOOST_TEST_MODULE TestCopyManager
+#include <fstream>
+#include <iterator>
 #include <vector>
+#include <sys/stat.h>
 #include <boost/test/unit_test.hpp>
 #include <common.hxx>
 #include <fs-copy.hxx>
@@ -162,3 +165,105 @@ BOOST_AUTO_TEST_CASE(TestCopyManager)
   boost::filesystem::remove_all(targetPath);
 
 }
+
+BOOST_AUTO_TEST_CASE(TestZeroBlock)
+{
+
+  std::vector<char> buf(3 * SPARSE_BLOCK_SIZE + 7, 0);
+
+  BOOST_TEST(SparseFile::zero(buf.data(), buf.size()));
+  BOOST_TEST(SparseFile::zero(buf.data(), 0));
+
+  /* a single byte anywhere, also in the unaligned tail */
+  for (size_t i : { (size_t) 0, (size_t) 63, (size_t) 64, (size_t) 127,
+                    (size_t) SPARSE_BLOCK_SIZE, buf.size() - 1 }) {
+
+    buf[i] = 1;
+    BOOST_TEST(!SparseFile::zero(buf.data(), buf.size()));
+    BOOST_TEST(SparseFile::zero(buf.data() + i + 1, buf.size() - i - 1));
+    buf[i] = 0;
+
+  }
+
+}
+
+BOOST_AUTO_TEST_CASE(TestSparseCopy)
+{
+
+  std::shared_ptr<BackupCopyManager> copyMgr = nullptr;
+
+  path sourcePath = path(BackupDirectory::system_temp_directory() / "_copyMgrSparseSource");
+  path targetPath = path(BackupDirectory::system_temp_directory() / "_copyMgrSparseTarget");
+
+  create_directories(sourcePath);
+  create_directories(targetPath);
+
+  std::shared_ptr<BackupDirectory> sourceDir
+          = std::make_shared<BackupDirectory>(sourcePath);
+  std::shared_ptr<TargetDirectory> targetDir
+          = std::make_shared<TargetDirectory>(targetPath);
+
+  create_directories(sourceDir->basedir());
+
+  /*
+   * Unaligned data, four zero blocks, data and zero blocks up to the
+   * end, written in pieces crossing block boundaries.
+   */
+  std::string content = std::string(100, 'A')
+    + std::string(5 * SPARSE_BLOCK_SIZE, '\0')
+    + std::string(SPARSE_BLOCK_SIZE + 1, 'B')
+    + std::string(3 * SPARSE_BLOCK_SIZE, '\0');
+
+  path name = BackupDirectory::temp_filename();
+  std::shared_ptr<ArchiveFile> infile
+    = std::make_shared<ArchiveFile>(sourceDir->basedir() / name);
+
+  infile->setOpenMode("w+");
+  infile->setSparse(true);
+  infile->open();
+
+  for (size_t i = 0; i < content.length(); i += 1000)
+    infile->write(content.c_str() + i, std::min((size_t) 1000, content.length() - i));
+
+  infile->fsync();
+  infile->close();
+
+  BOOST_TEST(file_size(sourceDir->basedir() / name) == content.length());
+
+  copyMgr = std::make_shared<BackupCopyManager>(sourceDir, targetDir);
+  copyMgr->start();
+  copyMgr->wait();
+
+  /* both files have the same content, holes read as zeros */
+  for (path file : { sourceDir->basedir() / name, targetPath / "base" / name }) {
+
+    std::ifstream in(file.string(), std::ios::binary);
+    std::string copied((std::istreambuf_iterator<char>(in)),
+                       std::istreambuf_iterator<char>());
+
+    BOOST_TEST(copied.length() == content.length());
+    BOOST_TEST((copied == content));
+
+  }
+
+  /* zero blocks aren't allocated if the filesystem supports holes */
+  {
+    std::shared_ptr<ArchiveFile> copied
+      = std::make_shared<ArchiveFile>(targetPath / "base" / name);
+    struct stat st;
+
+    copied->setOpenMode("rb");
+    copied->open();
+
+    if (SparseFile::dataRegions(copied->getFileno(), copied->size()).size() > 1) {
+      BOOST_TEST(fstat(copied->getFileno(), &st) == 0);
+      BOOST_TEST((unsigned long long) st.st_blocks * 512 < content.length());
+    }
+
+    copied->close();
+  }
+
+  boost::filesystem::remove_all(sourcePath);
+  boost::filesystem::remove_all(targetPath);
+
+}
@@ -12,7 +12,7 @@ using namespace pgbckctl;
  * NOTE: This needs to be in sync if you add or remove parser
  *       command checks.
  */
-#define NUM_SUCCESSFUL_PARSER_COMMANDS 62
+#define NUM_SUCCESSFUL_PARSER_COMMANDS 78
 #define COMMAND_IS_VALID(cmd, number) ( ((cmd) != nullptr) && ((number)++ > 0) )
 
 BOOST_AUTO_TEST_CASE(TestParser)
@@ -135,6 +135,8 @@ BOOST_AUTO_TEST_CASE(TestParser)
     BOOST_TEST( (backup_profile->wait_for_wal) );
     BOOST_TEST( (!backup_profile->noverify_checksums) );
     BOOST_TEST( (backup_profile->manifest_checksums == "CRC32C") );
+    BOOST_TEST( (!backup_profile->deduplicate) );
+    BOOST_TEST( (!backup_profile->verify_pages) );
 
     /* default checksum mode is CRC32C */
     BOOST_TEST( (backup_profile->manifest_checksums == "CRC32C") );
@@ -559,6 +561,7 @@ BOOST_AUTO_TEST_CASE(TestParser)
     std::shared_ptr<CatalogDescr> descr = command->getExecutableDescr();
     BOOST_TEST( (descr != nullptr) );
     BOOST_TEST( (descr->retention_name == "test") );
+    BOOST_TEST( (descr->dry_run == false) );
 
   }
 
@@ -1160,6 +1163,337 @@ BOOST_AUTO_TEST_CASE(TestParser)
 
   }
 
+  /* 63 APPLY RETENTION POLICY test TO ARCHIVE test DRY RUN */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("APPLY RETENTION POLICY test TO ARCHIVE test DRY RUN") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    BOOST_TEST( (command->getCommandTag() == APPLY_RETENTION_POLICY) );
+
+    std::shared_ptr<CatalogDescr> descr = command->getExecutableDescr();
+    BOOST_TEST( (descr != nullptr) );
+    BOOST_TEST( (descr->retention_name == "test") );
+    BOOST_TEST( (descr->archive_name == "test") );
+    BOOST_TEST( (descr->dry_run == true) );
+
+  }
+
+  /* 64 START METRICS SERVER test */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("START METRICS SERVER") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+    std::shared_ptr<MetricsServerDescr> metrics = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == START_METRICS_SERVER) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr != nullptr) );
+    BOOST_REQUIRE_NO_THROW( (metrics = descr->getMetricsServerDescr()) );
+    BOOST_TEST( (metrics != nullptr) );
+
+    BOOST_TEST( (metrics->port == MetricsServerDescr::DEFAULT_METRICS_PORT) );
+    BOOST_TEST( (metrics->listen_on.size() == 0) );
+
+  }
+
+  /* 65 START METRICS SERVER test */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("START METRICS SERVER PORT 9100 LISTEN_ON (127.0.0.1) NODETACH") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+    std::shared_ptr<MetricsServerDescr> metrics = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == START_METRICS_SERVER) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr != nullptr) );
+    BOOST_REQUIRE_NO_THROW( (metrics = descr->getMetricsServerDescr()) );
+    BOOST_TEST( (metrics != nullptr) );
+
+    BOOST_TEST( (metrics->port == 9100) );
+    BOOST_TEST( (metrics->listen_on.size() == 1) );
+    BOOST_TEST( (metrics->listen_on[0] == "127.0.0.1") );
+    BOOST_TEST( (descr->detach == false) );
+
+  }
+
+  /* 66 CREATE SCHEDULE ... BASEBACKUP test */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("CREATE SCHEDULE nightly FOR ARCHIVE test CRON \"30 2 * * 1-5\" BASEBACKUP PROFILE fast") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+    std::shared_ptr<ScheduleDescr> schedule = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == CREATE_SCHEDULE) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr != nullptr) );
+    BOOST_REQUIRE_NO_THROW( (schedule = descr->getScheduleDescr()) );
+    BOOST_TEST( (schedule != nullptr) );
+
+    BOOST_TEST( (descr->archive_name == "test") );
+    BOOST_TEST( (schedule->name == "nightly") );
+    BOOST_TEST( (schedule->cron == "30 2 * * 1-5") );
+    BOOST_TEST( (schedule->action == SCHEDULE_ACTION_BASEBACKUP) );
+    BOOST_TEST( (schedule->param == "fast") );
+
+  }
+
+  /* 67 CREATE SCHEDULE ... BASEBACKUP without profile test */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("CREATE SCHEDULE hourly FOR ARCHIVE test CRON \"@hourly\" BASEBACKUP") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == CREATE_SCHEDULE) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr->getScheduleDescr()->cron == "@hourly") );
+    BOOST_TEST( (descr->getScheduleDescr()->param == "") );
+
+  }
+
+  /* 68 CREATE SCHEDULE ... RETENTION POLICY test */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("CREATE SCHEDULE cleanup FOR ARCHIVE test CRON \"0 4 * * 0\" RETENTION POLICY keep3") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == CREATE_SCHEDULE) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr->getScheduleDescr()->action == SCHEDULE_ACTION_RETENTION) );
+    BOOST_TEST( (descr->getScheduleDescr()->param == "keep3") );
+
+  }
+
+  /* 69 DROP SCHEDULE test */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("DROP SCHEDULE nightly FROM ARCHIVE test") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == DROP_SCHEDULE) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr->archive_name == "test") );
+    BOOST_TEST( (descr->getScheduleDescr()->name == "nightly") );
+
+  }
+
+  /* 70 LIST SCHEDULES test */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("LIST SCHEDULES FOR ARCHIVE test") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == LIST_SCHEDULES) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr->archive_name == "test") );
+
+  }
+
+  /* A schedule needs a job */
+  BOOST_CHECK_THROW( parser.parseLine("CREATE SCHEDULE nightly FOR ARCHIVE test CRON \"0 2 * * *\""),
+                     CParserIssue );
+
+  /* 71 SET VARIABLE policy.basebackup_cpus = "0-3,8" */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("SET VARIABLE policy.basebackup_cpus = \"0-3,8\"") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == SET_VARIABLE) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr->var_name == "policy.basebackup_cpus") );
+    BOOST_TEST( (descr->var_val_str == "0-3,8") );
+
+  }
+
+  /* 72 SHOW EVENTS PID 4711 */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("SHOW EVENTS PID 4711") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == SHOW_EVENTS) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr->worker_pid == 4711) );
+
+  }
+
+  /* 73 CREATE BACKUP PROFILE test COMPRESSION=ZSTD ON SERVER LEVEL=5 WORKERS=4 */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("CREATE BACKUP PROFILE test COMPRESSION=ZSTD ON SERVER LEVEL=5 WORKERS=4") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    BOOST_TEST( (command->getCommandTag() == CREATE_BACKUP_PROFILE) );
+
+    std::shared_ptr<CatalogDescr> descr = command->getExecutableDescr();
+    std::shared_ptr<BackupProfileDescr> backup_profile = descr->getBackupProfileDescr();
+
+    BOOST_TEST( (backup_profile != nullptr) );
+    BOOST_TEST( (backup_profile->compress_type == BACKUP_COMPRESS_TYPE_ZSTD) );
+    BOOST_TEST( (backup_profile->compress_on_server) );
+    BOOST_TEST( (backup_profile->compress_level == 5) );
+    BOOST_TEST( (backup_profile->compress_workers == 4) );
+
+  }
+
+  /* ON SERVER requires the SERVER keyword */
+  BOOST_CHECK_THROW( parser.parseLine("CREATE BACKUP PROFILE test COMPRESSION=ZSTD ON LEVEL=5"),
+                     CParserIssue );
+
+  /* 74 START BASEBACKUP FOR ARCHIVE test PROFILE bla INCREMENTAL */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("START BASEBACKUP FOR ARCHIVE test PROFILE bla INCREMENTAL") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == START_BASEBACKUP) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr->getBackupProfileDescr()->name == "bla") );
+    BOOST_TEST( (descr->incremental) );
+    BOOST_TEST( (!descr->force_systemid_update) );
+
+  }
+
+  /* 75 VERIFY BASEBACKUP 1 FROM ARCHIVE test PARALLEL 4 */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("VERIFY BASEBACKUP 1 FROM ARCHIVE test PARALLEL 4") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == VERIFY_BASEBACKUP) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr->basebackup_id == 1) );
+    BOOST_TEST( (descr->archive_name == "test") );
+    BOOST_TEST( (descr->parallel == 4) );
+
+  }
+
+  /* 76 CREATE BACKUP PROFILE test COMPRESSION=GZIP MANIFEST INCLUDED DEDUPLICATE=TRUE */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("CREATE BACKUP PROFILE test COMPRESSION=GZIP MANIFEST INCLUDED DEDUPLICATE=TRUE") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    BOOST_TEST( (command->getCommandTag() == CREATE_BACKUP_PROFILE) );
+
+    std::shared_ptr<CatalogDescr> descr = command->getExecutableDescr();
+    std::shared_ptr<BackupProfileDescr> backup_profile = descr->getBackupProfileDescr();
+
+    BOOST_TEST( (backup_profile != nullptr) );
+    BOOST_TEST( (backup_profile->compress_type == BACKUP_COMPRESS_TYPE_GZIP) );
+    BOOST_TEST( (backup_profile->manifest) );
+    BOOST_TEST( (backup_profile->deduplicate) );
+
+  }
+
+  /* 77 CREATE BACKUP PROFILE test COMPRESSION=ZSTD VERIFY_PAGES=TRUE */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("CREATE BACKUP PROFILE test COMPRESSION=ZSTD VERIFY_PAGES=TRUE") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    BOOST_TEST( (command->getCommandTag() == CREATE_BACKUP_PROFILE) );
+
+    std::shared_ptr<CatalogDescr> descr = command->getExecutableDescr();
+    std::shared_ptr<BackupProfileDescr> backup_profile = descr->getBackupProfileDescr();
+
+    BOOST_TEST( (backup_profile != nullptr) );
+    BOOST_TEST( (backup_profile->compress_type == BACKUP_COMPRESS_TYPE_ZSTD) );
+    BOOST_TEST( (!backup_profile->deduplicate) );
+    BOOST_TEST( (backup_profile->verify_pages) );
+
+  }
+
+  /* 78 START BASEBACKUP FOR ARCHIVE test RESUME */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("START BASEBACKUP FOR ARCHIVE test RESUME") );
+
+  command = parser.getCommand();
+  BOOST_TEST( (command != nullptr) );
+
+  if (COMMAND_IS_VALID(command, count_parser_checks)) {
+
+    std::shared_ptr<CatalogDescr> descr = nullptr;
+
+    BOOST_TEST( (command->getCommandTag() == START_BASEBACKUP) );
+    BOOST_REQUIRE_NO_THROW( (descr = command->getExecutableDescr()) );
+
+    BOOST_TEST( (descr->resume) );
+    BOOST_TEST( (!descr->incremental) );
+
+  }
+
+  /* INCREMENTAL and RESUME exclude each other */
+  BOOST_CHECK_THROW( parser.parseLine("START BASEBACKUP FOR ARCHIVE test INCREMENTAL RESUME"),
+                     CParserIssue );
+
+  /* VERIFY ARCHIVE is still understood */
+  BOOST_REQUIRE_NO_THROW( parser.parseLine("VERIFY ARCHIVE test CONNECTION") );
+  BOOST_TEST( (parser.getCommand()->getCommandTag() == VERIFY_ARCHIVE) );
+
   /* IMPORTANT: Keep that check in sync with the number of
    * successful parser checks NUM_SUCCESSFUL_PARSER_COMMANDS
    *